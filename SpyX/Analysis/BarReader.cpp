@@ -0,0 +1,122 @@
+#include "BarReader.h"
+#include "Core/Simd.h"
+
+#include <algorithm>
+
+// Columns[X] += 1 where Mask[X] is set; Mask holds 0xFF or 0 per pixel
+static void AddMaskColumns(const uint8_t *Mask, int Width, uint16_t *Columns)
+{
+    int X = 0;
+
+#ifdef SPYX_SSE2
+    {
+        const __m128i One = _mm_set1_epi8(1);
+        const __m128i Zero = _mm_setzero_si128();
+        for (; X + 16 <= Width; X += 16)
+        {
+            __m128i Hits = _mm_and_si128(_mm_loadu_si128((const __m128i *)(Mask + X)), One);
+            __m128i Low = _mm_loadu_si128((const __m128i *)(Columns + X));
+            __m128i High = _mm_loadu_si128((const __m128i *)(Columns + X + 8));
+            _mm_storeu_si128((__m128i *)(Columns + X), _mm_add_epi16(Low, _mm_unpacklo_epi8(Hits, Zero)));
+            _mm_storeu_si128((__m128i *)(Columns + X + 8), _mm_add_epi16(High, _mm_unpackhi_epi8(Hits, Zero)));
+        }
+    }
+#endif
+
+    for (; X < Width; X++) Columns[X] += Mask[X] & 1;
+}
+
+// Set pixels of a mask row
+static uint32_t CountMaskRow(const uint8_t *Mask, int Width)
+{
+    uint32_t Count = 0;
+    int X = 0;
+
+#ifdef SPYX_SSE2
+    {
+        const __m128i One = _mm_set1_epi8(1);
+        __m128i Sums = _mm_setzero_si128();
+        for (; X + 16 <= Width; X += 16)
+        {
+            __m128i Hits = _mm_and_si128(_mm_loadu_si128((const __m128i *)(Mask + X)), One);
+            Sums = _mm_add_epi64(Sums, _mm_sad_epu8(Hits, _mm_setzero_si128()));
+        }
+        Count = (uint32_t)_mm_cvtsi128_si32(Sums) + (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(Sums, 8));
+    }
+#endif
+
+    for (; X < Width; X++) Count += Mask[X] & 1;
+    return Count;
+}
+
+bool CBarReader::ReadBar(const SImageView &Frame, const SBarRequest &Bar, SBarReading &Out)
+{
+    Out = SBarReading();
+    if (!Bar.Ranges || Bar.RangeCount < 1 || Bar.RangeCount > MaxColorRanges || Bar.Width <= 0 || Bar.Height <= 0) return false;
+
+    const SPixelRect Area = ClipToFrame(Bar.X, Bar.Y, Bar.Width, Bar.Height, Frame.Width, Frame.Height);
+    if (Area.IsEmpty()) return false;
+
+    const int Left = Area.Left;
+    const int Top = Area.Top;
+    const int Width = Area.GetWidth();
+    const int Height = Area.GetHeight();
+    const bool IsHorizontal = Bar.Orientation == EBarOrientation::LeftToRight || Bar.Orientation == EBarOrientation::RightToLeft;
+    const bool IsReversed = Bar.Orientation == EBarOrientation::RightToLeft || Bar.Orientation == EBarOrientation::BottomToTop;
+    const int Length = IsHorizontal ? Width : Height;
+    const int Thickness = IsHorizontal ? Height : Width;
+    const int BytesPerPixel = GetBytesPerPixel(Frame.Format);
+
+    MMask.resize((size_t)Width);
+    MProfile.resize((size_t)Length);
+    if (IsHorizontal) MColumns.assign((size_t)Width, 0);
+    for (int Y = 0; Y < Height; Y++)
+    {
+        MatchColorRow(Frame.Row(Top + Y) + (size_t)Left * BytesPerPixel, Frame.Format, Width, Bar.Ranges, Bar.RangeCount,
+            MMask.data());
+        if (IsHorizontal) AddMaskColumns(MMask.data(), Width, MColumns.data());
+        else MProfile[IsReversed ? Height - 1 - Y : Y] = CountMaskRow(MMask.data(), Width);
+    }
+    if (IsHorizontal)
+    {
+        for (int X = 0; X < Width; X++) MProfile[IsReversed ? Width - 1 - X : X] = MColumns[X];
+    }
+
+    // A step filled before Edge and empty from it agrees with Filled(Edge) + Empty(Edge) pixels:
+    // 2 * Prefix - Total + Thickness * (Length - Edge). The best edge maximizes that.
+    int64_t Total = 0;
+    for (int Index = 0; Index < Length; Index++) Total += MProfile[Index];
+
+    int64_t Prefix = 0;
+    int BestEdge = 0;
+    int64_t BestAgreement = (int64_t)Thickness * Length - Total;
+    for (int Edge = 1; Edge <= Length; Edge++)
+    {
+        Prefix += MProfile[Edge - 1];
+        const int64_t Agreement = 2 * Prefix - Total + (int64_t)Thickness * (Length - Edge);
+        if (Agreement > BestAgreement)
+        {
+            BestAgreement = Agreement;
+            BestEdge = Edge;
+        }
+    }
+
+    // Any profile agrees with some step on at least half its pixels, so that half maps to 0
+    const double Agreement = (double)BestAgreement / ((double)Thickness * Length);
+    Out.Fraction = (float)BestEdge / Length;
+    Out.Confidence = (float)std::max(0.0, 2.0 * Agreement - 1.0);
+    Out.IsValid = true;
+    return true;
+}
+
+int CBarReader::Read(const SImageView &Frame, const SBarRequest *Bars, int Count, SBarReading *Out)
+{
+    if (!Frame.IsValid() || (Frame.Format != EPixelFormat::BGRA8 && Frame.Format != EPixelFormat::Gray8)) return -1;
+
+    int Valid = 0;
+    for (int Index = 0; Index < Count; Index++)
+    {
+        if (ReadBar(Frame, Bars[Index], Out[Index])) Valid++;
+    }
+    return Valid;
+}
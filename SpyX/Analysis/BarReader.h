@@ -0,0 +1,57 @@
+#ifndef TAPI_BAR_READER_H
+#define TAPI_BAR_READER_H
+
+#include "Analysis/ColorSearch.h"
+#include "Imaging/ImageView.h"
+
+#include <cstdint>
+#include <vector>
+
+// Reads the fill level of progress, health and similar bars. The pixels of a bar's area that
+// match its fill colours are counted per column (per row for vertical bars), giving a profile
+// along the fill direction. The fill edge is where a step from full to empty fits that profile
+// best, so stray pixels, text over the bar and soft edges shift it little. How well the step
+// fits gives the confidence.
+
+enum class EBarOrientation : int
+{
+    LeftToRight = 0,    // Fills from the left edge
+    RightToLeft = 1,
+    BottomToTop = 2,
+    TopToBottom = 3
+};
+
+struct SBarRequest
+{
+    int X = 0;                      // Bar area, clipped to the frame
+    int Y = 0;
+    int Width = 0;
+    int Height = 0;
+    EBarOrientation Orientation = EBarOrientation::LeftToRight;
+    const SColorRange *Ranges = nullptr;    // Fill colours, 1 to MaxColorRanges
+    int RangeCount = 0;
+};
+
+struct SBarReading
+{
+    float Fraction = 0.0f;          // 0-1, filled length over bar length
+    float Confidence = 0.0f;        // 0 = no better than noise, 1 = a clean step
+    bool IsValid = false;           // False if the area missed the frame or the ranges were invalid
+};
+
+class CBarReader
+{
+public:
+    // Reads Count bars of one frame into Out. Returns the number of valid readings, or -1 if
+    // the frame is not BGRA8/Gray8.
+    int Read(const SImageView &Frame, const SBarRequest *Bars, int Count, SBarReading *Out);
+
+private:
+    bool ReadBar(const SImageView &Frame, const SBarRequest &Bar, SBarReading &Out);
+
+    std::vector<uint8_t> MMask;
+    std::vector<uint16_t> MColumns;
+    std::vector<uint32_t> MProfile; // Matches per step along the fill direction
+};
+
+#endif
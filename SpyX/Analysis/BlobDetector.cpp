@@ -0,0 +1,274 @@
+#include "BlobDetector.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Mask rows per parallel task; strips only change the order runs are joined in, not the result
+static const int StripRows = 64;
+
+static int FindRoot(std::vector<int> &Parents, int Index)
+{
+    while (Parents[Index] != Index)
+    {
+        Parents[Index] = Parents[Parents[Index]];
+        Index = Parents[Index];
+    }
+    return Index;
+}
+
+// The lower index becomes the root, so every root is the first run of its component in scan order
+static void Unite(std::vector<int> &Parents, int First, int Second)
+{
+    First = FindRoot(Parents, First);
+    Second = FindRoot(Parents, Second);
+    if (First < Second) Parents[Second] = First;
+    else if (Second < First) Parents[First] = Second;
+}
+
+// Index of the first non-zero byte at or after X, or Width
+static int SkipZeros(const uint8_t *Row, int X, int Width)
+{
+    uint64_t Word;
+    while (X + 8 <= Width)
+    {
+        std::memcpy(&Word, Row + X, 8);
+        if (Word) break;
+        X += 8;
+    }
+    while (X < Width && !Row[X]) X++;
+    return X;
+}
+
+CBlobDetector::CBlobDetector(int ThreadCount)
+{
+    MPool = std::make_unique<CThreadPool>(ThreadCount);
+}
+
+CBlobDetector::~CBlobDetector() = default;
+
+void CBlobDetector::JoinRows(const SRun *Upper, int UpperCount, int UpperBase, const SRun *Lower, int LowerCount,
+    int LowerBase, std::vector<int> &Parents) const
+{
+    const int Reach = MOptions.IsEightConnected ? 1 : 0;
+    int First = 0;
+    for (int Index = 0; Index < LowerCount; Index++)
+    {
+        const SRun &Run = Lower[Index];
+        while (First < UpperCount && Upper[First].End + Reach < Run.Start) First++;
+        for (int Other = First; Other < UpperCount && Upper[Other].Start <= Run.End + Reach; Other++)
+        {
+            if (MOptions.IsLabelMap && Upper[Other].Label != Run.Label) continue;
+            Unite(Parents, UpperBase + Other, LowerBase + Index);
+        }
+    }
+}
+
+void CBlobDetector::ScanStrip(int Index)
+{
+    SStrip &Strip = MStrips[Index];
+    Strip.Runs.clear();
+    Strip.RowStarts.clear();
+    Strip.Parents.clear();
+
+    const int Width = MMask.Width;
+    for (int Y = Strip.Top; Y < Strip.Bottom; Y++)
+    {
+        const uint8_t *Row = MMask.Row(Y);
+        const int RowStart = (int)Strip.Runs.size();
+        Strip.RowStarts.push_back(RowStart);
+
+        for (int X = SkipZeros(Row, 0, Width); X < Width; X = SkipZeros(Row, X, Width))
+        {
+            SRun Run;
+            Run.Start = X;
+            Run.Y = Y;
+            Run.Label = Row[X];
+            if (MOptions.IsLabelMap)
+            {
+                while (X < Width && Row[X] == Run.Label) X++;
+            }
+            else
+            {
+                while (X < Width && Row[X]) X++;
+            }
+            Run.End = X - 1;
+            Strip.Runs.push_back(Run);
+            Strip.Parents.push_back((int)Strip.Parents.size());
+        }
+
+        if (Y > Strip.Top)
+        {
+            const int PreviousStart = Strip.RowStarts[Strip.RowStarts.size() - 2];
+            JoinRows(Strip.Runs.data() + PreviousStart, RowStart - PreviousStart, PreviousStart, Strip.Runs.data() + RowStart,
+                (int)Strip.Runs.size() - RowStart, RowStart, Strip.Parents);
+        }
+    }
+    Strip.RowStarts.push_back((int)Strip.Runs.size());
+}
+
+int CBlobDetector::Detect(const SImageView &Mask, const SBlobOptions &Options, const SBlobColorSource *Colors,
+    std::vector<SBlob> &Out)
+{
+    Out.clear();
+    if (!Mask.IsValid() || Mask.Format != EPixelFormat::Gray8) return -1;
+    if (Colors && (!Colors->Frame.IsValid() || Colors->Step < 1 ||
+        (Colors->Frame.Format != EPixelFormat::BGRA8 && Colors->Frame.Format != EPixelFormat::Gray8))) return -1;
+
+    MMask = Mask;
+    MOptions = Options;
+    const int StripCount = (Mask.Height + StripRows - 1) / StripRows;
+    MStrips.resize((size_t)StripCount);
+    for (int Index = 0; Index < StripCount; Index++)
+    {
+        MStrips[Index].Top = Index * StripRows;
+        MStrips[Index].Bottom = std::min(MStrips[Index].Top + StripRows, Mask.Height);
+    }
+    MPool->ParallelFor(StripCount, [this](int Index) { ScanStrip(Index); });
+
+    // Strip trees side by side in one forest, then joined across each strip edge
+    std::vector<int> Bases((size_t)StripCount + 1, 0);
+    for (int Index = 0; Index < StripCount; Index++)
+    {
+        Bases[Index + 1] = Bases[Index] + (int)MStrips[Index].Runs.size();
+    }
+    MParents.resize((size_t)Bases[StripCount]);
+    for (int Index = 0; Index < StripCount; Index++)
+    {
+        const SStrip &Strip = MStrips[Index];
+        for (size_t Run = 0; Run < Strip.Parents.size(); Run++) MParents[Bases[Index] + Run] = Bases[Index] + Strip.Parents[Run];
+    }
+    for (int Index = 1; Index < StripCount; Index++)
+    {
+        const SStrip &Upper = MStrips[Index - 1];
+        const SStrip &Lower = MStrips[Index];
+        const int UpperStart = Upper.RowStarts[Upper.RowStarts.size() - 2];
+        const int LowerEnd = Lower.RowStarts[1];
+        JoinRows(Upper.Runs.data() + UpperStart, (int)Upper.Runs.size() - UpperStart, Bases[Index - 1] + UpperStart,
+            Lower.Runs.data(), LowerEnd, Bases[Index], MParents);
+    }
+
+    // Components numbered in scan order of their first run
+    MComponentOf.resize(MParents.size());
+    MComponents.clear();
+    for (int Index = 0; Index < StripCount; Index++)
+    {
+        const SStrip &Strip = MStrips[Index];
+        for (size_t Run = 0; Run < Strip.Runs.size(); Run++)
+        {
+            const int Global = Bases[Index] + (int)Run;
+            const int Root = FindRoot(MParents, Global);
+            const SRun &Span = Strip.Runs[Run];
+            const int Length = Span.End - Span.Start + 1;
+
+            if (Root == Global)
+            {
+                MComponentOf[Global] = (int)MComponents.size();
+                SComponent Component;
+                Component.Left = Span.Start;
+                Component.Top = Span.Y;
+                Component.Right = Span.End;
+                Component.Bottom = Span.Y;
+                Component.Label = Span.Label;
+                MComponents.push_back(Component);
+            }
+            else
+            {
+                MComponentOf[Global] = MComponentOf[Root];
+            }
+
+            SComponent &Component = MComponents[MComponentOf[Global]];
+            Component.Left = std::min(Component.Left, Span.Start);
+            Component.Right = std::max(Component.Right, Span.End);
+            Component.Bottom = Span.Y;
+            Component.Area += Length;
+            Component.DoubleSumX += (int64_t)(Span.Start + Span.End) * Length;
+            Component.SumY += (int64_t)Span.Y * Length;
+        }
+    }
+
+    MKept.clear();
+    for (int Component = 0; Component < (int)MComponents.size(); Component++)
+    {
+        if (MComponents[Component].Area >= Options.MinArea) MKept.push_back(Component);
+    }
+    const int Passed = (int)MKept.size();
+
+    auto IsLarger = [this](int First, int Second)
+    {
+        const int64_t FirstArea = MComponents[First].Area;
+        const int64_t SecondArea = MComponents[Second].Area;
+        return FirstArea != SecondArea ? FirstArea > SecondArea : First < Second;
+    };
+    if (Options.MaxBlobs > 0 && Passed > Options.MaxBlobs)
+    {
+        std::partial_sort(MKept.begin(), MKept.begin() + Options.MaxBlobs, MKept.end(), IsLarger);
+        MKept.resize((size_t)Options.MaxBlobs);
+    }
+    else
+    {
+        std::sort(MKept.begin(), MKept.end(), IsLarger);
+    }
+
+    MSlotOf.assign(MComponents.size(), -1);
+    Out.resize(MKept.size());
+    for (size_t Slot = 0; Slot < MKept.size(); Slot++)
+    {
+        const SComponent &Component = MComponents[MKept[Slot]];
+        SBlob &Blob = Out[Slot];
+        Blob.X = Component.Left;
+        Blob.Y = Component.Top;
+        Blob.Width = Component.Right - Component.Left + 1;
+        Blob.Height = Component.Bottom - Component.Top + 1;
+        Blob.Area = (int)Component.Area;
+        Blob.CentroidX = (float)((double)Component.DoubleSumX / (2.0 * Component.Area));
+        Blob.CentroidY = (float)((double)Component.SumY / Component.Area);
+        Blob.Label = Component.Label;
+        MSlotOf[MKept[Slot]] = (int)Slot;
+    }
+    if (!Colors || Out.empty()) return Passed;
+
+    // Second pass over the runs of kept components only
+    const SImageView &Frame = Colors->Frame;
+    const bool IsGray = Frame.Format == EPixelFormat::Gray8;
+    MColorSums.assign(Out.size() * 4, 0);
+    for (int Index = 0; Index < StripCount; Index++)
+    {
+        const SStrip &Strip = MStrips[Index];
+        for (size_t Run = 0; Run < Strip.Runs.size(); Run++)
+        {
+            const int Slot = MSlotOf[MComponentOf[Bases[Index] + Run]];
+            if (Slot < 0) continue;
+
+            const SRun &Span = Strip.Runs[Run];
+            const int FrameY = std::min(std::max(Colors->Y + Span.Y * Colors->Step + Colors->Step / 2, 0), Frame.Height - 1);
+            const uint8_t *Row = Frame.Row(FrameY);
+            uint64_t *Sums = &MColorSums[(size_t)Slot * 4];
+            for (int X = Span.Start; X <= Span.End; X++)
+            {
+                const int FrameX = std::min(std::max(Colors->X + X * Colors->Step + Colors->Step / 2, 0), Frame.Width - 1);
+                if (IsGray)
+                {
+                    Sums[0] += Row[FrameX];
+                    Sums[3] += 255;
+                    continue;
+                }
+                const uint8_t *Pixel = Row + (size_t)FrameX * 4;
+                Sums[0] += Pixel[0];
+                Sums[1] += Pixel[1];
+                Sums[2] += Pixel[2];
+                Sums[3] += Pixel[3];
+            }
+        }
+    }
+
+    for (size_t Slot = 0; Slot < Out.size(); Slot++)
+    {
+        const uint64_t *Sums = &MColorSums[Slot * 4];
+        const uint64_t Area = (uint64_t)Out[Slot].Area;
+        uint32_t Channels[4];
+        for (int Channel = 0; Channel < 4; Channel++) Channels[Channel] = (uint32_t)((Sums[Channel] + Area / 2) / Area);
+        if (IsGray) Channels[1] = Channels[2] = Channels[0];
+        Out[Slot].MeanColor = Channels[0] | Channels[1] << 8 | Channels[2] << 16 | Channels[3] << 24;
+    }
+    return Passed;
+}
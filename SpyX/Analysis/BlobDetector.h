@@ -0,0 +1,110 @@
+#ifndef TAPI_BLOB_DETECTOR_H
+#define TAPI_BLOB_DETECTOR_H
+
+#include "Core/ThreadPool.h"
+#include "Imaging/ImageView.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Connected components of a Gray8 mask or label map. Rows are cut into runs of equal
+// non-zero values, and runs touching on neighbouring rows are joined with union-find. Strips
+// of rows are scanned in parallel, then the runs facing each other across strip edges are
+// joined. Component statistics come from the runs, and only components that pass the area
+// filter and the cap are revisited for their mean colour.
+
+struct SBlobOptions
+{
+    bool IsLabelMap = false;        // Components need equal labels; otherwise any non-zero value joins
+    bool IsEightConnected = true;   // Diagonal neighbours join
+    int MinArea = 1;                // Smaller components are dropped
+    int MaxBlobs = 0;               // Keep only this many of the largest, 0 = all
+};
+
+// Frame the mask was made from, for mean colours. Mask pixel (x, y) stands for the frame pixel
+// at (X + x * Step + Step / 2, Y + y * Step + Step / 2), as a classifier label map does.
+struct SBlobColorSource
+{
+    SImageView Frame;               // BGRA8 or Gray8
+    int X = 0;
+    int Y = 0;
+    int Step = 1;
+};
+
+struct SBlob
+{
+    int X = 0;                      // Bounding box in mask pixels
+    int Y = 0;
+    int Width = 0;
+    int Height = 0;
+    int Area = 0;                   // Pixels
+    float CentroidX = 0.0f;         // Mean pixel centre, pixel (x, y) counting as (x, y)
+    float CentroidY = 0.0f;
+    uint32_t MeanColor = 0;         // 0xAARRGGBB, 0 without a colour source
+    int Label = 0;                  // Mask value of the component
+};
+
+class CBlobDetector
+{
+public:
+    // ThreadCount includes the calling thread; 0 uses the hardware concurrency
+    explicit CBlobDetector(int ThreadCount = 0);
+    ~CBlobDetector();
+
+    // Out receives the kept components, largest first and in scan order among equal areas.
+    // Returns how many components passed MinArea, which exceeds Out.size() when MaxBlobs
+    // cut the list, or -1 if Mask is not Gray8 or Colors is invalid.
+    int Detect(const SImageView &Mask, const SBlobOptions &Options, const SBlobColorSource *Colors,
+        std::vector<SBlob> &Out);
+
+private:
+    struct SRun
+    {
+        int Start = 0;              // First and last column
+        int End = 0;
+        int Y = 0;
+        uint8_t Label = 0;
+    };
+
+    struct SStrip
+    {
+        int Top = 0;
+        int Bottom = 0;
+        std::vector<SRun> Runs;
+        std::vector<int> RowStarts; // Index of each row's first run, plus the end
+        std::vector<int> Parents;   // Union-find over the strip's runs
+    };
+
+    struct SComponent
+    {
+        int Left = 0;
+        int Top = 0;
+        int Right = 0;
+        int Bottom = 0;
+        int64_t Area = 0;
+        int64_t DoubleSumX = 0;     // Twice the sum of x, exact for runs
+        int64_t SumY = 0;
+        uint8_t Label = 0;
+    };
+
+    void ScanStrip(int Index);
+    void JoinRows(const SRun *Upper, int UpperCount, int UpperBase, const SRun *Lower, int LowerCount, int LowerBase,
+        std::vector<int> &Parents) const;
+
+    std::unique_ptr<CThreadPool> MPool;
+
+    // State of the detection in progress, read by the workers
+    SImageView MMask;
+    SBlobOptions MOptions;
+    std::vector<SStrip> MStrips;
+
+    std::vector<int> MParents;      // All runs in scan order
+    std::vector<int> MComponentOf;
+    std::vector<SComponent> MComponents;
+    std::vector<int> MKept;
+    std::vector<int> MSlotOf;       // Output index of each component, -1 if dropped
+    std::vector<uint64_t> MColorSums;
+};
+
+#endif
@@ -0,0 +1,311 @@
+#include "ColorSearch.h"
+#include "Core/Simd.h"
+
+#include <algorithm>
+#include <cstring>
+
+static bool IsFrameSupported(const SImageView &Frame)
+{
+    return Frame.IsValid() && (Frame.Format == EPixelFormat::BGRA8 || Frame.Format == EPixelFormat::Gray8);
+}
+
+static uint8_t GetChannel(uint32_t Color, int Channel)
+{
+    return (uint8_t)(Color >> (8 * Channel));
+}
+
+SColorRange MakeColorRange(uint32_t Color, int ToleranceR, int ToleranceG, int ToleranceB)
+{
+    const int Tolerances[3] = {ToleranceB, ToleranceG, ToleranceR};
+    SColorRange Range;
+    Range.Low = 0;
+    Range.High = 0xFF000000u;
+    for (int Channel = 0; Channel < 3; Channel++)
+    {
+        const int Value = GetChannel(Color, Channel);
+        const int Tolerance = std::max(Tolerances[Channel], 0);
+        Range.Low |= (uint32_t)std::max(Value - Tolerance, 0) << (8 * Channel);
+        Range.High |= (uint32_t)std::min(Value + Tolerance, 255) << (8 * Channel);
+    }
+    return Range;
+}
+
+// A Gray8 pixel g is in a range when every channel box holds g. Low > High means never.
+static void GetGrayRange(const SColorRange &Range, int &Low, int &High)
+{
+    Low = std::max(std::max(GetChannel(Range.Low, 0), GetChannel(Range.Low, 1)), GetChannel(Range.Low, 2));
+    High = std::min(std::min(GetChannel(Range.High, 0), GetChannel(Range.High, 1)), GetChannel(Range.High, 2));
+}
+
+static bool IsInRange(const uint8_t *Pixel, const SColorRange &Range)
+{
+    for (int Channel = 0; Channel < 3; Channel++)
+    {
+        if (Pixel[Channel] < GetChannel(Range.Low, Channel) || Pixel[Channel] > GetChannel(Range.High, Channel)) return false;
+    }
+    return true;
+}
+
+void MatchColorRow(const uint8_t *Row, EPixelFormat Format, int Width, const SColorRange *Ranges, int RangeCount,
+    uint8_t *Mask)
+{
+    int X = 0;
+    if (Format == EPixelFormat::Gray8)
+    {
+        int GrayLow[MaxColorRanges];
+        int GrayHigh[MaxColorRanges];
+        const int Count = std::min(RangeCount, MaxColorRanges);
+        for (int Index = 0; Index < Count; Index++) GetGrayRange(Ranges[Index], GrayLow[Index], GrayHigh[Index]);
+
+#ifdef SPYX_SSE2
+        for (; X + 16 <= Width; X += 16)
+        {
+            __m128i Pixels = _mm_loadu_si128((const __m128i *)(Row + X));
+            __m128i Hits = _mm_setzero_si128();
+            for (int Index = 0; Index < Count; Index++)
+            {
+                if (GrayLow[Index] > GrayHigh[Index]) continue;
+                __m128i Low = _mm_set1_epi8((char)GrayLow[Index]);
+                __m128i High = _mm_set1_epi8((char)GrayHigh[Index]);
+                __m128i Above = _mm_cmpeq_epi8(_mm_max_epu8(Pixels, Low), Pixels);
+                __m128i Below = _mm_cmpeq_epi8(_mm_min_epu8(Pixels, High), Pixels);
+                Hits = _mm_or_si128(Hits, _mm_and_si128(Above, Below));
+            }
+            _mm_storeu_si128((__m128i *)(Mask + X), Hits);
+        }
+#endif
+        for (; X < Width; X++)
+        {
+            uint8_t Hit = 0;
+            for (int Index = 0; Index < Count && !Hit; Index++)
+            {
+                if (Row[X] >= GrayLow[Index] && Row[X] <= GrayHigh[Index]) Hit = 0xFF;
+            }
+            Mask[X] = Hit;
+        }
+        return;
+    }
+
+#ifdef SPYX_SSE2
+    // Per-byte range tests, then a pixel hits when all four of its bytes pass; alpha always does
+    const __m128i AllSet = _mm_set1_epi8((char)0xFF);
+    for (; X + 16 <= Width; X += 16)
+    {
+        __m128i Quads[4];
+        for (int Quad = 0; Quad < 4; Quad++)
+        {
+            __m128i Pixels = _mm_loadu_si128((const __m128i *)(Row + 4 * X + 16 * Quad));
+            __m128i Hits = _mm_setzero_si128();
+            for (int Index = 0; Index < RangeCount; Index++)
+            {
+                __m128i Low = _mm_set1_epi32((int)(Ranges[Index].Low & 0x00FFFFFFu));
+                __m128i High = _mm_set1_epi32((int)(Ranges[Index].High | 0xFF000000u));
+                __m128i Above = _mm_cmpeq_epi8(_mm_max_epu8(Pixels, Low), Pixels);
+                __m128i Below = _mm_cmpeq_epi8(_mm_min_epu8(Pixels, High), Pixels);
+                Hits = _mm_or_si128(Hits, _mm_cmpeq_epi32(_mm_and_si128(Above, Below), AllSet));
+            }
+            Quads[Quad] = Hits;
+        }
+        __m128i Packed = _mm_packs_epi16(_mm_packs_epi32(Quads[0], Quads[1]), _mm_packs_epi32(Quads[2], Quads[3]));
+        _mm_storeu_si128((__m128i *)(Mask + X), Packed);
+    }
+#endif
+    for (; X < Width; X++)
+    {
+        uint8_t Hit = 0;
+        for (int Index = 0; Index < RangeCount && !Hit; Index++)
+        {
+            if (IsInRange(Row + 4 * X, Ranges[Index])) Hit = 0xFF;
+        }
+        Mask[X] = Hit;
+    }
+}
+
+// Index of the first byte at or after X equal to Value, or Width
+static int FindByte(const uint8_t *Mask, int X, int Width, uint8_t Value)
+{
+    const uint64_t Skipped = Value ? 0 : ~0ull;
+    uint64_t Word;
+    while (X + 8 <= Width)
+    {
+        std::memcpy(&Word, Mask + X, 8);
+        if (Word != Skipped) break;
+        X += 8;
+    }
+    while (X < Width && Mask[X] != Value) X++;
+    return X;
+}
+
+int CColorSearch::Search(const SImageView &Frame, const SColorRange *Ranges, int RangeCount,
+    const SColorSearchOptions &Options, int32_t *Points, int MaxPoints, std::vector<SColorBox> *Boxes)
+{
+    if (Boxes) Boxes->clear();
+    if (!IsFrameSupported(Frame) || !Ranges || RangeCount <= 0 || RangeCount > MaxColorRanges || Options.MergeGap < 1) return -1;
+
+    const SPixelRect Area = ClipToFrame(Options.RoiX, Options.RoiY, Options.RoiWidth, Options.RoiHeight, Frame.Width,
+        Frame.Height);
+    if (Area.IsEmpty()) return 0;
+
+    const int Left = Area.Left;
+    const int Width = Area.GetWidth();
+    const int Gap = Options.MergeGap;
+    const bool IsFirstHit = Options.Mode == EColorSearchMode::FirstHit;
+    const bool WantBoxes = Boxes && !IsFirstHit;
+    const size_t BytesPerPixel = (size_t)GetBytesPerPixel(Frame.Format);
+    if (!Points) MaxPoints = 0;
+
+    MMask.resize((size_t)Width);
+    MOpen.clear();
+    MClosed.clear();
+
+    int Count = 0;
+    for (int Y = Area.Top; Y < Area.Bottom; Y++)
+    {
+        const uint8_t *Mask = MMask.data();
+        MatchColorRow(Frame.Row(Y) + Left * BytesPerPixel, Frame.Format, Width, Ranges, RangeCount, MMask.data());
+
+        // Runs closer than the gap join before they reach the boxes
+        int RunStart = -1;
+        int RunEnd = -1;
+        int RunCount = 0;
+        for (int X = FindByte(Mask, 0, Width, 0xFF); X < Width; X = FindByte(Mask, X, Width, 0xFF))
+        {
+            const int Start = X;
+            X = FindByte(Mask, X, Width, 0);
+            const int Length = X - Start;
+
+            if (IsFirstHit)
+            {
+                if (MaxPoints > 0)
+                {
+                    Points[0] = Left + Start;
+                    Points[1] = Y;
+                }
+                return 1;
+            }
+
+            for (int Hit = 0; Hit < Length && Count + Hit < MaxPoints; Hit++)
+            {
+                Points[2 * (Count + Hit)] = Left + Start + Hit;
+                Points[2 * (Count + Hit) + 1] = Y;
+            }
+            Count += Length;
+
+            if (!WantBoxes) continue;
+            if (RunCount > 0 && Start - RunEnd <= Gap)
+            {
+                RunEnd = X - 1;
+                RunCount += Length;
+                continue;
+            }
+            if (RunCount > 0) AddRun(Left + RunStart, Left + RunEnd, RunCount, Y, Gap);
+            RunStart = Start;
+            RunEnd = X - 1;
+            RunCount = Length;
+        }
+        if (!WantBoxes) continue;
+        if (RunCount > 0) AddRun(Left + RunStart, Left + RunEnd, RunCount, Y, Gap);
+
+        // Boxes the next row can no longer reach are done
+        auto IsDone = [Y, Gap](const SOpenBox &Box) { return Box.Count < 0 || Box.Bottom < Y + 1 - Gap; };
+        for (const SOpenBox &Box : MOpen)
+        {
+            if (Box.Count >= 0 && IsDone(Box)) MClosed.push_back(Box);
+        }
+        MOpen.erase(std::remove_if(MOpen.begin(), MOpen.end(), IsDone), MOpen.end());
+    }
+
+    if (WantBoxes) FinishBoxes(Gap, *Boxes);
+    return Count;
+}
+
+// Adds a run of row Y to the open boxes it reaches, merging them when it reaches several.
+// Merged-away boxes are marked with Count -1.
+void CColorSearch::AddRun(int Start, int End, int Count, int Y, int Gap)
+{
+    SOpenBox *Target = nullptr;
+    for (SOpenBox &Box : MOpen)
+    {
+        if (Box.Count < 0 || Start > Box.Right + Gap || End < Box.Left - Gap) continue;
+        if (!Target)
+        {
+            Target = &Box;
+            continue;
+        }
+        Target->Left = std::min(Target->Left, Box.Left);
+        Target->Top = std::min(Target->Top, Box.Top);
+        Target->Right = std::max(Target->Right, Box.Right);
+        Target->Bottom = std::max(Target->Bottom, Box.Bottom);
+        Target->Count += Box.Count;
+        Box.Count = -1;
+    }
+
+    if (!Target)
+    {
+        SOpenBox Box;
+        Box.Left = Start;
+        Box.Top = Y;
+        Box.Right = End;
+        Box.Bottom = Y;
+        Box.Count = Count;
+        MOpen.push_back(Box);
+        return;
+    }
+    Target->Left = std::min(Target->Left, Start);
+    Target->Right = std::max(Target->Right, End);
+    Target->Bottom = Y;
+    Target->Count += Count;
+}
+
+// Boxes that grew into each other's reach after they were closed merge here
+void CColorSearch::FinishBoxes(int Gap, std::vector<SColorBox> &Boxes)
+{
+    for (const SOpenBox &Box : MOpen)
+    {
+        if (Box.Count >= 0) MClosed.push_back(Box);
+    }
+
+    auto ByTop = [](const SOpenBox &First, const SOpenBox &Second)
+    {
+        return First.Top != Second.Top ? First.Top < Second.Top : First.Left < Second.Left;
+    };
+    std::sort(MClosed.begin(), MClosed.end(), ByTop);
+
+    bool IsMerged = true;
+    while (IsMerged)
+    {
+        IsMerged = false;
+        for (size_t Index = 0; Index < MClosed.size(); Index++)
+        {
+            SOpenBox &Box = MClosed[Index];
+            for (size_t Other = Index + 1; Other < MClosed.size() && MClosed[Other].Top <= Box.Bottom + Gap;)
+            {
+                const SOpenBox &Next = MClosed[Other];
+                if (Next.Left > Box.Right + Gap || Next.Right < Box.Left - Gap)
+                {
+                    Other++;
+                    continue;
+                }
+                Box.Left = std::min(Box.Left, Next.Left);
+                Box.Right = std::max(Box.Right, Next.Right);
+                Box.Bottom = std::max(Box.Bottom, Next.Bottom);
+                Box.Count += Next.Count;
+                MClosed.erase(MClosed.begin() + Other);
+                IsMerged = true;
+            }
+        }
+    }
+
+    std::sort(MClosed.begin(), MClosed.end(), ByTop);
+    Boxes.reserve(MClosed.size());
+    for (const SOpenBox &Box : MClosed)
+    {
+        SColorBox Result;
+        Result.X = Box.Left;
+        Result.Y = Box.Top;
+        Result.Width = Box.Right - Box.Left + 1;
+        Result.Height = Box.Bottom - Box.Top + 1;
+        Result.Count = Box.Count;
+        Boxes.push_back(Result);
+    }
+}
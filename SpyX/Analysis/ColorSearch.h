@@ -0,0 +1,87 @@
+#ifndef TAPI_COLOR_SEARCH_H
+#define TAPI_COLOR_SEARCH_H
+
+#include "Imaging/ImageView.h"
+
+#include <cstdint>
+#include <vector>
+
+// Finds the pixels of a BGRA8 or Gray8 frame that fall in any of several colour ranges. A
+// range is a per-channel box: a colour plus or minus a tolerance per channel (one tolerance
+// for all three gives an RGB cube), or explicit low and high corners. Alpha is ignored and
+// Gray8 pixels count as B = G = R. The frame is read in place, 16 pixels per SSE2 step, and
+// hits are gathered into bounding boxes as the rows go by.
+
+enum class EColorSearchMode : int
+{
+    FirstHit = 0,   // Stop at the first hit in row order
+    AllHits = 1
+};
+
+static const int MaxColorRanges = 16;
+
+// Corners packed like the pixels, read as uint32: 0xAARRGGBB. Alpha bytes are ignored.
+struct SColorRange
+{
+    uint32_t Low = 0;
+    uint32_t High = 0xFFFFFFFF;
+};
+
+// Color +- Tolerance per channel, clamped to 0-255
+SColorRange MakeColorRange(uint32_t Color, int ToleranceR, int ToleranceG, int ToleranceB);
+
+struct SColorSearchOptions
+{
+    EColorSearchMode Mode = EColorSearchMode::AllHits;
+    int RoiX = 0;
+    int RoiY = 0;
+    int RoiWidth = 0;               // 0 = to the frame edge
+    int RoiHeight = 0;
+    int MergeGap = 1;               // Hits this close (in x and y) share a box, 1 = touching
+};
+
+struct SColorBox
+{
+    int X = 0;
+    int Y = 0;
+    int Width = 0;
+    int Height = 0;
+    int Count = 0;                  // Hits inside
+};
+
+// Sets Mask[X] to 0xFF where pixel X of Row is in any of up to MaxColorRanges ranges, and
+// to 0 elsewhere
+void MatchColorRow(const uint8_t *Row, EPixelFormat Format, int Width, const SColorRange *Ranges, int RangeCount,
+    uint8_t *Mask);
+
+class CColorSearch
+{
+public:
+    // Returns the number of hits in the search area (at most 1 in FirstHit mode), or -1 if
+    // the frame, the ranges (1 to MaxColorRanges) or the gap are invalid. Points, if not
+    // null, receives the first MaxPoints hits as (x, y) pairs in row order. Boxes, if not
+    // null, receives the boxes of AllHits mode ordered by top then left; a box takes in hits
+    // within MergeGap of it, and boxes that come within MergeGap of each other merge.
+    int Search(const SImageView &Frame, const SColorRange *Ranges, int RangeCount, const SColorSearchOptions &Options,
+        int32_t *Points, int MaxPoints, std::vector<SColorBox> *Boxes);
+
+private:
+    // Box being built, with inclusive edges
+    struct SOpenBox
+    {
+        int Left = 0;
+        int Top = 0;
+        int Right = 0;
+        int Bottom = 0;
+        int Count = 0;
+    };
+
+    void AddRun(int Start, int End, int Count, int Y, int Gap);
+    void FinishBoxes(int Gap, std::vector<SColorBox> &Boxes);
+
+    std::vector<uint8_t> MMask;
+    std::vector<SOpenBox> MOpen;
+    std::vector<SOpenBox> MClosed;
+};
+
+#endif
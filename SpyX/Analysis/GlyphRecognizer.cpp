@@ -0,0 +1,378 @@
+#include "GlyphRecognizer.h"
+#include "Core/Simd.h"
+#include "Imaging/ToneMapper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static const float AspectWeight = 0.5f;        // Score lost per unit of log aspect ratio difference
+static const float PlacementWeight = 0.5f;     // Score lost per line height of height or position difference
+static const float DefaultSpaceRatio = 0.4f;
+static const float SplitRatio = 1.5f;          // Pieces this many widest glyphs wide are split
+
+static bool IsFrameSupported(const SImageView &Frame)
+{
+    return Frame.IsValid() && (Frame.Format == EPixelFormat::BGRA8 || Frame.Format == EPixelFormat::Gray8);
+}
+
+// Otsu's threshold: pixels above it form one class. -1 if the histogram has one level.
+static int FindThreshold(const uint32_t Histogram[256], uint64_t Total)
+{
+    uint64_t WeightedTotal = 0;
+    for (int Level = 0; Level < 256; Level++) WeightedTotal += (uint64_t)Level * Histogram[Level];
+
+    int Best = -1;
+    double BestVariance = 0.0;
+    uint64_t Below = 0;
+    uint64_t WeightedBelow = 0;
+    for (int Level = 0; Level < 255; Level++)
+    {
+        Below += Histogram[Level];
+        WeightedBelow += (uint64_t)Level * Histogram[Level];
+        if (Below == 0 || Below == Total) continue;
+
+        const uint64_t Above = Total - Below;
+        const double MeanBelow = (double)WeightedBelow / Below;
+        const double MeanAbove = (double)(WeightedTotal - WeightedBelow) / Above;
+        const double Variance = (double)Below * Above * (MeanAbove - MeanBelow) * (MeanAbove - MeanBelow);
+        if (Variance > BestVariance)
+        {
+            BestVariance = Variance;
+            Best = Level;
+        }
+    }
+    return Best;
+}
+
+// Ink[X] = 0xFF where Luma[X] > Threshold (light ink) or <= Threshold (dark ink), else 0
+static void ThresholdRow(const uint8_t *Luma, int Width, int Threshold, bool IsLightInk, uint8_t *Ink)
+{
+    int X = 0;
+
+#ifdef SPYX_SSE2
+    {
+        // Unsigned compares through min/max: x > t is max(x, t + 1) == x, x <= t is min(x, t) == x
+        const __m128i Bound = _mm_set1_epi8((char)(IsLightInk ? Threshold + 1 : Threshold));
+        for (; X + 16 <= Width; X += 16)
+        {
+            __m128i Pixels = _mm_loadu_si128((const __m128i *)(Luma + X));
+            __m128i Limit = IsLightInk ? _mm_max_epu8(Pixels, Bound) : _mm_min_epu8(Pixels, Bound);
+            _mm_storeu_si128((__m128i *)(Ink + X), _mm_cmpeq_epi8(Limit, Pixels));
+        }
+    }
+#endif
+
+    for (; X < Width; X++) Ink[X] = (IsLightInk ? Luma[X] > Threshold : Luma[X] <= Threshold) ? 0xFF : 0;
+}
+
+// Columns[X] += 1 where Ink[X] is set
+static void AddInkColumns(const uint8_t *Ink, int Width, uint16_t *Columns)
+{
+    int X = 0;
+
+#ifdef SPYX_SSE2
+    {
+        const __m128i One = _mm_set1_epi8(1);
+        const __m128i Zero = _mm_setzero_si128();
+        for (; X + 16 <= Width; X += 16)
+        {
+            __m128i Hits = _mm_and_si128(_mm_loadu_si128((const __m128i *)(Ink + X)), One);
+            __m128i Low = _mm_loadu_si128((const __m128i *)(Columns + X));
+            __m128i High = _mm_loadu_si128((const __m128i *)(Columns + X + 8));
+            _mm_storeu_si128((__m128i *)(Columns + X), _mm_add_epi16(Low, _mm_unpacklo_epi8(Hits, Zero)));
+            _mm_storeu_si128((__m128i *)(Columns + X + 8), _mm_add_epi16(High, _mm_unpackhi_epi8(Hits, Zero)));
+        }
+    }
+#endif
+
+    for (; X < Width; X++) Columns[X] += Ink[X] & 1;
+}
+
+static int32_t DotGrids(const int16_t *First, const int16_t *Second)
+{
+    const int Count = GlyphGridSize * GlyphGridSize;
+
+#ifdef SPYX_SSE2
+    __m128i Sums = _mm_setzero_si128();
+    for (int Index = 0; Index < Count; Index += 8)
+    {
+        __m128i Left = _mm_load_si128((const __m128i *)(First + Index));
+        __m128i Right = _mm_load_si128((const __m128i *)(Second + Index));
+        Sums = _mm_add_epi32(Sums, _mm_madd_epi16(Left, Right));
+    }
+    Sums = _mm_add_epi32(Sums, _mm_srli_si128(Sums, 8));
+    Sums = _mm_add_epi32(Sums, _mm_srli_si128(Sums, 4));
+    return _mm_cvtsi128_si32(Sums);
+#else
+    int32_t Sum = 0;
+    for (int Index = 0; Index < Count; Index++) Sum += First[Index] * Second[Index];
+    return Sum;
+#endif
+}
+
+bool CGlyphRecognizer::Binarize(const SImageView &Image, ETextPolarity Polarity, int Threshold)
+{
+    MWidth = Image.Width;
+    MHeight = Image.Height;
+    MLuma.resize((size_t)MWidth * MHeight);
+    MInk.resize((size_t)MWidth * MHeight);
+    if (Image.Format == EPixelFormat::BGRA8)
+    {
+        ConvertBGRA8ToGray8(Image, MLuma.data(), MWidth);
+    }
+    else
+    {
+        for (int Y = 0; Y < MHeight; Y++) std::memcpy(&MLuma[(size_t)Y * MWidth], Image.Row(Y), (size_t)MWidth);
+    }
+
+    uint32_t Histogram[256] = {};
+    for (uint8_t Level : MLuma) Histogram[Level]++;
+    const uint64_t Total = MLuma.size();
+
+    // Pixels above Split are the light side
+    int Split = Threshold > 0 ? Threshold - 1 : FindThreshold(Histogram, Total);
+    if (Split < 0 || Split > 254) return false;
+
+    uint64_t Above = 0;
+    for (int Level = Split + 1; Level < 256; Level++) Above += Histogram[Level];
+    if (Above == 0 || Above == Total) return false;
+
+    bool IsLightInk = Polarity == ETextPolarity::LightOnDark;
+    if (Polarity == ETextPolarity::Auto) IsLightInk = Above * 2 <= Total;
+    for (int Y = 0; Y < MHeight; Y++)
+    {
+        ThresholdRow(&MLuma[(size_t)Y * MWidth], MWidth, Split, IsLightInk, &MInk[(size_t)Y * MWidth]);
+    }
+    return true;
+}
+
+// Ink coverage of each grid cell, 0-255, over the box; cells smaller than a pixel take the nearest one
+void CGlyphRecognizer::MakeShape(int Left, int Top, int Width, int Height, SShape &Shape) const
+{
+    uint8_t Values[GlyphGridSize * GlyphGridSize];
+    int Sum = 0;
+    for (int GridY = 0; GridY < GlyphGridSize; GridY++)
+    {
+        const int Y0 = Top + GridY * Height / GlyphGridSize;
+        const int Y1 = std::max(Y0 + 1, Top + (GridY + 1) * Height / GlyphGridSize);
+        for (int GridX = 0; GridX < GlyphGridSize; GridX++)
+        {
+            const int X0 = Left + GridX * Width / GlyphGridSize;
+            const int X1 = std::max(X0 + 1, Left + (GridX + 1) * Width / GlyphGridSize);
+            int Ink = 0;
+            for (int Y = Y0; Y < Y1; Y++)
+            {
+                const uint8_t *Row = &MInk[(size_t)Y * MWidth];
+                for (int X = X0; X < X1; X++) Ink += Row[X] & 1;
+            }
+            const int Value = Ink * 255 / ((Y1 - Y0) * (X1 - X0));
+            Values[GridY * GlyphGridSize + GridX] = (uint8_t)Value;
+            Sum += Value;
+        }
+    }
+
+    const int Mean = (Sum + GlyphGridSize * GlyphGridSize / 2) / (GlyphGridSize * GlyphGridSize);
+    int64_t Squares = 0;
+    bool IsUniform = true;
+    for (int Index = 0; Index < GlyphGridSize * GlyphGridSize; Index++)
+    {
+        Shape.Grid[Index] = (int16_t)(Values[Index] - Mean);
+        Squares += (int64_t)Shape.Grid[Index] * Shape.Grid[Index];
+        IsUniform = IsUniform && Values[Index] == Values[0];
+    }
+    Shape.Norm = IsUniform ? 0.0f : (float)std::sqrt((double)Squares);
+    Shape.Aspect = (float)Width / Height;
+}
+
+// Correlation of the grids, less the differences in box shape and placement
+float CGlyphRecognizer::Compare(const SShape &Glyph, const SShape &Candidate) const
+{
+    float Correlation;
+    if (Glyph.Norm == 0.0f || Candidate.Norm == 0.0f)
+    {
+        Correlation = Glyph.Norm == Candidate.Norm ? 1.0f : 0.0f;
+    }
+    else
+    {
+        Correlation = (float)DotGrids(Glyph.Grid, Candidate.Grid) / (Glyph.Norm * Candidate.Norm);
+    }
+
+    const float AspectDifference = std::fabs(std::log(Glyph.Aspect / Candidate.Aspect));
+    const float PlacementDifference = std::fabs(Glyph.Height - Candidate.Height) + std::fabs(Glyph.Centre - Candidate.Centre);
+    return Correlation - AspectWeight * AspectDifference - PlacementWeight * PlacementDifference;
+}
+
+bool CGlyphRecognizer::AddGlyph(int Code, const SImageView &Image, ETextPolarity Polarity, int Threshold)
+{
+    if (Code < 1 || !IsFrameSupported(Image) || !Binarize(Image, Polarity, Threshold)) return false;
+
+    int Left = MWidth;
+    int Right = -1;
+    int Top = -1;
+    int Bottom = -1;
+    for (int Y = 0; Y < MHeight; Y++)
+    {
+        const uint8_t *Row = &MInk[(size_t)Y * MWidth];
+        for (int X = 0; X < MWidth; X++)
+        {
+            if (!Row[X]) continue;
+            Left = std::min(Left, X);
+            Right = std::max(Right, X);
+            if (Top < 0) Top = Y;
+            Bottom = Y;
+        }
+    }
+
+    SGlyph Glyph;
+    Glyph.Code = Code;
+    Glyph.Top = Top;
+    Glyph.Bottom = Bottom;
+    Glyph.Width = Right - Left + 1;
+    MakeShape(Left, Top, Glyph.Width, Bottom - Top + 1, Glyph.Shape);
+    MGlyphs.push_back(Glyph);
+    UpdateLine();
+    return true;
+}
+
+void CGlyphRecognizer::Clear()
+{
+    MGlyphs.clear();
+    MMaxWidth = 0.0f;
+}
+
+// Heights and positions are relative to the ink extent of the whole set
+void CGlyphRecognizer::UpdateLine()
+{
+    int LineTop = MGlyphs[0].Top;
+    int LineBottom = MGlyphs[0].Bottom;
+    for (const SGlyph &Glyph : MGlyphs)
+    {
+        LineTop = std::min(LineTop, Glyph.Top);
+        LineBottom = std::max(LineBottom, Glyph.Bottom);
+    }
+
+    const float LineHeight = (float)(LineBottom - LineTop + 1);
+    MMaxWidth = 0.0f;
+    for (SGlyph &Glyph : MGlyphs)
+    {
+        Glyph.Shape.Height = (Glyph.Bottom - Glyph.Top + 1) / LineHeight;
+        Glyph.Shape.Centre = ((Glyph.Top + Glyph.Bottom + 1) * 0.5f - LineTop) / LineHeight;
+        MMaxWidth = std::max(MMaxWidth, Glyph.Width / LineHeight);
+    }
+}
+
+bool CGlyphRecognizer::Recognize(const SImageView &Field, const STextOptions &Options, std::vector<SGlyphResult> &Out)
+{
+    Out.clear();
+    if (MGlyphs.empty() || !IsFrameSupported(Field)) return false;
+    if (!Binarize(Field, Options.Polarity, Options.Threshold)) return true;
+
+    MColumns.assign((size_t)MWidth, 0);
+    int LineTop = -1;
+    int LineBottom = -1;
+    for (int Y = 0; Y < MHeight; Y++)
+    {
+        const uint8_t *Row = &MInk[(size_t)Y * MWidth];
+        AddInkColumns(Row, MWidth, MColumns.data());
+        if (std::find(Row, Row + MWidth, 0xFF) == Row + MWidth) continue;
+        if (LineTop < 0) LineTop = Y;
+        LineBottom = Y;
+    }
+    const int LineHeight = LineBottom - LineTop + 1;
+    const int SpaceWidth = Options.SpaceWidth != 0 ? Options.SpaceWidth : std::max(1, (int)(DefaultSpaceRatio * LineHeight));
+    const float WidestGlyph = MMaxWidth * LineHeight;
+
+    int PreviousEnd = -1;
+    int X = 0;
+    while (X < MWidth)
+    {
+        if (!MColumns[X])
+        {
+            X++;
+            continue;
+        }
+        const int Start = X;
+        while (X < MWidth && MColumns[X]) X++;
+        const int End = X;
+
+        // Touching characters: cut near even divisions at the thinnest column. Each cut leaves
+        // at least one column to its own piece and to every piece after it.
+        int Pieces = 1;
+        if (WidestGlyph >= 1.0f && End - Start > SplitRatio * WidestGlyph)
+        {
+            Pieces = std::min(std::max(1, (int)std::lround((End - Start) / WidestGlyph)), End - Start);
+        }
+        int PieceStart = Start;
+        for (int Piece = 1; Piece <= Pieces; Piece++)
+        {
+            int PieceEnd = End;
+            if (Piece < Pieces)
+            {
+                const int Middle = Start + (End - Start) * Piece / Pieces;
+                const int Reach = std::max(1, (End - Start) / (4 * Pieces));
+                const int Lowest = PieceStart + 1;
+                const int Highest = End - (Pieces - Piece);
+                PieceEnd = std::min(std::max(Middle, Lowest), Highest);
+                for (int Column = std::max(Lowest, Middle - Reach); Column <= std::min(Highest, Middle + Reach); Column++)
+                {
+                    if (MColumns[Column] < MColumns[PieceEnd]) PieceEnd = Column;
+                }
+            }
+
+            // A piece without ink rows has no box to compare, so it is skipped
+            int Top = -1;
+            int Bottom = -1;
+            for (int Y = LineTop; Y <= LineBottom; Y++)
+            {
+                const uint8_t *Row = &MInk[(size_t)Y * MWidth];
+                if (std::find(Row + PieceStart, Row + PieceEnd, 0xFF) == Row + PieceEnd) continue;
+                if (Top < 0) Top = Y;
+                Bottom = Y;
+            }
+            if (Top < 0)
+            {
+                PieceStart = PieceEnd;
+                continue;
+            }
+
+            if (PreviousEnd >= 0 && SpaceWidth > 0 && PieceStart - PreviousEnd >= SpaceWidth)
+            {
+                SGlyphResult Space;
+                Space.Code = ' ';
+                Space.Confidence = 1.0f;
+                Space.X = PreviousEnd;
+                Space.Width = PieceStart - PreviousEnd;
+                Out.push_back(Space);
+            }
+
+            SShape Shape;
+            MakeShape(PieceStart, Top, PieceEnd - PieceStart, Bottom - Top + 1, Shape);
+            Shape.Height = (float)(Bottom - Top + 1) / LineHeight;
+            Shape.Centre = ((Top + Bottom + 1) * 0.5f - LineTop) / LineHeight;
+
+            int BestCode = '?';
+            float BestScore = -INFINITY;
+            for (const SGlyph &Glyph : MGlyphs)
+            {
+                const float Score = Compare(Glyph.Shape, Shape);
+                if (Score > BestScore)
+                {
+                    BestScore = Score;
+                    BestCode = Glyph.Code;
+                }
+            }
+
+            SGlyphResult Result;
+            Result.Code = BestScore >= Options.MinScore ? BestCode : '?';
+            Result.Confidence = std::min(std::max(BestScore, 0.0f), 1.0f);
+            Result.X = PieceStart;
+            Result.Width = PieceEnd - PieceStart;
+            Out.push_back(Result);
+
+            PreviousEnd = PieceEnd;
+            PieceStart = PieceEnd;
+        }
+    }
+    return true;
+}
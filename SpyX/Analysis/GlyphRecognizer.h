@@ -0,0 +1,94 @@
+#ifndef TAPI_GLYPH_RECOGNIZER_H
+#define TAPI_GLYPH_RECOGNIZER_H
+
+#include "Imaging/ImageView.h"
+
+#include <cstdint>
+#include <vector>
+
+// Reads short text (counters, timers, coordinates) from a field of a frame with a set of glyph
+// images, such as cells rendered once from the window's font. The field is binarized, and
+// characters are cut at empty columns of its ink projection, with over-wide pieces split at
+// projection minima. Every character and glyph is resampled from its ink box to a fixed grid,
+// so small size differences do not matter, and scored by correlation. Box shape, height and
+// position in the text line keep flat marks such as '.', '-' and '|' apart.
+//
+// Glyph images should share one height and baseline, like font cells: a glyph's position is
+// taken relative to the ink extent of the whole set. A field is placed the same way, so it
+// needs at least one full-height character for its marks to be told apart.
+
+enum class ETextPolarity : int
+{
+    Auto = 0,           // Ink is whichever side of the threshold has fewer pixels
+    LightOnDark = 1,
+    DarkOnLight = 2
+};
+
+static const int GlyphGridSize = 16;
+
+struct STextOptions
+{
+    ETextPolarity Polarity = ETextPolarity::Auto;
+    int Threshold = 0;              // Luma 1-255 splitting ink from background, 0 = Otsu on the field
+    float MinScore = 0.5f;          // Characters scoring lower read as '?'
+    int SpaceWidth = 0;             // Gap in pixels read as a space, 0 = 40% of the text height, -1 = none
+};
+
+struct SGlyphResult
+{
+    int Code = 0;                   // Code point of the best glyph, '?' below MinScore, ' ' for gaps
+    float Confidence = 0.0f;        // 0-1, the best glyph's score
+    int X = 0;                      // Columns of the character in the field
+    int Width = 0;
+};
+
+class CGlyphRecognizer
+{
+public:
+    // Binarizes Image (BGRA8 or Gray8) like a field and adds its ink as the glyph for Code.
+    // Several glyphs may share a code. Fails on an image without ink or a code below 1.
+    bool AddGlyph(int Code, const SImageView &Image, ETextPolarity Polarity = ETextPolarity::Auto, int Threshold = 0);
+    void Clear();
+    int GetGlyphCount() const { return (int)MGlyphs.size(); }
+
+    // Reads the text of Field (BGRA8 or Gray8) left to right into Out. Fails without glyphs.
+    bool Recognize(const SImageView &Field, const STextOptions &Options, std::vector<SGlyphResult> &Out);
+
+private:
+    // Ink resampled to the grid with its mean removed, plus where its box sits in the line
+    struct SShape
+    {
+        alignas(16) int16_t Grid[GlyphGridSize * GlyphGridSize];
+        float Norm = 0.0f;          // 0 for a uniform grid, such as a solid bar
+        float Aspect = 1.0f;        // Box width over height
+        float Height = 1.0f;        // Box height over line height
+        float Centre = 0.5f;        // Box middle from the line top, over line height
+    };
+
+    struct SGlyph
+    {
+        int Code = 0;
+        SShape Shape;
+        int Top = 0;                // Ink rows in the glyph image
+        int Bottom = 0;
+        int Width = 0;
+    };
+
+    // Fills MInk (0xFF ink, 0 background) with Image; false if nothing is ink
+    bool Binarize(const SImageView &Image, ETextPolarity Polarity, int Threshold);
+    void MakeShape(int Left, int Top, int Width, int Height, SShape &Shape) const;
+    void UpdateLine();
+    float Compare(const SShape &Glyph, const SShape &Candidate) const;
+
+    std::vector<SGlyph> MGlyphs;
+    float MMaxWidth = 0.0f;         // Widest glyph over the set's line height
+
+    // Scratch of the image in progress
+    std::vector<uint8_t> MLuma;
+    std::vector<uint8_t> MInk;
+    int MWidth = 0;
+    int MHeight = 0;
+    std::vector<uint16_t> MColumns;
+};
+
+#endif
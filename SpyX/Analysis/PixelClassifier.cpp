@@ -0,0 +1,291 @@
+#include "PixelClassifier.h"
+#include "Core/Simd.h"
+
+#include <algorithm>
+#include <cstring>
+
+static bool IsFrameSupported(const SImageView &Frame)
+{
+    return Frame.IsValid() && (Frame.Format == EPixelFormat::BGRA8 || Frame.Format == EPixelFormat::Gray8);
+}
+
+// Table cell of a colour: the top Bits of R, G and B, red most significant
+static uint32_t GetCellIndex(uint32_t Color, int Bits)
+{
+    const uint32_t Shift = 8 - Bits;
+    const uint32_t Mask = (1u << Bits) - 1;
+    return (((Color >> (16 + Shift)) & Mask) << (2 * Bits)) | (((Color >> (8 + Shift)) & Mask) << Bits) |
+        ((Color >> Shift) & Mask);
+}
+
+static bool IsRuleValid(const SColorRule &Rule)
+{
+    if (Rule.Label < 1 || Rule.Label > 255) return false;
+    switch (Rule.Type)
+    {
+        case EColorRuleType::Hsv:
+            return Rule.HueMin >= 0.0f && Rule.HueMin <= 360.0f && Rule.HueMax >= 0.0f && Rule.HueMax <= 360.0f &&
+                Rule.SaturationMin <= Rule.SaturationMax && Rule.ValueMin <= Rule.ValueMax;
+        case EColorRuleType::RgbBox:
+            return true;
+        case EColorRuleType::Palette:
+            return Rule.MaxDistance >= 0.0f;
+    }
+    return false;
+}
+
+static int GetChannel(uint32_t Color, int Shift)
+{
+    return (int)((Color >> Shift) & 0xFF);
+}
+
+// Hue has no meaning without saturation, so grey colours pass any hue range
+static bool IsInHsvRange(const SColorRule &Rule, int Red, int Green, int Blue)
+{
+    const int Maximum = std::max(std::max(Red, Green), Blue);
+    const int Minimum = std::min(std::min(Red, Green), Blue);
+    const float Value = Maximum / 255.0f;
+    const float Saturation = Maximum > 0 ? (float)(Maximum - Minimum) / Maximum : 0.0f;
+    if (Value < Rule.ValueMin || Value > Rule.ValueMax) return false;
+    if (Saturation < Rule.SaturationMin || Saturation > Rule.SaturationMax) return false;
+    if (Maximum == Minimum) return true;
+
+    const float Chroma = (float)(Maximum - Minimum);
+    float Hue;
+    if (Maximum == Red) Hue = 60.0f * (Green - Blue) / Chroma;
+    else if (Maximum == Green) Hue = 60.0f * (Blue - Red) / Chroma + 120.0f;
+    else Hue = 60.0f * (Red - Green) / Chroma + 240.0f;
+    if (Hue < 0.0f) Hue += 360.0f;
+
+    if (Rule.HueMin <= Rule.HueMax) return Hue >= Rule.HueMin && Hue <= Rule.HueMax;
+    return Hue >= Rule.HueMin || Hue <= Rule.HueMax;
+}
+
+static bool IsInBox(const SColorRule &Rule, int Red, int Green, int Blue)
+{
+    return Red >= GetChannel(Rule.Color, 16) && Red <= GetChannel(Rule.ColorHigh, 16) &&
+        Green >= GetChannel(Rule.Color, 8) && Green <= GetChannel(Rule.ColorHigh, 8) &&
+        Blue >= GetChannel(Rule.Color, 0) && Blue <= GetChannel(Rule.ColorHigh, 0);
+}
+
+static int GetSquaredDistance(uint32_t Color, int Red, int Green, int Blue)
+{
+    const int DeltaRed = Red - GetChannel(Color, 16);
+    const int DeltaGreen = Green - GetChannel(Color, 8);
+    const int DeltaBlue = Blue - GetChannel(Color, 0);
+    return DeltaRed * DeltaRed + DeltaGreen * DeltaGreen + DeltaBlue * DeltaBlue;
+}
+
+static uint8_t EvaluateRules(const SColorRule *Rules, int Count, int Red, int Green, int Blue)
+{
+    bool IsPaletteDone = false;
+    for (int Index = 0; Index < Count; Index++)
+    {
+        const SColorRule &Rule = Rules[Index];
+        switch (Rule.Type)
+        {
+            case EColorRuleType::Hsv:
+                if (IsInHsvRange(Rule, Red, Green, Blue)) return (uint8_t)Rule.Label;
+                break;
+            case EColorRuleType::RgbBox:
+                if (IsInBox(Rule, Red, Green, Blue)) return (uint8_t)Rule.Label;
+                break;
+            case EColorRuleType::Palette:
+            {
+                if (IsPaletteDone) break;
+                IsPaletteDone = true;
+
+                int Best = -1;
+                int BestDistance = 0;
+                for (int Other = Index; Other < Count; Other++)
+                {
+                    if (Rules[Other].Type != EColorRuleType::Palette) continue;
+                    const int Distance = GetSquaredDistance(Rules[Other].Color, Red, Green, Blue);
+                    const float MaxDistance = Rules[Other].MaxDistance;
+                    if ((float)Distance > MaxDistance * MaxDistance) continue;
+                    if (Best < 0 || Distance < BestDistance)
+                    {
+                        Best = Other;
+                        BestDistance = Distance;
+                    }
+                }
+                if (Best >= 0) return (uint8_t)Rules[Best].Label;
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+bool CPixelClassifier::Compile(const SColorRule *Rules, int Count, int LutBits)
+{
+    if (Count < 0 || (Count > 0 && !Rules) || LutBits < MinLutBits || LutBits > MaxLutBits) return false;
+    for (int Index = 0; Index < Count; Index++)
+    {
+        if (!IsRuleValid(Rules[Index])) return false;
+    }
+
+    const int Size = 1 << LutBits;
+    const int Shift = 8 - LutBits;
+    const int Centre = 1 << Shift >> 1;
+
+    // Three bytes of padding keep a 32-bit read of the last cell inside the table
+    MBits = LutBits;
+    MLut.assign(((size_t)1 << (3 * LutBits)) + 3, 0);
+    for (int Red = 0; Red < Size; Red++)
+    {
+        for (int Green = 0; Green < Size; Green++)
+        {
+            uint8_t *Cells = &MLut[((size_t)Red << (2 * LutBits)) | ((size_t)Green << LutBits)];
+            for (int Blue = 0; Blue < Size; Blue++)
+            {
+                Cells[Blue] = EvaluateRules(Rules, Count, (Red << Shift) + Centre, (Green << Shift) + Centre,
+                    (Blue << Shift) + Centre);
+            }
+        }
+    }
+
+    for (int Level = 0; Level < 256; Level++)
+    {
+        MGrayLut[Level] = Lookup(0xFF000000u | (uint32_t)Level * 0x010101u);
+    }
+    return true;
+}
+
+uint8_t CPixelClassifier::Lookup(uint32_t Color) const
+{
+    return MLut.empty() ? 0 : MLut[GetCellIndex(Color, MBits)];
+}
+
+void CPixelClassifier::GetLabelMapSize(const SImageView &Frame, const SClassifyOptions &Options, int &Width, int &Height)
+{
+    Width = 0;
+    Height = 0;
+    if (Options.Step < 1) return;
+
+    const SPixelRect Area = ClipToFrame(Options.RoiX, Options.RoiY, Options.RoiWidth, Options.RoiHeight, Frame.Width,
+        Frame.Height);
+    if (Area.IsEmpty()) return;
+
+    Width = (int)(((int64_t)Area.GetWidth() + Options.Step - 1) / Options.Step);
+    Height = (int)(((int64_t)Area.GetHeight() + Options.Step - 1) / Options.Step);
+}
+
+// One label per pixel of a BGRA8 row
+static void ClassifyRowBGRA(const uint8_t *Pixels, int Width, const uint8_t *Lut, int Bits, uint8_t *Labels)
+{
+    int X = 0;
+
+#ifdef SPYX_AVX2
+    // The gather reads four bytes per cell; the table's padding covers the last ones
+    {
+        const uint32_t Shift = 8 - Bits;
+        const __m256i CellMask = _mm256_set1_epi32((1 << Bits) - 1);
+        const __m256i ByteMask = _mm256_set1_epi32(0xFF);
+        const __m128i BlueShift = _mm_cvtsi32_si128((int)Shift);
+        const __m128i GreenShift = _mm_cvtsi32_si128((int)(8 + Shift));
+        const __m128i RedShift = _mm_cvtsi32_si128((int)(16 + Shift));
+        const __m128i GreenPlace = _mm_cvtsi32_si128(Bits);
+        const __m128i RedPlace = _mm_cvtsi32_si128(2 * Bits);
+        for (; X + 8 <= Width; X += 8)
+        {
+            __m256i Colors = _mm256_loadu_si256((const __m256i *)(Pixels + 4 * X));
+            __m256i Index = _mm256_and_si256(_mm256_srl_epi32(Colors, BlueShift), CellMask);
+            Index = _mm256_or_si256(Index, _mm256_sll_epi32(_mm256_and_si256(_mm256_srl_epi32(Colors, GreenShift), CellMask), GreenPlace));
+            Index = _mm256_or_si256(Index, _mm256_sll_epi32(_mm256_and_si256(_mm256_srl_epi32(Colors, RedShift), CellMask), RedPlace));
+            __m256i Cells = _mm256_and_si256(_mm256_i32gather_epi32((const int *)Lut, Index, 1), ByteMask);
+
+            // Dwords to bytes; the in-lane packs leave labels 0-3 and 4-7 in the two lanes
+            __m256i Words = _mm256_packus_epi32(Cells, Cells);
+            __m256i Bytes = _mm256_packus_epi16(Words, Words);
+            uint32_t Low = (uint32_t)_mm_cvtsi128_si32(_mm256_castsi256_si128(Bytes));
+            uint32_t High = (uint32_t)_mm_cvtsi128_si32(_mm256_extracti128_si256(Bytes, 1));
+            std::memcpy(Labels + X, &Low, 4);
+            std::memcpy(Labels + X + 4, &High, 4);
+        }
+    }
+#elif defined(SPYX_SSE2)
+    // Indices four at a time; SSE2 has no gather, so the table is read per lane
+    {
+        const uint32_t Shift = 8 - Bits;
+        const __m128i CellMask = _mm_set1_epi32((1 << Bits) - 1);
+        const __m128i BlueShift = _mm_cvtsi32_si128((int)Shift);
+        const __m128i GreenShift = _mm_cvtsi32_si128((int)(8 + Shift));
+        const __m128i RedShift = _mm_cvtsi32_si128((int)(16 + Shift));
+        const __m128i GreenPlace = _mm_cvtsi32_si128(Bits);
+        const __m128i RedPlace = _mm_cvtsi32_si128(2 * Bits);
+        alignas(16) uint32_t Indices[4];
+        for (; X + 4 <= Width; X += 4)
+        {
+            __m128i Colors = _mm_loadu_si128((const __m128i *)(Pixels + 4 * X));
+            __m128i Index = _mm_and_si128(_mm_srl_epi32(Colors, BlueShift), CellMask);
+            Index = _mm_or_si128(Index, _mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(Colors, GreenShift), CellMask), GreenPlace));
+            Index = _mm_or_si128(Index, _mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(Colors, RedShift), CellMask), RedPlace));
+            _mm_store_si128((__m128i *)Indices, Index);
+            Labels[X] = Lut[Indices[0]];
+            Labels[X + 1] = Lut[Indices[1]];
+            Labels[X + 2] = Lut[Indices[2]];
+            Labels[X + 3] = Lut[Indices[3]];
+        }
+    }
+#endif
+
+    for (; X < Width; X++)
+    {
+        uint32_t Color;
+        std::memcpy(&Color, Pixels + 4 * X, 4);
+        Labels[X] = Lut[GetCellIndex(Color, Bits)];
+    }
+}
+
+bool CPixelClassifier::Classify(const SImageView &Frame, const SClassifyOptions &Options, uint8_t *Labels,
+    int LabelStride, uint32_t *Counts) const
+{
+    if (MLut.empty() || !IsFrameSupported(Frame) || !Labels) return false;
+
+    int Width = 0;
+    int Height = 0;
+    GetLabelMapSize(Frame, Options, Width, Height);
+    if (Options.Step < 1 || LabelStride < Width) return false;
+    if (Counts) std::memset(Counts, 0, 256 * sizeof(uint32_t));
+    if (Width == 0) return true;
+
+    const SPixelRect Area = ClipToFrame(Options.RoiX, Options.RoiY, Options.RoiWidth, Options.RoiHeight, Frame.Width,
+        Frame.Height);
+    const int Left = Area.Left;
+    const int Top = Area.Top;
+    const int Right = Area.Right;
+    const int Bottom = Area.Bottom;
+    const int Step = Options.Step;
+    const bool IsGray = Frame.Format == EPixelFormat::Gray8;
+
+    for (int Y = 0; Y < Height; Y++)
+    {
+        const uint8_t *Row = Frame.Row((int)std::min<int64_t>((int64_t)Top + (int64_t)Y * Step + Step / 2, Bottom - 1));
+        uint8_t *LabelRow = Labels + (size_t)Y * LabelStride;
+
+        if (Step == 1 && !IsGray)
+        {
+            ClassifyRowBGRA(Row + (size_t)Left * 4, Width, MLut.data(), MBits, LabelRow);
+        }
+        else
+        {
+            for (int X = 0; X < Width; X++)
+            {
+                const int Column = (int)std::min<int64_t>((int64_t)Left + (int64_t)X * Step + Step / 2, Right - 1);
+                if (IsGray)
+                {
+                    LabelRow[X] = MGrayLut[Row[Column]];
+                    continue;
+                }
+                uint32_t Color;
+                std::memcpy(&Color, Row + (size_t)Column * 4, 4);
+                LabelRow[X] = MLut[GetCellIndex(Color, MBits)];
+            }
+        }
+
+        if (!Counts) continue;
+        for (int X = 0; X < Width; X++) Counts[LabelRow[X]]++;
+    }
+    return true;
+}
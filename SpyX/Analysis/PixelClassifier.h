@@ -0,0 +1,76 @@
+#ifndef TAPI_PIXEL_CLASSIFIER_H
+#define TAPI_PIXEL_CLASSIFIER_H
+
+#include "Imaging/ImageView.h"
+
+#include <cstdint>
+#include <vector>
+
+// Labels the pixels of BGRA8 or Gray8 frames from colour rules. Rules are compiled once into
+// a 3D lookup table indexed by the top LutBits of R, G and B, so classifying a pixel costs one
+// table read whatever the rules are. Each table cell takes the label of the colour at its
+// centre, which bounds the error of a rule edge to half a cell (4 levels at 5 bits).
+
+enum class EColorRuleType : int
+{
+    Hsv = 0,        // Hue, saturation and value ranges
+    RgbBox = 1,     // Per-channel box between two colours
+    Palette = 2     // Within a distance of a colour
+};
+
+struct SColorRule
+{
+    EColorRuleType Type = EColorRuleType::Hsv;
+    int Label = 1;                  // 1-255; 0 is left for pixels no rule holds
+
+    float HueMin = 0.0f;            // Degrees 0-360; HueMin > HueMax wraps through red
+    float HueMax = 360.0f;
+    float SaturationMin = 0.0f;     // 0-1
+    float SaturationMax = 1.0f;
+    float ValueMin = 0.0f;          // 0-1
+    float ValueMax = 1.0f;
+
+    uint32_t Color = 0;             // RgbBox: low corner, Palette: the colour (0xAARRGGBB)
+    uint32_t ColorHigh = 0;         // RgbBox: high corner
+    float MaxDistance = 0.0f;       // Palette: Euclidean RGB distance
+};
+
+struct SClassifyOptions
+{
+    int RoiX = 0;
+    int RoiY = 0;
+    int RoiWidth = 0;               // 0 = to the frame edge
+    int RoiHeight = 0;
+    int Step = 1;                   // Downsampling: one label per Step x Step block, from its centre pixel
+};
+
+static const int MinLutBits = 4;
+static const int MaxLutBits = 6;
+
+class CPixelClassifier
+{
+public:
+    // Rules are tried in order and the first that holds gives the label. Palette rules
+    // compete: where the first one is reached, the nearest palette colour within its distance
+    // wins. Fails on a label outside 1-255, an invalid range or LutBits outside 4-6.
+    bool Compile(const SColorRule *Rules, int Count, int LutBits = 5);
+    bool IsCompiled() const { return !MLut.empty(); }
+
+    // Label map size for Options on Frame; 0 x 0 if the search area is empty
+    static void GetLabelMapSize(const SImageView &Frame, const SClassifyOptions &Options, int &Width, int &Height);
+
+    // Writes the label map (Width x Height from GetLabelMapSize) and, if Counts is not null,
+    // the number of labels of each value into Counts[256]
+    bool Classify(const SImageView &Frame, const SClassifyOptions &Options, uint8_t *Labels, int LabelStride,
+        uint32_t *Counts) const;
+
+    // Label of one colour (0xAARRGGBB) through the table
+    uint8_t Lookup(uint32_t Color) const;
+
+private:
+    std::vector<uint8_t> MLut;      // (1 << 3 * MBits) cells, padded so 32-bit gathers stay inside
+    uint8_t MGrayLut[256] = {};     // Cells of R = G = B, indexed by the grey level
+    int MBits = 0;
+};
+
+#endif
@@ -0,0 +1,304 @@
+#include "PixelSampler.h"
+#include "Core/Simd.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// Below this many points the sort costs more than the cache misses it saves
+static const int MinPointsToSort = 32;
+
+static bool IsFrameSupported(const SImageView &Frame)
+{
+    return Frame.IsValid() && (Frame.Format == EPixelFormat::BGRA8 || Frame.Format == EPixelFormat::Gray8);
+}
+
+static bool IsInside(const SImageView &Frame, int32_t X, int32_t Y)
+{
+    return (uint32_t)X < (uint32_t)Frame.Width && (uint32_t)Y < (uint32_t)Frame.Height;
+}
+
+static uint32_t GrayToBGRA(uint32_t Value)
+{
+    return Value * 0x010101u | 0xFF000000u;
+}
+
+// Point indices in row-major order of their coordinates. Stays empty when the points are
+// few or already ordered, meaning "caller order".
+static void BuildRowOrder(const int32_t *Points, int Count, std::vector<uint32_t> &Order)
+{
+    Order.clear();
+    if (Count < MinPointsToSort) return;
+
+    bool IsOrdered = true;
+    for (int Index = 1; Index < Count && IsOrdered; Index++)
+    {
+        int32_t PreviousY = Points[2 * Index - 1];
+        int32_t Y = Points[2 * Index + 1];
+        IsOrdered = Y > PreviousY || (Y == PreviousY && Points[2 * Index] >= Points[2 * Index - 2]);
+    }
+    if (IsOrdered) return;
+
+    // Sort packed (y, x, index) keys; out-of-range coordinates only need to sort somewhere
+    std::vector<uint64_t> Keys((size_t)Count);
+    for (int Index = 0; Index < Count; Index++)
+    {
+        uint64_t Y = (uint64_t)(uint32_t)Points[2 * Index + 1] & 0xFFFFF;
+        uint64_t X = (uint64_t)(uint32_t)Points[2 * Index] & 0xFFFFF;
+        Keys[Index] = (Y << 44) | (X << 24) | (uint64_t)Index;
+    }
+    std::sort(Keys.begin(), Keys.end());
+
+    Order.resize((size_t)Count);
+    for (int Index = 0; Index < Count; Index++)
+    {
+        Order[Index] = (uint32_t)(Keys[Index] & 0xFFFFFF);
+    }
+}
+
+int SamplePixels(const SImageView &Frame, const int32_t *Points, int Count, uint32_t *Out)
+{
+    if (!IsFrameSupported(Frame) || !Points || !Out || Count <= 0) return 0;
+
+    std::vector<uint32_t> Order;
+    BuildRowOrder(Points, Count, Order);
+    const bool IsSorted = !Order.empty();
+
+    int Inside = 0;
+    int Position = 0;
+
+#ifdef SPYX_AVX2
+    // Eight points per gather; lanes outside the frame are masked off and stay zero. Byte
+    // offsets fit in 32 bits for any frame under 2 GiB, which D3D11 textures always are.
+    if (Frame.Format == EPixelFormat::BGRA8 && (size_t)Frame.Stride * Frame.Height < 0x7FFFFFFF)
+    {
+        const __m256i Width = _mm256_set1_epi32(Frame.Width);
+        const __m256i Height = _mm256_set1_epi32(Frame.Height);
+        const __m256i Stride = _mm256_set1_epi32(Frame.Stride);
+        const __m256i Negative = _mm256_set1_epi32(-1);
+
+        for (; Position + 8 <= Count; Position += 8)
+        {
+            alignas(32) int32_t Indices[8];
+            alignas(32) int32_t Xs[8];
+            alignas(32) int32_t Ys[8];
+            for (int Lane = 0; Lane < 8; Lane++)
+            {
+                Indices[Lane] = IsSorted ? (int32_t)Order[Position + Lane] : Position + Lane;
+                Xs[Lane] = Points[2 * Indices[Lane]];
+                Ys[Lane] = Points[2 * Indices[Lane] + 1];
+            }
+
+            __m256i X = _mm256_load_si256((const __m256i *)Xs);
+            __m256i Y = _mm256_load_si256((const __m256i *)Ys);
+            __m256i Mask = _mm256_and_si256(
+                _mm256_and_si256(_mm256_cmpgt_epi32(X, Negative), _mm256_cmpgt_epi32(Width, X)),
+                _mm256_and_si256(_mm256_cmpgt_epi32(Y, Negative), _mm256_cmpgt_epi32(Height, Y)));
+            __m256i Offsets = _mm256_add_epi32(_mm256_mullo_epi32(Y, Stride), _mm256_slli_epi32(X, 2));
+            Offsets = _mm256_and_si256(Offsets, Mask);
+
+            alignas(32) uint32_t Colours[8];
+            __m256i Gathered = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int *)Frame.Data, Offsets, Mask, 1);
+            _mm256_store_si256((__m256i *)Colours, Gathered);
+
+            for (int Lanes = _mm256_movemask_ps(_mm256_castsi256_ps(Mask)); Lanes; Lanes &= Lanes - 1)
+            {
+                Inside++;
+            }
+            for (int Lane = 0; Lane < 8; Lane++)
+            {
+                Out[Indices[Lane]] = Colours[Lane];
+            }
+        }
+    }
+#endif
+
+    for (; Position < Count; Position++)
+    {
+        int Index = IsSorted ? (int)Order[Position] : Position;
+        int32_t X = Points[2 * Index];
+        int32_t Y = Points[2 * Index + 1];
+        if (!IsInside(Frame, X, Y))
+        {
+            Out[Index] = 0;
+            continue;
+        }
+
+        Inside++;
+        if (Frame.Format == EPixelFormat::BGRA8)
+        {
+            std::memcpy(&Out[Index], Frame.Row(Y) + (size_t)X * 4, 4);
+        }
+        else
+        {
+            Out[Index] = GrayToBGRA(Frame.Row(Y)[X]);
+        }
+    }
+    return Inside;
+}
+
+// Per-channel sums of Width BGRA pixels, Width <= MaxNeighbourhoodSize
+static void SumRowBGRA(const uint8_t *Pixels, int Width, uint32_t Sums[4])
+{
+    int X = 0;
+#ifdef SPYX_SSE2
+    // 16-bit lanes hold at most ceil(31 / 4) * 31 pixels of 255, below 65536
+    const __m128i Zero = _mm_setzero_si128();
+    __m128i Accumulator = _mm_setzero_si128();
+    for (; X + 4 <= Width; X += 4)
+    {
+        __m128i Quad = _mm_loadu_si128((const __m128i *)(Pixels + 4 * X));
+        Accumulator = _mm_add_epi16(Accumulator, _mm_unpacklo_epi8(Quad, Zero));
+        Accumulator = _mm_add_epi16(Accumulator, _mm_unpackhi_epi8(Quad, Zero));
+    }
+    alignas(16) uint16_t Lanes[8];
+    _mm_store_si128((__m128i *)Lanes, Accumulator);
+    for (int Channel = 0; Channel < 4; Channel++)
+    {
+        Sums[Channel] += (uint32_t)Lanes[Channel] + Lanes[Channel + 4];
+    }
+#endif
+    for (; X < Width; X++)
+    {
+        for (int Channel = 0; Channel < 4; Channel++)
+        {
+            Sums[Channel] += Pixels[4 * X + Channel];
+        }
+    }
+}
+
+static void MinMaxRowBGRA(const uint8_t *Pixels, int Width, uint8_t Minimum[4], uint8_t Maximum[4])
+{
+    int X = 0;
+#ifdef SPYX_SSE2
+    if (Width >= 4)
+    {
+        __m128i Low = _mm_set1_epi8((char)0xFF);
+        __m128i High = _mm_setzero_si128();
+        for (; X + 4 <= Width; X += 4)
+        {
+            __m128i Quad = _mm_loadu_si128((const __m128i *)(Pixels + 4 * X));
+            Low = _mm_min_epu8(Low, Quad);
+            High = _mm_max_epu8(High, Quad);
+        }
+        Low = _mm_min_epu8(Low, _mm_srli_si128(Low, 8));
+        Low = _mm_min_epu8(Low, _mm_srli_si128(Low, 4));
+        High = _mm_max_epu8(High, _mm_srli_si128(High, 8));
+        High = _mm_max_epu8(High, _mm_srli_si128(High, 4));
+
+        uint8_t Lanes[4];
+        uint32_t Packed = (uint32_t)_mm_cvtsi128_si32(Low);
+        std::memcpy(Lanes, &Packed, 4);
+        for (int Channel = 0; Channel < 4; Channel++) Minimum[Channel] = std::min(Minimum[Channel], Lanes[Channel]);
+        Packed = (uint32_t)_mm_cvtsi128_si32(High);
+        std::memcpy(Lanes, &Packed, 4);
+        for (int Channel = 0; Channel < 4; Channel++) Maximum[Channel] = std::max(Maximum[Channel], Lanes[Channel]);
+    }
+#endif
+    for (; X < Width; X++)
+    {
+        for (int Channel = 0; Channel < 4; Channel++)
+        {
+            Minimum[Channel] = std::min(Minimum[Channel], Pixels[4 * X + Channel]);
+            Maximum[Channel] = std::max(Maximum[Channel], Pixels[4 * X + Channel]);
+        }
+    }
+}
+
+static uint32_t PackBGRA(const uint8_t Channels[4])
+{
+    return (uint32_t)Channels[0] | ((uint32_t)Channels[1] << 8) | ((uint32_t)Channels[2] << 16) |
+        ((uint32_t)Channels[3] << 24);
+}
+
+int SampleNeighbourhoods(const SImageView &Frame, const int32_t *Points, int Count, int Size,
+    ENeighbourhoodMode Mode, uint32_t *Out)
+{
+    if (!IsFrameSupported(Frame) || !Points || !Out || Count <= 0) return 0;
+    if (Size < 1 || Size > MaxNeighbourhoodSize) return 0;
+    if (Mode != ENeighbourhoodMode::Mean && Mode != ENeighbourhoodMode::MinMax) return 0;
+
+    std::vector<uint32_t> Order;
+    BuildRowOrder(Points, Count, Order);
+
+    const int Before = (Size - 1) / 2;
+    int Inside = 0;
+
+    for (int Position = 0; Position < Count; Position++)
+    {
+        int Index = Order.empty() ? Position : (int)Order[Position];
+        int32_t X = Points[2 * Index];
+        int32_t Y = Points[2 * Index + 1];
+        if (!IsInside(Frame, X, Y))
+        {
+            Out[Mode == ENeighbourhoodMode::Mean ? Index : 2 * Index] = 0;
+            if (Mode == ENeighbourhoodMode::MinMax) Out[2 * Index + 1] = 0;
+            continue;
+        }
+        Inside++;
+
+        int Left = std::max(X - Before, 0);
+        int Top = std::max(Y - Before, 0);
+        int Right = std::min(X - Before + Size, Frame.Width);
+        int Bottom = std::min(Y - Before + Size, Frame.Height);
+        int Width = Right - Left;
+        int PixelCount = Width * (Bottom - Top);
+
+        if (Frame.Format == EPixelFormat::BGRA8)
+        {
+            if (Mode == ENeighbourhoodMode::Mean)
+            {
+                uint32_t Sums[4] = {0, 0, 0, 0};
+                for (int Row = Top; Row < Bottom; Row++)
+                {
+                    SumRowBGRA(Frame.Row(Row) + (size_t)Left * 4, Width, Sums);
+                }
+
+                uint8_t Mean[4];
+                for (int Channel = 0; Channel < 4; Channel++)
+                {
+                    Mean[Channel] = (uint8_t)((Sums[Channel] + PixelCount / 2) / PixelCount);
+                }
+                Out[Index] = PackBGRA(Mean);
+            }
+            else
+            {
+                uint8_t Minimum[4] = {0xFF, 0xFF, 0xFF, 0xFF};
+                uint8_t Maximum[4] = {0, 0, 0, 0};
+                for (int Row = Top; Row < Bottom; Row++)
+                {
+                    MinMaxRowBGRA(Frame.Row(Row) + (size_t)Left * 4, Width, Minimum, Maximum);
+                }
+                Out[2 * Index] = PackBGRA(Minimum);
+                Out[2 * Index + 1] = PackBGRA(Maximum);
+            }
+        }
+        else
+        {
+            uint32_t Sum = 0;
+            uint8_t Minimum = 0xFF;
+            uint8_t Maximum = 0;
+            for (int Row = Top; Row < Bottom; Row++)
+            {
+                const uint8_t *Pixels = Frame.Row(Row) + Left;
+                for (int Column = 0; Column < Width; Column++)
+                {
+                    Sum += Pixels[Column];
+                    Minimum = std::min(Minimum, Pixels[Column]);
+                    Maximum = std::max(Maximum, Pixels[Column]);
+                }
+            }
+
+            if (Mode == ENeighbourhoodMode::Mean)
+            {
+                Out[Index] = GrayToBGRA((Sum + PixelCount / 2) / PixelCount);
+            }
+            else
+            {
+                Out[2 * Index] = GrayToBGRA(Minimum);
+                Out[2 * Index + 1] = GrayToBGRA(Maximum);
+            }
+        }
+    }
+    return Inside;
+}
@@ -0,0 +1,29 @@
+#ifndef TAPI_PIXEL_SAMPLER_H
+#define TAPI_PIXEL_SAMPLER_H
+
+#include "Imaging/ImageView.h"
+
+#include <cstdint>
+
+// Batched colour reads at many coordinates of a BGRA8 or Gray8 frame. Points are (x, y)
+// pairs in caller order; they are visited in row order so each frame row is touched once.
+// Colours are returned packed as in memory (read as uint32: 0xAARRGGBB); Gray8 samples are
+// replicated into B, G and R with alpha 255. Points outside the frame yield 0.
+
+enum class ENeighbourhoodMode : int
+{
+    Mean = 0,       // Rounded per-channel mean, one colour per point
+    MinMax = 1      // Per-channel minimum then maximum, two colours per point
+};
+
+static const int MaxNeighbourhoodSize = 31;
+
+// Returns the number of points inside the frame
+int SamplePixels(const SImageView &Frame, const int32_t *Points, int Count, uint32_t *Out);
+
+// Size x Size window centred on each point (even sizes extend right and down), clipped to the
+// frame. Size is 1..MaxNeighbourhoodSize. Returns the number of points inside the frame.
+int SampleNeighbourhoods(const SImageView &Frame, const int32_t *Points, int Count, int Size,
+    ENeighbourhoodMode Mode, uint32_t *Out);
+
+#endif
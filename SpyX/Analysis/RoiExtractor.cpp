@@ -0,0 +1,297 @@
+#include "RoiExtractor.h"
+#include "Core/Simd.h"
+#include "Imaging/ToneMapper.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// Largest area one output pixel may average, so 255 * area fits the 32-bit channel sums
+static const int64_t MaxSpanArea = 1 << 24;
+
+static bool IsRequestValid(const SRoiRequest &Roi)
+{
+    if (Roi.Width <= 0 || Roi.Height <= 0) return false;
+    if (Roi.Width > CRoiExtractor::MaxRoiSize || Roi.Height > CRoiExtractor::MaxRoiSize) return false;
+    if (Roi.Format != EPixelFormat::BGRA8 && Roi.Format != EPixelFormat::Gray8) return false;
+    if (Roi.OutputWidth < 0 || Roi.OutputHeight < 0) return false;
+    if (Roi.OutputWidth > Roi.Width || Roi.OutputHeight > Roi.Height) return false;
+
+    const int64_t SpanWidth = Roi.OutputWidth > 0 ? Roi.Width / Roi.OutputWidth + 1 : 1;
+    const int64_t SpanHeight = Roi.OutputHeight > 0 ? Roi.Height / Roi.OutputHeight + 1 : 1;
+    return SpanWidth * SpanHeight <= MaxSpanArea;
+}
+
+// End of the source span that output element Index averages, for Count elements over Size
+static int64_t GetSpanEnd(int Start, int Size, int Index, int Count)
+{
+    return (int64_t)Start + (int64_t)(Index + 1) * Size / Count;
+}
+
+// Rounded Sum / Area for the sums of one output pixel. A 48-bit reciprocal is exact while
+// Area < 2^20 because sums never exceed 255 * Area; larger areas divide.
+struct SAreaDivider
+{
+    uint32_t Area = 0;
+    uint64_t Reciprocal = 0;
+
+    explicit SAreaDivider(uint32_t InArea) : Area(InArea), Reciprocal((1ull << 48) / InArea + 1) {}
+
+    uint32_t operator()(uint32_t Sum) const
+    {
+        if (Area >= (1u << 20)) return (Sum + Area / 2) / Area;
+        return (uint32_t)(((uint64_t)Sum + Area / 2) * Reciprocal >> 48);
+    }
+};
+
+static uint8_t ToGray(uint32_t Blue, uint32_t Green, uint32_t Red)
+{
+    // Same weights as ConvertBGRA8ToGray8
+    return (uint8_t)((77 * Red + 150 * Green + 29 * Blue + 128) >> 8);
+}
+
+size_t CRoiExtractor::Layout(const SRoiRequest *Rois, int Count, SRoiOutput *OutLayout)
+{
+    if (!Rois || !OutLayout || Count <= 0) return 0;
+
+    // The size cap keeps each ROI below 2^30 bytes; only the running total can overflow
+    size_t Size = 0;
+    for (int Index = 0; Index < Count; Index++)
+    {
+        const SRoiRequest &Roi = Rois[Index];
+        if (!IsRequestValid(Roi)) return 0;
+
+        SRoiOutput &Output = OutLayout[Index];
+        Output.Width = Roi.OutputWidth > 0 ? Roi.OutputWidth : Roi.Width;
+        Output.Height = Roi.OutputHeight > 0 ? Roi.OutputHeight : Roi.Height;
+        Output.Format = Roi.Format;
+        Output.Stride = Output.Width * GetBytesPerPixel(Roi.Format);
+        Output.Offset = Size;
+
+        const size_t Bytes = ((size_t)Output.Stride * (size_t)Output.Height + 15) & ~(size_t)15;
+        if (Bytes > SIZE_MAX - Size) return 0;
+        Size += Bytes;
+    }
+    return Size;
+}
+
+bool CRoiExtractor::Extract(const SImageView &Frame, const SRoiRequest *Rois, int Count, const SRoiOutput *Layout,
+    uint8_t *Arena)
+{
+    if (!Frame.IsValid() || (Frame.Format != EPixelFormat::BGRA8 && Frame.Format != EPixelFormat::Gray8)) return false;
+    if (!Rois || !Layout || !Arena || Count <= 0) return false;
+
+    MRois.resize((size_t)Count);
+    MColumnEdges.clear();
+    size_t SumCount = 0;
+
+    for (int Index = 0; Index < Count; Index++)
+    {
+        const SRoiRequest &Request = Rois[Index];
+        const SRoiOutput &Output = Layout[Index];
+        if (!IsRequestValid(Request)) return false;
+
+        SActiveRoi &Roi = MRois[Index];
+        Roi.Request = &Request;
+        Roi.Output = &Output;
+        Roi.Destination = Arena + Output.Offset;
+        const SPixelRect Clipped = ClipToFrame(Request.X, Request.Y, Request.Width, Request.Height, Frame.Width,
+            Frame.Height);
+        Roi.Top = Clipped.Top;
+        Roi.Bottom = Clipped.Bottom;
+        Roi.Left = Clipped.Left;
+        Roi.Right = Clipped.Right;
+        Roi.IsScaled = Output.Width != Request.Width || Output.Height != Request.Height;
+        Roi.OutputRow = 0;
+        Roi.OutputRowEnd = GetSpanEnd(Request.Y, Request.Height, 0, Output.Height);
+
+        bool IsInside = Request.X >= 0 && Request.Y >= 0 && (int64_t)Request.X + Request.Width <= Frame.Width &&
+            (int64_t)Request.Y + Request.Height <= Frame.Height;
+        if (!IsInside && !Roi.IsScaled)
+        {
+            std::memset(Roi.Destination, 0, (size_t)Output.Stride * Output.Height);
+        }
+
+        if (Roi.IsScaled)
+        {
+            // Output column c averages ROI columns [Edges[c], Edges[c + 1])
+            Roi.EdgeOffset = MColumnEdges.size();
+            Roi.FirstColumn = -1;
+            for (int Column = 0; Column <= Output.Width; Column++)
+            {
+                int Edge = (int)((int64_t)Column * Request.Width / Output.Width);
+                if ((int64_t)Request.X + Edge <= Roi.Left) Roi.FirstColumn++;
+                MColumnEdges.push_back(Edge);
+            }
+            Roi.SumOffset = SumCount;
+            SumCount += (size_t)Output.Width * 4;
+        }
+    }
+    MSums.assign(SumCount, 0);
+
+    // Sweep the union of the ROIs' rows once, top to bottom
+    MOrder.resize((size_t)Count);
+    for (int Index = 0; Index < Count; Index++) MOrder[Index] = Index;
+    std::sort(MOrder.begin(), MOrder.end(), [this](int A, int B) { return MRois[A].Top < MRois[B].Top; });
+
+    MActive.clear();
+    size_t Next = 0;
+    int Y = 0;
+    while (Next < MOrder.size() || !MActive.empty())
+    {
+        if (MActive.empty()) Y = std::max(Y, MRois[MOrder[Next]].Top);
+        for (; Next < MOrder.size() && MRois[MOrder[Next]].Top <= Y; Next++)
+        {
+            if (MRois[MOrder[Next]].Top < MRois[MOrder[Next]].Bottom) MActive.push_back(MOrder[Next]);
+        }
+        if (Y >= Frame.Height) break;
+
+        for (int Index : MActive)
+        {
+            ProcessRow(Frame, Y, MRois[Index]);
+        }
+
+        Y++;
+        MActive.erase(std::remove_if(MActive.begin(), MActive.end(),
+            [this, Y](int Index) { return MRois[Index].Bottom <= Y; }), MActive.end());
+    }
+
+    // Scaled rows whose span ended outside the frame still get written
+    for (SActiveRoi &Roi : MRois)
+    {
+        if (!Roi.IsScaled) continue;
+        while (Roi.OutputRow < Roi.Output->Height) FinishOutputRow(Frame.Format, Roi);
+    }
+    return true;
+}
+
+void CRoiExtractor::ProcessRow(const SImageView &Frame, int Y, SActiveRoi &Roi)
+{
+    const SRoiRequest &Request = *Roi.Request;
+    const SRoiOutput &Output = *Roi.Output;
+    const int Left = Roi.Left;
+    const int Right = Roi.Right;
+    if (Left >= Right) return;
+
+    const uint8_t *Source = Frame.Row(Y) + (size_t)Left * GetBytesPerPixel(Frame.Format);
+    const int Width = Right - Left;
+
+    if (!Roi.IsScaled)
+    {
+        const int OutputBytesPerPixel = GetBytesPerPixel(Output.Format);
+        uint8_t *Destination = Roi.Destination + (size_t)(Y - Request.Y) * Output.Stride +
+            (size_t)(Left - Request.X) * OutputBytesPerPixel;
+
+        if (Frame.Format == Output.Format)
+        {
+            std::memcpy(Destination, Source, (size_t)Width * OutputBytesPerPixel);
+        }
+        else if (Frame.Format == EPixelFormat::BGRA8)
+        {
+            SImageView Segment;
+            Segment.Data = Source;
+            Segment.Width = Width;
+            Segment.Height = 1;
+            Segment.Stride = Width * 4;
+            Segment.Format = EPixelFormat::BGRA8;
+            ConvertBGRA8ToGray8(Segment, Destination, Width);
+        }
+        else
+        {
+            for (int X = 0; X < Width; X++)
+            {
+                uint32_t Value = Source[X] * 0x010101u | 0xFF000000u;
+                std::memcpy(Destination + 4 * X, &Value, 4);
+            }
+        }
+        return;
+    }
+
+    // Rows above this one that closed output rows (including ones entirely above the frame)
+    while (Roi.OutputRow < Output.Height && Y >= Roi.OutputRowEnd) FinishOutputRow(Frame.Format, Roi);
+    if (Roi.OutputRow >= Output.Height) return;
+
+    const int *Edges = MColumnEdges.data() + Roi.EdgeOffset;
+    uint32_t *Sums = MSums.data() + Roi.SumOffset;
+
+    int Column = Roi.FirstColumn;
+    for (int X = Left; X < Right && Column < Output.Width; Column++)
+    {
+        const int SpanEnd = (int)std::min<int64_t>((int64_t)Request.X + Edges[Column + 1], Right);
+        uint32_t *ColumnSums = Sums + 4 * Column;
+
+        if (Frame.Format == EPixelFormat::BGRA8)
+        {
+#ifdef SPYX_SSE2
+            const __m128i Zero = _mm_setzero_si128();
+            __m128i Accumulator = _mm_loadu_si128((const __m128i *)ColumnSums);
+            for (; X < SpanEnd; X++)
+            {
+                int Packed;
+                std::memcpy(&Packed, Source + 4 * (X - Left), 4);
+                __m128i Pixel = _mm_cvtsi32_si128(Packed);
+                Pixel = _mm_unpacklo_epi16(_mm_unpacklo_epi8(Pixel, Zero), Zero);
+                Accumulator = _mm_add_epi32(Accumulator, Pixel);
+            }
+            _mm_storeu_si128((__m128i *)ColumnSums, Accumulator);
+#else
+            for (; X < SpanEnd; X++)
+            {
+                const uint8_t *Pixel = Source + 4 * (X - Left);
+                for (int Channel = 0; Channel < 4; Channel++) ColumnSums[Channel] += Pixel[Channel];
+            }
+#endif
+        }
+        else
+        {
+            // Alpha counts coverage, so partly outside pixels fade like BGRA ones do
+            ColumnSums[3] += 255u * (uint32_t)(SpanEnd - X);
+            for (; X < SpanEnd; X++) ColumnSums[0] += Source[X - Left];
+        }
+    }
+
+    // The last frame row of this output row closes it right away
+    if (Y + 1 >= Roi.OutputRowEnd) FinishOutputRow(Frame.Format, Roi);
+}
+
+void CRoiExtractor::FinishOutputRow(EPixelFormat SourceFormat, SActiveRoi &Roi)
+{
+    const SRoiRequest &Request = *Roi.Request;
+    const SRoiOutput &Output = *Roi.Output;
+    const int *Edges = MColumnEdges.data() + Roi.EdgeOffset;
+    uint32_t *Sums = MSums.data() + Roi.SumOffset;
+    uint8_t *Destination = Roi.Destination + (size_t)Roi.OutputRow * Output.Stride;
+
+    // Output columns span one of two widths, so two dividers cover the whole row
+    const int64_t RowStart = Roi.OutputRow > 0 ? GetSpanEnd(0, Request.Height, Roi.OutputRow - 1, Output.Height) : 0;
+    const uint32_t RowHeight = (uint32_t)(Roi.OutputRowEnd - Request.Y - RowStart);
+    const uint32_t NarrowWidth = (uint32_t)(Request.Width / Output.Width);
+    const SAreaDivider Narrow(NarrowWidth * RowHeight);
+    const SAreaDivider Wide((NarrowWidth + 1) * RowHeight);
+
+    for (int Column = 0; Column < Output.Width; Column++)
+    {
+        uint32_t *ColumnSums = Sums + 4 * Column;
+        const SAreaDivider &Divider = (uint32_t)(Edges[Column + 1] - Edges[Column]) == NarrowWidth ? Narrow : Wide;
+
+        uint32_t Mean[4];
+        for (int Channel = 0; Channel < 4; Channel++)
+        {
+            Mean[Channel] = Divider(ColumnSums[Channel]);
+            ColumnSums[Channel] = 0;
+        }
+        if (SourceFormat == EPixelFormat::Gray8) Mean[1] = Mean[2] = Mean[0];
+
+        if (Output.Format == EPixelFormat::Gray8)
+        {
+            Destination[Column] = SourceFormat == EPixelFormat::Gray8 ? (uint8_t)Mean[0] : ToGray(Mean[0], Mean[1], Mean[2]);
+        }
+        else
+        {
+            for (int Channel = 0; Channel < 4; Channel++) Destination[4 * Column + Channel] = (uint8_t)Mean[Channel];
+        }
+    }
+
+    Roi.OutputRow++;
+    if (Roi.OutputRow < Output.Height) Roi.OutputRowEnd = GetSpanEnd(Request.Y, Request.Height, Roi.OutputRow, Output.Height);
+}
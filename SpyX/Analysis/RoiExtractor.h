@@ -0,0 +1,77 @@
+#ifndef TAPI_ROI_EXTRACTOR_H
+#define TAPI_ROI_EXTRACTOR_H
+
+#include "Imaging/ImageView.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Pulls many rectangles out of a BGRA8 or Gray8 frame in a single top-to-bottom sweep, so
+// every frame row is read once however many ROIs overlap it. Each ROI has its own output
+// format and an optional smaller output size, which is area-averaged. Outputs go into one
+// packed arena described by a layout table. Parts of a ROI outside the frame read as zero.
+
+struct SRoiRequest
+{
+    int X = 0;
+    int Y = 0;
+    int Width = 0;
+    int Height = 0;
+    EPixelFormat Format = EPixelFormat::BGRA8;  // BGRA8 or Gray8
+    int OutputWidth = 0;            // Downscaled size up to the ROI size, 0 keeps the ROI size
+    int OutputHeight = 0;
+};
+
+struct SRoiOutput
+{
+    size_t Offset = 0;              // Byte offset in the arena, 16-byte aligned
+    int Width = 0;
+    int Height = 0;
+    int Stride = 0;                 // Tightly packed rows
+    EPixelFormat Format = EPixelFormat::BGRA8;
+};
+
+class CRoiExtractor
+{
+public:
+    // Largest ROI side, the D3D11 texture limit. Bounds every stride and arena product.
+    static const int MaxRoiSize = 16384;
+
+    // Fills Layout (Count entries) and returns the arena size, or 0 if a request is invalid
+    static size_t Layout(const SRoiRequest *Rois, int Count, SRoiOutput *OutLayout);
+
+    // Arena must hold the size returned by Layout for the same requests
+    bool Extract(const SImageView &Frame, const SRoiRequest *Rois, int Count, const SRoiOutput *Layout,
+        uint8_t *Arena);
+
+private:
+    struct SActiveRoi
+    {
+        const SRoiRequest *Request = nullptr;
+        const SRoiOutput *Output = nullptr;
+        uint8_t *Destination = nullptr;
+        int Top = 0;                // ROI rows and columns clipped to the frame
+        int Bottom = 0;
+        int Left = 0;
+        int Right = 0;
+        bool IsScaled = false;
+        size_t EdgeOffset = 0;      // OutputWidth + 1 column edges in MColumnEdges
+        size_t SumOffset = 0;       // 4 sums per output column in MSums
+        int FirstColumn = 0;        // First output column touching the frame
+        int OutputRow = 0;          // Scaled output row being accumulated
+        int64_t OutputRowEnd = 0;   // Frame row after the last one of OutputRow, may lie past INT_MAX
+    };
+
+    void ProcessRow(const SImageView &Frame, int Y, SActiveRoi &Roi);
+    void FinishOutputRow(EPixelFormat SourceFormat, SActiveRoi &Roi);
+
+    // Per-call scratch, kept to avoid reallocating every frame
+    std::vector<SActiveRoi> MRois;
+    std::vector<int> MOrder;
+    std::vector<int> MActive;
+    std::vector<int> MColumnEdges;
+    std::vector<uint32_t> MSums;
+};
+
+#endif
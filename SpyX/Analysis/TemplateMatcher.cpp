@@ -0,0 +1,1025 @@
+#include "TemplateMatcher.h"
+#include "Core/Simd.h"
+#include "Imaging/ToneMapper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Position rows per parallel task. Fixed, so results are the same for any thread count.
+static const int BandRows = 16;
+
+struct SPreparedTemplate
+{
+    int Width = 0;
+    int Height = 0;
+    int Blocks = 0;                     // 16-pixel blocks per row, the last padded with masked-out pixels
+    bool HasMask = false;               // Some pixels inside the template do not count
+    std::vector<uint8_t> Pixels;        // Blocks * 16 per row, zero where masked out
+    std::vector<uint8_t> Mask;          // 0xFF where the pixel counts
+    uint32_t Count = 0;                 // Pixels that count
+    uint64_t Sum = 0;
+    double Energy = 0.0;                // Sum of squares about the mean
+    double Norm = 0.0;                  // Its square root
+
+    // Ncc bound on rows [Row, Height): sum and energy of the zero-mean template
+    std::vector<double> RemainingSum;
+    std::vector<double> RemainingEnergy;
+};
+
+// Per-row sums over Blocks 16-pixel blocks. Image is read through Mask so padding and
+// masked-out pixels compare equal to the zeroed template pixels.
+static uint32_t RowSad(const uint8_t *Image, const uint8_t *Pixels, const uint8_t *Mask, int Blocks)
+{
+#ifdef SPYX_SSE2
+    int Block = 0;
+    __m128i Total = _mm_setzero_si128();
+#ifdef SPYX_AVX2
+    __m256i Wide = _mm256_setzero_si256();
+    for (; Block + 2 <= Blocks; Block += 2)
+    {
+        __m256i Masked = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(Image + 16 * Block)),
+            _mm256_loadu_si256((const __m256i *)(Mask + 16 * Block)));
+        Wide = _mm256_add_epi64(Wide, _mm256_sad_epu8(Masked, _mm256_loadu_si256((const __m256i *)(Pixels + 16 * Block))));
+    }
+    Total = _mm_add_epi64(_mm256_castsi256_si128(Wide), _mm256_extracti128_si256(Wide, 1));
+#endif
+    for (; Block < Blocks; Block++)
+    {
+        __m128i Masked = _mm_and_si128(_mm_loadu_si128((const __m128i *)(Image + 16 * Block)),
+            _mm_loadu_si128((const __m128i *)(Mask + 16 * Block)));
+        Total = _mm_add_epi64(Total, _mm_sad_epu8(Masked, _mm_loadu_si128((const __m128i *)(Pixels + 16 * Block))));
+    }
+    return (uint32_t)_mm_cvtsi128_si32(Total) + (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(Total, 8));
+#else
+    uint32_t Total = 0;
+    for (int X = 0; X < Blocks * 16; X++)
+    {
+        int Difference = (Image[X] & Mask[X]) - Pixels[X];
+        Total += (uint32_t)(Difference < 0 ? -Difference : Difference);
+    }
+    return Total;
+#endif
+}
+
+#ifdef SPYX_SSE2
+static uint32_t HorizontalSum32(__m128i Value)
+{
+    Value = _mm_add_epi32(Value, _mm_srli_si128(Value, 8));
+    Value = _mm_add_epi32(Value, _mm_srli_si128(Value, 4));
+    return (uint32_t)_mm_cvtsi128_si32(Value);
+}
+#endif
+
+static uint32_t RowSsd(const uint8_t *Image, const uint8_t *Pixels, const uint8_t *Mask, int Blocks)
+{
+#ifdef SPYX_SSE2
+    int Block = 0;
+    __m128i Total = _mm_setzero_si128();
+#ifdef SPYX_AVX2
+    const __m256i WideZero = _mm256_setzero_si256();
+    __m256i Wide = _mm256_setzero_si256();
+    for (; Block + 2 <= Blocks; Block += 2)
+    {
+        __m256i Masked = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(Image + 16 * Block)),
+            _mm256_loadu_si256((const __m256i *)(Mask + 16 * Block)));
+        __m256i Template = _mm256_loadu_si256((const __m256i *)(Pixels + 16 * Block));
+        __m256i Low = _mm256_sub_epi16(_mm256_unpacklo_epi8(Masked, WideZero), _mm256_unpacklo_epi8(Template, WideZero));
+        __m256i High = _mm256_sub_epi16(_mm256_unpackhi_epi8(Masked, WideZero), _mm256_unpackhi_epi8(Template, WideZero));
+        Wide = _mm256_add_epi32(Wide, _mm256_add_epi32(_mm256_madd_epi16(Low, Low), _mm256_madd_epi16(High, High)));
+    }
+    Total = _mm_add_epi32(_mm256_castsi256_si128(Wide), _mm256_extracti128_si256(Wide, 1));
+#endif
+    const __m128i Zero = _mm_setzero_si128();
+    for (; Block < Blocks; Block++)
+    {
+        __m128i Masked = _mm_and_si128(_mm_loadu_si128((const __m128i *)(Image + 16 * Block)),
+            _mm_loadu_si128((const __m128i *)(Mask + 16 * Block)));
+        __m128i Template = _mm_loadu_si128((const __m128i *)(Pixels + 16 * Block));
+        __m128i Low = _mm_sub_epi16(_mm_unpacklo_epi8(Masked, Zero), _mm_unpacklo_epi8(Template, Zero));
+        __m128i High = _mm_sub_epi16(_mm_unpackhi_epi8(Masked, Zero), _mm_unpackhi_epi8(Template, Zero));
+        Total = _mm_add_epi32(Total, _mm_add_epi32(_mm_madd_epi16(Low, Low), _mm_madd_epi16(High, High)));
+    }
+    return HorizontalSum32(Total);
+#else
+    uint32_t Total = 0;
+    for (int X = 0; X < Blocks * 16; X++)
+    {
+        int Difference = (Image[X] & Mask[X]) - Pixels[X];
+        Total += (uint32_t)(Difference * Difference);
+    }
+    return Total;
+#endif
+}
+
+// Sum of the image, cross product with the template and, for masked templates, the image
+// energy. Lanes stay within 32 bits for rows up to MaxTemplateSize.
+struct SRowProducts
+{
+    uint32_t Sum = 0;
+    uint32_t Cross = 0;
+    uint32_t Energy = 0;
+};
+
+static void RowNcc(const uint8_t *Image, const uint8_t *Pixels, const uint8_t *Mask, int Blocks, bool WantEnergy,
+    SRowProducts &Out)
+{
+#ifdef SPYX_SSE2
+    int Block = 0;
+    __m128i Sum = _mm_setzero_si128();
+    __m128i Cross = _mm_setzero_si128();
+    __m128i Energy = _mm_setzero_si128();
+#ifdef SPYX_AVX2
+    const __m256i WideZero = _mm256_setzero_si256();
+    __m256i WideSum = _mm256_setzero_si256();
+    __m256i WideCross = _mm256_setzero_si256();
+    __m256i WideEnergy = _mm256_setzero_si256();
+    for (; Block + 2 <= Blocks; Block += 2)
+    {
+        __m256i Masked = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(Image + 16 * Block)),
+            _mm256_loadu_si256((const __m256i *)(Mask + 16 * Block)));
+        __m256i Template = _mm256_loadu_si256((const __m256i *)(Pixels + 16 * Block));
+        __m256i Low = _mm256_unpacklo_epi8(Masked, WideZero);
+        __m256i High = _mm256_unpackhi_epi8(Masked, WideZero);
+        WideSum = _mm256_add_epi64(WideSum, _mm256_sad_epu8(Masked, WideZero));
+        WideCross = _mm256_add_epi32(WideCross, _mm256_add_epi32(
+            _mm256_madd_epi16(Low, _mm256_unpacklo_epi8(Template, WideZero)),
+            _mm256_madd_epi16(High, _mm256_unpackhi_epi8(Template, WideZero))));
+        if (WantEnergy)
+        {
+            WideEnergy = _mm256_add_epi32(WideEnergy, _mm256_add_epi32(_mm256_madd_epi16(Low, Low), _mm256_madd_epi16(High, High)));
+        }
+    }
+    Sum = _mm_add_epi64(_mm256_castsi256_si128(WideSum), _mm256_extracti128_si256(WideSum, 1));
+    Cross = _mm_add_epi32(_mm256_castsi256_si128(WideCross), _mm256_extracti128_si256(WideCross, 1));
+    Energy = _mm_add_epi32(_mm256_castsi256_si128(WideEnergy), _mm256_extracti128_si256(WideEnergy, 1));
+#endif
+    const __m128i Zero = _mm_setzero_si128();
+    for (; Block < Blocks; Block++)
+    {
+        __m128i Masked = _mm_and_si128(_mm_loadu_si128((const __m128i *)(Image + 16 * Block)),
+            _mm_loadu_si128((const __m128i *)(Mask + 16 * Block)));
+        __m128i Template = _mm_loadu_si128((const __m128i *)(Pixels + 16 * Block));
+        __m128i Low = _mm_unpacklo_epi8(Masked, Zero);
+        __m128i High = _mm_unpackhi_epi8(Masked, Zero);
+        Sum = _mm_add_epi64(Sum, _mm_sad_epu8(Masked, Zero));
+        Cross = _mm_add_epi32(Cross, _mm_add_epi32(_mm_madd_epi16(Low, _mm_unpacklo_epi8(Template, Zero)),
+            _mm_madd_epi16(High, _mm_unpackhi_epi8(Template, Zero))));
+        if (WantEnergy)
+        {
+            Energy = _mm_add_epi32(Energy, _mm_add_epi32(_mm_madd_epi16(Low, Low), _mm_madd_epi16(High, High)));
+        }
+    }
+    Out.Sum = (uint32_t)_mm_cvtsi128_si32(Sum) + (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(Sum, 8));
+    Out.Cross = HorizontalSum32(Cross);
+    Out.Energy = HorizontalSum32(Energy);
+#else
+    Out = SRowProducts();
+    for (int X = 0; X < Blocks * 16; X++)
+    {
+        uint32_t Value = Image[X] & Mask[X];
+        Out.Sum += Value;
+        Out.Cross += Value * Pixels[X];
+        if (WantEnergy) Out.Energy += Value * Value;
+    }
+#endif
+}
+
+static bool IsBetter(EMatchMethod Method, float Score, float Other)
+{
+    return Method == EMatchMethod::Ncc ? Score > Other : Score < Other;
+}
+
+// Keeps the best MaxResults matches, best first. A match within Radius of a better one is
+// dropped, and one that beats nearby matches replaces them.
+static void InsertMatch(std::vector<SMatch> &List, const SMatch &Match, EMatchMethod Method, int MaxResults, int Radius)
+{
+    if ((int)List.size() >= MaxResults && !IsBetter(Method, Match.Score, List.back().Score)) return;
+
+    auto IsNear = [&Match, Radius](const SMatch &Other)
+    {
+        return std::abs(Other.X - Match.X) <= Radius && std::abs(Other.Y - Match.Y) <= Radius;
+    };
+    for (const SMatch &Other : List)
+    {
+        if (IsNear(Other) && !IsBetter(Method, Match.Score, Other.Score)) return;
+    }
+    List.erase(std::remove_if(List.begin(), List.end(), IsNear), List.end());
+
+    auto Position = std::find_if(List.begin(), List.end(),
+        [&](const SMatch &Other) { return IsBetter(Method, Match.Score, Other.Score); });
+    List.insert(Position, Match);
+    if ((int)List.size() > MaxResults) List.pop_back();
+}
+
+// Running-total limit of a Sad/Ssd position: the threshold, or the weakest kept result once
+// the list is full, since nothing worse can enter it
+static uint64_t GetDifferenceLimit(const std::vector<SMatch> &Results, const SMatchOptions &Options, uint32_t Count)
+{
+    float Limit = Options.MaxDifference;
+    if ((int)Results.size() >= Options.MaxResults) Limit = std::min(Limit, Results.back().Score);
+    return Limit < 0.0f ? 0 : (uint64_t)std::floor((double)Limit * Count);
+}
+
+static float GetCorrelationLimit(const std::vector<SMatch> &Results, const SMatchOptions &Options)
+{
+    float Limit = Options.MinCorrelation;
+    if ((int)Results.size() >= Options.MaxResults) Limit = std::max(Limit, Results.back().Score);
+    return Limit;
+}
+
+// One row of positions for Sad or Ssd. A position stops at the first template row that takes
+// its total past the limit.
+template <bool IsSad>
+static void ScanDifferenceRow(const uint8_t *Image, int Stride, int Y, int Positions, const SPreparedTemplate &Template,
+    const SMatchOptions &Options, int Radius, std::vector<SMatch> &Results)
+{
+    const int TemplateStride = Template.Blocks * 16;
+    uint64_t Limit = GetDifferenceLimit(Results, Options, Template.Count);
+
+    for (int X = 0; X < Positions; X++)
+    {
+        const uint8_t *Window = Image + X;
+        const uint8_t *Pixels = Template.Pixels.data();
+        const uint8_t *Mask = Template.Mask.data();
+        uint64_t Total = 0;
+        for (int Row = 0; Row < Template.Height && Total <= Limit; Row++)
+        {
+            Total += IsSad ? RowSad(Window, Pixels, Mask, Template.Blocks) : RowSsd(Window, Pixels, Mask, Template.Blocks);
+            Window += Stride;
+            Pixels += TemplateStride;
+            Mask += TemplateStride;
+        }
+        if (Total > Limit) continue;
+
+        SMatch Match;
+        Match.X = X;
+        Match.Y = Y;
+        Match.Score = (float)((double)Total / Template.Count);
+        if (Match.Score > Options.MaxDifference) continue;
+
+        InsertMatch(Results, Match, IsSad ? EMatchMethod::Sad : EMatchMethod::Ssd, Options.MaxResults, Radius);
+        Limit = GetDifferenceLimit(Results, Options, Template.Count);
+    }
+}
+
+// One row of positions for Ncc with an unmasked template. Window sums come from the column
+// sums, so after each template row Cauchy-Schwarz bounds what the remaining rows can add:
+//   sum T'(I - m) <= sqrt(sum T'^2 * sum (I - m)^2) over those rows, with T' = T - mean(T).
+static void ScanCorrelationRow(const uint8_t *Image, int Stride, int Y, int Positions, const SPreparedTemplate &Template,
+    const uint32_t *ColumnSums, const uint32_t *ColumnSquares, const SMatchOptions &Options, int Radius,
+    std::vector<SMatch> &Results)
+{
+    const int TemplateStride = Template.Blocks * 16;
+    const double Count = Template.Count;
+    const double TemplateMean = (double)Template.Sum / Count;
+    float Limit = GetCorrelationLimit(Results, Options);
+
+    uint64_t WindowSum = 0;
+    uint64_t WindowSquares = 0;
+    for (int X = 0; X < Template.Width; X++)
+    {
+        WindowSum += ColumnSums[X];
+        WindowSquares += ColumnSquares[X];
+    }
+
+    for (int X = 0; X < Positions; X++)
+    {
+        if (X > 0)
+        {
+            WindowSum += (uint64_t)ColumnSums[X - 1 + Template.Width] - ColumnSums[X - 1];
+            WindowSquares += (uint64_t)ColumnSquares[X - 1 + Template.Width] - ColumnSquares[X - 1];
+        }
+
+        const double Mean = WindowSum / Count;
+        const double Variance = (double)WindowSquares - WindowSum * Mean;
+        if (Variance <= 0.0) continue;
+
+        const double Denominator = Template.Norm * std::sqrt(Variance);
+        const double Needed = (Limit - 1e-6) * Denominator;
+
+        const uint8_t *Window = Image + X;
+        const uint8_t *Pixels = Template.Pixels.data();
+        const uint8_t *Mask = Template.Mask.data();
+        int64_t Cross = 0;
+        int64_t Sum = 0;
+        int64_t Squares = 0;
+        int Row = 0;
+        while (Row < Template.Height)
+        {
+            SRowProducts Products;
+            RowNcc(Window, Pixels, Mask, Template.Blocks, true, Products);
+            Cross += Products.Cross;
+            Sum += Products.Sum;
+            Squares += Products.Energy;
+            Window += Stride;
+            Pixels += TemplateStride;
+            Mask += TemplateStride;
+            Row++;
+
+            // Gap the rows left must close, against their largest possible contribution
+            const double Gap = Needed - (Cross - TemplateMean * Sum) - Template.RemainingSum[Row] * Mean;
+            if (Gap <= 0.0) continue;
+            const double RemainingCount = (double)(Template.Height - Row) * Template.Width;
+            const double RemainingSum = (double)WindowSum - Sum;
+            const double RemainingVariance = ((double)WindowSquares - Squares) - 2.0 * Mean * RemainingSum +
+                Mean * Mean * RemainingCount;
+            if (Template.RemainingEnergy[Row] * RemainingVariance < Gap * Gap) break;
+        }
+        if (Row < Template.Height) continue;
+
+        SMatch Match;
+        Match.X = X;
+        Match.Y = Y;
+        Match.Score = (float)((Cross - TemplateMean * Sum) / Denominator);
+        if (Match.Score < Options.MinCorrelation) continue;
+
+        InsertMatch(Results, Match, EMatchMethod::Ncc, Options.MaxResults, Radius);
+        Limit = GetCorrelationLimit(Results, Options);
+    }
+}
+
+// One row of positions for Ncc with a masked template; window statistics depend on the mask,
+// so they are gathered along with the cross product and every row is visited
+static void ScanMaskedCorrelationRow(const uint8_t *Image, int Stride, int Y, int Positions,
+    const SPreparedTemplate &Template, const SMatchOptions &Options, int Radius, std::vector<SMatch> &Results)
+{
+    const int TemplateStride = Template.Blocks * 16;
+    const double Count = Template.Count;
+    const double TemplateMean = (double)Template.Sum / Count;
+
+    for (int X = 0; X < Positions; X++)
+    {
+        const uint8_t *Window = Image + X;
+        const uint8_t *Pixels = Template.Pixels.data();
+        const uint8_t *Mask = Template.Mask.data();
+        int64_t Cross = 0;
+        int64_t Sum = 0;
+        int64_t Squares = 0;
+        for (int Row = 0; Row < Template.Height; Row++)
+        {
+            SRowProducts Products;
+            RowNcc(Window, Pixels, Mask, Template.Blocks, true, Products);
+            Cross += Products.Cross;
+            Sum += Products.Sum;
+            Squares += Products.Energy;
+            Window += Stride;
+            Pixels += TemplateStride;
+            Mask += TemplateStride;
+        }
+
+        const double Variance = (double)Squares - (double)Sum * Sum / Count;
+        if (Variance <= 0.0) continue;
+
+        SMatch Match;
+        Match.X = X;
+        Match.Y = Y;
+        Match.Score = (float)((Cross - TemplateMean * Sum) / (Template.Norm * std::sqrt(Variance)));
+        if (Match.Score < Options.MinCorrelation) continue;
+
+        InsertMatch(Results, Match, EMatchMethod::Ncc, Options.MaxResults, Radius);
+    }
+}
+
+// Coarse template levels stop before either side drops below this
+static const int MinCoarseTemplateSize = 8;
+
+// Scales tried per call, and scaled copies kept per template before the cache starts over
+static const int MaxScaleCount = 32;
+static const int MaxCachedVariants = 64;
+
+// Refinement searches this far around twice a coarse candidate's position
+static const int RefineRadius = 2;
+
+// A template as added. Scaled copies and their reduced levels are prepared the first time a
+// search asks for them and kept for later calls.
+struct STemplateSource
+{
+    struct SVariant
+    {
+        float Scale = 1.0f;
+        EPyramidFilter Filter = EPyramidFilter::Box;
+        std::vector<std::unique_ptr<SPreparedTemplate>> Levels;
+        bool IsComplete = false;        // The next level would be too small or fully masked
+
+        // Last level, tightly packed, to reduce the next one from
+        int Width = 0;
+        int Height = 0;
+        std::vector<uint8_t> Luma;
+        std::vector<uint8_t> Mask;
+    };
+
+    int Width = 0;
+    int Height = 0;
+    std::vector<uint8_t> Luma;
+    std::vector<uint8_t> Mask;          // 0xFF where the pixel counts
+    std::vector<SVariant> Variants;
+};
+
+// Pads tightly packed Luma and Mask into 16-pixel blocks and gathers the statistics the
+// scanners use. Returns null if no pixel counts.
+static std::unique_ptr<SPreparedTemplate> PrepareTemplate(const uint8_t *Luma, const uint8_t *Mask, int Width, int Height)
+{
+    std::unique_ptr<SPreparedTemplate> Template = std::make_unique<SPreparedTemplate>();
+    Template->Width = Width;
+    Template->Height = Height;
+    Template->Blocks = (Width + 15) / 16;
+
+    const int Stride = Template->Blocks * 16;
+    Template->Pixels.assign((size_t)Stride * Height, 0);
+    Template->Mask.assign((size_t)Stride * Height, 0);
+
+    uint64_t SumOfSquares = 0;
+    std::vector<uint64_t> RowSums((size_t)Height, 0);
+    std::vector<uint64_t> RowSquares((size_t)Height, 0);
+    std::vector<uint32_t> RowCounts((size_t)Height, 0);
+    for (int Y = 0; Y < Height; Y++)
+    {
+        uint8_t *Pixels = &Template->Pixels[(size_t)Y * Stride];
+        uint8_t *PixelMask = &Template->Mask[(size_t)Y * Stride];
+        for (int X = 0; X < Width; X++)
+        {
+            const size_t Source = (size_t)Y * Width + X;
+            if (!Mask[Source])
+            {
+                Template->HasMask = true;
+                continue;
+            }
+            Pixels[X] = Luma[Source];
+            PixelMask[X] = 0xFF;
+            RowSums[Y] += Pixels[X];
+            RowSquares[Y] += (uint32_t)Pixels[X] * Pixels[X];
+            RowCounts[Y]++;
+        }
+        Template->Sum += RowSums[Y];
+        SumOfSquares += RowSquares[Y];
+        Template->Count += RowCounts[Y];
+    }
+    if (Template->Count == 0) return nullptr;
+
+    const double Mean = (double)Template->Sum / Template->Count;
+    Template->Energy = std::max((double)SumOfSquares - (double)Template->Sum * Mean, 0.0);
+    Template->Norm = std::sqrt(Template->Energy);
+
+    // Suffix sums of the zero-mean template per row: sum T' = S - Mean * N, sum T'^2 = Q - 2 Mean S + Mean^2 N
+    Template->RemainingSum.assign((size_t)Height + 1, 0.0);
+    Template->RemainingEnergy.assign((size_t)Height + 1, 0.0);
+    double Sum = 0.0;
+    double Energy = 0.0;
+    for (int Y = Height - 1; Y >= 0; Y--)
+    {
+        Sum += (double)RowSums[Y] - Mean * RowCounts[Y];
+        Energy += (double)RowSquares[Y] - 2.0 * Mean * RowSums[Y] + Mean * Mean * RowCounts[Y];
+        Template->RemainingSum[Y] = Sum;
+        Template->RemainingEnergy[Y] = std::max(Energy, 0.0);
+    }
+    return Template;
+}
+
+// Bilinear luma and nearest-neighbour mask, sampled at pixel centres
+static void ScaleTemplate(const STemplateSource &Source, STemplateSource::SVariant &Variant)
+{
+    const double StepX = (double)Source.Width / Variant.Width;
+    const double StepY = (double)Source.Height / Variant.Height;
+    Variant.Luma.resize((size_t)Variant.Width * Variant.Height);
+    Variant.Mask.resize((size_t)Variant.Width * Variant.Height);
+
+    for (int Y = 0; Y < Variant.Height; Y++)
+    {
+        const double SourceY = std::min(std::max((Y + 0.5) * StepY - 0.5, 0.0), Source.Height - 1.0);
+        const int Top = (int)SourceY;
+        const int Bottom = std::min(Top + 1, Source.Height - 1);
+        const double WeightY = SourceY - Top;
+        const int NearestY = (int)(SourceY + 0.5);
+
+        for (int X = 0; X < Variant.Width; X++)
+        {
+            const double SourceX = std::min(std::max((X + 0.5) * StepX - 0.5, 0.0), Source.Width - 1.0);
+            const int Left = (int)SourceX;
+            const int Right = std::min(Left + 1, Source.Width - 1);
+            const double WeightX = SourceX - Left;
+
+            const uint8_t *Upper = &Source.Luma[(size_t)Top * Source.Width];
+            const uint8_t *Lower = &Source.Luma[(size_t)Bottom * Source.Width];
+            const double Value = (Upper[Left] * (1.0 - WeightX) + Upper[Right] * WeightX) * (1.0 - WeightY) +
+                (Lower[Left] * (1.0 - WeightX) + Lower[Right] * WeightX) * WeightY;
+
+            const size_t Index = (size_t)Y * Variant.Width + X;
+            Variant.Luma[Index] = (uint8_t)(Value + 0.5);
+            Variant.Mask[Index] = Source.Mask[(size_t)NearestY * Source.Width + (int)(SourceX + 0.5)];
+        }
+    }
+}
+
+// Variant for Scale and Filter with its full-size level prepared, or null if the scaled
+// template is empty, too large or fully masked
+static STemplateSource::SVariant *GetVariant(STemplateSource &Source, float Scale, EPyramidFilter Filter)
+{
+    for (STemplateSource::SVariant &Variant : Source.Variants)
+    {
+        if (Variant.Scale == Scale && Variant.Filter == Filter) return Variant.Levels.empty() ? nullptr : &Variant;
+    }
+
+    STemplateSource::SVariant Variant;
+    Variant.Scale = Scale;
+    Variant.Filter = Filter;
+    Variant.Width = Scale == 1.0f ? Source.Width : (int)std::lround(Source.Width * (double)Scale);
+    Variant.Height = Scale == 1.0f ? Source.Height : (int)std::lround(Source.Height * (double)Scale);
+    if (Variant.Width >= 1 && Variant.Height >= 1 && Variant.Width <= MaxTemplateSize && Variant.Height <= MaxTemplateSize)
+    {
+        if (Scale == 1.0f)
+        {
+            Variant.Luma = Source.Luma;
+            Variant.Mask = Source.Mask;
+        }
+        else
+        {
+            ScaleTemplate(Source, Variant);
+        }
+
+        std::unique_ptr<SPreparedTemplate> Template = PrepareTemplate(Variant.Luma.data(), Variant.Mask.data(),
+            Variant.Width, Variant.Height);
+        if (Template) Variant.Levels.push_back(std::move(Template));
+    }
+    Variant.IsComplete = Variant.Levels.empty();
+
+    // Failed scales are kept too, so they are not retried on every call
+    Source.Variants.push_back(std::move(Variant));
+    return Source.Variants.back().Levels.empty() ? nullptr : &Source.Variants.back();
+}
+
+// Reduces the variant until it has Levels + 1 levels or cannot go further. The frame pyramid's
+// filter is used, so coarse templates look like the frame around them. A reduced pixel counts
+// only if every pixel under its filter does.
+static void ExtendVariant(STemplateSource::SVariant &Variant, int Levels)
+{
+    while (!Variant.IsComplete && (int)Variant.Levels.size() <= Levels)
+    {
+        const int Width = Variant.Width / 2;
+        const int Height = Variant.Height / 2;
+        if (Width < MinCoarseTemplateSize || Height < MinCoarseTemplateSize)
+        {
+            Variant.IsComplete = true;
+            break;
+        }
+
+        SImageView Source;
+        Source.Data = Variant.Luma.data();
+        Source.Width = Variant.Width;
+        Source.Height = Variant.Height;
+        Source.Stride = Variant.Width;
+        Source.Format = EPixelFormat::Gray8;
+
+        std::vector<uint8_t> Luma((size_t)Width * Height);
+        std::vector<uint8_t> Mask((size_t)Width * Height);
+        ReduceGray8(Source, Luma.data(), Width, Variant.Filter);
+
+        const int Reach = Variant.Filter == EPyramidFilter::Box ? 0 : 1;
+        for (int Y = 0; Y < Height; Y++)
+        {
+            for (int X = 0; X < Width; X++)
+            {
+                uint8_t Counts = 0xFF;
+                for (int SourceY = std::max(2 * Y - Reach, 0); SourceY <= std::min(2 * Y + 1 + Reach, Variant.Height - 1); SourceY++)
+                {
+                    for (int SourceX = std::max(2 * X - Reach, 0); SourceX <= std::min(2 * X + 1 + Reach, Variant.Width - 1); SourceX++)
+                    {
+                        Counts &= Variant.Mask[(size_t)SourceY * Variant.Width + SourceX];
+                    }
+                }
+                Mask[(size_t)Y * Width + X] = Counts;
+            }
+        }
+
+        std::unique_ptr<SPreparedTemplate> Template = PrepareTemplate(Luma.data(), Mask.data(), Width, Height);
+        if (!Template)
+        {
+            Variant.IsComplete = true;
+            break;
+        }
+        Variant.Levels.push_back(std::move(Template));
+        Variant.Width = Width;
+        Variant.Height = Height;
+        Variant.Luma.swap(Luma);
+        Variant.Mask.swap(Mask);
+    }
+}
+
+// MinScale times powers of ScaleStep up to MaxScale. Fails on a range that is empty or cannot
+// be stepped through.
+static bool GetScales(const SMatchOptions &Options, std::vector<float> &Scales)
+{
+    Scales.clear();
+    if (!(Options.MinScale > 0.0f) || !(Options.MaxScale >= Options.MinScale)) return false;
+    if (Options.MaxScale == Options.MinScale)
+    {
+        Scales.push_back(Options.MinScale);
+        return true;
+    }
+    if (!(Options.ScaleStep > 1.0f)) return false;
+
+    for (double Scale = Options.MinScale; Scale <= Options.MaxScale * (1.0 + 1e-6) && (int)Scales.size() < MaxScaleCount;
+        Scale *= Options.ScaleStep)
+    {
+        Scales.push_back((float)Scale);
+    }
+    return true;
+}
+
+static int GetSuppressRadius(const SMatchOptions &Options, int Width, int Height)
+{
+    return Options.SuppressRadius >= 0 ? Options.SuppressRadius : std::min(Width, Height) / 2;
+}
+
+// Options of a search on Level. Coarse levels keep the best CoarseCandidates positions whatever
+// their score, since reduction blurs scores; thresholds only apply at full resolution.
+static SMatchOptions GetLevelOptions(const SMatchOptions &Options, int Level)
+{
+    if (Level == 0) return Options;
+
+    SMatchOptions Coarse = Options;
+    Coarse.MaxResults = std::max(Options.CoarseCandidates, 1);
+    Coarse.MaxDifference = 65025.0f;
+    Coarse.MinCorrelation = -1.0f;
+    if (Options.SuppressRadius >= 0) Coarse.SuppressRadius = Options.SuppressRadius >> Level;
+    return Coarse;
+}
+
+CTemplateMatcher::CTemplateMatcher(int ThreadCount)
+{
+    MPool = std::make_unique<CThreadPool>(ThreadCount);
+}
+
+CTemplateMatcher::~CTemplateMatcher() = default;
+
+int CTemplateMatcher::AddTemplate(const SImageView &Image, bool UseAlphaMask)
+{
+    if (!Image.IsValid() || (Image.Format != EPixelFormat::BGRA8 && Image.Format != EPixelFormat::Gray8)) return -1;
+    if (Image.Width > MaxTemplateSize || Image.Height > MaxTemplateSize) return -1;
+
+    std::unique_ptr<STemplateSource> Source = std::make_unique<STemplateSource>();
+    Source->Width = Image.Width;
+    Source->Height = Image.Height;
+    Source->Luma.resize((size_t)Image.Width * Image.Height);
+    Source->Mask.assign((size_t)Image.Width * Image.Height, 0xFF);
+
+    if (Image.Format == EPixelFormat::BGRA8)
+    {
+        ConvertBGRA8ToGray8(Image, Source->Luma.data(), Image.Width);
+        if (UseAlphaMask)
+        {
+            for (int Y = 0; Y < Image.Height; Y++)
+            {
+                for (int X = 0; X < Image.Width; X++)
+                {
+                    if (Image.Row(Y)[4 * X + 3] < 128) Source->Mask[(size_t)Y * Image.Width + X] = 0;
+                }
+            }
+        }
+    }
+    else
+    {
+        for (int Y = 0; Y < Image.Height; Y++) std::memcpy(&Source->Luma[(size_t)Y * Image.Width], Image.Row(Y), Image.Width);
+    }
+
+    // The full-size template is prepared now, so a fully transparent one fails here
+    if (!GetVariant(*Source, 1.0f, EPyramidFilter::Box)) return -1;
+
+    for (size_t Id = 0; Id < MTemplates.size(); Id++)
+    {
+        if (!MTemplates[Id])
+        {
+            MTemplates[Id] = std::move(Source);
+            return (int)Id;
+        }
+    }
+    MTemplates.push_back(std::move(Source));
+    return (int)MTemplates.size() - 1;
+}
+
+bool CTemplateMatcher::RemoveTemplate(int Id)
+{
+    if (Id < 0 || Id >= (int)MTemplates.size() || !MTemplates[Id]) return false;
+    MTemplates[Id].reset();
+    return true;
+}
+
+void CTemplateMatcher::ClearTemplates()
+{
+    MTemplates.clear();
+}
+
+bool CTemplateMatcher::GetTemplateSize(int Id, int &Width, int &Height) const
+{
+    if (Id < 0 || Id >= (int)MTemplates.size() || !MTemplates[Id]) return false;
+    Width = MTemplates[Id]->Width;
+    Height = MTemplates[Id]->Height;
+    return true;
+}
+
+bool CTemplateMatcher::IsRequestValid(const int *Ids, int Count, const SMatchOptions &Options)
+{
+    if (!Ids || Count <= 0 || Options.MaxResults <= 0) return false;
+    for (int Index = 0; Index < Count; Index++)
+    {
+        if (Ids[Index] < 0 || Ids[Index] >= (int)MTemplates.size() || !MTemplates[Ids[Index]]) return false;
+    }
+    return GetScales(Options, MScales);
+}
+
+bool CTemplateMatcher::Match(const SImageView &Frame, const int *Ids, int Count, const SMatchOptions &Options,
+    std::vector<SMatch> &Out)
+{
+    Out.clear();
+    if (!Frame.IsValid() || (Frame.Format != EPixelFormat::BGRA8 && Frame.Format != EPixelFormat::Gray8)) return false;
+    if (!IsRequestValid(Ids, Count, Options)) return false;
+
+    const SPixelRect Clipped = ClipToFrame(Options.RoiX, Options.RoiY, Options.RoiWidth, Options.RoiHeight,
+        Frame.Width, Frame.Height);
+    if (Clipped.IsEmpty()) return true;
+
+    // Only the search area is converted and reduced, once for all templates
+    SImageView Area = Frame;
+    Area.Data = Frame.Row(Clipped.Top) + (size_t)Clipped.Left * GetBytesPerPixel(Frame.Format);
+    Area.Width = Clipped.GetWidth();
+    Area.Height = Clipped.GetHeight();
+    MPyramid.Build(Area, Options.PyramidLevels, Options.PyramidFilter);
+
+    SRegion Region;
+    Region.Right = Area.Width;
+    Region.Bottom = Area.Height;
+    Search(MPyramid, Clipped.Left, Clipped.Top, Region, Ids, Count, Options, Out);
+    return true;
+}
+
+bool CTemplateMatcher::Match(const CImagePyramid &Pyramid, const int *Ids, int Count, const SMatchOptions &Options,
+    std::vector<SMatch> &Out)
+{
+    Out.clear();
+    if (Pyramid.GetLevelCount() <= 0 || !IsRequestValid(Ids, Count, Options)) return false;
+
+    const SImageView Base = Pyramid.GetLevel(0);
+    const SPixelRect Clipped = ClipToFrame(Options.RoiX, Options.RoiY, Options.RoiWidth, Options.RoiHeight,
+        Base.Width, Base.Height);
+    if (Clipped.IsEmpty()) return true;
+
+    SRegion Region;
+    Region.Left = Clipped.Left;
+    Region.Top = Clipped.Top;
+    Region.Right = Clipped.Right;
+    Region.Bottom = Clipped.Bottom;
+
+    Search(Pyramid, 0, 0, Region, Ids, Count, Options, Out);
+    return true;
+}
+
+void CTemplateMatcher::Search(const CImagePyramid &Pyramid, int OriginX, int OriginY, const SRegion &Area, const int *Ids,
+    int Count, const SMatchOptions &Options, std::vector<SMatch> &Out)
+{
+    // A level's area holds the level pixels lying entirely inside the full-size area
+    const int MaxLevel = std::min(std::max(Options.PyramidLevels, 0), Pyramid.GetLevelCount() - 1);
+    MLevelRegions.resize((size_t)MaxLevel + 1);
+    for (int Level = 0; Level <= MaxLevel; Level++)
+    {
+        SRegion &Region = MLevelRegions[Level];
+        Region.Left = (Area.Left + (1 << Level) - 1) >> Level;
+        Region.Top = (Area.Top + (1 << Level) - 1) >> Level;
+        Region.Right = Area.Right >> Level;
+        Region.Bottom = Area.Bottom >> Level;
+    }
+
+    // One job per template and scale, starting at the coarsest level its template fits
+    MJobs.clear();
+    for (int Index = 0; Index < Count; Index++)
+    {
+        STemplateSource &Source = *MTemplates[Ids[Index]];
+        if ((int)Source.Variants.size() + (int)MScales.size() > MaxCachedVariants) Source.Variants.clear();
+
+        for (float Scale : MScales)
+        {
+            STemplateSource::SVariant *Variant = GetVariant(Source, Scale, Pyramid.GetFilter());
+            if (!Variant) continue;
+            ExtendVariant(*Variant, MaxLevel);
+
+            SSearchJob Job;
+            Job.Index = Index;
+            Job.Scale = Scale;
+            Job.StartLevel = -1;
+            for (int Level = 0; Level < (int)Variant->Levels.size() && Level <= MaxLevel; Level++)
+            {
+                const SPreparedTemplate &Template = *Variant->Levels[Level];
+                const SRegion &Region = MLevelRegions[Level];
+                if (Template.Width > Region.Right - Region.Left || Template.Height > Region.Bottom - Region.Top) break;
+                if (Level > 0 && Options.Method == EMatchMethod::Ncc && Template.Energy <= 0.0) break;
+                Job.Levels.push_back(&Template);
+                Job.StartLevel = Level;
+            }
+            if (Job.StartLevel >= 0) MJobs.push_back(std::move(Job));
+        }
+    }
+
+    for (int Level = MaxLevel; Level >= 0; Level--)
+    {
+        MLevel = Pyramid.GetLevel(Level);
+        MRegion = MLevelRegions[Level];
+        MPassOptions = GetLevelOptions(Options, Level);
+        MPassLevel = Level;
+
+        // Candidates from the level above move down to this one
+        MRefineTasks.clear();
+        for (SSearchJob &Job : MJobs)
+        {
+            if (Job.StartLevel <= Level) continue;
+            for (int Candidate = 0; Candidate < (int)Job.Candidates.size(); Candidate++) MRefineTasks.emplace_back(&Job, Candidate);
+        }
+        MPool->ParallelFor((int)MRefineTasks.size(), [this](int Task) { RefineCandidate(Task); });
+        for (SSearchJob &Job : MJobs)
+        {
+            if (Job.StartLevel <= Level) continue;
+            Job.Candidates.erase(std::remove_if(Job.Candidates.begin(), Job.Candidates.end(),
+                [](const SMatch &Candidate) { return Candidate.Template < 0; }), Job.Candidates.end());
+        }
+
+        // Full search for the jobs starting here
+        MPassJobs.clear();
+        for (SSearchJob &Job : MJobs)
+        {
+            if (Job.StartLevel == Level) MPassJobs.push_back(&Job);
+        }
+        if (MPassJobs.empty()) continue;
+
+        int MaxPositionRows = 0;
+        for (const SSearchJob *Job : MPassJobs)
+        {
+            MaxPositionRows = std::max(MaxPositionRows, MRegion.Bottom - MRegion.Top - Job->Levels[Level]->Height + 1);
+        }
+        const int BandCount = (MaxPositionRows + BandRows - 1) / BandRows;
+        const size_t JobCount = MPassJobs.size();
+
+        MBandResults.resize((size_t)BandCount * JobCount);
+        for (std::vector<SMatch> &Results : MBandResults) Results.clear();
+        MPool->ParallelFor(BandCount, [this](int Band) { SearchBand(Band); });
+
+        // Bands merge in order, so ties and suppression resolve the same way on every run
+        for (size_t Index = 0; Index < JobCount; Index++)
+        {
+            SSearchJob &Job = *MPassJobs[Index];
+            const SPreparedTemplate &Template = *Job.Levels[Level];
+            const int Radius = GetSuppressRadius(MPassOptions, Template.Width, Template.Height);
+            for (int Band = 0; Band < BandCount; Band++)
+            {
+                for (const SMatch &Match : MBandResults[(size_t)Band * JobCount + Index])
+                {
+                    InsertMatch(Job.Candidates, Match, Options.Method, MPassOptions.MaxResults, Radius);
+                }
+            }
+            for (SMatch &Candidate : Job.Candidates)
+            {
+                Candidate.X += MRegion.Left;
+                Candidate.Y += MRegion.Top;
+            }
+        }
+    }
+
+    // Scales of a template compete for its result slots
+    std::vector<SMatch> Merged;
+    for (int Index = 0; Index < Count; Index++)
+    {
+        const STemplateSource &Source = *MTemplates[Ids[Index]];
+        const int Radius = GetSuppressRadius(Options, Source.Width, Source.Height);
+
+        Merged.clear();
+        for (const SSearchJob &Job : MJobs)
+        {
+            if (Job.Index != Index) continue;
+            for (SMatch Match : Job.Candidates)
+            {
+                Match.Template = Ids[Index];
+                Match.X += OriginX;
+                Match.Y += OriginY;
+                Match.Scale = Job.Scale;
+                InsertMatch(Merged, Match, Options.Method, Options.MaxResults, Radius);
+            }
+        }
+        Out.insert(Out.end(), Merged.begin(), Merged.end());
+    }
+}
+
+void CTemplateMatcher::SearchBand(int Band)
+{
+    const SMatchOptions &Options = MPassOptions;
+    const size_t JobCount = MPassJobs.size();
+    const int Width = MRegion.Right - MRegion.Left;
+    const int Height = MRegion.Bottom - MRegion.Top;
+    const int Stride = MLevel.Stride;
+
+    // Column sums of the image under the template, slid down one row at a time
+    std::vector<uint32_t> ColumnSums;
+    std::vector<uint32_t> ColumnSquares;
+
+    for (size_t Index = 0; Index < JobCount; Index++)
+    {
+        const SPreparedTemplate &Template = *MPassJobs[Index]->Levels[MPassLevel];
+        std::vector<SMatch> &Results = MBandResults[(size_t)Band * JobCount + Index];
+        const int Radius = GetSuppressRadius(Options, Template.Width, Template.Height);
+
+        const int Positions = Width - Template.Width + 1;
+        const int FirstRow = Band * BandRows;
+        const int LastRow = std::min(FirstRow + BandRows, Height - Template.Height + 1);
+        if (Positions <= 0 || FirstRow >= LastRow) continue;
+        if (Options.Method == EMatchMethod::Ncc && Template.Energy <= 0.0) continue;
+
+        const bool UseColumnSums = Options.Method == EMatchMethod::Ncc && !Template.HasMask;
+        if (UseColumnSums)
+        {
+            ColumnSums.assign((size_t)Width, 0);
+            ColumnSquares.assign((size_t)Width, 0);
+            for (int Y = FirstRow; Y < FirstRow + Template.Height; Y++)
+            {
+                const uint8_t *Row = MLevel.Row(MRegion.Top + Y) + MRegion.Left;
+                for (int X = 0; X < Width; X++)
+                {
+                    ColumnSums[X] += Row[X];
+                    ColumnSquares[X] += (uint32_t)Row[X] * Row[X];
+                }
+            }
+        }
+
+        for (int Y = FirstRow; Y < LastRow; Y++)
+        {
+            const uint8_t *Image = MLevel.Row(MRegion.Top + Y) + MRegion.Left;
+            switch (Options.Method)
+            {
+                case EMatchMethod::Sad:
+                    ScanDifferenceRow<true>(Image, Stride, Y, Positions, Template, Options, Radius, Results);
+                    break;
+                case EMatchMethod::Ssd:
+                    ScanDifferenceRow<false>(Image, Stride, Y, Positions, Template, Options, Radius, Results);
+                    break;
+                case EMatchMethod::Ncc:
+                    if (UseColumnSums)
+                    {
+                        ScanCorrelationRow(Image, Stride, Y, Positions, Template, ColumnSums.data(),
+                            ColumnSquares.data(), Options, Radius, Results);
+                    }
+                    else
+                    {
+                        ScanMaskedCorrelationRow(Image, Stride, Y, Positions, Template, Options, Radius, Results);
+                    }
+                    break;
+            }
+
+            if (UseColumnSums && Y + 1 < LastRow)
+            {
+                const uint8_t *Entering = Image + (size_t)Template.Height * Stride;
+                for (int X = 0; X < Width; X++)
+                {
+                    ColumnSums[X] += (uint32_t)Entering[X] - Image[X];
+                    ColumnSquares[X] += (uint32_t)Entering[X] * Entering[X] - (uint32_t)Image[X] * Image[X];
+                }
+            }
+        }
+    }
+}
+
+// Moves one candidate down a level: the best position within RefineRadius of twice its
+// coordinates. A candidate with no position passing the options is marked with Template -1.
+void CTemplateMatcher::RefineCandidate(int Task)
+{
+    SSearchJob &Job = *MRefineTasks[Task].first;
+    SMatch &Candidate = Job.Candidates[MRefineTasks[Task].second];
+    const SPreparedTemplate &Template = *Job.Levels[MPassLevel];
+
+    SMatchOptions Options = MPassOptions;
+    Options.MaxResults = 1;
+
+    const int Left = std::max(2 * Candidate.X - RefineRadius, MRegion.Left);
+    const int Top = std::max(2 * Candidate.Y - RefineRadius, MRegion.Top);
+    const int Right = std::min(2 * Candidate.X + RefineRadius, MRegion.Right - Template.Width);
+    const int Bottom = std::min(2 * Candidate.Y + RefineRadius, MRegion.Bottom - Template.Height);
+    Candidate.Template = -1;
+    if (Left > Right || Top > Bottom) return;
+    if (Options.Method == EMatchMethod::Ncc && Template.Energy <= 0.0) return;
+
+    std::vector<SMatch> Best;
+    for (int Y = Top; Y <= Bottom; Y++)
+    {
+        const uint8_t *Image = MLevel.Row(Y) + Left;
+        switch (Options.Method)
+        {
+            case EMatchMethod::Sad:
+                ScanDifferenceRow<true>(Image, MLevel.Stride, Y, Right - Left + 1, Template, Options, 0, Best);
+                break;
+            case EMatchMethod::Ssd:
+                ScanDifferenceRow<false>(Image, MLevel.Stride, Y, Right - Left + 1, Template, Options, 0, Best);
+                break;
+            case EMatchMethod::Ncc:
+                ScanMaskedCorrelationRow(Image, MLevel.Stride, Y, Right - Left + 1, Template, Options, 0, Best);
+                break;
+        }
+    }
+    if (Best.empty()) return;
+
+    Candidate = Best.front();
+    Candidate.X += Left;
+}
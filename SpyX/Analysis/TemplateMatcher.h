@@ -0,0 +1,132 @@
+#ifndef TAPI_TEMPLATE_MATCHER_H
+#define TAPI_TEMPLATE_MATCHER_H
+
+#include "Core/ThreadPool.h"
+#include "Imaging/ImagePyramid.h"
+#include "Imaging/ImageView.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Finds templates (icons, sprites) in BGRA8 or Gray8 frames. Matching runs on luma: the
+// searched part of the frame is converted once per call and shared by every template. A
+// BGRA8 template can take a mask from its alpha, so only its opaque pixels are compared.
+// Positions are scanned in row bands spread over a thread pool, and a position is dropped
+// as soon as its partial score can no longer beat the threshold or the results kept so far.
+//
+// With PyramidLevels the frame and the templates are halved that many times, the coarsest
+// level is searched in full and its best candidates are refined level by level within a
+// few pixels. Templates can also be tried at several scales for UI scaling and DPI changes.
+
+enum class EMatchMethod : int
+{
+    Sad = 0,    // Mean absolute difference, 0-255, lower is better
+    Ssd = 1,    // Mean squared difference, 0-65025, lower is better
+    Ncc = 2     // Normalized cross-correlation, -1 to 1, higher is better
+};
+
+static const int MaxTemplateSize = 1024;
+
+struct SMatchOptions
+{
+    EMatchMethod Method = EMatchMethod::Ncc;
+    float MaxDifference = 65025.0f;     // Sad and Ssd: worst score accepted
+    float MinCorrelation = 0.8f;        // Ncc: worst score accepted
+    int MaxResults = 1;                 // Per template
+    int SuppressRadius = -1;            // Results this close to a better one are dropped, -1 = half the template
+    int RoiX = 0;                       // Search area, templates must fit inside it
+    int RoiY = 0;
+    int RoiWidth = 0;                   // 0 = to the frame edge
+    int RoiHeight = 0;
+
+    int PyramidLevels = 0;              // Halvings before the full search, 0 = full resolution only
+    EPyramidFilter PyramidFilter = EPyramidFilter::Box;
+    int CoarseCandidates = 16;          // Per template and scale, kept at the coarsest level and refined
+    float MinScale = 1.0f;              // Template scales tried, MinScale times powers of ScaleStep up to MaxScale
+    float MaxScale = 1.0f;
+    float ScaleStep = 1.1f;
+};
+
+struct SMatch
+{
+    int Template = 0;                   // Template id
+    int X = 0;                          // Top-left corner in frame coordinates
+    int Y = 0;
+    float Score = 0.0f;
+    float Scale = 1.0f;                 // Template scale that matched
+};
+
+struct SPreparedTemplate;
+struct STemplateSource;
+
+class CTemplateMatcher
+{
+public:
+    // ThreadCount includes the calling thread; 0 uses the hardware concurrency
+    explicit CTemplateMatcher(int ThreadCount = 0);
+    ~CTemplateMatcher();
+
+    // Returns the template id, or -1 if the image is not BGRA8/Gray8, is larger than
+    // MaxTemplateSize or is fully transparent. Ncc never matches a flat template.
+    int AddTemplate(const SImageView &Image, bool UseAlphaMask);
+    bool RemoveTemplate(int Id);
+    void ClearTemplates();
+    bool GetTemplateSize(int Id, int &Width, int &Height) const;
+
+    // Searches Count templates. Out receives each template's results in call order, best
+    // first. Results do not depend on the thread count. Fails on an unknown id.
+    bool Match(const SImageView &Frame, const int *Ids, int Count, const SMatchOptions &Options,
+        std::vector<SMatch> &Out);
+
+    // Same on a pyramid the caller built, so several searches on one frame share its levels.
+    // Templates are reduced with the pyramid's filter, and a search starts no coarser than
+    // its last level whatever Options.PyramidLevels asks for.
+    bool Match(const CImagePyramid &Pyramid, const int *Ids, int Count, const SMatchOptions &Options,
+        std::vector<SMatch> &Out);
+
+private:
+    // One template at one scale, searched from StartLevel down to level 0
+    struct SSearchJob
+    {
+        int Index = 0;                  // Position in the caller's id list
+        float Scale = 1.0f;
+        std::vector<const SPreparedTemplate *> Levels;
+        int StartLevel = 0;
+        std::vector<SMatch> Candidates; // Level coordinates relative to the pyramid
+    };
+
+    // Search area of a pyramid level, in that level's pixels
+    struct SRegion
+    {
+        int Left = 0;
+        int Top = 0;
+        int Right = 0;
+        int Bottom = 0;
+    };
+
+    // Checks the ids and fills MScales
+    bool IsRequestValid(const int *Ids, int Count, const SMatchOptions &Options);
+    void Search(const CImagePyramid &Pyramid, int OriginX, int OriginY, const SRegion &Area, const int *Ids,
+        int Count, const SMatchOptions &Options, std::vector<SMatch> &Out);
+    void SearchBand(int Band);
+    void RefineCandidate(int Task);
+
+    std::unique_ptr<CThreadPool> MPool;
+    std::vector<std::unique_ptr<STemplateSource>> MTemplates;  // Indexed by id, null once removed
+    CImagePyramid MPyramid;             // Search area of the frame for Match(Frame, ...)
+
+    // State of the search pass in progress, read by the workers
+    std::vector<float> MScales;
+    SImageView MLevel;
+    SRegion MRegion;
+    SMatchOptions MPassOptions;
+    int MPassLevel = 0;
+    std::vector<SSearchJob> MJobs;
+    std::vector<SSearchJob *> MPassJobs;
+    std::vector<std::vector<SMatch>> MBandResults;  // Band * MPassJobs.size() + job
+    std::vector<SRegion> MLevelRegions;
+    std::vector<std::pair<SSearchJob *, int>> MRefineTasks;
+};
+
+#endif
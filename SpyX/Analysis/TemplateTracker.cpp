@@ -0,0 +1,135 @@
+#include "TemplateTracker.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+
+CTemplateTracker::CTemplateTracker(CTemplateMatcher &Matcher) : MMatcher(Matcher)
+{
+}
+
+int CTemplateTracker::CreateHandle(int TemplateId, const STrackOptions &Options)
+{
+    int Width = 0;
+    int Height = 0;
+    if (!MMatcher.GetTemplateSize(TemplateId, Width, Height)) return -1;
+    if (Options.SearchRadius < 0 || Options.MaxRadius < Options.SearchRadius) return -1;
+
+    const SMatchOptions &Match = Options.Match;
+    if (!(Match.MinScale > 0.0f) || !(Match.MaxScale >= Match.MinScale)) return -1;
+    if (Match.MaxScale > Match.MinScale && !(Match.ScaleStep > 1.0f)) return -1;
+
+    std::unique_ptr<SHandle> Handle = std::make_unique<SHandle>();
+    Handle->Template = TemplateId;
+    Handle->Options = Options;
+    Handle->Options.Match.MaxResults = 1;
+
+    for (size_t Id = 0; Id < MHandles.size(); Id++)
+    {
+        if (!MHandles[Id])
+        {
+            MHandles[Id] = std::move(Handle);
+            return (int)Id;
+        }
+    }
+    MHandles.push_back(std::move(Handle));
+    return (int)MHandles.size() - 1;
+}
+
+bool CTemplateTracker::DestroyHandle(int Handle)
+{
+    if (Handle < 0 || Handle >= (int)MHandles.size() || !MHandles[Handle]) return false;
+    MHandles[Handle].reset();
+    return true;
+}
+
+void CTemplateTracker::Clear()
+{
+    MHandles.clear();
+}
+
+bool CTemplateTracker::ResetHandle(int Handle)
+{
+    if (Handle < 0 || Handle >= (int)MHandles.size() || !MHandles[Handle]) return false;
+    MHandles[Handle]->HasLast = false;
+    MHandles[Handle]->Stats = STrackStats();
+    return true;
+}
+
+bool CTemplateTracker::Track(int Handle, const SImageView &Frame, SMatch &Out, bool &Found)
+{
+    Found = false;
+    if (Handle < 0 || Handle >= (int)MHandles.size() || !MHandles[Handle]) return false;
+    SHandle &Track = *MHandles[Handle];
+
+    int Width = 0;
+    int Height = 0;
+    if (!MMatcher.GetTemplateSize(Track.Template, Width, Height)) return false;
+    Track.Stats.Searches++;
+
+    if (Track.HasLast)
+    {
+        // Windows are small, so they are searched at full resolution and at the last scale only
+        SMatchOptions Window = Track.Options.Match;
+        Window.PyramidLevels = 0;
+        Window.MinScale = Track.Last.Scale;
+        Window.MaxScale = Track.Last.Scale;
+        const int MatchWidth = Track.Last.Scale == 1.0f ? Width : (int)std::lround(Width * (double)Track.Last.Scale);
+        const int MatchHeight = Track.Last.Scale == 1.0f ? Height : (int)std::lround(Height * (double)Track.Last.Scale);
+
+        int Radius = Track.Options.SearchRadius;
+        while (true)
+        {
+            // Kept inside the handle's own search area. Edges are 64-bit, since radii and the
+            // caller's area can reach past INT_MAX.
+            const SMatchOptions &Area = Track.Options.Match;
+            const int64_t Left = std::max<int64_t>((int64_t)Track.Last.X - Radius, Area.RoiX);
+            const int64_t Top = std::max<int64_t>((int64_t)Track.Last.Y - Radius, Area.RoiY);
+            int64_t Right = (int64_t)Track.Last.X + MatchWidth + Radius;
+            int64_t Bottom = (int64_t)Track.Last.Y + MatchHeight + Radius;
+            if (Area.RoiWidth > 0) Right = std::min<int64_t>(Right, (int64_t)Area.RoiX + Area.RoiWidth);
+            if (Area.RoiHeight > 0) Bottom = std::min<int64_t>(Bottom, (int64_t)Area.RoiY + Area.RoiHeight);
+            Window.RoiX = (int)Left;
+            Window.RoiY = (int)Top;
+            Window.RoiWidth = (int)std::min<int64_t>(std::max<int64_t>(Right - Left, 1), INT_MAX);
+            Window.RoiHeight = (int)std::min<int64_t>(std::max<int64_t>(Bottom - Top, 1), INT_MAX);
+            if (!MMatcher.Match(Frame, &Track.Template, 1, Window, MResults)) return false;
+            if (!MResults.empty())
+            {
+                if (Radius == Track.Options.SearchRadius) Track.Stats.WindowHits++;
+                else Track.Stats.GrownHits++;
+                Track.Last = MResults.front();
+                Out = Track.Last;
+                Found = true;
+                return true;
+            }
+
+            if (Radius >= Track.Options.MaxRadius) break;
+            Radius = std::min(std::max(Radius * 2, 1), Track.Options.MaxRadius);
+        }
+    }
+
+    Track.Stats.FullSearches++;
+    if (!MMatcher.Match(Frame, &Track.Template, 1, Track.Options.Match, MResults)) return false;
+    if (MResults.empty())
+    {
+        Track.Stats.Misses++;
+        Track.HasLast = false;
+        return true;
+    }
+
+    Track.Stats.FullHits++;
+    Track.HasLast = true;
+    Track.Last = MResults.front();
+    Out = Track.Last;
+    Found = true;
+    return true;
+}
+
+bool CTemplateTracker::GetStats(int Handle, STrackStats &Out) const
+{
+    if (Handle < 0 || Handle >= (int)MHandles.size() || !MHandles[Handle]) return false;
+    Out = MHandles[Handle]->Stats;
+    return true;
+}
@@ -0,0 +1,66 @@
+#ifndef TAPI_TEMPLATE_TRACKER_H
+#define TAPI_TEMPLATE_TRACKER_H
+
+#include "Analysis/TemplateMatcher.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Follows templates from frame to frame. A tracker handle remembers its last match and first
+// searches a window around it at the scale it matched, doubling the window while nothing
+// passes the thresholds. Only then does it fall back to a full search with the handle's
+// options. On a steady UI most searches cover a few hundred positions instead of the frame.
+
+struct STrackOptions
+{
+    SMatchOptions Match;                // Full search and thresholds; one result is kept
+    int SearchRadius = 16;              // First window: pixels around the last match
+    int MaxRadius = 128;                // Largest window tried before the full search
+};
+
+struct STrackStats
+{
+    uint64_t Searches = 0;
+    uint64_t WindowHits = 0;            // Found in the first window
+    uint64_t GrownHits = 0;             // Found in a larger window
+    uint64_t FullSearches = 0;          // Frame searched in full: no last match, or the windows failed
+    uint64_t FullHits = 0;
+    uint64_t Misses = 0;                // Not found anywhere
+};
+
+class CTemplateTracker
+{
+public:
+    // Matcher holds the templates and must outlive the tracker
+    explicit CTemplateTracker(CTemplateMatcher &Matcher);
+
+    // Returns the handle, or -1 if the template is unknown or the options are invalid
+    int CreateHandle(int TemplateId, const STrackOptions &Options);
+    bool DestroyHandle(int Handle);
+    void Clear();
+
+    // Forgets the last match and zeroes the statistics
+    bool ResetHandle(int Handle);
+
+    // Searches Frame for the handle's template. Found tells whether Out holds a match. Fails
+    // on an unknown handle, or if its template was removed from the matcher.
+    bool Track(int Handle, const SImageView &Frame, SMatch &Out, bool &Found);
+    bool GetStats(int Handle, STrackStats &Out) const;
+
+private:
+    struct SHandle
+    {
+        int Template = 0;
+        STrackOptions Options;
+        bool HasLast = false;
+        SMatch Last;
+        STrackStats Stats;
+    };
+
+    CTemplateMatcher &MMatcher;
+    std::vector<std::unique_ptr<SHandle>> MHandles;     // Null once destroyed
+    std::vector<SMatch> MResults;
+};
+
+#endif
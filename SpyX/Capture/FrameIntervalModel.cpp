@@ -0,0 +1,107 @@
+#include "FrameIntervalModel.h"
+
+#include <algorithm>
+#include <cmath>
+
+void CFrameIntervalModel::Reset()
+{
+    *this = CFrameIntervalModel();
+}
+
+bool CFrameIntervalModel::IsIdleGap(double Interval) const
+{
+    // A window that stops redrawing produces one long gap; folding it into the
+    // averages would inflate every later deadline.
+    return Interval > std::max(4.0 * MMeanInterval, MMeanInterval + 8.0 * MJitter);
+}
+
+void CFrameIntervalModel::AddArrival(int64_t ArrivalTime)
+{
+    if (MLastArrival == 0 || ArrivalTime <= MLastArrival)
+    {
+        if (ArrivalTime > MLastArrival) MLastArrival = ArrivalTime;
+        return;
+    }
+
+    double Interval = (double)(ArrivalTime - MLastArrival);
+    MLastArrival = ArrivalTime;
+
+    if (MSamples == 0)
+    {
+        MMeanInterval = Interval;
+        MJitter = Interval / 2.0;
+        MSamples = 1;
+        return;
+    }
+
+    if (IsIdleGap(Interval))
+    {
+        AddIdleGap(Interval);
+        return;
+    }
+    MIdleStreak = 0;
+
+    double Error = Interval - MMeanInterval;
+    MMeanInterval += Error * MeanGain;
+    MJitter += (std::fabs(Error) - MJitter) * JitterGain;
+    MSamples++;
+}
+
+void CFrameIntervalModel::AddIdleGap(double Interval)
+{
+    MIdleInterval = MIdleInterval == 0.0 ? Interval : MIdleInterval + (Interval - MIdleInterval) * MeanGain;
+
+    bool Agrees = MIdleStreak > 0 && std::fabs(Interval - MLastIdleGap) <= MLastIdleGap / 4.0;
+    MIdleStreak = Agrees ? MIdleStreak + 1 : 1;
+    MIdleStreakSum = Agrees ? MIdleStreakSum + Interval : Interval;
+    MLastIdleGap = Interval;
+
+    // Repeated gaps of one length mean the cadence itself changed (e.g. 144 Hz -> 30 Hz).
+    // Input-driven gaps vary too much to get here, and a slow blink is not worth waiting for.
+    double Cadence = MIdleStreakSum / MIdleStreak;
+    if (MIdleStreak >= IdleStreakLimit && Cadence <= MaxCadenceInterval)
+    {
+        MMeanInterval = Cadence;
+        MJitter = Cadence / 4.0;    // Settles within a few frames
+        MSamples++;
+        MIdleStreak = 0;
+    }
+}
+
+int64_t CFrameIntervalModel::GetDeadline() const
+{
+    if (!HasEstimate()) return 0;
+    return MLastArrival + (int64_t)(MMeanInterval + JitterMultiplier * MJitter) + Slack;
+}
+
+int64_t CFrameIntervalModel::ComputeWaitTime(EFrameWaitMode Mode, int64_t Now, int64_t Budget, int64_t MaxWait) const
+{
+    if (Mode == EFrameWaitMode::LatestNow) return 0;
+
+    int64_t Limit = MaxWait;
+    if (Mode == EFrameWaitMode::WithinBudget) Limit = std::min(Limit, std::max<int64_t>(Budget, 0));
+
+    if (!HasEstimate()) return std::min(DefaultWait, Limit);
+
+    int64_t Deadline = GetDeadline();
+    int64_t Wait = 0;
+
+    if (Now <= Deadline)
+    {
+        if (Mode == EFrameWaitMode::WithinBudget)
+        {
+            // Not worth waiting if even an on-time frame lands after the budget
+            int64_t Expected = MLastArrival + (int64_t)MMeanInterval;
+            if (Expected - Now > Limit) return 0;
+        }
+        Wait = Deadline - Now;
+    }
+    else if (Mode == EFrameWaitMode::NextFrame)
+    {
+        // The window looks idle. Give it one frame period to respond (e.g. to input)
+        // rather than the full legacy timeout.
+        Wait = (int64_t)(MMeanInterval + JitterMultiplier * MJitter) + Slack;
+    }
+
+    return std::clamp<int64_t>(Wait, 0, Limit);
+}
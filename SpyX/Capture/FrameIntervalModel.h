@@ -0,0 +1,61 @@
+#ifndef TAPI_FRAME_INTERVAL_MODEL_H
+#define TAPI_FRAME_INTERVAL_MODEL_H
+
+#include <cstdint>
+
+enum class EFrameWaitMode : int
+{
+    NextFrame = 0,      // Wait for a frame newer than the last one delivered, if one is expected
+    LatestNow = 1,      // Never wait, return the latest frame
+    WithinBudget = 2    // Wait only if the next frame is expected within the budget
+};
+
+// Running model of frame arrival intervals. The mean interval and its jitter (mean
+// absolute deviation) are tracked as exponentially weighted moving averages, the same
+// way TCP estimates round-trip time. All times are in 100 ns units.
+//
+// Gaps far longer than the cadence (a window that only redraws on input) are averaged
+// separately, so the deadline keeps following the redraw cadence. Idle gaps only replace
+// the cadence when several in a row agree with each other and are short enough to be one.
+class CFrameIntervalModel
+{
+public:
+    static constexpr int64_t DefaultWait = 50 * 10000;  // Used until enough frames were seen
+
+    void Reset();
+    void AddArrival(int64_t ArrivalTime);
+
+    bool HasEstimate() const { return MSamples > 0; }
+    double GetMeanInterval() const { return MMeanInterval; }
+    double GetJitter() const { return MJitter; }
+    double GetIdleInterval() const { return MIdleInterval; }  // 0 until an idle gap was seen
+    int64_t GetLastArrival() const { return MLastArrival; }
+
+    // Time after which the next frame is considered late, or 0 without an estimate
+    int64_t GetDeadline() const;
+
+    // How long a caller should wait, starting at Now, before settling for the latest frame
+    int64_t ComputeWaitTime(EFrameWaitMode Mode, int64_t Now, int64_t Budget, int64_t MaxWait) const;
+
+private:
+    static constexpr double MeanGain = 1.0 / 8.0;
+    static constexpr double JitterGain = 1.0 / 4.0;
+    static constexpr double JitterMultiplier = 4.0;
+    static constexpr int64_t Slack = 10000;  // 1 ms scheduling slack on top of the deadline
+    static constexpr int IdleStreakLimit = 3;
+    static constexpr double MaxCadenceInterval = 250 * 10000.0;  // Steady gaps longer than this stay idle
+
+    bool IsIdleGap(double Interval) const;
+    void AddIdleGap(double Interval);
+
+    int64_t MLastArrival = 0;
+    double MMeanInterval = 0.0;
+    double MJitter = 0.0;
+    uint64_t MSamples = 0;
+    double MIdleInterval = 0.0;
+    double MLastIdleGap = 0.0;
+    double MIdleStreakSum = 0.0;
+    int MIdleStreak = 0;    // Consecutive idle gaps within 25% of the one before
+};
+
+#endif
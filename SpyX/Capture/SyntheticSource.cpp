@@ -0,0 +1,41 @@
+#include "SyntheticSource.h"
+
+CSyntheticSource::CSyntheticSource(int Width, int Height, int64_t FrameInterval)
+    : MWidth(Width > 0 ? Width : 1), MHeight(Height > 0 ? Height : 1),
+      MFrameInterval(FrameInterval > 0 ? FrameInterval : 1)
+{
+    MPixels.resize((size_t)MWidth * MHeight);
+}
+
+uint32_t CSyntheticSource::GetPixel(int X, int Y, uint64_t FrameIndex)
+{
+    // Diagonal gradient scrolling one pixel per frame, with a checker in red so rows
+    // and columns are distinguishable after cropping
+    uint32_t Frame = (uint32_t)FrameIndex;
+    uint32_t Blue = (uint32_t)(X + Frame) & 0xFF;
+    uint32_t Green = (uint32_t)(Y + 2 * Frame) & 0xFF;
+    uint32_t Red = (((X >> 3) ^ (Y >> 3)) & 1) ? 0xE0 : 0x20;
+    return Blue | (Green << 8) | (Red << 16) | 0xFF000000u;
+}
+
+bool CSyntheticSource::ReadFrame(SImageView &OutFrame, int64_t *OutTimestamp)
+{
+    for (int Y = 0; Y < MHeight; Y++)
+    {
+        uint32_t *Row = MPixels.data() + (size_t)Y * MWidth;
+        for (int X = 0; X < MWidth; X++)
+        {
+            Row[X] = GetPixel(X, Y, MFrameIndex);
+        }
+    }
+
+    OutFrame.Data = reinterpret_cast<const uint8_t *>(MPixels.data());
+    OutFrame.Width = MWidth;
+    OutFrame.Height = MHeight;
+    OutFrame.Stride = MWidth * 4;
+    OutFrame.Format = EPixelFormat::BGRA8;
+
+    if (OutTimestamp) *OutTimestamp = (int64_t)MFrameIndex * MFrameInterval;
+    MFrameIndex++;
+    return true;
+}
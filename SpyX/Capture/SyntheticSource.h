@@ -0,0 +1,38 @@
+#ifndef TAPI_SYNTHETIC_SOURCE_H
+#define TAPI_SYNTHETIC_SOURCE_H
+
+#include "Imaging/ImageView.h"
+
+#include <cstdint>
+#include <vector>
+
+// Deterministic BGRA8 frame generator with no capture dependencies, for exercising the
+// frame pipeline on machines without WGC. Every pixel is a pure function of its position
+// and the frame index (see GetPixel), so consumers can verify what they received.
+class CSyntheticSource
+{
+public:
+    // FrameInterval is in 100 ns units; the default is 60 fps
+    CSyntheticSource(int Width, int Height, int64_t FrameInterval = 166667);
+
+    int GetWidth() const { return MWidth; }
+    int GetHeight() const { return MHeight; }
+    uint64_t GetPosition() const { return MFrameIndex; }  // Index of the frame ReadFrame returns next
+
+    void SeekToFrame(uint64_t Index) { MFrameIndex = Index; }
+
+    // Renders the next frame and advances. The view stays valid until the next call.
+    bool ReadFrame(SImageView &OutFrame, int64_t *OutTimestamp = nullptr);
+
+    // BGRA value of pixel (X, Y) in frame FrameIndex, packed as in memory (B in the low byte)
+    static uint32_t GetPixel(int X, int Y, uint64_t FrameIndex);
+
+private:
+    int MWidth;
+    int MHeight;
+    int64_t MFrameInterval;
+    uint64_t MFrameIndex = 0;
+    std::vector<uint32_t> MPixels;
+};
+
+#endif
@@ -30,8 +30,11 @@ struct CWindowCapture::SImplementation
     WGC::GraphicsCaptureSession MSession{ nullptr };
     WDT::IDirect3DDevice MDevice{ nullptr };
     WG::SizeInt32 MLastSize{ 0, 0 };
+    winrt::com_ptr<IGraphicsCaptureItemInterop> MInteropFactory;
 
-    HRESULT CreateCaptureItem(HWND HWnd);
+    WDX::DirectXPixelFormat GetPixelFormat() const;
+    HRESULT CreateCaptureItem(HWND HWnd, WGC::GraphicsCaptureItem &OutItem);
+    void StartSession();
     void OnFrameArrived(WGC::Direct3D11CaptureFramePool const &Sender, WF::IInspectable const &Args);
 };
 
@@ -60,15 +63,67 @@ CWindowCapture::~CWindowCapture()
 }
 
 
+HRESULT CWindowCapture::PrewarmActivationFactories()
+{
+    // Use the calling thread's apartment if it has one, otherwise join the MTA for the lookup
+    bool OwnsApartment = false;
+    try
+    {
+        winrt::init_apartment(winrt::apartment_type::multi_threaded);
+        OwnsApartment = true;
+    }
+    catch (...) {}
+
+    HRESULT HResult = S_OK;
+    try
+    {
+        // The factory is agile, so C++/WinRT keeps it in its process-wide cache
+        auto ActivationFactory = winrt::get_activation_factory<WGC::GraphicsCaptureItem>();
+        if (!ActivationFactory.try_as<IGraphicsCaptureItemInterop>()) HResult = E_NOINTERFACE;
+    }
+    catch (winrt::hresult_error const &Error) { HResult = Error.code(); }
+    catch (...) { HResult = E_FAIL; }
+
+    if (OwnsApartment) winrt::uninit_apartment();
+    return HResult;
+}
+
 void CWindowCapture::Initialize(CD3D11Context *Context) { MContext = Context; }
 void CWindowCapture::SetCallback(FFrameDelegate Callback) { MFrameCallback = Callback; }
 
+HRESULT CWindowCapture::SetCaptureFormat(DXGI_FORMAT Format)
+{
+    if (Format != DXGI_FORMAT_B8G8R8A8_UNORM && Format != DXGI_FORMAT_R16G16B16A16_FLOAT) return E_INVALIDARG;
+    if (Format == MCaptureFormat) return S_OK;
+
+    MCaptureFormat = Format;
+
+    if (MImplementation->MFramePool)
+    {
+        try
+        {
+            MImplementation->MFramePool.Recreate(
+                MImplementation->MDevice,
+                MImplementation->GetPixelFormat(),
+                2,
+                MImplementation->MLastSize
+            );
+        }
+        catch (...) { return E_FAIL; }
+
+        // Frames still held were produced in the old format
+        std::lock_guard<std::mutex> Lock(MMutex);
+        if (MLatestFrame) { MLatestFrame->Release(); MLatestFrame = nullptr; }
+    }
+    return S_OK;
+}
+
 bool CWindowCapture::IsCapturing() const
 {
     return MIsCapturing;
 }
 
-HRESULT CWindowCapture::AcquireLatestFrame(ID3D11Texture2D **OutTexture)
+HRESULT CWindowCapture::AcquireLatestFrame(ID3D11Texture2D **OutTexture, SFrameStamp *OutStamp)
 {
     if (!OutTexture) return E_INVALIDARG;
     *OutTexture = nullptr;
@@ -79,12 +134,13 @@ HRESULT CWindowCapture::AcquireLatestFrame(ID3D11Texture2D **OutTexture)
     {
         MLatestFrame->AddRef();
         *OutTexture = MLatestFrame;
+        if (OutStamp) *OutStamp = MLatestStamp;
         return S_OK;
     }
     return S_FALSE;
 }
 
-void CWindowCapture::OnFrameReceived(ID3D11Texture2D *Texture)
+void CWindowCapture::OnFrameReceived(ID3D11Texture2D *Texture, int64_t PresentationTime)
 {
     {
         std::lock_guard<std::mutex> Lock(MMutex);
@@ -92,6 +148,10 @@ void CWindowCapture::OnFrameReceived(ID3D11Texture2D *Texture)
         MLatestFrame = Texture;
         MLatestFrame->AddRef();
         MFrameCount++;  // Increment frame counter
+        MLatestStamp.Sequence = MFrameCount.load();
+        MLatestStamp.PresentationTime = PresentationTime;
+        MLatestStamp.Generation = MGeneration.load();
+        MIntervalModel.AddArrival(PresentationTime);
     }
 
     if (MFrameCallback.IsBound())
@@ -100,33 +160,52 @@ void CWindowCapture::OnFrameReceived(ID3D11Texture2D *Texture)
     }
 }
 
-HRESULT CWindowCapture::WaitForNewFrame(ID3D11Texture2D **OutTexture, int timeoutMs)
+HRESULT CWindowCapture::WaitForNewFrame(ID3D11Texture2D **OutTexture, int timeoutMs, SFrameStamp *OutStamp)
+{
+    return WaitForFrameAfter(MFrameCount.load(), timeoutMs, OutTexture, OutStamp);
+}
+
+HRESULT CWindowCapture::WaitForFrameAfter(uint64_t Sequence, int TimeoutMs, ID3D11Texture2D **OutTexture, SFrameStamp *OutStamp)
 {
     if (!OutTexture) return E_INVALIDARG;
     *OutTexture = nullptr;
     
     if (!MIsCapturing) return E_FAIL;
     
-    uint64_t startFrame = MFrameCount.load();
-    auto startTime = std::chrono::steady_clock::now();
+    auto Deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(TimeoutMs);
     
-    while (true) {
-        // Check if new frame arrived
-        if (MFrameCount.load() > startFrame) {
-            return AcquireLatestFrame(OutTexture);
-        }
+    while (MFrameCount.load() <= Sequence) {
+        auto Remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            Deadline - std::chrono::steady_clock::now()).count();
+        if (Remaining <= 0) break;
         
-        // Check timeout
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::steady_clock::now() - startTime).count();
-        if (elapsed >= timeoutMs) {
-            // Timeout - return whatever we have (even if old)
-            return AcquireLatestFrame(OutTexture);
-        }
+        // FrameArrived is dispatched through this thread's queue, so sleeping here would
+        // block the very frame we are waiting for. Wake on messages instead.
+        MsgWaitForMultipleObjects(0, nullptr, FALSE, (DWORD)Remaining, QS_ALLINPUT);
         
-        // Small sleep to not burn CPU
-        Sleep(1);
+        MSG Message;
+        bool QuitReceived = false;
+        while (PeekMessage(&Message, nullptr, 0, 0, PM_REMOVE)) {
+            if (Message.message == WM_QUIT) {
+                // Leave it for the owning message loop
+                PostQuitMessage((int)Message.wParam);
+                QuitReceived = true;
+                break;
+            }
+            TranslateMessage(&Message);
+            DispatchMessage(&Message);
+        }
+        if (QuitReceived) break;
     }
+    
+    // New frame, or timeout - return whatever we have (even if old)
+    return AcquireLatestFrame(OutTexture, OutStamp);
+}
+
+CFrameIntervalModel CWindowCapture::GetFrameIntervalModel()
+{
+    std::lock_guard<std::mutex> Lock(MMutex);
+    return MIntervalModel;
 }
 
 HRESULT CWindowCapture::StartCapture(HWND WindowHandle)
@@ -135,8 +214,9 @@ HRESULT CWindowCapture::StartCapture(HWND WindowHandle)
 
     StopCapture();
 
-    HRESULT HResult = MImplementation->CreateCaptureItem(WindowHandle);
+    HRESULT HResult = MImplementation->CreateCaptureItem(WindowHandle, MImplementation->MItem);
     if (FAILED(HResult)) return HResult; // Returns specific HRESULT from CreateCaptureItem
+    MGeneration++;
 
     WDT::IDirect3DDevice Direct3DDevice{ nullptr };
     HResult = MContext->CreateDirect3DDevice(winrt::put_abi(Direct3DDevice));
@@ -145,26 +225,23 @@ HRESULT CWindowCapture::StartCapture(HWND WindowHandle)
     MImplementation->MDevice = Direct3DDevice;
     MImplementation->MLastSize = MImplementation->MItem.Size();
 
+    {
+        std::lock_guard<std::mutex> Lock(MMutex);
+        MIntervalModel.Reset();
+    }
+
     try
     {
         MImplementation->MFramePool = WGC::Direct3D11CaptureFramePool::Create(
             MImplementation->MDevice,
-            WDX::DirectXPixelFormat::B8G8R8A8UIntNormalized,
+            MImplementation->GetPixelFormat(),
             2,
             MImplementation->MLastSize
         );
 
-        MImplementation->MSession = MImplementation->MFramePool.CreateCaptureSession(MImplementation->MItem);
-
-        if (WF::Metadata::ApiInformation::IsPropertyPresent(
-            L"Windows.Graphics.Capture.GraphicsCaptureSession", L"IsBorderRequired"))
-        {
-            MImplementation->MSession.IsBorderRequired(false);
-        }
-
         MImplementation->MFramePool.FrameArrived({ MImplementation, &SImplementation::OnFrameArrived });
 
-        MImplementation->MSession.StartCapture();
+        MImplementation->StartSession();
 
         MIsCapturing = true;
     }
@@ -173,6 +250,52 @@ HRESULT CWindowCapture::StartCapture(HWND WindowHandle)
     return S_OK;
 }
 
+HRESULT CWindowCapture::Retarget(HWND WindowHandle)
+{
+    if (!MIsCapturing || !MImplementation->MFramePool || !MImplementation->MDevice) return StartCapture(WindowHandle);
+
+    // Resolve the new target first so a bad handle leaves the current capture running
+    WGC::GraphicsCaptureItem NewItem{ nullptr };
+    HRESULT HResult = MImplementation->CreateCaptureItem(WindowHandle, NewItem);
+    if (FAILED(HResult)) return HResult;
+
+    try
+    {
+        if (MImplementation->MSession) { MImplementation->MSession.Close(); MImplementation->MSession = nullptr; }
+    }
+    catch (...) {}
+
+    MGeneration++;
+    MImplementation->MItem = NewItem;
+    MImplementation->MLastSize = NewItem.Size();
+
+    {
+        std::lock_guard<std::mutex> Lock(MMutex);
+        MIntervalModel.Reset();
+    }
+
+    try
+    {
+        // Recreate drops frames still queued from the old target; device and
+        // FrameArrived registration stay as they are
+        MImplementation->MFramePool.Recreate(
+            MImplementation->MDevice,
+            MImplementation->GetPixelFormat(),
+            2,
+            MImplementation->MLastSize
+        );
+
+        MImplementation->StartSession();
+    }
+    catch (...)
+    {
+        MIsCapturing = false;
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
 void CWindowCapture::StopCapture()
 {
     MIsCapturing = false;
@@ -190,7 +313,27 @@ void CWindowCapture::StopCapture()
 }
 
 
-HRESULT CWindowCapture::SImplementation::CreateCaptureItem(HWND HWnd)
+void CWindowCapture::SImplementation::StartSession()
+{
+    MSession = MFramePool.CreateCaptureSession(MItem);
+
+    if (WF::Metadata::ApiInformation::IsPropertyPresent(
+        L"Windows.Graphics.Capture.GraphicsCaptureSession", L"IsBorderRequired"))
+    {
+        MSession.IsBorderRequired(false);
+    }
+
+    MSession.StartCapture();
+}
+
+WDX::DirectXPixelFormat CWindowCapture::SImplementation::GetPixelFormat() const
+{
+    return MParent->MCaptureFormat == DXGI_FORMAT_R16G16B16A16_FLOAT
+        ? WDX::DirectXPixelFormat::R16G16B16A16Float
+        : WDX::DirectXPixelFormat::B8G8R8A8UIntNormalized;
+}
+
+HRESULT CWindowCapture::SImplementation::CreateCaptureItem(HWND HWnd, WGC::GraphicsCaptureItem &OutItem)
 {
     // Validate window handle first
     if (!HWnd || !IsWindow(HWnd)) {
@@ -235,14 +378,17 @@ HRESULT CWindowCapture::SImplementation::CreateCaptureItem(HWND HWnd)
         OutputDebugStringA("[WindowCapture] WARNING: IsWindowVisible returned false, but attempting capture anyway\n");
     }
     
-    auto ActivationFactory = winrt::get_activation_factory<WGC::GraphicsCaptureItem>();
-    auto InteropFactory = ActivationFactory.as<IGraphicsCaptureItemInterop>();
-    if (!InteropFactory) return E_NOINTERFACE;
+    if (!MInteropFactory)
+    {
+        auto ActivationFactory = winrt::get_activation_factory<WGC::GraphicsCaptureItem>();
+        MInteropFactory = ActivationFactory.try_as<IGraphicsCaptureItemInterop>();
+        if (!MInteropFactory) return E_NOINTERFACE;
+    }
 
-    HRESULT hr = InteropFactory->CreateForWindow(
+    HRESULT hr = MInteropFactory->CreateForWindow(
         HWnd,
         winrt::guid_of<WGC::GraphicsCaptureItem>(),
-        winrt::put_abi(MItem)
+        winrt::put_abi(OutItem)
     );
     
     if (FAILED(hr)) {
@@ -264,7 +410,7 @@ void CWindowCapture::SImplementation::OnFrameArrived(WGC::Direct3D11CaptureFrame
         MLastSize = ContentSize;
         MFramePool.Recreate(
             MDevice,
-            WDX::DirectXPixelFormat::B8G8R8A8UIntNormalized,
+            GetPixelFormat(),
             2,
             MLastSize
         );
@@ -277,7 +423,7 @@ void CWindowCapture::SImplementation::OnFrameArrived(WGC::Direct3D11CaptureFrame
     ID3D11Texture2D *Texture = nullptr;
     if (SUCCEEDED(Access->GetInterface(__uuidof(ID3D11Texture2D), (void **)&Texture)))
     {
-        MParent->OnFrameReceived(Texture);
+        MParent->OnFrameReceived(Texture, Frame.SystemRelativeTime().count());
         Texture->Release();
     }
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include "Core/D3D11Context.h" 
 #include "Core/Delegate.h"
+#include "Capture/FrameIntervalModel.h"
 
 #include <mutex>
 #include <atomic>
@@ -10,22 +11,53 @@
 
 using FFrameDelegate = TDelegate<void(ID3D11Texture2D *)>;
 
+struct SFrameStamp
+{
+    uint64_t Sequence = 0;          // Value of the frame counter when the frame arrived (1-based)
+    int64_t PresentationTime = 0;   // SystemRelativeTime of the frame, 100 ns QPC units
+    uint32_t Generation = 0;        // Capture target generation, incremented by Retarget
+};
+
 class CWindowCapture
 {
 public:
     CWindowCapture();
     ~CWindowCapture();
 
+    // Loads the Windows.Graphics.Capture activation factories so the first StartCapture
+    // does not pay for it. Safe to call from any thread, including before construction.
+    static HRESULT PrewarmActivationFactories();
+
     void Initialize(CD3D11Context *Context);
     void SetCallback(FFrameDelegate Callback);
 
+    // Pixel format of the frame pool. Supported: DXGI_FORMAT_B8G8R8A8_UNORM and
+    // DXGI_FORMAT_R16G16B16A16_FLOAT (scRGB, for HDR windows). Applies immediately
+    // when a capture is running.
+    HRESULT SetCaptureFormat(DXGI_FORMAT Format);
+    DXGI_FORMAT GetCaptureFormat() const { return MCaptureFormat; }
+
     HRESULT StartCapture(HWND WindowHandle);
     void StopCapture();
 
-    HRESULT AcquireLatestFrame(ID3D11Texture2D **OutTexture);
+    // Switch the running capture to another window. Keeps the device, frame pool and
+    // frame callback; only the capture item and session are replaced. Falls back to
+    // StartCapture when nothing is being captured.
+    HRESULT Retarget(HWND WindowHandle);
+    uint32_t GetGeneration() const { return MGeneration.load(); }
+
+    HRESULT AcquireLatestFrame(ID3D11Texture2D **OutTexture, SFrameStamp *OutStamp = nullptr);
     
     // Wait for a new frame with timeout (milliseconds). Returns frame count or 0 on timeout.
-    HRESULT WaitForNewFrame(ID3D11Texture2D **OutTexture, int timeoutMs);
+    HRESULT WaitForNewFrame(ID3D11Texture2D **OutTexture, int timeoutMs, SFrameStamp *OutStamp = nullptr);
+
+    // Wait until a frame with a sequence number above Sequence arrives, pumping the thread's
+    // messages so frame pool callbacks dispatched to this thread can run. On timeout the
+    // latest (older) frame is returned.
+    HRESULT WaitForFrameAfter(uint64_t Sequence, int TimeoutMs, ID3D11Texture2D **OutTexture, SFrameStamp *OutStamp = nullptr);
+
+    // Snapshot of the frame arrival model for the current capture
+    CFrameIntervalModel GetFrameIntervalModel();
     
     // Get current frame counter
     uint64_t GetFrameCount() const { return MFrameCount.load(); }
@@ -33,17 +65,21 @@ public:
     bool IsCapturing() const;
 
 private:
-    void OnFrameReceived(ID3D11Texture2D *Texture);
+    void OnFrameReceived(ID3D11Texture2D *Texture, int64_t PresentationTime);
 
     struct SImplementation;
     SImplementation *MImplementation = nullptr;
 
     std::mutex MMutex;
     ID3D11Texture2D *MLatestFrame = nullptr;
+    SFrameStamp MLatestStamp;
+    CFrameIntervalModel MIntervalModel;
     std::atomic<bool> MIsCapturing = false;
     std::atomic<uint64_t> MFrameCount = 0;  // Frame counter for detecting new frames
+    std::atomic<uint32_t> MGeneration = 0;
 
     CD3D11Context *MContext = nullptr;
+    DXGI_FORMAT MCaptureFormat = DXGI_FORMAT_B8G8R8A8_UNORM;
     FFrameDelegate MFrameCallback;
 
     friend struct SImplementation;
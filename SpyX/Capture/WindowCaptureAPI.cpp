@@ -1,13 +1,41 @@
 #include "WindowCaptureAPI.h"
 #include "WindowCapture.h"
+#include "Analysis/PixelSampler.h"
+#include "Analysis/RoiExtractor.h"
+#include "Analysis/TemplateMatcher.h"
+#include "Analysis/TemplateTracker.h"
+#include "Analysis/ColorSearch.h"
+#include "Analysis/PixelClassifier.h"
+#include "Analysis/BlobDetector.h"
+#include "Analysis/BarReader.h"
+#include "Analysis/GlyphRecognizer.h"
 #include "Core/D3D11Context.h"
+#include "Imaging/BitMask.h"
+#include "Imaging/JpegEncoder.h"
+#include "Imaging/PaletteQuantizer.h"
+#include "Imaging/ScreenshotService.h"
+#include "Imaging/ToneMapper.h"
+#include "Recording/FrameCodec.h"
+#include "Recording/FrameHistory.h"
+#include "Recording/RecordingFile.h"
+#include "Recording/RecordingSource.h"
+#include "Recording/ReplayBuffer.h"
+#include "Server/FrameClient.h"
+#include "Server/FrameServer.h"
+#include "Server/ResultBoard.h"
 
 #include <string>
 #include <mutex>
 #include <thread>
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
+#include <memory>
 #include <queue>
+#include <deque>
+#include <vector>
+#include <climits>
+#include <algorithm>
 
 // ============================================================================
 // Thread-safe capture system with dedicated message loop thread
@@ -18,14 +46,33 @@ enum class CaptureRequestType {
     Initialize,
     StartCapture,
     StopCapture,
+    Retarget,
     CaptureFrame,
+    SetFormat,
+    SetToneMapping,
+    GetFrameIntervalStats,
+    StartRecording,
+    StopRecording,
+    StartReplay,
+    SeekReplay,
+    StopReplay,
+    EnableReplayBuffer,
+    DisableReplayBuffer,
+    DumpReplay,
     Cleanup,
     Shutdown
 };
 
 struct CaptureRequest {
     CaptureRequestType type;
-    HWND hwnd = nullptr;  // For StartCapture
+    HWND hwnd = nullptr;  // For StartCapture and Retarget
+    int captureFormat = WC_CAPTURE_FORMAT_BGRA8;  // For SetFormat
+    int outputFormat = WC_OUTPUT_FORMAT_BGRA8;
+    SToneMapSettings toneMapping;  // For SetToneMapping
+    std::string path;  // For StartRecording, StartReplay and DumpReplay
+    SReplayBufferSettings replayBuffer;  // For EnableReplayBuffer
+    int64_t timestamp = 0;  // For SeekReplay
+    bool keepFrameNative = false;  // For CaptureFrame: cache the frame, return only metadata
 };
 
 struct CaptureResponse {
@@ -34,6 +81,16 @@ struct CaptureResponse {
     int width = 0;
     int height = 0;
     int stride = 0;
+    int format = WC_OUTPUT_FORMAT_BGRA8;
+    bool isCached = false;
+    bool frameOwnedByCache = false;  // frameData was adopted by the frame cache, do not free
+    uint64_t sequence = 0;
+    int64_t presentationTime = 0;
+    int64_t readbackTime = 0;
+    int droppedFrames = 0;
+    uint32_t generation = 0;
+    double meanIntervalMs = 0.0;  // For GetFrameIntervalStats
+    double jitterMs = 0.0;
     std::string error;
 };
 
@@ -48,6 +105,18 @@ static CaptureResponse g_CurrentResponse;
 static std::atomic<bool> g_HasRequest{false};
 static std::atomic<bool> g_HasResponse{false};
 
+// Capture thread startup handshake
+static std::mutex g_ReadyMutex;
+static std::condition_variable g_ReadyCV;
+static bool g_ThreadReady = false;
+static std::atomic<bool> g_PrewarmOnStart{false};
+
+// Startup timing breakdown
+typedef std::chrono::steady_clock StartupClock;
+static std::mutex g_TimingMutex;
+static WC_StartupTimings g_StartupTimings = {};
+static StartupClock::time_point g_StartupBegin;
+
 static std::string g_LastError;
 static std::mutex g_ErrorMutex;
 static char g_LastErrorBuffer[1024];  // Static buffer for returning error strings
@@ -58,12 +127,178 @@ static CWindowCapture* g_WindowCapture = nullptr;
 static std::atomic<bool> g_Initialized{false};
 static std::atomic<bool> g_IsCapturing{false};  // True when actively capturing a window
 
-// Last successful frame cache
-static void* g_LastFrameData = nullptr;
-static int g_LastFrameWidth = 0;
-static int g_LastFrameHeight = 0;
-static int g_LastFrameStride = 0;
-static size_t g_LastFrameSize = 0;
+// Pixel format configuration (capture thread only)
+static int g_CaptureFormat = WC_CAPTURE_FORMAT_BGRA8;
+static int g_OutputFormat = WC_OUTPUT_FORMAT_BGRA8;
+static CToneMapper g_ToneMapper;
+
+// Last successful frame, written on the capture thread. Analysis calls read it in place on
+// their own thread and hold a reference meanwhile, so the next frame goes into the spare.
+struct CachedFrame {
+    void* data = nullptr;
+    size_t size = 0;
+    int width = 0;
+    int height = 0;
+    int stride = 0;
+    int format = WC_OUTPUT_FORMAT_BGRA8;
+    SFrameStamp stamp;
+    uint64_t source = 0;  // g_FrameSource when cached
+    int64_t readbackTime = 0;
+    
+    CachedFrame() = default;
+    CachedFrame(const CachedFrame&) = delete;
+    CachedFrame& operator=(const CachedFrame&) = delete;
+    ~CachedFrame() {
+        if (data) {
+            HeapFree(GetProcessHeap(), 0, data);
+        }
+    }
+};
+static std::mutex g_FrameCacheMutex;
+static std::shared_ptr<CachedFrame> g_LastFrame;
+static std::shared_ptr<CachedFrame> g_SpareFrame;  // Capture thread only
+
+// Bumped whenever the cache is cleared for a new frame source. Live capture and replay both
+// number frames from 1, so the stamp alone does not tell their frames apart.
+static uint64_t g_FrameSource = 1;  // Capture thread only
+
+// Sequence of the last fresh frame handed to a caller, for drop accounting
+static uint64_t g_LastDeliveredSequence = 0;
+
+// Recording of delivered frames and replay of recordings (capture thread only)
+static CFrameEncoder* g_RecordingEncoder = nullptr;
+static CRecordingWriter* g_RecordingWriter = nullptr;
+static std::vector<uint8_t> g_RecordingBuffer;
+static CRecordingSource* g_ReplaySource = nullptr;
+static std::atomic<bool> g_IsReplaying{false};
+
+// Instant replay history of delivered frames. Replaced on the capture thread and encoded
+// into on the history worker, both under g_ReplayMutex; the dump thread keeps its own reference.
+static std::mutex g_ReplayMutex;
+static std::shared_ptr<CReplayBuffer> g_ReplayBuffer;
+static CFrameEncoder* g_ReplayEncoder = nullptr;
+static std::vector<uint8_t> g_ReplayFrameBuffer;
+static std::thread g_DumpThread;
+static std::atomic<int> g_DumpStatus{WC_REPLAY_DUMP_IDLE};
+
+// Long-term tile-deduplicated history (fed on the history worker, queried from any thread)
+static std::mutex g_HistoryMutex;
+static std::shared_ptr<CFrameHistory> g_FrameHistory;
+
+// Compresses delivered frames into the replay buffer and frame history, so the capture calls
+// do not wait for it. Queued frames are cache references; when the worker falls behind, the
+// oldest queued frame is skipped. Started and stopped on the capture thread.
+static const size_t MaxHistoryQueue = 4;
+static std::mutex g_HistoryWorkerMutex;
+static std::condition_variable g_HistoryWorkerCV;
+static std::thread g_HistoryWorker;
+static std::deque<std::shared_ptr<const CachedFrame>> g_HistoryQueue;
+static bool g_HistoryWorkerStop = false;
+
+// Background PNG/QOI writer, created on first use so no thread starts under the loader lock
+static std::mutex g_ScreenshotMutex;
+static std::unique_ptr<CScreenshotService> g_ScreenshotService;
+
+// Thumbnail encoder, kept so its worker threads and segment buffers are reused
+static std::mutex g_JpegMutex;
+static std::unique_ptr<CJpegEncoder> g_JpegEncoder;
+static std::vector<uint8_t> g_JpegOutput;
+
+// Frame server publishing this process's captures, and the client side for other processes
+static std::mutex g_FrameServerMutex;
+static std::shared_ptr<CFrameServer> g_FrameServer;
+static std::mutex g_FrameClientMutex;
+static std::unique_ptr<CFrameClient> g_FrameClient;
+static std::string g_FrameClientPath;
+static std::vector<uint8_t> g_FrameClientPixels;
+
+// Result board and the indices of the fields this file publishes
+struct ResultBoardState {
+    CResultBoard board;
+    int sequence = -1;
+    int presentationTime = -1;
+    int readbackTime = -1;
+    int width = -1;
+    int height = -1;
+    int droppedFrames = -1;
+    int firstCallerField = 0;      // Fields before this index are published by this file
+};
+
+// Caller-defined fields added to the board on WC_EnableResultBoard
+struct ResultFieldDeclaration {
+    std::string name;
+    EResultFieldType type;
+    int count;
+};
+static std::mutex g_ResultBoardMutex;
+static std::shared_ptr<ResultBoardState> g_ResultBoard;
+static std::vector<ResultFieldDeclaration> g_ResultFields;
+
+// ROI extraction scratch, reused across calls
+static std::mutex g_RoiMutex;
+static CRoiExtractor g_RoiExtractor;
+static std::vector<SRoiRequest> g_RoiRequests;
+static std::vector<SRoiOutput> g_RoiLayout;
+
+// Template matcher, created on first use so no thread starts under the loader lock
+static std::mutex g_MatcherMutex;
+static std::unique_ptr<CTemplateMatcher> g_TemplateMatcher;
+static std::unique_ptr<CTemplateTracker> g_TemplateTracker;
+static std::vector<SMatch> g_Matches;
+
+// Pyramid of the latest frame searched with pyramidLevels, shared by calls on that frame
+static CFramePyramidCache g_FramePyramid;
+
+// Colour search scratch, reused across calls
+static std::mutex g_ColorSearchMutex;
+static CColorSearch g_ColorSearch;
+static std::vector<SColorBox> g_ColorBoxes;
+
+// Pixel classifiers by id, null once destroyed
+static std::mutex g_ClassifierMutex;
+static std::vector<std::unique_ptr<CPixelClassifier>> g_Classifiers;
+
+// Blob detector, created on first use so no thread starts under the loader lock
+static std::mutex g_BlobMutex;
+static std::unique_ptr<CBlobDetector> g_BlobDetector;
+static std::vector<SBlob> g_Blobs;
+
+// Compact mask scratch, reused across calls
+static std::mutex g_MaskMutex;
+static std::vector<uint8_t> g_MaskLabels;
+static std::vector<uint8_t> g_MaskPixels;
+static std::vector<uint8_t> g_MaskRow;
+static std::vector<uint8_t> g_MaskBits;
+static std::vector<int32_t> g_MaskRowStarts;
+static std::vector<SMaskRun> g_MaskRuns;
+
+// Palettes by id, null once destroyed
+struct PaletteSlot {
+    CPaletteQuantizer quantizer;
+    bool rebuildEachFrame = false;
+    EPaletteMethod method = EPaletteMethod::MedianCut;
+    int maxColors = 0;
+    int sampleStep = 0;
+};
+static std::mutex g_PaletteMutex;
+static std::vector<std::unique_ptr<PaletteSlot>> g_Palettes;
+
+// Bar reader scratch, reused across calls
+static std::mutex g_BarMutex;
+static CBarReader g_BarReader;
+static std::vector<SColorRange> g_BarRanges;
+static std::vector<SBarRequest> g_BarRequests;
+static std::vector<SBarReading> g_BarReadings;
+
+// Glyph sets by id, null once destroyed
+static std::mutex g_GlyphMutex;
+static std::vector<std::unique_ptr<CGlyphRecognizer>> g_GlyphSets;
+static std::vector<SGlyphResult> g_GlyphResults;
+
+// Frame wait policy (set from any thread)
+static const int64_t MaxFrameWait = 50 * 10000;  // Legacy fixed wait, now the upper bound
+static std::atomic<int> g_FrameWaitMode{WC_WAIT_NEXT_FRAME};
+static std::atomic<int> g_FrameWaitBudgetMs{0};
 
 // Helper to set error
 static void SetError(const char* error) {
@@ -71,39 +306,122 @@ static void SetError(const char* error) {
     g_LastError = error ? error : "Unknown error";
 }
 
-// Helper to cache a successful frame
-static void CacheFrame(void* data, int width, int height, int stride) {
-    size_t dataSize = (size_t)stride * (size_t)height;
+// Current time in 100 ns units of the QPC clock (same clock as SystemRelativeTime)
+static int64_t QueryTime100ns() {
+    static LARGE_INTEGER frequency = [] {
+        LARGE_INTEGER value;
+        QueryPerformanceFrequency(&value);
+        return value;
+    }();
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    int64_t seconds = counter.QuadPart / frequency.QuadPart;
+    int64_t remainder = counter.QuadPart % frequency.QuadPart;
+    return seconds * 10000000 + remainder * 10000000 / frequency.QuadPart;
+}
+
+// Helper to cache a successful frame. With adopt the cache takes over the response
+// buffer instead of copying it; the response keeps pointing at it for the rest of the
+// capture thread's frame processing.
+static std::shared_ptr<const CachedFrame> CacheFrame(CaptureResponse& frame, bool adopt) {
+    size_t dataSize = (size_t)frame.stride * (size_t)frame.height;
+    
+    // Reuse the spare unless an analysis call still holds it
+    std::shared_ptr<CachedFrame> target;
+    if (g_SpareFrame && g_SpareFrame.use_count() == 1) {
+        target.swap(g_SpareFrame);
+    } else {
+        target = std::make_shared<CachedFrame>();
+    }
     
-    // Reallocate if needed
-    if (g_LastFrameData == nullptr || g_LastFrameSize < dataSize) {
-        if (g_LastFrameData) {
-            HeapFree(GetProcessHeap(), 0, g_LastFrameData);
+    if (adopt) {
+        if (target->data) {
+            HeapFree(GetProcessHeap(), 0, target->data);
+        }
+        target->data = frame.frameData;
+        target->size = dataSize;
+        frame.frameOwnedByCache = true;
+    } else {
+        // Reallocate if needed
+        if (target->data == nullptr || target->size < dataSize) {
+            if (target->data) {
+                HeapFree(GetProcessHeap(), 0, target->data);
+            }
+            target->data = HeapAlloc(GetProcessHeap(), 0, dataSize);
+            target->size = target->data ? dataSize : 0;
+        }
+        if (!target->data) {
+            return nullptr;
         }
-        g_LastFrameData = HeapAlloc(GetProcessHeap(), 0, dataSize);
-        g_LastFrameSize = dataSize;
+        memcpy(target->data, frame.frameData, dataSize);
     }
     
-    if (g_LastFrameData) {
-        memcpy(g_LastFrameData, data, dataSize);
-        g_LastFrameWidth = width;
-        g_LastFrameHeight = height;
-        g_LastFrameStride = stride;
-    }
+    target->width = frame.width;
+    target->height = frame.height;
+    target->stride = frame.stride;
+    target->format = frame.format;
+    target->stamp.Sequence = frame.sequence;
+    target->stamp.PresentationTime = frame.presentationTime;
+    target->stamp.Generation = frame.generation;
+    target->source = g_FrameSource;
+    target->readbackTime = frame.readbackTime;
+    
+    std::lock_guard<std::mutex> lock(g_FrameCacheMutex);
+    g_SpareFrame = g_LastFrame;
+    g_LastFrame = target;
+    return target;
+}
+
+// Drop the pyramid of the last searched frame and its buffers. Its key already differs from
+// frames of a later source, this only frees the memory.
+static void ResetFramePyramid() {
+    std::lock_guard<std::mutex> lock(g_MatcherMutex);
+    g_FramePyramid.Clear();
+}
+
+// Helper to drop the cached frame
+static void ClearFrameCache() {
+    std::lock_guard<std::mutex> lock(g_FrameCacheMutex);
+    g_LastFrame.reset();
+    g_SpareFrame.reset();
+    g_FrameSource++;
+}
+
+// Latest cached frame for use on any thread; stays valid while the reference is held
+static std::shared_ptr<const CachedFrame> AcquireLatestFrame() {
+    std::lock_guard<std::mutex> lock(g_FrameCacheMutex);
+    return g_LastFrame;
+}
+
+static SImageView ViewOfCachedFrame(const CachedFrame& frame) {
+    SImageView view;
+    view.Data = static_cast<const uint8_t*>(frame.data);
+    view.Width = frame.width;
+    view.Height = frame.height;
+    view.Stride = frame.stride;
+    view.Format = frame.format == WC_OUTPUT_FORMAT_GRAY8 ? EPixelFormat::Gray8 : EPixelFormat::BGRA8;
+    return view;
 }
 
 // Helper to return cached frame
 static CaptureResponse GetCachedFrame() {
     CaptureResponse response;
     
-    if (g_LastFrameData && g_LastFrameWidth > 0 && g_LastFrameHeight > 0) {
-        size_t dataSize = (size_t)g_LastFrameStride * (size_t)g_LastFrameHeight;
+    std::shared_ptr<const CachedFrame> cached = AcquireLatestFrame();
+    if (cached && cached->width > 0 && cached->height > 0) {
+        size_t dataSize = (size_t)cached->stride * (size_t)cached->height;
         response.frameData = HeapAlloc(GetProcessHeap(), 0, dataSize);
         if (response.frameData) {
-            memcpy(response.frameData, g_LastFrameData, dataSize);
-            response.width = g_LastFrameWidth;
-            response.height = g_LastFrameHeight;
-            response.stride = g_LastFrameStride;
+            memcpy(response.frameData, cached->data, dataSize);
+            response.width = cached->width;
+            response.height = cached->height;
+            response.stride = cached->stride;
+            response.format = cached->format;
+            response.isCached = true;
+            response.sequence = cached->stamp.Sequence;
+            response.presentationTime = cached->stamp.PresentationTime;
+            response.generation = cached->stamp.Generation;
+            response.readbackTime = cached->readbackTime;
             response.success = true;
         }
     }
@@ -111,28 +429,375 @@ static CaptureResponse GetCachedFrame() {
     return response;
 }
 
+static DXGI_FORMAT ToDXGIFormat(int captureFormat) {
+    return captureFormat == WC_CAPTURE_FORMAT_RGBA16F ? DXGI_FORMAT_R16G16B16A16_FLOAT : DXGI_FORMAT_B8G8R8A8_UNORM;
+}
+
+// Staging texture reused across frames and target switches while size and format match
+static ID3D11Texture2D* g_StagingTexture = nullptr;
+static D3D11_TEXTURE2D_DESC g_StagingDesc = {};
+
+static void ReleaseStagingTexture() {
+    if (g_StagingTexture) {
+        g_StagingTexture->Release();
+        g_StagingTexture = nullptr;
+    }
+}
+
+// Returns a borrowed staging texture matching the source texture
+static HRESULT GetStagingTexture(const D3D11_TEXTURE2D_DESC& sourceDesc, ID3D11Texture2D** outTexture) {
+    if (g_StagingTexture && g_StagingDesc.Width == sourceDesc.Width && g_StagingDesc.Height == sourceDesc.Height &&
+        g_StagingDesc.Format == sourceDesc.Format) {
+        *outTexture = g_StagingTexture;
+        return S_OK;
+    }
+    
+    ReleaseStagingTexture();
+    
+    D3D11_TEXTURE2D_DESC stagingDesc = sourceDesc;
+    stagingDesc.MipLevels = 1;
+    stagingDesc.ArraySize = 1;
+    stagingDesc.Usage = D3D11_USAGE_STAGING;
+    stagingDesc.BindFlags = 0;
+    stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+    stagingDesc.MiscFlags = 0;
+    
+    HRESULT hr = g_D3DContext->GetDevice()->CreateTexture2D(&stagingDesc, nullptr, &g_StagingTexture);
+    if (FAILED(hr)) {
+        g_StagingTexture = nullptr;
+        return hr;
+    }
+    
+    g_StagingDesc = stagingDesc;
+    *outTexture = g_StagingTexture;
+    return S_OK;
+}
+
+// Convert a mapped frame into the configured output format
+static void ConvertMappedFrame(const SImageView& source, void* destination, int destinationStride) {
+    uint8_t* out = static_cast<uint8_t*>(destination);
+    
+    if (source.Format == EPixelFormat::RGBA16F) {
+        if (g_OutputFormat == WC_OUTPUT_FORMAT_GRAY8) {
+            g_ToneMapper.ToneMapToGray8(source, out, destinationStride);
+        } else {
+            g_ToneMapper.ToneMapToBGRA8(source, out, destinationStride);
+        }
+    } else {
+        ConvertBGRA8ToGray8(source, out, destinationStride);
+    }
+}
+
+// Copy a CPU-side frame into a newly allocated response buffer in the output format
+static bool CopyFrameToResponse(const SImageView& source, CaptureResponse& response) {
+    response.width = source.Width;
+    response.height = source.Height;
+    
+    // Plain BGRA is copied with the source row pitch; converted output is tightly packed
+    bool needsConversion = source.Format != EPixelFormat::BGRA8 || g_OutputFormat != WC_OUTPUT_FORMAT_BGRA8;
+    if (needsConversion) {
+        response.stride = source.Width * (g_OutputFormat == WC_OUTPUT_FORMAT_GRAY8 ? 1 : 4);
+    } else {
+        response.stride = source.Stride;
+    }
+    
+    // Use HeapAlloc for better Windows compatibility
+    size_t dataSize = (size_t)response.stride * (size_t)source.Height;
+    response.frameData = HeapAlloc(GetProcessHeap(), 0, dataSize);
+    if (!response.frameData) {
+        return false;
+    }
+    
+    if (needsConversion) {
+        ConvertMappedFrame(source, response.frameData, response.stride);
+    } else {
+        memcpy(response.frameData, source.Data, dataSize);
+    }
+    
+    response.format = g_OutputFormat;
+    return true;
+}
+
+// Close the recording, writing its index
+static void StopRecording() {
+    if (g_RecordingWriter) {
+        if (!g_RecordingWriter->Close()) {
+            OutputDebugStringA("[WindowCaptureAPI] Failed to finalize recording\n");
+        }
+        delete g_RecordingWriter;
+        g_RecordingWriter = nullptr;
+    }
+    if (g_RecordingEncoder) {
+        delete g_RecordingEncoder;
+        g_RecordingEncoder = nullptr;
+    }
+    g_RecordingBuffer.clear();
+    g_RecordingBuffer.shrink_to_fit();
+}
+
+// View of a BGRA response buffer
+static SImageView ViewOfFrame(const CaptureResponse& frame) {
+    SImageView view;
+    view.Data = static_cast<const uint8_t*>(frame.frameData);
+    view.Width = frame.width;
+    view.Height = frame.height;
+    view.Stride = frame.stride;
+    view.Format = EPixelFormat::BGRA8;
+    return view;
+}
+
+// Append a freshly delivered BGRA frame to the recording
+static void RecordFrame(const CaptureResponse& frame) {
+    if (!g_RecordingWriter || frame.format != WC_OUTPUT_FORMAT_BGRA8) {
+        return;
+    }
+    
+    SImageView view = ViewOfFrame(frame);
+    SEncodedFrameInfo info;
+    if (!g_RecordingEncoder->Encode(view, g_RecordingBuffer, &info) ||
+        !g_RecordingWriter->AppendFrame(g_RecordingBuffer.data(), g_RecordingBuffer.size(), frame.presentationTime, info.IsKeyframe)) {
+        // A recording with a gap would not decode past it, so end it here
+        OutputDebugStringA("[WindowCaptureAPI] Recording write failed, recording stopped\n");
+        StopRecording();
+    }
+}
+
+// Append a delivered BGRA frame to the instant replay history (history worker)
+static void BufferReplayFrame(const CachedFrame& frame) {
+    if (frame.format != WC_OUTPUT_FORMAT_BGRA8) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(g_ReplayMutex);
+    if (!g_ReplayBuffer) {
+        return;
+    }
+    
+    SImageView view = ViewOfCachedFrame(frame);
+    // A dropped frame only costs history; the buffer asks for a keyframe to resume
+    SEncodedFrameInfo info;
+    int64_t presentationTime = frame.stamp.PresentationTime;
+    bool keyframe = g_ReplayBuffer->WantsKeyframe(presentationTime);
+    if (g_ReplayEncoder->Encode(view, g_ReplayFrameBuffer, &info, keyframe)) {
+        g_ReplayBuffer->Append(g_ReplayFrameBuffer.data(), g_ReplayFrameBuffer.size(), presentationTime, info.IsKeyframe);
+    }
+}
+
+// Add a delivered BGRA frame to the long-term history (history worker)
+static void AddHistoryFrame(const CachedFrame& frame) {
+    if (frame.format != WC_OUTPUT_FORMAT_BGRA8) {
+        return;
+    }
+    
+    std::shared_ptr<CFrameHistory> history;
+    {
+        std::lock_guard<std::mutex> lock(g_HistoryMutex);
+        history = g_FrameHistory;
+    }
+    if (history) {
+        history->AddFrame(ViewOfCachedFrame(frame), frame.stamp.PresentationTime, frame.stamp.Sequence);
+    }
+}
+
+static void HistoryWorkerMain() {
+    for (;;) {
+        std::shared_ptr<const CachedFrame> frame;
+        {
+            std::unique_lock<std::mutex> lock(g_HistoryWorkerMutex);
+            g_HistoryWorkerCV.wait(lock, [] { return g_HistoryWorkerStop || !g_HistoryQueue.empty(); });
+            if (g_HistoryWorkerStop) {
+                return;
+            }
+            frame = std::move(g_HistoryQueue.front());
+            g_HistoryQueue.pop_front();
+        }
+        BufferReplayFrame(*frame);
+        AddHistoryFrame(*frame);
+    }
+}
+
+// Hand a delivered frame to the history worker, starting it on first use (capture thread)
+static void QueueHistoryFrame(const std::shared_ptr<const CachedFrame>& frame) {
+    if (!frame || frame->format != WC_OUTPUT_FORMAT_BGRA8) {
+        return;
+    }
+    bool wanted;
+    {
+        std::lock_guard<std::mutex> lock(g_ReplayMutex);
+        wanted = g_ReplayBuffer != nullptr;
+    }
+    if (!wanted) {
+        std::lock_guard<std::mutex> lock(g_HistoryMutex);
+        wanted = g_FrameHistory != nullptr;
+    }
+    if (!wanted) {
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(g_HistoryWorkerMutex);
+        if (g_HistoryQueue.size() >= MaxHistoryQueue) {
+            g_HistoryQueue.pop_front();
+        }
+        g_HistoryQueue.push_back(frame);
+    }
+    if (!g_HistoryWorker.joinable()) {
+        g_HistoryWorkerStop = false;
+        g_HistoryWorker = std::thread(HistoryWorkerMain);
+    }
+    g_HistoryWorkerCV.notify_one();
+}
+
+// Stop the history worker and drop the frames it has not taken yet (capture thread)
+static void StopHistoryWorker() {
+    {
+        std::lock_guard<std::mutex> lock(g_HistoryWorkerMutex);
+        g_HistoryWorkerStop = true;
+        g_HistoryQueue.clear();
+    }
+    g_HistoryWorkerCV.notify_one();
+    if (g_HistoryWorker.joinable()) {
+        g_HistoryWorker.join();
+    }
+}
+
+// Publish a freshly delivered frame to frame server subscribers
+static void PublishServerFrame(const CaptureResponse& frame) {
+    std::shared_ptr<CFrameServer> server;
+    {
+        std::lock_guard<std::mutex> lock(g_FrameServerMutex);
+        server = g_FrameServer;
+    }
+    if (!server) {
+        return;
+    }
+    
+    SImageView view = ViewOfFrame(frame);
+    view.Format = frame.format == WC_OUTPUT_FORMAT_GRAY8 ? EPixelFormat::Gray8 : EPixelFormat::BGRA8;
+    server->Publish(view, frame.sequence, frame.presentationTime);
+}
+
+// Post the metadata of a freshly delivered frame to the result board
+static void PublishFrameResults(const CaptureResponse& frame) {
+    std::shared_ptr<ResultBoardState> state;
+    {
+        std::lock_guard<std::mutex> lock(g_ResultBoardMutex);
+        state = g_ResultBoard;
+    }
+    if (!state) {
+        return;
+    }
+    
+    CResultBoard& board = state->board;
+    board.BeginUpdate();
+    board.SetInt64(state->sequence, static_cast<int64_t>(frame.sequence));
+    board.SetInt64(state->presentationTime, frame.presentationTime);
+    board.SetInt64(state->readbackTime, frame.readbackTime);
+    board.SetInt32(state->width, frame.width);
+    board.SetInt32(state->height, frame.height);
+    board.SetInt32(state->droppedFrames, frame.droppedFrames);
+    board.EndUpdate();
+}
+
+static void DisableReplayBuffer() {
+    // A running dump keeps its own reference to the buffer
+    std::lock_guard<std::mutex> lock(g_ReplayMutex);
+    g_ReplayBuffer.reset();
+    if (g_ReplayEncoder) {
+        delete g_ReplayEncoder;
+        g_ReplayEncoder = nullptr;
+    }
+    g_ReplayFrameBuffer.clear();
+    g_ReplayFrameBuffer.shrink_to_fit();
+}
+
+static void JoinDumpThread() {
+    if (g_DumpThread.joinable()) {
+        g_DumpThread.join();
+    }
+}
+
+static void StopReplay() {
+    g_IsReplaying = false;
+    if (g_ReplaySource) {
+        delete g_ReplaySource;
+        g_ReplaySource = nullptr;
+    }
+}
+
+// Return the next frame of the replayed recording. Every call advances by exactly one
+// frame, so a replay produces the same frame sequence regardless of timing. The frame is
+// cached like a captured one, so analysis calls on the latest frame see the replay.
+static CaptureResponse ProcessReplayFrame(bool keepFrameNative) {
+    CaptureResponse response;
+    
+    size_t index = g_ReplaySource->GetPosition();
+    SImageView frame;
+    int64_t timestamp = 0;
+    if (!g_ReplaySource->ReadFrame(frame, &timestamp)) {
+        response.error = index >= g_ReplaySource->GetFrameCount() ? "End of recording" : "Corrupt recording frame";
+        return response;
+    }
+    
+    if (!CopyFrameToResponse(frame, response)) {
+        response.error = "Failed to allocate memory";
+        return response;
+    }
+    
+    response.sequence = index + 1;
+    response.presentationTime = timestamp;
+    response.readbackTime = QueryTime100ns();
+    CacheFrame(response, keepFrameNative);
+    response.success = true;
+    return response;
+}
+
+// Cached frame returned when a capture fails. Frames that arrived since the last delivery
+// count as dropped, except the newest, which the next call can still read back.
+static CaptureResponse GetFallbackFrame() {
+    CaptureResponse cached = GetCachedFrame();
+    if (cached.success && g_WindowCapture && g_LastDeliveredSequence != 0) {
+        uint64_t latest = g_WindowCapture->GetFrameCount();
+        if (latest > g_LastDeliveredSequence + 1) {
+            cached.droppedFrames = static_cast<int>(latest - g_LastDeliveredSequence - 1);
+            g_LastDeliveredSequence = latest - 1;
+        }
+    }
+    return cached;
+}
+
 // Process a single frame capture
-static CaptureResponse ProcessCaptureFrame() {
+static CaptureResponse ProcessCaptureFrame(bool keepFrameNative) {
     CaptureResponse response;
     
+    if (g_ReplaySource) {
+        return ProcessReplayFrame(keepFrameNative);
+    }
+    
     if (!g_Initialized.load() || !g_WindowCapture || !g_WindowCapture->IsCapturing()) {
         response.error = "Not capturing";
         // Try to return cached frame
-        CaptureResponse cached = GetCachedFrame();
+        CaptureResponse cached = GetFallbackFrame();
         if (cached.success) {
             return cached;
         }
         return response;
     }
     
-    // Wait for a new frame with 50ms timeout
-    // This ensures we get a fresh frame after user input/rendering
+    // Wait for a frame newer than the last one delivered, for as long as the
+    // frame interval model says one is worth waiting for
+    CFrameIntervalModel model = g_WindowCapture->GetFrameIntervalModel();
+    int64_t waitTime = model.ComputeWaitTime(static_cast<EFrameWaitMode>(g_FrameWaitMode.load()),
+        QueryTime100ns(), (int64_t)g_FrameWaitBudgetMs.load() * 10000, MaxFrameWait);
+    int timeoutMs = static_cast<int>((waitTime + 9999) / 10000);
+    
     ID3D11Texture2D* texture = nullptr;
-    HRESULT hr = g_WindowCapture->WaitForNewFrame(&texture, 50);
+    SFrameStamp stamp;
+    HRESULT hr = g_WindowCapture->WaitForFrameAfter(g_LastDeliveredSequence, timeoutMs, &texture, &stamp);
     if (FAILED(hr) || !texture) {
         response.error = "No frame available";
         // Try to return cached frame
-        CaptureResponse cached = GetCachedFrame();
+        CaptureResponse cached = GetFallbackFrame();
         if (cached.success) {
             return cached;
         }
@@ -144,30 +809,32 @@ static CaptureResponse ProcessCaptureFrame() {
     ZeroMemory(&desc, sizeof(desc));
     texture->GetDesc(&desc);
     
-    // Validate dimensions
+    // Validate dimensions and format
     if (desc.Width == 0 || desc.Height == 0 || desc.Width > 8192 || desc.Height > 8192) {
         texture->Release();
         response.error = "Invalid texture dimensions";
         // Try to return cached frame
-        CaptureResponse cached = GetCachedFrame();
+        CaptureResponse cached = GetFallbackFrame();
         if (cached.success) {
             return cached;
         }
         return response;
     }
     
-    response.width = static_cast<int>(desc.Width);
-    response.height = static_cast<int>(desc.Height);
-    
-    // Create staging texture for CPU access
-    D3D11_TEXTURE2D_DESC stagingDesc = desc;
-    stagingDesc.Usage = D3D11_USAGE_STAGING;
-    stagingDesc.BindFlags = 0;
-    stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
-    stagingDesc.MiscFlags = 0;
+    if (desc.Format != DXGI_FORMAT_B8G8R8A8_UNORM && desc.Format != DXGI_FORMAT_R16G16B16A16_FLOAT) {
+        texture->Release();
+        response.error = "Unsupported texture format";
+        // Try to return cached frame
+        CaptureResponse cached = GetFallbackFrame();
+        if (cached.success) {
+            return cached;
+        }
+        return response;
+    }
     
+    // Get a staging texture for CPU access
     ID3D11Texture2D* stagingTexture = nullptr;
-    hr = g_D3DContext->GetDevice()->CreateTexture2D(&stagingDesc, nullptr, &stagingTexture);
+    hr = GetStagingTexture(desc, &stagingTexture);
     if (FAILED(hr)) {
         texture->Release();
         response.error = "Failed to create staging texture";
@@ -182,48 +849,154 @@ static CaptureResponse ProcessCaptureFrame() {
     D3D11_MAPPED_SUBRESOURCE mapped;
     hr = g_D3DContext->GetContext()->Map(stagingTexture, 0, D3D11_MAP_READ, 0, &mapped);
     if (FAILED(hr)) {
-        stagingTexture->Release();
         response.error = "Failed to map staging texture";
         // Try to return cached frame
-        CaptureResponse cached = GetCachedFrame();
+        CaptureResponse cached = GetFallbackFrame();
         if (cached.success) {
             return cached;
         }
         return response;
     }
     
-    response.stride = mapped.RowPitch;
-    
-    // Allocate output buffer and copy data
-    size_t dataSize = (size_t)mapped.RowPitch * (size_t)desc.Height;
+    SImageView source;
+    source.Data = static_cast<const uint8_t*>(mapped.pData);
+    source.Width = static_cast<int>(desc.Width);
+    source.Height = static_cast<int>(desc.Height);
+    source.Stride = static_cast<int>(mapped.RowPitch);
+    source.Format = desc.Format == DXGI_FORMAT_R16G16B16A16_FLOAT ? EPixelFormat::RGBA16F : EPixelFormat::BGRA8;
     
-    // Use HeapAlloc for better Windows compatibility
-    response.frameData = HeapAlloc(GetProcessHeap(), 0, dataSize);
-    if (!response.frameData) {
+    if (!CopyFrameToResponse(source, response)) {
         g_D3DContext->GetContext()->Unmap(stagingTexture, 0);
-        stagingTexture->Release();
         response.error = "Failed to allocate memory";
         // Try to return cached frame
-        CaptureResponse cached = GetCachedFrame();
+        CaptureResponse cached = GetFallbackFrame();
         if (cached.success) {
             return cached;
         }
         return response;
     }
+    g_D3DContext->GetContext()->Unmap(stagingTexture, 0);
     
-    memcpy(response.frameData, mapped.pData, dataSize);
+    response.sequence = stamp.Sequence;
+    response.presentationTime = stamp.PresentationTime;
+    response.generation = stamp.Generation;
+    response.readbackTime = QueryTime100ns();
+    
+    // Frames that arrived after the previous delivery but were superseded before readback
+    bool isNewFrame = stamp.Sequence > g_LastDeliveredSequence;
+    if (g_LastDeliveredSequence != 0 && stamp.Sequence > g_LastDeliveredSequence + 1) {
+        response.droppedFrames = static_cast<int>(stamp.Sequence - g_LastDeliveredSequence - 1);
+    }
+    if (isNewFrame) {
+        g_LastDeliveredSequence = stamp.Sequence;
+    }
     
     // Cache this successful frame for future fallback
-    CacheFrame(response.frameData, response.width, response.height, response.stride);
+    std::shared_ptr<const CachedFrame> cached = CacheFrame(response, keepFrameNative);
     
-    // Cleanup
-    g_D3DContext->GetContext()->Unmap(stagingTexture, 0);
-    stagingTexture->Release();
+    if (isNewFrame) {
+        RecordFrame(response);
+        QueueHistoryFrame(cached);
+        PublishServerFrame(response);
+        PublishFrameResults(response);
+    }
+    
+    response.success = true;
+    return response;
+}
+
+// Stop and delete the capture object. Its successor counts frames from 1 again.
+static void DestroyWindowCapture() {
+    if (g_WindowCapture) {
+        g_WindowCapture->StopCapture();
+        delete g_WindowCapture;
+        g_WindowCapture = nullptr;
+    }
+    g_LastDeliveredSequence = 0;
+}
+
+static double ElapsedMs(StartupClock::time_point since) {
+    return std::chrono::duration<double, std::milli>(StartupClock::now() - since).count();
+}
+
+// Create the D3D11 device and capture object (runs on the capture thread).
+// Device creation and the capture item factory lookup run on worker threads while
+// this thread sets up its WinRT apartment and dispatcher queue.
+static CaptureResponse InitializeCaptureSystem() {
+    CaptureResponse response;
+    
+    if (g_Initialized) {
+        response.success = true;
+        return response;
+    }
+    
+    StartupClock::time_point initializeBegin = StartupClock::now();
+    
+    CD3D11Context* context = new CD3D11Context();
+    HRESULT deviceResult = E_FAIL;
+    double deviceMs = 0.0;
+    std::thread deviceThread([&] {
+        StartupClock::time_point begin = StartupClock::now();
+        deviceResult = context->Initialize();
+        deviceMs = ElapsedMs(begin);
+    });
+    
+    double factoryMs = 0.0;
+    std::thread factoryThread([&] {
+        StartupClock::time_point begin = StartupClock::now();
+        CWindowCapture::PrewarmActivationFactories();
+        factoryMs = ElapsedMs(begin);
+    });
+    
+    // Apartment and dispatcher queue belong to this thread
+    StartupClock::time_point dispatcherBegin = StartupClock::now();
+    CWindowCapture* capture = new CWindowCapture();
+    double dispatcherMs = ElapsedMs(dispatcherBegin);
+    
+    deviceThread.join();
+    factoryThread.join();
+    
+    if (FAILED(deviceResult)) {
+        delete capture;
+        delete context;
+        response.error = "Failed to initialize D3D11";
+        return response;
+    }
+    
+    g_D3DContext = context;
+    g_WindowCapture = capture;
+    g_LastDeliveredSequence = 0;
+    g_WindowCapture->Initialize(g_D3DContext);
+    g_WindowCapture->SetCaptureFormat(ToDXGIFormat(g_CaptureFormat));
+    g_Initialized = true;
+    
+    {
+        std::lock_guard<std::mutex> lock(g_TimingMutex);
+        g_StartupTimings.deviceMs = deviceMs;
+        g_StartupTimings.dispatcherMs = dispatcherMs;
+        g_StartupTimings.factoryMs = factoryMs;
+        g_StartupTimings.initializeMs = ElapsedMs(initializeBegin);
+        g_StartupTimings.totalMs = g_StartupTimings.threadStartMs + g_StartupTimings.initializeMs;
+        
+        char buf[256];
+        sprintf_s(buf, "[WindowCaptureAPI] Startup %.1f ms (thread %.1f, device %.1f, dispatcher %.1f, factory %.1f, initialize %.1f)\n",
+            g_StartupTimings.totalMs, g_StartupTimings.threadStartMs, deviceMs, dispatcherMs, factoryMs,
+            g_StartupTimings.initializeMs);
+        OutputDebugStringA(buf);
+    }
     
     response.success = true;
     return response;
 }
 
+static void SignalThreadReady() {
+    {
+        std::lock_guard<std::mutex> lock(g_ReadyMutex);
+        g_ThreadReady = true;
+    }
+    g_ReadyCV.notify_all();
+}
+
 // Capture thread main function
 static void CaptureThreadMain() {
     // Initialize COM for this thread (required for WinRT)
@@ -231,6 +1004,7 @@ static void CaptureThreadMain() {
     if (FAILED(hr) && hr != RPC_E_CHANGED_MODE) {
         SetError("Failed to initialize COM in capture thread");
         g_ThreadRunning = false;
+        SignalThreadReady();
         return;
     }
     
@@ -238,6 +1012,20 @@ static void CaptureThreadMain() {
     MSG msg;
     PeekMessage(&msg, NULL, WM_USER, WM_USER, PM_NOREMOVE);
     
+    {
+        std::lock_guard<std::mutex> lock(g_TimingMutex);
+        g_StartupTimings.threadStartMs = ElapsedMs(g_StartupBegin);
+    }
+    SignalThreadReady();
+    
+    // WC_Prewarm: pay for device and WinRT setup now instead of at the first capture
+    if (g_PrewarmOnStart.exchange(false) && g_ThreadRunning) {
+        CaptureResponse prewarm = InitializeCaptureSystem();
+        if (!prewarm.success) {
+            SetError(prewarm.error.c_str());
+        }
+    }
+    
     while (g_ThreadRunning) {
         // Process Windows messages (required for WinRT callbacks)
         while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
@@ -260,34 +1048,23 @@ static void CaptureThreadMain() {
                 
                 switch (request.type) {
                     case CaptureRequestType::Initialize: {
-                        if (g_Initialized) {
-                            response.success = true;
-                        } else {
-                            // Create D3D11 context
-                            g_D3DContext = new CD3D11Context();
-                            hr = g_D3DContext->Initialize();
-                            if (FAILED(hr)) {
-                                delete g_D3DContext;
-                                g_D3DContext = nullptr;
-                                response.error = "Failed to initialize D3D11";
-                            } else {
-                                // Create window capture
-                                g_WindowCapture = new CWindowCapture();
-                                g_WindowCapture->Initialize(g_D3DContext);
-                                g_Initialized = true;
-                                response.success = true;
-                            }
-                        }
+                        response = InitializeCaptureSystem();
                         break;
                     }
                     
-                    case CaptureRequestType::StartCapture: {
+                    case CaptureRequestType::StartCapture:
+                    case CaptureRequestType::Retarget: {
+                        bool retarget = request.type == CaptureRequestType::Retarget;
                         if (!g_Initialized || !g_WindowCapture) {
                             response.error = "Not initialized";
                         } else if (!IsWindow(request.hwnd)) {
                             response.error = "Invalid window handle";
                         } else {
-                            hr = g_WindowCapture->StartCapture(request.hwnd);
+                            if (retarget) {
+                                hr = g_WindowCapture->Retarget(request.hwnd);
+                            } else {
+                                hr = g_WindowCapture->StartCapture(request.hwnd);
+                            }
                             if (FAILED(hr)) {
                                 // Provide human-readable error messages
                                 const char* detail = nullptr;
@@ -304,13 +1081,16 @@ static void CaptureThreadMain() {
                                     default:
                                         detail = nullptr;
                                 }
+                                const char* action = retarget ? "retarget" : "start";
                                 char errBuf[256];
                                 if (detail) {
-                                    sprintf_s(errBuf, "Failed to start capture: %s (HRESULT: 0x%08X)", detail, hr);
+                                    sprintf_s(errBuf, "Failed to %s capture: %s (HRESULT: 0x%08X)", action, detail, hr);
                                 } else {
-                                    sprintf_s(errBuf, "Failed to start capture (HRESULT: 0x%08X)", hr);
+                                    sprintf_s(errBuf, "Failed to %s capture (HRESULT: 0x%08X)", action, hr);
                                 }
                                 response.error = errBuf;
+                                // A failed retarget that could not restore a session leaves nothing running
+                                g_IsCapturing = g_WindowCapture->IsCapturing();
                             } else {
                                 g_IsCapturing = true;
                                 response.success = true;
@@ -325,56 +1105,208 @@ static void CaptureThreadMain() {
                             g_WindowCapture->StopCapture();
                         }
                         // Clear frame cache when stopping capture
-                        if (g_LastFrameData) {
-                            HeapFree(GetProcessHeap(), 0, g_LastFrameData);
-                            g_LastFrameData = nullptr;
-                            g_LastFrameWidth = 0;
-                            g_LastFrameHeight = 0;
-                            g_LastFrameStride = 0;
-                            g_LastFrameSize = 0;
-                        }
+                        ClearFrameCache();
                         response.success = true;
                         break;
                     }
                     
                     case CaptureRequestType::CaptureFrame: {
-                        response = ProcessCaptureFrame();
+                        response = ProcessCaptureFrame(request.keepFrameNative);
+                        // The pixels stay in the frame cache for the analysis calls
+                        if (request.keepFrameNative && response.frameData) {
+                            if (!response.frameOwnedByCache) {
+                                HeapFree(GetProcessHeap(), 0, response.frameData);
+                            }
+                            response.frameData = nullptr;
+                        }
                         break;
                     }
                     
-                    case CaptureRequestType::Cleanup: {
-                        g_IsCapturing = false;
-                        // Clear frame cache
-                        if (g_LastFrameData) {
-                            HeapFree(GetProcessHeap(), 0, g_LastFrameData);
-                            g_LastFrameData = nullptr;
-                            g_LastFrameWidth = 0;
-                            g_LastFrameHeight = 0;
-                            g_LastFrameStride = 0;
-                            g_LastFrameSize = 0;
+                    case CaptureRequestType::SetFormat: {
+                        if (g_RecordingWriter && request.outputFormat != WC_OUTPUT_FORMAT_BGRA8) {
+                            response.error = "Stop the recording before leaving BGRA8 output";
+                            break;
                         }
                         if (g_WindowCapture) {
-                            g_WindowCapture->StopCapture();
-                            delete g_WindowCapture;
-                            g_WindowCapture = nullptr;
+                            hr = g_WindowCapture->SetCaptureFormat(ToDXGIFormat(request.captureFormat));
+                        } else {
+                            hr = S_OK;
                         }
-                        if (g_D3DContext) {
-                            g_D3DContext->Cleanup();
+                        if (FAILED(hr)) {
+                            response.error = "Failed to change capture format";
+                        } else {
+                            // A cached frame in the old format must not be returned as fallback
+                            if (request.captureFormat != g_CaptureFormat || request.outputFormat != g_OutputFormat) {
+                                ClearFrameCache();
+                            }
+                            g_CaptureFormat = request.captureFormat;
+                            g_OutputFormat = request.outputFormat;
+                            response.success = true;
+                        }
+                        break;
+                    }
+                    
+                    case CaptureRequestType::SetToneMapping: {
+                        g_ToneMapper.Configure(request.toneMapping);
+                        response.success = true;
+                        break;
+                    }
+                    
+                    case CaptureRequestType::GetFrameIntervalStats: {
+                        if (!g_WindowCapture || !g_WindowCapture->IsCapturing()) {
+                            response.error = "Not capturing";
+                        } else {
+                            CFrameIntervalModel model = g_WindowCapture->GetFrameIntervalModel();
+                            if (!model.HasEstimate()) {
+                                response.error = "Not enough frames observed";
+                            } else {
+                                response.meanIntervalMs = model.GetMeanInterval() / 10000.0;
+                                response.jitterMs = model.GetJitter() / 10000.0;
+                                response.success = true;
+                            }
+                        }
+                        break;
+                    }
+                    
+                    case CaptureRequestType::StartRecording: {
+                        // The codec only takes BGRA8; a GRAY8 session would record nothing
+                        if (g_OutputFormat != WC_OUTPUT_FORMAT_BGRA8) {
+                            response.error = "Recording needs BGRA8 output";
+                            break;
+                        }
+                        StopRecording();
+                        g_RecordingWriter = new CRecordingWriter();
+                        if (!g_RecordingWriter->Open(request.path.c_str())) {
+                            delete g_RecordingWriter;
+                            g_RecordingWriter = nullptr;
+                            response.error = "Failed to create recording file";
+                        } else {
+                            g_RecordingEncoder = new CFrameEncoder();
+                            response.success = true;
+                        }
+                        break;
+                    }
+                    
+                    case CaptureRequestType::StopRecording: {
+                        response.success = g_RecordingWriter != nullptr;
+                        if (!response.success) {
+                            response.error = "Not recording";
+                        }
+                        StopRecording();
+                        break;
+                    }
+                    
+                    case CaptureRequestType::StartReplay: {
+                        StopReplay();
+                        CRecordingSource* source = new CRecordingSource();
+                        if (!source->Open(request.path.c_str())) {
+                            delete source;
+                            response.error = "Failed to open recording";
+                        } else {
+                            // Replayed frames replace the live ones, the live cache must not leak into them
+                            ClearFrameCache();
+                            ResetFramePyramid();
+                            g_ReplaySource = source;
+                            g_IsReplaying = true;
+                            response.success = true;
+                        }
+                        break;
+                    }
+                    
+                    case CaptureRequestType::SeekReplay: {
+                        if (!g_ReplaySource) {
+                            response.error = "Not replaying";
+                        } else {
+                            g_ReplaySource->SeekToTime(request.timestamp);
+                            response.success = true;
+                        }
+                        break;
+                    }
+                    
+                    case CaptureRequestType::StopReplay: {
+                        StopReplay();
+                        ClearFrameCache();
+                        ResetFramePyramid();
+                        response.success = true;
+                        break;
+                    }
+                    
+                    case CaptureRequestType::EnableReplayBuffer: {
+                        DisableReplayBuffer();
+                        
+                        SFrameCodecSettings codecSettings;
+                        codecSettings.KeyframeInterval = 0;  // The buffer decides when it needs keyframes
+                        std::lock_guard<std::mutex> replayLock(g_ReplayMutex);
+                        g_ReplayBuffer = std::make_shared<CReplayBuffer>(request.replayBuffer);
+                        g_ReplayEncoder = new CFrameEncoder(codecSettings);
+                        response.success = true;
+                        break;
+                    }
+                    
+                    case CaptureRequestType::DisableReplayBuffer: {
+                        DisableReplayBuffer();
+                        response.success = true;
+                        break;
+                    }
+                    
+                    case CaptureRequestType::DumpReplay: {
+                        if (!g_ReplayBuffer) {
+                            response.error = "Replay buffer not enabled";
+                        } else if (g_DumpStatus.load() == WC_REPLAY_DUMP_RUNNING) {
+                            response.error = "Replay dump already in progress";
+                        } else if (g_ReplayBuffer->GetFrameCount() == 0) {
+                            response.error = "Replay buffer is empty";
+                        } else {
+                            // Compression already happened at capture time, the dump thread only copies and writes
+                            JoinDumpThread();
+                            g_DumpStatus = WC_REPLAY_DUMP_RUNNING;
+                            std::shared_ptr<CReplayBuffer> buffer = g_ReplayBuffer;
+                            std::string path = request.path;
+                            g_DumpThread = std::thread([buffer, path] {
+                                bool written = buffer->Dump(path.c_str());
+                                g_DumpStatus = written ? WC_REPLAY_DUMP_DONE : WC_REPLAY_DUMP_FAILED;
+                            });
+                            response.success = true;
+                        }
+                        break;
+                    }
+                    
+                    case CaptureRequestType::Cleanup: {
+                        g_IsCapturing = false;
+                        StopRecording();
+                        StopReplay();
+                        StopHistoryWorker();
+                        DisableReplayBuffer();
+                        JoinDumpThread();
+                        // Clear frame cache
+                        ClearFrameCache();
+                        ResetFramePyramid();
+                        DestroyWindowCapture();
+                        ReleaseStagingTexture();
+                        if (g_D3DContext) {
+                            g_D3DContext->Cleanup();
                             delete g_D3DContext;
                             g_D3DContext = nullptr;
                         }
                         g_Initialized = false;
+                        {
+                            // The thread stays up, a later Initialize only pays for the device and WinRT setup
+                            std::lock_guard<std::mutex> timingLock(g_TimingMutex);
+                            g_StartupTimings = {};
+                        }
                         response.success = true;
                         break;
                     }
                     
                     case CaptureRequestType::Shutdown: {
                         g_IsCapturing = false;
-                        if (g_WindowCapture) {
-                            g_WindowCapture->StopCapture();
-                            delete g_WindowCapture;
-                            g_WindowCapture = nullptr;
-                        }
+                        StopRecording();
+                        StopReplay();
+                        StopHistoryWorker();
+                        DisableReplayBuffer();
+                        JoinDumpThread();
+                        DestroyWindowCapture();
+                        ReleaseStagingTexture();
                         if (g_D3DContext) {
                             g_D3DContext->Cleanup();
                             delete g_D3DContext;
@@ -395,6 +1327,7 @@ static void CaptureThreadMain() {
         }
     }
     
+    StopHistoryWorker();
     CoUninitialize();
 }
 
@@ -426,17 +1359,40 @@ static CaptureResponse SendRequest(const CaptureRequest& request, int timeoutMs
     return response;
 }
 
-// Start the capture thread
-static bool StartCaptureThread() {
+// Start the capture thread and wait until its message queue exists
+static bool StartCaptureThread(bool prewarm = false) {
     if (g_ThreadRunning) {
         return true;
     }
     
+    // A previous thread may have exited on its own after a failed start
+    if (g_CaptureThread.joinable()) {
+        g_CaptureThread.join();
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(g_TimingMutex);
+        g_StartupTimings = {};
+        g_StartupBegin = StartupClock::now();
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(g_ReadyMutex);
+        g_ThreadReady = false;
+    }
+    
+    g_PrewarmOnStart = prewarm;
     g_ThreadRunning = true;
     g_CaptureThread = std::thread(CaptureThreadMain);
     
-    // Wait a bit for thread to initialize
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::unique_lock<std::mutex> lock(g_ReadyMutex);
+    if (!g_ReadyCV.wait_for(lock, std::chrono::seconds(5), [] { return g_ThreadReady; })) {
+        // Cleared before the thread can signal, so it skips prewarming and leaves its loop
+        g_ThreadRunning = false;
+        lock.unlock();
+        g_CaptureThread.join();
+        return false;
+    }
     
     return g_ThreadRunning;
 }
@@ -444,6 +1400,10 @@ static bool StartCaptureThread() {
 // Stop the capture thread
 static void StopCaptureThread() {
     if (!g_ThreadRunning) {
+        // It may have exited on its own after a failed start
+        if (g_CaptureThread.joinable()) {
+            g_CaptureThread.join();
+        }
         return;
     }
     
@@ -479,6 +1439,30 @@ WC_API bool WC_Initialize() {
     return response.success;
 }
 
+WC_API bool WC_Prewarm() {
+    if (g_ThreadRunning) {
+        return true;
+    }
+    
+    if (!StartCaptureThread(true)) {
+        SetError("Failed to start capture thread");
+        return false;
+    }
+    
+    return true;
+}
+
+WC_API bool WC_GetStartupTimings(WC_StartupTimings* outTimings) {
+    if (!outTimings) {
+        SetError("Invalid parameter: outTimings is null");
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(g_TimingMutex);
+    *outTimings = g_StartupTimings;
+    return g_StartupTimings.totalMs > 0.0;
+}
+
 WC_API void WC_Cleanup() {
     CaptureRequest request;
     request.type = CaptureRequestType::Cleanup;
@@ -498,6 +1482,19 @@ WC_API bool WC_StartCapture(HWND hwnd) {
     return response.success;
 }
 
+WC_API bool WC_RetargetCapture(HWND hwnd) {
+    CaptureRequest request;
+    request.type = CaptureRequestType::Retarget;
+    request.hwnd = hwnd;
+    CaptureResponse response = SendRequest(request);
+    
+    if (!response.success) {
+        SetError(response.error.c_str());
+    }
+    
+    return response.success;
+}
+
 WC_API void WC_StopCapture() {
     CaptureRequest request;
     request.type = CaptureRequestType::StopCapture;
@@ -506,6 +1503,9 @@ WC_API void WC_StopCapture() {
 
 WC_API bool WC_IsCapturing() {
     // Only check atomic flags - thread-safe
+    if (g_ThreadRunning.load() && g_IsReplaying.load()) {
+        return true;
+    }
     return g_ThreadRunning.load() && g_Initialized.load() && g_IsCapturing.load();
 }
 
@@ -597,11 +1597,59 @@ WC_API bool WC_CaptureFrameInfo(WC_FrameInfo* outInfo) {
     return true;
 }
 
+WC_API bool WC_CaptureFrameInfoEx(WC_FrameInfoEx* outInfo) {
+    if (!outInfo) {
+        SetError("Invalid parameter: outInfo is null");
+        return false;
+    }
+    
+    memset(outInfo, 0, sizeof(WC_FrameInfoEx));
+    
+    if (!g_ThreadRunning) {
+        SetError("Capture thread not running");
+        return false;
+    }
+    
+    CaptureRequest request;
+    request.type = CaptureRequestType::CaptureFrame;
+    CaptureResponse response = SendRequest(request, 1000);
+    
+    if (!response.success) {
+        SetError(response.error.c_str());
+        return false;
+    }
+    
+    if (response.frameData == nullptr) {
+        SetError("Frame data is null despite success");
+        return false;
+    }
+    
+    if (response.width <= 0 || response.height <= 0 || response.stride <= 0) {
+        SetError("Invalid frame dimensions in response");
+        HeapFree(GetProcessHeap(), 0, response.frameData);
+        return false;
+    }
+    
+    outInfo->width = response.width;
+    outInfo->height = response.height;
+    outInfo->stride = response.stride;
+    outInfo->data = response.frameData;
+    outInfo->format = response.format;
+    outInfo->isCached = response.isCached ? 1 : 0;
+    outInfo->sequence = response.sequence;
+    outInfo->presentationTime = response.presentationTime;
+    outInfo->readbackTime = response.readbackTime;
+    outInfo->droppedFrames = response.droppedFrames;
+    outInfo->generation = static_cast<int>(response.generation);
+    
+    return true;
+}
+
 // Global variable to cache last frame buffer size for WC_GetFrameBufferSize
 static std::atomic<int> g_CachedBufferSize{0};
 
 WC_API int WC_GetFrameBufferSize() {
-    if (!g_ThreadRunning.load() || !g_IsCapturing.load()) {
+    if (!g_ThreadRunning.load() || (!g_IsCapturing.load() && !g_IsReplaying.load())) {
         return 0;
     }
     
@@ -695,8 +1743,2082 @@ WC_API const char* WC_GetLastError() {
     return g_LastErrorBuffer;
 }
 
-WC_API void WC_Shutdown() {
-    StopCaptureThread();
+WC_API bool WC_SetCaptureFormat(int captureFormat, int outputFormat) {
+    if ((captureFormat != WC_CAPTURE_FORMAT_BGRA8 && captureFormat != WC_CAPTURE_FORMAT_RGBA16F) ||
+        (outputFormat != WC_OUTPUT_FORMAT_BGRA8 && outputFormat != WC_OUTPUT_FORMAT_GRAY8)) {
+        SetError("Invalid pixel format");
+        return false;
+    }
+    
+    CaptureRequest request;
+    request.type = CaptureRequestType::SetFormat;
+    request.captureFormat = captureFormat;
+    request.outputFormat = outputFormat;
+    CaptureResponse response = SendRequest(request);
+    
+    if (!response.success) {
+        SetError(response.error.c_str());
+        return false;
+    }
+    
+    // Frame size depends on the output format
+    g_CachedBufferSize = 0;
+    return true;
+}
+
+WC_API bool WC_SetToneMapping(float exposure, float whitePoint) {
+    if (!(exposure >= 0.0f) || !(whitePoint > 0.0f)) {
+        SetError("Invalid tone mapping parameters");
+        return false;
+    }
+    
+    CaptureRequest request;
+    request.type = CaptureRequestType::SetToneMapping;
+    request.toneMapping.Exposure = exposure;
+    request.toneMapping.WhitePoint = whitePoint;
+    CaptureResponse response = SendRequest(request);
+    
+    if (!response.success) {
+        SetError(response.error.c_str());
+    }
+    
+    return response.success;
+}
+
+WC_API bool WC_SetFrameWaitMode(int mode, int budgetMs) {
+    if (mode != WC_WAIT_NEXT_FRAME && mode != WC_WAIT_LATEST_NOW && mode != WC_WAIT_WITHIN_BUDGET) {
+        SetError("Invalid frame wait mode");
+        return false;
+    }
+    if (budgetMs < 0) {
+        SetError("Invalid frame wait budget");
+        return false;
+    }
+    
+    g_FrameWaitBudgetMs = budgetMs;
+    g_FrameWaitMode = mode;
+    return true;
+}
+
+WC_API bool WC_GetFrameIntervalStats(double* outMeanIntervalMs, double* outJitterMs) {
+    if (!outMeanIntervalMs || !outJitterMs) {
+        SetError("Invalid parameters");
+        return false;
+    }
+    
+    *outMeanIntervalMs = 0.0;
+    *outJitterMs = 0.0;
+    
+    CaptureRequest request;
+    request.type = CaptureRequestType::GetFrameIntervalStats;
+    CaptureResponse response = SendRequest(request);
+    
+    if (!response.success) {
+        SetError(response.error.c_str());
+        return false;
+    }
+    
+    *outMeanIntervalMs = response.meanIntervalMs;
+    *outJitterMs = response.jitterMs;
+    return true;
+}
+
+WC_API bool WC_StartRecording(const char* path) {
+    if (!path || !path[0]) {
+        SetError("Invalid parameter: path is empty");
+        return false;
+    }
+    
+    CaptureRequest request;
+    request.type = CaptureRequestType::StartRecording;
+    request.path = path;
+    CaptureResponse response = SendRequest(request);
+    
+    if (!response.success) {
+        SetError(response.error.c_str());
+    }
+    
+    return response.success;
+}
+
+WC_API bool WC_StopRecording() {
+    CaptureRequest request;
+    request.type = CaptureRequestType::StopRecording;
+    CaptureResponse response = SendRequest(request);
+    
+    if (!response.success) {
+        SetError(response.error.c_str());
+    }
+    
+    return response.success;
+}
+
+WC_API bool WC_StartReplay(const char* path) {
+    if (!path || !path[0]) {
+        SetError("Invalid parameter: path is empty");
+        return false;
+    }
+    
+    // Replay needs the capture thread but no D3D device or window
+    if (!StartCaptureThread()) {
+        SetError("Failed to start capture thread");
+        return false;
+    }
+    
+    CaptureRequest request;
+    request.type = CaptureRequestType::StartReplay;
+    request.path = path;
+    CaptureResponse response = SendRequest(request);
+    
+    if (!response.success) {
+        SetError(response.error.c_str());
+    }
+    
+    g_CachedBufferSize = 0;
+    return response.success;
+}
+
+WC_API bool WC_SeekReplay(long long timestamp) {
+    CaptureRequest request;
+    request.type = CaptureRequestType::SeekReplay;
+    request.timestamp = timestamp;
+    CaptureResponse response = SendRequest(request);
+    
+    if (!response.success) {
+        SetError(response.error.c_str());
+    }
+    
+    return response.success;
+}
+
+WC_API void WC_StopReplay() {
+    CaptureRequest request;
+    request.type = CaptureRequestType::StopReplay;
+    SendRequest(request);
+    g_CachedBufferSize = 0;
+}
+
+WC_API bool WC_EnableReplayBuffer(double seconds, int maxMegabytes) {
+    if (!(seconds > 0.0) || maxMegabytes <= 0) {
+        SetError("Invalid replay buffer limits");
+        return false;
+    }
+    
+    CaptureRequest request;
+    request.type = CaptureRequestType::EnableReplayBuffer;
+    request.replayBuffer.MaxDuration = static_cast<int64_t>(seconds * 10000000.0);
+    request.replayBuffer.MaxBytes = static_cast<size_t>(maxMegabytes) << 20;
+    CaptureResponse response = SendRequest(request);
+    
+    if (!response.success) {
+        SetError(response.error.c_str());
+    }
+    
+    return response.success;
+}
+
+WC_API void WC_DisableReplayBuffer() {
+    CaptureRequest request;
+    request.type = CaptureRequestType::DisableReplayBuffer;
+    SendRequest(request);
+}
+
+WC_API bool WC_DumpReplay(const char* path) {
+    if (!path || !path[0]) {
+        SetError("Invalid parameter: path is empty");
+        return false;
+    }
+    
+    CaptureRequest request;
+    request.type = CaptureRequestType::DumpReplay;
+    request.path = path;
+    CaptureResponse response = SendRequest(request);
+    
+    if (!response.success) {
+        SetError(response.error.c_str());
+    }
+    
+    return response.success;
+}
+
+WC_API int WC_GetReplayDumpStatus() {
+    return g_DumpStatus.load();
+}
+
+WC_API bool WC_EnableFrameHistory(int maxMegabytes) {
+    if (maxMegabytes <= 0) {
+        SetError("Invalid frame history budget");
+        return false;
+    }
+    
+    SFrameHistorySettings settings;
+    settings.MaxBytes = static_cast<size_t>(maxMegabytes) << 20;
+    std::shared_ptr<CFrameHistory> history = std::make_shared<CFrameHistory>(settings);
+    
+    std::lock_guard<std::mutex> lock(g_HistoryMutex);
+    g_FrameHistory = history;
+    return true;
+}
+
+WC_API void WC_DisableFrameHistory() {
+    std::shared_ptr<CFrameHistory> history;
+    {
+        std::lock_guard<std::mutex> lock(g_HistoryMutex);
+        history.swap(g_FrameHistory);
+    }
+    // Released here, outside the lock, unless the history worker still holds it
+}
+
+WC_API bool WC_GetHistoryFrame(long long timestamp, WC_FrameInfoEx* outInfo) {
+    if (!outInfo) {
+        SetError("Invalid parameter: outInfo is null");
+        return false;
+    }
+    
+    memset(outInfo, 0, sizeof(WC_FrameInfoEx));
+    
+    std::shared_ptr<CFrameHistory> history;
+    {
+        std::lock_guard<std::mutex> lock(g_HistoryMutex);
+        history = g_FrameHistory;
+    }
+    if (!history) {
+        SetError("Frame history not enabled");
+        return false;
+    }
+    
+    // Runs on the calling thread, capture keeps going meanwhile
+    uint64_t id = 0;
+    int width = 0;
+    int height = 0;
+    int64_t presentationTime = 0;
+    uint64_t sequence = 0;
+    if (!history->FindFrame(timestamp, id) ||
+        !history->GetFrameInfo(id, width, height, presentationTime, sequence)) {
+        SetError("No frame at or before the timestamp");
+        return false;
+    }
+    
+    int stride = width * 4;
+    void* data = HeapAlloc(GetProcessHeap(), 0, (size_t)stride * (size_t)height);
+    if (!data) {
+        SetError("Failed to allocate memory");
+        return false;
+    }
+    
+    // The frame may have been evicted since the lookup, then the read fails
+    if (!history->ReadFrame(id, static_cast<uint8_t*>(data), stride)) {
+        HeapFree(GetProcessHeap(), 0, data);
+        SetError("Frame no longer in history");
+        return false;
+    }
+    
+    outInfo->width = width;
+    outInfo->height = height;
+    outInfo->stride = stride;
+    outInfo->data = data;
+    outInfo->format = WC_OUTPUT_FORMAT_BGRA8;
+    outInfo->sequence = sequence;
+    outInfo->presentationTime = presentationTime;
+    return true;
+}
+
+WC_API bool WC_GetFrameHistoryStats(WC_FrameHistoryStats* outStats) {
+    if (!outStats) {
+        SetError("Invalid parameter: outStats is null");
+        return false;
+    }
+    
+    memset(outStats, 0, sizeof(WC_FrameHistoryStats));
+    
+    std::shared_ptr<CFrameHistory> history;
+    {
+        std::lock_guard<std::mutex> lock(g_HistoryMutex);
+        history = g_FrameHistory;
+    }
+    if (!history) {
+        SetError("Frame history not enabled");
+        return false;
+    }
+    
+    SFrameHistoryStats stats = history->GetStats();
+    outStats->frameCount = static_cast<long long>(stats.FrameCount);
+    outStats->uniqueFrames = static_cast<long long>(stats.GridCount);
+    outStats->uniqueTiles = static_cast<long long>(stats.TileCount);
+    outStats->bytesUsed = static_cast<long long>(stats.BytesUsed);
+    outStats->oldestTimestamp = stats.OldestTimestamp;
+    outStats->newestTimestamp = stats.NewestTimestamp;
+    return true;
+}
+
+WC_API bool WC_SaveFrameAsync(const WC_FrameInfoEx* frame, const char* path, int imageFormat) {
+    if (!frame || !frame->data || !path) {
+        SetError("Invalid parameter");
+        return false;
+    }
+    if (imageFormat != WC_IMAGE_FORMAT_PNG && imageFormat != WC_IMAGE_FORMAT_QOI) {
+        SetError("Invalid image format");
+        return false;
+    }
+    
+    SImageView view;
+    view.Data = static_cast<const uint8_t*>(frame->data);
+    view.Width = frame->width;
+    view.Height = frame->height;
+    view.Stride = frame->stride;
+    view.Format = frame->format == WC_OUTPUT_FORMAT_GRAY8 ? EPixelFormat::Gray8 : EPixelFormat::BGRA8;
+    
+    std::lock_guard<std::mutex> lock(g_ScreenshotMutex);
+    if (!g_ScreenshotService) {
+        g_ScreenshotService = std::make_unique<CScreenshotService>();
+    }
+    
+    // Only the pixel copy happens here, the caller may free the frame right after
+    if (!g_ScreenshotService->Submit(view, path, static_cast<EImageFileFormat>(imageFormat))) {
+        SetError(view.IsValid() ? "Too many frames waiting to be saved" : "Invalid frame");
+        return false;
+    }
+    return true;
+}
+
+WC_API void WC_WaitForSavedFrames() {
+    std::lock_guard<std::mutex> lock(g_ScreenshotMutex);
+    if (g_ScreenshotService) {
+        g_ScreenshotService->Flush();
+    }
+}
+
+WC_API bool WC_GetSaveStats(WC_SaveStats* outStats) {
+    if (!outStats) {
+        SetError("Invalid parameter: outStats is null");
+        return false;
+    }
+    
+    memset(outStats, 0, sizeof(WC_SaveStats));
+    
+    std::lock_guard<std::mutex> lock(g_ScreenshotMutex);
+    if (g_ScreenshotService) {
+        SScreenshotStats stats = g_ScreenshotService->GetStats();
+        outStats->pending = static_cast<int>(stats.Pending);
+        outStats->completed = static_cast<int>(stats.Completed);
+        outStats->failed = static_cast<int>(stats.Failed);
+        outStats->rejected = static_cast<int>(stats.Rejected);
+    }
+    return true;
+}
+
+WC_API void* WC_EncodeJpeg(const WC_FrameInfoEx* frame, int quality, int downscale, int* outSize) {
+    if (!frame || !frame->data || !outSize) {
+        SetError("Invalid parameter");
+        return nullptr;
+    }
+    
+    *outSize = 0;
+    
+    SImageView view;
+    view.Data = static_cast<const uint8_t*>(frame->data);
+    view.Width = frame->width;
+    view.Height = frame->height;
+    view.Stride = frame->stride;
+    view.Format = frame->format == WC_OUTPUT_FORMAT_GRAY8 ? EPixelFormat::Gray8 : EPixelFormat::BGRA8;
+    
+    SJpegSettings settings;
+    settings.Quality = quality;
+    settings.Downscale = downscale;
+    
+    std::lock_guard<std::mutex> lock(g_JpegMutex);
+    if (!g_JpegEncoder) {
+        g_JpegEncoder = std::make_unique<CJpegEncoder>(settings);
+    } else {
+        g_JpegEncoder->Configure(settings);
+    }
+    
+    if (!g_JpegEncoder->Encode(view, g_JpegOutput)) {
+        SetError("Failed to encode frame");
+        return nullptr;
+    }
+    
+    void* data = HeapAlloc(GetProcessHeap(), 0, g_JpegOutput.size());
+    if (!data) {
+        SetError("Failed to allocate memory");
+        return nullptr;
+    }
+    memcpy(data, g_JpegOutput.data(), g_JpegOutput.size());
+    *outSize = static_cast<int>(g_JpegOutput.size());
+    return data;
+}
+
+WC_API bool WC_StartFrameServer(const char* socketPath) {
+    if (!socketPath || !socketPath[0]) {
+        SetError("Invalid parameter: socketPath is empty");
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(g_FrameServerMutex);
+    if (g_FrameServer) {
+        SetError("Frame server already running");
+        return false;
+    }
+    
+    std::shared_ptr<CFrameServer> server = std::make_shared<CFrameServer>();
+    if (!server->Start(socketPath)) {
+        SetError("Failed to listen on frame server socket");
+        return false;
+    }
+    
+    g_FrameServer = server;
+    return true;
+}
+
+WC_API void WC_StopFrameServer() {
+    std::shared_ptr<CFrameServer> server;
+    {
+        std::lock_guard<std::mutex> lock(g_FrameServerMutex);
+        server.swap(g_FrameServer);
+    }
+    
+    // A publish in flight on the capture thread holds its own reference
+    if (server) {
+        server->Stop();
+    }
+}
+
+WC_API int WC_GetFrameServerClientCount() {
+    std::lock_guard<std::mutex> lock(g_FrameServerMutex);
+    return g_FrameServer ? g_FrameServer->GetClientCount() : 0;
+}
+
+WC_API bool WC_ConnectFrameServer(const char* socketPath, int outputFormat, int roiX, int roiY, int roiWidth, int roiHeight, double maxFps) {
+    if (!socketPath || !socketPath[0]) {
+        SetError("Invalid parameter: socketPath is empty");
+        return false;
+    }
+    if (outputFormat != WC_OUTPUT_FORMAT_BGRA8 && outputFormat != WC_OUTPUT_FORMAT_GRAY8) {
+        SetError("Invalid output format");
+        return false;
+    }
+    if (roiX < 0 || roiY < 0 || roiWidth < 0 || roiHeight < 0 || maxFps < 0.0) {
+        SetError("Invalid parameter: negative ROI or rate");
+        return false;
+    }
+    
+    SFrameSubscription subscription;
+    subscription.Format = outputFormat == WC_OUTPUT_FORMAT_GRAY8 ? EPixelFormat::Gray8 : EPixelFormat::BGRA8;
+    subscription.RoiX = roiX;
+    subscription.RoiY = roiY;
+    subscription.RoiWidth = roiWidth;
+    subscription.RoiHeight = roiHeight;
+    subscription.MinInterval = maxFps > 0.0 ? (int64_t)(10000000.0 / maxFps) : 0;
+    
+    std::lock_guard<std::mutex> lock(g_FrameClientMutex);
+    if (!g_FrameClient) {
+        g_FrameClient.reset(new CFrameClient());
+    }
+    
+    // A live connection to the same server is renegotiated instead of reopened
+    if (g_FrameClient->IsConnected() && g_FrameClientPath == socketPath &&
+        g_FrameClient->Subscribe(subscription)) {
+        return true;
+    }
+    
+    if (!g_FrameClient->Connect(socketPath, subscription)) {
+        SetError("Failed to connect to frame server");
+        return false;
+    }
+    g_FrameClientPath = socketPath;
+    return true;
+}
+
+WC_API bool WC_ReceiveFrame(int timeoutMs, WC_FrameInfoEx* outInfo) {
+    if (!outInfo) {
+        SetError("Invalid parameter: outInfo is null");
+        return false;
+    }
+    
+    memset(outInfo, 0, sizeof(WC_FrameInfoEx));
+    
+    std::lock_guard<std::mutex> lock(g_FrameClientMutex);
+    if (!g_FrameClient || !g_FrameClient->IsConnected()) {
+        SetError("Not connected to a frame server");
+        return false;
+    }
+    
+    SRingFrameInfo info;
+    if (!g_FrameClient->WaitFrame(timeoutMs, g_FrameClientPixels, info)) {
+        SetError(g_FrameClient->IsConnected() ? "Timed out waiting for a frame" : "Frame server disconnected");
+        return false;
+    }
+    
+    void* data = HeapAlloc(GetProcessHeap(), 0, g_FrameClientPixels.size());
+    if (!data) {
+        SetError("Failed to allocate memory");
+        return false;
+    }
+    memcpy(data, g_FrameClientPixels.data(), g_FrameClientPixels.size());
+    
+    outInfo->width = info.Width;
+    outInfo->height = info.Height;
+    outInfo->stride = info.Width * GetBytesPerPixel(info.Format);
+    outInfo->data = data;
+    outInfo->format = info.Format == EPixelFormat::Gray8 ? WC_OUTPUT_FORMAT_GRAY8 : WC_OUTPUT_FORMAT_BGRA8;
+    outInfo->sequence = info.Sequence;
+    outInfo->presentationTime = info.Timestamp;
+    outInfo->droppedFrames = static_cast<int>(info.Dropped);
+    return true;
+}
+
+WC_API void WC_DisconnectFrameServer() {
+    std::lock_guard<std::mutex> lock(g_FrameClientMutex);
+    g_FrameClient.reset();
+    g_FrameClientPath.clear();
+    std::vector<uint8_t>().swap(g_FrameClientPixels);
+}
+
+WC_API bool WC_EnableResultBoard(const char* sharedName) {
+    std::shared_ptr<ResultBoardState> state = std::make_shared<ResultBoardState>();
+    CResultBoard& board = state->board;
+    state->sequence = board.AddField("frame.sequence", EResultFieldType::Int64);
+    state->presentationTime = board.AddField("frame.presentationTime", EResultFieldType::Int64);
+    state->readbackTime = board.AddField("frame.readbackTime", EResultFieldType::Int64);
+    state->width = board.AddField("frame.width", EResultFieldType::Int32);
+    state->height = board.AddField("frame.height", EResultFieldType::Int32);
+    state->droppedFrames = board.AddField("frame.droppedFrames", EResultFieldType::Int32);
+    state->firstCallerField = static_cast<int>(board.GetFields().size());
+    
+    std::lock_guard<std::mutex> lock(g_ResultBoardMutex);
+    if (g_ResultBoard) {
+        SetError("Result board already enabled");
+        return false;
+    }
+    for (const ResultFieldDeclaration& field : g_ResultFields) {
+        if (board.AddField(field.name, field.type, field.count) < 0) {
+            SetError(("Failed to add result field " + field.name).c_str());
+            return false;
+        }
+    }
+    if (!board.Create(sharedName ? sharedName : "")) {
+        SetError("Failed to create result board shared memory");
+        return false;
+    }
+    
+    g_ResultBoard = state;
+    return true;
+}
+
+WC_API void WC_DisableResultBoard() {
+    std::lock_guard<std::mutex> lock(g_ResultBoardMutex);
+    g_ResultBoard.reset();
+}
+
+WC_API const void* WC_GetResultBoard(int* outSize) {
+    if (!outSize) {
+        SetError("Invalid parameter: outSize is null");
+        return nullptr;
+    }
+    
+    *outSize = 0;
+    
+    std::lock_guard<std::mutex> lock(g_ResultBoardMutex);
+    if (!g_ResultBoard) {
+        SetError("Result board not enabled");
+        return nullptr;
+    }
+    
+    *outSize = static_cast<int>(g_ResultBoard->board.GetSize());
+    return g_ResultBoard->board.GetData();
+}
+
+WC_API bool WC_AddResultField(const char* name, int type, int count) {
+    if (!name || !name[0] || strlen(name) > 31) {
+        SetError("Invalid parameter: name must be 1-31 characters");
+        return false;
+    }
+    if (strncmp(name, "frame.", 6) == 0) {
+        SetError("Invalid parameter: names starting with frame. are reserved");
+        return false;
+    }
+    if (type < WC_RESULT_INT32 || type > WC_RESULT_FLOAT64 || count < 1) {
+        SetError("Invalid parameter: unknown type or count below 1");
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(g_ResultBoardMutex);
+    if (g_ResultBoard) {
+        SetError("Result fields must be declared before WC_EnableResultBoard");
+        return false;
+    }
+    for (const ResultFieldDeclaration& field : g_ResultFields) {
+        if (field.name == name) {
+            SetError("Result field already declared");
+            return false;
+        }
+    }
+    
+    g_ResultFields.push_back({ name, static_cast<EResultFieldType>(type), count });
+    return true;
+}
+
+WC_API int WC_FindResultField(const char* name) {
+    if (!name) {
+        SetError("Invalid parameter: name is null");
+        return -1;
+    }
+    
+    std::lock_guard<std::mutex> lock(g_ResultBoardMutex);
+    if (!g_ResultBoard) {
+        SetError("Result board not enabled");
+        return -1;
+    }
+    
+    int field = g_ResultBoard->board.FindField(name);
+    if (field < 0) {
+        SetError("Unknown result field");
+    }
+    return field;
+}
+
+WC_API bool WC_PublishResults(const WC_ResultValue* values, int count) {
+    if (!values || count < 0) {
+        SetError("Invalid parameter: values is null or count is negative");
+        return false;
+    }
+    
+    std::shared_ptr<ResultBoardState> state;
+    {
+        std::lock_guard<std::mutex> lock(g_ResultBoardMutex);
+        state = g_ResultBoard;
+    }
+    if (!state) {
+        SetError("Result board not enabled");
+        return false;
+    }
+    
+    // Validate the whole batch so a bad value never leaves half an update behind
+    CResultBoard& board = state->board;
+    const std::vector<SResultField>& fields = board.GetFields();
+    for (int i = 0; i < count; i++) {
+        const WC_ResultValue& value = values[i];
+        if (value.field < state->firstCallerField || value.field >= static_cast<int>(fields.size())) {
+            SetError("Invalid result field");
+            return false;
+        }
+        if (value.element < 0 || static_cast<uint32_t>(value.element) >= fields[value.field].Count) {
+            SetError("Result element out of range");
+            return false;
+        }
+    }
+    
+    board.BeginUpdate();
+    for (int i = 0; i < count; i++) {
+        const WC_ResultValue& value = values[i];
+        switch (fields[value.field].Type) {
+            case EResultFieldType::Int32:
+                board.SetInt32(value.field, static_cast<int32_t>(value.intValue), value.element);
+                break;
+            case EResultFieldType::Int64:
+                board.SetInt64(value.field, static_cast<int64_t>(value.intValue), value.element);
+                break;
+            case EResultFieldType::Float32:
+                board.SetFloat32(value.field, static_cast<float>(value.floatValue), value.element);
+                break;
+            case EResultFieldType::Float64:
+                board.SetFloat64(value.field, value.floatValue, value.element);
+                break;
+        }
+    }
+    board.EndUpdate();
+    return true;
+}
+
+WC_API bool WC_UpdateFrame(WC_FrameInfoEx* outInfo) {
+    if (!outInfo) {
+        SetError("Invalid parameter: outInfo is null");
+        return false;
+    }
+    
+    memset(outInfo, 0, sizeof(WC_FrameInfoEx));
+    
+    if (!g_ThreadRunning) {
+        SetError("Capture thread not running");
+        return false;
+    }
+    
+    CaptureRequest request;
+    request.type = CaptureRequestType::CaptureFrame;
+    request.keepFrameNative = true;
+    CaptureResponse response = SendRequest(request, 1000);
+    
+    if (!response.success) {
+        SetError(response.error.c_str());
+        return false;
+    }
+    
+    outInfo->width = response.width;
+    outInfo->height = response.height;
+    outInfo->stride = response.stride;
+    outInfo->format = response.format;
+    outInfo->isCached = response.isCached ? 1 : 0;
+    outInfo->sequence = response.sequence;
+    outInfo->presentationTime = response.presentationTime;
+    outInfo->readbackTime = response.readbackTime;
+    outInfo->droppedFrames = response.droppedFrames;
+    outInfo->generation = static_cast<int>(response.generation);
+    
+    return true;
+}
+
+WC_API int WC_SamplePixels(const int* points, int count, unsigned int* outColors) {
+    if (!points || !outColors || count <= 0) {
+        SetError("Invalid parameter: points or outColors is null, or count is not positive");
+        return -1;
+    }
+    
+    std::shared_ptr<const CachedFrame> frame = AcquireLatestFrame();
+    if (!frame) {
+        SetError("No frame captured yet");
+        return -1;
+    }
+    
+    return SamplePixels(ViewOfCachedFrame(*frame), reinterpret_cast<const int32_t*>(points), count,
+        reinterpret_cast<uint32_t*>(outColors));
+}
+
+WC_API int WC_SampleNeighbourhoods(const int* points, int count, int size, int mode, unsigned int* outColors) {
+    if (!points || !outColors || count <= 0) {
+        SetError("Invalid parameter: points or outColors is null, or count is not positive");
+        return -1;
+    }
+    if (size < 1 || size > MaxNeighbourhoodSize) {
+        SetError("Invalid neighbourhood size");
+        return -1;
+    }
+    if (mode != WC_SAMPLE_MEAN && mode != WC_SAMPLE_MINMAX) {
+        SetError("Invalid sample mode");
+        return -1;
+    }
+    
+    std::shared_ptr<const CachedFrame> frame = AcquireLatestFrame();
+    if (!frame) {
+        SetError("No frame captured yet");
+        return -1;
+    }
+    
+    return SampleNeighbourhoods(ViewOfCachedFrame(*frame), reinterpret_cast<const int32_t*>(points), count, size,
+        static_cast<ENeighbourhoodMode>(mode), reinterpret_cast<uint32_t*>(outColors));
+}
+
+// Converts the caller's ROIs into g_RoiRequests and lays them out; call with g_RoiMutex held
+static int64_t PrepareRois(const WC_Roi* rois, int count) {
+    if (!rois || count <= 0) {
+        SetError("Invalid parameter: rois is null or count is not positive");
+        return -1;
+    }
+    
+    g_RoiRequests.resize(count);
+    g_RoiLayout.resize(count);
+    for (int i = 0; i < count; i++) {
+        const WC_Roi& roi = rois[i];
+        if (roi.format != WC_OUTPUT_FORMAT_BGRA8 && roi.format != WC_OUTPUT_FORMAT_GRAY8) {
+            SetError("Invalid ROI output format");
+            return -1;
+        }
+        if (roi.width > CRoiExtractor::MaxRoiSize || roi.height > CRoiExtractor::MaxRoiSize) {
+            SetError("Invalid ROI: wider or taller than 16384 pixels");
+            return -1;
+        }
+        SRoiRequest& request = g_RoiRequests[i];
+        request.X = roi.x;
+        request.Y = roi.y;
+        request.Width = roi.width;
+        request.Height = roi.height;
+        request.Format = roi.format == WC_OUTPUT_FORMAT_GRAY8 ? EPixelFormat::Gray8 : EPixelFormat::BGRA8;
+        request.OutputWidth = roi.outputWidth;
+        request.OutputHeight = roi.outputHeight;
+    }
+    
+    size_t size = CRoiExtractor::Layout(g_RoiRequests.data(), count, g_RoiLayout.data());
+    if (size == 0) {
+        SetError("Invalid ROI: empty, output larger than the ROI, or output pixels averaging over 2^24 pixels");
+        return -1;
+    }
+    if (size > INT_MAX) {
+        SetError("ROIs too large");
+        return -1;
+    }
+    return static_cast<int64_t>(size);
+}
+
+static void CopyRoiLayout(int count, WC_RoiLayout* outLayout) {
+    for (int i = 0; i < count; i++) {
+        const SRoiOutput& output = g_RoiLayout[i];
+        outLayout[i].offset = static_cast<int>(output.Offset);
+        outLayout[i].width = output.Width;
+        outLayout[i].height = output.Height;
+        outLayout[i].stride = output.Stride;
+        outLayout[i].format = output.Format == EPixelFormat::Gray8 ? WC_OUTPUT_FORMAT_GRAY8 : WC_OUTPUT_FORMAT_BGRA8;
+    }
+}
+
+WC_API int WC_GetRoiArenaSize(const WC_Roi* rois, int count, WC_RoiLayout* outLayout) {
+    std::lock_guard<std::mutex> lock(g_RoiMutex);
+    int64_t size = PrepareRois(rois, count);
+    if (size < 0) {
+        return -1;
+    }
+    
+    if (outLayout) {
+        CopyRoiLayout(count, outLayout);
+    }
+    return static_cast<int>(size);
+}
+
+WC_API bool WC_ExtractRois(const WC_Roi* rois, int count, void* arena, int arenaSize, WC_RoiLayout* outLayout) {
+    if (!arena) {
+        SetError("Invalid parameter: arena is null");
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(g_RoiMutex);
+    int64_t size = PrepareRois(rois, count);
+    if (size < 0) {
+        return false;
+    }
+    if (arenaSize < size) {
+        SetError("Arena too small, see WC_GetRoiArenaSize");
+        return false;
+    }
+    
+    std::shared_ptr<const CachedFrame> frame = AcquireLatestFrame();
+    if (!frame) {
+        SetError("No frame captured yet");
+        return false;
+    }
+    
+    if (!g_RoiExtractor.Extract(ViewOfCachedFrame(*frame), g_RoiRequests.data(), count, g_RoiLayout.data(),
+            static_cast<uint8_t*>(arena))) {
+        SetError("ROI extraction failed");
+        return false;
+    }
+    
+    if (outLayout) {
+        CopyRoiLayout(count, outLayout);
+    }
+    return true;
+}
+
+WC_API int WC_AddTemplate(const WC_FrameInfoEx* image, bool useAlphaMask) {
+    if (!image || !image->data) {
+        SetError("Invalid parameter: image is null");
+        return -1;
+    }
+    
+    SImageView view;
+    view.Data = static_cast<const uint8_t*>(image->data);
+    view.Width = image->width;
+    view.Height = image->height;
+    view.Stride = image->stride;
+    view.Format = image->format == WC_OUTPUT_FORMAT_GRAY8 ? EPixelFormat::Gray8 : EPixelFormat::BGRA8;
+    
+    std::lock_guard<std::mutex> lock(g_MatcherMutex);
+    if (!g_TemplateMatcher) {
+        g_TemplateMatcher = std::make_unique<CTemplateMatcher>();
+    }
+    
+    int id = g_TemplateMatcher->AddTemplate(view, useAlphaMask);
+    if (id < 0) {
+        SetError("Invalid template: bad size or format, or fully transparent");
+    }
+    return id;
+}
+
+WC_API bool WC_RemoveTemplate(int templateId) {
+    std::lock_guard<std::mutex> lock(g_MatcherMutex);
+    if (!g_TemplateMatcher || !g_TemplateMatcher->RemoveTemplate(templateId)) {
+        SetError("Unknown template id");
+        return false;
+    }
+    return true;
+}
+
+static void CopyMatch(const SMatch& match, WC_Match* outMatch) {
+    outMatch->templateId = match.Template;
+    outMatch->x = match.X;
+    outMatch->y = match.Y;
+    outMatch->score = match.Score;
+    outMatch->scale = match.Scale;
+}
+
+// Checks WC_MatchOptions and converts it; zero optional fields keep the defaults
+static bool ConvertMatchOptions(const WC_MatchOptions* options, SMatchOptions& matchOptions) {
+    if (options->method != WC_MATCH_SAD && options->method != WC_MATCH_SSD && options->method != WC_MATCH_NCC) {
+        SetError("Invalid match method");
+        return false;
+    }
+    if (options->maxResults <= 0) {
+        SetError("Invalid parameter: maxResults must be positive");
+        return false;
+    }
+    if (options->pyramidLevels < 0 || options->pyramidLevels > MaxPyramidLevels ||
+        (options->pyramidFilter != WC_PYRAMID_BOX && options->pyramidFilter != WC_PYRAMID_GAUSSIAN)) {
+        SetError("Invalid parameter: pyramidLevels must be 0-8 with a valid pyramidFilter");
+        return false;
+    }
+    
+    matchOptions.Method = static_cast<EMatchMethod>(options->method);
+    matchOptions.MaxDifference = options->maxDifference;
+    matchOptions.MinCorrelation = options->minCorrelation;
+    matchOptions.MaxResults = options->maxResults;
+    matchOptions.SuppressRadius = options->suppressRadius;
+    matchOptions.RoiX = options->roiX;
+    matchOptions.RoiY = options->roiY;
+    matchOptions.RoiWidth = options->roiWidth;
+    matchOptions.RoiHeight = options->roiHeight;
+    matchOptions.PyramidLevels = options->pyramidLevels;
+    matchOptions.PyramidFilter = static_cast<EPyramidFilter>(options->pyramidFilter);
+    if (options->coarseCandidates > 0) {
+        matchOptions.CoarseCandidates = options->coarseCandidates;
+    }
+    if (options->minScale != 0.0f || options->maxScale != 0.0f) {
+        matchOptions.MinScale = options->minScale;
+        matchOptions.MaxScale = options->maxScale;
+    }
+    if (options->scaleStep != 0.0f) {
+        matchOptions.ScaleStep = options->scaleStep;
+    }
+    return true;
+}
+
+WC_API int WC_MatchTemplates(const int* templateIds, int count, const WC_MatchOptions* options,
+                             WC_Match* outMatches, int maxMatches) {
+    if (!templateIds || count <= 0 || !options || !outMatches || maxMatches <= 0) {
+        SetError("Invalid parameter");
+        return -1;
+    }
+    SMatchOptions matchOptions;
+    if (!ConvertMatchOptions(options, matchOptions)) {
+        return -1;
+    }
+    
+    std::shared_ptr<const CachedFrame> frame = AcquireLatestFrame();
+    if (!frame) {
+        SetError("No frame captured yet");
+        return -1;
+    }
+    
+    SImageView view = ViewOfCachedFrame(*frame);
+    if (view.Format != EPixelFormat::BGRA8 && view.Format != EPixelFormat::Gray8) {
+        SetError("Template matching needs a BGRA8 or GRAY8 frame");
+        return -1;
+    }
+    
+    std::lock_guard<std::mutex> lock(g_MatcherMutex);
+    if (!g_TemplateMatcher) {
+        SetError("Unknown template id");
+        return -1;
+    }
+    
+    bool matched;
+    if (matchOptions.PyramidLevels > 0) {
+        SPyramidFrameKey key;
+        key.Source = frame->source;
+        key.Sequence = frame->stamp.Sequence;
+        key.Generation = frame->stamp.Generation;
+        key.Width = view.Width;
+        key.Height = view.Height;
+        key.Format = view.Format;
+        const CImagePyramid* pyramid = g_FramePyramid.Get(view, key, options->pyramidLevels, matchOptions.PyramidFilter);
+        if (!pyramid) {
+            SetError("Failed to build the frame pyramid");
+            return -1;
+        }
+        matched = g_TemplateMatcher->Match(*pyramid, templateIds, count, matchOptions, g_Matches);
+    } else {
+        matched = g_TemplateMatcher->Match(view, templateIds, count, matchOptions, g_Matches);
+    }
+    if (!matched) {
+        SetError("Unknown template id or invalid scale range");
+        return -1;
+    }
+    
+    int written = std::min(static_cast<int>(g_Matches.size()), maxMatches);
+    for (int i = 0; i < written; i++) {
+        CopyMatch(g_Matches[i], &outMatches[i]);
+    }
+    return written;
+}
+
+WC_API int WC_CreateTracker(int templateId, const WC_TrackOptions* options) {
+    if (!options) {
+        SetError("Invalid parameter");
+        return -1;
+    }
+    
+    WC_MatchOptions searchOptions = options->match;
+    searchOptions.maxResults = 1;
+    STrackOptions trackOptions;
+    if (!ConvertMatchOptions(&searchOptions, trackOptions.Match)) {
+        return -1;
+    }
+    if (options->searchRadius > 0) {
+        trackOptions.SearchRadius = options->searchRadius;
+    }
+    if (options->maxRadius > 0) {
+        trackOptions.MaxRadius = options->maxRadius;
+    }
+    if (options->searchRadius < 0 || options->maxRadius < 0 || trackOptions.MaxRadius < trackOptions.SearchRadius) {
+        SetError("Invalid parameter: maxRadius must be at least searchRadius");
+        return -1;
+    }
+    
+    std::lock_guard<std::mutex> lock(g_MatcherMutex);
+    if (!g_TemplateMatcher) {
+        SetError("Unknown template id");
+        return -1;
+    }
+    if (!g_TemplateTracker) {
+        g_TemplateTracker = std::make_unique<CTemplateTracker>(*g_TemplateMatcher);
+    }
+    
+    int tracker = g_TemplateTracker->CreateHandle(templateId, trackOptions);
+    if (tracker < 0) {
+        SetError("Unknown template id or invalid scale range");
+    }
+    return tracker;
+}
+
+WC_API bool WC_DestroyTracker(int tracker) {
+    std::lock_guard<std::mutex> lock(g_MatcherMutex);
+    if (!g_TemplateTracker || !g_TemplateTracker->DestroyHandle(tracker)) {
+        SetError("Unknown tracker");
+        return false;
+    }
+    return true;
+}
+
+WC_API bool WC_ResetTracker(int tracker) {
+    std::lock_guard<std::mutex> lock(g_MatcherMutex);
+    if (!g_TemplateTracker || !g_TemplateTracker->ResetHandle(tracker)) {
+        SetError("Unknown tracker");
+        return false;
+    }
+    return true;
+}
+
+WC_API int WC_Track(int tracker, WC_Match* outMatch) {
+    if (!outMatch) {
+        SetError("Invalid parameter");
+        return -1;
+    }
+    
+    std::shared_ptr<const CachedFrame> frame = AcquireLatestFrame();
+    if (!frame) {
+        SetError("No frame captured yet");
+        return -1;
+    }
+    SImageView view = ViewOfCachedFrame(*frame);
+    if (view.Format != EPixelFormat::BGRA8 && view.Format != EPixelFormat::Gray8) {
+        SetError("Template matching needs a BGRA8 or GRAY8 frame");
+        return -1;
+    }
+    
+    std::lock_guard<std::mutex> lock(g_MatcherMutex);
+    SMatch match;
+    bool found = false;
+    if (!g_TemplateTracker || !g_TemplateTracker->Track(tracker, view, match, found)) {
+        SetError("Unknown tracker, or its template was removed");
+        return -1;
+    }
+    if (!found) {
+        return 0;
+    }
+    CopyMatch(match, outMatch);
+    return 1;
+}
+
+WC_API bool WC_GetTrackerStats(int tracker, WC_TrackStats* outStats) {
+    if (!outStats) {
+        SetError("Invalid parameter");
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(g_MatcherMutex);
+    STrackStats stats;
+    if (!g_TemplateTracker || !g_TemplateTracker->GetStats(tracker, stats)) {
+        SetError("Unknown tracker");
+        return false;
+    }
+    outStats->searches = static_cast<long long>(stats.Searches);
+    outStats->windowHits = static_cast<long long>(stats.WindowHits);
+    outStats->grownHits = static_cast<long long>(stats.GrownHits);
+    outStats->fullSearches = static_cast<long long>(stats.FullSearches);
+    outStats->fullHits = static_cast<long long>(stats.FullHits);
+    outStats->misses = static_cast<long long>(stats.Misses);
+    return true;
+}
+
+static bool ConvertColorTargets(const WC_ColorTarget* targets, int count, SColorRange* ranges) {
+    for (int i = 0; i < count; i++) {
+        const WC_ColorTarget& target = targets[i];
+        if (target.mode == WC_COLOR_TOLERANCE) {
+            ranges[i] = MakeColorRange(target.color, target.toleranceR, target.toleranceG, target.toleranceB);
+        } else if (target.mode == WC_COLOR_BOX) {
+            ranges[i].Low = target.color;
+            ranges[i].High = target.colorHigh;
+        } else {
+            SetError("Invalid colour target mode");
+            return false;
+        }
+    }
+    return true;
+}
+
+WC_API int WC_FindColors(const WC_ColorTarget* targets, int count, const WC_ColorSearchOptions* options,
+                         int* outPoints, int maxPoints, WC_ColorBox* outBoxes, int maxBoxes, int* outBoxCount) {
+    if (!targets || count <= 0 || count > MaxColorRanges || maxPoints < 0 || maxBoxes < 0) {
+        SetError("Invalid parameter");
+        return -1;
+    }
+    
+    SColorRange ranges[MaxColorRanges];
+    if (!ConvertColorTargets(targets, count, ranges)) {
+        return -1;
+    }
+    
+    SColorSearchOptions searchOptions;
+    if (options) {
+        if (options->mode != WC_COLOR_SEARCH_ALL && options->mode != WC_COLOR_SEARCH_FIRST) {
+            SetError("Invalid colour search mode");
+            return -1;
+        }
+        if (options->mergeGap < 0) {
+            SetError("Invalid parameter: mergeGap must not be negative");
+            return -1;
+        }
+        searchOptions.Mode = options->mode == WC_COLOR_SEARCH_FIRST ? EColorSearchMode::FirstHit : EColorSearchMode::AllHits;
+        searchOptions.RoiX = options->roiX;
+        searchOptions.RoiY = options->roiY;
+        searchOptions.RoiWidth = options->roiWidth;
+        searchOptions.RoiHeight = options->roiHeight;
+        if (options->mergeGap > 0) {
+            searchOptions.MergeGap = options->mergeGap;
+        }
+    }
+    
+    std::shared_ptr<const CachedFrame> frame = AcquireLatestFrame();
+    if (!frame) {
+        SetError("No frame captured yet");
+        return -1;
+    }
+    
+    std::lock_guard<std::mutex> lock(g_ColorSearchMutex);
+    bool wantBoxes = outBoxes || outBoxCount;
+    int hits = g_ColorSearch.Search(ViewOfCachedFrame(*frame), ranges, count, searchOptions,
+                                    outPoints, outPoints ? maxPoints : 0, wantBoxes ? &g_ColorBoxes : nullptr);
+    if (hits < 0) {
+        SetError("Colour search needs a BGRA8 or GRAY8 frame");
+        return -1;
+    }
+    
+    int boxCount = wantBoxes ? static_cast<int>(g_ColorBoxes.size()) : 0;
+    if (outBoxes) {
+        int written = std::min(boxCount, maxBoxes);
+        for (int i = 0; i < written; i++) {
+            outBoxes[i].x = g_ColorBoxes[i].X;
+            outBoxes[i].y = g_ColorBoxes[i].Y;
+            outBoxes[i].width = g_ColorBoxes[i].Width;
+            outBoxes[i].height = g_ColorBoxes[i].Height;
+            outBoxes[i].pixelCount = g_ColorBoxes[i].Count;
+        }
+    }
+    if (outBoxCount) {
+        *outBoxCount = boxCount;
+    }
+    return hits;
+}
+
+WC_API int WC_CreateClassifier(const WC_ColorRule* rules, int count, int lutBits) {
+    if (count < 0 || (count > 0 && !rules)) {
+        SetError("Invalid parameter");
+        return -1;
+    }
+    
+    std::vector<SColorRule> colorRules(static_cast<size_t>(count));
+    for (int i = 0; i < count; i++) {
+        const WC_ColorRule& rule = rules[i];
+        if (rule.type != WC_RULE_HSV && rule.type != WC_RULE_RGB_BOX && rule.type != WC_RULE_PALETTE) {
+            SetError("Invalid colour rule type");
+            return -1;
+        }
+        SColorRule& colorRule = colorRules[i];
+        colorRule.Type = static_cast<EColorRuleType>(rule.type);
+        colorRule.Label = rule.label;
+        colorRule.HueMin = rule.hueMin;
+        colorRule.HueMax = rule.hueMax;
+        colorRule.SaturationMin = rule.saturationMin;
+        colorRule.SaturationMax = rule.saturationMax;
+        colorRule.ValueMin = rule.valueMin;
+        colorRule.ValueMax = rule.valueMax;
+        colorRule.Color = rule.color;
+        colorRule.ColorHigh = rule.colorHigh;
+        colorRule.MaxDistance = rule.maxDistance;
+    }
+    
+    std::unique_ptr<CPixelClassifier> classifier = std::make_unique<CPixelClassifier>();
+    if (!classifier->Compile(colorRules.data(), count, lutBits > 0 ? lutBits : 5)) {
+        SetError("Invalid colour rule: check labels (1-255), ranges and lutBits (4-6)");
+        return -1;
+    }
+    
+    std::lock_guard<std::mutex> lock(g_ClassifierMutex);
+    for (size_t id = 0; id < g_Classifiers.size(); id++) {
+        if (!g_Classifiers[id]) {
+            g_Classifiers[id] = std::move(classifier);
+            return static_cast<int>(id);
+        }
+    }
+    g_Classifiers.push_back(std::move(classifier));
+    return static_cast<int>(g_Classifiers.size()) - 1;
+}
+
+WC_API bool WC_DestroyClassifier(int classifier) {
+    std::lock_guard<std::mutex> lock(g_ClassifierMutex);
+    if (classifier < 0 || classifier >= static_cast<int>(g_Classifiers.size()) || !g_Classifiers[classifier]) {
+        SetError("Unknown classifier");
+        return false;
+    }
+    g_Classifiers[classifier].reset();
+    return true;
+}
+
+WC_API bool WC_ClassifyFrame(int classifier, const WC_ClassifyOptions* options, unsigned char* outLabels,
+                             int labelsSize, int* outWidth, int* outHeight, unsigned int* outCounts) {
+    if (!outLabels || labelsSize <= 0 || !outWidth || !outHeight) {
+        SetError("Invalid parameter");
+        return false;
+    }
+    *outWidth = 0;
+    *outHeight = 0;
+    
+    SClassifyOptions classifyOptions;
+    if (options) {
+        if (options->step < 0) {
+            SetError("Invalid parameter: step must not be negative");
+            return false;
+        }
+        classifyOptions.RoiX = options->roiX;
+        classifyOptions.RoiY = options->roiY;
+        classifyOptions.RoiWidth = options->roiWidth;
+        classifyOptions.RoiHeight = options->roiHeight;
+        if (options->step > 0) {
+            classifyOptions.Step = options->step;
+        }
+    }
+    
+    std::shared_ptr<const CachedFrame> frame = AcquireLatestFrame();
+    if (!frame) {
+        SetError("No frame captured yet");
+        return false;
+    }
+    SImageView view = ViewOfCachedFrame(*frame);
+    if (view.Format != EPixelFormat::BGRA8 && view.Format != EPixelFormat::Gray8) {
+        SetError("Classification needs a BGRA8 or GRAY8 frame");
+        return false;
+    }
+    
+    int width = 0;
+    int height = 0;
+    CPixelClassifier::GetLabelMapSize(view, classifyOptions, width, height);
+    *outWidth = width;
+    *outHeight = height;
+    if (static_cast<int64_t>(width) * height > labelsSize) {
+        SetError("Label buffer too small");
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(g_ClassifierMutex);
+    if (classifier < 0 || classifier >= static_cast<int>(g_Classifiers.size()) || !g_Classifiers[classifier]) {
+        SetError("Unknown classifier");
+        return false;
+    }
+    return g_Classifiers[classifier]->Classify(view, classifyOptions, outLabels, width, outCounts);
+}
+
+WC_API int WC_FindBlobs(const unsigned char* mask, int width, int height, int stride, const WC_BlobOptions* options,
+                        WC_Blob* outBlobs, int maxBlobs) {
+    if (!mask || width <= 0 || height <= 0 || stride < width || maxBlobs < 0 || (maxBlobs > 0 && !outBlobs)) {
+        SetError("Invalid parameter");
+        return -1;
+    }
+    
+    SBlobOptions blobOptions;
+    SBlobColorSource colors;
+    std::shared_ptr<const CachedFrame> frame;
+    if (options) {
+        if (options->minArea < 0 || options->maxBlobs < 0 || options->colorStep < 0) {
+            SetError("Invalid parameter: minArea, maxBlobs and colorStep must not be negative");
+            return -1;
+        }
+        blobOptions.IsLabelMap = options->isLabelMap != 0;
+        blobOptions.IsEightConnected = options->fourConnected == 0;
+        if (options->minArea > 0) {
+            blobOptions.MinArea = options->minArea;
+        }
+        blobOptions.MaxBlobs = options->maxBlobs;
+        
+        if (options->useFrameColors) {
+            frame = AcquireLatestFrame();
+            if (!frame) {
+                SetError("No frame captured yet");
+                return -1;
+            }
+            colors.Frame = ViewOfCachedFrame(*frame);
+            if (colors.Frame.Format != EPixelFormat::BGRA8 && colors.Frame.Format != EPixelFormat::Gray8) {
+                SetError("Blob colours need a BGRA8 or GRAY8 frame");
+                return -1;
+            }
+            colors.X = options->colorX;
+            colors.Y = options->colorY;
+            if (options->colorStep > 0) {
+                colors.Step = options->colorStep;
+            }
+        }
+    }
+    
+    // Blobs past the output capacity are never needed, so they are not ranked or coloured
+    if (maxBlobs > 0 && (blobOptions.MaxBlobs == 0 || blobOptions.MaxBlobs > maxBlobs)) {
+        blobOptions.MaxBlobs = maxBlobs;
+    }
+    
+    SImageView view;
+    view.Data = mask;
+    view.Width = width;
+    view.Height = height;
+    view.Stride = stride;
+    view.Format = EPixelFormat::Gray8;
+    
+    std::lock_guard<std::mutex> lock(g_BlobMutex);
+    if (!g_BlobDetector) {
+        g_BlobDetector = std::make_unique<CBlobDetector>();
+    }
+    
+    int found = g_BlobDetector->Detect(view, blobOptions, frame ? &colors : nullptr, g_Blobs);
+    if (found < 0) {
+        SetError("Blob detection failed");
+        return -1;
+    }
+    
+    int written = std::min(static_cast<int>(g_Blobs.size()), maxBlobs);
+    for (int i = 0; i < written; i++) {
+        const SBlob& blob = g_Blobs[i];
+        outBlobs[i].x = blob.X;
+        outBlobs[i].y = blob.Y;
+        outBlobs[i].width = blob.Width;
+        outBlobs[i].height = blob.Height;
+        outBlobs[i].area = blob.Area;
+        outBlobs[i].centroidX = blob.CentroidX;
+        outBlobs[i].centroidY = blob.CentroidY;
+        outBlobs[i].meanColor = blob.MeanColor;
+        outBlobs[i].label = blob.Label;
+    }
+    return found;
+}
+
+// Mask area and step share the classifier's label map geometry
+static bool ConvertMaskOptions(const WC_MaskOptions* options, SClassifyOptions& region, int& encoding) {
+    encoding = WC_MASK_BITS;
+    if (!options) {
+        return true;
+    }
+    if (options->encoding != WC_MASK_BITS && options->encoding != WC_MASK_RUNS) {
+        SetError("Invalid mask encoding");
+        return false;
+    }
+    if (options->step < 0) {
+        SetError("Invalid parameter: step must not be negative");
+        return false;
+    }
+    encoding = options->encoding;
+    region.RoiX = options->roiX;
+    region.RoiY = options->roiY;
+    region.RoiWidth = options->roiWidth;
+    region.RoiHeight = options->roiHeight;
+    if (options->step > 0) {
+        region.Step = options->step;
+    }
+    return true;
+}
+
+// Pixels of mask row y, contiguous: the frame row itself at step 1, else the block centres
+static const uint8_t* SampleMaskRow(const SImageView& view, const SClassifyOptions& region, int width, int y) {
+    const int bytesPerPixel = view.Format == EPixelFormat::Gray8 ? 1 : 4;
+    const SPixelRect area = ClipToFrame(region.RoiX, region.RoiY, region.RoiWidth, region.RoiHeight, view.Width,
+                                        view.Height);
+    const int step = region.Step;
+    
+    const int64_t rowY = static_cast<int64_t>(area.Top) + static_cast<int64_t>(y) * step + step / 2;
+    const uint8_t* row = view.Row(static_cast<int>(std::min<int64_t>(rowY, area.Bottom - 1)));
+    if (step == 1) {
+        return row + static_cast<size_t>(area.Left) * bytesPerPixel;
+    }
+    
+    g_MaskPixels.resize(static_cast<size_t>(width) * bytesPerPixel);
+    for (int x = 0; x < width; x++) {
+        const int64_t columnX = static_cast<int64_t>(area.Left) + static_cast<int64_t>(x) * step + step / 2;
+        const int column = static_cast<int>(std::min<int64_t>(columnX, area.Right - 1));
+        memcpy(&g_MaskPixels[static_cast<size_t>(x) * bytesPerPixel], row + static_cast<size_t>(column) * bytesPerPixel,
+               bytesPerPixel);
+    }
+    return g_MaskPixels.data();
+}
+
+// Where the packed rows go: the caller's buffer for bit masks, scratch for run lists
+static uint8_t* BeginMask(int width, int height, int encoding, void* outMask, int maskSize, WC_MaskInfo* outInfo) {
+    const int stride = GetBitMaskStride(width);
+    const int64_t bitsSize = static_cast<int64_t>(stride) * height;
+    *outInfo = WC_MaskInfo();
+    outInfo->width = width;
+    outInfo->height = height;
+    outInfo->stride = stride;
+    
+    if (encoding == WC_MASK_BITS) {
+        outInfo->size = static_cast<int>(bitsSize);
+        if (bitsSize > maskSize) {
+            SetError("Mask buffer too small");
+            return nullptr;
+        }
+        return static_cast<uint8_t*>(outMask);
+    }
+    g_MaskBits.resize(static_cast<size_t>(bitsSize) + 1);
+    return g_MaskBits.data();
+}
+
+static bool FinishMask(const uint8_t* bits, int encoding, void* outMask, int maskSize, WC_MaskInfo* outInfo) {
+    const int width = outInfo->width;
+    const int height = outInfo->height;
+    outInfo->pixelCount = static_cast<int>(CountMaskBits(bits, outInfo->stride, width, height));
+    if (encoding == WC_MASK_BITS) {
+        return true;
+    }
+    
+    g_MaskRuns.clear();
+    g_MaskRowStarts.resize(static_cast<size_t>(height) + 1);
+    for (int y = 0; y < height; y++) {
+        g_MaskRowStarts[y] = static_cast<int32_t>(g_MaskRuns.size());
+        EncodeMaskRuns(bits + static_cast<size_t>(y) * outInfo->stride, width, g_MaskRuns);
+    }
+    g_MaskRowStarts[height] = static_cast<int32_t>(g_MaskRuns.size());
+    
+    const size_t startsSize = g_MaskRowStarts.size() * sizeof(int32_t);
+    const size_t runsSize = g_MaskRuns.size() * sizeof(SMaskRun);
+    outInfo->runCount = static_cast<int>(g_MaskRuns.size());
+    outInfo->size = static_cast<int>(startsSize + runsSize);
+    if (startsSize + runsSize > static_cast<size_t>(maskSize)) {
+        SetError("Mask buffer too small");
+        return false;
+    }
+    memcpy(outMask, g_MaskRowStarts.data(), startsSize);
+    if (runsSize > 0) {
+        memcpy(static_cast<uint8_t*>(outMask) + startsSize, g_MaskRuns.data(), runsSize);
+    }
+    return true;
+}
+
+WC_API bool WC_ThresholdMask(int threshold, const WC_MaskOptions* options, void* outMask, int maskSize,
+                             WC_MaskInfo* outInfo) {
+    if (threshold < 0 || threshold > 255 || !outMask || maskSize <= 0 || !outInfo) {
+        SetError("Invalid parameter");
+        return false;
+    }
+    SClassifyOptions region;
+    int encoding = WC_MASK_BITS;
+    if (!ConvertMaskOptions(options, region, encoding)) {
+        return false;
+    }
+    
+    std::shared_ptr<const CachedFrame> frame = AcquireLatestFrame();
+    if (!frame) {
+        SetError("No frame captured yet");
+        return false;
+    }
+    SImageView view = ViewOfCachedFrame(*frame);
+    if (view.Format != EPixelFormat::BGRA8 && view.Format != EPixelFormat::Gray8) {
+        SetError("Masks need a BGRA8 or GRAY8 frame");
+        return false;
+    }
+    
+    int width = 0;
+    int height = 0;
+    CPixelClassifier::GetLabelMapSize(view, region, width, height);
+    
+    std::lock_guard<std::mutex> lock(g_MaskMutex);
+    uint8_t* bits = BeginMask(width, height, encoding, outMask, maskSize, outInfo);
+    if (!bits) {
+        return false;
+    }
+    
+    g_MaskRow.resize(static_cast<size_t>(width) + 1);
+    for (int y = 0; y < height; y++) {
+        const uint8_t* pixels = SampleMaskRow(view, region, width, y);
+        if (view.Format == EPixelFormat::BGRA8) {
+            SImageView row;
+            row.Data = pixels;
+            row.Width = width;
+            row.Height = 1;
+            row.Stride = width * 4;
+            row.Format = EPixelFormat::BGRA8;
+            ConvertBGRA8ToGray8(row, g_MaskRow.data(), width);
+            pixels = g_MaskRow.data();
+        }
+        PackMaskRow(pixels, width, EMaskTest::AtLeast, static_cast<uint8_t>(threshold),
+                    bits + static_cast<size_t>(y) * outInfo->stride);
+    }
+    return FinishMask(bits, encoding, outMask, maskSize, outInfo);
+}
+
+WC_API bool WC_FindColorMask(const WC_ColorTarget* targets, int count, const WC_MaskOptions* options, void* outMask,
+                             int maskSize, WC_MaskInfo* outInfo) {
+    if (!targets || count <= 0 || count > MaxColorRanges || !outMask || maskSize <= 0 || !outInfo) {
+        SetError("Invalid parameter");
+        return false;
+    }
+    SColorRange ranges[MaxColorRanges];
+    if (!ConvertColorTargets(targets, count, ranges)) {
+        return false;
+    }
+    SClassifyOptions region;
+    int encoding = WC_MASK_BITS;
+    if (!ConvertMaskOptions(options, region, encoding)) {
+        return false;
+    }
+    
+    std::shared_ptr<const CachedFrame> frame = AcquireLatestFrame();
+    if (!frame) {
+        SetError("No frame captured yet");
+        return false;
+    }
+    SImageView view = ViewOfCachedFrame(*frame);
+    if (view.Format != EPixelFormat::BGRA8 && view.Format != EPixelFormat::Gray8) {
+        SetError("Masks need a BGRA8 or GRAY8 frame");
+        return false;
+    }
+    
+    int width = 0;
+    int height = 0;
+    CPixelClassifier::GetLabelMapSize(view, region, width, height);
+    
+    std::lock_guard<std::mutex> lock(g_MaskMutex);
+    uint8_t* bits = BeginMask(width, height, encoding, outMask, maskSize, outInfo);
+    if (!bits) {
+        return false;
+    }
+    
+    g_MaskRow.resize(static_cast<size_t>(width) + 1);
+    for (int y = 0; y < height; y++) {
+        MatchColorRow(SampleMaskRow(view, region, width, y), view.Format, width, ranges, count, g_MaskRow.data());
+        PackMaskRow(g_MaskRow.data(), width, EMaskTest::NonZero, 0, bits + static_cast<size_t>(y) * outInfo->stride);
+    }
+    return FinishMask(bits, encoding, outMask, maskSize, outInfo);
+}
+
+WC_API bool WC_ClassifyMask(int classifier, int label, const WC_MaskOptions* options, void* outMask, int maskSize,
+                            WC_MaskInfo* outInfo) {
+    if (label < 0 || label > 255 || !outMask || maskSize <= 0 || !outInfo) {
+        SetError("Invalid parameter");
+        return false;
+    }
+    SClassifyOptions region;
+    int encoding = WC_MASK_BITS;
+    if (!ConvertMaskOptions(options, region, encoding)) {
+        return false;
+    }
+    
+    std::shared_ptr<const CachedFrame> frame = AcquireLatestFrame();
+    if (!frame) {
+        SetError("No frame captured yet");
+        return false;
+    }
+    SImageView view = ViewOfCachedFrame(*frame);
+    if (view.Format != EPixelFormat::BGRA8 && view.Format != EPixelFormat::Gray8) {
+        SetError("Classification needs a BGRA8 or GRAY8 frame");
+        return false;
+    }
+    
+    int width = 0;
+    int height = 0;
+    CPixelClassifier::GetLabelMapSize(view, region, width, height);
+    
+    std::lock_guard<std::mutex> classifierLock(g_ClassifierMutex);
+    if (classifier < 0 || classifier >= static_cast<int>(g_Classifiers.size()) || !g_Classifiers[classifier]) {
+        SetError("Unknown classifier");
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(g_MaskMutex);
+    uint8_t* bits = BeginMask(width, height, encoding, outMask, maskSize, outInfo);
+    if (!bits) {
+        return false;
+    }
+    
+    g_MaskLabels.resize(static_cast<size_t>(width) * height + 1);
+    g_Classifiers[classifier]->Classify(view, region, g_MaskLabels.data(), width, nullptr);
+    EMaskTest test = label > 0 ? EMaskTest::Equal : EMaskTest::NonZero;
+    for (int y = 0; y < height; y++) {
+        PackMaskRow(&g_MaskLabels[static_cast<size_t>(y) * width], width, test, static_cast<uint8_t>(label),
+                    bits + static_cast<size_t>(y) * outInfo->stride);
+    }
+    return FinishMask(bits, encoding, outMask, maskSize, outInfo);
+}
+
+WC_API long long WC_CountMaskBits(const unsigned char* bits, int width, int height, int stride) {
+    if (!bits || width <= 0 || height <= 0 || stride < GetBitMaskStride(width)) {
+        SetError("Invalid parameter");
+        return -1;
+    }
+    return static_cast<long long>(CountMaskBits(bits, stride, width, height));
+}
+
+WC_API bool WC_GetMaskBounds(const unsigned char* bits, int width, int height, int stride, WC_MaskBounds* outBounds) {
+    if (!bits || width <= 0 || height <= 0 || stride < GetBitMaskStride(width) || !outBounds) {
+        SetError("Invalid parameter");
+        return false;
+    }
+    SMaskBounds bounds;
+    bool found = GetMaskBounds(bits, stride, width, height, bounds);
+    outBounds->x = bounds.X;
+    outBounds->y = bounds.Y;
+    outBounds->width = bounds.Width;
+    outBounds->height = bounds.Height;
+    return found;
+}
+
+// Run pairs follow the height + 1 row starts
+static const SMaskRun* RunsOfMask(const int* runs, int height) {
+    static_assert(sizeof(SMaskRun) == 2 * sizeof(int32_t), "Run pairs must match the C layout");
+    return reinterpret_cast<const SMaskRun*>(runs + height + 1);
+}
+
+WC_API long long WC_CountMaskRuns(const int* runs, int height) {
+    if (!runs || height < 0 || runs[0] != 0 || runs[height] < 0) {
+        SetError("Invalid parameter");
+        return -1;
+    }
+    return static_cast<long long>(CountRunPixels(reinterpret_cast<const int32_t*>(runs), RunsOfMask(runs, height), height));
+}
+
+WC_API bool WC_GetRunBounds(const int* runs, int height, WC_MaskBounds* outBounds) {
+    if (!runs || height < 0 || runs[0] != 0 || runs[height] < 0 || !outBounds) {
+        SetError("Invalid parameter");
+        return false;
+    }
+    SMaskBounds bounds;
+    bool found = GetRunBounds(reinterpret_cast<const int32_t*>(runs), RunsOfMask(runs, height), height, bounds);
+    outBounds->x = bounds.X;
+    outBounds->y = bounds.Y;
+    outBounds->width = bounds.Width;
+    outBounds->height = bounds.Height;
+    return found;
+}
+
+static int AddPalette(std::unique_ptr<PaletteSlot> slot) {
+    std::lock_guard<std::mutex> lock(g_PaletteMutex);
+    for (size_t id = 0; id < g_Palettes.size(); id++) {
+        if (!g_Palettes[id]) {
+            g_Palettes[id] = std::move(slot);
+            return static_cast<int>(id);
+        }
+    }
+    g_Palettes.push_back(std::move(slot));
+    return static_cast<int>(g_Palettes.size()) - 1;
+}
+
+WC_API int WC_CreatePalette(const unsigned int* colors, int count) {
+    if (!colors || count <= 0 || count > MaxPaletteColors) {
+        SetError("Invalid parameter: count must be 1-256");
+        return -1;
+    }
+    
+    std::unique_ptr<PaletteSlot> slot = std::make_unique<PaletteSlot>();
+    slot->quantizer.SetPalette(reinterpret_cast<const uint32_t*>(colors), count);
+    return AddPalette(std::move(slot));
+}
+
+WC_API int WC_CreateAdaptivePalette(const WC_AdaptivePaletteOptions* options) {
+    std::unique_ptr<PaletteSlot> slot = std::make_unique<PaletteSlot>();
+    slot->maxColors = MaxPaletteColors;
+    if (options) {
+        if (options->method != WC_PALETTE_MEDIAN_CUT && options->method != WC_PALETTE_POPULARITY) {
+            SetError("Invalid palette method");
+            return -1;
+        }
+        if (options->maxColors < 0 || options->maxColors > MaxPaletteColors || options->sampleStep < 0) {
+            SetError("Invalid parameter: maxColors must be 0-256 and sampleStep not negative");
+            return -1;
+        }
+        slot->method = static_cast<EPaletteMethod>(options->method);
+        if (options->maxColors > 0) {
+            slot->maxColors = options->maxColors;
+        }
+        slot->sampleStep = options->sampleStep;
+        slot->rebuildEachFrame = options->rebuildEachFrame != 0;
+    }
+    
+    std::shared_ptr<const CachedFrame> frame = AcquireLatestFrame();
+    if (!frame) {
+        SetError("No frame captured yet");
+        return -1;
+    }
+    SImageView view = ViewOfCachedFrame(*frame);
+    if (view.Format != EPixelFormat::BGRA8 && view.Format != EPixelFormat::Gray8) {
+        SetError("Palettes need a BGRA8 or GRAY8 frame");
+        return -1;
+    }
+    if (!slot->quantizer.BuildPalette(view, slot->method, slot->maxColors, slot->sampleStep)) {
+        SetError("No palette colours could be built from the frame");
+        return -1;
+    }
+    return AddPalette(std::move(slot));
+}
+
+WC_API bool WC_DestroyPalette(int palette) {
+    std::lock_guard<std::mutex> lock(g_PaletteMutex);
+    if (palette < 0 || palette >= static_cast<int>(g_Palettes.size()) || !g_Palettes[palette]) {
+        SetError("Unknown palette");
+        return false;
+    }
+    g_Palettes[palette].reset();
+    return true;
+}
+
+WC_API bool WC_QuantizeFrame(int palette, const WC_QuantizeOptions* options, unsigned char* outIndices,
+                             int indicesSize, int* outWidth, int* outHeight, unsigned int* outPalette,
+                             int* outColorCount) {
+    if (!outIndices || indicesSize <= 0 || !outWidth || !outHeight) {
+        SetError("Invalid parameter");
+        return false;
+    }
+    *outWidth = 0;
+    *outHeight = 0;
+    
+    std::shared_ptr<const CachedFrame> frame = AcquireLatestFrame();
+    if (!frame) {
+        SetError("No frame captured yet");
+        return false;
+    }
+    SImageView view = ViewOfCachedFrame(*frame);
+    if (view.Format != EPixelFormat::BGRA8 && view.Format != EPixelFormat::Gray8) {
+        SetError("Quantization needs a BGRA8 or GRAY8 frame");
+        return false;
+    }
+    
+    // Narrow the view to the area; its pixels keep the frame's stride
+    if (options) {
+        SPixelRect area = ClipToFrame(options->roiX, options->roiY, options->roiWidth, options->roiHeight, view.Width,
+                                      view.Height);
+        if (area.IsEmpty()) {
+            SetError("Quantize area is outside the frame");
+            return false;
+        }
+        view.Data = view.Row(area.Top) + static_cast<size_t>(area.Left) * GetBytesPerPixel(view.Format);
+        view.Width = area.GetWidth();
+        view.Height = area.GetHeight();
+    }
+    *outWidth = view.Width;
+    *outHeight = view.Height;
+    if (static_cast<int64_t>(view.Width) * view.Height > indicesSize) {
+        SetError("Index buffer too small");
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(g_PaletteMutex);
+    if (palette < 0 || palette >= static_cast<int>(g_Palettes.size()) || !g_Palettes[palette]) {
+        SetError("Unknown palette");
+        return false;
+    }
+    PaletteSlot& slot = *g_Palettes[palette];
+    if (slot.rebuildEachFrame && !slot.quantizer.BuildPalette(view, slot.method, slot.maxColors, slot.sampleStep)) {
+        SetError("No palette colours could be built from the frame");
+        return false;
+    }
+    if (!slot.quantizer.Quantize(view, outIndices, view.Width)) {
+        SetError("Palette has no colours");
+        return false;
+    }
+    
+    if (outPalette) {
+        memcpy(outPalette, slot.quantizer.GetPalette(), static_cast<size_t>(slot.quantizer.GetColorCount()) * sizeof(uint32_t));
+    }
+    if (outColorCount) {
+        *outColorCount = slot.quantizer.GetColorCount();
+    }
+    return true;
+}
+
+WC_API int WC_ReadBars(const WC_Bar* bars, int count, const WC_ColorTarget* targets, int targetCount,
+                       WC_BarReading* outReadings) {
+    if (!bars || count <= 0 || !targets || targetCount <= 0 || !outReadings) {
+        SetError("Invalid parameter");
+        return -1;
+    }
+    
+    std::shared_ptr<const CachedFrame> frame = AcquireLatestFrame();
+    if (!frame) {
+        SetError("No frame captured yet");
+        return -1;
+    }
+    
+    std::lock_guard<std::mutex> lock(g_BarMutex);
+    g_BarRanges.resize(static_cast<size_t>(targetCount));
+    if (!ConvertColorTargets(targets, targetCount, g_BarRanges.data())) {
+        return -1;
+    }
+    
+    // Bars with targets outside the list keep no ranges, which the reader marks invalid
+    g_BarRequests.resize(static_cast<size_t>(count));
+    g_BarReadings.resize(static_cast<size_t>(count));
+    for (int i = 0; i < count; i++) {
+        const WC_Bar& bar = bars[i];
+        SBarRequest& request = g_BarRequests[i];
+        request = SBarRequest();
+        if (bar.orientation < WC_BAR_LEFT_TO_RIGHT || bar.orientation > WC_BAR_TOP_TO_BOTTOM) {
+            continue;
+        }
+        request.X = bar.x;
+        request.Y = bar.y;
+        request.Width = bar.width;
+        request.Height = bar.height;
+        request.Orientation = static_cast<EBarOrientation>(bar.orientation);
+        if (bar.firstTarget >= 0 && bar.targetCount > 0 && bar.targetCount <= targetCount - bar.firstTarget) {
+            request.Ranges = &g_BarRanges[bar.firstTarget];
+            request.RangeCount = bar.targetCount;
+        }
+    }
+    
+    int valid = g_BarReader.Read(ViewOfCachedFrame(*frame), g_BarRequests.data(), count, g_BarReadings.data());
+    if (valid < 0) {
+        SetError("Bar reading needs a BGRA8 or GRAY8 frame");
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        outReadings[i].fraction = g_BarReadings[i].Fraction;
+        outReadings[i].confidence = g_BarReadings[i].Confidence;
+        outReadings[i].isValid = g_BarReadings[i].IsValid ? 1 : 0;
+    }
+    return valid;
+}
+
+WC_API int WC_CreateGlyphSet() {
+    std::lock_guard<std::mutex> lock(g_GlyphMutex);
+    for (size_t id = 0; id < g_GlyphSets.size(); id++) {
+        if (!g_GlyphSets[id]) {
+            g_GlyphSets[id] = std::make_unique<CGlyphRecognizer>();
+            return static_cast<int>(id);
+        }
+    }
+    g_GlyphSets.push_back(std::make_unique<CGlyphRecognizer>());
+    return static_cast<int>(g_GlyphSets.size()) - 1;
+}
+
+WC_API bool WC_AddGlyph(int glyphSet, int codePoint, const WC_FrameInfoEx* image, int polarity) {
+    if (!image || !image->data || codePoint <= 0 || codePoint > 0x10FFFF) {
+        SetError("Invalid parameter");
+        return false;
+    }
+    if (polarity < WC_TEXT_AUTO || polarity > WC_TEXT_DARK_ON_LIGHT) {
+        SetError("Invalid text polarity");
+        return false;
+    }
+    
+    SImageView view;
+    view.Data = static_cast<const uint8_t*>(image->data);
+    view.Width = image->width;
+    view.Height = image->height;
+    view.Stride = image->stride;
+    view.Format = image->format == WC_OUTPUT_FORMAT_GRAY8 ? EPixelFormat::Gray8 : EPixelFormat::BGRA8;
+    
+    std::lock_guard<std::mutex> lock(g_GlyphMutex);
+    if (glyphSet < 0 || glyphSet >= static_cast<int>(g_GlyphSets.size()) || !g_GlyphSets[glyphSet]) {
+        SetError("Unknown glyph set");
+        return false;
+    }
+    if (!g_GlyphSets[glyphSet]->AddGlyph(codePoint, view, static_cast<ETextPolarity>(polarity))) {
+        SetError("Glyph image is invalid or has no ink");
+        return false;
+    }
+    return true;
+}
+
+WC_API bool WC_DestroyGlyphSet(int glyphSet) {
+    std::lock_guard<std::mutex> lock(g_GlyphMutex);
+    if (glyphSet < 0 || glyphSet >= static_cast<int>(g_GlyphSets.size()) || !g_GlyphSets[glyphSet]) {
+        SetError("Unknown glyph set");
+        return false;
+    }
+    g_GlyphSets[glyphSet].reset();
+    return true;
+}
+
+// Appends codePoint to text as UTF-8
+static void AppendUtf8(std::string& text, int codePoint) {
+    if (codePoint < 0x80) {
+        text += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800) {
+        text += static_cast<char>(0xC0 | (codePoint >> 6));
+        text += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+        text += static_cast<char>(0xE0 | (codePoint >> 12));
+        text += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        text += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else {
+        text += static_cast<char>(0xF0 | (codePoint >> 18));
+        text += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        text += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        text += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+}
+
+WC_API int WC_ReadText(int glyphSet, const WC_TextOptions* options, char* outText, int textSize,
+                       float* outConfidences, int maxConfidences) {
+    if (!outText || textSize <= 0 || maxConfidences < 0 || (maxConfidences > 0 && !outConfidences)) {
+        SetError("Invalid parameter");
+        return -1;
+    }
+    outText[0] = '\0';
+    
+    STextOptions textOptions;
+    int left = 0;
+    int top = 0;
+    int roiWidth = 0;
+    int roiHeight = 0;
+    if (options) {
+        if (options->polarity < WC_TEXT_AUTO || options->polarity > WC_TEXT_DARK_ON_LIGHT) {
+            SetError("Invalid text polarity");
+            return -1;
+        }
+        if (options->threshold < 0 || options->threshold > 255 || options->spaceWidth < -1) {
+            SetError("Invalid parameter: threshold must be 0-255 and spaceWidth at least -1");
+            return -1;
+        }
+        left = options->roiX;
+        top = options->roiY;
+        roiWidth = options->roiWidth;
+        roiHeight = options->roiHeight;
+        textOptions.Polarity = static_cast<ETextPolarity>(options->polarity);
+        textOptions.Threshold = options->threshold;
+        if (options->minScore != 0.0f) {
+            textOptions.MinScore = options->minScore;
+        }
+        textOptions.SpaceWidth = options->spaceWidth;
+    }
+    
+    std::shared_ptr<const CachedFrame> frame = AcquireLatestFrame();
+    if (!frame) {
+        SetError("No frame captured yet");
+        return -1;
+    }
+    SImageView view = ViewOfCachedFrame(*frame);
+    if (view.Format != EPixelFormat::BGRA8 && view.Format != EPixelFormat::Gray8) {
+        SetError("Text reading needs a BGRA8 or GRAY8 frame");
+        return -1;
+    }
+    
+    // Narrow the view to the field; its pixels keep the frame's stride
+    SPixelRect area = ClipToFrame(left, top, roiWidth, roiHeight, view.Width, view.Height);
+    if (area.IsEmpty()) {
+        SetError("Text field is outside the frame");
+        return -1;
+    }
+    view.Data = view.Row(area.Top) + static_cast<size_t>(area.Left) * GetBytesPerPixel(view.Format);
+    view.Width = area.GetWidth();
+    view.Height = area.GetHeight();
+    
+    std::lock_guard<std::mutex> lock(g_GlyphMutex);
+    if (glyphSet < 0 || glyphSet >= static_cast<int>(g_GlyphSets.size()) || !g_GlyphSets[glyphSet]) {
+        SetError("Unknown glyph set");
+        return -1;
+    }
+    if (!g_GlyphSets[glyphSet]->Recognize(view, textOptions, g_GlyphResults)) {
+        SetError("Glyph set is empty");
+        return -1;
+    }
+    
+    std::string text;
+    for (const SGlyphResult& result : g_GlyphResults) {
+        AppendUtf8(text, result.Code);
+    }
+    int count = static_cast<int>(g_GlyphResults.size());
+    if (static_cast<int>(text.size()) >= textSize || (outConfidences && count > maxConfidences)) {
+        SetError("Text buffer too small");
+        return -1;
+    }
+    memcpy(outText, text.c_str(), text.size() + 1);
+    if (outConfidences) {
+        for (int i = 0; i < count; i++) {
+            outConfidences[i] = g_GlyphResults[i].Confidence;
+        }
+    }
+    return count;
+}
+
+WC_API void WC_Shutdown() {
+    StopCaptureThread();
+    WC_DisableFrameHistory();
+    WC_StopFrameServer();
+    WC_DisconnectFrameServer();
+    WC_DisableResultBoard();
+    {
+        std::lock_guard<std::mutex> lock(g_ResultBoardMutex);
+        g_ResultFields.clear();
+    }
+    
+    // Writes whatever is still queued before the encoder thread exits
+    {
+        std::lock_guard<std::mutex> lock(g_ScreenshotMutex);
+        g_ScreenshotService.reset();
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(g_MatcherMutex);
+        g_TemplateTracker.reset();
+        g_TemplateMatcher.reset();
+        std::vector<SMatch>().swap(g_Matches);
+    }
+    ResetFramePyramid();
+    
+    {
+        std::lock_guard<std::mutex> lock(g_ClassifierMutex);
+        g_Classifiers.clear();
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(g_BlobMutex);
+        g_BlobDetector.reset();
+        std::vector<SBlob>().swap(g_Blobs);
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(g_MaskMutex);
+        std::vector<uint8_t>().swap(g_MaskLabels);
+        std::vector<uint8_t>().swap(g_MaskPixels);
+        std::vector<uint8_t>().swap(g_MaskRow);
+        std::vector<uint8_t>().swap(g_MaskBits);
+        std::vector<int32_t>().swap(g_MaskRowStarts);
+        std::vector<SMaskRun>().swap(g_MaskRuns);
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(g_PaletteMutex);
+        g_Palettes.clear();
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(g_GlyphMutex);
+        g_GlyphSets.clear();
+        std::vector<SGlyphResult>().swap(g_GlyphResults);
+    }
+    
+    std::lock_guard<std::mutex> lock(g_JpegMutex);
+    g_JpegEncoder.reset();
+    std::vector<uint8_t>().swap(g_JpegOutput);
 }
 
 } // extern "C"
@@ -18,6 +18,381 @@ typedef struct WC_FrameInfo {
     void* data;  // Pointer to pixel data (BGRA format)
 } WC_FrameInfo;
 
+// Extended frame info with sequencing and timing metadata
+// Timestamps are in 100 ns units of the QueryPerformanceCounter clock
+typedef struct WC_FrameInfoEx {
+    int width;
+    int height;
+    int stride;
+    void* data;                     // Pointer to pixel data in the configured output format
+    int format;                     // WC_OutputFormat of data
+    int isCached;                   // 1 if this is the cached fallback frame rather than a fresh readback
+    unsigned long long sequence;    // Capture sequence number of the frame (1-based, monotonic)
+    long long presentationTime;     // When the frame was presented to the capture session
+    long long readbackTime;         // When the CPU readback of the frame completed
+    int droppedFrames;              // Frames that arrived since the previous call but were never returned
+    int generation;                 // Capture target generation, changes on start and retarget
+} WC_FrameInfoEx;
+
+// How frame capture calls wait for a new frame
+typedef enum WC_FrameWaitMode {
+    WC_WAIT_NEXT_FRAME = 0,         // Wait for a new frame while one is expected (default)
+    WC_WAIT_LATEST_NOW = 1,         // Return the latest frame without waiting
+    WC_WAIT_WITHIN_BUDGET = 2       // Wait only if a new frame is expected within the budget
+} WC_FrameWaitMode;
+
+// Startup timing breakdown in milliseconds
+typedef struct WC_StartupTimings {
+    double threadStartMs;           // Spawning the capture thread until it reported ready
+    double deviceMs;                // D3D11 device creation (worker thread)
+    double dispatcherMs;            // WinRT apartment and dispatcher queue setup (capture thread)
+    double factoryMs;               // Capture item activation factory lookup (worker thread)
+    double initializeMs;            // Wall time of the overlapped initialization
+    double totalMs;                 // Thread start plus initialization
+} WC_StartupTimings;
+
+// Pixel format of the capture frame pool
+typedef enum WC_CaptureFormat {
+    WC_CAPTURE_FORMAT_BGRA8 = 0,    // B8G8R8A8UIntNormalized (SDR)
+    WC_CAPTURE_FORMAT_RGBA16F = 1   // R16G16B16A16Float (scRGB, HDR windows)
+} WC_CaptureFormat;
+
+// Pixel format of frames returned to the caller
+typedef enum WC_OutputFormat {
+    WC_OUTPUT_FORMAT_BGRA8 = 0,     // 4 bytes per pixel
+    WC_OUTPUT_FORMAT_GRAY8 = 1      // 1 byte per pixel (luma)
+} WC_OutputFormat;
+
+// State of the most recent WC_DumpReplay
+typedef enum WC_ReplayDumpStatus {
+    WC_REPLAY_DUMP_IDLE = 0,        // No dump was started
+    WC_REPLAY_DUMP_RUNNING = 1,     // Writing in the background
+    WC_REPLAY_DUMP_DONE = 2,        // File written completely
+    WC_REPLAY_DUMP_FAILED = 3       // File could not be written
+} WC_ReplayDumpStatus;
+
+// Reduction over each neighbourhood in WC_SampleNeighbourhoods
+typedef enum WC_SampleMode {
+    WC_SAMPLE_MEAN = 0,             // Per-channel mean, one colour per point
+    WC_SAMPLE_MINMAX = 1            // Per-channel minimum and maximum, two colours per point
+} WC_SampleMode;
+
+// Score used by WC_MatchTemplates
+typedef enum WC_MatchMethod {
+    WC_MATCH_SAD = 0,               // Mean absolute difference 0-255, lower is better
+    WC_MATCH_SSD = 1,               // Mean squared difference 0-65025, lower is better
+    WC_MATCH_NCC = 2                // Normalized cross-correlation -1 to 1, higher is better
+} WC_MatchMethod;
+
+// Reduction filter of the image pyramid used by WC_MatchTemplates
+typedef enum WC_PyramidFilter {
+    WC_PYRAMID_BOX = 0,             // Mean of each 2x2 block, fastest
+    WC_PYRAMID_GAUSSIAN = 1         // Binomial 4x4, less aliasing on fine patterns
+} WC_PyramidFilter;
+
+// How WC_FindColors reads a WC_ColorTarget
+typedef enum WC_ColorTargetMode {
+    WC_COLOR_TOLERANCE = 0,         // color plus or minus a tolerance per channel
+    WC_COLOR_BOX = 1                // Every channel between color and colorHigh
+} WC_ColorTargetMode;
+
+// Hits WC_FindColors looks for
+typedef enum WC_ColorSearchMode {
+    WC_COLOR_SEARCH_ALL = 0,        // Every hit, with bounding boxes
+    WC_COLOR_SEARCH_FIRST = 1       // Stop at the first hit in row order
+} WC_ColorSearchMode;
+
+// Kinds of WC_ColorRule
+typedef enum WC_ColorRuleType {
+    WC_RULE_HSV = 0,                // Hue, saturation and value ranges
+    WC_RULE_RGB_BOX = 1,            // Every channel between color and colorHigh
+    WC_RULE_PALETTE = 2             // Within maxDistance of color
+} WC_ColorRuleType;
+
+// Compact mask forms written by WC_ThresholdMask, WC_FindColorMask and WC_ClassifyMask
+typedef enum WC_MaskEncoding {
+    WC_MASK_BITS = 0,               // 1 bit per pixel, LSB first: pixel x is bit (x & 7) of byte x / 8 of its row
+    WC_MASK_RUNS = 1                // int rowStarts[height + 1], then (x, length) int pairs of set pixels
+} WC_MaskEncoding;
+
+// How WC_CreateAdaptivePalette picks colours
+typedef enum WC_PaletteMethod {
+    WC_PALETTE_MEDIAN_CUT = 0,      // Splits the widest colour box at its median; suits gradients
+    WC_PALETTE_POPULARITY = 1       // Most frequent colours; suits flat UI colours
+} WC_PaletteMethod;
+
+// Direction a WC_Bar fills in
+typedef enum WC_BarOrientation {
+    WC_BAR_LEFT_TO_RIGHT = 0,
+    WC_BAR_RIGHT_TO_LEFT = 1,
+    WC_BAR_BOTTOM_TO_TOP = 2,
+    WC_BAR_TOP_TO_BOTTOM = 3
+} WC_BarOrientation;
+
+// Which side of the threshold is text for WC_AddGlyph and WC_ReadText
+typedef enum WC_TextPolarity {
+    WC_TEXT_AUTO = 0,               // Whichever side has fewer pixels
+    WC_TEXT_LIGHT_ON_DARK = 1,
+    WC_TEXT_DARK_ON_LIGHT = 2
+} WC_TextPolarity;
+
+// File formats for WC_SaveFrameAsync
+typedef enum WC_ImageFormat {
+    WC_IMAGE_FORMAT_PNG = 0,        // Lossless, smaller
+    WC_IMAGE_FORMAT_QOI = 1         // Lossless, faster to write
+} WC_ImageFormat;
+
+// Background frame saving counters
+typedef struct WC_SaveStats {
+    int pending;                    // Queued or being written
+    int completed;                  // Files written
+    int failed;                     // Files that could not be encoded or written
+    int rejected;                   // Frames not queued because the queue was full
+} WC_SaveStats;
+
+// Frame history usage
+typedef struct WC_FrameHistoryStats {
+    long long frameCount;           // Frames that can be read back
+    long long uniqueFrames;         // Distinct frame contents among them
+    long long uniqueTiles;          // Distinct 64x64 tiles among them
+    long long bytesUsed;            // Memory held, counted against the budget
+    long long oldestTimestamp;      // Presentation time of the oldest frame
+    long long newestTimestamp;      // Presentation time of the newest frame
+} WC_FrameHistoryStats;
+
+// Template search settings
+typedef struct WC_MatchOptions {
+    int method;                     // WC_MatchMethod
+    float maxDifference;            // SAD and SSD: worst score accepted
+    float minCorrelation;           // NCC: worst score accepted
+    int maxResults;                 // Best results returned per template
+    int suppressRadius;             // Results this close to a better one are dropped, -1 = half the template
+    int roiX;                       // Search area, templates must fit inside it
+    int roiY;
+    int roiWidth;                   // 0 = to the frame edge
+    int roiHeight;
+    int pyramidLevels;              // Halvings before the full search (0-8), 0 = full resolution only
+    int pyramidFilter;              // WC_PyramidFilter
+    int coarseCandidates;           // Per template and scale, refined from the coarsest level, 0 = 16
+    float minScale;                 // Template scales tried: minScale times powers of scaleStep up to
+    float maxScale;                 // maxScale, at most 32 of them. 0 for both = 1
+    float scaleStep;                // Above 1, 0 = 1.1
+} WC_MatchOptions;
+
+// One template match
+typedef struct WC_Match {
+    int templateId;
+    int x;                          // Top-left corner of the match in the frame
+    int y;
+    float score;                    // See WC_MatchMethod
+    float scale;                    // Template scale that matched
+} WC_Match;
+
+// Tracked template search settings
+typedef struct WC_TrackOptions {
+    WC_MatchOptions match;          // Full search and thresholds; maxResults is ignored
+    int searchRadius;               // First window: pixels around the last match, 0 = 16
+    int maxRadius;                  // Largest window before the full search, 0 = 128
+} WC_TrackOptions;
+
+// Tracked search counters
+typedef struct WC_TrackStats {
+    long long searches;
+    long long windowHits;           // Found in the first window
+    long long grownHits;            // Found in a larger window
+    long long fullSearches;         // Search area scanned in full
+    long long fullHits;
+    long long misses;               // Not found anywhere
+} WC_TrackStats;
+
+// Colour looked for by WC_FindColors; alpha is ignored
+typedef struct WC_ColorTarget {
+    int mode;                       // WC_ColorTargetMode
+    unsigned int color;             // 0xAARRGGBB
+    unsigned int colorHigh;         // WC_COLOR_BOX: upper corner, color is the lower one
+    int toleranceR;                 // WC_COLOR_TOLERANCE: use the same value on all three for an RGB cube
+    int toleranceG;
+    int toleranceB;
+} WC_ColorTarget;
+
+// Colour search settings
+typedef struct WC_ColorSearchOptions {
+    int mode;                       // WC_ColorSearchMode
+    int roiX;                       // Search area
+    int roiY;
+    int roiWidth;                   // 0 = to the frame edge
+    int roiHeight;
+    int mergeGap;                   // Hits this many pixels apart share a box, 0 = 1 (touching)
+} WC_ColorSearchOptions;
+
+// Bounding box of nearby colour hits
+typedef struct WC_ColorBox {
+    int x;
+    int y;
+    int width;
+    int height;
+    int pixelCount;                 // Hits inside
+} WC_ColorBox;
+
+// Colour rule of a pixel classifier
+typedef struct WC_ColorRule {
+    int type;                       // WC_ColorRuleType
+    int label;                      // 1-255, written where the rule holds
+    float hueMin;                   // WC_RULE_HSV: degrees 0-360, hueMin > hueMax wraps through red
+    float hueMax;
+    float saturationMin;            // WC_RULE_HSV: 0-1
+    float saturationMax;
+    float valueMin;                 // WC_RULE_HSV: 0-1
+    float valueMax;
+    unsigned int color;             // WC_RULE_RGB_BOX: low corner, WC_RULE_PALETTE: the colour (0xAARRGGBB)
+    unsigned int colorHigh;         // WC_RULE_RGB_BOX: high corner
+    float maxDistance;              // WC_RULE_PALETTE: Euclidean RGB distance
+} WC_ColorRule;
+
+// Pixel classification settings
+typedef struct WC_ClassifyOptions {
+    int roiX;                       // Classified area
+    int roiY;
+    int roiWidth;                   // 0 = to the frame edge
+    int roiHeight;
+    int step;                       // One label per step x step block, 0 = 1
+} WC_ClassifyOptions;
+
+// Connected component search settings
+typedef struct WC_BlobOptions {
+    int isLabelMap;                 // 1: components need equal mask values; 0: any non-zero value joins
+    int fourConnected;              // 1: only horizontal and vertical neighbours join; 0: diagonals too
+    int minArea;                    // Smaller components are dropped, 0 = 1
+    int maxBlobs;                   // Keep only this many of the largest, 0 = all
+    int useFrameColors;             // 1: fill meanColor from the latest captured frame
+    int colorX;                     // Frame pixel of mask pixel (x, y): (colorX + x * colorStep + colorStep / 2,
+    int colorY;                     //   colorY + y * colorStep + colorStep / 2), matching WC_ClassifyFrame's roi and step
+    int colorStep;                  // 0 = 1
+} WC_BlobOptions;
+
+// Connected component of a mask
+typedef struct WC_Blob {
+    int x;                          // Bounding box in mask pixels
+    int y;
+    int width;
+    int height;
+    int area;                       // Pixels
+    float centroidX;                // Mean pixel position
+    float centroidY;
+    unsigned int meanColor;         // 0xAARRGGBB, 0 without useFrameColors
+    int label;                      // Mask value of the component
+} WC_Blob;
+
+// Area and sampling of a compact mask
+typedef struct WC_MaskOptions {
+    int encoding;                   // WC_MaskEncoding
+    int roiX;                       // Masked area
+    int roiY;
+    int roiWidth;                   // 0 = to the frame edge
+    int roiHeight;
+    int step;                       // One bit per step x step block, from its centre pixel, 0 = 1
+} WC_MaskOptions;
+
+// Layout of a compact mask
+typedef struct WC_MaskInfo {
+    int width;                      // Mask size in pixels
+    int height;
+    int stride;                     // WC_MASK_BITS: bytes per row, (width + 7) / 8
+    int size;                       // Bytes written, or needed when the buffer is too small
+    int runCount;                   // WC_MASK_RUNS: pairs after rowStarts
+    int pixelCount;                 // Set pixels
+} WC_MaskInfo;
+
+// Bounding box of the set pixels of a compact mask
+typedef struct WC_MaskBounds {
+    int x;
+    int y;
+    int width;
+    int height;
+} WC_MaskBounds;
+
+// Palette built from captured frames
+typedef struct WC_AdaptivePaletteOptions {
+    int method;                     // WC_PaletteMethod
+    int maxColors;                  // 1-256, 0 = 256
+    int sampleStep;                 // Every sampleStep-th pixel in x and y is sampled, 0 = about 16K samples
+    int rebuildEachFrame;           // 1: WC_QuantizeFrame rebuilds the palette from the area it quantizes
+} WC_AdaptivePaletteOptions;
+
+// Area of a frame to quantize
+typedef struct WC_QuantizeOptions {
+    int roiX;
+    int roiY;
+    int roiWidth;                   // 0 = to the frame edge
+    int roiHeight;
+} WC_QuantizeOptions;
+
+// Progress or health bar read by WC_ReadBars
+typedef struct WC_Bar {
+    int x;                          // Bar area, clipped to the frame
+    int y;
+    int width;
+    int height;
+    int orientation;                // WC_BarOrientation
+    int firstTarget;                // Fill colours: targets[firstTarget] onwards in the WC_ReadBars call
+    int targetCount;                // 1-16
+} WC_Bar;
+
+// Fill level of one bar
+typedef struct WC_BarReading {
+    float fraction;                 // 0-1
+    float confidence;               // 0 = no better than noise, 1 = a clean filled/empty step
+    int isValid;                    // 0 if the bar missed the frame or its targets were invalid
+} WC_BarReading;
+
+// Text field read by WC_ReadText
+typedef struct WC_TextOptions {
+    int roiX;                       // Field area
+    int roiY;
+    int roiWidth;                   // 0 = to the frame edge
+    int roiHeight;
+    int polarity;                   // WC_TextPolarity
+    int threshold;                  // Luma 1-255 at and above which pixels are light, 0 = chosen from the field
+    float minScore;                 // Characters scoring lower read as '?', 0 = 0.5
+    int spaceWidth;                 // Gap in pixels read as a space, 0 = 40% of the text height, -1 = no spaces
+} WC_TextOptions;
+
+// Rectangle to extract with WC_ExtractRois
+typedef struct WC_Roi {
+    int x;                          // May extend past the frame; outside pixels read as 0
+    int y;
+    int width;                      // 1-16384
+    int height;
+    int format;                     // WC_OUTPUT_FORMAT_BGRA8 or WC_OUTPUT_FORMAT_GRAY8
+    int outputWidth;                // Area-averaged size up to width x height, 0 keeps the ROI size
+    int outputHeight;               // Each output pixel may average at most 2^24 ROI pixels
+} WC_Roi;
+
+// Where one extracted ROI lies in the arena
+typedef struct WC_RoiLayout {
+    int offset;                     // Byte offset in the arena, 16-byte aligned
+    int width;
+    int height;
+    int stride;                     // Bytes per row, rows are tightly packed
+    int format;                     // WC_OutputFormat
+} WC_RoiLayout;
+
+// Value types of result board fields declared with WC_AddResultField
+typedef enum WC_ResultType {
+    WC_RESULT_INT32 = 1,
+    WC_RESULT_INT64 = 2,
+    WC_RESULT_FLOAT32 = 3,
+    WC_RESULT_FLOAT64 = 4
+} WC_ResultType;
+
+// One value written by WC_PublishResults
+typedef struct WC_ResultValue {
+    int field;                      // Index from WC_FindResultField
+    int element;                    // Array element, 0 for single-value fields
+    long long intValue;             // Written to WC_RESULT_INT32 and WC_RESULT_INT64 fields
+    double floatValue;              // Written to WC_RESULT_FLOAT32 and WC_RESULT_FLOAT64 fields
+} WC_ResultValue;
+
 extern "C" {
 
 /**
@@ -27,6 +402,22 @@ extern "C" {
  */
 WC_API bool WC_Initialize();
 
+/**
+ * Start the capture thread and initialize the capture system in the background,
+ * so the cost is paid at application start rather than at first capture.
+ * Does not wait for initialization; WC_Initialize still has to be called and
+ * returns as soon as the background initialization completed.
+ * @return true if the capture thread started
+ */
+WC_API bool WC_Prewarm();
+
+/**
+ * Get the timing breakdown of the last capture system startup.
+ * @param outTimings Pointer to WC_StartupTimings structure to fill
+ * @return true if a startup has completed
+ */
+WC_API bool WC_GetStartupTimings(WC_StartupTimings* outTimings);
+
 /**
  * Cleanup and release all resources.
  */
@@ -39,6 +430,16 @@ WC_API void WC_Cleanup();
  */
 WC_API bool WC_StartCapture(HWND hwnd);
 
+/**
+ * Switch the running capture to another window without tearing down the pipeline.
+ * The D3D device, frame pool, staging resources and frame cache are kept; frames
+ * from the new window carry a new generation in WC_FrameInfoEx.
+ * Starts a new capture if none is running.
+ * @param hwnd Handle to the window to capture
+ * @return true if the capture was switched
+ */
+WC_API bool WC_RetargetCapture(HWND hwnd);
+
 /**
  * Stop the current capture session.
  */
@@ -84,7 +485,16 @@ WC_API int WC_GetFrameBufferSize();
 WC_API bool WC_CaptureFrameInfo(WC_FrameInfo* outInfo);
 
 /**
- * Free a frame previously returned by WC_CaptureFrame or WC_CaptureFrameInfo.
+ * Capture the latest frame and fill in an extended frame info structure.
+ * Unlike WC_CaptureFrameInfo, cached fallback frames are flagged instead of
+ * being indistinguishable from fresh ones.
+ * @param outInfo Pointer to WC_FrameInfoEx structure to fill
+ * @return true if successful, false if no frame available
+ */
+WC_API bool WC_CaptureFrameInfoEx(WC_FrameInfoEx* outInfo);
+
+/**
+ * Free a frame previously returned by WC_CaptureFrame, WC_CaptureFrameInfo or WC_CaptureFrameInfoEx.
  * @param frameData The pointer returned by WC_CaptureFrame or in WC_FrameInfo.data
  */
 WC_API void WC_FreeFrame(void* frameData);
@@ -95,6 +505,632 @@ WC_API void WC_FreeFrame(void* frameData);
  */
 WC_API const char* WC_GetLastError();
 
+/**
+ * Select the capture and output pixel formats. Output stays BGRA8 while recording.
+ * FP16 captures are tone-mapped to 8-bit sRGB during readback.
+ * @param captureFormat One of WC_CaptureFormat
+ * @param outputFormat One of WC_OutputFormat
+ * @return true if successful
+ */
+WC_API bool WC_SetCaptureFormat(int captureFormat, int outputFormat);
+
+/**
+ * Configure tone mapping used for WC_CAPTURE_FORMAT_RGBA16F captures.
+ * @param exposure Linear scale applied before tone mapping (default 1.0)
+ * @param whitePoint Scene value mapped to full white, 1.0 = SDR white (default 4.0)
+ * @return true if successful
+ */
+WC_API bool WC_SetToneMapping(float exposure, float whitePoint);
+
+/**
+ * Select how capture calls wait for a new frame. Wait deadlines are derived from
+ * a running model of the window's frame intervals (EWMA mean plus jitter), capped at 50 ms.
+ * @param mode One of WC_FrameWaitMode
+ * @param budgetMs Maximum wait for WC_WAIT_WITHIN_BUDGET, ignored otherwise
+ * @return true if successful
+ */
+WC_API bool WC_SetFrameWaitMode(int mode, int budgetMs);
+
+/**
+ * Get the current frame interval model of the capture session.
+ * @param outMeanIntervalMs Receives the smoothed frame interval in milliseconds
+ * @param outJitterMs Receives the smoothed interval deviation in milliseconds
+ * @return true if enough frames were observed to form an estimate
+ */
+WC_API bool WC_GetFrameIntervalStats(double* outMeanIntervalMs, double* outJitterMs);
+
+/**
+ * Record every new frame returned by the capture calls to a file, losslessly
+ * compressed. Needs BGRA8 output, which cannot be changed until the recording stops.
+ * Replaces a recording in progress.
+ * @param path File to create
+ * @return true if the file was created, false with an error for GRAY8 output
+ */
+WC_API bool WC_StartRecording(const char* path);
+
+/**
+ * Finish the recording and write its timestamp index.
+ * @return true if a recording was finalized
+ */
+WC_API bool WC_StopRecording();
+
+/**
+ * Replay a recording through the capture calls instead of a live window. Each capture
+ * call returns the next recorded frame with its recorded timestamp and sequence, and
+ * fails with "End of recording" after the last one. Needs no WC_Initialize.
+ * @param path Recording created by WC_StartRecording
+ * @return true if the recording was opened
+ */
+WC_API bool WC_StartReplay(const char* path);
+
+/**
+ * Move the replay to the last frame recorded at or before a timestamp.
+ * @param timestamp Presentation time in 100 ns units, as in WC_FrameInfoEx
+ * @return true if replaying
+ */
+WC_API bool WC_SeekReplay(long long timestamp);
+
+/**
+ * Stop replaying and return to live capture.
+ */
+WC_API void WC_StopReplay();
+
+/**
+ * Keep a rolling, losslessly compressed history of the frames returned by the capture
+ * calls, so the moments before an event can be saved after the fact. Only BGRA8 output
+ * is kept. Frames are compressed on a background thread, so capture calls are not
+ * delayed; if it falls more than a few frames behind, frames are left out of the history.
+ * Replaces the current history.
+ * @param seconds History length to keep
+ * @param maxMegabytes Memory budget; the oldest frames are evicted first when it is reached
+ * @return true if successful
+ */
+WC_API bool WC_EnableReplayBuffer(double seconds, int maxMegabytes);
+
+/**
+ * Stop keeping frame history and release its memory.
+ */
+WC_API void WC_DisableReplayBuffer();
+
+/**
+ * Write the current frame history to a recording file on a background thread.
+ * Capture continues meanwhile. The file can be played with WC_StartReplay.
+ * @param path File to create
+ * @return true if the dump started; poll WC_GetReplayDumpStatus for the result
+ */
+WC_API bool WC_DumpReplay(const char* path);
+
+/**
+ * Get the state of the most recent WC_DumpReplay.
+ * @return One of WC_ReplayDumpStatus
+ */
+WC_API int WC_GetReplayDumpStatus();
+
+/**
+ * Keep a long-term history of the frames returned by the capture calls. Frames are
+ * stored as grids of shared, compressed 64x64 tiles, so unchanged screen areas cost
+ * no extra memory. Only BGRA8 output is kept. Shares the background thread of
+ * WC_EnableReplayBuffer and, like it, skips frames rather than delay capture calls.
+ * Replaces the current history.
+ * @param maxMegabytes Memory budget; the oldest frames are dropped first when it is reached
+ * @return true if successful
+ */
+WC_API bool WC_EnableFrameHistory(int maxMegabytes);
+
+/**
+ * Stop keeping frame history and release its memory.
+ */
+WC_API void WC_DisableFrameHistory();
+
+/**
+ * Reassemble the last history frame presented at or before a timestamp.
+ * Runs on the calling thread without pausing capture.
+ * @param timestamp Presentation time in 100 ns units, as in WC_FrameInfoEx
+ * @param outInfo Receives the frame; free data with WC_FreeFrame
+ * @return true if a frame was found
+ */
+WC_API bool WC_GetHistoryFrame(long long timestamp, WC_FrameInfoEx* outInfo);
+
+/**
+ * Get the size and time span of the frame history.
+ * @param outStats Pointer to WC_FrameHistoryStats structure to fill
+ * @return true if the history is enabled
+ */
+WC_API bool WC_GetFrameHistoryStats(WC_FrameHistoryStats* outStats);
+
+/**
+ * Save a frame to an image file on a background thread. Only the pixel copy happens
+ * on the calling thread, so the frame can be freed as soon as this returns.
+ * Alpha is not stored.
+ * @param frame BGRA8 or GRAY8 frame, e.g. from WC_CaptureFrameInfoEx
+ * @param path File to write
+ * @param imageFormat One of WC_ImageFormat
+ * @return true if the frame was queued; false if it is invalid or too many saves are pending
+ */
+WC_API bool WC_SaveFrameAsync(const WC_FrameInfoEx* frame, const char* path, int imageFormat);
+
+/**
+ * Block until every frame queued with WC_SaveFrameAsync has been written.
+ */
+WC_API void WC_WaitForSavedFrames();
+
+/**
+ * Get the background frame saving counters.
+ * @param outStats Pointer to WC_SaveStats structure to fill
+ * @return true if successful
+ */
+WC_API bool WC_GetSaveStats(WC_SaveStats* outStats);
+
+/**
+ * Encode a frame as a baseline JPEG in memory, e.g. for live thumbnails.
+ * Encoding is multi-threaded and the downscale is applied while reading the pixels.
+ * @param frame BGRA8 or GRAY8 frame, e.g. from WC_CaptureFrameInfoEx
+ * @param quality JPEG quality 1-100
+ * @param downscale Integer box-filter factor 1-8 (1 = full size)
+ * @param outSize Receives the size of the JPEG data in bytes
+ * @return Pointer to the JPEG file data (must be freed with WC_FreeFrame), or nullptr on failure
+ */
+WC_API void* WC_EncodeJpeg(const WC_FrameInfoEx* frame, int quality, int downscale, int* outSize);
+
+/**
+ * Publish this process's captured frames to other local processes.
+ * Clients connect through a Unix domain socket at socketPath and receive frames through
+ * shared memory, each cropped and converted to what it subscribed for. Frames are
+ * published as this process captures them, so keep calling WC_CaptureFrame as usual.
+ * @param socketPath File path of the control socket, e.g. "C:\Temp\spyx.sock"
+ * @return true if the server is listening
+ */
+WC_API bool WC_StartFrameServer(const char* socketPath);
+
+/**
+ * Stop the frame server and disconnect its clients.
+ */
+WC_API void WC_StopFrameServer();
+
+/**
+ * Get the number of processes connected to this process's frame server.
+ * @return Client count, 0 when the server is not running
+ */
+WC_API int WC_GetFrameServerClientCount();
+
+/**
+ * Subscribe to the frames of a frame server in another process, instead of capturing here.
+ * Calling again on the same socket renegotiates the subscription in place.
+ * @param socketPath Control socket of the server, as passed to WC_StartFrameServer
+ * @param outputFormat WC_OUTPUT_FORMAT_BGRA8 or WC_OUTPUT_FORMAT_GRAY8
+ * @param roiX Left edge of the region of interest
+ * @param roiY Top edge of the region of interest
+ * @param roiWidth Region width, 0 = to the right edge of the frame
+ * @param roiHeight Region height, 0 = to the bottom edge of the frame
+ * @param maxFps Maximum delivered frame rate, 0 = every frame
+ * @return true if connected
+ */
+WC_API bool WC_ConnectFrameServer(const char* socketPath, int outputFormat, int roiX, int roiY, int roiWidth, int roiHeight, double maxFps);
+
+/**
+ * Wait for the next frame from the connected frame server.
+ * Always returns the newest frame; droppedFrames counts the ones skipped since the last call.
+ * @param timeoutMs Maximum wait in milliseconds, -1 = wait indefinitely
+ * @param outInfo Receives the frame (data must be freed with WC_FreeFrame)
+ * @return true if a frame was received
+ */
+WC_API bool WC_ReceiveFrame(int timeoutMs, WC_FrameInfoEx* outInfo);
+
+/**
+ * Disconnect from the frame server.
+ */
+WC_API void WC_DisconnectFrameServer();
+
+/**
+ * Publish per-frame results into a self-describing memory region that callers read with
+ * plain memory reads instead of one API call per value, e.g. from Java through
+ * Pointer.getByteBuffer. The layout, field schema and read protocol are described in
+ * Server/ResultBoard.h; look fields up by name, since new ones may be added. Fields
+ * published here: frame.sequence, frame.presentationTime, frame.readbackTime (int64),
+ * frame.width, frame.height, frame.droppedFrames (int32). Fields declared with
+ * WC_AddResultField follow them.
+ * @param sharedName Name under which other processes can map the board, or nullptr/"" for
+ *                   this process only
+ * @return true if the board was created
+ */
+WC_API bool WC_EnableResultBoard(const char* sharedName);
+
+/**
+ * Stop publishing results and release the board. Pointers from WC_GetResultBoard become invalid.
+ */
+WC_API void WC_DisableResultBoard();
+
+/**
+ * Get the result board memory of this process.
+ * @param outSize Receives the size of the region in bytes
+ * @return Pointer to the board, valid until WC_DisableResultBoard or WC_Shutdown; nullptr if not enabled
+ */
+WC_API const void* WC_GetResultBoard(int* outSize);
+
+/**
+ * Declare a caller-defined result board field, e.g. the hit count of a colour search or a
+ * bar reading, so analysis results reach board readers alongside the frame fields. The
+ * schema is fixed while the board is enabled: declare fields before WC_EnableResultBoard.
+ * Declarations persist across WC_DisableResultBoard and are cleared by WC_Shutdown.
+ * @param name Unique field name of 1-31 characters; names starting with "frame." are reserved
+ * @param type WC_ResultType of the values
+ * @param count Number of elements, 1 for a single value or more for a fixed-size array
+ * @return true if the field was declared
+ */
+WC_API bool WC_AddResultField(const char* name, int type, int count);
+
+/**
+ * Look up a field of the enabled result board, for WC_PublishResults.
+ * @param name Field name, built-in or declared with WC_AddResultField
+ * @return Field index, or -1 if the board is not enabled or has no such field
+ */
+WC_API int WC_FindResultField(const char* name);
+
+/**
+ * Write a batch of values to the result board as one update, so readers see either none
+ * or all of them. The batch is checked first and nothing is written if any value names an
+ * unknown field or an element past the field's count, or targets a built-in frame field.
+ * @param values Values to write; int values are truncated to int32 for WC_RESULT_INT32 fields
+ * @param count Number of values
+ * @return true if the values were published
+ */
+WC_API bool WC_PublishResults(const WC_ResultValue* values, int count);
+
+/**
+ * Capture a frame into the library without copying it out.
+ * Analysis functions such as WC_SamplePixels run on the latest captured frame, whichever
+ * call captured it; this is the cheap way to refresh it. outInfo->data is always nullptr.
+ * @param outInfo Receives the frame metadata
+ * @return true if a frame (fresh or cached) is available
+ */
+WC_API bool WC_UpdateFrame(WC_FrameInfoEx* outInfo);
+
+/**
+ * Read the colours at many coordinates of the latest captured frame.
+ * @param points count (x, y) pairs
+ * @param count Number of points
+ * @param outColors Receives count colours as BGRA in memory (0xAARRGGBB as an int);
+ *                  GRAY8 frames give grey colours; points outside the frame give 0
+ * @return Number of points inside the frame, or -1 on error
+ */
+WC_API int WC_SamplePixels(const int* points, int count, unsigned int* outColors);
+
+/**
+ * Reduce a size x size neighbourhood around each of many coordinates of the latest frame.
+ * Neighbourhoods are clipped to the frame; even sizes extend right and down.
+ * @param points count (x, y) pairs
+ * @param count Number of points
+ * @param size Neighbourhood size 1-31
+ * @param mode WC_SampleMode
+ * @param outColors Receives count colours for WC_SAMPLE_MEAN, or 2 * count (minimum and
+ *                  maximum per point) for WC_SAMPLE_MINMAX; points outside the frame give 0
+ * @return Number of points inside the frame, or -1 on error
+ */
+WC_API int WC_SampleNeighbourhoods(const int* points, int count, int size, int mode, unsigned int* outColors);
+
+/**
+ * Get the arena size and layout for a set of ROIs, for sizing the buffer of WC_ExtractRois.
+ * @param rois Rectangles with their output format and size
+ * @param count Number of ROIs
+ * @param outLayout Receives count layout entries (optional)
+ * @return Arena size in bytes, or -1 if a ROI is invalid
+ */
+WC_API int WC_GetRoiArenaSize(const WC_Roi* rois, int count, WC_RoiLayout* outLayout);
+
+/**
+ * Copy many rectangles out of the latest captured frame in one pass over it.
+ * Every frame row is read once however many ROIs cover it.
+ * @param rois Rectangles with their output format and size
+ * @param count Number of ROIs
+ * @param arena Receives all ROIs packed as described by outLayout
+ * @param arenaSize Size of arena in bytes, at least WC_GetRoiArenaSize
+ * @param outLayout Receives count layout entries (optional)
+ * @return true if the ROIs were extracted
+ */
+WC_API bool WC_ExtractRois(const WC_Roi* rois, int count, void* arena, int arenaSize, WC_RoiLayout* outLayout);
+
+/**
+ * Register a template image (icon, sprite) for WC_MatchTemplates.
+ * Matching compares luma, so templates and frames may be BGRA8 or GRAY8.
+ * @param image Template pixels, width and height at most 1024
+ * @param useAlphaMask true to compare only pixels with alpha >= 128 (BGRA8 only)
+ * @return Template id, or -1 on error
+ */
+WC_API int WC_AddTemplate(const WC_FrameInfoEx* image, bool useAlphaMask);
+
+/**
+ * Remove a template. Its id may be reused by a later WC_AddTemplate.
+ * @param templateId Id from WC_AddTemplate
+ * @return true if the template existed
+ */
+WC_API bool WC_RemoveTemplate(int templateId);
+
+/**
+ * Search the latest captured frame for several templates at once.
+ * The frame is converted to luma once and shared by all templates; the search is multi-threaded.
+ * With pyramidLevels the coarsest level is searched in full and candidates are refined down to
+ * full resolution. The pyramid is kept per frame, so further calls on the same frame reuse it.
+ * @param templateIds Ids from WC_AddTemplate
+ * @param count Number of templates
+ * @param options Method, thresholds, result count and search area
+ * @param outMatches Receives up to maxMatches results, grouped per template in the order of
+ *                   templateIds, best first
+ * @param maxMatches Capacity of outMatches; count * options->maxResults always suffices
+ * @return Number of matches written, or -1 on error
+ */
+WC_API int WC_MatchTemplates(const int* templateIds, int count, const WC_MatchOptions* options,
+                             WC_Match* outMatches, int maxMatches);
+
+/**
+ * Create a tracker that follows one template across frames.
+ * Each WC_Track first searches a window around the last match at the scale it matched,
+ * doubling it up to maxRadius, and scans the whole search area only when that fails.
+ * @param templateId Id from WC_AddTemplate
+ * @param options Search settings
+ * @return Tracker handle, or -1 on error
+ */
+WC_API int WC_CreateTracker(int templateId, const WC_TrackOptions* options);
+
+/**
+ * Destroy a tracker. Its handle may be reused by a later WC_CreateTracker.
+ * @param tracker Handle from WC_CreateTracker
+ * @return true if the tracker existed
+ */
+WC_API bool WC_DestroyTracker(int tracker);
+
+/**
+ * Forget the last match, so the next WC_Track searches in full, and zero the counters.
+ * @param tracker Handle from WC_CreateTracker
+ * @return true if the tracker exists
+ */
+WC_API bool WC_ResetTracker(int tracker);
+
+/**
+ * Find the tracked template in the latest captured frame.
+ * @param tracker Handle from WC_CreateTracker
+ * @param outMatch Receives the match when found
+ * @return 1 if found, 0 if not, -1 on error
+ */
+WC_API int WC_Track(int tracker, WC_Match* outMatch);
+
+/**
+ * Get a tracker's hit and miss counters.
+ * @param tracker Handle from WC_CreateTracker
+ * @param outStats Receives the counters
+ * @return true on success
+ */
+WC_API bool WC_GetTrackerStats(int tracker, WC_TrackStats* outStats);
+
+/**
+ * Find pixels of the latest captured frame matching any of several colours.
+ * The frame is scanned in place; GRAY8 pixels count as R = G = B.
+ * @param targets Colours to look for
+ * @param count Number of targets, 1-16
+ * @param options Mode, search area and box merging, or NULL for all hits in the whole frame
+ * @param outPoints Receives up to maxPoints hits as (x, y) pairs in row order, may be NULL
+ * @param maxPoints Capacity of outPoints in points
+ * @param outBoxes Receives up to maxBoxes boxes ordered by top then left, may be NULL
+ * @param maxBoxes Capacity of outBoxes
+ * @param outBoxCount Receives the number of boxes found, which may exceed maxBoxes; may be NULL
+ * @return Number of hits (at most 1 with WC_COLOR_SEARCH_FIRST), or -1 on error
+ */
+WC_API int WC_FindColors(const WC_ColorTarget* targets, int count, const WC_ColorSearchOptions* options,
+                         int* outPoints, int maxPoints, WC_ColorBox* outBoxes, int maxBoxes, int* outBoxCount);
+
+/**
+ * Compile colour rules into a pixel classifier.
+ * Rules are tried in order and the first that holds gives the label; palette rules compete,
+ * so the nearest palette colour within its distance wins. Colours no rule holds get label 0.
+ * The rules become a lookup table on the top lutBits of R, G and B, judged at each cell's centre.
+ * @param rules Rules to compile
+ * @param count Number of rules
+ * @param lutBits Table bits per channel, 4-6, 0 = 5 (32 KB table)
+ * @return Classifier id, or -1 on error
+ */
+WC_API int WC_CreateClassifier(const WC_ColorRule* rules, int count, int lutBits);
+
+/**
+ * Destroy a classifier. Its id may be reused by a later WC_CreateClassifier.
+ * @param classifier Id from WC_CreateClassifier
+ * @return true if the classifier existed
+ */
+WC_API bool WC_DestroyClassifier(int classifier);
+
+/**
+ * Label every pixel (or every step x step block, from its centre pixel) of the latest captured frame.
+ * @param classifier Id from WC_CreateClassifier
+ * @param options Area and step, or NULL for the whole frame at full resolution
+ * @param outLabels Receives the GRAY8 label map, rows tightly packed
+ * @param labelsSize Size of outLabels in bytes
+ * @param outWidth Receives the label map width, also when outLabels is too small
+ * @param outHeight Receives the label map height
+ * @param outCounts Receives 256 per-label counts, may be NULL
+ * @return true on success
+ */
+WC_API bool WC_ClassifyFrame(int classifier, const WC_ClassifyOptions* options, unsigned char* outLabels,
+                             int labelsSize, int* outWidth, int* outHeight, unsigned int* outCounts);
+
+/**
+ * Find connected components in a GRAY8 mask, such as a label map from WC_ClassifyFrame.
+ * @param mask Mask pixels; non-zero pixels belong to components
+ * @param width Mask width
+ * @param height Mask height
+ * @param stride Bytes between mask rows
+ * @param options Connectivity, filters and colour source, or NULL for 8-connected binary components
+ * @param outBlobs Receives up to maxBlobs components, largest first, may be NULL
+ * @param maxBlobs Capacity of outBlobs
+ * @return Number of components of at least minArea pixels, which may exceed maxBlobs, or -1 on error
+ */
+WC_API int WC_FindBlobs(const unsigned char* mask, int width, int height, int stride, const WC_BlobOptions* options,
+                        WC_Blob* outBlobs, int maxBlobs);
+
+/**
+ * Mask the pixels of the latest captured frame whose luma reaches a threshold.
+ * @param threshold Luma 0-255; pixels at or above it are set
+ * @param options Encoding, area and step, or NULL for a bit mask of the whole frame
+ * @param outMask Receives the mask in the requested encoding
+ * @param maskSize Size of outMask in bytes
+ * @param outInfo Receives the mask layout, also when outMask is too small
+ * @return true on success
+ */
+WC_API bool WC_ThresholdMask(int threshold, const WC_MaskOptions* options, void* outMask, int maskSize,
+                             WC_MaskInfo* outInfo);
+
+/**
+ * Mask the pixels of the latest captured frame that match any of several colours, as WC_FindColors does.
+ * @param targets Colours to look for
+ * @param count Number of targets, 1-16
+ * @param options Encoding, area and step, or NULL for a bit mask of the whole frame
+ * @param outMask Receives the mask in the requested encoding
+ * @param maskSize Size of outMask in bytes
+ * @param outInfo Receives the mask layout, also when outMask is too small
+ * @return true on success
+ */
+WC_API bool WC_FindColorMask(const WC_ColorTarget* targets, int count, const WC_MaskOptions* options, void* outMask,
+                             int maskSize, WC_MaskInfo* outInfo);
+
+/**
+ * Mask the pixels of the latest captured frame that a classifier labels, without shipping the label map.
+ * @param classifier Id from WC_CreateClassifier
+ * @param label Label to mask, 1-255, or 0 for any non-zero label
+ * @param options Encoding, area and step, or NULL for a bit mask of the whole frame
+ * @param outMask Receives the mask in the requested encoding
+ * @param maskSize Size of outMask in bytes
+ * @param outInfo Receives the mask layout, also when outMask is too small
+ * @return true on success
+ */
+WC_API bool WC_ClassifyMask(int classifier, int label, const WC_MaskOptions* options, void* outMask, int maskSize,
+                            WC_MaskInfo* outInfo);
+
+/**
+ * Count the set pixels of a WC_MASK_BITS mask. Bits past the width of each row are ignored.
+ * @param bits Mask rows
+ * @param width Mask width in pixels
+ * @param height Mask height
+ * @param stride Bytes between rows, at least (width + 7) / 8
+ * @return Set pixels, or -1 on error
+ */
+WC_API long long WC_CountMaskBits(const unsigned char* bits, int width, int height, int stride);
+
+/**
+ * Bounding box of the set pixels of a WC_MASK_BITS mask.
+ * @param bits Mask rows
+ * @param width Mask width in pixels
+ * @param height Mask height
+ * @param stride Bytes between rows, at least (width + 7) / 8
+ * @param outBounds Receives the box, zero when no pixel is set
+ * @return true if any pixel is set
+ */
+WC_API bool WC_GetMaskBounds(const unsigned char* bits, int width, int height, int stride, WC_MaskBounds* outBounds);
+
+/**
+ * Count the set pixels of a WC_MASK_RUNS mask.
+ * @param runs Mask as written by WC_MASK_RUNS
+ * @param height Mask height
+ * @return Set pixels, or -1 on error
+ */
+WC_API long long WC_CountMaskRuns(const int* runs, int height);
+
+/**
+ * Bounding box of the set pixels of a WC_MASK_RUNS mask.
+ * @param runs Mask as written by WC_MASK_RUNS
+ * @param height Mask height
+ * @param outBounds Receives the box, zero when no pixel is set
+ * @return true if any pixel is set
+ */
+WC_API bool WC_GetRunBounds(const int* runs, int height, WC_MaskBounds* outBounds);
+
+/**
+ * Create a fixed palette for WC_QuantizeFrame.
+ * @param colors Palette colours (0xAARRGGBB, alpha ignored)
+ * @param count Number of colours, 1-256
+ * @return Palette id, or -1 on error
+ */
+WC_API int WC_CreatePalette(const unsigned int* colors, int count);
+
+/**
+ * Create a palette from the latest captured frame by median cut or popularity on sampled pixels.
+ * @param options Method, colour count, sampling and rebuilding, or NULL for a 256-colour median cut built once
+ * @return Palette id, or -1 on error
+ */
+WC_API int WC_CreateAdaptivePalette(const WC_AdaptivePaletteOptions* options);
+
+/**
+ * Destroy a palette. Its id may be reused by a later palette.
+ * @param palette Id from WC_CreatePalette or WC_CreateAdaptivePalette
+ * @return true if the palette existed
+ */
+WC_API bool WC_DestroyPalette(int palette);
+
+/**
+ * Quantize the latest captured frame to one palette index per pixel.
+ * Nearest colours are cached per palette, so a palette kept across frames gets faster as it is used.
+ * @param palette Id from WC_CreatePalette or WC_CreateAdaptivePalette
+ * @param options Area, or NULL for the whole frame
+ * @param outIndices Receives the indices, rows tightly packed
+ * @param indicesSize Size of outIndices in bytes
+ * @param outWidth Receives the index map width, also when outIndices is too small
+ * @param outHeight Receives the index map height
+ * @param outPalette Receives the palette the indices refer to, room for 256 colours; may be NULL
+ * @param outColorCount Receives the number of palette colours; may be NULL
+ * @return true on success
+ */
+WC_API bool WC_QuantizeFrame(int palette, const WC_QuantizeOptions* options, unsigned char* outIndices,
+                             int indicesSize, int* outWidth, int* outHeight, unsigned int* outPalette,
+                             int* outColorCount);
+
+/**
+ * Read the fill levels of several bars in the latest captured frame.
+ * Pixels matching a bar's fill colours are counted along its length, and the fill edge is
+ * where a filled-then-empty step fits those counts best.
+ * @param bars Bars to read
+ * @param count Number of bars
+ * @param targets Fill colours shared by the bars, as in WC_FindColors
+ * @param targetCount Number of targets
+ * @param outReadings Receives one reading per bar
+ * @return Number of valid readings, or -1 on error
+ */
+WC_API int WC_ReadBars(const WC_Bar* bars, int count, const WC_ColorTarget* targets, int targetCount,
+                       WC_BarReading* outReadings);
+
+/**
+ * Create an empty glyph set for WC_ReadText.
+ * @return Glyph set id, or -1 on error
+ */
+WC_API int WC_CreateGlyphSet();
+
+/**
+ * Add a glyph image to a set. Images of one set should share a height and baseline, like
+ * cells rendered from one font at the window's size; the text inside is found by binarizing.
+ * @param glyphSet Id from WC_CreateGlyphSet
+ * @param codePoint Character the glyph stands for (Unicode code point); several glyphs may share one
+ * @param image Glyph pixels, BGRA8 or GRAY8
+ * @param polarity WC_TextPolarity of the image
+ * @return true if the glyph was added
+ */
+WC_API bool WC_AddGlyph(int glyphSet, int codePoint, const WC_FrameInfoEx* image, int polarity);
+
+/**
+ * Destroy a glyph set. Its id may be reused by a later WC_CreateGlyphSet.
+ * @param glyphSet Id from WC_CreateGlyphSet
+ * @return true if the set existed
+ */
+WC_API bool WC_DestroyGlyphSet(int glyphSet);
+
+/**
+ * Read short text (digits, timers, coordinates) from a field of the latest captured frame.
+ * Characters are cut at empty columns and matched against the set's glyphs by correlation.
+ * @param glyphSet Id from WC_CreateGlyphSet
+ * @param options Field area and binarization, or NULL for the whole frame with defaults
+ * @param outText Receives the text as NUL-terminated UTF-8
+ * @param textSize Size of outText in bytes
+ * @param outConfidences Receives one 0-1 confidence per character, may be NULL
+ * @param maxConfidences Capacity of outConfidences
+ * @return Number of characters read, or -1 on error
+ */
+WC_API int WC_ReadText(int glyphSet, const WC_TextOptions* options, char* outText, int textSize,
+                       float* outConfidences, int maxConfidences);
+
 /**
  * Shutdown the capture system and stop the capture thread.
  * Call this when completely done with capture.
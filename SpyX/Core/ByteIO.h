@@ -0,0 +1,43 @@
+#ifndef TAPI_BYTE_IO_H
+#define TAPI_BYTE_IO_H
+
+#include <cstdint>
+
+// Little-endian field access for file and wire formats, independent of host byte order.
+
+inline void WriteU16(uint8_t *Out, uint32_t Value)
+{
+    Out[0] = (uint8_t)Value;
+    Out[1] = (uint8_t)(Value >> 8);
+}
+
+inline void WriteU32(uint8_t *Out, uint32_t Value)
+{
+    Out[0] = (uint8_t)Value;
+    Out[1] = (uint8_t)(Value >> 8);
+    Out[2] = (uint8_t)(Value >> 16);
+    Out[3] = (uint8_t)(Value >> 24);
+}
+
+inline void WriteU64(uint8_t *Out, uint64_t Value)
+{
+    WriteU32(Out, (uint32_t)Value);
+    WriteU32(Out + 4, (uint32_t)(Value >> 32));
+}
+
+inline uint32_t ReadU16(const uint8_t *In)
+{
+    return (uint32_t)In[0] | ((uint32_t)In[1] << 8);
+}
+
+inline uint32_t ReadU32(const uint8_t *In)
+{
+    return (uint32_t)In[0] | ((uint32_t)In[1] << 8) | ((uint32_t)In[2] << 16) | ((uint32_t)In[3] << 24);
+}
+
+inline uint64_t ReadU64(const uint8_t *In)
+{
+    return (uint64_t)ReadU32(In) | ((uint64_t)ReadU32(In + 4) << 32);
+}
+
+#endif
@@ -0,0 +1,246 @@
+#include "LocalSocket.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <afunix.h>
+#include <mutex>
+
+#pragma comment(lib, "ws2_32.lib")
+
+typedef SOCKET NativeSocket;
+typedef WSAPOLLFD NativePollEntry;
+
+static bool InitializeSockets()
+{
+    static std::once_flag Once;
+    static bool Initialized = false;
+    std::call_once(Once, []()
+    {
+        WSADATA Data;
+        Initialized = WSAStartup(MAKEWORD(2, 2), &Data) == 0;
+    });
+    return Initialized;
+}
+
+static bool SetNonBlocking(NativeSocket Socket)
+{
+    u_long Enable = 1;
+    return ioctlsocket(Socket, FIONBIO, &Enable) == 0;
+}
+
+static bool WouldBlock()
+{
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+
+static bool Interrupted()
+{
+    return false;
+}
+
+static void CloseNative(NativeSocket Socket)
+{
+    closesocket(Socket);
+}
+
+static void RemovePath(const std::string &Path)
+{
+    DeleteFileA(Path.c_str());
+}
+
+static int PollNative(NativePollEntry *Entries, size_t Count, int TimeoutMs)
+{
+    return WSAPoll(Entries, (ULONG)Count, TimeoutMs);
+}
+
+static const int SendFlags = 0;
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+typedef int NativeSocket;
+typedef pollfd NativePollEntry;
+
+static bool InitializeSockets()
+{
+    return true;
+}
+
+static bool SetNonBlocking(NativeSocket Socket)
+{
+    int Flags = fcntl(Socket, F_GETFL, 0);
+    return Flags >= 0 && fcntl(Socket, F_SETFL, Flags | O_NONBLOCK) == 0;
+}
+
+static bool WouldBlock()
+{
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+static bool Interrupted()
+{
+    return errno == EINTR;
+}
+
+static void CloseNative(NativeSocket Socket)
+{
+    close(Socket);
+}
+
+static void RemovePath(const std::string &Path)
+{
+    unlink(Path.c_str());
+}
+
+static int PollNative(NativePollEntry *Entries, size_t Count, int TimeoutMs)
+{
+    return poll(Entries, (nfds_t)Count, TimeoutMs);
+}
+
+// A vanished client must not raise SIGPIPE in the server
+static const int SendFlags = MSG_NOSIGNAL;
+#endif
+
+static bool MakeAddress(const std::string &Path, sockaddr_un &OutAddress)
+{
+    std::memset(&OutAddress, 0, sizeof(OutAddress));
+    if (Path.empty() || Path.size() >= sizeof(OutAddress.sun_path)) return false;
+
+    OutAddress.sun_family = AF_UNIX;
+    std::memcpy(OutAddress.sun_path, Path.c_str(), Path.size());
+    return true;
+}
+
+CLocalSocket::~CLocalSocket()
+{
+    Close();
+}
+
+bool CLocalSocket::Listen(const std::string &Path)
+{
+    Close();
+
+    sockaddr_un Address;
+    if (!InitializeSockets() || !MakeAddress(Path, Address)) return false;
+
+    NativeSocket Socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (Socket == (NativeSocket)-1) return false;
+
+    RemovePath(Path);
+    if (bind(Socket, (const sockaddr *)&Address, sizeof(Address)) != 0 || listen(Socket, 16) != 0 ||
+        !SetNonBlocking(Socket))
+    {
+        CloseNative(Socket);
+        return false;
+    }
+
+    MHandle = (intptr_t)Socket;
+    MListenPath = Path;
+    return true;
+}
+
+bool CLocalSocket::Accept(CLocalSocket &OutClient)
+{
+    OutClient.Close();
+    if (MHandle == -1) return false;
+
+    NativeSocket Socket = accept((NativeSocket)MHandle, nullptr, nullptr);
+    if (Socket == (NativeSocket)-1) return false;
+
+    // Accepted sockets do not reliably inherit non-blocking mode
+    if (!SetNonBlocking(Socket))
+    {
+        CloseNative(Socket);
+        return false;
+    }
+
+    OutClient.MHandle = (intptr_t)Socket;
+    return true;
+}
+
+bool CLocalSocket::Connect(const std::string &Path)
+{
+    Close();
+
+    sockaddr_un Address;
+    if (!InitializeSockets() || !MakeAddress(Path, Address)) return false;
+
+    NativeSocket Socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (Socket == (NativeSocket)-1) return false;
+
+    if (connect(Socket, (const sockaddr *)&Address, sizeof(Address)) != 0 || !SetNonBlocking(Socket))
+    {
+        CloseNative(Socket);
+        return false;
+    }
+
+    MHandle = (intptr_t)Socket;
+    return true;
+}
+
+void CLocalSocket::Close()
+{
+    if (MHandle != -1) CloseNative((NativeSocket)MHandle);
+    if (!MListenPath.empty()) RemovePath(MListenPath);
+
+    MHandle = -1;
+    MListenPath.clear();
+}
+
+int CLocalSocket::Send(const void *Data, size_t Size)
+{
+    if (MHandle == -1) return -1;
+
+    for (;;)
+    {
+        int Sent = (int)send((NativeSocket)MHandle, (const char *)Data, (int)Size, SendFlags);
+        if (Sent >= 0) return Sent;
+        if (Interrupted()) continue;
+        return WouldBlock() ? 0 : -1;
+    }
+}
+
+int CLocalSocket::Receive(void *Data, size_t Size)
+{
+    if (MHandle == -1) return -1;
+
+    for (;;)
+    {
+        int Received = (int)recv((NativeSocket)MHandle, (char *)Data, (int)Size, 0);
+        if (Received > 0) return Received;
+        if (Received == 0) return -1;
+        if (Interrupted()) continue;
+        return WouldBlock() ? 0 : -1;
+    }
+}
+
+bool CLocalSocket::Poll(std::vector<SPollEntry> &Entries, int TimeoutMs)
+{
+    std::vector<NativePollEntry> Native(Entries.size());
+    for (size_t Index = 0; Index < Entries.size(); Index++)
+    {
+        Native[Index].fd = Entries[Index].Socket ? (NativeSocket)Entries[Index].Socket->MHandle : (NativeSocket)-1;
+        Native[Index].events = POLLIN;
+        if (Entries[Index].WantWrite) Native[Index].events |= POLLOUT;
+        Native[Index].revents = 0;
+        Entries[Index].Readable = false;
+        Entries[Index].Writable = false;
+    }
+
+    int Result = PollNative(Native.data(), Native.size(), TimeoutMs);
+    if (Result < 0) return Interrupted();
+
+    for (size_t Index = 0; Index < Entries.size(); Index++)
+    {
+        // Errors and hang-ups surface as readable so the next Receive reports them
+        Entries[Index].Readable = (Native[Index].revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+        Entries[Index].Writable = (Native[Index].revents & POLLOUT) != 0;
+    }
+    return true;
+}
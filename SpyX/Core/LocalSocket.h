@@ -0,0 +1,54 @@
+#ifndef TAPI_LOCAL_SOCKET_H
+#define TAPI_LOCAL_SOCKET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Non-blocking AF_UNIX stream socket. Windows 10 1803+ supports the same family through
+// Winsock, so both platforms share one code path and socket paths are plain file paths.
+class CLocalSocket
+{
+public:
+    struct SPollEntry
+    {
+        CLocalSocket *Socket = nullptr;
+        bool WantWrite = false;
+        bool Readable = false;     // Data, a pending connection, or a hang-up is waiting
+        bool Writable = false;
+    };
+
+    CLocalSocket() = default;
+    ~CLocalSocket();
+
+    CLocalSocket(const CLocalSocket &) = delete;
+    CLocalSocket &operator=(const CLocalSocket &) = delete;
+
+    // Binds and listens at Path, replacing a stale socket file left by a crashed server
+    bool Listen(const std::string &Path);
+
+    // Returns false when no connection is pending
+    bool Accept(CLocalSocket &OutClient);
+
+    // Connects (blocking) and then switches to non-blocking mode
+    bool Connect(const std::string &Path);
+
+    void Close();
+    bool IsOpen() const { return MHandle != -1; }
+
+    // Bytes transferred, 0 when the call would block, -1 on error or (for Receive) a
+    // closed peer
+    int Send(const void *Data, size_t Size);
+    int Receive(void *Data, size_t Size);
+
+    // Waits up to TimeoutMs (-1 = forever) and fills the Readable/Writable flags.
+    // Returns false on a poll error; a timeout is a success with no flags set.
+    static bool Poll(std::vector<SPollEntry> &Entries, int TimeoutMs);
+
+private:
+    intptr_t MHandle = -1;
+    std::string MListenPath;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+CMappedFile::~CMappedFile()
+{
+    Close();
+}
+
+#ifdef _WIN32
+
+bool CMappedFile::Open(const char *Path)
+{
+    Close();
+
+    HANDLE File = CreateFileA(Path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (File == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER Size;
+    if (!GetFileSizeEx(File, &Size) || Size.QuadPart == 0)
+    {
+        CloseHandle(File);
+        return false;
+    }
+
+    HANDLE Mapping = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!Mapping)
+    {
+        CloseHandle(File);
+        return false;
+    }
+
+    void *View = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!View)
+    {
+        CloseHandle(Mapping);
+        CloseHandle(File);
+        return false;
+    }
+
+    MFile = File;
+    MMapping = Mapping;
+    MData = static_cast<const uint8_t *>(View);
+    MSize = (size_t)Size.QuadPart;
+    return true;
+}
+
+void CMappedFile::Close()
+{
+    if (MData) UnmapViewOfFile(MData);
+    if (MMapping) CloseHandle(MMapping);
+    if (MFile) CloseHandle(MFile);
+
+    MData = nullptr;
+    MSize = 0;
+    MMapping = nullptr;
+    MFile = nullptr;
+}
+
+#else
+
+bool CMappedFile::Open(const char *Path)
+{
+    Close();
+
+    int File = open(Path, O_RDONLY);
+    if (File < 0) return false;
+
+    struct stat Status;
+    if (fstat(File, &Status) != 0 || Status.st_size <= 0)
+    {
+        close(File);
+        return false;
+    }
+
+    void *View = mmap(nullptr, (size_t)Status.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+    close(File);
+    if (View == MAP_FAILED) return false;
+
+    madvise(View, (size_t)Status.st_size, MADV_SEQUENTIAL);
+
+    MData = static_cast<const uint8_t *>(View);
+    MSize = (size_t)Status.st_size;
+    return true;
+}
+
+void CMappedFile::Close()
+{
+    if (MData) munmap(const_cast<uint8_t *>(MData), MSize);
+
+    MData = nullptr;
+    MSize = 0;
+}
+
+#endif
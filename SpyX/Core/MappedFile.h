@@ -0,0 +1,34 @@
+#ifndef TAPI_MAPPED_FILE_H
+#define TAPI_MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Read-only memory mapping of a whole file.
+class CMappedFile
+{
+public:
+    CMappedFile() = default;
+    ~CMappedFile();
+
+    CMappedFile(const CMappedFile &) = delete;
+    CMappedFile &operator=(const CMappedFile &) = delete;
+
+    bool Open(const char *Path);
+    void Close();
+
+    bool IsOpen() const { return MData != nullptr; }
+    const uint8_t *GetData() const { return MData; }
+    size_t GetSize() const { return MSize; }
+
+private:
+    const uint8_t *MData = nullptr;
+    size_t MSize = 0;
+
+#ifdef _WIN32
+    void *MFile = nullptr;
+    void *MMapping = nullptr;
+#endif
+};
+
+#endif
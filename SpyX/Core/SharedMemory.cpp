@@ -0,0 +1,173 @@
+#include "SharedMemory.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+CSharedMemory::~CSharedMemory()
+{
+    Close();
+}
+
+#ifdef _WIN32
+
+static std::string GetSystemName(const std::string &Name)
+{
+    return "Local\\" + Name;
+}
+
+bool CSharedMemory::Create(const std::string &Name, size_t Size)
+{
+    Close();
+    if (Size == 0) return false;
+
+    uint64_t Size64 = Size;
+    HANDLE Mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, (DWORD)(Size64 >> 32),
+        (DWORD)Size64, GetSystemName(Name).c_str());
+    if (!Mapping) return false;
+    if (GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+        CloseHandle(Mapping);
+        return false;
+    }
+
+    void *View = MapViewOfFile(Mapping, FILE_MAP_ALL_ACCESS, 0, 0, Size);
+    if (!View)
+    {
+        CloseHandle(Mapping);
+        return false;
+    }
+
+    MMapping = Mapping;
+    MData = static_cast<uint8_t *>(View);
+    MSize = Size;
+    MName = Name;
+    MIsOwner = true;
+    return true;
+}
+
+bool CSharedMemory::Open(const std::string &Name, bool Writable)
+{
+    Close();
+
+    DWORD Access = Writable ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ;
+    HANDLE Mapping = OpenFileMappingA(Access, FALSE, GetSystemName(Name).c_str());
+    if (!Mapping) return false;
+
+    void *View = MapViewOfFile(Mapping, Access, 0, 0, 0);
+    if (!View)
+    {
+        CloseHandle(Mapping);
+        return false;
+    }
+
+    // Page-rounded, which is fine: the creator's layout header bounds every access
+    MEMORY_BASIC_INFORMATION Information;
+    if (VirtualQuery(View, &Information, sizeof(Information)) == 0)
+    {
+        UnmapViewOfFile(View);
+        CloseHandle(Mapping);
+        return false;
+    }
+
+    MMapping = Mapping;
+    MData = static_cast<uint8_t *>(View);
+    MSize = Information.RegionSize;
+    MName = Name;
+    MIsOwner = false;
+    return true;
+}
+
+void CSharedMemory::Close()
+{
+    // The section disappears with its last handle
+    if (MData) UnmapViewOfFile(MData);
+    if (MMapping) CloseHandle(MMapping);
+
+    MData = nullptr;
+    MSize = 0;
+    MMapping = nullptr;
+    MName.clear();
+    MIsOwner = false;
+}
+
+#else
+
+static std::string GetSystemName(const std::string &Name)
+{
+    return "/" + Name;
+}
+
+bool CSharedMemory::Create(const std::string &Name, size_t Size)
+{
+    Close();
+    if (Size == 0) return false;
+
+    int File = shm_open(GetSystemName(Name).c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (File < 0) return false;
+
+    if (ftruncate(File, (off_t)Size) != 0)
+    {
+        close(File);
+        shm_unlink(GetSystemName(Name).c_str());
+        return false;
+    }
+
+    void *View = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED, File, 0);
+    close(File);
+    if (View == MAP_FAILED)
+    {
+        shm_unlink(GetSystemName(Name).c_str());
+        return false;
+    }
+
+    MData = static_cast<uint8_t *>(View);
+    MSize = Size;
+    MName = Name;
+    MIsOwner = true;
+    return true;
+}
+
+bool CSharedMemory::Open(const std::string &Name, bool Writable)
+{
+    Close();
+
+    int File = shm_open(GetSystemName(Name).c_str(), Writable ? O_RDWR : O_RDONLY, 0);
+    if (File < 0) return false;
+
+    struct stat Status;
+    if (fstat(File, &Status) != 0 || Status.st_size <= 0)
+    {
+        close(File);
+        return false;
+    }
+
+    int Protection = Writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void *View = mmap(nullptr, (size_t)Status.st_size, Protection, MAP_SHARED, File, 0);
+    close(File);
+    if (View == MAP_FAILED) return false;
+
+    MData = static_cast<uint8_t *>(View);
+    MSize = (size_t)Status.st_size;
+    MName = Name;
+    MIsOwner = false;
+    return true;
+}
+
+void CSharedMemory::Close()
+{
+    if (MData) munmap(MData, MSize);
+    if (MIsOwner) shm_unlink(GetSystemName(MName).c_str());
+
+    MData = nullptr;
+    MSize = 0;
+    MName.clear();
+    MIsOwner = false;
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef TAPI_SHARED_MEMORY_H
+#define TAPI_SHARED_MEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Named shared memory region visible to other local processes. Names are plain
+// identifiers; the platform prefix ("Local\" or "/") is added here.
+class CSharedMemory
+{
+public:
+    CSharedMemory() = default;
+    ~CSharedMemory();
+
+    CSharedMemory(const CSharedMemory &) = delete;
+    CSharedMemory &operator=(const CSharedMemory &) = delete;
+
+    // Creates a zero-filled region; fails if the name is already taken
+    bool Create(const std::string &Name, size_t Size);
+
+    // Maps an existing region, read-only unless Writable
+    bool Open(const std::string &Name, bool Writable = false);
+
+    // Unmaps; the creator also removes the name
+    void Close();
+
+    bool IsOpen() const { return MData != nullptr; }
+    uint8_t *GetData() const { return MData; }
+    size_t GetSize() const { return MSize; }
+    const std::string &GetName() const { return MName; }
+
+private:
+    uint8_t *MData = nullptr;
+    size_t MSize = 0;
+    std::string MName;
+    bool MIsOwner = false;
+
+#ifdef _WIN32
+    void *MMapping = nullptr;
+#endif
+};
+
+#endif
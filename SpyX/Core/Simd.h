@@ -0,0 +1,25 @@
+#ifndef TAPI_SIMD_H
+#define TAPI_SIMD_H
+
+// SPYX_NO_SIMD builds every kernel's scalar fallback, to test those paths on SIMD hardware.
+// SSE2 is part of the x64 baseline, so MSVC never defines __SSE2__ there. The F16C and AVX2
+// paths below need SSE2, so they are off with it.
+#if !defined(SPYX_NO_SIMD) && \
+    (defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define SPYX_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// Hardware half conversion is only available when the build targets AVX2 (/arch:AVX2).
+#if defined(SPYX_SSE2) && (defined(__F16C__) || defined(__AVX2__))
+#define SPYX_F16C 1
+#include <immintrin.h>
+#endif
+
+// Gathers and 256-bit integer paths, likewise only with /arch:AVX2.
+#if defined(SPYX_SSE2) && defined(__AVX2__)
+#define SPYX_AVX2 1
+#include <immintrin.h>
+#endif
+
+#endif
@@ -0,0 +1,90 @@
+#include "ThreadPool.h"
+
+CThreadPool::CThreadPool(int ThreadCount)
+{
+    if (ThreadCount <= 0) ThreadCount = (int)std::thread::hardware_concurrency();
+    if (ThreadCount <= 0) ThreadCount = 1;
+
+    MWorkers.reserve(ThreadCount - 1);
+    for (int Index = 1; Index < ThreadCount; Index++)
+    {
+        MWorkers.emplace_back(&CThreadPool::WorkerMain, this);
+    }
+}
+
+CThreadPool::~CThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> Lock(MMutex);
+        MStop = true;
+    }
+    MWorkCondition.notify_all();
+
+    for (std::thread &Worker : MWorkers)
+    {
+        if (Worker.joinable()) Worker.join();
+    }
+}
+
+void CThreadPool::ParallelFor(int Count, const std::function<void(int)> &Function)
+{
+    if (Count <= 0) return;
+
+    if (MWorkers.empty() || Count == 1)
+    {
+        for (int Index = 0; Index < Count; Index++) Function(Index);
+        return;
+    }
+
+    std::lock_guard<std::mutex> SubmitLock(MSubmitMutex);
+
+    {
+        std::lock_guard<std::mutex> Lock(MMutex);
+        MFunction = &Function;
+        MCount = Count;
+        MNextIndex = 0;
+        MPendingWorkers = (int)MWorkers.size();
+        MGeneration++;
+    }
+    MWorkCondition.notify_all();
+
+    RunIndices();
+
+    // Workers still hold a pointer to Function until they report back
+    std::unique_lock<std::mutex> Lock(MMutex);
+    MDoneCondition.wait(Lock, [this] { return MPendingWorkers == 0; });
+    MFunction = nullptr;
+}
+
+void CThreadPool::RunIndices()
+{
+    for (;;)
+    {
+        int Index = MNextIndex.fetch_add(1);
+        if (Index >= MCount) break;
+        (*MFunction)(Index);
+    }
+}
+
+void CThreadPool::WorkerMain()
+{
+    uint64_t SeenGeneration = 0;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> Lock(MMutex);
+            MWorkCondition.wait(Lock, [&] { return MStop || MGeneration != SeenGeneration; });
+            if (MStop) return;
+            SeenGeneration = MGeneration;
+        }
+
+        RunIndices();
+
+        {
+            std::lock_guard<std::mutex> Lock(MMutex);
+            MPendingWorkers--;
+        }
+        MDoneCondition.notify_one();
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef TAPI_THREAD_POOL_H
+#define TAPI_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for data-parallel loops. The calling thread takes part
+// in every loop, so a pool created with one thread runs everything inline.
+class CThreadPool
+{
+public:
+    // ThreadCount includes the calling thread; 0 uses the hardware concurrency
+    explicit CThreadPool(int ThreadCount = 0);
+    ~CThreadPool();
+
+    CThreadPool(const CThreadPool &) = delete;
+    CThreadPool &operator=(const CThreadPool &) = delete;
+
+    int GetThreadCount() const { return (int)MWorkers.size() + 1; }
+
+    // Calls Function(Index) for every Index in [0, Count) and returns when all calls
+    // finished. Calls from several threads are serialized.
+    void ParallelFor(int Count, const std::function<void(int)> &Function);
+
+private:
+    void WorkerMain();
+    void RunIndices();
+
+    std::vector<std::thread> MWorkers;
+    std::mutex MSubmitMutex;
+
+    std::mutex MMutex;
+    std::condition_variable MWorkCondition;
+    std::condition_variable MDoneCondition;
+    uint64_t MGeneration = 0;
+    int MPendingWorkers = 0;
+    bool MStop = false;
+
+    const std::function<void(int)> *MFunction = nullptr;
+    int MCount = 0;
+    std::atomic<int> MNextIndex = 0;
+};
+
+#endif
@@ -0,0 +1,333 @@
+#include "BitMask.h"
+#include "Core/Simd.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static inline int CountTrailingZeros(uint64_t Value)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long Index;
+    _BitScanForward64(&Index, Value);
+    return (int)Index;
+#elif defined(_MSC_VER)
+    unsigned long Index;
+    if (_BitScanForward(&Index, (unsigned long)Value)) return (int)Index;
+    _BitScanForward(&Index, (unsigned long)(Value >> 32));
+    return (int)Index + 32;
+#else
+    return __builtin_ctzll(Value);
+#endif
+}
+
+static inline int GetHighestBit(uint64_t Value)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long Index;
+    _BitScanReverse64(&Index, Value);
+    return (int)Index;
+#elif defined(_MSC_VER)
+    unsigned long Index;
+    if (_BitScanReverse(&Index, (unsigned long)(Value >> 32))) return (int)Index + 32;
+    _BitScanReverse(&Index, (unsigned long)Value);
+    return (int)Index;
+#else
+    return 63 - __builtin_clzll(Value);
+#endif
+}
+
+// Bit count by halving sums, so it needs no POPCNT
+static inline int CountBits(uint64_t Value)
+{
+    Value = Value - ((Value >> 1) & 0x5555555555555555ull);
+    Value = (Value & 0x3333333333333333ull) + ((Value >> 2) & 0x3333333333333333ull);
+    Value = (Value + (Value >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return (int)((Value * 0x0101010101010101ull) >> 56);
+}
+
+// Up to 8 bytes at Data as one word, zero-filled; pixel x of the word is bit x
+static inline uint64_t LoadWord(const uint8_t *Data, int Size)
+{
+    uint64_t Word = 0;
+    std::memcpy(&Word, Data, (size_t)std::min(Size, 8));
+    return Word;
+}
+
+// Last byte of a row, with the bits past Width cleared; Width must not be a multiple of 8
+static inline uint8_t GetTailByte(const uint8_t *Bits, int Width)
+{
+    return (uint8_t)(Bits[Width / 8] & ((1 << (Width & 7)) - 1));
+}
+
+static inline bool IsPassing(uint8_t Byte, EMaskTest Test, uint8_t Value)
+{
+    switch (Test)
+    {
+    case EMaskTest::Equal: return Byte == Value;
+    case EMaskTest::AtLeast: return Byte >= Value;
+    default: return Byte != 0;
+    }
+}
+
+void PackMaskRowReference(const uint8_t *Row, int Width, EMaskTest Test, uint8_t Value, uint8_t *Bits)
+{
+    for (int X = 0; X < Width; X += 8)
+    {
+        int Byte = 0;
+        for (int Bit = 0; Bit < 8 && X + Bit < Width; Bit++)
+        {
+            if (IsPassing(Row[X + Bit], Test, Value)) Byte |= 1 << Bit;
+        }
+        Bits[X / 8] = (uint8_t)Byte;
+    }
+}
+
+#ifdef SPYX_AVX2
+
+// 0xFF lanes pass; NonZero comes back inverted and is flipped after the movemask
+template <EMaskTest Test>
+static inline __m256i TestBytes(__m256i Pixels, __m256i Values)
+{
+    if (Test == EMaskTest::Equal) return _mm256_cmpeq_epi8(Pixels, Values);
+    if (Test == EMaskTest::AtLeast) return _mm256_cmpeq_epi8(_mm256_max_epu8(Pixels, Values), Pixels);
+    return _mm256_cmpeq_epi8(Pixels, _mm256_setzero_si256());
+}
+
+#endif
+
+#ifdef SPYX_SSE2
+
+template <EMaskTest Test>
+static inline __m128i TestBytes(__m128i Pixels, __m128i Values)
+{
+    if (Test == EMaskTest::Equal) return _mm_cmpeq_epi8(Pixels, Values);
+    if (Test == EMaskTest::AtLeast) return _mm_cmpeq_epi8(_mm_max_epu8(Pixels, Values), Pixels);
+    return _mm_cmpeq_epi8(Pixels, _mm_setzero_si128());
+}
+
+#endif
+
+template <EMaskTest Test>
+static void PackRow(const uint8_t *Row, int Width, uint8_t Value, uint8_t *Bits)
+{
+    int X = 0;
+
+#ifdef SPYX_AVX2
+    {
+        const __m256i Values = _mm256_set1_epi8((char)Value);
+        for (; X + 32 <= Width; X += 32)
+        {
+            __m256i Pixels = _mm256_loadu_si256((const __m256i *)(Row + X));
+            uint32_t Mask = (uint32_t)_mm256_movemask_epi8(TestBytes<Test>(Pixels, Values));
+            if (Test == EMaskTest::NonZero) Mask = ~Mask;
+            std::memcpy(Bits + X / 8, &Mask, 4);
+        }
+    }
+#endif
+
+#ifdef SPYX_SSE2
+    {
+        const __m128i Values = _mm_set1_epi8((char)Value);
+        for (; X + 16 <= Width; X += 16)
+        {
+            __m128i Pixels = _mm_loadu_si128((const __m128i *)(Row + X));
+            uint32_t Mask = (uint32_t)_mm_movemask_epi8(TestBytes<Test>(Pixels, Values));
+            if (Test == EMaskTest::NonZero) Mask = ~Mask;
+            Bits[X / 8] = (uint8_t)Mask;
+            Bits[X / 8 + 1] = (uint8_t)(Mask >> 8);
+        }
+    }
+#endif
+
+    if (X < Width) PackMaskRowReference(Row + X, Width - X, Test, Value, Bits + X / 8);
+}
+
+void PackMaskRow(const uint8_t *Row, int Width, EMaskTest Test, uint8_t Value, uint8_t *Bits)
+{
+    switch (Test)
+    {
+    case EMaskTest::Equal: PackRow<EMaskTest::Equal>(Row, Width, Value, Bits); break;
+    case EMaskTest::AtLeast: PackRow<EMaskTest::AtLeast>(Row, Width, Value, Bits); break;
+    default: PackRow<EMaskTest::NonZero>(Row, Width, Value, Bits); break;
+    }
+}
+
+static uint64_t CountByteBits(const uint8_t *Data, int Size)
+{
+    uint64_t Count = 0;
+    int Index = 0;
+
+#ifdef SPYX_SSE2
+    {
+        // The same halving sums on 16 bytes, then one SAD adds the byte counts into two lanes
+        const __m128i Ones = _mm_set1_epi8(0x55);
+        const __m128i Pairs = _mm_set1_epi8(0x33);
+        const __m128i Nibbles = _mm_set1_epi8(0x0F);
+        __m128i Total = _mm_setzero_si128();
+        for (; Index + 16 <= Size; Index += 16)
+        {
+            __m128i Value = _mm_loadu_si128((const __m128i *)(Data + Index));
+            Value = _mm_sub_epi8(Value, _mm_and_si128(_mm_srli_epi64(Value, 1), Ones));
+            Value = _mm_add_epi8(_mm_and_si128(Value, Pairs), _mm_and_si128(_mm_srli_epi64(Value, 2), Pairs));
+            Value = _mm_and_si128(_mm_add_epi8(Value, _mm_srli_epi64(Value, 4)), Nibbles);
+            Total = _mm_add_epi64(Total, _mm_sad_epu8(Value, _mm_setzero_si128()));
+        }
+        Count += (uint64_t)_mm_cvtsi128_si32(Total) + (uint64_t)_mm_cvtsi128_si32(_mm_srli_si128(Total, 8));
+    }
+#endif
+
+    for (; Index < Size; Index += 8) Count += CountBits(LoadWord(Data + Index, Size - Index));
+    return Count;
+}
+
+uint64_t CountMaskBits(const uint8_t *Bits, int Stride, int Width, int Height)
+{
+    uint64_t Count = 0;
+    for (int Y = 0; Y < Height; Y++)
+    {
+        const uint8_t *Row = Bits + (size_t)Y * Stride;
+        Count += CountByteBits(Row, Width / 8);
+        if (Width & 7) Count += CountBits(GetTailByte(Row, Width));
+    }
+    return Count;
+}
+
+// First and last set pixel of a packed row; false if none is set
+static bool FindRowSpan(const uint8_t *Row, int Width, int &First, int &Last)
+{
+    const int Full = Width / 8;
+    const uint8_t Tail = (Width & 7) ? GetTailByte(Row, Width) : 0;
+
+    First = -1;
+    for (int Index = 0; Index < Full; Index += 8)
+    {
+        const uint64_t Word = LoadWord(Row + Index, Full - Index);
+        if (Word)
+        {
+            First = Index * 8 + CountTrailingZeros(Word);
+            break;
+        }
+    }
+    if (First < 0)
+    {
+        if (!Tail) return false;
+        First = Full * 8 + CountTrailingZeros(Tail);
+    }
+
+    if (Tail)
+    {
+        Last = Full * 8 + GetHighestBit(Tail);
+        return true;
+    }
+    for (int Index = Full; Index > 0; Index -= 8)
+    {
+        const int Start = std::max(Index - 8, 0);
+        const uint64_t Word = LoadWord(Row + Start, Index - Start);
+        if (Word)
+        {
+            Last = Start * 8 + GetHighestBit(Word);
+            break;
+        }
+    }
+    return true;
+}
+
+bool GetMaskBounds(const uint8_t *Bits, int Stride, int Width, int Height, SMaskBounds &Bounds)
+{
+    Bounds = SMaskBounds();
+    int Left = Width;
+    int Right = -1;
+    int Top = -1;
+    int Bottom = -1;
+    for (int Y = 0; Y < Height; Y++)
+    {
+        int First = 0;
+        int Last = 0;
+        if (!FindRowSpan(Bits + (size_t)Y * Stride, Width, First, Last)) continue;
+        if (Top < 0) Top = Y;
+        Bottom = Y;
+        Left = std::min(Left, First);
+        Right = std::max(Right, Last);
+    }
+    if (Top < 0) return false;
+
+    Bounds.X = Left;
+    Bounds.Y = Top;
+    Bounds.Width = Right - Left + 1;
+    Bounds.Height = Bottom - Top + 1;
+    return true;
+}
+
+void EncodeMaskRuns(const uint8_t *Bits, int Width, std::vector<SMaskRun> &Runs)
+{
+    const int Stride = GetBitMaskStride(Width);
+    int Open = -1;
+    for (int Base = 0; Base < Width; Base += 64)
+    {
+        uint64_t Word = LoadWord(Bits + Base / 8, Stride - Base / 8);
+        if (Width - Base < 64) Word &= (1ull << (Width - Base)) - 1;
+
+        // Alternately look for the next set bit (run start) and the next clear bit (run end)
+        int Bit = 0;
+        while (Bit < 64)
+        {
+            const uint64_t Pending = (Open < 0 ? Word : ~Word) >> Bit;
+            if (!Pending) break;
+            Bit += CountTrailingZeros(Pending);
+            if (Open < 0)
+            {
+                Open = Base + Bit;
+                continue;
+            }
+            SMaskRun Run;
+            Run.X = Open;
+            Run.Length = Base + Bit - Open;
+            Runs.push_back(Run);
+            Open = -1;
+        }
+    }
+    if (Open >= 0)
+    {
+        SMaskRun Run;
+        Run.X = Open;
+        Run.Length = Width - Open;
+        Runs.push_back(Run);
+    }
+}
+
+uint64_t CountRunPixels(const int32_t *RowStarts, const SMaskRun *Runs, int Height)
+{
+    uint64_t Count = 0;
+    for (int32_t Index = RowStarts[0]; Index < RowStarts[Height]; Index++) Count += (uint64_t)Runs[Index].Length;
+    return Count;
+}
+
+bool GetRunBounds(const int32_t *RowStarts, const SMaskRun *Runs, int Height, SMaskBounds &Bounds)
+{
+    Bounds = SMaskBounds();
+    int Left = INT32_MAX;
+    int Right = -1;
+    int Top = -1;
+    int Bottom = -1;
+    for (int Y = 0; Y < Height; Y++)
+    {
+        if (RowStarts[Y] >= RowStarts[Y + 1]) continue;
+        const SMaskRun &First = Runs[RowStarts[Y]];
+        const SMaskRun &Last = Runs[RowStarts[Y + 1] - 1];
+        if (Top < 0) Top = Y;
+        Bottom = Y;
+        Left = std::min(Left, (int)First.X);
+        Right = std::max(Right, (int)(Last.X + Last.Length - 1));
+    }
+    if (Top < 0) return false;
+
+    Bounds.X = Left;
+    Bounds.Y = Top;
+    Bounds.Width = Right - Left + 1;
+    Bounds.Height = Bottom - Top + 1;
+    return true;
+}
@@ -0,0 +1,56 @@
+#ifndef TAPI_BIT_MASK_H
+#define TAPI_BIT_MASK_H
+
+#include <cstdint>
+#include <vector>
+
+// Compact forms of Gray8 masks and label maps. A bit mask holds one bit per pixel: pixel x of
+// a row is bit (x & 7) of byte x / 8, least significant bit first, and packing clears the
+// unused bits of each row's last byte. A run list holds each row's set pixels as (start,
+// length) pairs in column order, with RowStarts[y] the index of row y's first run and
+// RowStarts[Height] the run count. Counting and bounding boxes work on either form directly.
+
+enum class EMaskTest : int
+{
+    NonZero = 0,    // Any non-zero byte, the test value is ignored
+    Equal = 1,      // Byte equals the test value, such as one classifier label
+    AtLeast = 2     // Byte is at least the test value, such as a luma threshold
+};
+
+struct SMaskRun
+{
+    int32_t X = 0;
+    int32_t Length = 0;
+};
+
+struct SMaskBounds
+{
+    int X = 0;
+    int Y = 0;
+    int Width = 0;
+    int Height = 0;
+};
+
+// Bytes per bit mask row when rows are tightly packed
+inline int GetBitMaskStride(int Width)
+{
+    return (Width + 7) / 8;
+}
+
+// Packs Width bytes of Row into GetBitMaskStride(Width) bytes, setting the bits that pass Test
+void PackMaskRow(const uint8_t *Row, int Width, EMaskTest Test, uint8_t Value, uint8_t *Bits);
+void PackMaskRowReference(const uint8_t *Row, int Width, EMaskTest Test, uint8_t Value, uint8_t *Bits);
+
+// Bits past Width in each row are ignored, whatever they hold
+uint64_t CountMaskBits(const uint8_t *Bits, int Stride, int Width, int Height);
+
+// False and empty bounds if no bit is set
+bool GetMaskBounds(const uint8_t *Bits, int Stride, int Width, int Height, SMaskBounds &Bounds);
+
+// Appends the runs of one packed row to Runs
+void EncodeMaskRuns(const uint8_t *Bits, int Width, std::vector<SMaskRun> &Runs);
+
+uint64_t CountRunPixels(const int32_t *RowStarts, const SMaskRun *Runs, int Height);
+bool GetRunBounds(const int32_t *RowStarts, const SMaskRun *Runs, int Height, SMaskBounds &Bounds);
+
+#endif
@@ -0,0 +1,834 @@
+#include "ImageEncoder.h"
+#include "Core/Simd.h"
+
+#include <cstring>
+
+// ---------------------------------------------------------------------------
+// Shared helpers
+// ---------------------------------------------------------------------------
+
+static inline void WriteBE32(uint8_t *Out, uint32_t Value)
+{
+    Out[0] = (uint8_t)(Value >> 24);
+    Out[1] = (uint8_t)(Value >> 16);
+    Out[2] = (uint8_t)(Value >> 8);
+    Out[3] = (uint8_t)Value;
+}
+
+static inline uint32_t Load32(const uint8_t *Data)
+{
+    uint32_t Value;
+    std::memcpy(&Value, Data, sizeof(Value));
+    return Value;
+}
+
+static inline uint64_t Load64(const uint8_t *Data)
+{
+    uint64_t Value;
+    std::memcpy(&Value, Data, sizeof(Value));
+    return Value;
+}
+
+static bool IsEncodable(const SImageView &Image)
+{
+    return Image.IsValid() && (Image.Format == EPixelFormat::BGRA8 || Image.Format == EPixelFormat::Gray8);
+}
+
+// ---------------------------------------------------------------------------
+// Checksums
+// ---------------------------------------------------------------------------
+
+struct SCrcTable
+{
+    uint32_t Entries[4][256];
+
+    SCrcTable()
+    {
+        for (uint32_t Byte = 0; Byte < 256; Byte++)
+        {
+            uint32_t Value = Byte;
+            for (int Bit = 0; Bit < 8; Bit++) Value = (Value >> 1) ^ (0xEDB88320u & (0u - (Value & 1)));
+            Entries[0][Byte] = Value;
+        }
+        for (uint32_t Byte = 0; Byte < 256; Byte++)
+        {
+            for (int Slice = 1; Slice < 4; Slice++)
+            {
+                uint32_t Previous = Entries[Slice - 1][Byte];
+                Entries[Slice][Byte] = (Previous >> 8) ^ Entries[0][Previous & 0xFF];
+            }
+        }
+    }
+};
+
+static uint32_t Crc32(const uint8_t *Data, size_t Size)
+{
+    static const SCrcTable Table;
+
+    uint32_t Crc = 0xFFFFFFFFu;
+    size_t Index = 0;
+    for (; Index + 4 <= Size; Index += 4)
+    {
+        Crc ^= (uint32_t)Data[Index] | ((uint32_t)Data[Index + 1] << 8) |
+            ((uint32_t)Data[Index + 2] << 16) | ((uint32_t)Data[Index + 3] << 24);
+        Crc = Table.Entries[3][Crc & 0xFF] ^ Table.Entries[2][(Crc >> 8) & 0xFF] ^
+            Table.Entries[1][(Crc >> 16) & 0xFF] ^ Table.Entries[0][Crc >> 24];
+    }
+    for (; Index < Size; Index++) Crc = (Crc >> 8) ^ Table.Entries[0][(Crc ^ Data[Index]) & 0xFF];
+    return Crc ^ 0xFFFFFFFFu;
+}
+
+static uint32_t Adler32(const uint8_t *Data, size_t Size)
+{
+    // 5552 is the largest block whose sums cannot overflow 32 bits
+    uint32_t A = 1;
+    uint32_t B = 0;
+    while (Size > 0)
+    {
+        size_t Block = Size < 5552 ? Size : 5552;
+        Size -= Block;
+        for (size_t Index = 0; Index < Block; Index++)
+        {
+            A += Data[Index];
+            B += A;
+        }
+        Data += Block;
+        A %= 65521;
+        B %= 65521;
+    }
+    return (B << 16) | A;
+}
+
+// ---------------------------------------------------------------------------
+// PNG filtering
+// ---------------------------------------------------------------------------
+
+// Out = A - B, bytewise
+static void SubtractBytes(const uint8_t *A, const uint8_t *B, uint8_t *Out, size_t Count)
+{
+    size_t Index = 0;
+#ifdef SPYX_SSE2
+    for (; Index + 16 <= Count; Index += 16)
+    {
+        __m128i ValueA = _mm_loadu_si128((const __m128i *)(A + Index));
+        __m128i ValueB = _mm_loadu_si128((const __m128i *)(B + Index));
+        _mm_storeu_si128((__m128i *)(Out + Index), _mm_sub_epi8(ValueA, ValueB));
+    }
+#endif
+    for (; Index < Count; Index++) Out[Index] = (uint8_t)(A[Index] - B[Index]);
+}
+
+// Sum of absolute values of the bytes read as signed, the usual filter selection heuristic
+static uint64_t FilterCost(const uint8_t *Row, size_t Count)
+{
+    uint64_t Cost = 0;
+    size_t Index = 0;
+#ifdef SPYX_SSE2
+    __m128i Zero = _mm_setzero_si128();
+    __m128i Sum = _mm_setzero_si128();
+    for (; Index + 16 <= Count; Index += 16)
+    {
+        __m128i Value = _mm_loadu_si128((const __m128i *)(Row + Index));
+        __m128i Magnitude = _mm_min_epu8(Value, _mm_sub_epi8(Zero, Value));
+        Sum = _mm_add_epi64(Sum, _mm_sad_epu8(Magnitude, Zero));
+    }
+    Cost = (uint64_t)_mm_cvtsi128_si32(Sum) + (uint64_t)_mm_cvtsi128_si32(_mm_srli_si128(Sum, 8));
+#endif
+    for (; Index < Count; Index++)
+    {
+        uint8_t Value = Row[Index];
+        Cost += Value < 128 ? Value : 256 - Value;
+    }
+    return Cost;
+}
+
+static void ConvertRowToRGB(const uint8_t *Source, int Width, uint8_t *Out)
+{
+    for (int X = 0; X < Width; X++)
+    {
+        Out[0] = Source[2];
+        Out[1] = Source[1];
+        Out[2] = Source[0];
+        Source += 4;
+        Out += 3;
+    }
+}
+
+// Filtered scanlines, each prefixed with its filter type byte
+static void FilterImage(const SImageView &Image, std::vector<uint8_t> &Output)
+{
+    const int PixelBytes = Image.Format == EPixelFormat::BGRA8 ? 3 : 1;
+    const size_t RowBytes = (size_t)Image.Width * PixelBytes;
+
+    Output.resize((RowBytes + 1) * (size_t)Image.Height);
+
+    std::vector<uint8_t> Scratch(RowBytes * 4);
+    uint8_t *Current = Scratch.data();
+    uint8_t *Previous = Current + RowBytes;
+    uint8_t *Sub = Previous + RowBytes;
+    uint8_t *Up = Sub + RowBytes;
+
+    for (int Y = 0; Y < Image.Height; Y++)
+    {
+        const uint8_t *Raw = Image.Row(Y);
+        if (PixelBytes == 3)
+        {
+            ConvertRowToRGB(Raw, Image.Width, Current);
+            Raw = Current;
+        }
+
+        std::memcpy(Sub, Raw, PixelBytes);
+        SubtractBytes(Raw + PixelBytes, Raw, Sub + PixelBytes, RowBytes - PixelBytes);
+
+        uint8_t Type = 0;
+        const uint8_t *Best = Raw;
+        uint64_t BestCost = FilterCost(Raw, RowBytes);
+
+        uint64_t SubCost = FilterCost(Sub, RowBytes);
+        if (SubCost < BestCost)
+        {
+            Type = 1;
+            Best = Sub;
+            BestCost = SubCost;
+        }
+
+        if (Y > 0)
+        {
+            SubtractBytes(Raw, Previous, Up, RowBytes);
+            if (FilterCost(Up, RowBytes) < BestCost)
+            {
+                Type = 2;
+                Best = Up;
+            }
+        }
+
+        uint8_t *Out = Output.data() + (size_t)Y * (RowBytes + 1);
+        Out[0] = Type;
+        std::memcpy(Out + 1, Best, RowBytes);
+
+        if (PixelBytes == 3)
+        {
+            uint8_t *Swap = Previous;
+            Previous = Current;
+            Current = Swap;
+        }
+        else
+        {
+            std::memcpy(Previous, Raw, RowBytes);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Deflate
+// ---------------------------------------------------------------------------
+
+static const int MinMatch = 4;
+static const int MaxMatch = 258;
+static const int WindowSize = 32768;
+static const int HashBits = 15;
+static const size_t TokensPerBlock = 1 << 16;
+static const uint32_t NoPosition = UINT32_MAX;
+
+static const uint16_t LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
+    67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4,
+    5, 5, 5, 5, 0 };
+static const uint16_t DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+    513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10,
+    10, 11, 11, 12, 12, 13, 13 };
+static const uint8_t CodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+struct SDeflateTables
+{
+    uint8_t LengthCode[MaxMatch + 1];  // Match length -> index into LengthBase
+    uint8_t DistanceCode[512];         // See GetDistanceCode
+
+    SDeflateTables()
+    {
+        for (int Code = 0; Code < 29; Code++)
+        {
+            int End = Code + 1 < 29 ? LengthBase[Code + 1] : MaxMatch + 1;
+            for (int Length = LengthBase[Code]; Length < End; Length++) LengthCode[Length] = (uint8_t)Code;
+        }
+
+        for (int Code = 0; Code < 30; Code++)
+        {
+            int Span = 1 << DistanceExtra[Code];
+            for (int Offset = 0; Offset < Span; Offset++)
+            {
+                int Distance = DistanceBase[Code] + Offset - 1;
+                if (Distance < 256) DistanceCode[Distance] = (uint8_t)Code;
+                else if ((Distance & 127) == 0) DistanceCode[256 + (Distance >> 7)] = (uint8_t)Code;
+            }
+        }
+    }
+
+    // From code 16 on every span starts on a multiple of 128, so large distances index by Distance / 128
+    int GetDistanceCode(int Distance) const
+    {
+        return Distance <= 256 ? DistanceCode[Distance - 1] : DistanceCode[256 + ((Distance - 1) >> 7)];
+    }
+};
+
+static const SDeflateTables &GetDeflateTables()
+{
+    static const SDeflateTables Tables;
+    return Tables;
+}
+
+class CBitWriter
+{
+public:
+    explicit CBitWriter(std::vector<uint8_t> &Output) : MOutput(Output) {}
+
+    void Put(uint32_t Bits, int Count)
+    {
+        MBuffer |= (uint64_t)Bits << MCount;
+        MCount += Count;
+        while (MCount >= 8)
+        {
+            MOutput.push_back((uint8_t)MBuffer);
+            MBuffer >>= 8;
+            MCount -= 8;
+        }
+    }
+
+    void Flush()
+    {
+        if (MCount > 0) MOutput.push_back((uint8_t)MBuffer);
+        MBuffer = 0;
+        MCount = 0;
+    }
+
+private:
+    std::vector<uint8_t> &MOutput;
+    uint64_t MBuffer = 0;
+    int MCount = 0;
+};
+
+// Length-limited Huffman code lengths: plain Huffman over the used symbols, then the
+// deepest leaves are pulled up to MaxBits while keeping the code complete
+static void BuildCodeLengths(const uint32_t *Frequencies, int Count, int MaxBits, uint8_t *Lengths)
+{
+    std::memset(Lengths, 0, Count);
+
+    std::vector<int> Symbols;
+    for (int Symbol = 0; Symbol < Count; Symbol++)
+    {
+        if (Frequencies[Symbol] > 0) Symbols.push_back(Symbol);
+    }
+    // A single code would be incomplete, which strict decoders reject
+    for (int Symbol = 0; Symbols.size() < 2; Symbol++)
+    {
+        if (Frequencies[Symbol] == 0) Symbols.push_back(Symbol);
+    }
+
+    // Ascending by frequency; unused padding symbols count as 1
+    auto Weight = [&](int Symbol) { return Frequencies[Symbol] > 0 ? Frequencies[Symbol] : 1u; };
+    for (size_t Index = 1; Index < Symbols.size(); Index++)
+    {
+        int Symbol = Symbols[Index];
+        size_t Position = Index;
+        while (Position > 0 && Weight(Symbols[Position - 1]) > Weight(Symbol))
+        {
+            Symbols[Position] = Symbols[Position - 1];
+            Position--;
+        }
+        Symbols[Position] = Symbol;
+    }
+
+    // Two-queue Huffman: leaves are sorted, merged nodes come out in ascending order
+    const int LeafCount = (int)Symbols.size();
+    std::vector<uint64_t> NodeWeight(LeafCount * 2);
+    std::vector<int> Parent(LeafCount * 2, -1);
+    for (int Leaf = 0; Leaf < LeafCount; Leaf++) NodeWeight[Leaf] = Weight(Symbols[Leaf]);
+
+    int NextLeaf = 0;
+    int NextMerged = LeafCount;
+    int NodeCount = LeafCount;
+    auto TakeSmallest = [&]() {
+        if (NextLeaf < LeafCount && (NextMerged >= NodeCount || NodeWeight[NextLeaf] <= NodeWeight[NextMerged]))
+        {
+            return NextLeaf++;
+        }
+        return NextMerged++;
+    };
+    while (NodeCount < LeafCount * 2 - 1)
+    {
+        int First = TakeSmallest();
+        int Second = TakeSmallest();
+        NodeWeight[NodeCount] = NodeWeight[First] + NodeWeight[Second];
+        Parent[First] = NodeCount;
+        Parent[Second] = NodeCount;
+        NodeCount++;
+    }
+
+    std::vector<int> Depth(NodeCount, 0);
+    int LengthCounts[33] = {};
+    for (int Node = NodeCount - 2; Node >= 0; Node--)
+    {
+        Depth[Node] = Depth[Parent[Node]] + 1;
+        if (Node < LeafCount) LengthCounts[Depth[Node] < 32 ? Depth[Node] : 32]++;
+    }
+
+    // Fold overlong codes into MaxBits, then split shorter codes until the Kraft sum is exact
+    for (int Bits = MaxBits + 1; Bits <= 32; Bits++)
+    {
+        LengthCounts[MaxBits] += LengthCounts[Bits];
+        LengthCounts[Bits] = 0;
+    }
+    uint32_t Total = 0;
+    for (int Bits = 1; Bits <= MaxBits; Bits++) Total += (uint32_t)LengthCounts[Bits] << (MaxBits - Bits);
+    while (Total > (1u << MaxBits))
+    {
+        LengthCounts[MaxBits]--;
+        for (int Bits = MaxBits - 1; Bits > 0; Bits--)
+        {
+            if (LengthCounts[Bits] > 0)
+            {
+                LengthCounts[Bits]--;
+                LengthCounts[Bits + 1] += 2;
+                break;
+            }
+        }
+        Total--;
+    }
+
+    // Longest codes to the rarest symbols
+    int Leaf = 0;
+    for (int Bits = MaxBits; Bits > 0; Bits--)
+    {
+        for (int Index = 0; Index < LengthCounts[Bits]; Index++) Lengths[Symbols[Leaf++]] = (uint8_t)Bits;
+    }
+}
+
+// Canonical codes, bit-reversed because deflate writes Huffman codes MSB first into an LSB-first stream
+static void BuildCodes(const uint8_t *Lengths, int Count, uint16_t *Codes)
+{
+    int LengthCounts[16] = {};
+    for (int Symbol = 0; Symbol < Count; Symbol++) LengthCounts[Lengths[Symbol]]++;
+    LengthCounts[0] = 0;
+
+    int NextCode[16] = {};
+    int Code = 0;
+    for (int Bits = 1; Bits < 16; Bits++)
+    {
+        Code = (Code + LengthCounts[Bits - 1]) << 1;
+        NextCode[Bits] = Code;
+    }
+
+    for (int Symbol = 0; Symbol < Count; Symbol++)
+    {
+        int Bits = Lengths[Symbol];
+        if (Bits == 0) continue;
+        int Value = NextCode[Bits]++;
+        int Reversed = 0;
+        for (int Bit = 0; Bit < Bits; Bit++) Reversed |= ((Value >> Bit) & 1) << (Bits - 1 - Bit);
+        Codes[Symbol] = (uint16_t)Reversed;
+    }
+}
+
+// A token is a literal byte (Distance 0) or a match: Length in bits 0-8, Distance from bit 9
+static inline uint32_t MakeLiteral(uint8_t Byte) { return Byte; }
+static inline uint32_t MakeMatch(int Length, int Distance) { return (uint32_t)Length | ((uint32_t)Distance << 9); }
+
+static void WriteBlock(CBitWriter &Writer, const std::vector<uint32_t> &Tokens, bool IsFinal)
+{
+    const SDeflateTables &Tables = GetDeflateTables();
+
+    uint32_t LiteralFrequencies[286] = {};
+    uint32_t DistanceFrequencies[30] = {};
+    for (uint32_t Token : Tokens)
+    {
+        int Distance = (int)(Token >> 9);
+        if (Distance == 0)
+        {
+            LiteralFrequencies[Token]++;
+        }
+        else
+        {
+            LiteralFrequencies[257 + Tables.LengthCode[Token & 511]]++;
+            DistanceFrequencies[Tables.GetDistanceCode(Distance)]++;
+        }
+    }
+    LiteralFrequencies[256] = 1;
+
+    uint8_t LiteralLengths[286];
+    uint8_t DistanceLengths[30];
+    BuildCodeLengths(LiteralFrequencies, 286, 15, LiteralLengths);
+    BuildCodeLengths(DistanceFrequencies, 30, 15, DistanceLengths);
+
+    int LiteralCount = 286;
+    while (LiteralCount > 257 && LiteralLengths[LiteralCount - 1] == 0) LiteralCount--;
+    int DistanceCount = 30;
+    while (DistanceCount > 1 && DistanceLengths[DistanceCount - 1] == 0) DistanceCount--;
+
+    uint8_t Lengths[286 + 30];
+    std::memcpy(Lengths, LiteralLengths, LiteralCount);
+    std::memcpy(Lengths + LiteralCount, DistanceLengths, DistanceCount);
+
+    // Run-length code the combined code length sequence (symbols 16, 17, 18)
+    const int TotalLengths = LiteralCount + DistanceCount;
+    std::vector<uint16_t> LengthSymbols;  // Symbol in the low byte, extra bits value above
+    uint32_t LengthSymbolFrequencies[19] = {};
+    for (int Index = 0; Index < TotalLengths;)
+    {
+        uint8_t Value = Lengths[Index];
+        int Run = 1;
+        while (Index + Run < TotalLengths && Lengths[Index + Run] == Value) Run++;
+        Index += Run;
+
+        if (Value == 0)
+        {
+            while (Run >= 11)
+            {
+                int Chunk = Run < 138 ? Run : 138;
+                LengthSymbols.push_back((uint16_t)(18 | ((Chunk - 11) << 8)));
+                LengthSymbolFrequencies[18]++;
+                Run -= Chunk;
+            }
+            if (Run >= 3)
+            {
+                LengthSymbols.push_back((uint16_t)(17 | ((Run - 3) << 8)));
+                LengthSymbolFrequencies[17]++;
+                Run = 0;
+            }
+        }
+        else
+        {
+            LengthSymbols.push_back(Value);
+            LengthSymbolFrequencies[Value]++;
+            Run--;
+            while (Run >= 3)
+            {
+                int Chunk = Run < 6 ? Run : 6;
+                LengthSymbols.push_back((uint16_t)(16 | ((Chunk - 3) << 8)));
+                LengthSymbolFrequencies[16]++;
+                Run -= Chunk;
+            }
+        }
+        for (; Run > 0; Run--)
+        {
+            LengthSymbols.push_back(Value);
+            LengthSymbolFrequencies[Value]++;
+        }
+    }
+
+    uint8_t CodeLengthLengths[19];
+    uint16_t CodeLengthCodes[19] = {};
+    BuildCodeLengths(LengthSymbolFrequencies, 19, 7, CodeLengthLengths);
+    BuildCodes(CodeLengthLengths, 19, CodeLengthCodes);
+
+    int CodeLengthCount = 19;
+    while (CodeLengthCount > 4 && CodeLengthLengths[CodeLengthOrder[CodeLengthCount - 1]] == 0) CodeLengthCount--;
+
+    uint16_t LiteralCodes[286] = {};
+    uint16_t DistanceCodes[30] = {};
+    BuildCodes(LiteralLengths, 286, LiteralCodes);
+    BuildCodes(DistanceLengths, 30, DistanceCodes);
+
+    Writer.Put(IsFinal ? 1 : 0, 1);
+    Writer.Put(2, 2);
+    Writer.Put(LiteralCount - 257, 5);
+    Writer.Put(DistanceCount - 1, 5);
+    Writer.Put(CodeLengthCount - 4, 4);
+    for (int Index = 0; Index < CodeLengthCount; Index++) Writer.Put(CodeLengthLengths[CodeLengthOrder[Index]], 3);
+
+    static const int RepeatExtraBits[3] = { 2, 3, 7 };
+    for (uint16_t Entry : LengthSymbols)
+    {
+        int Symbol = Entry & 0xFF;
+        Writer.Put(CodeLengthCodes[Symbol], CodeLengthLengths[Symbol]);
+        if (Symbol >= 16) Writer.Put(Entry >> 8, RepeatExtraBits[Symbol - 16]);
+    }
+
+    for (uint32_t Token : Tokens)
+    {
+        int Distance = (int)(Token >> 9);
+        if (Distance == 0)
+        {
+            Writer.Put(LiteralCodes[Token], LiteralLengths[Token]);
+            continue;
+        }
+
+        int Length = (int)(Token & 511);
+        int LengthCode = Tables.LengthCode[Length];
+        Writer.Put(LiteralCodes[257 + LengthCode], LiteralLengths[257 + LengthCode]);
+        Writer.Put(Length - LengthBase[LengthCode], LengthExtra[LengthCode]);
+
+        int DistanceCode = Tables.GetDistanceCode(Distance);
+        Writer.Put(DistanceCodes[DistanceCode], DistanceLengths[DistanceCode]);
+        Writer.Put(Distance - DistanceBase[DistanceCode], DistanceExtra[DistanceCode]);
+    }
+    Writer.Put(LiteralCodes[256], LiteralLengths[256]);
+}
+
+static inline uint32_t HashBytes(uint32_t Value)
+{
+    return (Value * 2654435761u) >> (32 - HashBits);
+}
+
+// Greedy LZ77 with one candidate per hash bucket. Filtered screen content is dominated
+// by long zero and repeat runs, where a single probe already finds the match.
+static void Deflate(const uint8_t *Data, size_t Size, std::vector<uint8_t> &Output)
+{
+    CBitWriter Writer(Output);
+    std::vector<uint32_t> Head((size_t)1 << HashBits, NoPosition);
+    std::vector<uint32_t> Tokens;
+    Tokens.reserve(TokensPerBlock);
+
+    size_t Position = 0;
+    while (Position < Size)
+    {
+        if (Tokens.size() >= TokensPerBlock)
+        {
+            WriteBlock(Writer, Tokens, false);
+            Tokens.clear();
+        }
+
+        if (Position + MinMatch > Size)
+        {
+            Tokens.push_back(MakeLiteral(Data[Position++]));
+            continue;
+        }
+
+        uint32_t Bytes = Load32(Data + Position);
+        uint32_t Hash = HashBytes(Bytes);
+        uint32_t Candidate = Head[Hash];
+        Head[Hash] = (uint32_t)Position;
+
+        if (Candidate == NoPosition || Position - Candidate > WindowSize || Load32(Data + Candidate) != Bytes)
+        {
+            Tokens.push_back(MakeLiteral(Data[Position++]));
+            continue;
+        }
+
+        size_t Limit = Size - Position < (size_t)MaxMatch ? Size - Position : (size_t)MaxMatch;
+        size_t Length = MinMatch;
+        while (Length + 8 <= Limit && Load64(Data + Candidate + Length) == Load64(Data + Position + Length)) Length += 8;
+        while (Length < Limit && Data[Candidate + Length] == Data[Position + Length]) Length++;
+
+        Tokens.push_back(MakeMatch((int)Length, (int)(Position - Candidate)));
+
+        // Short matches seed the table from inside; long ones are runs and need no help
+        if (Length < 32)
+        {
+            for (size_t Inner = Position + 1; Inner < Position + Length && Inner + MinMatch <= Size; Inner++)
+            {
+                Head[HashBytes(Load32(Data + Inner))] = (uint32_t)Inner;
+            }
+        }
+        Position += Length;
+    }
+
+    WriteBlock(Writer, Tokens, true);
+    Writer.Flush();
+}
+
+// ---------------------------------------------------------------------------
+// Encoders
+// ---------------------------------------------------------------------------
+
+static void AppendChunkHeader(std::vector<uint8_t> &Output, const char *Type, uint32_t Length)
+{
+    size_t Start = Output.size();
+    Output.resize(Start + 8);
+    WriteBE32(Output.data() + Start, Length);
+    std::memcpy(Output.data() + Start + 4, Type, 4);
+}
+
+// Appends the CRC over the chunk that starts at Start (its length field)
+static void FinishChunk(std::vector<uint8_t> &Output, size_t Start)
+{
+    uint32_t Crc = Crc32(Output.data() + Start + 4, Output.size() - Start - 4);
+    size_t End = Output.size();
+    Output.resize(End + 4);
+    WriteBE32(Output.data() + End, Crc);
+}
+
+bool EncodePNG(const SImageView &Image, std::vector<uint8_t> &Output)
+{
+    Output.clear();
+    if (!IsEncodable(Image)) return false;
+
+    std::vector<uint8_t> Filtered;
+    FilterImage(Image, Filtered);
+
+    static const uint8_t Signature[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+    Output.reserve(Filtered.size() / 4 + 1024);
+    Output.insert(Output.end(), Signature, Signature + 8);
+
+    size_t Chunk = Output.size();
+    AppendChunkHeader(Output, "IHDR", 13);
+    uint8_t Header[13] = {};
+    WriteBE32(Header, (uint32_t)Image.Width);
+    WriteBE32(Header + 4, (uint32_t)Image.Height);
+    Header[8] = 8;
+    Header[9] = Image.Format == EPixelFormat::BGRA8 ? 2 : 0;  // Truecolour or greyscale
+    Output.insert(Output.end(), Header, Header + 13);
+    FinishChunk(Output, Chunk);
+
+    // One IDAT holding the whole zlib stream; its length is patched in afterwards
+    Chunk = Output.size();
+    AppendChunkHeader(Output, "IDAT", 0);
+    Output.push_back(0x78);
+    Output.push_back(0x01);
+    Deflate(Filtered.data(), Filtered.size(), Output);
+    size_t End = Output.size();
+    Output.resize(End + 4);
+    WriteBE32(Output.data() + End, Adler32(Filtered.data(), Filtered.size()));
+    WriteBE32(Output.data() + Chunk, (uint32_t)(Output.size() - Chunk - 8));
+    FinishChunk(Output, Chunk);
+
+    Chunk = Output.size();
+    AppendChunkHeader(Output, "IEND", 0);
+    FinishChunk(Output, Chunk);
+    return true;
+}
+
+// Pixels as 0xAARRGGBB with alpha forced opaque
+static inline uint32_t LoadOpaquePixel(const uint8_t *Row, int X, bool IsGray)
+{
+    if (IsGray)
+    {
+        uint32_t Value = Row[X];
+        return 0xFF000000u | (Value << 16) | (Value << 8) | Value;
+    }
+    return Load32(Row + (size_t)X * 4) | 0xFF000000u;
+}
+
+// Pixels from X on that equal Pixel, up to End
+static int CountRepeats(const uint8_t *Row, int X, int End, uint32_t Pixel, bool IsGray)
+{
+    int Start = X;
+#ifdef SPYX_SSE2
+    if (!IsGray)
+    {
+        __m128i Alpha = _mm_set1_epi32((int)0xFF000000u);
+        __m128i Target = _mm_set1_epi32((int)Pixel);
+        for (; X + 4 <= End; X += 4)
+        {
+            __m128i Pixels = _mm_or_si128(_mm_loadu_si128((const __m128i *)(Row + (size_t)X * 4)), Alpha);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(Pixels, Target)) != 0xFFFF) break;
+        }
+    }
+#endif
+    while (X < End && LoadOpaquePixel(Row, X, IsGray) == Pixel) X++;
+    return X - Start;
+}
+
+bool EncodeQOI(const SImageView &Image, std::vector<uint8_t> &Output)
+{
+    Output.clear();
+    if (!IsEncodable(Image)) return false;
+
+    const bool IsGray = Image.Format == EPixelFormat::Gray8;
+
+    // Worst case is one 4-byte RGB op per pixel
+    Output.resize(14 + (size_t)Image.Width * Image.Height * 4 + 8);
+    uint8_t *Out = Output.data();
+
+    std::memcpy(Out, "qoif", 4);
+    WriteBE32(Out + 4, (uint32_t)Image.Width);
+    WriteBE32(Out + 8, (uint32_t)Image.Height);
+    Out[12] = 3;
+    Out[13] = 0;
+    Out += 14;
+
+    uint32_t Index[64] = {};
+    uint32_t Previous = 0xFF000000u;
+    int Run = 0;
+
+    for (int Y = 0; Y < Image.Height; Y++)
+    {
+        const uint8_t *Row = Image.Row(Y);
+        int X = 0;
+        while (X < Image.Width)
+        {
+            uint32_t Pixel = LoadOpaquePixel(Row, X, IsGray);
+            if (Pixel == Previous)
+            {
+                int Repeats = CountRepeats(Row, X, Image.Width, Pixel, IsGray);
+                X += Repeats;
+                Run += Repeats;
+                while (Run >= 62)
+                {
+                    *Out++ = 0xC0 | 61;
+                    Run -= 62;
+                }
+                continue;
+            }
+
+            if (Run > 0)
+            {
+                *Out++ = (uint8_t)(0xC0 | (Run - 1));
+                Run = 0;
+            }
+
+            uint8_t Red = (uint8_t)(Pixel >> 16);
+            uint8_t Green = (uint8_t)(Pixel >> 8);
+            uint8_t Blue = (uint8_t)Pixel;
+            int Hash = (Red * 3 + Green * 5 + Blue * 7 + 255 * 11) & 63;
+
+            if (Index[Hash] == Pixel)
+            {
+                *Out++ = (uint8_t)Hash;
+            }
+            else
+            {
+                Index[Hash] = Pixel;
+
+                signed char DeltaRed = (signed char)(Red - (uint8_t)(Previous >> 16));
+                signed char DeltaGreen = (signed char)(Green - (uint8_t)(Previous >> 8));
+                signed char DeltaBlue = (signed char)(Blue - (uint8_t)Previous);
+                signed char RedFromGreen = (signed char)(DeltaRed - DeltaGreen);
+                signed char BlueFromGreen = (signed char)(DeltaBlue - DeltaGreen);
+
+                if (DeltaRed >= -2 && DeltaRed <= 1 && DeltaGreen >= -2 && DeltaGreen <= 1 &&
+                    DeltaBlue >= -2 && DeltaBlue <= 1)
+                {
+                    *Out++ = (uint8_t)(0x40 | ((DeltaRed + 2) << 4) | ((DeltaGreen + 2) << 2) | (DeltaBlue + 2));
+                }
+                else if (DeltaGreen >= -32 && DeltaGreen <= 31 && RedFromGreen >= -8 && RedFromGreen <= 7 &&
+                    BlueFromGreen >= -8 && BlueFromGreen <= 7)
+                {
+                    *Out++ = (uint8_t)(0x80 | (DeltaGreen + 32));
+                    *Out++ = (uint8_t)(((RedFromGreen + 8) << 4) | (BlueFromGreen + 8));
+                }
+                else
+                {
+                    Out[0] = 0xFE;
+                    Out[1] = Red;
+                    Out[2] = Green;
+                    Out[3] = Blue;
+                    Out += 4;
+                }
+            }
+
+            Previous = Pixel;
+            X++;
+        }
+    }
+
+    if (Run > 0) *Out++ = (uint8_t)(0xC0 | (Run - 1));
+
+    static const uint8_t EndMarker[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+    std::memcpy(Out, EndMarker, 8);
+    Out += 8;
+
+    Output.resize((size_t)(Out - Output.data()));
+    return true;
+}
+
+bool EncodeImage(const SImageView &Image, EImageFileFormat Format, std::vector<uint8_t> &Output)
+{
+    switch (Format)
+    {
+        case EImageFileFormat::PNG: return EncodePNG(Image, Output);
+        case EImageFileFormat::QOI: return EncodeQOI(Image, Output);
+    }
+    Output.clear();
+    return false;
+}
@@ -0,0 +1,29 @@
+#ifndef TAPI_IMAGE_ENCODER_H
+#define TAPI_IMAGE_ENCODER_H
+
+#include "Imaging/ImageView.h"
+
+#include <cstdint>
+#include <vector>
+
+enum class EImageFileFormat : int
+{
+    PNG = 0,
+    QOI = 1
+};
+
+// Still-image encoders for BGRA8 and Gray8 views. Both write opaque images: captured
+// alpha is not meaningful (GDI leaves it zero), so BGRA8 is stored as RGB.
+
+// PNG tuned for speed: per-row None/Sub/Up filter chosen by a SIMD cost estimate, then a
+// single-probe LZ77 matcher with dynamic Huffman blocks. Typically within a few percent
+// of zlib level 1 on screen content.
+bool EncodePNG(const SImageView &Image, std::vector<uint8_t> &Output);
+
+// QOI (qoiformat.org), 3 channels. Faster than PNG but larger on gradients. Gray8 input
+// is expanded to RGB.
+bool EncodeQOI(const SImageView &Image, std::vector<uint8_t> &Output);
+
+bool EncodeImage(const SImageView &Image, EImageFileFormat Format, std::vector<uint8_t> &Output);
+
+#endif
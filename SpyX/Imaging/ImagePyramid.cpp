@@ -0,0 +1,241 @@
+#include "ImagePyramid.h"
+#include "Core/Simd.h"
+#include "Imaging/ToneMapper.h"
+
+#include <cstring>
+
+static int ClampIndex(int Index, int Size)
+{
+    return Index < 0 ? 0 : (Index >= Size ? Size - 1 : Index);
+}
+
+static uint8_t ReducePixel(const SImageView &Source, int X, int Y, EPyramidFilter Filter)
+{
+    if (Filter == EPyramidFilter::Box)
+    {
+        const uint8_t *Top = Source.Row(2 * Y) + 2 * X;
+        const uint8_t *Bottom = Source.Row(2 * Y + 1) + 2 * X;
+        return (uint8_t)((Top[0] + Top[1] + Bottom[0] + Bottom[1] + 2) >> 2);
+    }
+
+    static const int Weights[4] = {1, 3, 3, 1};
+    int Sum = 0;
+    for (int Row = 0; Row < 4; Row++)
+    {
+        const uint8_t *Pixels = Source.Row(ClampIndex(2 * Y - 1 + Row, Source.Height));
+        int RowSum = 0;
+        for (int Column = 0; Column < 4; Column++)
+        {
+            RowSum += Weights[Column] * Pixels[ClampIndex(2 * X - 1 + Column, Source.Width)];
+        }
+        Sum += Weights[Row] * RowSum;
+    }
+    return (uint8_t)((Sum + 32) >> 6);
+}
+
+void ReduceGray8Reference(const SImageView &Source, uint8_t *Destination, int DestinationStride, EPyramidFilter Filter)
+{
+    const int Width = Source.Width / 2;
+    const int Height = Source.Height / 2;
+    for (int Y = 0; Y < Height; Y++)
+    {
+        uint8_t *DestinationRow = Destination + (size_t)Y * DestinationStride;
+        for (int X = 0; X < Width; X++) DestinationRow[X] = ReducePixel(Source, X, Y, Filter);
+    }
+}
+
+#ifdef SPYX_SSE2
+
+static void ReduceRowBox(const uint8_t *Top, const uint8_t *Bottom, int SourceWidth, uint8_t *Destination)
+{
+    const __m128i Zero = _mm_setzero_si128();
+    const __m128i Ones = _mm_set1_epi16(1);
+    const __m128i Rounding = _mm_set1_epi32(2);
+
+    const int Width = SourceWidth / 2;
+    int X = 0;
+    for (; 2 * X + 16 <= SourceWidth; X += 8)
+    {
+        __m128i Upper = _mm_loadu_si128((const __m128i *)(Top + 2 * X));
+        __m128i Lower = _mm_loadu_si128((const __m128i *)(Bottom + 2 * X));
+        __m128i Low = _mm_add_epi16(_mm_unpacklo_epi8(Upper, Zero), _mm_unpacklo_epi8(Lower, Zero));
+        __m128i High = _mm_add_epi16(_mm_unpackhi_epi8(Upper, Zero), _mm_unpackhi_epi8(Lower, Zero));
+
+        // Adjacent 16-bit column sums pair up into one 32-bit lane per output pixel
+        __m128i First = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(Low, Ones), Rounding), 2);
+        __m128i Second = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(High, Ones), Rounding), 2);
+        __m128i Packed = _mm_packs_epi32(First, Second);
+        _mm_storel_epi64((__m128i *)(Destination + X), _mm_packus_epi16(Packed, Packed));
+    }
+    for (; X < Width; X++)
+    {
+        Destination[X] = (uint8_t)((Top[2 * X] + Top[2 * X + 1] + Bottom[2 * X] + Bottom[2 * X + 1] + 2) >> 2);
+    }
+}
+
+// Column is the vertical [1 3 3 1] pass of one output row, with one clamped entry on each side
+static void ReduceRowGaussian(const uint8_t *const Rows[4], int SourceWidth, int16_t *Column, uint8_t *Destination)
+{
+    const __m128i Zero = _mm_setzero_si128();
+
+    int Index = 0;
+    for (; Index + 8 <= SourceWidth; Index += 8)
+    {
+        __m128i Outer = _mm_add_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(Rows[0] + Index)), Zero),
+            _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(Rows[3] + Index)), Zero));
+        __m128i Inner = _mm_add_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(Rows[1] + Index)), Zero),
+            _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(Rows[2] + Index)), Zero));
+        __m128i Sum = _mm_add_epi16(Outer, _mm_add_epi16(Inner, _mm_add_epi16(Inner, Inner)));
+        _mm_storeu_si128((__m128i *)(Column + Index), Sum);
+    }
+    for (; Index < SourceWidth; Index++)
+    {
+        Column[Index] = (int16_t)(Rows[0][Index] + Rows[3][Index] + 3 * (Rows[1][Index] + Rows[2][Index]));
+    }
+    Column[-1] = Column[0];
+    Column[SourceWidth] = Column[SourceWidth - 1];
+
+    // Output x weighs columns 2x - 1 .. 2x + 2; each madd lane covers one output pixel
+    const __m128i CentreWeights = _mm_set1_epi16(3);
+    const __m128i LeftWeights = _mm_set1_epi32(1);
+    const __m128i RightWeights = _mm_set1_epi32(1 << 16);
+    const __m128i Rounding = _mm_set1_epi32(32);
+
+    const int Width = SourceWidth / 2;
+    int X = 0;
+    for (; 2 * X + 16 <= SourceWidth; X += 8)
+    {
+        __m128i Sums[2];
+        for (int Half = 0; Half < 2; Half++)
+        {
+            const int16_t *Centre = Column + 2 * X + 8 * Half;
+            __m128i Sum = _mm_madd_epi16(_mm_loadu_si128((const __m128i *)Centre), CentreWeights);
+            Sum = _mm_add_epi32(Sum, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(Centre - 1)), LeftWeights));
+            Sum = _mm_add_epi32(Sum, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(Centre + 1)), RightWeights));
+            Sums[Half] = _mm_srli_epi32(_mm_add_epi32(Sum, Rounding), 6);
+        }
+        __m128i Packed = _mm_packs_epi32(Sums[0], Sums[1]);
+        _mm_storel_epi64((__m128i *)(Destination + X), _mm_packus_epi16(Packed, Packed));
+    }
+    for (; X < Width; X++)
+    {
+        int Sum = Column[2 * X - 1] + 3 * (Column[2 * X] + Column[2 * X + 1]) + Column[2 * X + 2];
+        Destination[X] = (uint8_t)((Sum + 32) >> 6);
+    }
+}
+
+void ReduceGray8(const SImageView &Source, uint8_t *Destination, int DestinationStride, EPyramidFilter Filter)
+{
+    const int Height = Source.Height / 2;
+    if (Source.Width < 2 || Height <= 0) return;
+
+    std::vector<int16_t> Column;
+    if (Filter == EPyramidFilter::Gaussian) Column.resize((size_t)Source.Width + 2);
+
+    for (int Y = 0; Y < Height; Y++)
+    {
+        uint8_t *DestinationRow = Destination + (size_t)Y * DestinationStride;
+        if (Filter == EPyramidFilter::Box)
+        {
+            ReduceRowBox(Source.Row(2 * Y), Source.Row(2 * Y + 1), Source.Width, DestinationRow);
+            continue;
+        }
+
+        const uint8_t *Rows[4];
+        for (int Row = 0; Row < 4; Row++) Rows[Row] = Source.Row(ClampIndex(2 * Y - 1 + Row, Source.Height));
+        ReduceRowGaussian(Rows, Source.Width, Column.data() + 1, DestinationRow);
+    }
+}
+
+#else
+
+void ReduceGray8(const SImageView &Source, uint8_t *Destination, int DestinationStride, EPyramidFilter Filter)
+{
+    ReduceGray8Reference(Source, Destination, DestinationStride, Filter);
+}
+
+#endif
+
+bool CImagePyramid::Build(const SImageView &Frame, int Levels, EPyramidFilter Filter)
+{
+    MLevelCount = 0;
+    if (!Frame.IsValid() || (Frame.Format != EPixelFormat::BGRA8 && Frame.Format != EPixelFormat::Gray8)) return false;
+    if (Levels < 0) Levels = 0;
+    if (Levels > MaxPyramidLevels) Levels = MaxPyramidLevels;
+
+    MFilter = Filter;
+    if (MLevels.size() < (size_t)Levels + 1) MLevels.resize((size_t)Levels + 1);
+
+    SLevel &Base = MLevels[0];
+    Base.Width = Frame.Width;
+    Base.Height = Frame.Height;
+    Base.Stride = (Frame.Width + 31) & ~15;
+    Base.Pixels.resize((size_t)Base.Stride * Base.Height);
+    if (Frame.Format == EPixelFormat::BGRA8)
+    {
+        ConvertBGRA8ToGray8(Frame, Base.Pixels.data(), Base.Stride);
+    }
+    else
+    {
+        for (int Y = 0; Y < Frame.Height; Y++) std::memcpy(&Base.Pixels[(size_t)Y * Base.Stride], Frame.Row(Y), Frame.Width);
+    }
+    MLevelCount = 1;
+
+    for (int Level = 1; Level <= Levels; Level++)
+    {
+        const SImageView Source = GetLevel(Level - 1);
+        if (Source.Width < 2 || Source.Height < 2) break;
+
+        SLevel &Reduced = MLevels[Level];
+        Reduced.Width = Source.Width / 2;
+        Reduced.Height = Source.Height / 2;
+        Reduced.Stride = (Reduced.Width + 31) & ~15;
+        Reduced.Pixels.resize((size_t)Reduced.Stride * Reduced.Height);
+        ReduceGray8(Source, Reduced.Pixels.data(), Reduced.Stride, Filter);
+        MLevelCount++;
+    }
+    return true;
+}
+
+void CImagePyramid::Clear()
+{
+    MLevels.clear();
+    MLevelCount = 0;
+}
+
+SImageView CImagePyramid::GetLevel(int Level) const
+{
+    SImageView View;
+    if (Level < 0 || Level >= MLevelCount) return View;
+
+    const SLevel &Source = MLevels[Level];
+    View.Data = Source.Pixels.data();
+    View.Width = Source.Width;
+    View.Height = Source.Height;
+    View.Stride = Source.Stride;
+    View.Format = EPixelFormat::Gray8;
+    return View;
+}
+
+const CImagePyramid *CFramePyramidCache::Get(const SImageView &Frame, const SPyramidFrameKey &Key, int Levels,
+    EPyramidFilter Filter)
+{
+    const bool IsSameFrame = MLevels >= 0 && MKey.Source == Key.Source && MKey.Sequence == Key.Sequence &&
+        MKey.Generation == Key.Generation && MKey.Width == Key.Width && MKey.Height == Key.Height &&
+        MKey.Format == Key.Format;
+    if (IsSameFrame && MPyramid.GetFilter() == Filter && MLevels >= Levels) return &MPyramid;
+
+    MLevels = -1;
+    MBuildCount++;
+    if (!MPyramid.Build(Frame, Levels, Filter)) return nullptr;
+    MKey = Key;
+    MLevels = Levels;
+    return &MPyramid;
+}
+
+void CFramePyramidCache::Clear()
+{
+    MPyramid.Clear();
+    MKey = SPyramidFrameKey();
+    MLevels = -1;
+}
@@ -0,0 +1,83 @@
+#ifndef TAPI_IMAGE_PYRAMID_H
+#define TAPI_IMAGE_PYRAMID_H
+
+#include "Imaging/ImageView.h"
+
+#include <cstdint>
+#include <vector>
+
+// Luma pyramid of a frame. Level 0 is the frame as Gray8 and each further level halves both
+// sizes, rounding down. Level rows have at least 16 readable bytes past their width, so
+// 16-byte loads at the end of a row stay inside the buffer.
+
+enum class EPyramidFilter : int
+{
+    Box = 0,        // Mean of each 2x2 block
+    Gaussian = 1    // Separable binomial [1 3 3 1] / 8 over 4x4, smoother and less aliased
+};
+
+static const int MaxPyramidLevels = 8;
+
+// Halves a Gray8 image into (Width / 2) x (Height / 2) pixels. The filter clamps at the edges
+// and reads nothing past Source.Width, so any stride works.
+void ReduceGray8(const SImageView &Source, uint8_t *Destination, int DestinationStride, EPyramidFilter Filter);
+void ReduceGray8Reference(const SImageView &Source, uint8_t *Destination, int DestinationStride, EPyramidFilter Filter);
+
+class CImagePyramid
+{
+public:
+    // Converts Frame (BGRA8 or Gray8) and reduces it up to Levels times, stopping before a
+    // level would be empty. Buffers are reused between builds.
+    bool Build(const SImageView &Frame, int Levels, EPyramidFilter Filter);
+    void Clear();
+
+    int GetLevelCount() const { return MLevelCount; }
+    SImageView GetLevel(int Level) const;
+    EPyramidFilter GetFilter() const { return MFilter; }
+
+private:
+    struct SLevel
+    {
+        std::vector<uint8_t> Pixels;
+        int Width = 0;
+        int Height = 0;
+        int Stride = 0;
+    };
+
+    std::vector<SLevel> MLevels;
+    int MLevelCount = 0;
+    EPyramidFilter MFilter = EPyramidFilter::Box;
+};
+
+// Identity of the frame a cached pyramid was built from. Source numbers the frame sources,
+// since a new capture or replay restarts sequences and generations.
+struct SPyramidFrameKey
+{
+    uint64_t Source = 0;
+    uint64_t Sequence = 0;
+    uint32_t Generation = 0;
+    int Width = 0;
+    int Height = 0;
+    EPixelFormat Format = EPixelFormat::BGRA8;
+};
+
+// Pyramid of the latest searched frame, shared by searches on that frame
+class CFramePyramidCache
+{
+public:
+    // Pyramid of Frame with at least Levels levels and Filter, rebuilt unless the last build was
+    // of the same frame. A pyramid with more levels serves requests for fewer, since searches
+    // start no coarser than asked. Null if the frame cannot be converted.
+    const CImagePyramid *Get(const SImageView &Frame, const SPyramidFrameKey &Key, int Levels, EPyramidFilter Filter);
+    void Clear();
+
+    uint64_t GetBuildCount() const { return MBuildCount; }
+
+private:
+    CImagePyramid MPyramid;
+    SPyramidFrameKey MKey;
+    int MLevels = -1;               // -1 while nothing is cached
+    uint64_t MBuildCount = 0;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef TAPI_IMAGE_VIEW_H
+#define TAPI_IMAGE_VIEW_H
+
+#include <cstddef>
+#include <cstdint>
+
+enum class EPixelFormat : int
+{
+    BGRA8 = 0,
+    Gray8 = 1,
+    RGBA16F = 2
+};
+
+inline int GetBytesPerPixel(EPixelFormat Format)
+{
+    switch (Format)
+    {
+        case EPixelFormat::BGRA8: return 4;
+        case EPixelFormat::Gray8: return 1;
+        case EPixelFormat::RGBA16F: return 8;
+    }
+    return 0;
+}
+
+// Non-owning view of a pixel buffer. Stride is in bytes.
+struct SImageView
+{
+    const uint8_t *Data = nullptr;
+    int Width = 0;
+    int Height = 0;
+    int Stride = 0;
+    EPixelFormat Format = EPixelFormat::BGRA8;
+
+    const uint8_t *Row(int Y) const { return Data + (size_t)Y * (size_t)Stride; }
+    bool IsValid() const { return Data && Width > 0 && Height > 0 && Stride >= Width * GetBytesPerPixel(Format); }
+};
+
+// Pixel rectangle with exclusive Right and Bottom
+struct SPixelRect
+{
+    int Left = 0;
+    int Top = 0;
+    int Right = 0;
+    int Bottom = 0;
+
+    bool IsEmpty() const { return Left >= Right || Top >= Bottom; }
+    int GetWidth() const { return Right - Left; }
+    int GetHeight() const { return Bottom - Top; }
+};
+
+// Part of the rectangle at (X, Y) of Width x Height inside a FrameWidth x FrameHeight
+// frame. A width or height of 0 or less reaches the frame edge. Edges are summed in 64
+// bits, so caller rectangles that reach past INT_MAX clip instead of wrapping.
+inline SPixelRect ClipToFrame(int X, int Y, int Width, int Height, int FrameWidth, int FrameHeight)
+{
+    const int64_t Right = Width > 0 ? (int64_t)X + Width : FrameWidth;
+    const int64_t Bottom = Height > 0 ? (int64_t)Y + Height : FrameHeight;
+
+    SPixelRect Rect;
+    Rect.Left = X > 0 ? X : 0;
+    Rect.Top = Y > 0 ? Y : 0;
+    Rect.Right = (int)(Right < FrameWidth ? Right : FrameWidth);
+    Rect.Bottom = (int)(Bottom < FrameHeight ? Bottom : FrameHeight);
+    return Rect;
+}
+
+#endif
@@ -0,0 +1,745 @@
+#include "JpegEncoder.h"
+#include "Core/Simd.h"
+
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// ---------------------------------------------------------------------------
+// Tables (ITU T.81 Annex K)
+// ---------------------------------------------------------------------------
+
+static const uint8_t ZigzagToNatural[64] = {
+    0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63
+};
+
+static const uint8_t BaseQuantLuma[64] = {
+    16, 11, 10, 16, 24, 40, 51, 61,
+    12, 12, 14, 19, 26, 58, 60, 55,
+    14, 13, 16, 24, 40, 57, 69, 56,
+    14, 17, 22, 29, 51, 87, 80, 62,
+    18, 22, 37, 56, 68, 109, 103, 77,
+    24, 35, 55, 64, 81, 104, 113, 92,
+    49, 64, 78, 87, 103, 121, 120, 101,
+    72, 92, 95, 98, 112, 100, 103, 99
+};
+
+static const uint8_t BaseQuantChroma[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99,
+    18, 21, 26, 66, 99, 99, 99, 99,
+    24, 26, 56, 99, 99, 99, 99, 99,
+    47, 66, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99
+};
+
+static const uint8_t DcLumaBits[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+static const uint8_t DcChromaBits[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+static const uint8_t DcValues[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+static const uint8_t AcLumaBits[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7D };
+static const uint8_t AcLumaValues[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xA1, 0x08, 0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7,
+    0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5,
+    0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2,
+    0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+    0xF9, 0xFA
+};
+
+static const uint8_t AcChromaBits[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+static const uint8_t AcChromaValues[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0,
+    0x15, 0x62, 0x72, 0xD1, 0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25, 0xF1, 0x17, 0x18, 0x19, 0x1A, 0x26,
+    0x27, 0x28, 0x29, 0x2A, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5,
+    0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3,
+    0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA,
+    0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+    0xF9, 0xFA
+};
+
+// AAN output scaling per frequency: cos(k * pi / 16) * sqrt(2), 1 for k = 0
+static const float AanScale[8] = { 1.0f, 1.387039845f, 1.306562965f, 1.175875602f, 1.0f, 0.785694958f,
+    0.541196100f, 0.275899379f };
+
+struct SHuffmanTable
+{
+    uint16_t Codes[256];
+    uint8_t Sizes[256];
+
+    SHuffmanTable(const uint8_t *Bits, const uint8_t *Values)
+    {
+        std::memset(Codes, 0, sizeof(Codes));
+        std::memset(Sizes, 0, sizeof(Sizes));
+
+        int Code = 0;
+        int Index = 0;
+        for (int Length = 1; Length <= 16; Length++)
+        {
+            for (int Count = 0; Count < Bits[Length - 1]; Count++)
+            {
+                Codes[Values[Index]] = (uint16_t)Code++;
+                Sizes[Values[Index]] = (uint8_t)Length;
+                Index++;
+            }
+            Code <<= 1;
+        }
+    }
+};
+
+static const SHuffmanTable DcLumaTable(DcLumaBits, DcValues);
+static const SHuffmanTable DcChromaTable(DcChromaBits, DcValues);
+static const SHuffmanTable AcLumaTable(AcLumaBits, AcLumaValues);
+static const SHuffmanTable AcChromaTable(AcChromaBits, AcChromaValues);
+
+static const int MaxDownscale = 8;
+
+// ---------------------------------------------------------------------------
+// Colour conversion and sample fetch
+// ---------------------------------------------------------------------------
+
+// JFIF YCbCr with the -128 level shift applied to Y (Cb and Cr are already centred)
+static inline void ToYCbCr(float Blue, float Green, float Red, float &OutY, float &OutCb, float &OutCr)
+{
+    OutY = 0.299f * Red + 0.587f * Green + 0.114f * Blue - 128.0f;
+    OutCb = -0.168736f * Red - 0.331264f * Green + 0.5f * Blue;
+    OutCr = 0.5f * Red - 0.418688f * Green - 0.081312f * Blue;
+}
+
+// One scaled row into the planes, padded to PaddedWidth by repeating the last sample
+static void FetchRow(const SImageView &Image, int Factor, int Y, int Width, int PaddedWidth, float *OutY,
+    float *OutCb, float *OutCr)
+{
+    const bool IsGray = Image.Format == EPixelFormat::Gray8;
+    int X = 0;
+
+    if (Factor == 1)
+    {
+        const uint8_t *Row = Image.Row(Y);
+        if (IsGray)
+        {
+            for (; X < Width; X++) OutY[X] = (float)Row[X] - 128.0f;
+        }
+        else
+        {
+#ifdef SPYX_SSE2
+            const __m128i Mask = _mm_set1_epi32(0xFF);
+            const __m128 Offset = _mm_set1_ps(128.0f);
+            for (; X + 4 <= Width; X += 4)
+            {
+                __m128i Pixels = _mm_loadu_si128((const __m128i *)(Row + (size_t)X * 4));
+                __m128 Blue = _mm_cvtepi32_ps(_mm_and_si128(Pixels, Mask));
+                __m128 Green = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(Pixels, 8), Mask));
+                __m128 Red = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(Pixels, 16), Mask));
+
+                __m128 Luma = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Red, _mm_set1_ps(0.299f)),
+                    _mm_mul_ps(Green, _mm_set1_ps(0.587f))), _mm_mul_ps(Blue, _mm_set1_ps(0.114f)));
+                __m128 BlueDifference = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Red, _mm_set1_ps(-0.168736f)),
+                    _mm_mul_ps(Green, _mm_set1_ps(-0.331264f))), _mm_mul_ps(Blue, _mm_set1_ps(0.5f)));
+                __m128 RedDifference = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Red, _mm_set1_ps(0.5f)),
+                    _mm_mul_ps(Green, _mm_set1_ps(-0.418688f))), _mm_mul_ps(Blue, _mm_set1_ps(-0.081312f)));
+
+                _mm_storeu_ps(OutY + X, _mm_sub_ps(Luma, Offset));
+                _mm_storeu_ps(OutCb + X, BlueDifference);
+                _mm_storeu_ps(OutCr + X, RedDifference);
+            }
+#endif
+            for (; X < Width; X++)
+            {
+                const uint8_t *Pixel = Row + (size_t)X * 4;
+                ToYCbCr(Pixel[0], Pixel[1], Pixel[2], OutY[X], OutCb[X], OutCr[X]);
+            }
+        }
+    }
+    else
+    {
+        // Box average of Factor x Factor source pixels, read straight from the frame
+        const float Scale = 1.0f / (float)(Factor * Factor);
+        const int BytesPerPixel = IsGray ? 1 : 4;
+        for (; X < Width; X++)
+        {
+            int Sums[3] = {};
+            for (int Row = 0; Row < Factor; Row++)
+            {
+                const uint8_t *Source = Image.Row(Y * Factor + Row) + (size_t)X * Factor * BytesPerPixel;
+                for (int Column = 0; Column < Factor; Column++)
+                {
+                    Sums[0] += Source[0];
+                    if (!IsGray)
+                    {
+                        Sums[1] += Source[1];
+                        Sums[2] += Source[2];
+                    }
+                    Source += BytesPerPixel;
+                }
+            }
+
+            if (IsGray)
+            {
+                OutY[X] = (float)Sums[0] * Scale - 128.0f;
+            }
+            else
+            {
+                ToYCbCr(Sums[0] * Scale, Sums[1] * Scale, Sums[2] * Scale, OutY[X], OutCb[X], OutCr[X]);
+            }
+        }
+    }
+
+    for (; X < PaddedWidth; X++)
+    {
+        OutY[X] = OutY[Width - 1];
+        if (!IsGray)
+        {
+            OutCb[X] = OutCb[Width - 1];
+            OutCr[X] = OutCr[Width - 1];
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Forward DCT (AAN, float) and quantization
+// ---------------------------------------------------------------------------
+
+#ifdef SPYX_SSE2
+struct SFloat4
+{
+    __m128 Value;
+
+    SFloat4() = default;
+    SFloat4(__m128 Other) : Value(Other) {}
+    SFloat4(float Scalar) : Value(_mm_set1_ps(Scalar)) {}
+
+    SFloat4 operator+(SFloat4 Other) const { return _mm_add_ps(Value, Other.Value); }
+    SFloat4 operator-(SFloat4 Other) const { return _mm_sub_ps(Value, Other.Value); }
+    SFloat4 operator*(SFloat4 Other) const { return _mm_mul_ps(Value, Other.Value); }
+};
+#endif
+
+// 1D AAN butterfly over eight samples; outputs still carry the AanScale factors
+template <typename TValue>
+static inline void ForwardDCT1D(TValue *Data)
+{
+    TValue Tmp0 = Data[0] + Data[7];
+    TValue Tmp7 = Data[0] - Data[7];
+    TValue Tmp1 = Data[1] + Data[6];
+    TValue Tmp6 = Data[1] - Data[6];
+    TValue Tmp2 = Data[2] + Data[5];
+    TValue Tmp5 = Data[2] - Data[5];
+    TValue Tmp3 = Data[3] + Data[4];
+    TValue Tmp4 = Data[3] - Data[4];
+
+    // Even part
+    TValue Tmp10 = Tmp0 + Tmp3;
+    TValue Tmp13 = Tmp0 - Tmp3;
+    TValue Tmp11 = Tmp1 + Tmp2;
+    TValue Tmp12 = Tmp1 - Tmp2;
+
+    Data[0] = Tmp10 + Tmp11;
+    Data[4] = Tmp10 - Tmp11;
+
+    TValue Z1 = (Tmp12 + Tmp13) * TValue(0.707106781f);
+    Data[2] = Tmp13 + Z1;
+    Data[6] = Tmp13 - Z1;
+
+    // Odd part
+    Tmp10 = Tmp4 + Tmp5;
+    Tmp11 = Tmp5 + Tmp6;
+    Tmp12 = Tmp6 + Tmp7;
+
+    TValue Z5 = (Tmp10 - Tmp12) * TValue(0.382683433f);
+    TValue Z2 = Tmp10 * TValue(0.541196100f) + Z5;
+    TValue Z4 = Tmp12 * TValue(1.306562965f) + Z5;
+    TValue Z3 = Tmp11 * TValue(0.707106781f);
+
+    TValue Z11 = Tmp7 + Z3;
+    TValue Z13 = Tmp7 - Z3;
+
+    Data[5] = Z13 + Z2;
+    Data[3] = Z13 - Z2;
+    Data[1] = Z11 + Z4;
+    Data[7] = Z11 - Z4;
+}
+
+// Block is row-major; Divisors are reciprocals in natural order
+static void TransformAndQuantize(float *Block, const float *Divisors, int16_t *OutCoefficients)
+{
+#ifdef SPYX_SSE2
+    // Column pass on four columns at a time, each vector holding one row of a half block
+    SFloat4 Rows[2][8];
+    for (int Half = 0; Half < 2; Half++)
+    {
+        for (int Row = 0; Row < 8; Row++) Rows[Half][Row] = _mm_loadu_ps(Block + Row * 8 + Half * 4);
+        ForwardDCT1D(Rows[Half]);
+    }
+
+    // Transpose the four 4x4 quadrants, then the row pass becomes another column pass
+    SFloat4 Columns[2][8];
+    for (int Half = 0; Half < 2; Half++)
+    {
+        for (int Quadrant = 0; Quadrant < 2; Quadrant++)
+        {
+            __m128 A = Rows[Quadrant][Half * 4 + 0].Value;
+            __m128 B = Rows[Quadrant][Half * 4 + 1].Value;
+            __m128 C = Rows[Quadrant][Half * 4 + 2].Value;
+            __m128 D = Rows[Quadrant][Half * 4 + 3].Value;
+            _MM_TRANSPOSE4_PS(A, B, C, D);
+            Columns[Half][Quadrant * 4 + 0] = A;
+            Columns[Half][Quadrant * 4 + 1] = B;
+            Columns[Half][Quadrant * 4 + 2] = C;
+            Columns[Half][Quadrant * 4 + 3] = D;
+        }
+        ForwardDCT1D(Columns[Half]);
+    }
+
+    // Columns[Half][U] holds frequency U along rows for vertical frequencies Half*4..+3;
+    // transpose back while quantizing into natural order
+    for (int Half = 0; Half < 2; Half++)
+    {
+        for (int Quadrant = 0; Quadrant < 2; Quadrant++)
+        {
+            __m128 A = Columns[Half][Quadrant * 4 + 0].Value;
+            __m128 B = Columns[Half][Quadrant * 4 + 1].Value;
+            __m128 C = Columns[Half][Quadrant * 4 + 2].Value;
+            __m128 D = Columns[Half][Quadrant * 4 + 3].Value;
+            _MM_TRANSPOSE4_PS(A, B, C, D);
+            __m128 Values[4] = { A, B, C, D };
+            for (int Row = 0; Row < 4; Row++)
+            {
+                int Offset = (Half * 4 + Row) * 8 + Quadrant * 4;
+                __m128 Scaled = _mm_mul_ps(Values[Row], _mm_loadu_ps(Divisors + Offset));
+                __m128i Rounded = _mm_cvtps_epi32(Scaled);
+                _mm_storel_epi64((__m128i *)(OutCoefficients + Offset), _mm_packs_epi32(Rounded, Rounded));
+            }
+        }
+    }
+#else
+    for (int Row = 0; Row < 8; Row++) ForwardDCT1D(Block + Row * 8);
+    for (int Column = 0; Column < 8; Column++)
+    {
+        float Samples[8];
+        for (int Row = 0; Row < 8; Row++) Samples[Row] = Block[Row * 8 + Column];
+        ForwardDCT1D(Samples);
+        for (int Row = 0; Row < 8; Row++) Block[Row * 8 + Column] = Samples[Row];
+    }
+    for (int Index = 0; Index < 64; Index++)
+    {
+        float Scaled = Block[Index] * Divisors[Index];
+        OutCoefficients[Index] = (int16_t)(Scaled < 0.0f ? Scaled - 0.5f : Scaled + 0.5f);
+    }
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Entropy coding
+// ---------------------------------------------------------------------------
+
+class CEntropyWriter
+{
+public:
+    explicit CEntropyWriter(std::vector<uint8_t> &Output) : MOutput(Output)
+    {
+        MOutput.resize(MOutput.capacity() > 4096 ? MOutput.capacity() : 4096);
+    }
+
+    // Room for one worst-case block, all bytes stuffed
+    void Reserve()
+    {
+        if (MOutput.size() - MSize < 1024) MOutput.resize(MOutput.size() * 2);
+    }
+
+    void Put(uint32_t Bits, int Count)
+    {
+        MBuffer = (MBuffer << Count) | Bits;
+        MCount += Count;
+        if (MCount < 32) return;
+
+        // Four bytes at once unless one of them needs a stuffed zero after it
+        MCount -= 32;
+        uint32_t Word = (uint32_t)(MBuffer >> MCount);
+        uint8_t *Out = MOutput.data() + MSize;
+        uint32_t Inverted = ~Word;
+        if (((Inverted - 0x01010101u) & ~Inverted & 0x80808080u) == 0)
+        {
+            Out[0] = (uint8_t)(Word >> 24);
+            Out[1] = (uint8_t)(Word >> 16);
+            Out[2] = (uint8_t)(Word >> 8);
+            Out[3] = (uint8_t)Word;
+            MSize += 4;
+            return;
+        }
+        for (int Shift = 24; Shift >= 0; Shift -= 8) PutByte((uint8_t)(Word >> Shift));
+    }
+
+    // Pads the last byte with one bits, as segments must end byte aligned, and trims the output
+    void Finish()
+    {
+        if (MCount % 8 != 0) Put((1u << (8 - MCount % 8)) - 1, 8 - MCount % 8);
+        while (MCount >= 8)
+        {
+            MCount -= 8;
+            PutByte((uint8_t)(MBuffer >> MCount));
+        }
+        MOutput.resize(MSize);
+    }
+
+private:
+    void PutByte(uint8_t Byte)
+    {
+        MOutput[MSize++] = Byte;
+        if (Byte == 0xFF) MOutput[MSize++] = 0x00;
+    }
+
+    std::vector<uint8_t> &MOutput;
+    size_t MSize = 0;
+    uint64_t MBuffer = 0;
+    int MCount = 0;
+};
+
+// Magnitude category and the value bits that follow the Huffman symbol
+static inline int GetCategory(int Value, uint32_t &OutBits)
+{
+    int Magnitude = Value < 0 ? -Value : Value;
+    int Category = 0;
+    while (Magnitude >> Category) Category++;
+    OutBits = (uint32_t)(Value < 0 ? Value - 1 : Value) & ((1u << Category) - 1);
+    return Category;
+}
+
+static inline int CountTrailingZeros(uint64_t Value)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long Index;
+    _BitScanForward64(&Index, Value);
+    return (int)Index;
+#elif defined(_MSC_VER)
+    unsigned long Index;
+    if (_BitScanForward(&Index, (unsigned long)Value)) return (int)Index;
+    _BitScanForward(&Index, (unsigned long)(Value >> 32));
+    return (int)Index + 32;
+#else
+    return __builtin_ctzll(Value);
+#endif
+}
+
+static void EncodeBlock(CEntropyWriter &Writer, const int16_t *Coefficients, int &PreviousDC,
+    const SHuffmanTable &DcTable, const SHuffmanTable &AcTable)
+{
+    alignas(16) int16_t Zigzag[64];
+    for (int Index = 0; Index < 64; Index++) Zigzag[Index] = Coefficients[ZigzagToNatural[Index]];
+
+    // Bit per non-zero AC coefficient, so zero runs are skipped instead of scanned
+    uint64_t NonZero = 0;
+#ifdef SPYX_SSE2
+    const __m128i Zero = _mm_setzero_si128();
+    for (int Index = 0; Index < 64; Index += 16)
+    {
+        __m128i Low = _mm_cmpeq_epi16(_mm_load_si128((const __m128i *)(Zigzag + Index)), Zero);
+        __m128i High = _mm_cmpeq_epi16(_mm_load_si128((const __m128i *)(Zigzag + Index + 8)), Zero);
+        uint32_t Zeros = (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(Low, High));
+        NonZero |= (uint64_t)(~Zeros & 0xFFFFu) << Index;
+    }
+#else
+    for (int Index = 0; Index < 64; Index++)
+    {
+        if (Zigzag[Index] != 0) NonZero |= 1ull << Index;
+    }
+#endif
+    NonZero &= ~1ull;
+
+    uint32_t Bits;
+    int Category = GetCategory(Zigzag[0] - PreviousDC, Bits);
+    PreviousDC = Zigzag[0];
+    Writer.Put(DcTable.Codes[Category], DcTable.Sizes[Category]);
+    if (Category > 0) Writer.Put(Bits, Category);
+
+    int Previous = 0;
+    while (NonZero)
+    {
+        int Index = CountTrailingZeros(NonZero);
+        NonZero &= NonZero - 1;
+
+        int Run = Index - Previous - 1;
+        Previous = Index;
+        while (Run > 15)
+        {
+            Writer.Put(AcTable.Codes[0xF0], AcTable.Sizes[0xF0]);
+            Run -= 16;
+        }
+
+        Category = GetCategory(Zigzag[Index], Bits);
+        int Symbol = (Run << 4) | Category;
+        Writer.Put(AcTable.Codes[Symbol], AcTable.Sizes[Symbol]);
+        Writer.Put(Bits, Category);
+    }
+    if (Previous < 63) Writer.Put(AcTable.Codes[0x00], AcTable.Sizes[0x00]);
+}
+
+// ---------------------------------------------------------------------------
+// Encoder
+// ---------------------------------------------------------------------------
+
+static void AppendMarker(std::vector<uint8_t> &Output, uint8_t Marker, int Length)
+{
+    Output.push_back(0xFF);
+    Output.push_back(Marker);
+    if (Length >= 0)
+    {
+        Output.push_back((uint8_t)((Length + 2) >> 8));
+        Output.push_back((uint8_t)(Length + 2));
+    }
+}
+
+static void AppendHuffmanTable(std::vector<uint8_t> &Output, uint8_t ClassAndId, const uint8_t *Bits,
+    const uint8_t *Values)
+{
+    int Count = 0;
+    for (int Length = 0; Length < 16; Length++) Count += Bits[Length];
+
+    Output.push_back(ClassAndId);
+    Output.insert(Output.end(), Bits, Bits + 16);
+    Output.insert(Output.end(), Values, Values + Count);
+}
+
+CJpegEncoder::CJpegEncoder(const SJpegSettings &Settings)
+{
+    Configure(Settings);
+}
+
+void CJpegEncoder::Configure(const SJpegSettings &Settings)
+{
+    MSettings = Settings;
+    if (MSettings.Quality < 1) MSettings.Quality = 1;
+    if (MSettings.Quality > 100) MSettings.Quality = 100;
+    if (MSettings.Downscale < 1) MSettings.Downscale = 1;
+    if (MSettings.Downscale > MaxDownscale) MSettings.Downscale = MaxDownscale;
+    if (MSettings.RestartRows < 0) MSettings.RestartRows = 0;
+
+    if (!MPool || MPoolThreads != MSettings.ThreadCount)
+    {
+        MPool.reset(new CThreadPool(MSettings.ThreadCount));
+        MPoolThreads = MSettings.ThreadCount;
+    }
+
+    // libjpeg quality scaling
+    int Scale = MSettings.Quality < 50 ? 5000 / MSettings.Quality : 200 - MSettings.Quality * 2;
+    for (int Index = 0; Index < 64; Index++)
+    {
+        int Natural = ZigzagToNatural[Index];
+        int Luma = (BaseQuantLuma[Natural] * Scale + 50) / 100;
+        int Chroma = (BaseQuantChroma[Natural] * Scale + 50) / 100;
+        MQuantLuma[Index] = (uint8_t)(Luma < 1 ? 1 : (Luma > 255 ? 255 : Luma));
+        MQuantChroma[Index] = (uint8_t)(Chroma < 1 ? 1 : (Chroma > 255 ? 255 : Chroma));
+
+        float Aan = AanScale[Natural / 8] * AanScale[Natural % 8] * 8.0f;
+        MDivisorsLuma[Natural] = 1.0f / (MQuantLuma[Index] * Aan);
+        MDivisorsChroma[Natural] = 1.0f / (MQuantChroma[Index] * Aan);
+    }
+}
+
+void CJpegEncoder::EncodeSegment(const SImageView &Image, int FirstRow, int RowCount,
+    std::vector<uint8_t> &Output) const
+{
+    CEntropyWriter Writer(Output);
+
+    const int Factor = MSettings.Downscale;
+    const int PaddedWidth = MMcusX * MMcuSize;
+    const bool Subsampled = !MIsGray && MMcuSize == 16;
+
+    // MCU-row planes; chroma stays full resolution until the block gather
+    std::vector<float> Planes((size_t)PaddedWidth * MMcuSize * (MIsGray ? 1 : 3));
+    float *PlaneY = Planes.data();
+    float *PlaneCb = MIsGray ? nullptr : PlaneY + (size_t)PaddedWidth * MMcuSize;
+    float *PlaneCr = MIsGray ? nullptr : PlaneCb + (size_t)PaddedWidth * MMcuSize;
+
+    alignas(16) float Block[64];
+    alignas(16) int16_t Coefficients[64];
+    int PreviousDC[3] = {};
+
+    auto GatherBlock = [&](const float *Plane, int X0, int Y0) {
+        for (int Row = 0; Row < 8; Row++)
+        {
+            std::memcpy(Block + Row * 8, Plane + (size_t)(Y0 + Row) * PaddedWidth + X0, 8 * sizeof(float));
+        }
+    };
+
+    // 2x2 average of a 16x16 MCU area
+    auto GatherSubsampled = [&](const float *Plane, int X0) {
+        for (int Row = 0; Row < 8; Row++)
+        {
+            const float *Top = Plane + (size_t)(Row * 2) * PaddedWidth + X0;
+            const float *Bottom = Top + PaddedWidth;
+            for (int Column = 0; Column < 8; Column++)
+            {
+                Block[Row * 8 + Column] = 0.25f * (Top[Column * 2] + Top[Column * 2 + 1] +
+                    Bottom[Column * 2] + Bottom[Column * 2 + 1]);
+            }
+        }
+    };
+
+    for (int McuRow = FirstRow; McuRow < FirstRow + RowCount; McuRow++)
+    {
+        for (int Row = 0; Row < MMcuSize; Row++)
+        {
+            int Y = McuRow * MMcuSize + Row;
+            if (Y >= MHeight) Y = MHeight - 1;
+            size_t Offset = (size_t)Row * PaddedWidth;
+            FetchRow(Image, Factor, Y, MWidth, PaddedWidth, PlaneY + Offset, PlaneCb ? PlaneCb + Offset : nullptr,
+                PlaneCr ? PlaneCr + Offset : nullptr);
+        }
+
+        for (int Mcu = 0; Mcu < MMcusX; Mcu++)
+        {
+            int X0 = Mcu * MMcuSize;
+            Writer.Reserve();
+            for (int BlockY = 0; BlockY < MMcuSize; BlockY += 8)
+            {
+                for (int BlockX = 0; BlockX < MMcuSize; BlockX += 8)
+                {
+                    GatherBlock(PlaneY, X0 + BlockX, BlockY);
+                    TransformAndQuantize(Block, MDivisorsLuma, Coefficients);
+                    EncodeBlock(Writer, Coefficients, PreviousDC[0], DcLumaTable, AcLumaTable);
+                }
+            }
+            if (MIsGray) continue;
+
+            const float *ChromaPlanes[2] = { PlaneCb, PlaneCr };
+            for (int Component = 0; Component < 2; Component++)
+            {
+                if (Subsampled) GatherSubsampled(ChromaPlanes[Component], X0);
+                else GatherBlock(ChromaPlanes[Component], X0, 0);
+                TransformAndQuantize(Block, MDivisorsChroma, Coefficients);
+                EncodeBlock(Writer, Coefficients, PreviousDC[1 + Component], DcChromaTable, AcChromaTable);
+            }
+        }
+    }
+
+    Writer.Finish();
+}
+
+bool CJpegEncoder::Encode(const SImageView &Image, std::vector<uint8_t> &Output)
+{
+    Output.clear();
+    if (!Image.IsValid() || (Image.Format != EPixelFormat::BGRA8 && Image.Format != EPixelFormat::Gray8))
+    {
+        return false;
+    }
+
+    const int Factor = MSettings.Downscale;
+    MIsGray = Image.Format == EPixelFormat::Gray8;
+    MWidth = Image.Width / Factor;
+    MHeight = Image.Height / Factor;
+    if (MWidth < 1 || MHeight < 1 || MWidth > 65535 || MHeight > 65535) return false;
+
+    MMcuSize = (!MIsGray && MSettings.Subsample) ? 16 : 8;
+    MMcusX = (MWidth + MMcuSize - 1) / MMcuSize;
+    const int McuRows = (MHeight + MMcuSize - 1) / MMcuSize;
+
+    int RowsPerSegment = MSettings.RestartRows;
+    if (RowsPerSegment == 0)
+    {
+        // A few segments per thread keeps the pool balanced; one thread needs no restarts
+        int Threads = MPool->GetThreadCount();
+        int Segments = Threads > 1 ? Threads * 4 : 1;
+        RowsPerSegment = (McuRows + Segments - 1) / Segments;
+    }
+    if (RowsPerSegment > McuRows) RowsPerSegment = McuRows;
+    while ((long long)RowsPerSegment * MMcusX > 65535 && RowsPerSegment > 1) RowsPerSegment--;
+    const int SegmentCount = (McuRows + RowsPerSegment - 1) / RowsPerSegment;
+    const int RestartInterval = SegmentCount > 1 ? RowsPerSegment * MMcusX : 0;
+    if (RestartInterval > 65535) return false;
+
+    if ((int)MSegments.size() < SegmentCount) MSegments.resize(SegmentCount);
+    MPool->ParallelFor(SegmentCount, [&](int Segment) {
+        int FirstRow = Segment * RowsPerSegment;
+        int RowCount = McuRows - FirstRow < RowsPerSegment ? McuRows - FirstRow : RowsPerSegment;
+        EncodeSegment(Image, FirstRow, RowCount, MSegments[Segment]);
+    });
+
+    size_t DataSize = 0;
+    for (int Segment = 0; Segment < SegmentCount; Segment++) DataSize += MSegments[Segment].size() + 2;
+    Output.reserve(DataSize + 1024);
+
+    AppendMarker(Output, 0xD8, -1);
+
+    // JFIF 1.01, no density, no thumbnail
+    static const uint8_t Jfif[14] = { 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0 };
+    AppendMarker(Output, 0xE0, 14);
+    Output.insert(Output.end(), Jfif, Jfif + 14);
+
+    AppendMarker(Output, 0xDB, MIsGray ? 65 : 130);
+    Output.push_back(0x00);
+    Output.insert(Output.end(), MQuantLuma, MQuantLuma + 64);
+    if (!MIsGray)
+    {
+        Output.push_back(0x01);
+        Output.insert(Output.end(), MQuantChroma, MQuantChroma + 64);
+    }
+
+    const int Components = MIsGray ? 1 : 3;
+    AppendMarker(Output, 0xC0, 6 + Components * 3);
+    Output.push_back(8);
+    Output.push_back((uint8_t)(MHeight >> 8));
+    Output.push_back((uint8_t)MHeight);
+    Output.push_back((uint8_t)(MWidth >> 8));
+    Output.push_back((uint8_t)MWidth);
+    Output.push_back((uint8_t)Components);
+    for (int Component = 0; Component < Components; Component++)
+    {
+        uint8_t Sampling = (Component == 0 && MMcuSize == 16) ? 0x22 : 0x11;
+        Output.push_back((uint8_t)(Component + 1));
+        Output.push_back(Sampling);
+        Output.push_back(Component == 0 ? 0 : 1);
+    }
+
+    AppendMarker(Output, 0xC4, MIsGray ? (17 + 12) + (17 + 162) : 2 * ((17 + 12) + (17 + 162)));
+    AppendHuffmanTable(Output, 0x00, DcLumaBits, DcValues);
+    AppendHuffmanTable(Output, 0x10, AcLumaBits, AcLumaValues);
+    if (!MIsGray)
+    {
+        AppendHuffmanTable(Output, 0x01, DcChromaBits, DcValues);
+        AppendHuffmanTable(Output, 0x11, AcChromaBits, AcChromaValues);
+    }
+
+    if (RestartInterval > 0)
+    {
+        AppendMarker(Output, 0xDD, 2);
+        Output.push_back((uint8_t)(RestartInterval >> 8));
+        Output.push_back((uint8_t)RestartInterval);
+    }
+
+    AppendMarker(Output, 0xDA, 4 + Components * 2);
+    Output.push_back((uint8_t)Components);
+    for (int Component = 0; Component < Components; Component++)
+    {
+        Output.push_back((uint8_t)(Component + 1));
+        Output.push_back(Component == 0 ? 0x00 : 0x11);
+    }
+    Output.push_back(0);
+    Output.push_back(63);
+    Output.push_back(0);
+
+    for (int Segment = 0; Segment < SegmentCount; Segment++)
+    {
+        if (Segment > 0) AppendMarker(Output, (uint8_t)(0xD0 + ((Segment - 1) & 7)), -1);
+        Output.insert(Output.end(), MSegments[Segment].begin(), MSegments[Segment].end());
+    }
+
+    AppendMarker(Output, 0xD9, -1);
+    return true;
+}
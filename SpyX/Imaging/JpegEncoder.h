@@ -0,0 +1,61 @@
+#ifndef TAPI_JPEG_ENCODER_H
+#define TAPI_JPEG_ENCODER_H
+
+#include "Core/ThreadPool.h"
+#include "Imaging/ImageView.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct SJpegSettings
+{
+    int Quality = 75;             // 1..100, libjpeg scaling of the Annex K tables
+    bool Subsample = true;        // 4:2:0 chroma; false keeps full-resolution chroma (4:4:4)
+    int Downscale = 1;            // Box-filter factor 1..8 applied while reading the source
+    int RestartRows = 0;          // MCU rows per restart segment, 0 = one segment per thread share
+    int ThreadCount = 0;          // Segment encoder threads, 0 = hardware concurrency
+};
+
+// Baseline JPEG encoder for BGRA8 and Gray8 frames, aimed at previews and thumbnails.
+// Pixels are converted to YCbCr, transformed with a float AAN forward DCT (SSE2 where
+// available), quantized and Huffman coded with the standard tables. The image is cut
+// into restart-interval segments of whole MCU rows that encode in parallel and are
+// joined with RSTn markers. An optional integer downscale is fused into the pixel fetch,
+// so thumbnails never materialize a full-size intermediate.
+class CJpegEncoder
+{
+public:
+    explicit CJpegEncoder(const SJpegSettings &Settings = SJpegSettings());
+
+    void Configure(const SJpegSettings &Settings);
+    const SJpegSettings &GetSettings() const { return MSettings; }
+
+    // Replaces Output with a complete JFIF file. Gray8 input produces a greyscale JPEG.
+    bool Encode(const SImageView &Image, std::vector<uint8_t> &Output);
+
+private:
+    void EncodeSegment(const SImageView &Image, int FirstRow, int RowCount, std::vector<uint8_t> &Output) const;
+
+    SJpegSettings MSettings;
+    std::unique_ptr<CThreadPool> MPool;
+    int MPoolThreads = -1;
+
+    // Quantization tables in zigzag order, and the matching reciprocal divisors in
+    // natural order with the AAN output scaling folded in
+    uint8_t MQuantLuma[64];
+    uint8_t MQuantChroma[64];
+    float MDivisorsLuma[64];
+    float MDivisorsChroma[64];
+
+    // Scaled image geometry for the current Encode call
+    bool MIsGray = false;
+    int MWidth = 0;
+    int MHeight = 0;
+    int MMcuSize = 8;
+    int MMcusX = 0;
+
+    std::vector<std::vector<uint8_t>> MSegments;
+};
+
+#endif
@@ -0,0 +1,400 @@
+#include "PaletteQuantizer.h"
+#include "Core/Simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static const uint16_t EmptyCell = 0xFFFF;
+static const int CellCount = 1 << (3 * PaletteLutBits);
+static const int HistogramBits = 5;     // Popularity counts colours on the top 5 bits of each channel
+static const int TargetSamples = 16384;
+static const int16_t FarChannel = 2048;  // Padding colour, farther than any pixel from every cell
+
+static bool IsFrameSupported(const SImageView &Frame)
+{
+    return Frame.IsValid() && (Frame.Format == EPixelFormat::BGRA8 || Frame.Format == EPixelFormat::Gray8);
+}
+
+// Table cell of a colour: the top PaletteLutBits of R, G and B, red most significant
+static uint32_t GetCellIndex(uint32_t Color)
+{
+    const uint32_t Shift = 8 - PaletteLutBits;
+    const uint32_t Mask = (1u << PaletteLutBits) - 1;
+    return (((Color >> (16 + Shift)) & Mask) << (2 * PaletteLutBits)) |
+        (((Color >> (8 + Shift)) & Mask) << PaletteLutBits) | ((Color >> Shift) & Mask);
+}
+
+static int GetChannel(uint32_t Color, int Channel)
+{
+    return (int)(Color >> (8 * Channel)) & 0xFF;
+}
+
+static uint32_t MakeColor(uint64_t Red, uint64_t Green, uint64_t Blue)
+{
+    return 0xFF000000u | (uint32_t)Red << 16 | (uint32_t)Green << 8 | (uint32_t)Blue;
+}
+
+// Rounded mean of Count colours
+static uint32_t GetMeanColor(const uint64_t Sums[3], uint64_t Count)
+{
+    return MakeColor((Sums[2] + Count / 2) / Count, (Sums[1] + Count / 2) / Count, (Sums[0] + Count / 2) / Count);
+}
+
+bool CPaletteQuantizer::SetPalette(const uint32_t *Colors, int Count)
+{
+    if (!Colors || Count < 1 || Count > MaxPaletteColors) return false;
+
+    MPalette.resize((size_t)Count);
+    for (int Index = 0; Index < Count; Index++) MPalette[Index] = Colors[Index] | 0xFF000000u;
+    ResetTable();
+    return true;
+}
+
+void CPaletteQuantizer::ResetTable()
+{
+    const size_t Padded = (MPalette.size() + 3) & ~(size_t)3;
+    MRedGreen.assign(Padded * 2, FarChannel);
+    MBlue.assign(Padded * 2, 0);
+    for (size_t Index = 0; Index < Padded; Index++)
+    {
+        if (Index >= MPalette.size())
+        {
+            MBlue[Index * 2] = FarChannel;
+            continue;
+        }
+        MRedGreen[Index * 2] = (int16_t)GetChannel(MPalette[Index], 2);
+        MRedGreen[Index * 2 + 1] = (int16_t)GetChannel(MPalette[Index], 1);
+        MBlue[Index * 2] = (int16_t)GetChannel(MPalette[Index], 0);
+    }
+
+    MLut.assign((size_t)CellCount + 1, EmptyCell);
+    for (int Level = 0; Level < 256; Level++)
+    {
+        MGrayLut[Level] = Lookup(0xFF000000u | (uint32_t)Level * 0x010101u);
+    }
+}
+
+// Nearest palette colour to the cell's centre, ties to the lower index
+uint8_t CPaletteQuantizer::ResolveCell(uint32_t Cell)
+{
+    const int Shift = 8 - PaletteLutBits;
+    const int Mask = (1 << PaletteLutBits) - 1;
+    const int Half = 1 << (Shift - 1);
+    const int Red = (((int)Cell >> (2 * PaletteLutBits)) << Shift) + Half;
+    const int Green = ((((int)Cell >> PaletteLutBits) & Mask) << Shift) + Half;
+    const int Blue = (((int)Cell & Mask) << Shift) + Half;
+    const int Padded = (int)MBlue.size() / 2;
+
+    int Best = 0;
+    int BestDistance = INT32_MAX;
+
+#ifdef SPYX_SSE2
+    // Four colours per step: madd squares and adds the (R, G) differences, then the (B, 0) ones.
+    // Each lane keeps its first minimum, so the lowest index still wins ties.
+    {
+        const __m128i CentreRedGreen = _mm_set1_epi32(Green << 16 | Red);
+        const __m128i CentreBlue = _mm_set1_epi32(Blue);
+        const __m128i Four = _mm_set1_epi32(4);
+        __m128i Index = _mm_setr_epi32(0, 1, 2, 3);
+        __m128i LaneDistance = _mm_set1_epi32(INT32_MAX);
+        __m128i LaneBest = _mm_setzero_si128();
+        for (int Base = 0; Base < Padded; Base += 4)
+        {
+            __m128i RedGreen = _mm_sub_epi16(_mm_loadu_si128((const __m128i *)&MRedGreen[(size_t)Base * 2]), CentreRedGreen);
+            __m128i BlueDelta = _mm_sub_epi16(_mm_loadu_si128((const __m128i *)&MBlue[(size_t)Base * 2]), CentreBlue);
+            __m128i Distance = _mm_add_epi32(_mm_madd_epi16(RedGreen, RedGreen), _mm_madd_epi16(BlueDelta, BlueDelta));
+            __m128i Closer = _mm_cmplt_epi32(Distance, LaneDistance);
+            LaneDistance = _mm_or_si128(_mm_and_si128(Closer, Distance), _mm_andnot_si128(Closer, LaneDistance));
+            LaneBest = _mm_or_si128(_mm_and_si128(Closer, Index), _mm_andnot_si128(Closer, LaneBest));
+            Index = _mm_add_epi32(Index, Four);
+        }
+
+        alignas(16) int32_t Distances[4];
+        alignas(16) int32_t Indices[4];
+        _mm_store_si128((__m128i *)Distances, LaneDistance);
+        _mm_store_si128((__m128i *)Indices, LaneBest);
+        for (int Lane = 0; Lane < 4; Lane++)
+        {
+            if (Distances[Lane] < BestDistance || (Distances[Lane] == BestDistance && Indices[Lane] < Best))
+            {
+                BestDistance = Distances[Lane];
+                Best = Indices[Lane];
+            }
+        }
+    }
+#else
+    for (int Index = 0; Index < Padded; Index++)
+    {
+        const int DeltaRed = MRedGreen[(size_t)Index * 2] - Red;
+        const int DeltaGreen = MRedGreen[(size_t)Index * 2 + 1] - Green;
+        const int DeltaBlue = MBlue[(size_t)Index * 2] - Blue;
+        const int Distance = DeltaRed * DeltaRed + DeltaGreen * DeltaGreen + DeltaBlue * DeltaBlue;
+        if (Distance < BestDistance)
+        {
+            BestDistance = Distance;
+            Best = Index;
+        }
+    }
+#endif
+
+    MLut[Cell] = (uint16_t)Best;
+    return (uint8_t)Best;
+}
+
+uint8_t CPaletteQuantizer::Lookup(uint32_t Color)
+{
+    const uint32_t Cell = GetCellIndex(Color);
+    const uint16_t Index = MLut[Cell];
+    return Index != EmptyCell ? (uint8_t)Index : ResolveCell(Cell);
+}
+
+// Median cut box over MSamples[Begin, End)
+struct SCutBox
+{
+    int Begin = 0;
+    int End = 0;
+    int Channel = 0;                // Channel with the widest spread
+    int Spread = 0;
+};
+
+static void MeasureBox(const uint32_t *Samples, SCutBox &Box)
+{
+    int Low[3] = {255, 255, 255};
+    int High[3] = {0, 0, 0};
+    for (int Index = Box.Begin; Index < Box.End; Index++)
+    {
+        for (int Channel = 0; Channel < 3; Channel++)
+        {
+            const int Value = GetChannel(Samples[Index], Channel);
+            Low[Channel] = std::min(Low[Channel], Value);
+            High[Channel] = std::max(High[Channel], Value);
+        }
+    }
+    Box.Channel = 0;
+    Box.Spread = High[0] - Low[0];
+    for (int Channel = 1; Channel < 3; Channel++)
+    {
+        if (High[Channel] - Low[Channel] > Box.Spread)
+        {
+            Box.Channel = Channel;
+            Box.Spread = High[Channel] - Low[Channel];
+        }
+    }
+}
+
+bool CPaletteQuantizer::BuildPalette(const SImageView &Frame, EPaletteMethod Method, int MaxColors, int SampleStep)
+{
+    if (!IsFrameSupported(Frame) || MaxColors < 1 || MaxColors > MaxPaletteColors || SampleStep < 0) return false;
+    if (SampleStep == 0)
+    {
+        SampleStep = std::max(1, (int)std::sqrt((double)Frame.Width * Frame.Height / TargetSamples));
+    }
+
+    // The first sample stays inside the frame however large the step, so there is always one.
+    // Positions are 64-bit since a step near INT_MAX would wrap the next one.
+    MSamples.clear();
+    for (int64_t Y = std::min(SampleStep / 2, Frame.Height - 1); Y < Frame.Height; Y += SampleStep)
+    {
+        const uint8_t *Row = Frame.Row((int)Y);
+        for (int64_t X = std::min(SampleStep / 2, Frame.Width - 1); X < Frame.Width; X += SampleStep)
+        {
+            uint32_t Color;
+            if (Frame.Format == EPixelFormat::Gray8) Color = (uint32_t)Row[X] * 0x010101u;
+            else std::memcpy(&Color, Row + (size_t)X * 4, 4);
+            MSamples.push_back(Color & 0xFFFFFF);
+        }
+    }
+
+    // Built aside, so a failed build keeps the current palette and its table
+    MBuilt.clear();
+    if (Method == EPaletteMethod::Popularity)
+    {
+        const int Cells = 1 << (3 * HistogramBits);
+        const int Shift = 8 - HistogramBits;
+        MCounts.assign((size_t)Cells, 0);
+        MSums.assign((size_t)Cells * 3, 0);
+        for (uint32_t Color : MSamples)
+        {
+            const uint32_t Cell = ((uint32_t)GetChannel(Color, 2) >> Shift) << (2 * HistogramBits) |
+                ((uint32_t)GetChannel(Color, 1) >> Shift) << HistogramBits | (uint32_t)GetChannel(Color, 0) >> Shift;
+            MCounts[Cell]++;
+            for (int Channel = 0; Channel < 3; Channel++) MSums[(size_t)Cell * 3 + Channel] += GetChannel(Color, Channel);
+        }
+
+        std::vector<uint32_t> Used;
+        for (int Cell = 0; Cell < Cells; Cell++)
+        {
+            if (MCounts[Cell]) Used.push_back((uint32_t)Cell);
+        }
+        const size_t Kept = std::min(Used.size(), (size_t)MaxColors);
+        std::partial_sort(Used.begin(), Used.begin() + Kept, Used.end(), [this](uint32_t First, uint32_t Second)
+        {
+            return MCounts[First] != MCounts[Second] ? MCounts[First] > MCounts[Second] : First < Second;
+        });
+        for (size_t Index = 0; Index < Kept; Index++)
+        {
+            MBuilt.push_back(GetMeanColor(&MSums[(size_t)Used[Index] * 3], MCounts[Used[Index]]));
+        }
+    }
+    else
+    {
+        // Split the widest box weighted by its samples until MaxColors boxes or all are flat
+        std::vector<SCutBox> Boxes(1);
+        Boxes[0].End = (int)MSamples.size();
+        MeasureBox(MSamples.data(), Boxes[0]);
+        while ((int)Boxes.size() < MaxColors)
+        {
+            int Widest = -1;
+            int64_t WidestScore = 0;
+            for (int Index = 0; Index < (int)Boxes.size(); Index++)
+            {
+                const int64_t Score = (int64_t)Boxes[Index].Spread * (Boxes[Index].End - Boxes[Index].Begin);
+                if (Score > WidestScore)
+                {
+                    WidestScore = Score;
+                    Widest = Index;
+                }
+            }
+            if (Widest < 0) break;
+
+            // Splitting below the median value keeps equal colours together and both halves non-empty
+            SCutBox Box = Boxes[Widest];
+            const int Channel = Box.Channel;
+            uint32_t *Begin = MSamples.data() + Box.Begin;
+            uint32_t *End = MSamples.data() + Box.End;
+            uint32_t *Middle = Begin + (End - Begin) / 2;
+            std::nth_element(Begin, Middle, End, [Channel](uint32_t First, uint32_t Second)
+            {
+                return GetChannel(First, Channel) < GetChannel(Second, Channel);
+            });
+            const int Median = GetChannel(*Middle, Channel);
+            uint32_t *Split = std::partition(Begin, End, [Channel, Median](uint32_t Color)
+            {
+                return GetChannel(Color, Channel) < Median;
+            });
+            if (Split == Begin)
+            {
+                Split = std::partition(Begin, End, [Channel, Median](uint32_t Color)
+                {
+                    return GetChannel(Color, Channel) <= Median;
+                });
+            }
+
+            SCutBox Upper;
+            Upper.Begin = (int)(Split - MSamples.data());
+            Upper.End = Box.End;
+            Box.End = Upper.Begin;
+            MeasureBox(MSamples.data(), Box);
+            MeasureBox(MSamples.data(), Upper);
+            Boxes[Widest] = Box;
+            Boxes.push_back(Upper);
+        }
+
+        for (const SCutBox &Box : Boxes)
+        {
+            if (Box.Begin == Box.End) continue;
+            uint64_t Sums[3] = {};
+            for (int Index = Box.Begin; Index < Box.End; Index++)
+            {
+                for (int Channel = 0; Channel < 3; Channel++) Sums[Channel] += GetChannel(MSamples[Index], Channel);
+            }
+            MBuilt.push_back(GetMeanColor(Sums, (uint64_t)(Box.End - Box.Begin)));
+        }
+    }
+
+    if (MBuilt.empty()) return false;
+    MPalette.swap(MBuilt);
+    ResetTable();
+    return true;
+}
+
+void CPaletteQuantizer::QuantizeRowBGRA(const uint8_t *Pixels, int Width, uint8_t *Indices)
+{
+    int X = 0;
+
+#ifdef SPYX_AVX2
+    // The gather reads four bytes per 2-byte cell; the table's last entry is padding
+    {
+        const int Shift = 8 - PaletteLutBits;
+        const __m256i CellMask = _mm256_set1_epi32((1 << PaletteLutBits) - 1);
+        const __m256i EntryMask = _mm256_set1_epi32(0xFFFF);
+        const __m256i Empty = _mm256_set1_epi32(EmptyCell);
+        for (; X + 8 <= Width; X += 8)
+        {
+            __m256i Colors = _mm256_loadu_si256((const __m256i *)(Pixels + 4 * X));
+            __m256i Cell = _mm256_and_si256(_mm256_srli_epi32(Colors, Shift), CellMask);
+            Cell = _mm256_or_si256(Cell, _mm256_slli_epi32(_mm256_and_si256(_mm256_srli_epi32(Colors, 8 + Shift), CellMask),
+                PaletteLutBits));
+            Cell = _mm256_or_si256(Cell, _mm256_slli_epi32(_mm256_and_si256(_mm256_srli_epi32(Colors, 16 + Shift), CellMask),
+                2 * PaletteLutBits));
+            __m256i Entries = _mm256_and_si256(_mm256_i32gather_epi32((const int *)MLut.data(), Cell, 2), EntryMask);
+
+            // Cells met for the first time are resolved one by one
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(Entries, Empty)))
+            {
+                for (int Lane = 0; Lane < 8; Lane++)
+                {
+                    uint32_t Color;
+                    std::memcpy(&Color, Pixels + 4 * (X + Lane), 4);
+                    Indices[X + Lane] = Lookup(Color);
+                }
+                continue;
+            }
+
+            __m256i Words = _mm256_packus_epi32(Entries, Entries);
+            __m256i Bytes = _mm256_packus_epi16(Words, Words);
+            uint32_t Low = (uint32_t)_mm_cvtsi128_si32(_mm256_castsi256_si128(Bytes));
+            uint32_t High = (uint32_t)_mm_cvtsi128_si32(_mm256_extracti128_si256(Bytes, 1));
+            std::memcpy(Indices + X, &Low, 4);
+            std::memcpy(Indices + X + 4, &High, 4);
+        }
+    }
+#elif defined(SPYX_SSE2)
+    // Cells four at a time; SSE2 has no gather, so the table is read per lane
+    {
+        const int Shift = 8 - PaletteLutBits;
+        const __m128i CellMask = _mm_set1_epi32((1 << PaletteLutBits) - 1);
+        alignas(16) uint32_t Cells[4];
+        for (; X + 4 <= Width; X += 4)
+        {
+            __m128i Colors = _mm_loadu_si128((const __m128i *)(Pixels + 4 * X));
+            __m128i Cell = _mm_and_si128(_mm_srli_epi32(Colors, Shift), CellMask);
+            Cell = _mm_or_si128(Cell, _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(Colors, 8 + Shift), CellMask), PaletteLutBits));
+            Cell = _mm_or_si128(Cell, _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(Colors, 16 + Shift), CellMask),
+                2 * PaletteLutBits));
+            _mm_store_si128((__m128i *)Cells, Cell);
+            for (int Lane = 0; Lane < 4; Lane++)
+            {
+                const uint16_t Entry = MLut[Cells[Lane]];
+                Indices[X + Lane] = Entry != EmptyCell ? (uint8_t)Entry : ResolveCell(Cells[Lane]);
+            }
+        }
+    }
+#endif
+
+    for (; X < Width; X++)
+    {
+        uint32_t Color;
+        std::memcpy(&Color, Pixels + 4 * X, 4);
+        Indices[X] = Lookup(Color);
+    }
+}
+
+bool CPaletteQuantizer::Quantize(const SImageView &Frame, uint8_t *Indices, int IndexStride)
+{
+    if (MPalette.empty() || !IsFrameSupported(Frame) || !Indices || IndexStride < Frame.Width) return false;
+
+    for (int Y = 0; Y < Frame.Height; Y++)
+    {
+        const uint8_t *Row = Frame.Row(Y);
+        uint8_t *IndexRow = Indices + (size_t)Y * IndexStride;
+        if (Frame.Format == EPixelFormat::BGRA8)
+        {
+            QuantizeRowBGRA(Row, Frame.Width, IndexRow);
+            continue;
+        }
+        for (int X = 0; X < Frame.Width; X++) IndexRow[X] = MGrayLut[Row[X]];
+    }
+    return true;
+}
@@ -0,0 +1,62 @@
+#ifndef TAPI_PALETTE_QUANTIZER_H
+#define TAPI_PALETTE_QUANTIZER_H
+
+#include "Imaging/ImageView.h"
+
+#include <cstdint>
+#include <vector>
+
+// Turns BGRA8 or Gray8 frames into one palette index per pixel, a quarter of BGRA8. The palette
+// is given, or built from a sparse grid of frame samples by median cut or popularity. Nearest
+// colours come from a 3D table on the top PaletteLutBits of R, G and B. Its cells start empty
+// and are resolved the first time a pixel falls in them, each from the cell's centre, so a
+// palette that stays in use pays for the colours it meets once.
+
+enum class EPaletteMethod : int
+{
+    MedianCut = 0,  // Splits the sample box with the widest spread at its median; covers gradients
+    Popularity = 1  // Most frequent sample colours; best for flat UI colours
+};
+
+static const int MaxPaletteColors = 256;
+static const int PaletteLutBits = 6;
+
+class CPaletteQuantizer
+{
+public:
+    // Colors are 0xAARRGGBB; alpha is ignored and the palette keeps 0xFF. Fails outside 1-256 colours.
+    bool SetPalette(const uint32_t *Colors, int Count);
+
+    // Builds up to MaxColors colours from every SampleStep-th pixel in both directions, 0 to
+    // take about 16K samples. Fewer colours come out when the samples have fewer. On failure
+    // the current palette is kept.
+    bool BuildPalette(const SImageView &Frame, EPaletteMethod Method, int MaxColors, int SampleStep);
+
+    int GetColorCount() const { return (int)MPalette.size(); }
+    const uint32_t *GetPalette() const { return MPalette.data(); }
+
+    // Writes Frame.Width x Frame.Height indices; fails without a palette
+    bool Quantize(const SImageView &Frame, uint8_t *Indices, int IndexStride);
+
+    // Index of one colour through the table
+    uint8_t Lookup(uint32_t Color);
+
+private:
+    void ResetTable();
+    uint8_t ResolveCell(uint32_t Cell);
+    void QuantizeRowBGRA(const uint8_t *Pixels, int Width, uint8_t *Indices);
+
+    std::vector<uint32_t> MPalette;
+    std::vector<int16_t> MRedGreen; // (R, G) and (B, 0) pairs per colour, padded to a multiple of 4
+    std::vector<int16_t> MBlue;     // with colours far from any pixel
+    std::vector<uint16_t> MLut;     // Palette index per cell, EmptyCell until resolved, padded for gathers
+    uint8_t MGrayLut[256] = {};     // Cells of R = G = B, indexed by the grey level
+
+    // Palette building scratch
+    std::vector<uint32_t> MSamples;
+    std::vector<uint32_t> MBuilt;   // Palette being built, swapped in on success
+    std::vector<uint32_t> MCounts;
+    std::vector<uint64_t> MSums;
+};
+
+#endif
@@ -0,0 +1,142 @@
+#include "ScreenshotService.h"
+
+#include <cstdio>
+#include <cstring>
+
+static bool WriteFileContents(const std::string &Path, const std::vector<uint8_t> &Data)
+{
+    std::FILE *File = nullptr;
+#ifdef _MSC_VER
+    if (fopen_s(&File, Path.c_str(), "wb") != 0) File = nullptr;
+#else
+    File = std::fopen(Path.c_str(), "wb");
+#endif
+    if (!File) return false;
+
+    bool Success = std::fwrite(Data.data(), 1, Data.size(), File) == Data.size();
+    if (std::fclose(File) != 0) Success = false;
+    return Success;
+}
+
+CScreenshotService::CScreenshotService(int MaxPending)
+    : MMaxPending(MaxPending > 0 ? MaxPending : 1)
+{
+    MWorker = std::thread(&CScreenshotService::WorkerMain, this);
+}
+
+CScreenshotService::~CScreenshotService()
+{
+    // Queued screenshots are still written before the thread exits
+    {
+        std::lock_guard<std::mutex> Lock(MMutex);
+        MStop = true;
+    }
+    MWorkCondition.notify_one();
+    if (MWorker.joinable()) MWorker.join();
+}
+
+void CScreenshotService::SetCompletionCallback(const FCompletion &Callback)
+{
+    std::lock_guard<std::mutex> Lock(MMutex);
+    MCompletion = Callback;
+}
+
+bool CScreenshotService::Submit(const SImageView &Frame, const std::string &Path, EImageFileFormat Format)
+{
+    if (!Frame.IsValid() || (Frame.Format != EPixelFormat::BGRA8 && Frame.Format != EPixelFormat::Gray8))
+    {
+        return false;
+    }
+
+    SJob Job;
+    {
+        std::lock_guard<std::mutex> Lock(MMutex);
+        if (MStats.Pending >= (size_t)MMaxPending)
+        {
+            MStats.Rejected++;
+            return false;
+        }
+        MStats.Pending++;
+
+        if (!MFreeBuffers.empty())
+        {
+            Job.Pixels = std::move(MFreeBuffers.back());
+            MFreeBuffers.pop_back();
+        }
+    }
+
+    // The copy is the only per-frame work on this thread; recycled buffers avoid page faults
+    const size_t RowBytes = (size_t)Frame.Width * GetBytesPerPixel(Frame.Format);
+    Job.Pixels.resize(RowBytes * Frame.Height);
+    for (int Y = 0; Y < Frame.Height; Y++)
+    {
+        std::memcpy(Job.Pixels.data() + RowBytes * Y, Frame.Row(Y), RowBytes);
+    }
+    Job.Width = Frame.Width;
+    Job.Height = Frame.Height;
+    Job.PixelFormat = Frame.Format;
+    Job.Path = Path;
+    Job.Format = Format;
+
+    {
+        std::lock_guard<std::mutex> Lock(MMutex);
+        MJobs.push_back(std::move(Job));
+    }
+    MWorkCondition.notify_one();
+    return true;
+}
+
+void CScreenshotService::Flush()
+{
+    std::unique_lock<std::mutex> Lock(MMutex);
+    MIdleCondition.wait(Lock, [this]() { return MStats.Pending == 0; });
+}
+
+SScreenshotStats CScreenshotService::GetStats() const
+{
+    std::lock_guard<std::mutex> Lock(MMutex);
+    return MStats;
+}
+
+void CScreenshotService::WorkerMain()
+{
+    std::vector<uint8_t> Encoded;
+
+    for (;;)
+    {
+        SJob Job;
+        {
+            std::unique_lock<std::mutex> Lock(MMutex);
+            MWorkCondition.wait(Lock, [this]() { return MStop || !MJobs.empty(); });
+            if (MJobs.empty()) return;
+
+            Job = std::move(MJobs.front());
+            MJobs.pop_front();
+        }
+
+        SImageView View;
+        View.Data = Job.Pixels.data();
+        View.Width = Job.Width;
+        View.Height = Job.Height;
+        View.Stride = Job.Width * GetBytesPerPixel(Job.PixelFormat);
+        View.Format = Job.PixelFormat;
+
+        bool Success = EncodeImage(View, Job.Format, Encoded) && WriteFileContents(Job.Path, Encoded);
+
+        FCompletion Completion;
+        {
+            std::lock_guard<std::mutex> Lock(MMutex);
+            Completion = MCompletion;
+        }
+        if (Completion) Completion(Job.Path, Success);
+
+        {
+            std::lock_guard<std::mutex> Lock(MMutex);
+            if (MFreeBuffers.size() < (size_t)MMaxPending) MFreeBuffers.push_back(std::move(Job.Pixels));
+            if (Success) MStats.Completed++;
+            else MStats.Failed++;
+            MStats.Pending--;
+        }
+        MIdleCondition.notify_all();
+    }
+}
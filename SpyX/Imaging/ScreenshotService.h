@@ -0,0 +1,77 @@
+#ifndef TAPI_SCREENSHOT_SERVICE_H
+#define TAPI_SCREENSHOT_SERVICE_H
+
+#include "Imaging/ImageEncoder.h"
+#include "Imaging/ImageView.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SScreenshotStats
+{
+    size_t Pending = 0;     // Queued or being encoded
+    size_t Completed = 0;   // Written successfully
+    size_t Failed = 0;      // Encoding or writing failed
+    size_t Rejected = 0;    // Not queued because the queue was full
+};
+
+// Saves frames to disk on a background thread. The submitting thread only copies the
+// pixels into a recycled buffer; encoding and file I/O happen on the encoder thread.
+class CScreenshotService
+{
+public:
+    // Called on the encoder thread after each file is written or has failed
+    using FCompletion = std::function<void(const std::string &Path, bool Success)>;
+
+    // MaxPending bounds the queued frames, and with them the memory held
+    explicit CScreenshotService(int MaxPending = 4);
+    ~CScreenshotService();
+
+    CScreenshotService(const CScreenshotService &) = delete;
+    CScreenshotService &operator=(const CScreenshotService &) = delete;
+
+    void SetCompletionCallback(const FCompletion &Callback);
+
+    // Queues a BGRA8 or Gray8 frame; false if the frame is invalid or the queue is full
+    bool Submit(const SImageView &Frame, const std::string &Path, EImageFileFormat Format);
+
+    // Blocks until every queued screenshot has been written
+    void Flush();
+
+    SScreenshotStats GetStats() const;
+
+private:
+    struct SJob
+    {
+        std::vector<uint8_t> Pixels;  // Tightly packed
+        int Width = 0;
+        int Height = 0;
+        EPixelFormat PixelFormat = EPixelFormat::BGRA8;
+        std::string Path;
+        EImageFileFormat Format = EImageFileFormat::PNG;
+    };
+
+    void WorkerMain();
+
+    int MMaxPending;
+    std::thread MWorker;
+
+    mutable std::mutex MMutex;
+    std::condition_variable MWorkCondition;
+    std::condition_variable MIdleCondition;
+    std::deque<SJob> MJobs;
+    std::vector<std::vector<uint8_t>> MFreeBuffers;
+    FCompletion MCompletion;
+    bool MBusy = false;
+    bool MStop = false;
+    SScreenshotStats MStats;
+};
+
+#endif
@@ -0,0 +1,352 @@
+#include "ToneMapper.h"
+#include "Core/Simd.h"
+
+#include <cmath>
+#include <cstring>
+
+// Luminance weights (BT.709) in 1/4096 units, applied to the 12-bit tone-mapped
+// channel indices so the gray path stays in exact integer math.
+static const int LumaWeightRed = 871;
+static const int LumaWeightGreen = 2929;
+static const int LumaWeightBlue = 296;
+
+static const uint32_t HalfMagic = (254 - 15) << 23;
+static const uint32_t HalfWasInfNan = (127 + 16) << 23;
+
+static inline float BitsToFloat(uint32_t Bits)
+{
+    float Value;
+    std::memcpy(&Value, &Bits, sizeof(Value));
+    return Value;
+}
+
+static inline uint32_t FloatToBits(float Value)
+{
+    uint32_t Bits;
+    std::memcpy(&Bits, &Value, sizeof(Bits));
+    return Bits;
+}
+
+float HalfToFloat(uint16_t Half)
+{
+    uint32_t ExponentMantissa = Half & 0x7FFFu;
+    float Scaled = BitsToFloat(ExponentMantissa << 13) * BitsToFloat(HalfMagic);
+    uint32_t Bits = FloatToBits(Scaled);
+    if (Scaled >= BitsToFloat(HalfWasInfNan)) Bits |= 255u << 23;
+    Bits |= (uint32_t)(Half & 0x8000u) << 16;
+    return BitsToFloat(Bits);
+}
+
+static inline int QuantizeIndex(float Value, float Scale)
+{
+    // Round-to-nearest-even, matching _mm_cvtps_epi32 under the default MXCSR.
+    return (int)std::nearbyint(Value * Scale);
+}
+
+static inline int LumaIndex(int Red, int Green, int Blue)
+{
+    return (Red * LumaWeightRed + Green * LumaWeightGreen + Blue * LumaWeightBlue + 2048) >> 12;
+}
+
+CToneMapper::CToneMapper()
+{
+    Configure(SToneMapSettings());
+}
+
+void CToneMapper::Configure(const SToneMapSettings &Settings)
+{
+    MSettings = Settings;
+    if (!(MSettings.Exposure >= 0.0f)) MSettings.Exposure = 1.0f;
+    if (!(MSettings.WhitePoint > 0.0f)) MSettings.WhitePoint = 1.0f;
+    MWhiteSquared = MSettings.WhitePoint * MSettings.WhitePoint;
+
+    // sRGB OETF sampled over the tone-mapped [0, 1] range.
+    for (int Index = 0; Index < EncodeTableSize; Index++)
+    {
+        double Linear = (double)Index / (double)(EncodeTableSize - 1);
+        double Encoded = Linear <= 0.0031308 ? Linear * 12.92 : 1.055 * std::pow(Linear, 1.0 / 2.4) - 0.055;
+        int Value = (int)(Encoded * 255.0 + 0.5);
+        MEncodeTable[Index] = (uint8_t)(Value < 0 ? 0 : (Value > 255 ? 255 : Value));
+    }
+}
+
+float CToneMapper::ToneMapChannel(float Value) const
+{
+    // Extended Reinhard: L * (W^2 + L) / (W^2 * (1 + L)). Written without any a * b + c
+    // pattern so the compiler cannot contract it into an FMA and break SIMD parity.
+    float Scaled = Value * MSettings.Exposure;
+    Scaled = Scaled > 0.0f ? Scaled : 0.0f;
+    Scaled = Scaled < MSettings.WhitePoint ? Scaled : MSettings.WhitePoint;
+    float Numerator = Scaled * (MWhiteSquared + Scaled);
+    float Denominator = MWhiteSquared * (1.0f + Scaled);
+    return Numerator / Denominator;
+}
+
+void CToneMapper::ToneMapToBGRA8Reference(const SImageView &Source, uint8_t *Destination, int DestinationStride) const
+{
+    const float Scale = (float)(EncodeTableSize - 1);
+
+    for (int Y = 0; Y < Source.Height; Y++)
+    {
+        const uint16_t *SourceRow = reinterpret_cast<const uint16_t *>(Source.Row(Y));
+        uint8_t *DestinationRow = Destination + (size_t)Y * (size_t)DestinationStride;
+
+        for (int X = 0; X < Source.Width; X++)
+        {
+            const uint16_t *Pixel = SourceRow + X * 4;
+            float Alpha = HalfToFloat(Pixel[3]);
+            Alpha = Alpha > 0.0f ? Alpha : 0.0f;
+            Alpha = Alpha < 1.0f ? Alpha : 1.0f;
+
+            DestinationRow[X * 4 + 0] = MEncodeTable[QuantizeIndex(ToneMapChannel(HalfToFloat(Pixel[2])), Scale)];
+            DestinationRow[X * 4 + 1] = MEncodeTable[QuantizeIndex(ToneMapChannel(HalfToFloat(Pixel[1])), Scale)];
+            DestinationRow[X * 4 + 2] = MEncodeTable[QuantizeIndex(ToneMapChannel(HalfToFloat(Pixel[0])), Scale)];
+            DestinationRow[X * 4 + 3] = (uint8_t)QuantizeIndex(Alpha, 255.0f);
+        }
+    }
+}
+
+void CToneMapper::ToneMapToGray8Reference(const SImageView &Source, uint8_t *Destination, int DestinationStride) const
+{
+    const float Scale = (float)(EncodeTableSize - 1);
+
+    for (int Y = 0; Y < Source.Height; Y++)
+    {
+        const uint16_t *SourceRow = reinterpret_cast<const uint16_t *>(Source.Row(Y));
+        uint8_t *DestinationRow = Destination + (size_t)Y * (size_t)DestinationStride;
+
+        for (int X = 0; X < Source.Width; X++)
+        {
+            const uint16_t *Pixel = SourceRow + X * 4;
+            int Red = QuantizeIndex(ToneMapChannel(HalfToFloat(Pixel[0])), Scale);
+            int Green = QuantizeIndex(ToneMapChannel(HalfToFloat(Pixel[1])), Scale);
+            int Blue = QuantizeIndex(ToneMapChannel(HalfToFloat(Pixel[2])), Scale);
+            DestinationRow[X] = MEncodeTable[LumaIndex(Red, Green, Blue)];
+        }
+    }
+}
+
+void ConvertBGRA8ToGray8Reference(const SImageView &Source, uint8_t *Destination, int DestinationStride)
+{
+    for (int Y = 0; Y < Source.Height; Y++)
+    {
+        const uint8_t *SourceRow = Source.Row(Y);
+        uint8_t *DestinationRow = Destination + (size_t)Y * (size_t)DestinationStride;
+
+        for (int X = 0; X < Source.Width; X++)
+        {
+            const uint8_t *Pixel = SourceRow + X * 4;
+            DestinationRow[X] = (uint8_t)((Pixel[2] * 77 + Pixel[1] * 150 + Pixel[0] * 29 + 128) >> 8);
+        }
+    }
+}
+
+#if defined(SPYX_SSE2)
+
+// Four halves (one pixel) held in the low 16 bits of each 32-bit lane.
+static inline __m128 HalfToFloat4(__m128i Half)
+{
+    const __m128i ExponentMantissa = _mm_and_si128(Half, _mm_set1_epi32(0x7FFF));
+    const __m128i Sign = _mm_slli_epi32(_mm_xor_si128(Half, ExponentMantissa), 16);
+    const __m128 Scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(ExponentMantissa, 13)),
+        _mm_castsi128_ps(_mm_set1_epi32((int)HalfMagic)));
+    const __m128 InfNan = _mm_cmpge_ps(Scaled, _mm_castsi128_ps(_mm_set1_epi32((int)HalfWasInfNan)));
+    const __m128 Result = _mm_or_ps(Scaled, _mm_and_ps(InfNan, _mm_castsi128_ps(_mm_set1_epi32(255 << 23))));
+    return _mm_or_ps(Result, _mm_castsi128_ps(Sign));
+}
+
+// Loads four RGBA16F pixels and returns them transposed into per-channel vectors.
+static inline void LoadPixels4(const uint16_t *Pixels, __m128 &Red, __m128 &Green, __m128 &Blue, __m128 &Alpha)
+{
+    const __m128i First = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Pixels));
+    const __m128i Second = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Pixels + 8));
+#if defined(SPYX_F16C)
+    __m128 P0 = _mm_cvtph_ps(First);
+    __m128 P1 = _mm_cvtph_ps(_mm_unpackhi_epi64(First, First));
+    __m128 P2 = _mm_cvtph_ps(Second);
+    __m128 P3 = _mm_cvtph_ps(_mm_unpackhi_epi64(Second, Second));
+#else
+    const __m128i Zero = _mm_setzero_si128();
+    __m128 P0 = HalfToFloat4(_mm_unpacklo_epi16(First, Zero));
+    __m128 P1 = HalfToFloat4(_mm_unpackhi_epi16(First, Zero));
+    __m128 P2 = HalfToFloat4(_mm_unpacklo_epi16(Second, Zero));
+    __m128 P3 = HalfToFloat4(_mm_unpackhi_epi16(Second, Zero));
+#endif
+    _MM_TRANSPOSE4_PS(P0, P1, P2, P3);
+    Red = P0;
+    Green = P1;
+    Blue = P2;
+    Alpha = P3;
+}
+
+static inline __m128i ToneMapIndex4(__m128 Value, __m128 Exposure, __m128 White, __m128 WhiteSquared, __m128 Scale)
+{
+    const __m128 One = _mm_set1_ps(1.0f);
+    __m128 Scaled = _mm_mul_ps(Value, Exposure);
+    Scaled = _mm_max_ps(Scaled, _mm_setzero_ps());
+    Scaled = _mm_min_ps(Scaled, White);
+    const __m128 Numerator = _mm_mul_ps(Scaled, _mm_add_ps(WhiteSquared, Scaled));
+    const __m128 Denominator = _mm_mul_ps(WhiteSquared, _mm_add_ps(One, Scaled));
+    return _mm_cvtps_epi32(_mm_mul_ps(_mm_div_ps(Numerator, Denominator), Scale));
+}
+
+void CToneMapper::ToneMapToBGRA8(const SImageView &Source, uint8_t *Destination, int DestinationStride) const
+{
+    const float ScaleValue = (float)(EncodeTableSize - 1);
+    const __m128 Exposure = _mm_set1_ps(MSettings.Exposure);
+    const __m128 White = _mm_set1_ps(MSettings.WhitePoint);
+    const __m128 WhiteSquared = _mm_set1_ps(MWhiteSquared);
+    const __m128 Scale = _mm_set1_ps(ScaleValue);
+    const __m128 AlphaScale = _mm_set1_ps(255.0f);
+    const __m128 One = _mm_set1_ps(1.0f);
+
+    alignas(16) int32_t RedIndex[4], GreenIndex[4], BlueIndex[4], AlphaValue[4];
+
+    for (int Y = 0; Y < Source.Height; Y++)
+    {
+        const uint16_t *SourceRow = reinterpret_cast<const uint16_t *>(Source.Row(Y));
+        uint8_t *DestinationRow = Destination + (size_t)Y * (size_t)DestinationStride;
+
+        int X = 0;
+        for (; X + 4 <= Source.Width; X += 4)
+        {
+            __m128 Red, Green, Blue, Alpha;
+            LoadPixels4(SourceRow + X * 4, Red, Green, Blue, Alpha);
+
+            _mm_store_si128(reinterpret_cast<__m128i *>(RedIndex), ToneMapIndex4(Red, Exposure, White, WhiteSquared, Scale));
+            _mm_store_si128(reinterpret_cast<__m128i *>(GreenIndex), ToneMapIndex4(Green, Exposure, White, WhiteSquared, Scale));
+            _mm_store_si128(reinterpret_cast<__m128i *>(BlueIndex), ToneMapIndex4(Blue, Exposure, White, WhiteSquared, Scale));
+            Alpha = _mm_min_ps(_mm_max_ps(Alpha, _mm_setzero_ps()), One);
+            _mm_store_si128(reinterpret_cast<__m128i *>(AlphaValue), _mm_cvtps_epi32(_mm_mul_ps(Alpha, AlphaScale)));
+
+            uint8_t *Out = DestinationRow + X * 4;
+            for (int Lane = 0; Lane < 4; Lane++)
+            {
+                Out[Lane * 4 + 0] = MEncodeTable[BlueIndex[Lane]];
+                Out[Lane * 4 + 1] = MEncodeTable[GreenIndex[Lane]];
+                Out[Lane * 4 + 2] = MEncodeTable[RedIndex[Lane]];
+                Out[Lane * 4 + 3] = (uint8_t)AlphaValue[Lane];
+            }
+        }
+
+        if (X < Source.Width)
+        {
+            SImageView Tail = Source;
+            Tail.Data = reinterpret_cast<const uint8_t *>(SourceRow + X * 4);
+            Tail.Width = Source.Width - X;
+            Tail.Height = 1;
+            ToneMapToBGRA8Reference(Tail, DestinationRow + X * 4, DestinationStride);
+        }
+    }
+}
+
+void CToneMapper::ToneMapToGray8(const SImageView &Source, uint8_t *Destination, int DestinationStride) const
+{
+    const float ScaleValue = (float)(EncodeTableSize - 1);
+    const __m128 Exposure = _mm_set1_ps(MSettings.Exposure);
+    const __m128 White = _mm_set1_ps(MSettings.WhitePoint);
+    const __m128 WhiteSquared = _mm_set1_ps(MWhiteSquared);
+    const __m128 Scale = _mm_set1_ps(ScaleValue);
+    const __m128i RedGreenWeights = _mm_set1_epi32((LumaWeightGreen << 16) | LumaWeightRed);
+    const __m128i BlueWeights = _mm_set1_epi32(LumaWeightBlue);
+    const __m128i Rounding = _mm_set1_epi32(2048);
+
+    alignas(16) int32_t LumaIndices[4];
+
+    for (int Y = 0; Y < Source.Height; Y++)
+    {
+        const uint16_t *SourceRow = reinterpret_cast<const uint16_t *>(Source.Row(Y));
+        uint8_t *DestinationRow = Destination + (size_t)Y * (size_t)DestinationStride;
+
+        int X = 0;
+        for (; X + 4 <= Source.Width; X += 4)
+        {
+            __m128 Red, Green, Blue, Alpha;
+            LoadPixels4(SourceRow + X * 4, Red, Green, Blue, Alpha);
+
+            const __m128i RedIndex = ToneMapIndex4(Red, Exposure, White, WhiteSquared, Scale);
+            const __m128i GreenIndex = ToneMapIndex4(Green, Exposure, White, WhiteSquared, Scale);
+            const __m128i BlueIndex = ToneMapIndex4(Blue, Exposure, White, WhiteSquared, Scale);
+
+            // Indices are < 4096, so red/green pack into one 16-bit pair per lane for madd.
+            const __m128i RedGreen = _mm_or_si128(RedIndex, _mm_slli_epi32(GreenIndex, 16));
+            __m128i Luma = _mm_add_epi32(_mm_madd_epi16(RedGreen, RedGreenWeights), _mm_madd_epi16(BlueIndex, BlueWeights));
+            Luma = _mm_srai_epi32(_mm_add_epi32(Luma, Rounding), 12);
+            _mm_store_si128(reinterpret_cast<__m128i *>(LumaIndices), Luma);
+
+            for (int Lane = 0; Lane < 4; Lane++)
+            {
+                DestinationRow[X + Lane] = MEncodeTable[LumaIndices[Lane]];
+            }
+        }
+
+        if (X < Source.Width)
+        {
+            SImageView Tail = Source;
+            Tail.Data = reinterpret_cast<const uint8_t *>(SourceRow + X * 4);
+            Tail.Width = Source.Width - X;
+            Tail.Height = 1;
+            ToneMapToGray8Reference(Tail, DestinationRow + X, DestinationStride);
+        }
+    }
+}
+
+void ConvertBGRA8ToGray8(const SImageView &Source, uint8_t *Destination, int DestinationStride)
+{
+    const __m128i Weights = _mm_setr_epi16(29, 150, 77, 0, 29, 150, 77, 0);
+    const __m128i Rounding = _mm_set1_epi32(128);
+    const __m128i Zero = _mm_setzero_si128();
+
+    for (int Y = 0; Y < Source.Height; Y++)
+    {
+        const uint8_t *SourceRow = Source.Row(Y);
+        uint8_t *DestinationRow = Destination + (size_t)Y * (size_t)DestinationStride;
+
+        int X = 0;
+        for (; X + 8 <= Source.Width; X += 8)
+        {
+            __m128i Sums[2];
+            for (int Half = 0; Half < 2; Half++)
+            {
+                const __m128i Pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(SourceRow + (X + Half * 4) * 4));
+                // Each madd lane holds B*29 + G*150 or R*77 + A*0 for one pixel.
+                const __m128 Low = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpacklo_epi8(Pixels, Zero), Weights));
+                const __m128 High = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpackhi_epi8(Pixels, Zero), Weights));
+                const __m128i Even = _mm_castps_si128(_mm_shuffle_ps(Low, High, _MM_SHUFFLE(2, 0, 2, 0)));
+                const __m128i Odd = _mm_castps_si128(_mm_shuffle_ps(Low, High, _MM_SHUFFLE(3, 1, 3, 1)));
+                Sums[Half] = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(Even, Odd), Rounding), 8);
+            }
+
+            const __m128i Packed = _mm_packs_epi32(Sums[0], Sums[1]);
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(DestinationRow + X), _mm_packus_epi16(Packed, Packed));
+        }
+
+        if (X < Source.Width)
+        {
+            SImageView Tail = Source;
+            Tail.Data = SourceRow + X * 4;
+            Tail.Width = Source.Width - X;
+            Tail.Height = 1;
+            ConvertBGRA8ToGray8Reference(Tail, DestinationRow + X, DestinationStride);
+        }
+    }
+}
+
+#else
+
+void CToneMapper::ToneMapToBGRA8(const SImageView &Source, uint8_t *Destination, int DestinationStride) const
+{
+    ToneMapToBGRA8Reference(Source, Destination, DestinationStride);
+}
+
+void CToneMapper::ToneMapToGray8(const SImageView &Source, uint8_t *Destination, int DestinationStride) const
+{
+    ToneMapToGray8Reference(Source, Destination, DestinationStride);
+}
+
+void ConvertBGRA8ToGray8(const SImageView &Source, uint8_t *Destination, int DestinationStride)
+{
+    ConvertBGRA8ToGray8Reference(Source, Destination, DestinationStride);
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef TAPI_TONE_MAPPER_H
+#define TAPI_TONE_MAPPER_H
+
+#include "Imaging/ImageView.h"
+
+#include <cstdint>
+
+struct SToneMapSettings
+{
+    float Exposure = 1.0f;    // Linear scale applied before tone mapping
+    float WhitePoint = 4.0f;  // Scene value that maps to full white (1.0 = SDR white in scRGB)
+};
+
+// Converts scRGB FP16 frames (R16G16B16A16Float) to 8-bit sRGB using an extended
+// Reinhard curve. The vectorized kernels and the scalar reference kernels perform the
+// same float operations in the same order, so their output is bit-identical.
+class CToneMapper
+{
+public:
+    CToneMapper();
+
+    void Configure(const SToneMapSettings &Settings);
+    const SToneMapSettings &GetSettings() const { return MSettings; }
+
+    void ToneMapToBGRA8(const SImageView &Source, uint8_t *Destination, int DestinationStride) const;
+    void ToneMapToGray8(const SImageView &Source, uint8_t *Destination, int DestinationStride) const;
+
+    void ToneMapToBGRA8Reference(const SImageView &Source, uint8_t *Destination, int DestinationStride) const;
+    void ToneMapToGray8Reference(const SImageView &Source, uint8_t *Destination, int DestinationStride) const;
+
+private:
+    float ToneMapChannel(float Value) const;
+
+    static constexpr int EncodeTableSize = 4096;
+
+    SToneMapSettings MSettings;
+    float MWhiteSquared = 0.0f;
+    uint8_t MEncodeTable[EncodeTableSize];
+};
+
+float HalfToFloat(uint16_t Half);
+
+// BGRA8 -> Gray8 with BT.601 integer weights: (77 R + 150 G + 29 B + 128) >> 8.
+void ConvertBGRA8ToGray8(const SImageView &Source, uint8_t *Destination, int DestinationStride);
+void ConvertBGRA8ToGray8Reference(const SImageView &Source, uint8_t *Destination, int DestinationStride);
+
+#endif
@@ -0,0 +1,591 @@
+#include "FrameCodec.h"
+#include "Core/ByteIO.h"
+#include "Core/Simd.h"
+
+#include <atomic>
+#include <cstring>
+
+static const uint32_t FrameMagic = 0x43465853;  // "SXFC"
+static const uint8_t FrameVersion = 1;
+static const uint8_t FlagKeyframe = 0x01;
+static const size_t FrameHeaderSize = 16;
+
+static const int MinTileSize = 8;
+static const int MaxTileSize = 256;
+
+// Tile ops. INDEX, DIFF and LUMA follow QOI; the run ops take over QOI's run range.
+static const uint8_t OpIndex = 0x00;        // 00iiiiii: colour cache slot
+static const uint8_t OpDiff = 0x40;         // 01rrggbb: channel deltas in [-2, 1]
+static const uint8_t OpLuma = 0x80;         // 10gggggg rrrrbbbb: green delta, red/blue relative to it
+static const uint8_t OpRun = 0xC0;          // 11llllll: repeat the last pixel 1..ShortRunLimit times
+static const uint8_t OpLongRun = 0xFA;      // + varint: repeat the last pixel
+static const uint8_t OpTemporalRun = 0xFB;  // + varint: keep the previous frame's pixels
+static const uint8_t OpBGR = 0xFE;          // + B, G, R: alpha unchanged
+static const uint8_t OpBGRA = 0xFF;         // + B, G, R, A
+
+static const int ShortRunLimit = OpLongRun - OpRun;
+static const size_t MaxBytesPerPixel = 5;
+static const uint32_t InitialPixel = 0xFF000000u;  // Opaque black
+
+static inline int PixelB(uint32_t Pixel) { return (int)(Pixel & 0xFF); }
+static inline int PixelG(uint32_t Pixel) { return (int)((Pixel >> 8) & 0xFF); }
+static inline int PixelR(uint32_t Pixel) { return (int)((Pixel >> 16) & 0xFF); }
+static inline int PixelA(uint32_t Pixel) { return (int)(Pixel >> 24); }
+
+static inline uint32_t MakePixel(int B, int G, int R, int A)
+{
+    return (uint32_t)(B & 0xFF) | ((uint32_t)(G & 0xFF) << 8) | ((uint32_t)(R & 0xFF) << 16) | ((uint32_t)(A & 0xFF) << 24);
+}
+
+static inline int ColourHash(uint32_t Pixel)
+{
+    return (PixelR(Pixel) * 3 + PixelG(Pixel) * 5 + PixelB(Pixel) * 7 + PixelA(Pixel) * 11) & 63;
+}
+
+static inline uint8_t *WriteVarint(uint8_t *Out, uint32_t Value)
+{
+    while (Value >= 0x80)
+    {
+        *Out++ = (uint8_t)(Value | 0x80);
+        Value >>= 7;
+    }
+    *Out++ = (uint8_t)Value;
+    return Out;
+}
+
+static inline bool ReadVarint(const uint8_t *&In, const uint8_t *End, uint32_t &OutValue)
+{
+    uint32_t Value = 0;
+    for (int Shift = 0; Shift < 32; Shift += 7)
+    {
+        if (In >= End) return false;
+        uint8_t Byte = *In++;
+        Value |= (uint32_t)(Byte & 0x7F) << Shift;
+        if (!(Byte & 0x80))
+        {
+            OutValue = Value;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Number of leading pixels where A and B agree
+static inline int MatchLength(const uint32_t *A, const uint32_t *B, int Count)
+{
+    int Index = 0;
+#ifdef SPYX_SSE2
+    for (; Index + 4 <= Count; Index += 4)
+    {
+        __m128i VectorA = _mm_loadu_si128((const __m128i *)(A + Index));
+        __m128i VectorB = _mm_loadu_si128((const __m128i *)(B + Index));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(VectorA, VectorB)) != 0xFFFF) break;
+    }
+#endif
+    while (Index < Count && A[Index] == B[Index]) Index++;
+    return Index;
+}
+
+// Number of leading pixels equal to Value
+static inline int RunLength(const uint32_t *Pixels, uint32_t Value, int Count)
+{
+    int Index = 0;
+#ifdef SPYX_SSE2
+    __m128i Broadcast = _mm_set1_epi32((int)Value);
+    for (; Index + 4 <= Count; Index += 4)
+    {
+        __m128i Vector = _mm_loadu_si128((const __m128i *)(Pixels + Index));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(Vector, Broadcast)) != 0xFFFF) break;
+    }
+#endif
+    while (Index < Count && Pixels[Index] == Value) Index++;
+    return Index;
+}
+
+static inline uint8_t *WriteRun(uint8_t *Out, int Length)
+{
+    if (Length <= ShortRunLimit)
+    {
+        *Out++ = (uint8_t)(OpRun + Length - 1);
+        return Out;
+    }
+    *Out++ = OpLongRun;
+    return WriteVarint(Out, (uint32_t)Length);
+}
+
+static inline uint8_t *WriteLiteral(uint8_t *Out, uint32_t Pixel, uint32_t Last)
+{
+    if (PixelA(Pixel) == PixelA(Last))
+    {
+        *Out++ = OpBGR;
+    }
+    else
+    {
+        *Out++ = OpBGRA;
+    }
+    *Out++ = (uint8_t)PixelB(Pixel);
+    *Out++ = (uint8_t)PixelG(Pixel);
+    *Out++ = (uint8_t)PixelR(Pixel);
+    if (PixelA(Pixel) != PixelA(Last)) *Out++ = (uint8_t)PixelA(Pixel);
+    return Out;
+}
+
+// Codes Count pixels of a gathered tile. Previous is null for keyframes.
+static size_t EncodeTilePixels(const uint32_t *Current, const uint32_t *Previous, int Count, uint8_t *Out)
+{
+    uint8_t *Start = Out;
+    uint32_t Cache[64] = {};
+    uint32_t Last = InitialPixel;
+
+    int Position = 0;
+    while (Position < Count)
+    {
+        uint32_t Pixel = Current[Position];
+        int Remaining = Count - Position;
+
+        int Temporal = Previous ? MatchLength(Current + Position, Previous + Position, Remaining) : 0;
+        int Repeat = Pixel == Last ? RunLength(Current + Position, Last, Remaining) : 0;
+
+        if (Temporal >= 2 && Temporal >= Repeat)
+        {
+            *Out++ = OpTemporalRun;
+            Out = WriteVarint(Out, (uint32_t)Temporal);
+            Position += Temporal;
+            Last = Current[Position - 1];
+            continue;
+        }
+
+        if (Repeat > 0)
+        {
+            Out = WriteRun(Out, Repeat);
+            Position += Repeat;
+            continue;
+        }
+
+        int Hash = ColourHash(Pixel);
+        if (Cache[Hash] == Pixel)
+        {
+            *Out++ = (uint8_t)(OpIndex | Hash);
+        }
+        else
+        {
+            int DeltaB = PixelB(Pixel) - PixelB(Last);
+            int DeltaG = PixelG(Pixel) - PixelG(Last);
+            int DeltaR = PixelR(Pixel) - PixelR(Last);
+            // Deltas wrap modulo 256, as in QOI
+            DeltaB = (int8_t)(uint8_t)DeltaB;
+            DeltaG = (int8_t)(uint8_t)DeltaG;
+            DeltaR = (int8_t)(uint8_t)DeltaR;
+            int DeltaRG = DeltaR - DeltaG;
+            int DeltaBG = DeltaB - DeltaG;
+
+            if (PixelA(Pixel) != PixelA(Last))
+            {
+                if (Temporal == 1)
+                {
+                    *Out++ = OpTemporalRun;
+                    *Out++ = 1;
+                    Position++;
+                    Last = Pixel;
+                    continue;
+                }
+                Out = WriteLiteral(Out, Pixel, Last);
+            }
+            else if (DeltaR >= -2 && DeltaR <= 1 && DeltaG >= -2 && DeltaG <= 1 && DeltaB >= -2 && DeltaB <= 1)
+            {
+                *Out++ = (uint8_t)(OpDiff | ((DeltaR + 2) << 4) | ((DeltaG + 2) << 2) | (DeltaB + 2));
+            }
+            else if (DeltaG >= -32 && DeltaG <= 31 && DeltaRG >= -8 && DeltaRG <= 7 && DeltaBG >= -8 && DeltaBG <= 7)
+            {
+                *Out++ = (uint8_t)(OpLuma | (DeltaG + 32));
+                *Out++ = (uint8_t)(((DeltaRG + 8) << 4) | (DeltaBG + 8));
+            }
+            else if (Temporal == 1)
+            {
+                // Two bytes beat a four byte literal; the cache is left untouched
+                *Out++ = OpTemporalRun;
+                *Out++ = 1;
+                Position++;
+                Last = Pixel;
+                continue;
+            }
+            else
+            {
+                Out = WriteLiteral(Out, Pixel, Last);
+            }
+            Cache[Hash] = Pixel;
+        }
+
+        Last = Pixel;
+        Position++;
+    }
+
+    return (size_t)(Out - Start);
+}
+
+// Decodes into Pixels, which holds the previous frame's tile for delta frames
+static bool DecodeTilePixels(const uint8_t *In, size_t Size, uint32_t *Pixels, int Count, bool HasPrevious)
+{
+    const uint8_t *End = In + Size;
+    uint32_t Cache[64] = {};
+    uint32_t Last = InitialPixel;
+
+    int Position = 0;
+    while (Position < Count)
+    {
+        if (In >= End) return false;
+        uint8_t Op = *In++;
+
+        if (Op == OpTemporalRun || Op == OpLongRun || (Op >= OpRun && Op < OpLongRun))
+        {
+            uint32_t Length;
+            if (Op >= OpRun && Op < OpLongRun)
+            {
+                Length = (uint32_t)(Op - OpRun) + 1;
+            }
+            else if (!ReadVarint(In, End, Length))
+            {
+                return false;
+            }
+            if (Length == 0 || Length > (uint32_t)(Count - Position)) return false;
+
+            if (Op == OpTemporalRun)
+            {
+                if (!HasPrevious) return false;
+                Position += (int)Length;
+                Last = Pixels[Position - 1];
+            }
+            else
+            {
+                for (uint32_t Index = 0; Index < Length; Index++) Pixels[Position++] = Last;
+            }
+            continue;
+        }
+
+        uint32_t Pixel;
+        if (Op == OpBGR || Op == OpBGRA)
+        {
+            size_t Needed = Op == OpBGRA ? 4 : 3;
+            if ((size_t)(End - In) < Needed) return false;
+            int Alpha = Op == OpBGRA ? In[3] : PixelA(Last);
+            Pixel = MakePixel(In[0], In[1], In[2], Alpha);
+            In += Needed;
+        }
+        else if (Op < OpDiff)
+        {
+            Pixel = Cache[Op];
+            Pixels[Position++] = Pixel;
+            Last = Pixel;
+            continue;
+        }
+        else if (Op < OpLuma)
+        {
+            int DeltaR = ((Op >> 4) & 3) - 2;
+            int DeltaG = ((Op >> 2) & 3) - 2;
+            int DeltaB = (Op & 3) - 2;
+            Pixel = MakePixel(PixelB(Last) + DeltaB, PixelG(Last) + DeltaG, PixelR(Last) + DeltaR, PixelA(Last));
+        }
+        else if (Op < OpRun)
+        {
+            if (In >= End) return false;
+            int DeltaG = (Op & 63) - 32;
+            int DeltaRG = (*In >> 4) - 8;
+            int DeltaBG = (*In & 15) - 8;
+            In++;
+            Pixel = MakePixel(PixelB(Last) + DeltaG + DeltaBG, PixelG(Last) + DeltaG, PixelR(Last) + DeltaG + DeltaRG,
+                PixelA(Last));
+        }
+        else
+        {
+            return false;  // Reserved op
+        }
+
+        Cache[ColourHash(Pixel)] = Pixel;
+        Pixels[Position++] = Pixel;
+        Last = Pixel;
+    }
+
+    return In == End;
+}
+
+static bool TileEquals(const uint8_t *A, int StrideA, const uint8_t *B, int StrideB, int RowBytes, int Rows)
+{
+    for (int Row = 0; Row < Rows; Row++)
+    {
+        if (std::memcmp(A + (size_t)Row * StrideA, B + (size_t)Row * StrideB, RowBytes) != 0) return false;
+    }
+    return true;
+}
+
+static void GatherTile(const uint8_t *Source, int Stride, int RowBytes, int Rows, uint32_t *Out)
+{
+    for (int Row = 0; Row < Rows; Row++)
+    {
+        std::memcpy((uint8_t *)Out + (size_t)Row * RowBytes, Source + (size_t)Row * Stride, RowBytes);
+    }
+}
+
+static void ScatterTile(const uint32_t *Pixels, int RowBytes, int Rows, uint8_t *Destination, int Stride)
+{
+    for (int Row = 0; Row < Rows; Row++)
+    {
+        std::memcpy(Destination + (size_t)Row * Stride, (const uint8_t *)Pixels + (size_t)Row * RowBytes, RowBytes);
+    }
+}
+
+// Per-thread gather buffers sized for the largest tile
+static uint32_t *GetTileBuffer(int Slot)
+{
+    thread_local std::vector<uint32_t> Buffers[2];
+    std::vector<uint32_t> &Buffer = Buffers[Slot];
+    if (Buffer.size() < (size_t)MaxTileSize * MaxTileSize) Buffer.resize((size_t)MaxTileSize * MaxTileSize);
+    return Buffer.data();
+}
+
+size_t GetMaxEncodedTileSize(int PixelCount)
+{
+    return (size_t)PixelCount * MaxBytesPerPixel;
+}
+
+size_t EncodeTile(const uint32_t *Pixels, int PixelCount, uint8_t *Out)
+{
+    return EncodeTilePixels(Pixels, nullptr, PixelCount, Out);
+}
+
+bool DecodeTile(const uint8_t *Data, size_t Size, uint32_t *Pixels, int PixelCount)
+{
+    return DecodeTilePixels(Data, Size, Pixels, PixelCount, false);
+}
+
+CFrameEncoder::CFrameEncoder(const SFrameCodecSettings &Settings)
+    : MSettings(Settings)
+{
+    if (MSettings.TileSize < MinTileSize) MSettings.TileSize = MinTileSize;
+    if (MSettings.TileSize > MaxTileSize) MSettings.TileSize = MaxTileSize;
+    if (MSettings.KeyframeInterval < 0) MSettings.KeyframeInterval = 0;
+
+    MPool = std::make_unique<CThreadPool>(MSettings.ThreadCount);
+}
+
+void CFrameEncoder::Reset()
+{
+    MHasReference = false;
+    MFramesSinceKeyframe = 0;
+}
+
+bool CFrameEncoder::Encode(const SImageView &Frame, std::vector<uint8_t> &Output, SEncodedFrameInfo *OutInfo,
+    bool ForceKeyframe)
+{
+    if (!Frame.IsValid() || Frame.Format != EPixelFormat::BGRA8) return false;
+
+    SFrameCodecHeader Header;
+    Header.Width = Frame.Width;
+    Header.Height = Frame.Height;
+    Header.TileSize = MSettings.TileSize;
+
+    int TilesX = Header.GetTilesX();
+    int TileCount = Header.GetTileCount();
+    int TileSize = Header.TileSize;
+
+    bool SizeChanged = Frame.Width != MWidth || Frame.Height != MHeight;
+    bool IntervalReached = MSettings.KeyframeInterval > 0 && MFramesSinceKeyframe >= MSettings.KeyframeInterval;
+    Header.IsKeyframe = ForceKeyframe || !MHasReference || SizeChanged || IntervalReached;
+
+    size_t ReferenceStride = (size_t)Frame.Width * 4;
+    if (SizeChanged)
+    {
+        MWidth = Frame.Width;
+        MHeight = Frame.Height;
+        MReference.resize(ReferenceStride * Frame.Height);
+    }
+
+    size_t SlotSize = (size_t)TileSize * TileSize * MaxBytesPerPixel;
+    size_t ScratchSize = SlotSize * TileCount;
+    if (ScratchSize > MScratchSize)
+    {
+        MScratch.reset(new uint8_t[ScratchSize]);
+        MScratchSize = ScratchSize;
+    }
+    MTileBytes.assign(TileCount, 0);
+
+    bool IsKeyframe = Header.IsKeyframe;
+    std::atomic<int> ChangedTiles = 0;
+
+    MPool->ParallelFor(TileCount, [&](int Tile) {
+        int X0 = (Tile % TilesX) * TileSize;
+        int Y0 = (Tile / TilesX) * TileSize;
+        int Width = Frame.Width - X0 < TileSize ? Frame.Width - X0 : TileSize;
+        int Height = Frame.Height - Y0 < TileSize ? Frame.Height - Y0 : TileSize;
+        int RowBytes = Width * 4;
+
+        const uint8_t *Source = Frame.Row(Y0) + (size_t)X0 * 4;
+        uint8_t *Reference = MReference.data() + Y0 * ReferenceStride + (size_t)X0 * 4;
+
+        if (!IsKeyframe && TileEquals(Source, Frame.Stride, Reference, (int)ReferenceStride, RowBytes, Height))
+        {
+            return;
+        }
+
+        uint32_t *Current = GetTileBuffer(0);
+        uint32_t *Previous = nullptr;
+        GatherTile(Source, Frame.Stride, RowBytes, Height, Current);
+        if (!IsKeyframe)
+        {
+            Previous = GetTileBuffer(1);
+            GatherTile(Reference, (int)ReferenceStride, RowBytes, Height, Previous);
+        }
+
+        uint8_t *Slot = MScratch.get() + SlotSize * Tile;
+        MTileBytes[Tile] = (uint32_t)EncodeTilePixels(Current, Previous, Width * Height, Slot);
+
+        ScatterTile(Current, RowBytes, Height, Reference, (int)ReferenceStride);
+        ChangedTiles++;
+    });
+
+    size_t TotalSize = FrameHeaderSize + (size_t)TileCount * 4;
+    for (uint32_t Bytes : MTileBytes) TotalSize += Bytes;
+
+    Output.resize(TotalSize);
+    uint8_t *Out = Output.data();
+    WriteU32(Out, FrameMagic);
+    Out[4] = FrameVersion;
+    Out[5] = IsKeyframe ? FlagKeyframe : 0;
+    WriteU16(Out + 6, (uint32_t)TileSize);
+    WriteU32(Out + 8, (uint32_t)Frame.Width);
+    WriteU32(Out + 12, (uint32_t)Frame.Height);
+    Out += FrameHeaderSize;
+
+    for (int Tile = 0; Tile < TileCount; Tile++)
+    {
+        WriteU32(Out, MTileBytes[Tile]);
+        Out += 4;
+    }
+    for (int Tile = 0; Tile < TileCount; Tile++)
+    {
+        std::memcpy(Out, MScratch.get() + SlotSize * Tile, MTileBytes[Tile]);
+        Out += MTileBytes[Tile];
+    }
+
+    MHasReference = true;
+    MFramesSinceKeyframe = IsKeyframe ? 1 : MFramesSinceKeyframe + 1;
+
+    if (OutInfo)
+    {
+        OutInfo->IsKeyframe = IsKeyframe;
+        OutInfo->TileCount = TileCount;
+        OutInfo->ChangedTiles = ChangedTiles.load();
+        OutInfo->Size = TotalSize;
+    }
+    return true;
+}
+
+CFrameDecoder::CFrameDecoder(int ThreadCount)
+{
+    MPool = std::make_unique<CThreadPool>(ThreadCount);
+}
+
+void CFrameDecoder::Reset()
+{
+    MHasFrame = false;
+}
+
+bool CFrameDecoder::ParseHeader(const uint8_t *Data, size_t Size, SFrameCodecHeader &OutHeader)
+{
+    if (!Data || Size < FrameHeaderSize) return false;
+    if (ReadU32(Data) != FrameMagic || Data[4] != FrameVersion) return false;
+
+    SFrameCodecHeader Header;
+    Header.IsKeyframe = (Data[5] & FlagKeyframe) != 0;
+    Header.TileSize = (int)ReadU16(Data + 6);
+    uint32_t Width = ReadU32(Data + 8);
+    uint32_t Height = ReadU32(Data + 12);
+
+    if (Header.TileSize < MinTileSize || Header.TileSize > MaxTileSize) return false;
+    if (Width == 0 || Height == 0 || Width > 32768 || Height > 32768) return false;
+    Header.Width = (int)Width;
+    Header.Height = (int)Height;
+
+    OutHeader = Header;
+    return true;
+}
+
+bool CFrameDecoder::Decode(const uint8_t *Data, size_t Size)
+{
+    SFrameCodecHeader Header;
+    if (!ParseHeader(Data, Size, Header)) return false;
+
+    int TilesX = Header.GetTilesX();
+    int TileCount = Header.GetTileCount();
+    int TileSize = Header.TileSize;
+
+    size_t TableEnd = FrameHeaderSize + (size_t)TileCount * 4;
+    if (Size < TableEnd) return false;
+
+    bool SizeChanged = Header.Width != MWidth || Header.Height != MHeight;
+    if (!Header.IsKeyframe && (!MHasFrame || SizeChanged)) return false;
+
+    MTileOffsets.resize((size_t)TileCount + 1);
+    size_t Offset = TableEnd;
+    for (int Tile = 0; Tile < TileCount; Tile++)
+    {
+        uint32_t Bytes = ReadU32(Data + FrameHeaderSize + (size_t)Tile * 4);
+        if (Header.IsKeyframe && Bytes == 0) return false;
+        MTileOffsets[Tile] = Offset;
+        Offset += Bytes;
+        if (Offset > Size) return false;
+    }
+    MTileOffsets[TileCount] = Offset;
+    if (Offset != Size) return false;
+
+    size_t Stride = (size_t)Header.Width * 4;
+    if (SizeChanged)
+    {
+        MWidth = Header.Width;
+        MHeight = Header.Height;
+        MFrame.resize(Stride * Header.Height);
+    }
+
+    // A failed tile leaves the frame half updated, so it stops serving as a reference
+    MHasFrame = false;
+    std::atomic<bool> Failed = false;
+    bool IsKeyframe = Header.IsKeyframe;
+
+    MPool->ParallelFor(TileCount, [&](int Tile) {
+        size_t Bytes = MTileOffsets[Tile + 1] - MTileOffsets[Tile];
+        if (Bytes == 0 || Failed.load()) return;
+
+        int X0 = (Tile % TilesX) * TileSize;
+        int Y0 = (Tile / TilesX) * TileSize;
+        int Width = Header.Width - X0 < TileSize ? Header.Width - X0 : TileSize;
+        int Height = Header.Height - Y0 < TileSize ? Header.Height - Y0 : TileSize;
+        int RowBytes = Width * 4;
+        uint8_t *Destination = MFrame.data() + Y0 * Stride + (size_t)X0 * 4;
+
+        uint32_t *Pixels = GetTileBuffer(0);
+        if (!IsKeyframe) GatherTile(Destination, (int)Stride, RowBytes, Height, Pixels);
+
+        if (!DecodeTilePixels(Data + MTileOffsets[Tile], Bytes, Pixels, Width * Height, !IsKeyframe))
+        {
+            Failed = true;
+            return;
+        }
+        ScatterTile(Pixels, RowBytes, Height, Destination, (int)Stride);
+    });
+
+    if (Failed) return false;
+    MHasFrame = true;
+    return true;
+}
+
+SImageView CFrameDecoder::GetFrame() const
+{
+    SImageView View = {};
+    if (!MHasFrame) return View;
+
+    View.Data = MFrame.data();
+    View.Width = MWidth;
+    View.Height = MHeight;
+    View.Stride = MWidth * 4;
+    View.Format = EPixelFormat::BGRA8;
+    return View;
+}
@@ -0,0 +1,112 @@
+#ifndef TAPI_FRAME_CODEC_H
+#define TAPI_FRAME_CODEC_H
+
+#include "Core/ThreadPool.h"
+#include "Imaging/ImageView.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Lossless codec for BGRA8 screen content. A frame is split into square tiles that
+// are coded independently, so tiles encode and decode in parallel. In a delta frame an
+// unchanged tile costs nothing and changed tiles can copy runs of pixels from the
+// previous frame. Pixels that do change are coded with QOI-style byte ops (colour
+// cache, small deltas, runs, literals).
+//
+// Frame layout, little endian:
+//   uint32 Magic 'SXFC', uint8 Version, uint8 Flags, uint16 TileSize,
+//   uint32 Width, uint32 Height, uint32 TileBytes[TileCount], tile payloads.
+// A tile payload of zero bytes means "same as the previous frame".
+
+struct SFrameCodecSettings
+{
+    int TileSize = 64;            // Tile edge in pixels, clamped to [8, 256]
+    int KeyframeInterval = 300;   // Frames between forced keyframes, 0 = only when needed
+    int ThreadCount = 0;          // Encoder threads, 0 = hardware concurrency
+};
+
+struct SFrameCodecHeader
+{
+    int Width = 0;
+    int Height = 0;
+    int TileSize = 0;
+    bool IsKeyframe = false;
+
+    int GetTilesX() const { return (Width + TileSize - 1) / TileSize; }
+    int GetTilesY() const { return (Height + TileSize - 1) / TileSize; }
+    int GetTileCount() const { return GetTilesX() * GetTilesY(); }
+};
+
+struct SEncodedFrameInfo
+{
+    bool IsKeyframe = false;
+    int TileCount = 0;
+    int ChangedTiles = 0;
+    size_t Size = 0;
+};
+
+// Single tiles coded without a reference frame, for stores that keep tiles on their own.
+// Pixels are BGRA8 values, row-major without padding.
+size_t GetMaxEncodedTileSize(int PixelCount);
+size_t EncodeTile(const uint32_t *Pixels, int PixelCount, uint8_t *Out);
+bool DecodeTile(const uint8_t *Data, size_t Size, uint32_t *Pixels, int PixelCount);
+
+class CFrameEncoder
+{
+public:
+    explicit CFrameEncoder(const SFrameCodecSettings &Settings = SFrameCodecSettings());
+
+    // Drops the reference frame; the next frame is encoded as a keyframe
+    void Reset();
+
+    // Replaces Output with the encoded frame. Only BGRA8 frames are accepted.
+    bool Encode(const SImageView &Frame, std::vector<uint8_t> &Output, SEncodedFrameInfo *OutInfo = nullptr,
+        bool ForceKeyframe = false);
+
+    const SFrameCodecSettings &GetSettings() const { return MSettings; }
+
+private:
+    SFrameCodecSettings MSettings;
+    std::unique_ptr<CThreadPool> MPool;
+
+    int MWidth = 0;
+    int MHeight = 0;
+    int MFramesSinceKeyframe = 0;
+    bool MHasReference = false;
+    std::vector<uint8_t> MReference;  // Previous frame, tightly packed
+
+    std::unique_ptr<uint8_t[]> MScratch;  // One worst-case slot per tile
+    size_t MScratchSize = 0;
+    std::vector<uint32_t> MTileBytes;
+};
+
+class CFrameDecoder
+{
+public:
+    explicit CFrameDecoder(int ThreadCount = 0);
+
+    void Reset();
+
+    // Decodes a frame produced by CFrameEncoder. Delta frames need the frame before
+    // them to have been decoded by this decoder. Malformed input returns false.
+    bool Decode(const uint8_t *Data, size_t Size);
+
+    // The most recently decoded frame, valid until the next Decode or Reset
+    SImageView GetFrame() const;
+    bool HasFrame() const { return MHasFrame; }
+
+    static bool ParseHeader(const uint8_t *Data, size_t Size, SFrameCodecHeader &OutHeader);
+
+private:
+    std::unique_ptr<CThreadPool> MPool;
+
+    int MWidth = 0;
+    int MHeight = 0;
+    bool MHasFrame = false;
+    std::vector<uint8_t> MFrame;
+    std::vector<size_t> MTileOffsets;
+};
+
+#endif
@@ -0,0 +1,422 @@
+#include "FrameHistory.h"
+#include "Recording/FrameCodec.h"
+
+#include <atomic>
+#include <cstring>
+
+static const int MinTileSize = 8;
+static const int MaxTileSize = 256;
+
+// Rough per-object bookkeeping cost on top of payload bytes
+static const size_t TileOverhead = 96;
+static const size_t GridOverhead = 64;
+static const size_t FrameOverhead = 24;
+
+struct STileHash
+{
+    uint64_t Low;
+    uint64_t High;
+};
+
+static inline uint64_t RotateLeft(uint64_t Value, int Shift)
+{
+    return (Value << Shift) | (Value >> (64 - Shift));
+}
+
+static inline uint64_t Avalanche(uint64_t Value)
+{
+    Value ^= Value >> 33;
+    Value *= 0xFF51AFD7ED558CCDull;
+    Value ^= Value >> 33;
+    Value *= 0xC4CEB9FE1A85EC53ull;
+    Value ^= Value >> 33;
+    return Value;
+}
+
+// Two independent 64-bit lanes. Tiles are matched on all 128 bits without comparing
+// pixels, which makes a false match practically impossible.
+static STileHash HashTile(const uint8_t *Source, int Stride, int RowBytes, int Rows)
+{
+    uint64_t Low = 0x9E3779B97F4A7C15ull ^ (uint64_t)RowBytes;
+    uint64_t High = 0xC2B2AE3D27D4EB4Full ^ ((uint64_t)Rows << 32);
+
+    for (int Row = 0; Row < Rows; Row++)
+    {
+        const uint8_t *Line = Source + (size_t)Row * Stride;
+        int Offset = 0;
+        for (; Offset + 8 <= RowBytes; Offset += 8)
+        {
+            uint64_t Word;
+            std::memcpy(&Word, Line + Offset, sizeof(Word));
+            Low = RotateLeft(Low ^ (Word * 0x87C37B91114253D5ull), 31) * 0x4CF5AD432745937Full;
+            High = RotateLeft(High + (Word * 0x52DCE729ull), 27) * 0x9E3779B97F4A7C15ull;
+        }
+        for (; Offset < RowBytes; Offset++)
+        {
+            Low = (Low ^ Line[Offset]) * 0x100000001B3ull;
+            High = (High + Line[Offset]) * 0x87C37B91114253D5ull;
+        }
+    }
+
+    return { Avalanche(Low), Avalanche(High ^ Low) };
+}
+
+static uint32_t *GetTileScratch()
+{
+    thread_local std::vector<uint32_t> Pixels;
+    if (Pixels.size() < (size_t)MaxTileSize * MaxTileSize) Pixels.resize((size_t)MaxTileSize * MaxTileSize);
+    return Pixels.data();
+}
+
+static uint8_t *GetEncodeScratch()
+{
+    thread_local std::vector<uint8_t> Bytes;
+    size_t Size = GetMaxEncodedTileSize(MaxTileSize * MaxTileSize);
+    if (Bytes.size() < Size) Bytes.resize(Size);
+    return Bytes.data();
+}
+
+CFrameHistory::CFrameHistory(const SFrameHistorySettings &Settings)
+    : MSettings(Settings)
+{
+    if (MSettings.TileSize < MinTileSize) MSettings.TileSize = MinTileSize;
+    if (MSettings.TileSize > MaxTileSize) MSettings.TileSize = MaxTileSize;
+
+    MPool = std::make_unique<CThreadPool>(MSettings.ThreadCount);
+}
+
+uint32_t CFrameHistory::AllocateTile()
+{
+    if (!MFreeTiles.empty())
+    {
+        uint32_t Id = MFreeTiles.back();
+        MFreeTiles.pop_back();
+        return Id;
+    }
+    MTiles.emplace_back();
+    return (uint32_t)(MTiles.size() - 1);
+}
+
+uint32_t CFrameHistory::AllocateGrid()
+{
+    if (!MFreeGrids.empty())
+    {
+        uint32_t Id = MFreeGrids.back();
+        MFreeGrids.pop_back();
+        return Id;
+    }
+    MGrids.emplace_back();
+    return (uint32_t)(MGrids.size() - 1);
+}
+
+void CFrameHistory::ReleaseTile(uint32_t Id)
+{
+    STile &Tile = MTiles[Id];
+    if (--Tile.RefCount > 0) return;
+
+    auto Found = MTileLookup.find(Tile.HashLow);
+    if (Found != MTileLookup.end() && Found->second == Id) MTileLookup.erase(Found);
+    MBytesUsed -= Tile.Data.size() + TileOverhead;
+    std::vector<uint8_t>().swap(Tile.Data);
+    MFreeTiles.push_back(Id);
+    MTileCount--;
+}
+
+void CFrameHistory::ReleaseGrid(uint32_t Id)
+{
+    SGrid &Grid = MGrids[Id];
+    if (--Grid.RefCount > 0) return;
+
+    for (uint32_t Tile : Grid.Tiles) ReleaseTile(Tile);
+    MBytesUsed -= Grid.Tiles.size() * sizeof(uint32_t) + GridOverhead;
+    std::vector<uint32_t>().swap(Grid.Tiles);
+    MFreeGrids.push_back(Id);
+    MGridCount--;
+}
+
+void CFrameHistory::EvictOldestFrame()
+{
+    uint32_t Grid = MFrames.front().Grid;
+    MFrames.pop_front();
+    MFirstId++;
+    MBytesUsed -= FrameOverhead;
+    ReleaseGrid(Grid);
+}
+
+bool CFrameHistory::AddFrame(const SImageView &Frame, int64_t Timestamp, uint64_t Sequence)
+{
+    if (!Frame.IsValid() || Frame.Format != EPixelFormat::BGRA8) return false;
+
+    std::lock_guard<std::mutex> AddLock(MAddMutex);
+
+    {
+        std::lock_guard<std::mutex> Lock(MMutex);
+        if (!MFrames.empty() && Timestamp < MFrames.back().Timestamp) return false;
+    }
+
+    int TileSize = MSettings.TileSize;
+    int TilesX = (Frame.Width + TileSize - 1) / TileSize;
+    int TilesY = (Frame.Height + TileSize - 1) / TileSize;
+    int TileCount = TilesX * TilesY;
+
+    size_t PreviousStride = (size_t)Frame.Width * 4;
+    bool SameSize = MPreviousGrid != NoId && Frame.Width == MPreviousWidth && Frame.Height == MPreviousHeight;
+    if (!SameSize)
+    {
+        MPrevious.resize(PreviousStride * Frame.Height);
+        MPreviousWidth = Frame.Width;
+        MPreviousHeight = Frame.Height;
+    }
+
+    // Pass 1: find changed tiles and hash them
+    std::vector<uint32_t> Ids(TileCount, NoId);
+    std::vector<STileHash> Hashes(TileCount);
+    const std::vector<uint32_t> *PreviousTiles = SameSize ? &MGrids[MPreviousGrid].Tiles : nullptr;
+
+    MPool->ParallelFor(TileCount, [&](int Tile) {
+        int X0 = (Tile % TilesX) * TileSize;
+        int Y0 = (Tile / TilesX) * TileSize;
+        int RowBytes = (Frame.Width - X0 < TileSize ? Frame.Width - X0 : TileSize) * 4;
+        int Rows = Frame.Height - Y0 < TileSize ? Frame.Height - Y0 : TileSize;
+
+        const uint8_t *Source = Frame.Row(Y0) + (size_t)X0 * 4;
+        uint8_t *Previous = MPrevious.data() + Y0 * PreviousStride + (size_t)X0 * 4;
+
+        if (PreviousTiles)
+        {
+            bool Same = true;
+            for (int Row = 0; Row < Rows && Same; Row++)
+            {
+                Same = std::memcmp(Source + (size_t)Row * Frame.Stride, Previous + Row * PreviousStride, RowBytes) == 0;
+            }
+            if (Same)
+            {
+                Ids[Tile] = (*PreviousTiles)[Tile];
+                return;
+            }
+        }
+
+        Hashes[Tile] = HashTile(Source, Frame.Stride, RowBytes, Rows);
+        for (int Row = 0; Row < Rows; Row++)
+        {
+            std::memcpy(Previous + Row * PreviousStride, Source + (size_t)Row * Frame.Stride, RowBytes);
+        }
+    });
+
+    // Pass 2: resolve changed tiles against the store. Only this thread mutates the
+    // store, so lookups need no lock. Tiles repeated within the frame are encoded once.
+    bool Unchanged = PreviousTiles != nullptr;
+    std::vector<int> Missing;
+    std::vector<int> FirstOccurrence(TileCount, -1);
+    std::unordered_map<uint64_t, int> MissingLookup;
+    for (int Tile = 0; Tile < TileCount; Tile++)
+    {
+        if (Ids[Tile] != NoId) continue;
+        Unchanged = false;
+
+        auto Found = MTileLookup.find(Hashes[Tile].Low);
+        if (Found != MTileLookup.end() && MTiles[Found->second].HashHigh == Hashes[Tile].High)
+        {
+            Ids[Tile] = Found->second;
+            continue;
+        }
+
+        auto Pending = MissingLookup.find(Hashes[Tile].Low);
+        if (Pending != MissingLookup.end() && Hashes[Pending->second].High == Hashes[Tile].High)
+        {
+            FirstOccurrence[Tile] = Pending->second;
+            continue;
+        }
+        MissingLookup[Hashes[Tile].Low] = Tile;
+        Missing.push_back(Tile);
+    }
+
+    // Pass 3: encode new tiles
+    std::vector<std::vector<uint8_t>> Encoded(Missing.size());
+    MPool->ParallelFor((int)Missing.size(), [&](int Index) {
+        int Tile = Missing[Index];
+        int X0 = (Tile % TilesX) * TileSize;
+        int Y0 = (Tile / TilesX) * TileSize;
+        int Width = Frame.Width - X0 < TileSize ? Frame.Width - X0 : TileSize;
+        int Rows = Frame.Height - Y0 < TileSize ? Frame.Height - Y0 : TileSize;
+
+        uint32_t *Pixels = GetTileScratch();
+        for (int Row = 0; Row < Rows; Row++)
+        {
+            std::memcpy(Pixels + (size_t)Row * Width, Frame.Row(Y0 + Row) + (size_t)X0 * 4, (size_t)Width * 4);
+        }
+
+        uint8_t *Scratch = GetEncodeScratch();
+        size_t Size = EncodeTile(Pixels, Width * Rows, Scratch);
+        Encoded[Index].assign(Scratch, Scratch + Size);
+    });
+
+    // Pass 4: publish
+    std::lock_guard<std::mutex> Lock(MMutex);
+
+    for (size_t Index = 0; Index < Missing.size(); Index++)
+    {
+        int Tile = Missing[Index];
+        uint32_t Id = AllocateTile();
+        STile &Stored = MTiles[Id];
+        Stored.HashLow = Hashes[Tile].Low;
+        Stored.HashHigh = Hashes[Tile].High;
+        Stored.Data = std::move(Encoded[Index]);
+        Stored.RefCount = 0;
+        MBytesUsed += Stored.Data.size() + TileOverhead;
+        MTileCount++;
+
+        // A low-half collision keeps the older tile addressable
+        MTileLookup.emplace(Hashes[Tile].Low, Id);
+        Ids[Tile] = Id;
+    }
+
+    uint32_t GridId;
+    if (Unchanged)
+    {
+        GridId = MPreviousGrid;
+    }
+    else
+    {
+        GridId = AllocateGrid();
+        SGrid &Grid = MGrids[GridId];
+        Grid.Width = Frame.Width;
+        Grid.Height = Frame.Height;
+        Grid.Tiles.resize(TileCount);
+        for (int Tile = 0; Tile < TileCount; Tile++)
+        {
+            uint32_t Id = FirstOccurrence[Tile] >= 0 ? Ids[FirstOccurrence[Tile]] : Ids[Tile];
+            Grid.Tiles[Tile] = Id;
+            MTiles[Id].RefCount++;
+        }
+        Grid.RefCount = 0;
+        MBytesUsed += Grid.Tiles.size() * sizeof(uint32_t) + GridOverhead;
+        MGridCount++;
+    }
+
+    MGrids[GridId].RefCount++;
+    MFrames.push_back({ Timestamp, Sequence, GridId });
+    MBytesUsed += FrameOverhead;
+    MPreviousGrid = GridId;
+
+    // The newest frame always survives, it anchors the next comparison
+    while (MBytesUsed > MSettings.MaxBytes && MFrames.size() > 1) EvictOldestFrame();
+
+    return true;
+}
+
+bool CFrameHistory::FindFrame(int64_t Timestamp, uint64_t &OutId) const
+{
+    std::lock_guard<std::mutex> Lock(MMutex);
+
+    size_t Low = 0;
+    size_t High = MFrames.size();
+    while (Low < High)
+    {
+        size_t Middle = Low + (High - Low) / 2;
+        if (MFrames[Middle].Timestamp <= Timestamp)
+        {
+            Low = Middle + 1;
+        }
+        else
+        {
+            High = Middle;
+        }
+    }
+
+    if (Low == 0) return false;
+    OutId = MFirstId + (Low - 1);
+    return true;
+}
+
+size_t CFrameHistory::GetFrameCount() const
+{
+    std::lock_guard<std::mutex> Lock(MMutex);
+    return MFrames.size();
+}
+
+bool CFrameHistory::GetFrameInfo(uint64_t Id, int &OutWidth, int &OutHeight, int64_t &OutTimestamp,
+    uint64_t &OutSequence) const
+{
+    std::lock_guard<std::mutex> Lock(MMutex);
+    if (Id < MFirstId || Id - MFirstId >= MFrames.size()) return false;
+
+    const SFrame &Frame = MFrames[(size_t)(Id - MFirstId)];
+    OutWidth = MGrids[Frame.Grid].Width;
+    OutHeight = MGrids[Frame.Grid].Height;
+    OutTimestamp = Frame.Timestamp;
+    OutSequence = Frame.Sequence;
+    return true;
+}
+
+bool CFrameHistory::ReadFrame(uint64_t Id, uint8_t *Destination, int DestinationStride) const
+{
+    // Held for the whole reassembly so eviction cannot free tiles underneath it
+    std::lock_guard<std::mutex> Lock(MMutex);
+    if (Id < MFirstId || Id - MFirstId >= MFrames.size() || !Destination) return false;
+
+    const SGrid &Grid = MGrids[MFrames[(size_t)(Id - MFirstId)].Grid];
+    if (DestinationStride < Grid.Width * 4) return false;
+
+    int TileSize = MSettings.TileSize;
+    int TilesX = (Grid.Width + TileSize - 1) / TileSize;
+    std::atomic<bool> Failed = false;
+
+    MPool->ParallelFor((int)Grid.Tiles.size(), [&](int Tile) {
+        int X0 = (Tile % TilesX) * TileSize;
+        int Y0 = (Tile / TilesX) * TileSize;
+        int Width = Grid.Width - X0 < TileSize ? Grid.Width - X0 : TileSize;
+        int Rows = Grid.Height - Y0 < TileSize ? Grid.Height - Y0 : TileSize;
+
+        const STile &Stored = MTiles[Grid.Tiles[Tile]];
+        uint32_t *Pixels = GetTileScratch();
+        if (!DecodeTile(Stored.Data.data(), Stored.Data.size(), Pixels, Width * Rows))
+        {
+            Failed = true;
+            return;
+        }
+
+        uint8_t *Out = Destination + (size_t)Y0 * DestinationStride + (size_t)X0 * 4;
+        for (int Row = 0; Row < Rows; Row++)
+        {
+            std::memcpy(Out + (size_t)Row * DestinationStride, Pixels + (size_t)Row * Width, (size_t)Width * 4);
+        }
+    });
+
+    return !Failed;
+}
+
+SFrameHistoryStats CFrameHistory::GetStats() const
+{
+    std::lock_guard<std::mutex> Lock(MMutex);
+
+    SFrameHistoryStats Stats;
+    Stats.FrameCount = MFrames.size();
+    Stats.GridCount = MGridCount;
+    Stats.TileCount = MTileCount;
+    Stats.BytesUsed = MBytesUsed;
+    if (!MFrames.empty())
+    {
+        Stats.OldestTimestamp = MFrames.front().Timestamp;
+        Stats.NewestTimestamp = MFrames.back().Timestamp;
+    }
+    return Stats;
+}
+
+void CFrameHistory::Clear()
+{
+    std::lock_guard<std::mutex> AddLock(MAddMutex);
+    std::lock_guard<std::mutex> Lock(MMutex);
+
+    MFirstId += MFrames.size();
+    MFrames.clear();
+    MGrids.clear();
+    MFreeGrids.clear();
+    MTiles.clear();
+    MFreeTiles.clear();
+    MTileLookup.clear();
+    MBytesUsed = 0;
+    MGridCount = 0;
+    MTileCount = 0;
+    MPreviousGrid = NoId;
+}
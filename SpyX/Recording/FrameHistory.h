@@ -0,0 +1,116 @@
+#ifndef TAPI_FRAME_HISTORY_H
+#define TAPI_FRAME_HISTORY_H
+
+#include "Core/ThreadPool.h"
+#include "Imaging/ImageView.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+struct SFrameHistorySettings
+{
+    size_t MaxBytes = 256 << 20;  // Budget for tiles, grids and frame entries
+    int TileSize = 64;            // Tile edge in pixels, clamped to [8, 256]
+    int ThreadCount = 0;          // Hashing, encoding and reassembly threads, 0 = hardware concurrency
+};
+
+struct SFrameHistoryStats
+{
+    size_t FrameCount = 0;    // Frames that can be read back
+    size_t GridCount = 0;     // Distinct frame contents among them
+    size_t TileCount = 0;     // Distinct tiles among them
+    size_t BytesUsed = 0;
+    int64_t OldestTimestamp = 0;
+    int64_t NewestTimestamp = 0;
+};
+
+// Long-term frame history for mostly static content. Each frame is a grid of references
+// to content-addressed, individually compressed tiles, so a tile is stored once no
+// matter how many frames show it, and a frame identical to its predecessor costs one
+// small entry. Tiles and grids are reference counted; when the budget is exceeded the
+// oldest frames are dropped and whatever they alone referenced is freed.
+//
+// One thread adds frames while others may read; reads reassemble a frame in parallel.
+class CFrameHistory
+{
+public:
+    explicit CFrameHistory(const SFrameHistorySettings &Settings = SFrameHistorySettings());
+
+    // Only BGRA8 frames are accepted; timestamps must not decrease
+    bool AddFrame(const SImageView &Frame, int64_t Timestamp, uint64_t Sequence = 0);
+
+    // Id of the last frame at or before Timestamp; false if there is none. Ids grow by one
+    // per added frame and stay valid until the frame is evicted.
+    bool FindFrame(int64_t Timestamp, uint64_t &OutId) const;
+    size_t GetFrameCount() const;
+
+    bool GetFrameInfo(uint64_t Id, int &OutWidth, int &OutHeight, int64_t &OutTimestamp, uint64_t &OutSequence) const;
+
+    // Reassembles a frame as BGRA8 into Destination; false if it was evicted
+    bool ReadFrame(uint64_t Id, uint8_t *Destination, int DestinationStride) const;
+
+    SFrameHistoryStats GetStats() const;
+    void Clear();
+
+private:
+    struct STile
+    {
+        uint64_t HashLow = 0;
+        uint64_t HashHigh = 0;
+        std::vector<uint8_t> Data;
+        uint32_t RefCount = 0;
+    };
+
+    struct SGrid
+    {
+        int Width = 0;
+        int Height = 0;
+        std::vector<uint32_t> Tiles;
+        uint32_t RefCount = 0;
+    };
+
+    struct SFrame
+    {
+        int64_t Timestamp;
+        uint64_t Sequence;
+        uint32_t Grid;
+    };
+
+    static constexpr uint32_t NoId = UINT32_MAX;
+
+    uint32_t AllocateTile();
+    uint32_t AllocateGrid();
+    void ReleaseTile(uint32_t Id);
+    void ReleaseGrid(uint32_t Id);
+    void EvictOldestFrame();
+
+    SFrameHistorySettings MSettings;
+    std::unique_ptr<CThreadPool> MPool;
+
+    // Owned by the adding thread
+    std::mutex MAddMutex;
+    std::vector<uint8_t> MPrevious;  // Last added frame, tightly packed
+    int MPreviousWidth = 0;
+    int MPreviousHeight = 0;
+    uint32_t MPreviousGrid = NoId;
+
+    // Shared with readers
+    mutable std::mutex MMutex;
+    std::deque<SFrame> MFrames;
+    uint64_t MFirstId = 0;  // Id of MFrames.front()
+    std::vector<SGrid> MGrids;
+    std::vector<uint32_t> MFreeGrids;
+    std::vector<STile> MTiles;
+    std::vector<uint32_t> MFreeTiles;
+    std::unordered_map<uint64_t, uint32_t> MTileLookup;  // Low hash half -> tile
+    size_t MBytesUsed = 0;
+    size_t MGridCount = 0;
+    size_t MTileCount = 0;
+};
+
+#endif
@@ -0,0 +1,290 @@
+#include "RecordingFile.h"
+#include "Core/ByteIO.h"
+
+#include <cstring>
+
+static const uint32_t RecordingMagic = 0x46525853;  // "SXRF"
+static const uint16_t RecordingVersion = 1;
+static const size_t HeaderSize = 64;
+static const size_t RecordHeaderSize = 16;
+static const size_t IndexEntrySize = 32;
+static const uint32_t HeaderFinalized = 0x01;
+
+static std::FILE *OpenForWriting(const char *Path)
+{
+#ifdef _MSC_VER
+    std::FILE *File = nullptr;
+    if (fopen_s(&File, Path, "wb") != 0) return nullptr;
+    return File;
+#else
+    return std::fopen(Path, "wb");
+#endif
+}
+
+static void WriteIndexEntry(uint8_t *Out, const SRecordingIndexEntry &Entry)
+{
+    WriteU64(Out, (uint64_t)Entry.Timestamp);
+    WriteU64(Out + 8, Entry.Offset);
+    WriteU32(Out + 16, Entry.Size);
+    WriteU32(Out + 20, Entry.Flags);
+    WriteU32(Out + 24, Entry.KeyframeIndex);
+    WriteU32(Out + 28, 0);
+}
+
+static SRecordingIndexEntry ReadIndexEntry(const uint8_t *In)
+{
+    SRecordingIndexEntry Entry;
+    Entry.Timestamp = (int64_t)ReadU64(In);
+    Entry.Offset = ReadU64(In + 8);
+    Entry.Size = ReadU32(In + 16);
+    Entry.Flags = ReadU32(In + 20);
+    Entry.KeyframeIndex = ReadU32(In + 24);
+    return Entry;
+}
+
+CRecordingWriter::~CRecordingWriter()
+{
+    Close();
+}
+
+bool CRecordingWriter::Open(const char *Path, uint32_t Codec, size_t BufferSize)
+{
+    Close();
+
+    MFile = OpenForWriting(Path);
+    if (!MFile) return false;
+
+    // Writes go through MBuffer, stdio buffering would only add a copy
+    std::setvbuf(MFile, nullptr, _IONBF, 0);
+
+    MCodec = Codec;
+    MBuffer.resize(BufferSize < HeaderSize ? HeaderSize : BufferSize);
+    MBuffered = 0;
+    MOffset = 0;
+    MFailed = false;
+    MIndex.clear();
+
+    // Provisional header; a reader seeing it without the finalized flag rebuilds the index
+    uint8_t Header[HeaderSize];
+    WriteHeader(Header, false, 0);
+    return Write(Header, HeaderSize);
+}
+
+void CRecordingWriter::WriteHeader(uint8_t *Out, bool Finalized, uint64_t IndexOffset) const
+{
+    std::memset(Out, 0, HeaderSize);
+    WriteU32(Out, RecordingMagic);
+    WriteU16(Out + 4, RecordingVersion);
+    WriteU16(Out + 6, (uint32_t)HeaderSize);
+    WriteU32(Out + 8, MCodec);
+    WriteU32(Out + 12, Finalized ? HeaderFinalized : 0);
+    WriteU64(Out + 16, MIndex.size());
+    WriteU64(Out + 24, HeaderSize);
+    WriteU64(Out + 32, IndexOffset);
+}
+
+bool CRecordingWriter::AppendFrame(const uint8_t *Data, size_t Size, int64_t Timestamp, bool IsKeyframe)
+{
+    if (!MFile || MFailed || !Data || Size == 0 || Size > UINT32_MAX) return false;
+    if (MIndex.empty() && !IsKeyframe) return false;
+    if (!MIndex.empty() && Timestamp < MIndex.back().Timestamp) return false;
+
+    SRecordingIndexEntry Entry;
+    Entry.Timestamp = Timestamp;
+    Entry.Offset = MOffset + RecordHeaderSize;
+    Entry.Size = (uint32_t)Size;
+    Entry.Flags = IsKeyframe ? RecordingFrameKeyframe : 0;
+    Entry.KeyframeIndex = IsKeyframe ? (uint32_t)MIndex.size() : MIndex.back().KeyframeIndex;
+
+    uint8_t Record[RecordHeaderSize];
+    WriteU32(Record, Entry.Size);
+    WriteU32(Record + 4, Entry.Flags);
+    WriteU64(Record + 8, (uint64_t)Timestamp);
+
+    if (!Write(Record, RecordHeaderSize) || !Write(Data, Size)) return false;
+
+    MIndex.push_back(Entry);
+    return true;
+}
+
+bool CRecordingWriter::Close()
+{
+    if (!MFile) return false;
+
+    uint64_t IndexOffset = MOffset;
+    uint8_t Entry[IndexEntrySize];
+    for (const SRecordingIndexEntry &IndexEntry : MIndex)
+    {
+        WriteIndexEntry(Entry, IndexEntry);
+        if (!Write(Entry, IndexEntrySize)) break;
+    }
+
+    bool Success = Flush() && !MFailed;
+    if (Success)
+    {
+        uint8_t Header[HeaderSize];
+        WriteHeader(Header, true, IndexOffset);
+        Success = std::fseek(MFile, 0, SEEK_SET) == 0 && std::fwrite(Header, 1, HeaderSize, MFile) == HeaderSize;
+    }
+
+    if (std::fclose(MFile) != 0) Success = false;
+    MFile = nullptr;
+    MBuffer.clear();
+    MBuffer.shrink_to_fit();
+    MIndex.clear();
+    return Success;
+}
+
+bool CRecordingWriter::Write(const void *Data, size_t Size)
+{
+    if (MFailed) return false;
+
+    const uint8_t *Bytes = static_cast<const uint8_t *>(Data);
+    MOffset += Size;
+
+    if (MBuffered + Size <= MBuffer.size())
+    {
+        std::memcpy(MBuffer.data() + MBuffered, Bytes, Size);
+        MBuffered += Size;
+        return true;
+    }
+
+    if (!Flush()) return false;
+
+    // Large payloads skip the buffer
+    if (Size >= MBuffer.size())
+    {
+        if (std::fwrite(Bytes, 1, Size, MFile) != Size) MFailed = true;
+        return !MFailed;
+    }
+
+    std::memcpy(MBuffer.data(), Bytes, Size);
+    MBuffered = Size;
+    return true;
+}
+
+bool CRecordingWriter::Flush()
+{
+    if (MBuffered > 0 && !MFailed)
+    {
+        if (std::fwrite(MBuffer.data(), 1, MBuffered, MFile) != MBuffered) MFailed = true;
+    }
+    MBuffered = 0;
+    return !MFailed;
+}
+
+bool CRecordingReader::Open(const char *Path)
+{
+    Close();
+    if (!MFile.Open(Path)) return false;
+
+    const uint8_t *Data = MFile.GetData();
+    size_t Size = MFile.GetSize();
+    if (Size < HeaderSize || ReadU32(Data) != RecordingMagic || ReadU16(Data + 4) != RecordingVersion)
+    {
+        Close();
+        return false;
+    }
+
+    MCodec = ReadU32(Data + 8);
+    uint32_t Flags = ReadU32(Data + 12);
+    uint64_t FrameCount = ReadU64(Data + 16);
+    uint64_t DataOffset = ReadU64(Data + 24);
+    uint64_t IndexOffset = ReadU64(Data + 32);
+
+    if (DataOffset < HeaderSize || DataOffset > Size)
+    {
+        Close();
+        return false;
+    }
+
+    bool IndexValid = (Flags & HeaderFinalized) && IndexOffset >= DataOffset && IndexOffset <= Size &&
+        FrameCount <= (Size - IndexOffset) / IndexEntrySize;
+    if (IndexValid)
+    {
+        MIndex = Data + IndexOffset;
+        MFrameCount = (size_t)FrameCount;
+        return true;
+    }
+
+    RecoverIndex(DataOffset);
+    return true;
+}
+
+void CRecordingReader::Close()
+{
+    MFile.Close();
+    MCodec = 0;
+    MFrameCount = 0;
+    MIndex = nullptr;
+    MRecoveredIndex.clear();
+    MRecovered = false;
+}
+
+void CRecordingReader::RecoverIndex(uint64_t DataOffset)
+{
+    const uint8_t *Data = MFile.GetData();
+    uint64_t Size = MFile.GetSize();
+    uint64_t Offset = DataOffset;
+
+    // Keep every complete record; a torn final record is dropped. A recording cut before its
+    // first record is empty, not invalid.
+    while (Offset + RecordHeaderSize <= Size)
+    {
+        SRecordingIndexEntry Entry;
+        Entry.Size = ReadU32(Data + Offset);
+        Entry.Flags = ReadU32(Data + Offset + 4);
+        Entry.Timestamp = (int64_t)ReadU64(Data + Offset + 8);
+        Entry.Offset = Offset + RecordHeaderSize;
+
+        if (Entry.Size == 0 || Entry.Size > Size - Entry.Offset) break;
+        if (MRecoveredIndex.empty() && !Entry.IsKeyframe()) break;
+        if (!MRecoveredIndex.empty() && Entry.Timestamp < MRecoveredIndex.back().Timestamp) break;
+
+        Entry.KeyframeIndex = Entry.IsKeyframe() ? (uint32_t)MRecoveredIndex.size() : MRecoveredIndex.back().KeyframeIndex;
+        MRecoveredIndex.push_back(Entry);
+        Offset = Entry.Offset + Entry.Size;
+    }
+
+    MFrameCount = MRecoveredIndex.size();
+    MRecovered = true;
+}
+
+SRecordingIndexEntry CRecordingReader::GetEntry(size_t Index) const
+{
+    if (Index >= MFrameCount) return SRecordingIndexEntry();
+    if (MIndex) return ReadIndexEntry(MIndex + Index * IndexEntrySize);
+    return MRecoveredIndex[Index];
+}
+
+const uint8_t *CRecordingReader::GetFrameData(size_t Index, size_t *OutSize) const
+{
+    if (OutSize) *OutSize = 0;
+    if (Index >= MFrameCount) return nullptr;
+
+    SRecordingIndexEntry Entry = GetEntry(Index);
+    if (Entry.Offset > MFile.GetSize() || Entry.Size > MFile.GetSize() - Entry.Offset) return nullptr;
+
+    if (OutSize) *OutSize = Entry.Size;
+    return MFile.GetData() + Entry.Offset;
+}
+
+size_t CRecordingReader::FindFrame(int64_t Timestamp) const
+{
+    // First frame later than Timestamp, then step back one
+    size_t Low = 0;
+    size_t High = MFrameCount;
+    while (Low < High)
+    {
+        size_t Middle = Low + (High - Low) / 2;
+        if (GetEntry(Middle).Timestamp <= Timestamp)
+        {
+            Low = Middle + 1;
+        }
+        else
+        {
+            High = Middle;
+        }
+    }
+    return Low > 0 ? Low - 1 : 0;
+}
@@ -0,0 +1,107 @@
+#ifndef TAPI_RECORDING_FILE_H
+#define TAPI_RECORDING_FILE_H
+
+#include "Core/MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Recording container. Layout, little endian:
+//
+//   Header (64 bytes)
+//     uint32 Magic 'SXRF', uint16 Version, uint16 HeaderSize, uint32 Codec, uint32 Flags,
+//     uint64 FrameCount, uint64 DataOffset, uint64 IndexOffset, reserved
+//   Data region, append-only records
+//     uint32 PayloadSize, uint32 Flags, int64 Timestamp, payload
+//   Index (written on close), one entry per frame in timestamp order
+//     int64 Timestamp, uint64 PayloadOffset, uint32 PayloadSize, uint32 Flags,
+//     uint32 KeyframeIndex, uint32 reserved
+//
+// The index lets a reader seek by time with a binary search over the mapped file. A
+// recording that was never closed has no index; readers rebuild it from the records.
+// A header without records is a valid empty recording.
+
+static const uint32_t RecordingCodecTiled = 0x43465853;  // CFrameEncoder frames ("SXFC")
+static const uint32_t RecordingFrameKeyframe = 0x01;
+
+struct SRecordingIndexEntry
+{
+    int64_t Timestamp = 0;        // 100 ns units, non-decreasing
+    uint64_t Offset = 0;          // File offset of the payload
+    uint32_t Size = 0;
+    uint32_t Flags = 0;           // RecordingFrame* flags
+    uint32_t KeyframeIndex = 0;   // Frame to start decoding at to reach this one
+
+    bool IsKeyframe() const { return (Flags & RecordingFrameKeyframe) != 0; }
+};
+
+// Appends frames with large sequential writes through an in-memory buffer.
+class CRecordingWriter
+{
+public:
+    static constexpr size_t DefaultBufferSize = 4 << 20;
+
+    CRecordingWriter() = default;
+    ~CRecordingWriter();
+
+    CRecordingWriter(const CRecordingWriter &) = delete;
+    CRecordingWriter &operator=(const CRecordingWriter &) = delete;
+
+    bool Open(const char *Path, uint32_t Codec = RecordingCodecTiled, size_t BufferSize = DefaultBufferSize);
+
+    // The first frame must be a keyframe and timestamps must not decrease
+    bool AppendFrame(const uint8_t *Data, size_t Size, int64_t Timestamp, bool IsKeyframe);
+
+    // Writes the index and the final header. Returns false if any write failed.
+    bool Close();
+
+    bool IsOpen() const { return MFile != nullptr; }
+    size_t GetFrameCount() const { return MIndex.size(); }
+    uint64_t GetBytesWritten() const { return MOffset; }
+
+private:
+    bool Write(const void *Data, size_t Size);
+    bool Flush();
+    void WriteHeader(uint8_t *Out, bool Finalized, uint64_t IndexOffset) const;
+
+    std::FILE *MFile = nullptr;
+    uint32_t MCodec = 0;
+    std::vector<uint8_t> MBuffer;
+    size_t MBuffered = 0;
+    uint64_t MOffset = 0;       // Logical file size including buffered bytes
+    bool MFailed = false;
+    std::vector<SRecordingIndexEntry> MIndex;
+};
+
+// Memory-mapped view of a recording.
+class CRecordingReader
+{
+public:
+    bool Open(const char *Path);
+    void Close();
+
+    bool IsOpen() const { return MFile.IsOpen(); }
+    uint32_t GetCodec() const { return MCodec; }
+    bool WasRecovered() const { return MRecovered; }
+
+    size_t GetFrameCount() const { return MFrameCount; }
+    SRecordingIndexEntry GetEntry(size_t Index) const;
+    const uint8_t *GetFrameData(size_t Index, size_t *OutSize) const;
+
+    // Last frame with a timestamp at or before Timestamp, 0 if all frames are later
+    size_t FindFrame(int64_t Timestamp) const;
+
+private:
+    void RecoverIndex(uint64_t DataOffset);
+
+    CMappedFile MFile;
+    uint32_t MCodec = 0;
+    size_t MFrameCount = 0;
+    const uint8_t *MIndex = nullptr;  // Index entries in the mapped file
+    std::vector<SRecordingIndexEntry> MRecoveredIndex;
+    bool MRecovered = false;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include "RecordingSource.h"
+
+CRecordingSource::CRecordingSource(int ThreadCount)
+    : MDecoder(ThreadCount)
+{
+}
+
+bool CRecordingSource::Open(const char *Path)
+{
+    Close();
+    if (!MReader.Open(Path)) return false;
+
+    if (MReader.GetCodec() != RecordingCodecTiled)
+    {
+        MReader.Close();
+        return false;
+    }
+    return true;
+}
+
+void CRecordingSource::Close()
+{
+    MReader.Close();
+    MDecoder.Reset();
+    MPosition = 0;
+    MHasDecoded = false;
+}
+
+void CRecordingSource::SeekToFrame(size_t Index)
+{
+    MPosition = Index;
+}
+
+void CRecordingSource::SeekToTime(int64_t Timestamp)
+{
+    MPosition = MReader.FindFrame(Timestamp);
+}
+
+bool CRecordingSource::ReadFrame(SImageView &OutFrame, int64_t *OutTimestamp)
+{
+    if (MPosition >= MReader.GetFrameCount()) return false;
+    if (!DecodeFrame(MPosition)) return false;
+
+    OutFrame = MDecoder.GetFrame();
+    if (OutTimestamp) *OutTimestamp = MReader.GetEntry(MPosition).Timestamp;
+    MPosition++;
+    return true;
+}
+
+bool CRecordingSource::DecodeFrame(size_t Index)
+{
+    if (MHasDecoded && MDecodedIndex == Index) return true;
+
+    SRecordingIndexEntry Entry = MReader.GetEntry(Index);
+    if (Entry.KeyframeIndex > Index) return false;
+
+    // Continue from the current frame when playing forward, otherwise restart at the keyframe
+    size_t First = Entry.KeyframeIndex;
+    if (MHasDecoded && MDecodedIndex < Index && MDecodedIndex >= First) First = MDecodedIndex + 1;
+
+    for (size_t Current = First; Current <= Index; Current++)
+    {
+        size_t Size = 0;
+        const uint8_t *Data = MReader.GetFrameData(Current, &Size);
+        if (!Data || !MDecoder.Decode(Data, Size))
+        {
+            MHasDecoded = false;
+            return false;
+        }
+        MDecodedIndex = Current;
+        MHasDecoded = true;
+    }
+    return true;
+}
@@ -0,0 +1,43 @@
+#ifndef TAPI_RECORDING_SOURCE_H
+#define TAPI_RECORDING_SOURCE_H
+
+#include "Imaging/ImageView.h"
+#include "Recording/FrameCodec.h"
+#include "Recording/RecordingFile.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Plays a recording back frame by frame. Seeking decodes forward from the nearest
+// keyframe, so any frame can be reached without decoding the whole recording.
+class CRecordingSource
+{
+public:
+    explicit CRecordingSource(int ThreadCount = 0);
+
+    bool Open(const char *Path);
+    void Close();
+    bool IsOpen() const { return MReader.IsOpen(); }
+
+    size_t GetFrameCount() const { return MReader.GetFrameCount(); }
+    size_t GetPosition() const { return MPosition; }  // Index of the frame ReadFrame returns next
+    const CRecordingReader &GetReader() const { return MReader; }
+
+    void SeekToFrame(size_t Index);
+    void SeekToTime(int64_t Timestamp);
+
+    // Decodes the frame at the current position and advances. The view stays valid
+    // until the next call. Returns false at the end or on a corrupt frame.
+    bool ReadFrame(SImageView &OutFrame, int64_t *OutTimestamp = nullptr);
+
+private:
+    bool DecodeFrame(size_t Index);
+
+    CRecordingReader MReader;
+    CFrameDecoder MDecoder;
+    size_t MPosition = 0;
+    size_t MDecodedIndex = 0;
+    bool MHasDecoded = false;
+};
+
+#endif
@@ -0,0 +1,196 @@
+#include "ReplayBuffer.h"
+#include "Recording/RecordingFile.h"
+
+#include <cstring>
+#include <vector>
+
+CReplayBuffer::CReplayBuffer(const SReplayBufferSettings &Settings)
+    : MSettings(Settings)
+{
+    if (MSettings.MaxDuration < 0) MSettings.MaxDuration = 0;
+    if (MSettings.MaxBytes < 1024) MSettings.MaxBytes = 1024;
+    MStorage.reset(new uint8_t[MSettings.MaxBytes]);
+}
+
+bool CReplayBuffer::WantsKeyframe(int64_t Timestamp) const
+{
+    std::lock_guard<std::mutex> Lock(MMutex);
+    if (MNeedsKeyframe || MFrames.empty()) return true;
+
+    // Groups are the eviction unit, keep them small against both limits
+    return Timestamp - MGroupStart >= MSettings.MaxDuration / GroupsPerBudget ||
+        MGroupBytes >= MSettings.MaxBytes / GroupsPerBudget;
+}
+
+bool CReplayBuffer::FindSpace(size_t Size, size_t &OutOffset) const
+{
+    if (MFrames.empty())
+    {
+        OutOffset = 0;
+        return true;
+    }
+
+    size_t Front = MFrames.front().Offset;
+    size_t BackEnd = MFrames.back().Offset + MFrames.back().Size;
+
+    if (MFrames.back().Offset >= Front)
+    {
+        // Live data is one span [Front, BackEnd); free space is after it, then before it
+        if (MSettings.MaxBytes - BackEnd >= Size)
+        {
+            OutOffset = BackEnd;
+            return true;
+        }
+        if (Front >= Size)
+        {
+            OutOffset = 0;
+            return true;
+        }
+        return false;
+    }
+
+    // Wrapped: free space is the gap [BackEnd, Front)
+    if (Front - BackEnd >= Size)
+    {
+        OutOffset = BackEnd;
+        return true;
+    }
+    return false;
+}
+
+size_t CReplayBuffer::GetGroupEnd(size_t First) const
+{
+    size_t End = First + 1;
+    while (End < MFrames.size() && !MFrames[End].IsKeyframe) End++;
+    return End;
+}
+
+bool CReplayBuffer::EvictOldestGroup()
+{
+    if (MFrames.empty()) return false;
+
+    size_t End = GetGroupEnd(0);
+    if (MPinnedId != NoPin && MFirstId + End > MPinnedId) return false;
+
+    for (size_t Index = 0; Index < End; Index++)
+    {
+        MBytesUsed -= MFrames.front().Size;
+        MFrames.pop_front();
+        MFirstId++;
+    }
+    return true;
+}
+
+bool CReplayBuffer::Append(const uint8_t *Data, size_t Size, int64_t Timestamp, bool IsKeyframe)
+{
+    std::lock_guard<std::mutex> Lock(MMutex);
+
+    if (!Data || Size == 0 || Size > MSettings.MaxBytes || (!IsKeyframe && (MFrames.empty() || MNeedsKeyframe)))
+    {
+        MNeedsKeyframe = true;
+        return false;
+    }
+
+    size_t Offset = 0;
+    while (!FindSpace(Size, Offset))
+    {
+        // Evicting the last group would leave a delta frame without its reference
+        bool LastGroup = GetGroupEnd(0) == MFrames.size();
+        if ((LastGroup && !IsKeyframe) || !EvictOldestGroup())
+        {
+            MNeedsKeyframe = true;
+            return false;
+        }
+    }
+
+    std::memcpy(MStorage.get() + Offset, Data, Size);
+    MFrames.push_back({ Offset, Size, Timestamp, IsKeyframe });
+    MBytesUsed += Size;
+
+    if (IsKeyframe)
+    {
+        MGroupStart = Timestamp;
+        MGroupBytes = 0;
+        MNeedsKeyframe = false;
+    }
+    MGroupBytes += Size;
+
+    // Drop the oldest group while the remaining frames still cover the wanted history
+    for (;;)
+    {
+        size_t NextGroup = GetGroupEnd(0);
+        if (NextGroup >= MFrames.size()) break;
+        if (Timestamp - MFrames[NextGroup].Timestamp < MSettings.MaxDuration) break;
+        if (!EvictOldestGroup()) break;
+    }
+    return true;
+}
+
+void CReplayBuffer::Clear()
+{
+    std::lock_guard<std::mutex> Lock(MMutex);
+
+    // Frames a dump still reads from stay in place
+    while (!MFrames.empty() && EvictOldestGroup()) {}
+    MNeedsKeyframe = true;
+}
+
+size_t CReplayBuffer::GetFrameCount() const
+{
+    std::lock_guard<std::mutex> Lock(MMutex);
+    return MFrames.size();
+}
+
+size_t CReplayBuffer::GetBytesUsed() const
+{
+    std::lock_guard<std::mutex> Lock(MMutex);
+    return MBytesUsed;
+}
+
+int64_t CReplayBuffer::GetDuration() const
+{
+    std::lock_guard<std::mutex> Lock(MMutex);
+    return MFrames.empty() ? 0 : MFrames.back().Timestamp - MFrames.front().Timestamp;
+}
+
+bool CReplayBuffer::Dump(const char *Path)
+{
+    uint64_t First = 0;
+    uint64_t Last = 0;
+    {
+        std::lock_guard<std::mutex> Lock(MMutex);
+        if (MFrames.empty() || MPinnedId != NoPin) return false;
+        First = MFirstId;
+        Last = MFirstId + MFrames.size();
+        MPinnedId = First;
+    }
+
+    CRecordingWriter Writer;
+    bool Success = Writer.Open(Path);
+
+    std::vector<uint8_t> Frame;
+    for (uint64_t Id = First; Id < Last && Success; Id++)
+    {
+        int64_t Timestamp;
+        bool IsKeyframe;
+        {
+            // Pinned frames are never evicted, so Id is still stored
+            std::lock_guard<std::mutex> Lock(MMutex);
+            const SFrame &Stored = MFrames[(size_t)(Id - MFirstId)];
+            Frame.assign(MStorage.get() + Stored.Offset, MStorage.get() + Stored.Offset + Stored.Size);
+            Timestamp = Stored.Timestamp;
+            IsKeyframe = Stored.IsKeyframe;
+            MPinnedId = Id + 1;
+        }
+
+        Success = Writer.AppendFrame(Frame.data(), Frame.size(), Timestamp, IsKeyframe);
+    }
+
+    {
+        std::lock_guard<std::mutex> Lock(MMutex);
+        MPinnedId = NoPin;
+    }
+
+    if (Writer.IsOpen() && !Writer.Close()) Success = false;
+    return Success;
+}
@@ -0,0 +1,74 @@
+#ifndef TAPI_REPLAY_BUFFER_H
+#define TAPI_REPLAY_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+struct SReplayBufferSettings
+{
+    int64_t MaxDuration = 30 * 10000000LL;  // History to keep, 100 ns units
+    size_t MaxBytes = 256 << 20;            // Hard memory budget for encoded frames
+};
+
+// Rolling history of encoded frames in a fixed-size byte ring. The oldest keyframe
+// group is evicted once the rest still covers MaxDuration, or when a new frame does not
+// fit. Frames are appended by one thread while another may dump a snapshot to disk.
+class CReplayBuffer
+{
+public:
+    explicit CReplayBuffer(const SReplayBufferSettings &Settings = SReplayBufferSettings());
+
+    const SReplayBufferSettings &GetSettings() const { return MSettings; }
+
+    // Whether the next appended frame should be a keyframe: the buffer is empty, a frame
+    // was dropped, or the current group grew past its time or size share of the budget
+    bool WantsKeyframe(int64_t Timestamp) const;
+
+    // Returns false and drops the frame if it cannot be stored without evicting frames
+    // a dump still needs, or if a delta frame has no stored reference
+    bool Append(const uint8_t *Data, size_t Size, int64_t Timestamp, bool IsKeyframe);
+
+    void Clear();
+
+    size_t GetFrameCount() const;
+    size_t GetBytesUsed() const;
+    int64_t GetDuration() const;
+
+    // Writes the frames held at the time of the call as a recording (see RecordingFile.h).
+    // Appends continue meanwhile; only frames the dump has not copied yet are protected
+    // from eviction. One dump at a time.
+    bool Dump(const char *Path);
+
+private:
+    struct SFrame
+    {
+        size_t Offset;
+        size_t Size;
+        int64_t Timestamp;
+        bool IsKeyframe;
+    };
+
+    static constexpr uint64_t NoPin = UINT64_MAX;
+    static constexpr int GroupsPerBudget = 8;  // Keyframe spacing as a fraction of the budget
+
+    bool FindSpace(size_t Size, size_t &OutOffset) const;
+    size_t GetGroupEnd(size_t First) const;
+    bool EvictOldestGroup();
+
+    SReplayBufferSettings MSettings;
+    std::unique_ptr<uint8_t[]> MStorage;
+
+    mutable std::mutex MMutex;
+    std::deque<SFrame> MFrames;
+    uint64_t MFirstId = 0;            // Id of MFrames.front(); ids grow by one per stored frame
+    uint64_t MPinnedId = NoPin;       // Frames from this id on are still needed by a dump
+    size_t MBytesUsed = 0;
+    size_t MGroupBytes = 0;           // Bytes since the newest keyframe
+    int64_t MGroupStart = 0;          // Timestamp of the newest keyframe
+    bool MNeedsKeyframe = true;
+};
+
+#endif
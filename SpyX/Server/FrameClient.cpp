@@ -0,0 +1,115 @@
+#include "FrameClient.h"
+
+#include <chrono>
+
+// A subscription is one message, so this only waits if the server stopped reading entirely
+static const int SendTimeoutMs = 1000;
+
+bool CFrameClient::Connect(const std::string &SocketPath, const SFrameSubscription &Subscription)
+{
+    Disconnect();
+    if (!MSocket.Connect(SocketPath)) return false;
+
+    if (!Subscribe(Subscription))
+    {
+        Disconnect();
+        return false;
+    }
+    return true;
+}
+
+void CFrameClient::Disconnect()
+{
+    MSocket.Close();
+    MRing.Close();
+    MInput.clear();
+}
+
+bool CFrameClient::Subscribe(const SFrameSubscription &Subscription)
+{
+    if (!MSocket.IsOpen()) return false;
+
+    uint8_t Message[FrameServerMessageSize];
+    EncodeSubscribe(Subscription, Message);
+
+    size_t Offset = 0;
+    while (Offset < FrameServerMessageSize)
+    {
+        int Sent = MSocket.Send(Message + Offset, FrameServerMessageSize - Offset);
+        if (Sent < 0) return false;
+        if (Sent > 0)
+        {
+            Offset += (size_t)Sent;
+            continue;
+        }
+
+        std::vector<CLocalSocket::SPollEntry> Entries(1);
+        Entries[0].Socket = &MSocket;
+        Entries[0].WantWrite = true;
+        if (!CLocalSocket::Poll(Entries, SendTimeoutMs) || !Entries[0].Writable) return false;
+    }
+    return true;
+}
+
+bool CFrameClient::WaitFrame(int TimeoutMs, std::vector<uint8_t> &OutPixels, SRingFrameInfo &OutInfo)
+{
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point Deadline = Clock::now() + std::chrono::milliseconds(TimeoutMs < 0 ? 0 : TimeoutMs);
+
+    for (;;)
+    {
+        if (!ReceiveMessages())
+        {
+            Disconnect();
+            return false;
+        }
+
+        // The ring is checked before waiting, since doorbells may have been coalesced away
+        if (MRing.IsOpen() && MRing.ReadLatest(OutPixels, OutInfo)) return true;
+
+        int WaitMs = -1;
+        if (TimeoutMs >= 0)
+        {
+            Clock::duration Remaining = Deadline - Clock::now();
+            if (Remaining <= Clock::duration::zero()) return false;
+            WaitMs = (int)std::chrono::duration_cast<std::chrono::milliseconds>(Remaining).count() + 1;
+        }
+
+        std::vector<CLocalSocket::SPollEntry> Entries(1);
+        Entries[0].Socket = &MSocket;
+        if (!CLocalSocket::Poll(Entries, WaitMs))
+        {
+            Disconnect();
+            return false;
+        }
+    }
+}
+
+bool CFrameClient::ReceiveMessages()
+{
+    if (!MSocket.IsOpen()) return false;
+
+    uint8_t Buffer[1024];
+    for (;;)
+    {
+        int Received = MSocket.Receive(Buffer, sizeof(Buffer));
+        if (Received < 0) return false;
+        if (Received == 0) break;
+        MInput.insert(MInput.end(), Buffer, Buffer + Received);
+    }
+
+    // Only ring changes need handling here; doorbells have done their job by waking us
+    size_t Offset = 0;
+    for (; Offset + FrameServerMessageSize <= MInput.size(); Offset += FrameServerMessageSize)
+    {
+        const uint8_t *Message = MInput.data() + Offset;
+        std::string Name;
+        if (GetMessageType(Message) == EFrameServerMessage::Ring && DecodeRing(Message, Name))
+        {
+            // A ring replaced again before we got here is gone; the next Ring message follows
+            MRing.Open(Name);
+        }
+    }
+    MInput.erase(MInput.begin(), MInput.begin() + Offset);
+    return true;
+}
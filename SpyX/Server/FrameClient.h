@@ -0,0 +1,36 @@
+#ifndef TAPI_FRAME_CLIENT_H
+#define TAPI_FRAME_CLIENT_H
+
+#include "Core/LocalSocket.h"
+#include "Server/FrameRing.h"
+#include "Server/FrameServerProtocol.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Receives frames from a CFrameServer in another process. Frames are copied out of the
+// shared ring, so the caller's buffer is never overwritten behind its back.
+class CFrameClient
+{
+public:
+    bool Connect(const std::string &SocketPath, const SFrameSubscription &Subscription);
+    void Disconnect();
+    bool IsConnected() const { return MSocket.IsOpen(); }
+
+    // Renegotiates format, ROI or rate on a live connection
+    bool Subscribe(const SFrameSubscription &Subscription);
+
+    // Waits up to TimeoutMs (-1 = forever) for a frame newer than the last one returned and
+    // copies it out. Returns false on timeout or when the server has gone away.
+    bool WaitFrame(int TimeoutMs, std::vector<uint8_t> &OutPixels, SRingFrameInfo &OutInfo);
+
+private:
+    bool ReceiveMessages();
+
+    CLocalSocket MSocket;
+    CFrameRingReader MRing;
+    std::vector<uint8_t> MInput;
+};
+
+#endif
@@ -0,0 +1,200 @@
+#include "FrameRing.h"
+
+#include <atomic>
+#include <cstring>
+#include <new>
+
+static const uint32_t RingMagic = 0x52465853;   // "SXFR"
+static const uint32_t RingVersion = 1;
+
+struct SRingHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t SlotCount;
+    uint32_t SlotHeaderSize;
+    uint64_t SlotCapacity;
+    std::atomic<uint64_t> PublishCount;
+    uint8_t Reserved[32];
+};
+
+// Lock is 2 * PublishIndex + 1 while the slot is written and 2 * PublishIndex + 2 once it
+// is complete, so a reader can tell both a torn copy and a slot that now holds another frame
+struct SSlotHeader
+{
+    std::atomic<uint64_t> Lock;
+    uint64_t Sequence;
+    int64_t Timestamp;
+    int32_t Width;
+    int32_t Height;
+    int32_t Format;
+    uint32_t DataSize;
+    uint8_t Reserved[24];
+};
+
+static_assert(sizeof(SRingHeader) == 64, "Ring header layout is shared with other processes");
+static_assert(sizeof(SSlotHeader) == 64, "Slot header layout is shared with other processes");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared-memory atomics must be lock-free");
+
+static size_t GetSlotStride(size_t SlotCapacity)
+{
+    return sizeof(SSlotHeader) + SlotCapacity;
+}
+
+static SSlotHeader *GetSlot(uint8_t *Base, size_t SlotCapacity, int SlotCount, uint64_t PublishIndex)
+{
+    size_t Offset = sizeof(SRingHeader) + (size_t)(PublishIndex % (uint64_t)SlotCount) * GetSlotStride(SlotCapacity);
+    return reinterpret_cast<SSlotHeader *>(Base + Offset);
+}
+
+bool CFrameRingWriter::Create(const std::string &Name, int SlotCount, size_t SlotCapacity)
+{
+    Close();
+    if (SlotCount < 2 || SlotCapacity == 0) return false;
+
+    // Keep every slot header on its own cache line
+    SlotCapacity = (SlotCapacity + 63) & ~(size_t)63;
+    size_t Size = sizeof(SRingHeader) + (size_t)SlotCount * GetSlotStride(SlotCapacity);
+    if (!MMemory.Create(Name, Size)) return false;
+
+    SRingHeader *Header = new (MMemory.GetData()) SRingHeader();
+    Header->Magic = RingMagic;
+    Header->Version = RingVersion;
+    Header->SlotCount = (uint32_t)SlotCount;
+    Header->SlotHeaderSize = sizeof(SSlotHeader);
+    Header->SlotCapacity = SlotCapacity;
+    Header->PublishCount.store(0, std::memory_order_relaxed);
+    for (int Index = 0; Index < SlotCount; Index++)
+    {
+        new (GetSlot(MMemory.GetData(), SlotCapacity, SlotCount, (uint64_t)Index)) SSlotHeader();
+    }
+
+    MSlotCount = SlotCount;
+    MSlotCapacity = SlotCapacity;
+    MNextIndex = 0;
+    MSlot = nullptr;
+    return true;
+}
+
+uint8_t *CFrameRingWriter::BeginWrite(int Width, int Height, EPixelFormat Format)
+{
+    if (!MMemory.IsOpen() || MSlot || Width <= 0 || Height <= 0) return nullptr;
+
+    size_t DataSize = (size_t)Width * Height * GetBytesPerPixel(Format);
+    if (DataSize == 0 || DataSize > MSlotCapacity) return nullptr;
+
+    SSlotHeader *Slot = GetSlot(MMemory.GetData(), MSlotCapacity, MSlotCount, MNextIndex);
+    Slot->Lock.store(2 * MNextIndex + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    Slot->Width = Width;
+    Slot->Height = Height;
+    Slot->Format = (int32_t)Format;
+    Slot->DataSize = (uint32_t)DataSize;
+
+    MSlot = reinterpret_cast<uint8_t *>(Slot);
+    return MSlot + sizeof(SSlotHeader);
+}
+
+uint64_t CFrameRingWriter::EndWrite(uint64_t Sequence, int64_t Timestamp)
+{
+    SSlotHeader *Slot = reinterpret_cast<SSlotHeader *>(MSlot);
+    Slot->Sequence = Sequence;
+    Slot->Timestamp = Timestamp;
+    Slot->Lock.store(2 * MNextIndex + 2, std::memory_order_release);
+
+    SRingHeader *Header = reinterpret_cast<SRingHeader *>(MMemory.GetData());
+    Header->PublishCount.store(MNextIndex + 1, std::memory_order_release);
+
+    MSlot = nullptr;
+    return MNextIndex++;
+}
+
+bool CFrameRingReader::Open(const std::string &Name)
+{
+    Close();
+    if (!MMemory.Open(Name)) return false;
+
+    const SRingHeader *Header = reinterpret_cast<const SRingHeader *>(MMemory.GetData());
+    bool Valid = MMemory.GetSize() >= sizeof(SRingHeader) && Header->Magic == RingMagic &&
+        Header->Version == RingVersion && Header->SlotHeaderSize == sizeof(SSlotHeader) && Header->SlotCount >= 2;
+    if (Valid)
+    {
+        size_t Required = sizeof(SRingHeader) + (size_t)Header->SlotCount * GetSlotStride((size_t)Header->SlotCapacity);
+        Valid = MMemory.GetSize() >= Required;
+    }
+    if (!Valid)
+    {
+        Close();
+        return false;
+    }
+
+    MSlotCount = (int)Header->SlotCount;
+    MSlotCapacity = (size_t)Header->SlotCapacity;
+    MNextUnread = 0;
+    return true;
+}
+
+void CFrameRingReader::Close()
+{
+    MMemory.Close();
+    MSlotCount = 0;
+    MSlotCapacity = 0;
+    MNextUnread = 0;
+}
+
+uint64_t CFrameRingReader::GetPublishCount() const
+{
+    if (!MMemory.IsOpen()) return 0;
+
+    const SRingHeader *Header = reinterpret_cast<const SRingHeader *>(MMemory.GetData());
+    return Header->PublishCount.load(std::memory_order_acquire);
+}
+
+bool CFrameRingReader::ReadLatest(std::vector<uint8_t> &OutPixels, SRingFrameInfo &OutInfo)
+{
+    // A miss means the writer lapped the slot mid-copy; the newer frame is then worth a retry
+    for (int Attempt = 0; Attempt < 4; Attempt++)
+    {
+        uint64_t Count = GetPublishCount();
+        if (Count == 0 || Count <= MNextUnread) return false;
+        if (Read(Count - 1, OutPixels, OutInfo)) return true;
+    }
+    return false;
+}
+
+bool CFrameRingReader::Read(uint64_t PublishIndex, std::vector<uint8_t> &OutPixels, SRingFrameInfo &OutInfo)
+{
+    if (!MMemory.IsOpen() || PublishIndex >= GetPublishCount()) return false;
+
+    SSlotHeader *Slot = GetSlot(MMemory.GetData(), MSlotCapacity, MSlotCount, PublishIndex);
+    uint64_t Expected = 2 * PublishIndex + 2;
+    if (Slot->Lock.load(std::memory_order_acquire) != Expected) return false;
+
+    SSlotHeader Copy;
+    std::memcpy((void *)&Copy.Sequence, (const void *)&Slot->Sequence, sizeof(SSlotHeader) - sizeof(Slot->Lock));
+    if (Copy.DataSize > MSlotCapacity) return false;
+
+    OutPixels.resize(Copy.DataSize);
+    std::memcpy(OutPixels.data(), reinterpret_cast<const uint8_t *>(Slot) + sizeof(SSlotHeader), Copy.DataSize);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (Slot->Lock.load(std::memory_order_relaxed) != Expected) return false;
+
+    EPixelFormat Format = (EPixelFormat)Copy.Format;
+    if (Copy.Width <= 0 || Copy.Height <= 0 || GetBytesPerPixel(Format) == 0 ||
+        (size_t)Copy.Width * Copy.Height * GetBytesPerPixel(Format) != Copy.DataSize)
+    {
+        return false;
+    }
+
+    OutInfo.PublishIndex = PublishIndex;
+    OutInfo.Sequence = Copy.Sequence;
+    OutInfo.Timestamp = Copy.Timestamp;
+    OutInfo.Width = Copy.Width;
+    OutInfo.Height = Copy.Height;
+    OutInfo.Format = Format;
+    OutInfo.Dropped = PublishIndex > MNextUnread ? PublishIndex - MNextUnread : 0;
+    if (PublishIndex >= MNextUnread) MNextUnread = PublishIndex + 1;
+    return true;
+}
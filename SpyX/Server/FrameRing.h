@@ -0,0 +1,81 @@
+#ifndef TAPI_FRAME_RING_H
+#define TAPI_FRAME_RING_H
+
+#include "Core/SharedMemory.h"
+#include "Imaging/ImageView.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Single-producer frame ring in shared memory. The writer never waits for readers: each
+// slot carries a sequence lock that is odd while the slot is being rewritten, and readers
+// copy a slot out and then check the lock did not move. A reader that falls behind by
+// more than the slot count loses frames, and can tell from the gap in publish indices.
+//
+// Layout: a 64-byte ring header, then SlotCount slots of a 64-byte slot header followed
+// by SlotCapacity bytes of tightly packed pixels. All fields are host-endian, since both
+// ends share the machine.
+
+struct SRingFrameInfo
+{
+    uint64_t PublishIndex = 0;      // Position in the ring's publish order, from 0
+    uint64_t Sequence = 0;          // Producer's frame sequence
+    int64_t Timestamp = 0;
+    int Width = 0;
+    int Height = 0;
+    EPixelFormat Format = EPixelFormat::BGRA8;
+    uint64_t Dropped = 0;           // Frames published since the previous read that were skipped
+};
+
+class CFrameRingWriter
+{
+public:
+    bool Create(const std::string &Name, int SlotCount, size_t SlotCapacity);
+    void Close() { MMemory.Close(); }
+    bool IsOpen() const { return MMemory.IsOpen(); }
+
+    const std::string &GetName() const { return MMemory.GetName(); }
+    int GetSlotCount() const { return MSlotCount; }
+    size_t GetSlotCapacity() const { return MSlotCapacity; }
+
+    // Claims the next slot and returns where to write Height rows of Width pixels, tightly
+    // packed. Returns nullptr if the frame does not fit. Every successful BeginWrite must be
+    // followed by EndWrite, which publishes the slot and returns its publish index.
+    uint8_t *BeginWrite(int Width, int Height, EPixelFormat Format);
+    uint64_t EndWrite(uint64_t Sequence, int64_t Timestamp);
+
+private:
+    CSharedMemory MMemory;
+    int MSlotCount = 0;
+    size_t MSlotCapacity = 0;
+    uint64_t MNextIndex = 0;
+    uint8_t *MSlot = nullptr;
+};
+
+class CFrameRingReader
+{
+public:
+    bool Open(const std::string &Name);
+    void Close();
+    bool IsOpen() const { return MMemory.IsOpen(); }
+
+    // Number of frames published so far
+    uint64_t GetPublishCount() const;
+
+    // Copies the newest frame if it is newer than the previous read. Returns false when
+    // nothing new is available or the slot was overwritten during the copy.
+    bool ReadLatest(std::vector<uint8_t> &OutPixels, SRingFrameInfo &OutInfo);
+
+    // Copies a specific frame if it is still in the ring
+    bool Read(uint64_t PublishIndex, std::vector<uint8_t> &OutPixels, SRingFrameInfo &OutInfo);
+
+private:
+    CSharedMemory MMemory;
+    int MSlotCount = 0;
+    size_t MSlotCapacity = 0;
+    uint64_t MNextUnread = 0;
+};
+
+#endif
@@ -0,0 +1,247 @@
+#include "FrameServer.h"
+
+#include "Imaging/ToneMapper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+// Doorbells queued beyond this many messages are dropped; the client catches up from the ring
+static const size_t MaxQueuedMessages = 8;
+
+static const int PollIntervalMs = 50;
+
+CFrameServer::CFrameServer()
+{
+    std::random_device Device;
+    uint64_t Seed = ((uint64_t)Device() << 32) ^ Device();
+    MRandom.seed(Seed ^ (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count());
+}
+
+CFrameServer::~CFrameServer()
+{
+    Stop();
+}
+
+bool CFrameServer::Start(const std::string &SocketPath)
+{
+    if (IsRunning()) return false;
+    if (!MListener.Listen(SocketPath)) return false;
+
+    MStop = false;
+    MThread = std::thread(&CFrameServer::ServerMain, this);
+    return true;
+}
+
+void CFrameServer::Stop()
+{
+    MStop = true;
+    if (MThread.joinable()) MThread.join();
+
+    std::lock_guard<std::mutex> Lock(MMutex);
+    MClients.clear();
+    MListener.Close();
+}
+
+int CFrameServer::GetClientCount() const
+{
+    std::lock_guard<std::mutex> Lock(MMutex);
+    return (int)MClients.size();
+}
+
+void CFrameServer::Publish(const SImageView &Frame, uint64_t Sequence, int64_t Timestamp)
+{
+    if (!Frame.IsValid() || (Frame.Format != EPixelFormat::BGRA8 && Frame.Format != EPixelFormat::Gray8)) return;
+
+    std::lock_guard<std::mutex> Lock(MMutex);
+    for (std::unique_ptr<SClient> &Client : MClients)
+    {
+        PublishToClient(*Client, Frame, Sequence, Timestamp);
+    }
+}
+
+void CFrameServer::ServerMain()
+{
+    std::vector<CLocalSocket::SPollEntry> Entries;
+
+    while (!MStop)
+    {
+        // Only this thread adds or removes clients, so entry i + 1 stays MClients[i]
+        Entries.clear();
+        Entries.emplace_back();
+        Entries.back().Socket = &MListener;
+        {
+            std::lock_guard<std::mutex> Lock(MMutex);
+            for (std::unique_ptr<SClient> &Client : MClients)
+            {
+                Entries.emplace_back();
+                Entries.back().Socket = &Client->Socket;
+                Entries.back().WantWrite = !Client->Output.empty();
+            }
+        }
+
+        if (!CLocalSocket::Poll(Entries, PollIntervalMs)) break;
+
+        std::lock_guard<std::mutex> Lock(MMutex);
+        for (size_t Index = 1; Index < Entries.size(); Index++)
+        {
+            SClient &Client = *MClients[Index - 1];
+            if (Entries[Index].Readable) ReceiveMessages(Client);
+            if (Entries[Index].Writable) FlushOutput(Client);
+        }
+
+        MClients.erase(std::remove_if(MClients.begin(), MClients.end(),
+            [](const std::unique_ptr<SClient> &Client) { return Client->IsClosed; }), MClients.end());
+
+        if (Entries[0].Readable)
+        {
+            for (;;)
+            {
+                std::unique_ptr<SClient> Client(new SClient());
+                if (!MListener.Accept(Client->Socket)) break;
+                MClients.push_back(std::move(Client));
+            }
+        }
+    }
+}
+
+void CFrameServer::ReceiveMessages(SClient &Client)
+{
+    uint8_t Buffer[1024];
+    for (;;)
+    {
+        int Received = Client.Socket.Receive(Buffer, sizeof(Buffer));
+        if (Received < 0)
+        {
+            Client.IsClosed = true;
+            return;
+        }
+        if (Received == 0) break;
+        Client.Input.insert(Client.Input.end(), Buffer, Buffer + Received);
+    }
+
+    size_t Offset = 0;
+    for (; Offset + FrameServerMessageSize <= Client.Input.size(); Offset += FrameServerMessageSize)
+    {
+        const uint8_t *Message = Client.Input.data() + Offset;
+        if (GetMessageType(Message) != EFrameServerMessage::Subscribe) continue;
+
+        SFrameSubscription Subscription;
+        if (!DecodeSubscribe(Message, Subscription))
+        {
+            // Nothing sensible to deliver; the client sees the connection close
+            Client.IsClosed = true;
+            return;
+        }
+
+        // A new depth needs a new ring; a new format or ROI fits the old one or regrows it
+        if (Client.Ring.IsOpen() && Client.Ring.GetSlotCount() != Subscription.SlotCount) Client.Ring.Close();
+
+        Client.Subscription = Subscription;
+        Client.IsSubscribed = true;
+        Client.HasPublished = false;
+    }
+    Client.Input.erase(Client.Input.begin(), Client.Input.begin() + Offset);
+}
+
+void CFrameServer::PublishToClient(SClient &Client, const SImageView &Frame, uint64_t Sequence, int64_t Timestamp)
+{
+    if (!Client.IsSubscribed || Client.IsClosed) return;
+
+    // Frames up to a quarter interval early still count, so presentation jitter does not
+    // halve the delivered rate
+    const SFrameSubscription &Subscription = Client.Subscription;
+    if (Client.HasPublished && Timestamp < Client.NextDue - Subscription.MinInterval / 4) return;
+
+    int X = std::min(Subscription.RoiX, Frame.Width);
+    int Y = std::min(Subscription.RoiY, Frame.Height);
+    int Width = Subscription.RoiWidth > 0 ? std::min(Subscription.RoiWidth, Frame.Width - X) : Frame.Width - X;
+    int Height = Subscription.RoiHeight > 0 ? std::min(Subscription.RoiHeight, Frame.Height - Y) : Frame.Height - Y;
+    if (Width <= 0 || Height <= 0) return;
+
+    const int OutputBytesPerPixel = GetBytesPerPixel(Subscription.Format);
+    if (!EnsureRing(Client, (size_t)Width * Height * OutputBytesPerPixel)) return;
+
+    uint8_t *Destination = Client.Ring.BeginWrite(Width, Height, Subscription.Format);
+    if (!Destination) return;
+
+    SImageView Source = Frame;
+    Source.Data = Frame.Row(Y) + (size_t)X * GetBytesPerPixel(Frame.Format);
+    Source.Width = Width;
+    Source.Height = Height;
+
+    const size_t OutputStride = (size_t)Width * OutputBytesPerPixel;
+    if (Source.Format == Subscription.Format)
+    {
+        for (int Row = 0; Row < Height; Row++)
+        {
+            std::memcpy(Destination + OutputStride * Row, Source.Row(Row), OutputStride);
+        }
+    }
+    else if (Source.Format == EPixelFormat::BGRA8)
+    {
+        ConvertBGRA8ToGray8(Source, Destination, (int)OutputStride);
+    }
+    else
+    {
+        for (int Row = 0; Row < Height; Row++)
+        {
+            const uint8_t *In = Source.Row(Row);
+            uint8_t *Out = Destination + OutputStride * Row;
+            for (int Column = 0; Column < Width; Column++)
+            {
+                Out[0] = Out[1] = Out[2] = In[Column];
+                Out[3] = 0xFF;
+                Out += 4;
+            }
+        }
+    }
+
+    uint64_t PublishIndex = Client.Ring.EndWrite(Sequence, Timestamp);
+    Client.HasPublished = true;
+    Client.NextDue = Timestamp + Subscription.MinInterval;
+
+    if (Client.Output.size() < MaxQueuedMessages * FrameServerMessageSize)
+    {
+        uint8_t Message[FrameServerMessageSize];
+        EncodeFrameReady(PublishIndex, Sequence, Message);
+        QueueMessage(Client, Message);
+    }
+}
+
+bool CFrameServer::EnsureRing(SClient &Client, size_t FrameBytes)
+{
+    if (Client.Ring.IsOpen() && FrameBytes <= Client.Ring.GetSlotCapacity()) return true;
+
+    // The client keeps its mapping of the old ring until it has opened the new one
+    char Name[32];
+    std::snprintf(Name, sizeof(Name), "SpyXFrames_%016llx", (unsigned long long)MRandom());
+    if (!Client.Ring.Create(Name, Client.Subscription.SlotCount, FrameBytes)) return false;
+
+    uint8_t Message[FrameServerMessageSize];
+    EncodeRing(Client.Ring.GetName(), Message);
+    QueueMessage(Client, Message);
+    return true;
+}
+
+void CFrameServer::QueueMessage(SClient &Client, const uint8_t *Message)
+{
+    Client.Output.insert(Client.Output.end(), Message, Message + FrameServerMessageSize);
+    FlushOutput(Client);
+}
+
+void CFrameServer::FlushOutput(SClient &Client)
+{
+    while (!Client.Output.empty() && !Client.IsClosed)
+    {
+        int Sent = Client.Socket.Send(Client.Output.data(), Client.Output.size());
+        if (Sent < 0)
+        {
+            Client.IsClosed = true;
+            Client.Output.clear();
+        }
+        if (Sent <= 0) break;
+        Client.Output.erase(Client.Output.begin(), Client.Output.begin() + Sent);
+    }
+}
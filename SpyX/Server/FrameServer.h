@@ -0,0 +1,70 @@
+#ifndef TAPI_FRAME_SERVER_H
+#define TAPI_FRAME_SERVER_H
+
+#include "Core/LocalSocket.h"
+#include "Imaging/ImageView.h"
+#include "Server/FrameRing.h"
+#include "Server/FrameServerProtocol.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Shares one capture with other local processes. Each subscriber gets its own shared-memory
+// ring holding frames already cropped to its ROI and converted to its format, so clients
+// never touch pixels they did not ask for. A server thread accepts connections and handles
+// subscriptions; Publish runs on the producer's thread, writes the rings and rings doorbells
+// without ever blocking on a slow client.
+class CFrameServer
+{
+public:
+    CFrameServer();
+    ~CFrameServer();
+
+    CFrameServer(const CFrameServer &) = delete;
+    CFrameServer &operator=(const CFrameServer &) = delete;
+
+    bool Start(const std::string &SocketPath);
+    void Stop();
+    bool IsRunning() const { return MThread.joinable(); }
+
+    // BGRA8 or Gray8 frames; others are ignored
+    void Publish(const SImageView &Frame, uint64_t Sequence, int64_t Timestamp);
+
+    int GetClientCount() const;
+
+private:
+    struct SClient
+    {
+        CLocalSocket Socket;
+        std::vector<uint8_t> Input;
+        std::vector<uint8_t> Output;
+        bool IsSubscribed = false;
+        bool IsClosed = false;
+        SFrameSubscription Subscription;
+        CFrameRingWriter Ring;
+        bool HasPublished = false;
+        int64_t NextDue = 0;
+    };
+
+    void ServerMain();
+    void ReceiveMessages(SClient &Client);
+    void PublishToClient(SClient &Client, const SImageView &Frame, uint64_t Sequence, int64_t Timestamp);
+    bool EnsureRing(SClient &Client, size_t FrameBytes);
+    void QueueMessage(SClient &Client, const uint8_t *Message);
+    void FlushOutput(SClient &Client);
+
+    mutable std::mutex MMutex;
+    std::vector<std::unique_ptr<SClient>> MClients;
+    CLocalSocket MListener;
+    std::thread MThread;
+    std::atomic<bool> MStop{false};
+    std::mt19937_64 MRandom;
+};
+
+#endif
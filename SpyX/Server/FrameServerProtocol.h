@@ -0,0 +1,111 @@
+#ifndef TAPI_FRAME_SERVER_PROTOCOL_H
+#define TAPI_FRAME_SERVER_PROTOCOL_H
+
+#include "Core/ByteIO.h"
+#include "Imaging/ImageView.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Control channel between a frame server and its clients. Every message is a fixed
+// 64-byte little-endian record starting with its type, so either side can parse a stream
+// of them without framing.
+//
+//   Subscribe   client -> server  Format, ROI and rate; may be re-sent to renegotiate
+//   Ring        server -> client  Name of the shared-memory ring to (re)open
+//   FrameReady  server -> client  Doorbell: a frame was published into the ring
+//
+// Doorbells are wake-ups only. The server drops them for clients that stop reading, and
+// clients always take the newest frame from the ring rather than the one a doorbell names.
+
+static const size_t FrameServerMessageSize = 64;
+static const uint32_t FrameServerProtocolVersion = 1;
+static const size_t FrameServerMaxRingName = 48;
+
+enum class EFrameServerMessage : uint32_t
+{
+    Subscribe = 1,
+    Ring = 2,
+    FrameReady = 3
+};
+
+struct SFrameSubscription
+{
+    EPixelFormat Format = EPixelFormat::BGRA8;  // BGRA8 or Gray8
+    int RoiX = 0;
+    int RoiY = 0;
+    int RoiWidth = 0;               // 0 extends the ROI to the frame edge
+    int RoiHeight = 0;
+    int64_t MinInterval = 0;        // Minimum spacing of delivered frames, 100 ns units
+    int SlotCount = 4;              // Ring depth, 2..64
+};
+
+inline EFrameServerMessage GetMessageType(const uint8_t *Message)
+{
+    return (EFrameServerMessage)ReadU32(Message);
+}
+
+inline void EncodeSubscribe(const SFrameSubscription &Subscription, uint8_t *Message)
+{
+    std::memset(Message, 0, FrameServerMessageSize);
+    WriteU32(Message, (uint32_t)EFrameServerMessage::Subscribe);
+    WriteU32(Message + 4, FrameServerProtocolVersion);
+    WriteU32(Message + 8, (uint32_t)Subscription.Format);
+    WriteU32(Message + 12, (uint32_t)Subscription.RoiX);
+    WriteU32(Message + 16, (uint32_t)Subscription.RoiY);
+    WriteU32(Message + 20, (uint32_t)Subscription.RoiWidth);
+    WriteU32(Message + 24, (uint32_t)Subscription.RoiHeight);
+    WriteU64(Message + 28, (uint64_t)Subscription.MinInterval);
+    WriteU32(Message + 36, (uint32_t)Subscription.SlotCount);
+}
+
+// Fails on a version mismatch or values the server cannot honour
+inline bool DecodeSubscribe(const uint8_t *Message, SFrameSubscription &OutSubscription)
+{
+    if (ReadU32(Message + 4) != FrameServerProtocolVersion) return false;
+
+    OutSubscription.Format = (EPixelFormat)ReadU32(Message + 8);
+    OutSubscription.RoiX = (int)ReadU32(Message + 12);
+    OutSubscription.RoiY = (int)ReadU32(Message + 16);
+    OutSubscription.RoiWidth = (int)ReadU32(Message + 20);
+    OutSubscription.RoiHeight = (int)ReadU32(Message + 24);
+    OutSubscription.MinInterval = (int64_t)ReadU64(Message + 28);
+    OutSubscription.SlotCount = (int)ReadU32(Message + 36);
+
+    return (OutSubscription.Format == EPixelFormat::BGRA8 || OutSubscription.Format == EPixelFormat::Gray8) &&
+        OutSubscription.RoiX >= 0 && OutSubscription.RoiY >= 0 && OutSubscription.RoiWidth >= 0 &&
+        OutSubscription.RoiHeight >= 0 && OutSubscription.MinInterval >= 0 &&
+        OutSubscription.SlotCount >= 2 && OutSubscription.SlotCount <= 64;
+}
+
+inline bool EncodeRing(const std::string &Name, uint8_t *Message)
+{
+    if (Name.empty() || Name.size() > FrameServerMaxRingName) return false;
+
+    std::memset(Message, 0, FrameServerMessageSize);
+    WriteU32(Message, (uint32_t)EFrameServerMessage::Ring);
+    WriteU32(Message + 4, (uint32_t)Name.size());
+    std::memcpy(Message + 8, Name.data(), Name.size());
+    return true;
+}
+
+inline bool DecodeRing(const uint8_t *Message, std::string &OutName)
+{
+    uint32_t Length = ReadU32(Message + 4);
+    if (Length == 0 || Length > FrameServerMaxRingName) return false;
+
+    OutName.assign((const char *)Message + 8, Length);
+    return true;
+}
+
+inline void EncodeFrameReady(uint64_t PublishIndex, uint64_t Sequence, uint8_t *Message)
+{
+    std::memset(Message, 0, FrameServerMessageSize);
+    WriteU32(Message, (uint32_t)EFrameServerMessage::FrameReady);
+    WriteU64(Message + 8, PublishIndex);
+    WriteU64(Message + 16, Sequence);
+}
+
+#endif
@@ -0,0 +1,279 @@
+#include "ResultBoard.h"
+
+#include <atomic>
+#include <cstring>
+#include <new>
+
+static const uint32_t BoardMagic = 0x42525853;  // "SXRB"
+static const uint32_t BoardLayoutVersion = 1;
+static const size_t MaxFieldName = 31;
+
+struct SBoardHeader
+{
+    uint32_t Magic;
+    uint32_t LayoutVersion;
+    uint32_t HeaderSize;
+    uint32_t FieldCount;
+    uint32_t SchemaOffset;
+    uint32_t FieldDescriptorSize;
+    uint32_t RecordOffset;
+    uint32_t RecordSize;
+    std::atomic<uint64_t> Version;
+    uint8_t Reserved[24];
+};
+
+struct SFieldDescriptor
+{
+    char Name[32];
+    uint32_t Type;
+    uint32_t Offset;
+    uint32_t Count;
+    uint32_t Reserved;
+};
+
+static_assert(sizeof(SBoardHeader) == 64, "Board header layout is read by other processes");
+static_assert(sizeof(SFieldDescriptor) == 48, "Field descriptor layout is read by other processes");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared-memory atomics must be lock-free");
+
+static uint32_t GetTypeSize(EResultFieldType Type)
+{
+    switch (Type)
+    {
+        case EResultFieldType::Int32: return 4;
+        case EResultFieldType::Int64: return 8;
+        case EResultFieldType::Float32: return 4;
+        case EResultFieldType::Float64: return 8;
+    }
+    return 0;
+}
+
+static uint32_t AlignUp(uint32_t Value, uint32_t Alignment)
+{
+    return (Value + Alignment - 1) & ~(Alignment - 1);
+}
+
+static SBoardHeader *GetHeader(uint8_t *Data)
+{
+    return reinterpret_cast<SBoardHeader *>(Data);
+}
+
+CResultBoard::~CResultBoard()
+{
+    Close();
+}
+
+int CResultBoard::AddField(const std::string &Name, EResultFieldType Type, int Count)
+{
+    uint32_t TypeSize = GetTypeSize(Type);
+    if (MData || Name.empty() || Name.size() > MaxFieldName || TypeSize == 0 || Count < 1 || FindField(Name) >= 0)
+    {
+        return -1;
+    }
+
+    // Natural alignment keeps every field a single plain load for readers
+    SResultField Field;
+    Field.Name = Name;
+    Field.Type = Type;
+    Field.Offset = AlignUp(MRecordSize, TypeSize);
+    Field.Count = (uint32_t)Count;
+    MRecordSize = Field.Offset + TypeSize * Field.Count;
+
+    MFields.push_back(Field);
+    return (int)MFields.size() - 1;
+}
+
+int CResultBoard::FindField(const std::string &Name) const
+{
+    for (size_t Index = 0; Index < MFields.size(); Index++)
+    {
+        if (MFields[Index].Name == Name) return (int)Index;
+    }
+    return -1;
+}
+
+bool CResultBoard::Create(const std::string &Name)
+{
+    Close();
+
+    uint32_t SchemaSize = (uint32_t)(MFields.size() * sizeof(SFieldDescriptor));
+    uint32_t RecordOffset = AlignUp((uint32_t)sizeof(SBoardHeader) + SchemaSize, 64);
+    uint32_t RecordSize = AlignUp(MRecordSize > 0 ? MRecordSize : 8, 8);
+    size_t Size = (size_t)RecordOffset + RecordSize;
+
+    if (Name.empty())
+    {
+        MPrivate.reset(new uint64_t[Size / 8]());
+        MData = reinterpret_cast<uint8_t *>(MPrivate.get());
+    }
+    else
+    {
+        if (!MMemory.Create(Name, Size)) return false;
+        MData = MMemory.GetData();
+    }
+    MSize = Size;
+    MRecord = MData + RecordOffset;
+
+    SBoardHeader *Header = new (MData) SBoardHeader();
+    Header->Magic = BoardMagic;
+    Header->LayoutVersion = BoardLayoutVersion;
+    Header->HeaderSize = sizeof(SBoardHeader);
+    Header->FieldCount = (uint32_t)MFields.size();
+    Header->SchemaOffset = sizeof(SBoardHeader);
+    Header->FieldDescriptorSize = sizeof(SFieldDescriptor);
+    Header->RecordOffset = RecordOffset;
+    Header->RecordSize = RecordSize;
+    Header->Version.store(0, std::memory_order_relaxed);
+
+    SFieldDescriptor *Descriptors = reinterpret_cast<SFieldDescriptor *>(MData + sizeof(SBoardHeader));
+    for (size_t Index = 0; Index < MFields.size(); Index++)
+    {
+        SFieldDescriptor &Descriptor = Descriptors[Index];
+        std::memset(&Descriptor, 0, sizeof(Descriptor));
+        std::memcpy(Descriptor.Name, MFields[Index].Name.data(), MFields[Index].Name.size());
+        Descriptor.Type = (uint32_t)MFields[Index].Type;
+        Descriptor.Offset = MFields[Index].Offset;
+        Descriptor.Count = MFields[Index].Count;
+    }
+    return true;
+}
+
+void CResultBoard::Close()
+{
+    MMemory.Close();
+    MPrivate.reset();
+    MData = nullptr;
+    MRecord = nullptr;
+    MSize = 0;
+}
+
+void CResultBoard::BeginUpdate()
+{
+    MUpdateMutex.lock();
+    MIsUpdating = MData != nullptr;
+    if (!MIsUpdating) return;
+
+    std::atomic<uint64_t> &Version = GetHeader(MData)->Version;
+    Version.store(Version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void CResultBoard::EndUpdate()
+{
+    if (MIsUpdating)
+    {
+        std::atomic<uint64_t> &Version = GetHeader(MData)->Version;
+        Version.store(Version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        MIsUpdating = false;
+    }
+    MUpdateMutex.unlock();
+}
+
+uint8_t *CResultBoard::GetFieldAddress(int Field, EResultFieldType Type, int Element) const
+{
+    if (!MIsUpdating || Field < 0 || Field >= (int)MFields.size()) return nullptr;
+
+    const SResultField &Descriptor = MFields[Field];
+    if (Descriptor.Type != Type || Element < 0 || (uint32_t)Element >= Descriptor.Count) return nullptr;
+    return MRecord + Descriptor.Offset + (size_t)Element * GetTypeSize(Type);
+}
+
+void CResultBoard::SetInt32(int Field, int32_t Value, int Element)
+{
+    uint8_t *Address = GetFieldAddress(Field, EResultFieldType::Int32, Element);
+    if (Address) std::memcpy(Address, &Value, sizeof(Value));
+}
+
+void CResultBoard::SetInt64(int Field, int64_t Value, int Element)
+{
+    uint8_t *Address = GetFieldAddress(Field, EResultFieldType::Int64, Element);
+    if (Address) std::memcpy(Address, &Value, sizeof(Value));
+}
+
+void CResultBoard::SetFloat32(int Field, float Value, int Element)
+{
+    uint8_t *Address = GetFieldAddress(Field, EResultFieldType::Float32, Element);
+    if (Address) std::memcpy(Address, &Value, sizeof(Value));
+}
+
+void CResultBoard::SetFloat64(int Field, double Value, int Element)
+{
+    uint8_t *Address = GetFieldAddress(Field, EResultFieldType::Float64, Element);
+    if (Address) std::memcpy(Address, &Value, sizeof(Value));
+}
+
+bool CResultBoardReader::Open(const std::string &Name)
+{
+    Close();
+    if (!MMemory.Open(Name)) return false;
+
+    const uint8_t *Data = MMemory.GetData();
+    const size_t Size = MMemory.GetSize();
+    const SBoardHeader *Header = reinterpret_cast<const SBoardHeader *>(Data);
+
+    // Larger headers and descriptors from newer writers are fine, their prefix is ours
+    bool Valid = Size >= sizeof(SBoardHeader) && Header->Magic == BoardMagic &&
+        Header->LayoutVersion == BoardLayoutVersion && Header->HeaderSize >= sizeof(SBoardHeader) &&
+        Header->FieldDescriptorSize >= sizeof(SFieldDescriptor) &&
+        (uint64_t)Header->SchemaOffset + (uint64_t)Header->FieldCount * Header->FieldDescriptorSize <= Size &&
+        (uint64_t)Header->RecordOffset + Header->RecordSize <= Size;
+
+    for (uint32_t Index = 0; Valid && Index < Header->FieldCount; Index++)
+    {
+        const SFieldDescriptor *Descriptor = reinterpret_cast<const SFieldDescriptor *>(
+            Data + Header->SchemaOffset + (size_t)Index * Header->FieldDescriptorSize);
+
+        SResultField Field;
+        Field.Name.assign(Descriptor->Name, strnlen(Descriptor->Name, sizeof(Descriptor->Name)));
+        Field.Type = (EResultFieldType)Descriptor->Type;
+        Field.Offset = Descriptor->Offset;
+        Field.Count = Descriptor->Count;
+
+        // Unknown types are kept; a reader simply never asks for them
+        uint64_t TypeSize = GetTypeSize(Field.Type);
+        Valid = (uint64_t)Field.Offset + TypeSize * Field.Count <= Header->RecordSize;
+        MFields.push_back(Field);
+    }
+
+    if (!Valid)
+    {
+        Close();
+        return false;
+    }
+
+    MRecordOffset = Header->RecordOffset;
+    MRecordSize = Header->RecordSize;
+    return true;
+}
+
+int CResultBoardReader::FindField(const std::string &Name) const
+{
+    for (size_t Index = 0; Index < MFields.size(); Index++)
+    {
+        if (MFields[Index].Name == Name) return (int)Index;
+    }
+    return -1;
+}
+
+bool CResultBoardReader::ReadSnapshot(std::vector<uint8_t> &OutRecord, uint64_t &OutVersion) const
+{
+    if (!MMemory.IsOpen()) return false;
+
+    const SBoardHeader *Header = reinterpret_cast<const SBoardHeader *>(MMemory.GetData());
+    const uint8_t *Record = MMemory.GetData() + MRecordOffset;
+    OutRecord.resize(MRecordSize);
+
+    for (int Attempt = 0; Attempt < 1000; Attempt++)
+    {
+        uint64_t Before = Header->Version.load(std::memory_order_acquire);
+        if (Before & 1) continue;
+
+        std::memcpy(OutRecord.data(), Record, MRecordSize);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (Header->Version.load(std::memory_order_relaxed) == Before)
+        {
+            OutVersion = Before / 2;
+            return true;
+        }
+    }
+    return false;
+}
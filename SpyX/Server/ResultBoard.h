@@ -0,0 +1,120 @@
+#ifndef TAPI_RESULT_BOARD_H
+#define TAPI_RESULT_BOARD_H
+
+#include "Core/SharedMemory.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Flat region of per-frame results that consumers read with plain loads, e.g. a JVM
+// through a direct ByteBuffer, instead of one native call per value. The region is
+// self-describing, host-endian and laid out as
+//
+//   0   uint32 Magic 'SXRB'        24  uint32 RecordOffset
+//   4   uint32 LayoutVersion       28  uint32 RecordSize
+//   8   uint32 HeaderSize (64)     32  uint64 Version (sequence lock)
+//   12  uint32 FieldCount          40  reserved up to HeaderSize
+//   16  uint32 SchemaOffset
+//   20  uint32 FieldDescriptorSize (48)
+//
+// followed by FieldCount descriptors { char Name[32]; uint32 Type, Offset, Count, Reserved }
+// and the record. Readers look fields up by name once and keep the offsets, so fields can
+// be added without breaking them; LayoutVersion only changes if this header does.
+//
+// Version is odd while an update is in progress and advances by two per update. To read
+// consistently: load Version with acquire semantics and retry while it is odd, read the
+// fields, then load Version again and retry if it moved.
+
+enum class EResultFieldType : uint32_t
+{
+    Int32 = 1,
+    Int64 = 2,
+    Float32 = 3,
+    Float64 = 4
+};
+
+struct SResultField
+{
+    std::string Name;
+    EResultFieldType Type = EResultFieldType::Int32;
+    uint32_t Offset = 0;            // Byte offset within the record
+    uint32_t Count = 1;             // Elements, for fixed-size arrays
+};
+
+class CResultBoard
+{
+public:
+    CResultBoard() = default;
+    ~CResultBoard();
+
+    CResultBoard(const CResultBoard &) = delete;
+    CResultBoard &operator=(const CResultBoard &) = delete;
+
+    // Declares a field before Create. Names are at most 31 characters and unique.
+    // Returns the field index used by the setters, or -1.
+    int AddField(const std::string &Name, EResultFieldType Type, int Count = 1);
+
+    // Lays out the region in shared memory under Name, or in private memory if Name is
+    // empty (for readers in this process only)
+    bool Create(const std::string &Name);
+    void Close();
+    bool IsOpen() const { return MData != nullptr; }
+
+    const uint8_t *GetData() const { return MData; }
+    size_t GetSize() const { return MSize; }
+    const std::vector<SResultField> &GetFields() const { return MFields; }
+    int FindField(const std::string &Name) const;
+
+    // Field writes are only valid between BeginUpdate and EndUpdate. Fields not written
+    // keep their previous values. Updates from several threads are serialized.
+    void BeginUpdate();
+    void EndUpdate();
+
+    void SetInt32(int Field, int32_t Value, int Element = 0);
+    void SetInt64(int Field, int64_t Value, int Element = 0);
+    void SetFloat32(int Field, float Value, int Element = 0);
+    void SetFloat64(int Field, double Value, int Element = 0);
+
+private:
+    uint8_t *GetFieldAddress(int Field, EResultFieldType Type, int Element) const;
+
+    std::vector<SResultField> MFields;
+    uint32_t MRecordSize = 0;
+
+    CSharedMemory MMemory;
+    std::unique_ptr<uint64_t[]> MPrivate;
+    uint8_t *MData = nullptr;
+    uint8_t *MRecord = nullptr;
+    size_t MSize = 0;
+
+    std::mutex MUpdateMutex;
+    bool MIsUpdating = false;
+};
+
+// Native counterpart of the reader protocol, for consumers in other processes
+class CResultBoardReader
+{
+public:
+    bool Open(const std::string &Name);
+    void Close() { MMemory.Close(); MFields.clear(); }
+    bool IsOpen() const { return MMemory.IsOpen(); }
+
+    const std::vector<SResultField> &GetFields() const { return MFields; }
+    int FindField(const std::string &Name) const;
+
+    // Consistent copy of the record and its version. Fails only if the writer keeps
+    // updating for the whole retry budget.
+    bool ReadSnapshot(std::vector<uint8_t> &OutRecord, uint64_t &OutVersion) const;
+
+private:
+    CSharedMemory MMemory;
+    std::vector<SResultField> MFields;
+    uint32_t MRecordOffset = 0;
+    uint32_t MRecordSize = 0;
+};
+
+#endif
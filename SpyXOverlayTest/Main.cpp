@@ -16,6 +16,7 @@
 // Adjust these paths if your folder structure is different
 #include "Core/D3D11Context.h"
 #include "Overlay/WindowOverlay.h"
+#include "Imaging/ScreenshotService.h"
 
 #pragma comment(lib, "d3dcompiler.lib")
 #pragma comment(lib, "dwmapi.lib")
@@ -27,6 +28,7 @@
 // =============================================================
 CD3D11Context     g_D3DContext;
 CWindowOverlay    g_Overlay;
+CScreenshotService g_ScreenshotService;
 bool              g_RequestScreenshot = false;
 bool              g_AntiCapture = false;
 
@@ -103,68 +105,71 @@ bool ProtectCurrentProcess() {
 // =============================================================
 // SCREENSHOT HELPER
 // =============================================================
+// The screenshot is meant to show the overlay on top of its target, which only the
+// composited screen contains; a Windows.Graphics.Capture frame of the target window would
+// leave the overlay out. So the pixels still come from a screen BitBlt here, and only the
+// PNG encode and file write go to the screenshot service's thread.
 void CaptureScreenshot(HWND targetWindow)
 {
     RECT rect;
     GetWindowRect(targetWindow, &rect);
     int width = rect.right - rect.left;
     int height = rect.bottom - rect.top;
+    if (width <= 0 || height <= 0) return;
+
+    // Top-down 32bpp DIB section, so BitBlt lands directly in memory we can read
+    BITMAPINFO bi = {};
+    bi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bi.bmiHeader.biWidth = width;
+    bi.bmiHeader.biHeight = -height;
+    bi.bmiHeader.biPlanes = 1;
+    bi.bmiHeader.biBitCount = 32;
+    bi.bmiHeader.biCompression = BI_RGB;
 
     HDC hScreenDC = GetDC(NULL);
     HDC hMemoryDC = CreateCompatibleDC(hScreenDC);
-    HBITMAP hBitmap = CreateCompatibleBitmap(hScreenDC, width, height);
+    void* pixels = nullptr;
+    HBITMAP hBitmap = CreateDIBSection(hScreenDC, &bi, DIB_RGB_COLORS, &pixels, NULL, 0);
+    if (!hBitmap)
+    {
+        DeleteDC(hMemoryDC);
+        ReleaseDC(NULL, hScreenDC);
+        return;
+    }
     HBITMAP hOldBitmap = (HBITMAP)SelectObject(hMemoryDC, hBitmap);
 
     // Copy screen content
     BitBlt(hMemoryDC, 0, 0, width, height, hScreenDC, rect.left, rect.top, SRCCOPY);
-
-    // Save to file
-    BITMAP bmpScreen;
-    GetObject(hBitmap, sizeof(BITMAP), &bmpScreen);
-    BITMAPFILEHEADER   bmfHeader;
-    BITMAPINFOHEADER   bi;
-
-    bi.biSize = sizeof(BITMAPINFOHEADER);
-    bi.biWidth = bmpScreen.bmWidth;
-    bi.biHeight = bmpScreen.bmHeight;
-    bi.biPlanes = 1;
-    bi.biBitCount = 32;
-    bi.biCompression = BI_RGB;
-    bi.biSizeImage = 0;
-    bi.biXPelsPerMeter = 0;
-    bi.biYPelsPerMeter = 0;
-    bi.biClrUsed = 0;
-    bi.biClrImportant = 0;
-
-    DWORD dwBmpSize = ((bmpScreen.bmWidth * bi.biBitCount + 31) / 32) * 4 * bmpScreen.bmHeight;
-    HANDLE hDIB = GlobalAlloc(GHND, dwBmpSize);
-    char* lpbitmap = (char*)GlobalLock(hDIB);
-
-    GetDIBits(hScreenDC, hBitmap, 0, (UINT)bmpScreen.bmHeight, lpbitmap, (BITMAPINFO*)&bi, DIB_RGB_COLORS);
-
-    HANDLE hFile = CreateFile(L"screenshot.bmp", GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-    DWORD dwBytesWritten = 0;
-    
-    bmfHeader.bfType = 0x4D42; // BM
-    bmfHeader.bfSize = dwBmpSize + sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFOHEADER);
-    bmfHeader.bfReserved1 = 0;
-    bmfHeader.bfReserved2 = 0;
-    bmfHeader.bfOffBits = (DWORD)sizeof(BITMAPFILEHEADER) + (DWORD)sizeof(BITMAPINFOHEADER);
-
-    WriteFile(hFile, (LPSTR)&bmfHeader, sizeof(BITMAPFILEHEADER), &dwBytesWritten, NULL);
-    WriteFile(hFile, (LPSTR)&bi, sizeof(BITMAPINFOHEADER), &dwBytesWritten, NULL);
-    WriteFile(hFile, (LPSTR)lpbitmap, dwBmpSize, &dwBytesWritten, NULL);
-
-    CloseHandle(hFile);
-    GlobalUnlock(hDIB);
-    GlobalFree(hDIB);
+    GdiFlush();
+
+    // Hand the pixels to the encoder thread; PNG encoding and the file write happen there
+    SImageView frame;
+    frame.Data = static_cast<const uint8_t*>(pixels);
+    frame.Width = width;
+    frame.Height = height;
+    frame.Stride = width * 4;
+    frame.Format = EPixelFormat::BGRA8;
+    if (!g_ScreenshotService.Submit(frame, "screenshot.png", EImageFileFormat::PNG))
+    {
+        printf("Screenshot skipped, previous ones are still being saved\n");
+    }
 
     SelectObject(hMemoryDC, hOldBitmap);
     DeleteObject(hBitmap);
     DeleteDC(hMemoryDC);
     ReleaseDC(NULL, hScreenDC);
+}
 
-    printf("Screenshot saved to screenshot.bmp\n");
+void OnScreenshotSaved(const std::string &path, bool success)
+{
+    if (success)
+    {
+        printf("Screenshot saved to %s\n", path.c_str());
+    }
+    else
+    {
+        printf("Failed to save %s\n", path.c_str());
+    }
 }
 
 bool IsCursorOverImGui()
@@ -668,6 +673,8 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int) {
     FWindowProcedureDelegate wndProcCallback;
     wndProcCallback.BindStatic(WindowProcedureCallback);
     g_Overlay.SetWindowProcedureCallback(wndProcCallback);
+
+    g_ScreenshotService.SetCompletionCallback(OnScreenshotSaved);
     
     
     // 6. Main Loop
@@ -717,6 +724,9 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int) {
 
     if (g_hKeyboardHook) UnhookWindowsHookEx(g_hKeyboardHook);
 
+    // Let pending screenshots finish writing
+    g_ScreenshotService.Flush();
+
     // 7. Cleanup
     ImGui_ImplDX11_Shutdown();
     ImGui_ImplWin32_Shutdown();
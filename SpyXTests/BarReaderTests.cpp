@@ -0,0 +1,171 @@
+#include "TestFramework.h"
+#include "Analysis/BarReader.h"
+
+#include <cmath>
+#include <vector>
+
+// Bars drawn in all four orientations at every kind of fill level read back exactly when clean,
+// stay close with flipped pixels, and report lower confidence the noisier they get.
+
+static const uint32_t FillColor = 0xFFE03020u;
+static const uint32_t EmptyColor = 0xFF282828u;
+static const uint32_t BackgroundColor = 0xFFE03020u;    // Fill-coloured, so reading past the area shows
+
+struct STestFrame
+{
+    std::vector<uint8_t> Pixels;
+    SImageView View;
+
+    STestFrame(int Width, int Height, EPixelFormat Format)
+    {
+        View.Width = Width;
+        View.Height = Height;
+        View.Stride = Width * GetBytesPerPixel(Format);
+        View.Format = Format;
+        Pixels.resize((size_t)View.Stride * Height);
+        for (int Y = 0; Y < Height; Y++)
+        {
+            for (int X = 0; X < Width; X++) SetPixel(X, Y, BackgroundColor);
+        }
+        View.Data = Pixels.data();
+    }
+
+    // Gray8 frames take the green channel
+    void SetPixel(int X, int Y, uint32_t Color)
+    {
+        uint8_t *Pixel = &Pixels[(size_t)Y * View.Stride + (size_t)X * GetBytesPerPixel(View.Format)];
+        if (View.Format == EPixelFormat::Gray8)
+        {
+            Pixel[0] = (uint8_t)(Color >> 8);
+            return;
+        }
+        for (int Channel = 0; Channel < 4; Channel++) Pixel[Channel] = (uint8_t)(Color >> (Channel * 8));
+    }
+};
+
+// Draws a bar of Request's area filled Filled steps along its orientation. Each pixel flips to
+// the other colour with probability Noise percent.
+static void DrawBar(STestFrame &Frame, const SBarRequest &Request, int Filled, int Noise, CTestRandom &Random)
+{
+    const bool IsHorizontal = Request.Orientation == EBarOrientation::LeftToRight ||
+        Request.Orientation == EBarOrientation::RightToLeft;
+    const bool IsReversed = Request.Orientation == EBarOrientation::RightToLeft ||
+        Request.Orientation == EBarOrientation::BottomToTop;
+    const int Length = IsHorizontal ? Request.Width : Request.Height;
+    for (int Y = 0; Y < Request.Height; Y++)
+    {
+        for (int X = 0; X < Request.Width; X++)
+        {
+            int Step = IsHorizontal ? X : Y;
+            if (IsReversed) Step = Length - 1 - Step;
+            bool IsFilled = Step < Filled;
+            if (Random.Range(0, 99) < Noise) IsFilled = !IsFilled;
+            Frame.SetPixel(Request.X + X, Request.Y + Y, IsFilled ? FillColor : EmptyColor);
+        }
+    }
+}
+
+static SBarRequest MakeRequest(EBarOrientation Orientation, const SColorRange *Range)
+{
+    SBarRequest Request;
+    const bool IsHorizontal = Orientation == EBarOrientation::LeftToRight || Orientation == EBarOrientation::RightToLeft;
+    Request.X = 7;
+    Request.Y = 5;
+    Request.Width = IsHorizontal ? 150 : 12;
+    Request.Height = IsHorizontal ? 12 : 100;
+    Request.Orientation = Orientation;
+    Request.Ranges = Range;
+    Request.RangeCount = 1;
+    return Request;
+}
+
+SPYX_TEST(CleanBarsReadExactly)
+{
+    CTestRandom Random(49);
+    for (EPixelFormat Format : {EPixelFormat::BGRA8, EPixelFormat::Gray8})
+    {
+        // Gray8 pixels count as B = G = R of the green channel they were drawn from
+        const SColorRange Range = Format == EPixelFormat::Gray8 ? MakeColorRange(0xFF303030u, 4, 4, 4) :
+            MakeColorRange(FillColor, 12, 12, 12);
+        for (int Orientation = 0; Orientation < 4; Orientation++)
+        {
+            const SBarRequest Request = MakeRequest((EBarOrientation)Orientation, &Range);
+            const int Length = Orientation < 2 ? Request.Width : Request.Height;
+            for (int Filled : {0, Length, 1, Length - 1, Random.Range(2, Length - 2), Random.Range(2, Length - 2)})
+            {
+                STestFrame Frame(180, 120, Format);
+                DrawBar(Frame, Request, Filled, 0, Random);
+
+                CBarReader Reader;
+                SBarReading Reading;
+                SPYX_REQUIRE(Reader.Read(Frame.View, &Request, 1, &Reading) == 1);
+                SPYX_CHECK(Reading.IsValid);
+                SPYX_CHECK(Reading.Fraction == (float)Filled / Length);
+                SPYX_CHECK(Reading.Confidence == 1.0f);
+            }
+        }
+    }
+}
+
+SPYX_TEST(FlippedPixelsShiftLittleAndLowerConfidence)
+{
+    CTestRandom Random(490);
+    const SColorRange Range = MakeColorRange(FillColor, 12, 12, 12);
+    CBarReader Reader;
+    for (int Orientation = 0; Orientation < 4; Orientation++)
+    {
+        const SBarRequest Request = MakeRequest((EBarOrientation)Orientation, &Range);
+        const int Length = Orientation < 2 ? Request.Width : Request.Height;
+        for (int Trial = 0; Trial < 10; Trial++)
+        {
+            const int Filled = Random.Range(0, Length);
+            float Confidences[3];
+            const int Noises[3] = {3, 10, 50};
+            for (int Level = 0; Level < 3; Level++)
+            {
+                STestFrame Frame(180, 120, EPixelFormat::BGRA8);
+                DrawBar(Frame, Request, Filled, Noises[Level], Random);
+                SBarReading Reading;
+                SPYX_REQUIRE(Reader.Read(Frame.View, &Request, 1, &Reading) == 1);
+                Confidences[Level] = Reading.Confidence;
+                if (Level < 2) SPYX_CHECK(std::fabs(Reading.Fraction - (float)Filled / Length) <= 3.0f / Length);
+            }
+
+            // About 1 - 2 * Noise away from pure noise
+            SPYX_CHECK(Confidences[0] < 1.0f && Confidences[0] > 0.85f);
+            SPYX_CHECK(Confidences[1] < Confidences[0] && Confidences[1] > 0.65f);
+            SPYX_CHECK(Confidences[2] < 0.2f);
+        }
+    }
+}
+
+SPYX_TEST(InvalidBarsAreSkipped)
+{
+    CTestRandom Random(4900);
+    const SColorRange Range = MakeColorRange(FillColor, 12, 12, 12);
+    STestFrame Frame(180, 120, EPixelFormat::BGRA8);
+
+    // A bar hanging off the right edge is read over the part inside the frame
+    SBarRequest Bars[4];
+    Bars[0] = MakeRequest(EBarOrientation::LeftToRight, &Range);
+    Bars[0].X = 130;
+    DrawBar(Frame, Bars[0], 25, 0, Random);
+    Bars[1] = Bars[0];
+    Bars[1].X = 180;
+    Bars[2] = Bars[0];
+    Bars[2].RangeCount = 0;
+    Bars[3] = Bars[0];
+    Bars[3].Height = 0;
+
+    CBarReader Reader;
+    SBarReading Readings[4];
+    SPYX_REQUIRE(Reader.Read(Frame.View, Bars, 4, Readings) == 1);
+    SPYX_CHECK(Readings[0].IsValid && Readings[0].Fraction == 0.5f && Readings[0].Confidence == 1.0f);
+    for (int Index = 1; Index < 4; Index++)
+    {
+        SPYX_CHECK(!Readings[Index].IsValid && Readings[Index].Fraction == 0.0f && Readings[Index].Confidence == 0.0f);
+    }
+
+    Frame.View.Format = EPixelFormat::RGBA16F;
+    SPYX_CHECK(Reader.Read(Frame.View, Bars, 1, Readings) == -1);
+}
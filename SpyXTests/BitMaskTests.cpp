@@ -0,0 +1,163 @@
+#include "TestFramework.h"
+#include "Imaging/BitMask.h"
+
+#include <algorithm>
+#include <vector>
+
+// Packing against the byte-at-a-time reference, and counts, bounds and runs of the packed
+// form against the same figures taken straight from the bytes, with garbage in the bits past
+// each row's width and in the padding after it.
+
+struct STestMask
+{
+    std::vector<uint8_t> Bytes;
+    int Width = 0;
+    int Height = 0;
+};
+
+// Runs of random bytes, zero bytes and bytes at the test value, or all one of them
+static STestMask MakeMask(CTestRandom &Random, uint8_t Value)
+{
+    STestMask Mask;
+    Mask.Width = Random.Range(1, 300);
+    Mask.Height = Random.Range(1, 12);
+    Mask.Bytes.resize((size_t)Mask.Width * Mask.Height);
+
+    const int Fill = Random.Range(0, 9);
+    size_t Index = 0;
+    while (Index < Mask.Bytes.size())
+    {
+        const int Kind = Fill < 3 ? Fill : Random.Range(0, 2);
+        const size_t End = std::min(Mask.Bytes.size(), Index + (size_t)Random.Range(1, 40));
+        for (; Index < End; Index++)
+        {
+            Mask.Bytes[Index] = Kind == 0 ? 0 : Kind == 1 ? Value : (uint8_t)Random.Next();
+        }
+    }
+    return Mask;
+}
+
+static bool IsPassing(uint8_t Byte, EMaskTest Test, uint8_t Value)
+{
+    if (Test == EMaskTest::Equal) return Byte == Value;
+    if (Test == EMaskTest::AtLeast) return Byte >= Value;
+    return Byte != 0;
+}
+
+SPYX_TEST(PackedRowsMatchReference)
+{
+    CTestRandom Random(47);
+    for (int Trial = 0; Trial < 600; Trial++)
+    {
+        const EMaskTest Test = (EMaskTest)(Trial % 3);
+        const uint8_t Value = (uint8_t)Random.Range(0, 255);
+        const STestMask Mask = MakeMask(Random, Value);
+        const int Stride = GetBitMaskStride(Mask.Width);
+
+        // One spare byte past the row shows neither version writes beyond it
+        std::vector<uint8_t> Packed((size_t)Stride + 1, 0xCD);
+        std::vector<uint8_t> Expected((size_t)Stride + 1, 0xCD);
+        for (int Y = 0; Y < Mask.Height; Y++)
+        {
+            const uint8_t *Row = &Mask.Bytes[(size_t)Y * Mask.Width];
+            PackMaskRow(Row, Mask.Width, Test, Value, Packed.data());
+            PackMaskRowReference(Row, Mask.Width, Test, Value, Expected.data());
+            SPYX_CHECK(Packed == Expected);
+            SPYX_CHECK(Packed[Stride] == 0xCD);
+            for (int X = 0; X < Stride * 8; X++)
+            {
+                const bool IsSet = (Packed[X / 8] >> (X & 7) & 1) != 0;
+                SPYX_CHECK(IsSet == (X < Mask.Width && IsPassing(Row[X], Test, Value)));
+            }
+        }
+    }
+}
+
+SPYX_TEST(PackedFormsMatchByteCounts)
+{
+    CTestRandom Random(470);
+    for (int Trial = 0; Trial < 600; Trial++)
+    {
+        const EMaskTest Test = (EMaskTest)(Trial % 3);
+        const uint8_t Value = (uint8_t)Random.Range(1, 255);
+        const STestMask Mask = MakeMask(Random, Value);
+        const int Stride = GetBitMaskStride(Mask.Width) + Random.Range(0, 5);
+
+        // Packed rows, then set bits past the width and in the padding
+        std::vector<uint8_t> Bits((size_t)Stride * Mask.Height);
+        for (int Y = 0; Y < Mask.Height; Y++)
+        {
+            uint8_t *Row = &Bits[(size_t)Y * Stride];
+            PackMaskRow(&Mask.Bytes[(size_t)Y * Mask.Width], Mask.Width, Test, Value, Row);
+            if (Mask.Width & 7) Row[Mask.Width / 8] |= (uint8_t)(0xFF << (Mask.Width & 7));
+            for (int Byte = GetBitMaskStride(Mask.Width); Byte < Stride; Byte++) Row[Byte] = (uint8_t)Random.Next();
+        }
+
+        uint64_t ExpectedCount = 0;
+        int Left = Mask.Width;
+        int Right = -1;
+        int Top = -1;
+        int Bottom = -1;
+        std::vector<SMaskRun> ExpectedRuns;
+        std::vector<int32_t> RowStarts;
+        for (int Y = 0; Y < Mask.Height; Y++)
+        {
+            RowStarts.push_back((int32_t)ExpectedRuns.size());
+            const uint8_t *Row = &Mask.Bytes[(size_t)Y * Mask.Width];
+            for (int X = 0; X < Mask.Width; X++)
+            {
+                if (!IsPassing(Row[X], Test, Value)) continue;
+                ExpectedCount++;
+                Left = std::min(Left, X);
+                Right = std::max(Right, X);
+                if (Top < 0) Top = Y;
+                Bottom = Y;
+                if (X > 0 && IsPassing(Row[X - 1], Test, Value))
+                {
+                    ExpectedRuns.back().Length++;
+                    continue;
+                }
+                SMaskRun Run;
+                Run.X = X;
+                Run.Length = 1;
+                ExpectedRuns.push_back(Run);
+            }
+        }
+        RowStarts.push_back((int32_t)ExpectedRuns.size());
+
+        SPYX_CHECK(CountMaskBits(Bits.data(), Stride, Mask.Width, Mask.Height) == ExpectedCount);
+
+        SMaskBounds Bounds;
+        SMaskBounds RunBounds;
+        const bool HasBounds = GetMaskBounds(Bits.data(), Stride, Mask.Width, Mask.Height, Bounds);
+        SPYX_CHECK(HasBounds == (ExpectedCount > 0));
+        if (HasBounds)
+        {
+            SPYX_CHECK(Bounds.X == Left && Bounds.Y == Top);
+            SPYX_CHECK(Bounds.Width == Right - Left + 1 && Bounds.Height == Bottom - Top + 1);
+        }
+        else
+        {
+            SPYX_CHECK(Bounds.Width == 0 && Bounds.Height == 0);
+        }
+
+        // Runs are appended after whatever the list already holds
+        std::vector<SMaskRun> Runs(1);
+        for (int Y = 0; Y < Mask.Height; Y++)
+        {
+            const size_t Before = Runs.size();
+            EncodeMaskRuns(&Bits[(size_t)Y * Stride], Mask.Width, Runs);
+            SPYX_CHECK(Runs.size() - Before == (size_t)(RowStarts[Y + 1] - RowStarts[Y]));
+        }
+        SPYX_REQUIRE(Runs.size() == ExpectedRuns.size() + 1);
+        for (size_t Index = 0; Index < ExpectedRuns.size(); Index++)
+        {
+            SPYX_CHECK(Runs[Index + 1].X == ExpectedRuns[Index].X && Runs[Index + 1].Length == ExpectedRuns[Index].Length);
+        }
+
+        SPYX_CHECK(CountRunPixels(RowStarts.data(), ExpectedRuns.data(), Mask.Height) == ExpectedCount);
+        SPYX_CHECK(GetRunBounds(RowStarts.data(), ExpectedRuns.data(), Mask.Height, RunBounds) == HasBounds);
+        SPYX_CHECK(RunBounds.X == Bounds.X && RunBounds.Y == Bounds.Y);
+        SPYX_CHECK(RunBounds.Width == Bounds.Width && RunBounds.Height == Bounds.Height);
+    }
+}
@@ -0,0 +1,287 @@
+#include "TestFramework.h"
+#include "Analysis/BlobDetector.h"
+
+#include <algorithm>
+#include <vector>
+
+// Components against a flood fill over random masks tall enough to cross several parallel
+// strips, for any thread count, both connectivities, label maps, MinArea and MaxBlobs.
+
+// Gray8 mask with padding past each row
+struct STestMask
+{
+    std::vector<uint8_t> Pixels;
+    int Width = 0;
+    int Height = 0;
+    int Stride = 0;
+
+    STestMask(int MaskWidth, int MaskHeight, int Padding)
+        : Pixels((size_t)(MaskWidth + Padding) * MaskHeight, 0), Width(MaskWidth), Height(MaskHeight), Stride(MaskWidth + Padding)
+    {
+    }
+
+    uint8_t &At(int X, int Y) { return Pixels[(size_t)Y * Stride + X]; }
+    uint8_t At(int X, int Y) const { return Pixels[(size_t)Y * Stride + X]; }
+
+    SImageView GetView() const
+    {
+        SImageView View;
+        View.Data = Pixels.data();
+        View.Width = Width;
+        View.Height = Height;
+        View.Stride = Stride;
+        View.Format = EPixelFormat::Gray8;
+        return View;
+    }
+};
+
+// Mix of noise, rectangles and long lines, so components run across strip edges and touch
+// only diagonally. Padding holds non-zero garbage that must never be read.
+static STestMask MakeMask(CTestRandom &Random, bool IsLabelMap)
+{
+    STestMask Mask(Random.Range(1, 150), Random.Range(1, 300), Random.Range(0, 9));
+    std::fill(Mask.Pixels.begin(), Mask.Pixels.end(), (uint8_t)0xEE);
+    auto NextLabel = [&] { return (uint8_t)(IsLabelMap ? Random.Range(1, 3) : Random.Range(1, 255)); };
+
+    const int Density = Random.Range(0, 60);
+    for (int Y = 0; Y < Mask.Height; Y++)
+    {
+        for (int X = 0; X < Mask.Width; X++) Mask.At(X, Y) = Random.Range(0, 99) < Density ? NextLabel() : 0;
+    }
+    const int Shapes = Random.Range(0, 12);
+    for (int Shape = 0; Shape < Shapes; Shape++)
+    {
+        const uint8_t Label = NextLabel();
+        int Left = Random.Range(0, Mask.Width - 1);
+        int Top = Random.Range(0, Mask.Height - 1);
+        int Right = std::min(Mask.Width - 1, Left + Random.Range(0, 40));
+        int Bottom = std::min(Mask.Height - 1, Top + Random.Range(0, 140));
+        if (Shape % 3 == 1) Right = Left;
+        if (Shape % 3 == 2) Bottom = Top;
+        for (int Y = Top; Y <= Bottom; Y++)
+        {
+            for (int X = Left; X <= Right; X++) Mask.At(X, Y) = Label;
+        }
+    }
+    return Mask;
+}
+
+struct SReferenceComponent
+{
+    int Left;
+    int Top;
+    int Right;
+    int Bottom;
+    int64_t Area = 0;
+    int64_t SumX = 0;
+    int64_t SumY = 0;
+    uint64_t Sums[4] = {};
+    uint8_t Label;
+};
+
+// Flood fill from each unvisited pixel in raster order, which is also the scan order of the
+// components' first runs
+static std::vector<SReferenceComponent> FloodFill(const STestMask &Mask, const SBlobOptions &Options,
+    const SBlobColorSource *Colors)
+{
+    std::vector<int> Visited((size_t)Mask.Width * Mask.Height, 0);
+    std::vector<SReferenceComponent> Components;
+    std::vector<int> Stack;
+    for (int StartY = 0; StartY < Mask.Height; StartY++)
+    {
+        for (int StartX = 0; StartX < Mask.Width; StartX++)
+        {
+            if (!Mask.At(StartX, StartY) || Visited[(size_t)StartY * Mask.Width + StartX]) continue;
+
+            SReferenceComponent Component;
+            Component.Left = Component.Right = StartX;
+            Component.Top = Component.Bottom = StartY;
+            Component.Label = Mask.At(StartX, StartY);
+            Visited[(size_t)StartY * Mask.Width + StartX] = 1;
+            Stack.assign(1, StartY * Mask.Width + StartX);
+            while (!Stack.empty())
+            {
+                const int X = Stack.back() % Mask.Width;
+                const int Y = Stack.back() / Mask.Width;
+                Stack.pop_back();
+                Component.Left = std::min(Component.Left, X);
+                Component.Right = std::max(Component.Right, X);
+                Component.Top = std::min(Component.Top, Y);
+                Component.Bottom = std::max(Component.Bottom, Y);
+                Component.Area++;
+                Component.SumX += X;
+                Component.SumY += Y;
+                if (Colors)
+                {
+                    const SImageView &Frame = Colors->Frame;
+                    const int FrameX = std::min(std::max(Colors->X + X * Colors->Step + Colors->Step / 2, 0), Frame.Width - 1);
+                    const int FrameY = std::min(std::max(Colors->Y + Y * Colors->Step + Colors->Step / 2, 0), Frame.Height - 1);
+                    const uint8_t *Pixel = Frame.Row(FrameY) + (size_t)FrameX * 4;
+                    for (int Channel = 0; Channel < 4; Channel++) Component.Sums[Channel] += Pixel[Channel];
+                }
+
+                for (int DeltaY = -1; DeltaY <= 1; DeltaY++)
+                {
+                    for (int DeltaX = -1; DeltaX <= 1; DeltaX++)
+                    {
+                        if (!DeltaX && !DeltaY) continue;
+                        if (DeltaX && DeltaY && !Options.IsEightConnected) continue;
+                        const int NextX = X + DeltaX;
+                        const int NextY = Y + DeltaY;
+                        if (NextX < 0 || NextY < 0 || NextX >= Mask.Width || NextY >= Mask.Height) continue;
+                        const uint8_t Value = Mask.At(NextX, NextY);
+                        if (!Value || (Options.IsLabelMap && Value != Component.Label)) continue;
+                        int &Seen = Visited[(size_t)NextY * Mask.Width + NextX];
+                        if (Seen) continue;
+                        Seen = 1;
+                        Stack.push_back(NextY * Mask.Width + NextX);
+                    }
+                }
+            }
+            Components.push_back(Component);
+        }
+    }
+    return Components;
+}
+
+// Compares Detect's output with the flood fill, after the same filtering and ordering
+static bool MatchesReference(const STestMask &Mask, const SBlobOptions &Options, const SBlobColorSource *Colors,
+    int Passed, const std::vector<SBlob> &Blobs)
+{
+    const std::vector<SReferenceComponent> Components = FloodFill(Mask, Options, Colors);
+    std::vector<int> Kept;
+    for (int Index = 0; Index < (int)Components.size(); Index++)
+    {
+        if (Components[Index].Area >= Options.MinArea) Kept.push_back(Index);
+    }
+    if (Passed != (int)Kept.size()) return false;
+    std::stable_sort(Kept.begin(), Kept.end(), [&](int First, int Second) { return Components[First].Area > Components[Second].Area; });
+    if (Options.MaxBlobs > 0 && (int)Kept.size() > Options.MaxBlobs) Kept.resize((size_t)Options.MaxBlobs);
+    if (Blobs.size() != Kept.size()) return false;
+
+    for (size_t Slot = 0; Slot < Kept.size(); Slot++)
+    {
+        const SReferenceComponent &Expected = Components[Kept[Slot]];
+        const SBlob &Blob = Blobs[Slot];
+        if (Blob.X != Expected.Left || Blob.Y != Expected.Top || Blob.Width != Expected.Right - Expected.Left + 1 ||
+            Blob.Height != Expected.Bottom - Expected.Top + 1 || Blob.Area != Expected.Area || Blob.Label != Expected.Label)
+        {
+            return false;
+        }
+        if (Blob.CentroidX != (float)((double)Expected.SumX / Expected.Area)) return false;
+        if (Blob.CentroidY != (float)((double)Expected.SumY / Expected.Area)) return false;
+
+        uint32_t MeanColor = 0;
+        for (int Channel = 0; Colors && Channel < 4; Channel++)
+        {
+            MeanColor |= (uint32_t)((Expected.Sums[Channel] + (uint64_t)Expected.Area / 2) / (uint64_t)Expected.Area) << (Channel * 8);
+        }
+        if (Blob.MeanColor != MeanColor) return false;
+    }
+    return true;
+}
+
+SPYX_TEST(RandomMasksMatchFloodFill)
+{
+    CTestRandom Random(46);
+    for (int Trial = 0; Trial < 300; Trial++)
+    {
+        SBlobOptions Options;
+        Options.IsLabelMap = Trial % 2 == 1;
+        Options.IsEightConnected = Trial / 2 % 2 == 1;
+        Options.MinArea = Random.Range(0, 3) == 0 ? Random.Range(2, 30) : 1;
+        Options.MaxBlobs = Random.Range(0, 2) == 0 ? Random.Range(1, 10) : 0;
+        const STestMask Mask = MakeMask(Random, Options.IsLabelMap);
+
+        CBlobDetector Detector(Random.Range(1, 8));
+        std::vector<SBlob> Blobs;
+        const int Passed = Detector.Detect(Mask.GetView(), Options, nullptr, Blobs);
+        SPYX_CHECK(MatchesReference(Mask, Options, nullptr, Passed, Blobs));
+    }
+}
+
+SPYX_TEST(ResultsMatchForAnyThreadCount)
+{
+    CTestRandom Random(460);
+    CBlobDetector Single(1);
+    CBlobDetector Pair(2);
+    CBlobDetector Many(7);
+    for (int Trial = 0; Trial < 60; Trial++)
+    {
+        SBlobOptions Options;
+        Options.IsLabelMap = Random.Range(0, 1) == 1;
+        Options.IsEightConnected = Random.Range(0, 1) == 1;
+        const STestMask Mask = MakeMask(Random, Options.IsLabelMap);
+
+        // Detectors are reused, so state left by a larger mask must not leak into a smaller one
+        std::vector<SBlob> Expected;
+        std::vector<SBlob> Blobs;
+        const int Passed = Single.Detect(Mask.GetView(), Options, nullptr, Expected);
+        SPYX_CHECK(MatchesReference(Mask, Options, nullptr, Passed, Expected));
+        for (CBlobDetector *Detector : {&Pair, &Many})
+        {
+            SPYX_CHECK(Detector->Detect(Mask.GetView(), Options, nullptr, Blobs) == Passed);
+            SPYX_REQUIRE(Blobs.size() == Expected.size());
+            for (size_t Slot = 0; Slot < Blobs.size(); Slot++)
+            {
+                SPYX_CHECK(Blobs[Slot].X == Expected[Slot].X && Blobs[Slot].Y == Expected[Slot].Y);
+                SPYX_CHECK(Blobs[Slot].Width == Expected[Slot].Width && Blobs[Slot].Height == Expected[Slot].Height);
+                SPYX_CHECK(Blobs[Slot].Area == Expected[Slot].Area && Blobs[Slot].Label == Expected[Slot].Label);
+                SPYX_CHECK(Blobs[Slot].CentroidX == Expected[Slot].CentroidX && Blobs[Slot].CentroidY == Expected[Slot].CentroidY);
+            }
+        }
+    }
+}
+
+SPYX_TEST(MeanColorsMatchFloodFill)
+{
+    CTestRandom Random(4600);
+    for (int Trial = 0; Trial < 40; Trial++)
+    {
+        SBlobOptions Options;
+        Options.IsLabelMap = true;
+        const STestMask Mask = MakeMask(Random, true);
+
+        // A frame a little smaller than the mask covers, so edge samples are clamped
+        SBlobColorSource Colors;
+        Colors.Step = Random.Range(1, 3);
+        Colors.X = Random.Range(-3, 3);
+        Colors.Y = Random.Range(-3, 3);
+        const int FrameWidth = std::max(1, Mask.Width * Colors.Step - 2);
+        const int FrameHeight = std::max(1, Mask.Height * Colors.Step - 2);
+        std::vector<uint8_t> Pixels((size_t)FrameWidth * FrameHeight * 4);
+        for (uint8_t &Byte : Pixels) Byte = (uint8_t)Random.Next();
+        Colors.Frame.Data = Pixels.data();
+        Colors.Frame.Width = FrameWidth;
+        Colors.Frame.Height = FrameHeight;
+        Colors.Frame.Stride = FrameWidth * 4;
+        Colors.Frame.Format = EPixelFormat::BGRA8;
+
+        CBlobDetector Detector(Random.Range(1, 8));
+        std::vector<SBlob> Blobs;
+        const int Passed = Detector.Detect(Mask.GetView(), Options, &Colors, Blobs);
+        SPYX_CHECK(MatchesReference(Mask, Options, &Colors, Passed, Blobs));
+    }
+}
+
+SPYX_TEST(InvalidInputsAreRejected)
+{
+    STestMask Mask(8, 8, 0);
+    Mask.At(2, 2) = 1;
+    SImageView View = Mask.GetView();
+    CBlobDetector Detector(2);
+    std::vector<SBlob> Blobs(3);
+
+    View.Format = EPixelFormat::BGRA8;
+    SPYX_CHECK(Detector.Detect(View, SBlobOptions(), nullptr, Blobs) == -1);
+    SPYX_CHECK(Blobs.empty());
+
+    SBlobColorSource Colors;
+    Colors.Frame = Mask.GetView();
+    Colors.Step = 0;
+    SPYX_CHECK(Detector.Detect(Mask.GetView(), SBlobOptions(), &Colors, Blobs) == -1);
+    Colors.Step = 1;
+    SPYX_CHECK(Detector.Detect(Mask.GetView(), SBlobOptions(), &Colors, Blobs) == 1);
+    SPYX_REQUIRE(Blobs.size() == 1);
+    SPYX_CHECK(Blobs[0].MeanColor == 0xFF010101u);
+}
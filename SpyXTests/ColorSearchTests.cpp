@@ -0,0 +1,155 @@
+#include "TestFramework.h"
+#include "Analysis/ColorSearch.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <vector>
+
+// Random palettes against a per-pixel reference, and search areas whose edges used to
+// overflow 32-bit arithmetic.
+
+static bool IsInRanges(const uint8_t *Pixel, bool IsGray, const std::vector<SColorRange> &Ranges)
+{
+    for (const SColorRange &Range : Ranges)
+    {
+        bool IsInside = true;
+        for (int Channel = 0; Channel < 3; Channel++)
+        {
+            int Value = IsGray ? Pixel[0] : Pixel[Channel];
+            IsInside &= Value >= (int)((Range.Low >> (8 * Channel)) & 0xFF) &&
+                Value <= (int)((Range.High >> (8 * Channel)) & 0xFF);
+        }
+        if (IsInside) return true;
+    }
+    return false;
+}
+
+SPYX_TEST(RandomSearchesMatchReference)
+{
+    CTestRandom Random(3);
+    CColorSearch Search;
+    for (int Trial = 0; Trial < 300; Trial++)
+    {
+        const int Width = Random.Range(1, 90);
+        const int Height = Random.Range(1, 60);
+        const bool IsGray = Random.Next() % 2;
+        const int BytesPerPixel = IsGray ? 1 : 4;
+
+        // A few palette colours, a third of the pixels perturbed
+        uint32_t Palette[6];
+        for (uint32_t &Color : Palette) Color = Random.Next();
+        const int PaletteSize = Random.Range(2, 5);
+        std::vector<uint8_t> Pixels((size_t)Width * Height * BytesPerPixel);
+        for (size_t Index = 0; Index < (size_t)Width * Height; Index++)
+        {
+            uint32_t Color = Palette[Random.Next() % PaletteSize];
+            if (Random.Next() % 3 == 0) Color ^= Random.Next() % 0x0F0F0F;
+            if (IsGray) Pixels[Index] = (uint8_t)Color;
+            else std::memcpy(&Pixels[Index * 4], &Color, 4);
+        }
+        SImageView Frame;
+        Frame.Data = Pixels.data();
+        Frame.Width = Width;
+        Frame.Height = Height;
+        Frame.Stride = Width * BytesPerPixel;
+        Frame.Format = IsGray ? EPixelFormat::Gray8 : EPixelFormat::BGRA8;
+
+        std::vector<SColorRange> Ranges((size_t)Random.Range(1, 4));
+        for (SColorRange &Range : Ranges)
+        {
+            uint32_t Color = Palette[Random.Next() % PaletteSize];
+            if (IsGray) Color = (Color & 0xFF) * 0x010101u;
+            const int Tolerance = Random.Range(0, 30);
+            Range = MakeColorRange(Color, Tolerance, Random.Range(0, 30), Tolerance);
+        }
+
+        SColorSearchOptions Options;
+        Options.Mode = Random.Next() % 4 ? EColorSearchMode::AllHits : EColorSearchMode::FirstHit;
+        Options.MergeGap = Random.Range(1, 3);
+        if (Random.Next() % 2)
+        {
+            Options.RoiX = Random.Range(-5, 14);
+            Options.RoiY = Random.Range(-5, 14);
+            Options.RoiWidth = Random.Range(1, Width);
+            Options.RoiHeight = Random.Range(1, Height);
+        }
+
+        const SPixelRect Area = ClipToFrame(Options.RoiX, Options.RoiY, Options.RoiWidth, Options.RoiHeight, Width,
+            Height);
+        std::vector<int32_t> Expected;
+        std::vector<uint8_t> IsHit((size_t)Width * Height, 0);
+        for (int Y = Area.Top; Y < Area.Bottom; Y++)
+        {
+            for (int X = Area.Left; X < Area.Right; X++)
+            {
+                if (!IsInRanges(&Pixels[((size_t)Y * Width + X) * BytesPerPixel], IsGray, Ranges)) continue;
+                Expected.push_back(X);
+                Expected.push_back(Y);
+                IsHit[(size_t)Y * Width + X] = 1;
+            }
+        }
+
+        std::vector<int32_t> Points(Expected.size() + 2);
+        std::vector<SColorBox> Boxes;
+        const int MaxPoints = (int)Points.size() / 2;
+        int Count = Search.Search(Frame, Ranges.data(), (int)Ranges.size(), Options, Points.data(), MaxPoints, &Boxes);
+        const int ExpectedCount = (int)Expected.size() / 2;
+        if (Options.Mode == EColorSearchMode::FirstHit)
+        {
+            SPYX_REQUIRE(Count == std::min(ExpectedCount, 1));
+            SPYX_CHECK(Boxes.empty());
+        }
+        else
+        {
+            SPYX_REQUIRE(Count == ExpectedCount);
+        }
+        SPYX_CHECK(std::equal(Points.begin(), Points.begin() + 2 * Count, Expected.begin()));
+
+        // Boxes are tight, account for every hit and stay MergeGap apart
+        int BoxedHits = 0;
+        for (size_t Index = 0; Index < Boxes.size(); Index++)
+        {
+            const SColorBox &Box = Boxes[Index];
+            int Hits = 0;
+            for (int Y = Box.Y; Y < Box.Y + Box.Height; Y++)
+            {
+                for (int X = Box.X; X < Box.X + Box.Width; X++) Hits += IsHit[(size_t)Y * Width + X];
+            }
+            SPYX_CHECK(Hits == Box.Count);
+            BoxedHits += Box.Count;
+
+            for (size_t Other = Index + 1; Other < Boxes.size(); Other++)
+            {
+                const SColorBox &Next = Boxes[Other];
+                const int Gap = Options.MergeGap;
+                SPYX_CHECK(Next.X > Box.X + Box.Width - 1 + Gap || Next.X + Next.Width - 1 < Box.X - Gap ||
+                    Next.Y > Box.Y + Box.Height - 1 + Gap || Next.Y + Next.Height - 1 < Box.Y - Gap);
+            }
+        }
+        if (Options.Mode == EColorSearchMode::AllHits) SPYX_CHECK(BoxedHits == Count);
+    }
+}
+
+SPYX_TEST(AreaEdgesPastIntMaxClip)
+{
+    std::vector<uint32_t> Pixels(32 * 16, 0xFF102030u);
+    Pixels[5 * 32 + 20] = 0xFFFF0000u;
+    Pixels[15 * 32 + 31] = 0xFFFF0000u;
+    SImageView Frame;
+    Frame.Data = reinterpret_cast<const uint8_t *>(Pixels.data());
+    Frame.Width = 32;
+    Frame.Height = 16;
+    Frame.Stride = 32 * 4;
+    const SColorRange Red = MakeColorRange(0xFFFF0000u, 4, 4, 4);
+
+    CColorSearch Search;
+    SColorSearchOptions Options;
+    Options.RoiX = 1;
+    Options.RoiY = 1;
+    Options.RoiWidth = INT_MAX;
+    Options.RoiHeight = INT_MAX;
+    int32_t Points[4];
+    SPYX_CHECK(Search.Search(Frame, &Red, 1, Options, Points, 2, nullptr) == 2);
+    SPYX_CHECK(Points[0] == 20 && Points[1] == 5 && Points[2] == 31 && Points[3] == 15);
+}
@@ -0,0 +1,76 @@
+#include "TestFramework.h"
+#include "SyntheticUi.h"
+#include "Recording/FrameCodec.h"
+
+#include <thread>
+#include <vector>
+
+// Encode and decode speed of the recording codec on a 2560x1440 synthetic UI sequence of
+// 60 frames, single-threaded and on up to four threads. Usage: FrameCodecBench [repeats]
+int main(int ArgumentCount, char **Arguments)
+{
+    const int Repeats = GetRepeatCount(ArgumentCount, Arguments, 3);
+    const int Width = 2560;
+    const int Height = 1440;
+    const int FrameCount = 60;
+
+    // Rendering is not part of the measurement
+    CSyntheticUi Ui(Width, Height);
+    std::vector<std::vector<uint8_t>> Frames(FrameCount);
+    for (int Frame = 0; Frame < FrameCount; Frame++)
+    {
+        SImageView View = Ui.Render(Frame);
+        Frames[Frame].assign(View.Data, View.Data + (size_t)Width * Height * 4);
+    }
+    auto ViewOf = [&](int Frame)
+    {
+        SImageView View;
+        View.Data = Frames[Frame].data();
+        View.Width = Width;
+        View.Height = Height;
+        View.Stride = Width * 4;
+        return View;
+    };
+
+    const int MaxThreads = (int)std::min(4u, std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<int> ThreadCounts = {1};
+    if (MaxThreads > 1) ThreadCounts.push_back(MaxThreads);
+    for (int ThreadCount : ThreadCounts)
+    {
+        SFrameCodecSettings Settings;
+        Settings.ThreadCount = ThreadCount;
+        std::vector<std::vector<uint8_t>> Encoded(FrameCount);
+        size_t EncodedBytes = 0;
+        size_t KeyframeBytes = 0;
+        double KeyframeMs = 0.0;
+
+        double EncodeMs = MeasureBestMilliseconds(Repeats, [&]
+        {
+            CFrameEncoder Encoder(Settings);
+            EncodedBytes = 0;
+            for (int Frame = 0; Frame < FrameCount; Frame++)
+            {
+                Encoder.Encode(ViewOf(Frame), Encoded[Frame]);
+                EncodedBytes += Encoded[Frame].size();
+            }
+        });
+        KeyframeMs = MeasureBestMilliseconds(Repeats, [&]
+        {
+            CFrameEncoder Encoder(Settings);
+            std::vector<uint8_t> Keyframe;
+            Encoder.Encode(ViewOf(0), Keyframe);
+            KeyframeBytes = Keyframe.size();
+        });
+        double DecodeMs = MeasureBestMilliseconds(Repeats, [&]
+        {
+            CFrameDecoder Decoder(ThreadCount);
+            for (int Frame = 0; Frame < FrameCount; Frame++) Decoder.Decode(Encoded[Frame].data(), Encoded[Frame].size());
+        });
+
+        const double RawBytes = (double)Width * Height * 4;
+        std::printf("%d thread(s): encode %.2f ms/frame, decode %.2f ms/frame, keyframe %.2f ms (%.1fx), sequence %.1fx\n",
+            ThreadCount, EncodeMs / FrameCount, DecodeMs / FrameCount, KeyframeMs, RawBytes / KeyframeBytes,
+            RawBytes * FrameCount / EncodedBytes);
+    }
+    return 0;
+}
@@ -0,0 +1,197 @@
+#include "TestFramework.h"
+#include "SyntheticUi.h"
+#include "Recording/FrameCodec.h"
+
+#include <cstring>
+#include <vector>
+
+static bool IsSameFrame(const SImageView &Expected, const SImageView &Actual)
+{
+    if (Expected.Width != Actual.Width || Expected.Height != Actual.Height) return false;
+    for (int Y = 0; Y < Expected.Height; Y++)
+    {
+        if (std::memcmp(Expected.Row(Y), Actual.Row(Y), (size_t)Expected.Width * 4) != 0) return false;
+    }
+    return true;
+}
+
+// Copy of a view with Padding bytes after every row
+static std::vector<uint8_t> CopyWithPadding(const SImageView &Frame, int Padding, SImageView &OutView)
+{
+    const int Stride = Frame.Width * 4 + Padding;
+    std::vector<uint8_t> Pixels((size_t)Stride * Frame.Height, 0xEE);
+    for (int Y = 0; Y < Frame.Height; Y++) std::memcpy(&Pixels[(size_t)Y * Stride], Frame.Row(Y), (size_t)Frame.Width * 4);
+    OutView = Frame;
+    OutView.Data = Pixels.data();
+    OutView.Stride = Stride;
+    return Pixels;
+}
+
+SPYX_TEST(UiSequenceRoundTrips)
+{
+    const int Sizes[][2] = {{640, 400}, {131, 77}, {1, 1}, {300, 9}};
+    const int TileSizes[] = {8, 64, 256};
+    for (const auto &Size : Sizes)
+    {
+        for (int TileSize : TileSizes)
+        {
+            SFrameCodecSettings Settings;
+            Settings.TileSize = TileSize;
+            Settings.KeyframeInterval = 7;
+            Settings.ThreadCount = 3;
+            CFrameEncoder Encoder(Settings);
+            CFrameDecoder Decoder(2);
+            CSyntheticUi Ui(Size[0], Size[1]);
+
+            std::vector<uint8_t> Encoded;
+            int Keyframes = 0;
+            for (int Frame = 0; Frame < 24; Frame++)
+            {
+                SImageView Padded;
+                std::vector<uint8_t> Pixels = CopyWithPadding(Ui.Render(Frame), Frame % 3 * 4, Padded);
+                SEncodedFrameInfo Info;
+                SPYX_REQUIRE(Encoder.Encode(Padded, Encoded, &Info, Frame == 12));
+                SPYX_CHECK(Info.Size == Encoded.size());
+                if (Info.IsKeyframe) Keyframes++;
+                SPYX_REQUIRE(Decoder.Decode(Encoded.data(), Encoded.size()));
+                SPYX_CHECK(IsSameFrame(Padded, Decoder.GetFrame()));
+            }
+            SPYX_CHECK(Keyframes >= 4);
+        }
+    }
+}
+
+SPYX_TEST(UnchangedFrameCostsOnlyTheTileTable)
+{
+    CSyntheticUi Ui(640, 400);
+    CFrameEncoder Encoder;
+    std::vector<uint8_t> Encoded;
+    SImageView Frame = Ui.Render(3);
+    SPYX_REQUIRE(Encoder.Encode(Frame, Encoded));
+
+    SEncodedFrameInfo Info;
+    SPYX_REQUIRE(Encoder.Encode(Frame, Encoded, &Info));
+    SPYX_CHECK(!Info.IsKeyframe);
+    SPYX_CHECK(Info.ChangedTiles == 0);
+    SPYX_CHECK(Encoded.size() <= 32 + (size_t)Info.TileCount * 4);
+}
+
+SPYX_TEST(UiContentCompresses)
+{
+    // The target was a 10-50x ratio on UI content; a mostly static sequence does far better
+    CSyntheticUi Ui(1280, 720);
+    CFrameEncoder Encoder;
+    CFrameDecoder Decoder;
+    std::vector<uint8_t> Encoded;
+    size_t RawBytes = 0;
+    size_t EncodedBytes = 0;
+    for (int Frame = 0; Frame < 30; Frame++)
+    {
+        SImageView View = Ui.Render(Frame);
+        SPYX_REQUIRE(Encoder.Encode(View, Encoded));
+        SPYX_REQUIRE(Decoder.Decode(Encoded.data(), Encoded.size()));
+        RawBytes += (size_t)View.Width * View.Height * 4;
+        EncodedBytes += Encoded.size();
+    }
+    std::printf("UI sequence ratio %.1fx\n", (double)RawBytes / EncodedBytes);
+    SPYX_CHECK(RawBytes >= EncodedBytes * 10);
+}
+
+SPYX_TEST(NoiseKeyframeRoundTrips)
+{
+    CTestRandom Random(31);
+    const int Width = 203;
+    const int Height = 101;
+    std::vector<uint8_t> Pixels((size_t)Width * Height * 4);
+    for (uint8_t &Byte : Pixels) Byte = (uint8_t)Random.Next();
+    SImageView View;
+    View.Data = Pixels.data();
+    View.Width = Width;
+    View.Height = Height;
+    View.Stride = Width * 4;
+
+    CFrameEncoder Encoder;
+    CFrameDecoder Decoder;
+    std::vector<uint8_t> Encoded;
+    SPYX_REQUIRE(Encoder.Encode(View, Encoded));
+    SPYX_REQUIRE(Decoder.Decode(Encoded.data(), Encoded.size()));
+    SPYX_CHECK(IsSameFrame(View, Decoder.GetFrame()));
+}
+
+SPYX_TEST(OutputDoesNotDependOnThreadCount)
+{
+    CSyntheticUi Ui(500, 300);
+    SFrameCodecSettings Single;
+    Single.ThreadCount = 1;
+    SFrameCodecSettings Many;
+    Many.ThreadCount = 4;
+    CFrameEncoder SingleEncoder(Single);
+    CFrameEncoder ManyEncoder(Many);
+    for (int Frame = 0; Frame < 5; Frame++)
+    {
+        std::vector<uint8_t> First, Second;
+        SImageView View = Ui.Render(Frame * 10);
+        SPYX_REQUIRE(SingleEncoder.Encode(View, First));
+        SPYX_REQUIRE(ManyEncoder.Encode(View, Second));
+        SPYX_CHECK(First == Second);
+    }
+}
+
+SPYX_TEST(SingleTilesRoundTrip)
+{
+    CTestRandom Random(64);
+    for (int Case = 0; Case < 50; Case++)
+    {
+        const int PixelCount = Random.Range(1, 64 * 64);
+        std::vector<uint32_t> Pixels(PixelCount);
+        uint32_t Colour = Random.Next();
+        for (uint32_t &Pixel : Pixels)
+        {
+            // Runs, small steps and literals
+            int Kind = Random.Range(0, 3);
+            if (Kind == 1) Colour += 0x010101u;
+            else if (Kind == 2) Colour = Random.Next();
+            Pixel = Colour;
+        }
+        std::vector<uint8_t> Encoded(GetMaxEncodedTileSize(PixelCount));
+        size_t Size = EncodeTile(Pixels.data(), PixelCount, Encoded.data());
+        SPYX_REQUIRE(Size > 0 && Size <= Encoded.size());
+
+        std::vector<uint32_t> Decoded(PixelCount);
+        SPYX_REQUIRE(DecodeTile(Encoded.data(), Size, Decoded.data(), PixelCount));
+        SPYX_CHECK(Decoded == Pixels);
+        SPYX_CHECK(!DecodeTile(Encoded.data(), Size - 1, Decoded.data(), PixelCount) || Size == 1);
+    }
+}
+
+SPYX_TEST(MalformedInputIsRejected)
+{
+    CSyntheticUi Ui(256, 160);
+    CFrameEncoder Encoder;
+    std::vector<uint8_t> Keyframe, Delta;
+    SPYX_REQUIRE(Encoder.Encode(Ui.Render(0), Keyframe));
+    SPYX_REQUIRE(Encoder.Encode(Ui.Render(1), Delta));
+
+    // A delta frame needs its reference
+    CFrameDecoder Fresh(1);
+    SPYX_CHECK(!Fresh.Decode(Delta.data(), Delta.size()));
+
+    // Truncations and bit flips must fail cleanly or decode something, never read out of bounds
+    CTestRandom Random(404);
+    for (size_t Length = 0; Length < Keyframe.size(); Length += 1 + Length / 3)
+    {
+        CFrameDecoder Decoder(1);
+        SPYX_CHECK(!Decoder.Decode(Keyframe.data(), Length));
+    }
+    for (int Case = 0; Case < 2000; Case++)
+    {
+        std::vector<uint8_t> Corrupt = Case % 2 ? Keyframe : Delta;
+        for (int Flip = Random.Range(1, 4); Flip > 0; Flip--)
+        {
+            Corrupt[Random.Next() % Corrupt.size()] ^= (uint8_t)(1 << Random.Range(0, 7));
+        }
+        CFrameDecoder Decoder(1);
+        if (Case % 2 == 0) Decoder.Decode(Keyframe.data(), Keyframe.size());
+        Decoder.Decode(Corrupt.data(), Corrupt.size());
+    }
+}
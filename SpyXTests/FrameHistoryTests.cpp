@@ -0,0 +1,216 @@
+#include "TestFramework.h"
+#include "SyntheticUi.h"
+#include "Recording/FrameHistory.h"
+
+#include <cstring>
+#include <vector>
+
+// Frames with repeated content, repeated grids and repeated tiles read back exactly, and
+// eviction over the budget keeps the ids of the frames that remain.
+
+static const int PaddingBytes = 12;
+static const uint8_t Canary = 0xA5;
+
+// BGRA8 frame copied into rows with padding past the pixels
+struct SPaddedFrame
+{
+    std::vector<uint8_t> Pixels;
+    int Width = 0;
+    int Height = 0;
+    int Stride = 0;
+
+    SPaddedFrame(int FrameWidth, int FrameHeight)
+        : Width(FrameWidth), Height(FrameHeight), Stride(FrameWidth * 4 + PaddingBytes)
+    {
+        Pixels.assign((size_t)Stride * Height, Canary);
+    }
+
+    SImageView GetView() const
+    {
+        SImageView View;
+        View.Data = Pixels.data();
+        View.Width = Width;
+        View.Height = Height;
+        View.Stride = Stride;
+        View.Format = EPixelFormat::BGRA8;
+        return View;
+    }
+};
+
+static SPaddedFrame CopyFrame(const SImageView &Source)
+{
+    SPaddedFrame Frame(Source.Width, Source.Height);
+    for (int Y = 0; Y < Source.Height; Y++) std::memcpy(&Frame.Pixels[(size_t)Y * Frame.Stride], Source.Row(Y), (size_t)Source.Width * 4);
+    return Frame;
+}
+
+static SPaddedFrame MakeSolidFrame(int Width, int Height, uint32_t Color)
+{
+    SPaddedFrame Frame(Width, Height);
+    for (int Y = 0; Y < Height; Y++)
+    {
+        for (int X = 0; X < Width; X++) std::memcpy(&Frame.Pixels[(size_t)Y * Frame.Stride + X * 4], &Color, 4);
+    }
+    return Frame;
+}
+
+// Reads Id into a padded frame and compares pixels exactly, with the padding left alone
+static bool ReadsBackAs(const CFrameHistory &History, uint64_t Id, const SPaddedFrame &Expected)
+{
+    SPaddedFrame Read(Expected.Width, Expected.Height);
+    if (!History.ReadFrame(Id, Read.Pixels.data(), Read.Stride)) return false;
+    for (int Y = 0; Y < Expected.Height; Y++)
+    {
+        const uint8_t *Row = &Read.Pixels[(size_t)Y * Read.Stride];
+        if (std::memcmp(Row, &Expected.Pixels[(size_t)Y * Expected.Stride], (size_t)Expected.Width * 4) != 0) return false;
+        for (int Byte = Expected.Width * 4; Byte < Read.Stride; Byte++)
+        {
+            if (Row[Byte] != Canary) return false;
+        }
+    }
+    return true;
+}
+
+SPYX_TEST(RepeatedContentReadsBackExactly)
+{
+    CTestRandom Random(34);
+    for (int Trial = 0; Trial < 4; Trial++)
+    {
+        SFrameHistorySettings Settings;
+        Settings.TileSize = 32;
+        Settings.ThreadCount = Random.Range(1, 8);
+        CFrameHistory History(Settings);
+
+        // 200 x 130 is 7 x 5 tiles with narrow right and short bottom edges
+        CSyntheticUi Ui(200, 130);
+        CSyntheticUi Small(150, 90);
+        std::vector<SPaddedFrame> Contents;
+        Contents.push_back(CopyFrame(Ui.Render(0)));
+        Contents.push_back(CopyFrame(Ui.Render(1)));
+        Contents.push_back(CopyFrame(Ui.Render(10)));
+        Contents.push_back(MakeSolidFrame(200, 130, 0xFF336699u));
+        Contents.push_back(CopyFrame(Small.Render(5)));
+
+        const int Order[] = {0, 0, 1, 2, 2, 2, 1, 0, 3, 4, 0};
+        const int FrameCount = (int)(sizeof(Order) / sizeof(Order[0]));
+        std::vector<size_t> TileCounts;
+        for (int Frame = 0; Frame < FrameCount; Frame++)
+        {
+            SPYX_REQUIRE(History.AddFrame(Contents[Order[Frame]].GetView(), Frame * 1000, 100 + Frame));
+            TileCounts.push_back(History.GetStats().TileCount);
+        }
+        SPYX_CHECK(!History.AddFrame(Contents[0].GetView(), 9999, 0));
+
+        // Content seen before adds no tiles, and the solid frame adds one per tile shape
+        SPYX_CHECK(TileCounts[1] == TileCounts[0]);
+        SPYX_CHECK(TileCounts[6] == TileCounts[5] && TileCounts[7] == TileCounts[5]);
+        SPYX_CHECK(TileCounts[8] == TileCounts[7] + 4);
+        SPYX_CHECK(TileCounts[10] == TileCounts[9]);
+
+        // A frame equal to the one before shares its grid; equal to an older one it does not
+        const SFrameHistoryStats Stats = History.GetStats();
+        SPYX_CHECK(Stats.FrameCount == (size_t)FrameCount);
+        SPYX_CHECK(Stats.GridCount == 8);
+        SPYX_CHECK(Stats.OldestTimestamp == 0 && Stats.NewestTimestamp == (FrameCount - 1) * 1000);
+
+        uint64_t Id = 0;
+        SPYX_CHECK(!History.FindFrame(-1, Id));
+        for (int Frame = 0; Frame < FrameCount; Frame++)
+        {
+            SPYX_REQUIRE(History.FindFrame(Frame * 1000 + 500, Id));
+            SPYX_CHECK(Id == (uint64_t)Frame);
+
+            int Width = 0;
+            int Height = 0;
+            int64_t Timestamp = 0;
+            uint64_t Sequence = 0;
+            SPYX_REQUIRE(History.GetFrameInfo(Id, Width, Height, Timestamp, Sequence));
+            const SPaddedFrame &Expected = Contents[Order[Frame]];
+            SPYX_CHECK(Width == Expected.Width && Height == Expected.Height);
+            SPYX_CHECK(Timestamp == Frame * 1000 && Sequence == (uint64_t)(100 + Frame));
+            SPYX_CHECK(ReadsBackAs(History, Id, Expected));
+        }
+        SPYX_CHECK(!History.ReadFrame(FrameCount, Contents[0].Pixels.data(), Contents[0].Stride));
+    }
+}
+
+SPYX_TEST(OverBudgetEvictsOldestKeepingIds)
+{
+    SFrameHistorySettings Settings;
+    Settings.TileSize = 32;
+    Settings.MaxBytes = 64 << 10;
+    Settings.ThreadCount = 3;
+    CFrameHistory History(Settings);
+
+    // Every content shown twice, so half the frames reuse the grid before them
+    const int FrameCount = 200;
+    CSyntheticUi Ui(200, 130);
+    for (int Frame = 0; Frame < FrameCount; Frame++)
+    {
+        const SPaddedFrame Content = CopyFrame(Ui.Render(Frame / 2));
+        SPYX_REQUIRE(History.AddFrame(Content.GetView(), Frame * 1000, Frame));
+        const SFrameHistoryStats Stats = History.GetStats();
+        SPYX_CHECK(Stats.BytesUsed <= Settings.MaxBytes || Stats.FrameCount == 1);
+    }
+
+    const size_t Remaining = History.GetFrameCount();
+    SPYX_REQUIRE(Remaining > 1 && Remaining < (size_t)FrameCount);
+    const int First = FrameCount - (int)Remaining;
+    SPYX_CHECK(History.GetStats().OldestTimestamp == First * 1000);
+
+    CSyntheticUi Reference(200, 130);
+    uint64_t Id = 0;
+    SPYX_CHECK(!History.FindFrame(First * 1000 - 1, Id));
+    for (int Frame = 0; Frame < FrameCount; Frame++)
+    {
+        const SPaddedFrame Expected = CopyFrame(Reference.Render(Frame / 2));
+        int Width = 0;
+        int Height = 0;
+        int64_t Timestamp = 0;
+        uint64_t Sequence = 0;
+        if (Frame < First)
+        {
+            SPYX_CHECK(!History.GetFrameInfo(Frame, Width, Height, Timestamp, Sequence));
+            SPYX_CHECK(!ReadsBackAs(History, Frame, Expected));
+            continue;
+        }
+        SPYX_REQUIRE(History.FindFrame(Frame * 1000, Id));
+        SPYX_CHECK(Id == (uint64_t)Frame);
+        SPYX_REQUIRE(History.GetFrameInfo(Id, Width, Height, Timestamp, Sequence));
+        SPYX_CHECK(Timestamp == Frame * 1000 && Sequence == (uint64_t)Frame);
+        SPYX_CHECK(ReadsBackAs(History, Id, Expected));
+    }
+
+    // Ids carry on past a clear
+    History.Clear();
+    SPYX_CHECK(History.GetFrameCount() == 0 && History.GetStats().BytesUsed == 0);
+    SPYX_CHECK(!History.FindFrame(FrameCount * 1000, Id));
+    const SPaddedFrame Last = CopyFrame(Reference.Render(FrameCount));
+    SPYX_REQUIRE(History.AddFrame(Last.GetView(), FrameCount * 1000, FrameCount));
+    SPYX_REQUIRE(History.FindFrame(FrameCount * 1000, Id));
+    SPYX_CHECK(Id == (uint64_t)FrameCount);
+    SPYX_CHECK(ReadsBackAs(History, Id, Last));
+}
+
+SPYX_TEST(NewestFrameSurvivesAnyBudget)
+{
+    SFrameHistorySettings Settings;
+    Settings.TileSize = 16;
+    Settings.MaxBytes = 1;
+    CFrameHistory History(Settings);
+
+    CSyntheticUi Ui(90, 70);
+    for (int Frame = 0; Frame < 12; Frame++)
+    {
+        const SPaddedFrame Content = CopyFrame(Ui.Render(Frame));
+        SPYX_REQUIRE(History.AddFrame(Content.GetView(), Frame * 1000, Frame));
+        SPYX_CHECK(History.GetFrameCount() == 1);
+
+        const SFrameHistoryStats Stats = History.GetStats();
+        SPYX_CHECK(Stats.GridCount == 1 && Stats.OldestTimestamp == Frame * 1000);
+        uint64_t Id = 0;
+        SPYX_REQUIRE(History.FindFrame(Frame * 1000, Id));
+        SPYX_CHECK(Id == (uint64_t)Frame);
+        SPYX_CHECK(ReadsBackAs(History, Id, Content));
+    }
+}
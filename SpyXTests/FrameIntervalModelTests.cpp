@@ -0,0 +1,167 @@
+#include "TestFramework.h"
+#include "Capture/FrameIntervalModel.h"
+
+#include <cmath>
+
+// Synthetic arrival traces in 100 ns units, fed through the model as CWindowCapture does.
+
+static const int64_t Millisecond = 10000;
+static const int64_t MaxWait = 50 * Millisecond;
+static const int64_t Start = 1000 * Millisecond;
+
+static bool IsNear(double Value, double Expected, double Tolerance)
+{
+    return std::fabs(Value - Expected) <= Tolerance * Expected;
+}
+
+SPYX_TEST(SteadyCadenceIsLearned)
+{
+    CFrameIntervalModel Model;
+    const int64_t Period = 69444;   // 144 Hz
+    int64_t Time = Start;
+    for (int Frame = 0; Frame < 200; Frame++)
+    {
+        Model.AddArrival(Time);
+        Time += Period;
+    }
+    SPYX_CHECK(IsNear(Model.GetMeanInterval(), (double)Period, 0.01));
+    SPYX_CHECK(Model.GetJitter() < Period * 0.05);
+
+    // Just after a frame, the wait covers about one period, far below the old fixed 50 ms
+    const int64_t Last = Model.GetLastArrival();
+    int64_t Wait = Model.ComputeWaitTime(EFrameWaitMode::NextFrame, Last + Millisecond, 0, MaxWait);
+    SPYX_CHECK(Wait >= Period - Millisecond && Wait <= 2 * Period);
+    SPYX_CHECK(Model.ComputeWaitTime(EFrameWaitMode::LatestNow, Last + Millisecond, 0, MaxWait) == 0);
+}
+
+SPYX_TEST(JitteredArrivalsMeetDeadline)
+{
+    CTestRandom Random(60);
+    CFrameIntervalModel Model;
+    const int64_t Period = 166667;  // 60 Hz with +-2 ms compositor jitter
+    int64_t Time = Start;
+    int Predicted = 0;
+    int Checked = 0;
+    for (int Frame = 0; Frame < 2000; Frame++)
+    {
+        if (Frame >= 50)
+        {
+            // The next arrival should come before the deadline the model gave for it
+            Checked++;
+            if (Time <= Model.GetDeadline()) Predicted++;
+        }
+        Model.AddArrival(Time);
+        Time += Period + Random.Range(-20000, 20000);
+    }
+    SPYX_CHECK(IsNear(Model.GetMeanInterval(), (double)Period, 0.05));
+    SPYX_CHECK(Predicted >= Checked * 99 / 100);
+}
+
+SPYX_TEST(InputDrivenIdleGapsKeepRedrawCadence)
+{
+    // A window that redraws at 60 Hz for a few frames after input, often only one, then
+    // sits idle for a varying time. Waits while idle must stay near one redraw period.
+    CTestRandom Random(7);
+    CFrameIntervalModel Model;
+    const int64_t Period = 166667;
+    int64_t Time = Start;
+    int LongWaits = 0;
+    int IdleChecks = 0;
+    for (int Burst = 0; Burst < 100; Burst++)
+    {
+        int Frames = Random.Range(0, 2) ? 1 : Random.Range(2, 12);
+        for (int Frame = 0; Frame < Frames; Frame++)
+        {
+            Model.AddArrival(Time);
+            Time += Period;
+        }
+
+        int64_t Gap = Random.Range(300, 3000) * Millisecond;
+        if (Burst >= 5)
+        {
+            IdleChecks++;
+            int64_t Now = Model.GetLastArrival() + Gap / 2;
+            if (Model.ComputeWaitTime(EFrameWaitMode::NextFrame, Now, 0, MaxWait) >= 30 * Millisecond) LongWaits++;
+        }
+        Time += Gap;
+    }
+    SPYX_CHECK(LongWaits == 0);
+    SPYX_CHECK(IdleChecks > 0);
+    SPYX_CHECK(IsNear(Model.GetMeanInterval(), (double)Period, 0.05));
+    SPYX_CHECK(Model.GetIdleInterval() > 300 * Millisecond);
+}
+
+SPYX_TEST(SteadySlowerCadenceIsAdopted)
+{
+    // 144 Hz that drops to 30 Hz: repeated equal gaps are a new cadence, not idle time
+    CFrameIntervalModel Model;
+    int64_t Time = Start;
+    for (int Frame = 0; Frame < 100; Frame++)
+    {
+        Model.AddArrival(Time);
+        Time += 69444;
+    }
+    const int64_t SlowPeriod = 333333;
+    for (int Frame = 0; Frame < 40; Frame++)
+    {
+        Time += SlowPeriod;
+        Model.AddArrival(Time);
+    }
+    SPYX_CHECK(IsNear(Model.GetMeanInterval(), (double)SlowPeriod, 0.05));
+
+    int64_t Wait = Model.ComputeWaitTime(EFrameWaitMode::NextFrame, Model.GetLastArrival() + Millisecond, 0, MaxWait);
+    SPYX_CHECK(Wait >= SlowPeriod - Millisecond);
+}
+
+SPYX_TEST(SlowBlinkStaysIdle)
+{
+    // A caret blinking every 500 ms is regular, but too slow to be waited for
+    CFrameIntervalModel Model;
+    int64_t Time = Start;
+    for (int Frame = 0; Frame < 30; Frame++)
+    {
+        Model.AddArrival(Time);
+        Time += 166667;
+    }
+    for (int Frame = 0; Frame < 20; Frame++)
+    {
+        Time += 500 * Millisecond;
+        Model.AddArrival(Time);
+    }
+    SPYX_CHECK(IsNear(Model.GetMeanInterval(), 166667.0, 0.05));
+}
+
+SPYX_TEST(WithinBudgetSkipsLateFrames)
+{
+    CFrameIntervalModel Model;
+    const int64_t Period = 333333;  // 30 Hz
+    int64_t Time = Start;
+    for (int Frame = 0; Frame < 100; Frame++)
+    {
+        Model.AddArrival(Time);
+        Time += Period;
+    }
+    const int64_t Now = Model.GetLastArrival() + Millisecond;
+
+    // The next frame is about 32 ms away: a 5 ms budget does not wait, a 40 ms budget does
+    SPYX_CHECK(Model.ComputeWaitTime(EFrameWaitMode::WithinBudget, Now, 5 * Millisecond, MaxWait) == 0);
+    int64_t Wait = Model.ComputeWaitTime(EFrameWaitMode::WithinBudget, Now, 40 * Millisecond, MaxWait);
+    SPYX_CHECK(Wait > 0 && Wait <= 40 * Millisecond);
+}
+
+SPYX_TEST(NoEstimateUsesDefault)
+{
+    CFrameIntervalModel Model;
+    SPYX_CHECK(!Model.HasEstimate());
+    SPYX_CHECK(Model.ComputeWaitTime(EFrameWaitMode::NextFrame, Start, 0, MaxWait) == CFrameIntervalModel::DefaultWait);
+    SPYX_CHECK(Model.ComputeWaitTime(EFrameWaitMode::WithinBudget, Start, 3 * Millisecond, MaxWait) == 3 * Millisecond);
+
+    // Repeated and out-of-order timestamps are ignored
+    Model.AddArrival(Start);
+    Model.AddArrival(Start);
+    Model.AddArrival(Start - Millisecond);
+    SPYX_CHECK(!Model.HasEstimate());
+    Model.AddArrival(Start + 10 * Millisecond);
+    SPYX_CHECK(Model.HasEstimate());
+    SPYX_CHECK(IsNear(Model.GetMeanInterval(), 10.0 * Millisecond, 0.001));
+}
@@ -0,0 +1,253 @@
+#include "TestFramework.h"
+#include "Capture/SyntheticSource.h"
+#include "Imaging/ToneMapper.h"
+#include "Server/FrameClient.h"
+#include "Server/FrameServer.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// End-to-end transport over a real socket and shared-memory rings. A producer thread
+// publishes CSyntheticSource frames, so every pixel a client receives can be checked
+// against the frame its sequence names.
+
+static std::string MakeSocketPath(const char *Name)
+{
+    return "/tmp/spyx-test-" + std::to_string(getpid()) + "-" + Name;
+}
+
+// Publishes 640x480 synthetic frames about every 2 ms until stopped
+class CTestPublisher
+{
+public:
+    explicit CTestPublisher(CFrameServer &Server) : MServer(Server), MThread([this] { Run(); }) {}
+    ~CTestPublisher()
+    {
+        MStop = true;
+        MThread.join();
+    }
+
+private:
+    void Run()
+    {
+        CSyntheticSource Source(640, 480);
+        while (!MStop)
+        {
+            uint64_t Sequence = Source.GetPosition();
+            SImageView Frame;
+            int64_t Timestamp = 0;
+            Source.ReadFrame(Frame, &Timestamp);
+            MServer.Publish(Frame, Sequence, Timestamp);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+
+    CFrameServer &MServer;
+    std::atomic<bool> MStop{false};
+    std::thread MThread;
+};
+
+static uint8_t ToGray(uint32_t Pixel)
+{
+    SImageView View;
+    View.Data = reinterpret_cast<const uint8_t *>(&Pixel);
+    View.Width = 1;
+    View.Height = 1;
+    View.Stride = 4;
+    uint8_t Gray = 0;
+    ConvertBGRA8ToGray8Reference(View, &Gray, 1);
+    return Gray;
+}
+
+static bool Connect(CFrameClient &Client, const std::string &Path, const SFrameSubscription &Subscription)
+{
+    for (int Attempt = 0; Attempt < 50; Attempt++)
+    {
+        if (Client.Connect(Path, Subscription)) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    return false;
+}
+
+// Number of pixels in a received frame that differ from the synthetic source
+static int CountBadPixels(const std::vector<uint8_t> &Pixels, const SRingFrameInfo &Info,
+    const SFrameSubscription &Subscription)
+{
+    int Bad = 0;
+    const int BytesPerPixel = Info.Format == EPixelFormat::Gray8 ? 1 : 4;
+    for (int Y = 0; Y < Info.Height; Y++)
+    {
+        for (int X = 0; X < Info.Width; X++)
+        {
+            uint32_t Expected = CSyntheticSource::GetPixel(X + Subscription.RoiX, Y + Subscription.RoiY, Info.Sequence);
+            const uint8_t *Pixel = &Pixels[((size_t)Y * Info.Width + X) * BytesPerPixel];
+            if (BytesPerPixel == 1)
+            {
+                Bad += *Pixel != ToGray(Expected);
+            }
+            else
+            {
+                uint32_t Value = Pixel[0] | (Pixel[1] << 8) | (Pixel[2] << 16) | ((uint32_t)Pixel[3] << 24);
+                Bad += Value != Expected;
+            }
+        }
+    }
+    return Bad;
+}
+
+SPYX_TEST(FullFrameSubscription)
+{
+    const std::string Path = MakeSocketPath("full");
+    CFrameServer Server;
+    SPYX_REQUIRE(Server.Start(Path));
+    CTestPublisher Publisher(Server);
+
+    SFrameSubscription Subscription;
+    CFrameClient Client;
+    SPYX_REQUIRE(Connect(Client, Path, Subscription));
+
+    std::vector<uint8_t> Pixels;
+    SRingFrameInfo Info;
+    uint64_t LastSequence = 0;
+    for (int Frame = 0; Frame < 60; Frame++)
+    {
+        SPYX_REQUIRE(Client.WaitFrame(2000, Pixels, Info));
+        SPYX_CHECK(Info.Width == 640 && Info.Height == 480 && Info.Format == EPixelFormat::BGRA8);
+        SPYX_CHECK(Frame == 0 || Info.Sequence > LastSequence);
+        SPYX_CHECK(CountBadPixels(Pixels, Info, Subscription) == 0);
+        LastSequence = Info.Sequence;
+    }
+    SPYX_CHECK(Server.GetClientCount() == 1);
+}
+
+SPYX_TEST(GrayRoiSubscriptions)
+{
+    const std::string Path = MakeSocketPath("roi");
+    CFrameServer Server;
+    SPYX_REQUIRE(Server.Start(Path));
+    CTestPublisher Publisher(Server);
+
+    // An interior grey crop and a BGRA crop hanging over the bottom-right corner
+    SFrameSubscription Gray;
+    Gray.Format = EPixelFormat::Gray8;
+    Gray.RoiX = 100;
+    Gray.RoiY = 50;
+    Gray.RoiWidth = 200;
+    Gray.RoiHeight = 100;
+    SFrameSubscription Edge;
+    Edge.RoiX = 600;
+    Edge.RoiY = 400;
+    Edge.RoiWidth = 500;
+    Edge.SlotCount = 2;
+
+    CFrameClient GrayClient, EdgeClient;
+    SPYX_REQUIRE(Connect(GrayClient, Path, Gray));
+    SPYX_REQUIRE(Connect(EdgeClient, Path, Edge));
+
+    std::vector<uint8_t> Pixels;
+    SRingFrameInfo Info;
+    for (int Frame = 0; Frame < 30; Frame++)
+    {
+        SPYX_REQUIRE(GrayClient.WaitFrame(2000, Pixels, Info));
+        SPYX_CHECK(Info.Width == 200 && Info.Height == 100 && Info.Format == EPixelFormat::Gray8);
+        SPYX_CHECK(CountBadPixels(Pixels, Info, Gray) == 0);
+
+        SPYX_REQUIRE(EdgeClient.WaitFrame(2000, Pixels, Info));
+        SPYX_CHECK(Info.Width == 40 && Info.Height == 80 && Info.Format == EPixelFormat::BGRA8);
+        SPYX_CHECK(CountBadPixels(Pixels, Info, Edge) == 0);
+    }
+}
+
+SPYX_TEST(RateLimitAndRenegotiation)
+{
+    const std::string Path = MakeSocketPath("rate");
+    CFrameServer Server;
+    SPYX_REQUIRE(Server.Start(Path));
+    CTestPublisher Publisher(Server);
+
+    SFrameSubscription Subscription;
+    Subscription.RoiX = 10;
+    Subscription.RoiY = 20;
+    Subscription.RoiWidth = 64;
+    Subscription.RoiHeight = 32;
+    Subscription.MinInterval = 166667 * 3;
+    CFrameClient Client;
+    SPYX_REQUIRE(Connect(Client, Path, Subscription));
+
+    std::vector<uint8_t> Pixels;
+    SRingFrameInfo Info;
+    int64_t LastTimestamp = -1;
+    for (int Frame = 0; Frame < 20; Frame++)
+    {
+        SPYX_REQUIRE(Client.WaitFrame(2000, Pixels, Info));
+        SPYX_CHECK(LastTimestamp < 0 || Info.Timestamp - LastTimestamp >= Subscription.MinInterval);
+        SPYX_CHECK(CountBadPixels(Pixels, Info, Subscription) == 0);
+        LastTimestamp = Info.Timestamp;
+    }
+
+    // The new format and ROI take over on the live connection
+    Subscription.Format = EPixelFormat::Gray8;
+    Subscription.RoiWidth = 500;
+    Subscription.RoiHeight = 400;
+    Subscription.MinInterval = 0;
+    SPYX_REQUIRE(Client.Subscribe(Subscription));
+    bool Renegotiated = false;
+    for (int Frame = 0; Frame < 100 && !Renegotiated; Frame++)
+    {
+        SPYX_REQUIRE(Client.WaitFrame(2000, Pixels, Info));
+        Renegotiated = Info.Format == EPixelFormat::Gray8;
+    }
+    SPYX_REQUIRE(Renegotiated);
+    for (int Frame = 0; Frame < 10; Frame++)
+    {
+        SPYX_REQUIRE(Client.WaitFrame(2000, Pixels, Info));
+        SPYX_CHECK(Info.Width == 500 && Info.Height == 400 && Info.Format == EPixelFormat::Gray8);
+        SPYX_CHECK(CountBadPixels(Pixels, Info, Subscription) == 0);
+    }
+}
+
+SPYX_TEST(SlowClientSkipsToNewest)
+{
+    const std::string Path = MakeSocketPath("slow");
+    CFrameServer Server;
+    SPYX_REQUIRE(Server.Start(Path));
+    CTestPublisher Publisher(Server);
+
+    SFrameSubscription Subscription;
+    CFrameClient Client;
+    SPYX_REQUIRE(Connect(Client, Path, Subscription));
+
+    std::vector<uint8_t> Pixels;
+    SRingFrameInfo Info;
+    SPYX_REQUIRE(Client.WaitFrame(2000, Pixels, Info));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+    // The publisher kept going without blocking; the client gets a recent, intact frame
+    SPYX_REQUIRE(Client.WaitFrame(2000, Pixels, Info));
+    SPYX_CHECK(Info.Dropped > 0);
+    SPYX_CHECK(CountBadPixels(Pixels, Info, Subscription) == 0);
+}
+
+SPYX_TEST(ClientSeesServerStop)
+{
+    const std::string Path = MakeSocketPath("stop");
+    CFrameClient Client;
+    {
+        CFrameServer Server;
+        SPYX_REQUIRE(Server.Start(Path));
+        SFrameSubscription Subscription;
+        SPYX_REQUIRE(Connect(Client, Path, Subscription));
+        Server.Stop();
+    }
+
+    std::vector<uint8_t> Pixels;
+    SRingFrameInfo Info;
+    SPYX_CHECK(!Client.WaitFrame(500, Pixels, Info));
+
+    CFrameClient Late;
+    SPYX_CHECK(!Late.Connect(Path, SFrameSubscription()));
+}
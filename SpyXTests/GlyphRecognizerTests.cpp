@@ -0,0 +1,157 @@
+#include "TestFramework.h"
+#include "Analysis/GlyphRecognizer.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Fields drawn from a 5 x 7 font read back, and touching ink too narrow to split into whole
+// characters.
+
+struct SFontGlyph
+{
+    char Code;
+    uint8_t Rows[7];                // Bit 4 is the left column
+};
+
+static const SFontGlyph Font[] = {
+    {'0', {14, 17, 19, 21, 25, 17, 14}}, {'1', {4, 12, 4, 4, 4, 4, 14}}, {'2', {14, 17, 1, 2, 4, 8, 31}},
+    {'3', {31, 2, 4, 2, 1, 17, 14}}, {'4', {2, 6, 10, 18, 31, 2, 2}}, {'5', {31, 16, 30, 1, 1, 17, 14}},
+    {'6', {6, 8, 16, 30, 17, 17, 14}}, {'7', {31, 1, 2, 4, 8, 8, 8}}, {'8', {14, 17, 17, 14, 17, 17, 14}},
+    {'9', {14, 17, 17, 15, 1, 2, 12}}, {':', {0, 12, 12, 0, 12, 12, 0}}, {'.', {0, 0, 0, 0, 0, 12, 12}}};
+
+// Gray8 image with its pixels
+struct STestImage
+{
+    std::vector<uint8_t> Pixels;
+    int Width = 0;
+    int Height = 0;
+
+    STestImage(int ImageWidth, int ImageHeight, uint8_t Background)
+        : Pixels((size_t)ImageWidth * ImageHeight, Background), Width(ImageWidth), Height(ImageHeight)
+    {
+    }
+
+    SImageView GetView() const
+    {
+        SImageView View;
+        View.Data = Pixels.data();
+        View.Width = Width;
+        View.Height = Height;
+        View.Stride = Width;
+        View.Format = EPixelFormat::Gray8;
+        return View;
+    }
+};
+
+// Draws the inked columns of Glyph at (X, Y) scaled by Scale and returns the drawn width
+static int DrawGlyph(STestImage &Image, const SFontGlyph &Glyph, int X, int Y, int Scale)
+{
+    int First = 5;
+    int Last = -1;
+    for (uint8_t Row : Glyph.Rows)
+    {
+        for (int Column = 0; Column < 5; Column++)
+        {
+            if (!(Row >> (4 - Column) & 1)) continue;
+            First = std::min(First, Column);
+            Last = std::max(Last, Column);
+        }
+    }
+    for (int Row = 0; Row < 7; Row++)
+    {
+        for (int Column = First; Column <= Last; Column++)
+        {
+            if (!(Glyph.Rows[Row] >> (4 - Column) & 1)) continue;
+            for (int DeltaY = 0; DeltaY < Scale; DeltaY++)
+            {
+                for (int DeltaX = 0; DeltaX < Scale; DeltaX++)
+                {
+                    const size_t Offset = (size_t)(Y + Row * Scale + DeltaY) * Image.Width + X + (Column - First) * Scale;
+                    Image.Pixels[Offset + DeltaX] = 230;
+                }
+            }
+        }
+    }
+    return (Last - First + 1) * Scale;
+}
+
+static const SFontGlyph &FindGlyph(char Code)
+{
+    for (const SFontGlyph &Glyph : Font)
+    {
+        if (Glyph.Code == Code) return Glyph;
+    }
+    return Font[0];
+}
+
+static void AddFont(CGlyphRecognizer &Recognizer)
+{
+    for (const SFontGlyph &Glyph : Font)
+    {
+        STestImage Cell(27, 27, 20);
+        DrawGlyph(Cell, Glyph, 3, 3, 3);
+        Recognizer.AddGlyph(Glyph.Code, Cell.GetView());
+    }
+}
+
+SPYX_TEST(RandomFieldsReadBack)
+{
+    CGlyphRecognizer Recognizer;
+    AddFont(Recognizer);
+    SPYX_REQUIRE(Recognizer.GetGlyphCount() == (int)(sizeof(Font) / sizeof(Font[0])));
+
+    CTestRandom Random(11);
+    for (int Trial = 0; Trial < 100; Trial++)
+    {
+        // A full-height character first, so flat marks have a line to be placed in
+        const int Scale = Random.Range(3, 4);
+        const int Count = Random.Range(2, 8);
+        std::string Text(1, (char)('0' + Random.Range(0, 9)));
+        for (int Index = 1; Index < Count; Index++) Text += Font[Random.Next() % (sizeof(Font) / sizeof(Font[0]))].Code;
+
+        STestImage Field(Count * 6 * Scale + 10, 9 * Scale, 20);
+        int X = 5;
+        for (char Code : Text) X += DrawGlyph(Field, FindGlyph(Code), X, Scale, Scale) + Scale;
+
+        STextOptions Options;
+        Options.SpaceWidth = -1;
+        std::vector<SGlyphResult> Results;
+        SPYX_REQUIRE(Recognizer.Recognize(Field.GetView(), Options, Results));
+        std::string Read;
+        for (const SGlyphResult &Result : Results) Read += (char)Result.Code;
+        SPYX_CHECK(Read == Text);
+    }
+}
+
+SPYX_TEST(NarrowTouchingInkSplitsIntoColumns)
+{
+    // A one-column glyph makes a 4-column blob four pieces. Column 2 holds a single ink pixel,
+    // so the first cut moves onto it; the second cut used to land on the same column, giving
+    // an empty piece with no ink rows that was read from before the ink buffer.
+    CGlyphRecognizer Recognizer;
+    STestImage Bar(5, 10, 20);
+    for (int Y = 0; Y < 10; Y++) Bar.Pixels[(size_t)Y * 5 + 2] = 230;
+    SPYX_REQUIRE(Recognizer.AddGlyph('|', Bar.GetView(), ETextPolarity::LightOnDark));
+
+    STestImage Field(12, 10, 20);
+    for (int Y = 0; Y < 10; Y++)
+    {
+        Field.Pixels[(size_t)Y * 12 + 4] = 230;
+        Field.Pixels[(size_t)Y * 12 + 5] = 230;
+        Field.Pixels[(size_t)Y * 12 + 7] = 230;
+    }
+    Field.Pixels[5 * 12 + 6] = 230;
+
+    STextOptions Options;
+    Options.Polarity = ETextPolarity::LightOnDark;
+    Options.SpaceWidth = -1;
+    std::vector<SGlyphResult> Results;
+    SPYX_REQUIRE(Recognizer.Recognize(Field.GetView(), Options, Results));
+    SPYX_REQUIRE(Results.size() == 4);
+    for (int Index = 0; Index < 4; Index++)
+    {
+        SPYX_CHECK(Results[Index].X == 4 + Index);
+        SPYX_CHECK(Results[Index].Width == 1);
+    }
+}
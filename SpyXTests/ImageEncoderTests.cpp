@@ -0,0 +1,292 @@
+#include "TestFramework.h"
+#include "SyntheticUi.h"
+#include "Imaging/ImageEncoder.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <zlib.h>
+
+// PNG and QOI outputs decoded again and compared with the source pixels exactly: PNG through
+// zlib's inflate with every chunk CRC checked, QOI with a decoder written from the format's
+// specification.
+
+struct STestImage
+{
+    std::vector<uint8_t> Pixels;
+    SImageView View;
+};
+
+static uint32_t ReadBE32(const uint8_t *Data)
+{
+    return (uint32_t)Data[0] << 24 | (uint32_t)Data[1] << 16 | (uint32_t)Data[2] << 8 | Data[3];
+}
+
+// Screen-like, noisy, flat or gradient content, with padding past each row
+static STestImage MakeImage(CTestRandom &Random, int Width, int Height, EPixelFormat Format)
+{
+    STestImage Image;
+    const int BytesPerPixel = GetBytesPerPixel(Format);
+    Image.View.Width = Width;
+    Image.View.Height = Height;
+    Image.View.Stride = Width * BytesPerPixel + Random.Range(0, 2) * 4;
+    Image.View.Format = Format;
+    Image.Pixels.resize((size_t)Image.View.Stride * Height);
+    for (uint8_t &Byte : Image.Pixels) Byte = (uint8_t)Random.Next();
+
+    CSyntheticUi Ui(Width, Height);
+    const SImageView Screen = Ui.Render(Random.Range(0, 100));
+    const int Kind = Random.Range(0, 3);
+    for (int Y = 0; Y < Height; Y++)
+    {
+        uint8_t *Row = &Image.Pixels[(size_t)Y * Image.View.Stride];
+        for (int X = 0; X < Width * BytesPerPixel; X++)
+        {
+            if (Kind == 0) Row[X] = Format == EPixelFormat::Gray8 ? Screen.Row(Y)[X * 4 + 1] : Screen.Row(Y)[X];
+            if (Kind == 2) Row[X] = (uint8_t)(X % 4 == 3 ? 0 : 40);
+            if (Kind == 3) Row[X] = (uint8_t)(X / BytesPerPixel + Y * 3 + X % BytesPerPixel * 50);
+        }
+    }
+    Image.View.Data = Image.Pixels.data();
+    return Image;
+}
+
+// Source pixels as the encoders store them: RGB triples, or one gray byte
+static std::vector<uint8_t> ToStoredPixels(const SImageView &Image, int Channels)
+{
+    std::vector<uint8_t> Pixels;
+    for (int Y = 0; Y < Image.Height; Y++)
+    {
+        const uint8_t *Row = Image.Row(Y);
+        for (int X = 0; X < Image.Width; X++)
+        {
+            if (Image.Format == EPixelFormat::Gray8)
+            {
+                for (int Channel = 0; Channel < Channels; Channel++) Pixels.push_back(Row[X]);
+                continue;
+            }
+            Pixels.push_back(Row[X * 4 + 2]);
+            Pixels.push_back(Row[X * 4 + 1]);
+            Pixels.push_back(Row[X * 4]);
+        }
+    }
+    return Pixels;
+}
+
+static int PaethPredictor(int Left, int Above, int UpperLeft)
+{
+    const int Estimate = Left + Above - UpperLeft;
+    const int ToLeft = std::abs(Estimate - Left);
+    const int ToAbove = std::abs(Estimate - Above);
+    const int ToUpperLeft = std::abs(Estimate - UpperLeft);
+    if (ToLeft <= ToAbove && ToLeft <= ToUpperLeft) return Left;
+    return ToAbove <= ToUpperLeft ? Above : UpperLeft;
+}
+
+// Decodes an 8-bit greyscale or truecolour PNG; false on any structural error
+static bool DecodePNG(const std::vector<uint8_t> &File, int &Width, int &Height, int &Channels, std::vector<uint8_t> &Pixels)
+{
+    static const uint8_t Signature[8] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+    if (File.size() < 8 || std::memcmp(File.data(), Signature, 8) != 0) return false;
+
+    std::vector<uint8_t> Compressed;
+    bool HasHeader = false;
+    bool HasEnd = false;
+    size_t Position = 8;
+    while (Position + 12 <= File.size() && !HasEnd)
+    {
+        const uint32_t Length = ReadBE32(&File[Position]);
+        if (Position + 12 + Length > File.size()) return false;
+        const uint8_t *Type = &File[Position + 4];
+        const uint8_t *Data = Type + 4;
+        if (crc32(crc32(0, nullptr, 0), Type, Length + 4) != ReadBE32(Data + Length)) return false;
+
+        if (!std::memcmp(Type, "IHDR", 4))
+        {
+            if (Length != 13 || Data[8] != 8 || (Data[9] != 0 && Data[9] != 2) || Data[10] || Data[11] || Data[12]) return false;
+            Width = (int)ReadBE32(Data);
+            Height = (int)ReadBE32(Data + 4);
+            Channels = Data[9] == 2 ? 3 : 1;
+            HasHeader = true;
+        }
+        else if (!std::memcmp(Type, "IDAT", 4))
+        {
+            Compressed.insert(Compressed.end(), Data, Data + Length);
+        }
+        else if (!std::memcmp(Type, "IEND", 4))
+        {
+            HasEnd = true;
+        }
+        Position += 12 + Length;
+    }
+    if (!HasHeader || !HasEnd || Position != File.size()) return false;
+
+    const size_t RowBytes = (size_t)Width * Channels;
+    std::vector<uint8_t> Filtered((RowBytes + 1) * Height);
+    uLongf Size = (uLongf)Filtered.size();
+    if (uncompress(Filtered.data(), &Size, Compressed.data(), (uLong)Compressed.size()) != Z_OK) return false;
+    if (Size != Filtered.size()) return false;
+
+    Pixels.assign(RowBytes * Height, 0);
+    for (int Y = 0; Y < Height; Y++)
+    {
+        const uint8_t *Line = &Filtered[(RowBytes + 1) * Y];
+        uint8_t *Row = &Pixels[RowBytes * Y];
+        const uint8_t *Previous = Y > 0 ? Row - RowBytes : nullptr;
+        for (size_t Index = 0; Index < RowBytes; Index++)
+        {
+            const int Left = Index >= (size_t)Channels ? Row[Index - Channels] : 0;
+            const int Above = Previous ? Previous[Index] : 0;
+            const int UpperLeft = Previous && Index >= (size_t)Channels ? Previous[Index - Channels] : 0;
+            int Predicted = 0;
+            switch (Line[0])
+            {
+            case 0: break;
+            case 1: Predicted = Left; break;
+            case 2: Predicted = Above; break;
+            case 3: Predicted = (Left + Above) / 2; break;
+            case 4: Predicted = PaethPredictor(Left, Above, UpperLeft); break;
+            default: return false;
+            }
+            Row[Index] = (uint8_t)(Line[1 + Index] + Predicted);
+        }
+    }
+    return true;
+}
+
+// Decodes a QOI file to RGB, checking the alpha the encoder promises to keep opaque
+static bool DecodeQOI(const std::vector<uint8_t> &File, int &Width, int &Height, std::vector<uint8_t> &Pixels)
+{
+    static const uint8_t EndMarker[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    if (File.size() < 22 || std::memcmp(File.data(), "qoif", 4) != 0 || File[12] != 3 || File[13] > 1) return false;
+    if (std::memcmp(&File[File.size() - 8], EndMarker, 8) != 0) return false;
+    Width = (int)ReadBE32(&File[4]);
+    Height = (int)ReadBE32(&File[8]);
+
+    uint8_t Index[64][4] = {};
+    uint8_t Pixel[4] = {0, 0, 0, 255};
+    const size_t Count = (size_t)Width * Height;
+    const size_t End = File.size() - 8;
+    size_t Position = 14;
+    Pixels.clear();
+    while (Pixels.size() < Count * 3)
+    {
+        if (Position >= End) return false;
+        const uint8_t Op = File[Position++];
+        int Run = 1;
+        if (Op == 0xFE || Op == 0xFF)
+        {
+            const int Bytes = Op == 0xFE ? 3 : 4;
+            if (Position + Bytes > End) return false;
+            std::memcpy(Pixel, &File[Position], Bytes);
+            Position += Bytes;
+        }
+        else if ((Op & 0xC0) == 0x00)
+        {
+            std::memcpy(Pixel, Index[Op], 4);
+        }
+        else if ((Op & 0xC0) == 0x40)
+        {
+            Pixel[0] = (uint8_t)(Pixel[0] + ((Op >> 4) & 3) - 2);
+            Pixel[1] = (uint8_t)(Pixel[1] + ((Op >> 2) & 3) - 2);
+            Pixel[2] = (uint8_t)(Pixel[2] + (Op & 3) - 2);
+        }
+        else if ((Op & 0xC0) == 0x80)
+        {
+            if (Position >= End) return false;
+            const int Green = (Op & 0x3F) - 32;
+            const uint8_t Next = File[Position++];
+            Pixel[0] = (uint8_t)(Pixel[0] + Green + (Next >> 4) - 8);
+            Pixel[1] = (uint8_t)(Pixel[1] + Green);
+            Pixel[2] = (uint8_t)(Pixel[2] + Green + (Next & 15) - 8);
+        }
+        else
+        {
+            Run = (Op & 0x3F) + 1;
+        }
+
+        if (Pixel[3] != 255) return false;
+        std::memcpy(Index[(Pixel[0] * 3 + Pixel[1] * 5 + Pixel[2] * 7 + Pixel[3] * 11) % 64], Pixel, 4);
+        for (int Repeat = 0; Repeat < Run; Repeat++) Pixels.insert(Pixels.end(), Pixel, Pixel + 3);
+    }
+    return Position == End && Pixels.size() == Count * 3;
+}
+
+SPYX_TEST(PNGRoundTrips)
+{
+    CTestRandom Random(35);
+    std::vector<uint8_t> File;
+    for (int Trial = 0; Trial < 120; Trial++)
+    {
+        const EPixelFormat Format = Trial % 2 ? EPixelFormat::Gray8 : EPixelFormat::BGRA8;
+        const STestImage Image = MakeImage(Random, Random.Range(1, 120), Random.Range(1, 90), Format);
+        SPYX_REQUIRE(EncodePNG(Image.View, File));
+
+        int Width = 0;
+        int Height = 0;
+        int Channels = 0;
+        std::vector<uint8_t> Pixels;
+        SPYX_REQUIRE(DecodePNG(File, Width, Height, Channels, Pixels));
+        SPYX_CHECK(Width == Image.View.Width && Height == Image.View.Height);
+        SPYX_CHECK(Channels == (Format == EPixelFormat::Gray8 ? 1 : 3));
+        SPYX_CHECK(Pixels == ToStoredPixels(Image.View, Channels));
+    }
+}
+
+SPYX_TEST(LargePNGRoundTrips)
+{
+    // Enough tokens for several deflate blocks, and matches reaching back the whole window
+    CTestRandom Random(350);
+    for (int Kind = 0; Kind < 2; Kind++)
+    {
+        STestImage Image = MakeImage(Random, 900, 700, EPixelFormat::BGRA8);
+        if (Kind == 1)
+        {
+            for (size_t Index = 0; Index < Image.Pixels.size(); Index++) Image.Pixels[Index] = (uint8_t)(Random.Next() & 0x0F);
+        }
+
+        std::vector<uint8_t> File;
+        SPYX_REQUIRE(EncodeImage(Image.View, EImageFileFormat::PNG, File));
+        int Width = 0;
+        int Height = 0;
+        int Channels = 0;
+        std::vector<uint8_t> Pixels;
+        SPYX_REQUIRE(DecodePNG(File, Width, Height, Channels, Pixels));
+        SPYX_CHECK(Pixels == ToStoredPixels(Image.View, 3));
+    }
+}
+
+SPYX_TEST(QOIRoundTrips)
+{
+    CTestRandom Random(3500);
+    std::vector<uint8_t> File;
+    for (int Trial = 0; Trial < 200; Trial++)
+    {
+        const EPixelFormat Format = Trial % 2 ? EPixelFormat::Gray8 : EPixelFormat::BGRA8;
+        const STestImage Image = MakeImage(Random, Random.Range(1, 200), Random.Range(1, 90), Format);
+        SPYX_REQUIRE(EncodeImage(Image.View, EImageFileFormat::QOI, File));
+
+        int Width = 0;
+        int Height = 0;
+        std::vector<uint8_t> Pixels;
+        SPYX_REQUIRE(DecodeQOI(File, Width, Height, Pixels));
+        SPYX_CHECK(Width == Image.View.Width && Height == Image.View.Height);
+        SPYX_CHECK(Pixels == ToStoredPixels(Image.View, 3));
+    }
+}
+
+SPYX_TEST(InvalidImagesAreRejected)
+{
+    std::vector<uint8_t> Pixels(64, 0);
+    SImageView View;
+    View.Data = Pixels.data();
+    View.Width = 4;
+    View.Height = 2;
+    View.Stride = 32;
+    View.Format = EPixelFormat::RGBA16F;
+    std::vector<uint8_t> File(10);
+    SPYX_CHECK(!EncodePNG(View, File) && File.empty());
+    SPYX_CHECK(!EncodeQOI(View, File) && File.empty());
+    View.Format = EPixelFormat::BGRA8;
+    SPYX_CHECK(!EncodeImage(View, (EImageFileFormat)2, File));
+}
@@ -0,0 +1,110 @@
+#include "TestFramework.h"
+#include "Imaging/ImagePyramid.h"
+
+#include <cstring>
+#include <vector>
+
+// Reductions against the reference, and the frame pyramid cache telling frames of different
+// sources apart.
+
+static SImageView MakeGrayView(const std::vector<uint8_t> &Pixels, int Width, int Height, int Stride)
+{
+    SImageView View;
+    View.Data = Pixels.data();
+    View.Width = Width;
+    View.Height = Height;
+    View.Stride = Stride;
+    View.Format = EPixelFormat::Gray8;
+    return View;
+}
+
+static bool IsLevelEqual(const SImageView &Level, const SImageView &Frame)
+{
+    if (Level.Width != Frame.Width || Level.Height != Frame.Height) return false;
+    for (int Y = 0; Y < Frame.Height; Y++)
+    {
+        if (std::memcmp(Level.Row(Y), Frame.Row(Y), (size_t)Frame.Width) != 0) return false;
+    }
+    return true;
+}
+
+SPYX_TEST(ReductionsMatchReference)
+{
+    CTestRandom Random(21);
+    for (int Trial = 0; Trial < 200; Trial++)
+    {
+        const int Width = Random.Range(2, 90);
+        const int Height = Random.Range(2, 40);
+        const int Stride = Width + Random.Range(0, 20);
+        std::vector<uint8_t> Pixels((size_t)Stride * Height);
+        for (uint8_t &Pixel : Pixels) Pixel = (uint8_t)Random.Next();
+        const SImageView Source = MakeGrayView(Pixels, Width, Height, Stride);
+        const EPyramidFilter Filter = (EPyramidFilter)(Random.Next() % 2);
+
+        const int OutputStride = Width / 2 + 16;
+        std::vector<uint8_t> Fast((size_t)OutputStride * (Height / 2));
+        std::vector<uint8_t> Reference(Fast.size());
+        ReduceGray8(Source, Fast.data(), OutputStride, Filter);
+        ReduceGray8Reference(Source, Reference.data(), OutputStride, Filter);
+        for (int Y = 0; Y < Height / 2; Y++)
+        {
+            SPYX_CHECK(std::memcmp(&Fast[(size_t)Y * OutputStride], &Reference[(size_t)Y * OutputStride],
+                (size_t)(Width / 2)) == 0);
+        }
+    }
+}
+
+SPYX_TEST(CacheRebuildsForAnotherSource)
+{
+    std::vector<uint8_t> First(64 * 48);
+    std::vector<uint8_t> Second(64 * 48);
+    CTestRandom Random(22);
+    for (uint8_t &Pixel : First) Pixel = (uint8_t)Random.Next();
+    for (uint8_t &Pixel : Second) Pixel = (uint8_t)Random.Next();
+    const SImageView FirstFrame = MakeGrayView(First, 64, 48, 64);
+    const SImageView SecondFrame = MakeGrayView(Second, 64, 48, 64);
+
+    SPyramidFrameKey Key;
+    Key.Source = 1;
+    Key.Sequence = 1;
+    Key.Width = 64;
+    Key.Height = 48;
+    Key.Format = EPixelFormat::Gray8;
+
+    CFramePyramidCache Cache;
+    const CImagePyramid *Pyramid = Cache.Get(FirstFrame, Key, 2, EPyramidFilter::Box);
+    SPYX_REQUIRE(Pyramid && IsLevelEqual(Pyramid->GetLevel(0), FirstFrame));
+
+    // The same frame is served from the cache, also for fewer levels
+    SPYX_REQUIRE(Cache.Get(FirstFrame, Key, 1, EPyramidFilter::Box) == Pyramid);
+    SPYX_CHECK(Cache.GetBuildCount() == 1);
+
+    // A replay after live capture restarts at the same sequence, generation and size
+    Key.Source = 2;
+    Pyramid = Cache.Get(SecondFrame, Key, 2, EPyramidFilter::Box);
+    SPYX_REQUIRE(Pyramid);
+    SPYX_CHECK(Cache.GetBuildCount() == 2);
+    SPYX_CHECK(IsLevelEqual(Pyramid->GetLevel(0), SecondFrame));
+
+    // More levels, another filter or a new frame rebuild too
+    Cache.Get(SecondFrame, Key, 3, EPyramidFilter::Box);
+    Cache.Get(SecondFrame, Key, 3, EPyramidFilter::Gaussian);
+    Key.Sequence = 2;
+    Cache.Get(SecondFrame, Key, 3, EPyramidFilter::Gaussian);
+    SPYX_CHECK(Cache.GetBuildCount() == 5);
+
+    Cache.Clear();
+    Key.Source = 1;
+    Key.Sequence = 1;
+    Pyramid = Cache.Get(FirstFrame, Key, 2, EPyramidFilter::Box);
+    SPYX_REQUIRE(Pyramid);
+    SPYX_CHECK(IsLevelEqual(Pyramid->GetLevel(0), FirstFrame));
+
+    SImageView Invalid;
+    Key.Sequence = 3;
+    SPYX_CHECK(!Cache.Get(Invalid, Key, 2, EPyramidFilter::Box));
+    Key.Sequence = 1;
+    Pyramid = Cache.Get(FirstFrame, Key, 2, EPyramidFilter::Box);
+    SPYX_REQUIRE(Pyramid);
+    SPYX_CHECK(IsLevelEqual(Pyramid->GetLevel(0), FirstFrame));
+}
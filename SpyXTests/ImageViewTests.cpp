@@ -0,0 +1,85 @@
+#include "TestFramework.h"
+#include "Imaging/ImageView.h"
+
+#include <climits>
+#include <cstdint>
+
+// Rectangle clipping shared by every engine that takes a search or read area: rectangles
+// reaching to or past the frame edge, starting before it, and with edges past INT_MAX.
+
+// Whether frame column or row Position lies in the requested span, reaching the frame edge
+// when Size is 0 or less
+static bool IsInSpan(int Position, int Start, int Size, int FrameSize)
+{
+    const int64_t End = Size > 0 ? (int64_t)Start + Size : FrameSize;
+    return Position >= Start && Position < End;
+}
+
+SPYX_TEST(ClipToFrameKeepsInsideParts)
+{
+    SPixelRect Rect = ClipToFrame(10, 5, 20, 8, 64, 32);
+    SPYX_CHECK(Rect.Left == 10 && Rect.Top == 5 && Rect.GetWidth() == 20 && Rect.GetHeight() == 8);
+
+    // Zero and negative sizes reach the frame edge
+    Rect = ClipToFrame(10, 5, 0, -3, 64, 32);
+    SPYX_CHECK(Rect.Right == 64 && Rect.Bottom == 32 && !Rect.IsEmpty());
+
+    Rect = ClipToFrame(-4, -6, 10, 10, 64, 32);
+    SPYX_CHECK(Rect.Left == 0 && Rect.Top == 0 && Rect.Right == 6 && Rect.Bottom == 4);
+
+    Rect = ClipToFrame(60, 30, 10, 10, 64, 32);
+    SPYX_CHECK(Rect.GetWidth() == 4 && Rect.GetHeight() == 2);
+
+    SPYX_CHECK(ClipToFrame(64, 0, 5, 5, 64, 32).IsEmpty());
+    SPYX_CHECK(ClipToFrame(-10, 0, 10, 5, 64, 32).IsEmpty());
+}
+
+SPYX_TEST(ClipToFrameEdgesPastIntMax)
+{
+    // Edges summed in int would wrap negative and clip everything away
+    SPixelRect Rect = ClipToFrame(1, 1, INT_MAX, INT_MAX, 64, 32);
+    SPYX_CHECK(Rect.Left == 1 && Rect.Top == 1 && Rect.Right == 64 && Rect.Bottom == 32);
+
+    Rect = ClipToFrame(INT_MAX - 10, 0, 100, 4, 64, 32);
+    SPYX_CHECK(Rect.IsEmpty());
+    Rect = ClipToFrame(INT_MAX, INT_MAX, INT_MAX, INT_MAX, 64, 32);
+    SPYX_CHECK(Rect.IsEmpty());
+    Rect = ClipToFrame(INT_MIN, INT_MIN, 10, 10, 64, 32);
+    SPYX_CHECK(Rect.IsEmpty());
+    Rect = ClipToFrame(INT_MIN, 0, INT_MAX, 0, 64, 32);
+    SPYX_CHECK(Rect.IsEmpty() && Rect.Right == -1);
+}
+
+SPYX_TEST(ClipToFrameHoldsRequestedPixels)
+{
+    // Frame pixels around the clipped edges lie inside the clipped rectangle exactly when they
+    // lie inside the requested one
+    CTestRandom Random(44);
+    const int Extremes[] = {INT_MIN, INT_MIN + 1, -1, 0, 1, INT_MAX - 1, INT_MAX};
+    auto NextValue = [&](int Low, int High)
+    {
+        return Random.Range(0, 3) == 0 ? Extremes[Random.Range(0, 6)] : Random.Range(Low, High);
+    };
+    for (int Trial = 0; Trial < 100000; Trial++)
+    {
+        const int FrameWidth = Random.Range(1, 4000);
+        const int FrameHeight = Random.Range(1, 4000);
+        const int X = NextValue(-100, FrameWidth + 100);
+        const int Y = NextValue(-100, FrameHeight + 100);
+        const int Width = NextValue(-10, 5000);
+        const int Height = NextValue(-10, 5000);
+        const SPixelRect Rect = ClipToFrame(X, Y, Width, Height, FrameWidth, FrameHeight);
+
+        const int Columns[] = {0, FrameWidth - 1, Random.Range(0, FrameWidth - 1), Rect.Left - 1, Rect.Left, Rect.Right - 1, Rect.Right};
+        const int Rows[] = {0, FrameHeight - 1, Random.Range(0, FrameHeight - 1), Rect.Top - 1, Rect.Top, Rect.Bottom - 1, Rect.Bottom};
+        for (int Index = 0; Index < 7; Index++)
+        {
+            const int Column = Columns[Index];
+            const int Row = Rows[Index];
+            if (Column < 0 || Column >= FrameWidth || Row < 0 || Row >= FrameHeight) continue;
+            const bool IsInside = !Rect.IsEmpty() && Column >= Rect.Left && Column < Rect.Right && Row >= Rect.Top &&
+                Row < Rect.Bottom;
+            SPYX_CHECK(IsInside == (IsInSpan(Column, X, Width, FrameWidth) && IsInSpan(Row, Y, Height, FrameHeight)));
+        }
+    }
+}
@@ -0,0 +1,105 @@
+#include "TestFramework.h"
+#include "JpegTestSupport.h"
+#include "SyntheticUi.h"
+#include "Imaging/JpegEncoder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+// Encode time, size and PSNR of CJpegEncoder on a 2560x1440 synthetic UI frame, with
+// libjpeg's encoder at the same quality for comparison. Usage: JpegEncoderBench [repeats]
+
+static double EncodeWithLibjpeg(const SImageView &View, int Quality, int Repeats, size_t &OutSize)
+{
+    std::vector<uint8_t> Rgb((size_t)View.Width * View.Height * 3);
+    for (int Y = 0; Y < View.Height; Y++)
+    {
+        for (int X = 0; X < View.Width; X++)
+        {
+            const uint8_t *Pixel = View.Row(Y) + X * 4;
+            uint8_t *Out = &Rgb[((size_t)Y * View.Width + X) * 3];
+            Out[0] = Pixel[2];
+            Out[1] = Pixel[1];
+            Out[2] = Pixel[0];
+        }
+    }
+
+    return MeasureBestMilliseconds(Repeats, [&]
+    {
+        jpeg_compress_struct Encoder;
+        jpeg_error_mgr Errors;
+        Encoder.err = jpeg_std_error(&Errors);
+        jpeg_create_compress(&Encoder);
+        unsigned char *Buffer = nullptr;
+        unsigned long Length = 0;
+        jpeg_mem_dest(&Encoder, &Buffer, &Length);
+        Encoder.image_width = (JDIMENSION)View.Width;
+        Encoder.image_height = (JDIMENSION)View.Height;
+        Encoder.input_components = 3;
+        Encoder.in_color_space = JCS_RGB;
+        jpeg_set_defaults(&Encoder);
+        jpeg_set_quality(&Encoder, Quality, TRUE);
+        jpeg_start_compress(&Encoder, TRUE);
+        while (Encoder.next_scanline < Encoder.image_height)
+        {
+            unsigned char *Row = &Rgb[(size_t)Encoder.next_scanline * View.Width * 3];
+            jpeg_write_scanlines(&Encoder, &Row, 1);
+        }
+        jpeg_finish_compress(&Encoder);
+        OutSize = Length;
+        std::free(Buffer);
+        jpeg_destroy_compress(&Encoder);
+    });
+}
+
+int main(int ArgumentCount, char **Arguments)
+{
+    const int Repeats = GetRepeatCount(ArgumentCount, Arguments, 10);
+    CSyntheticUi Ui(2560, 1440);
+    SImageView View = Ui.Render(0);
+    const int MaxThreads = (int)std::max(1u, std::thread::hardware_concurrency());
+
+    struct SCase
+    {
+        const char *Name;
+        int Quality;
+        bool Subsample;
+        int Downscale;
+        int ThreadCount;
+    };
+    const SCase Cases[] = {
+        {"q75 4:2:0", 75, true, 1, 1},
+        {"q75 4:4:4", 75, false, 1, 1},
+        {"q50 4:2:0", 50, true, 1, 1},
+        {"q90 4:2:0", 90, true, 1, 1},
+        {"q75 4:2:0 4x thumbnail", 75, true, 4, 1},
+        {"q75 4:2:0 all threads", 75, true, 1, MaxThreads},
+    };
+    for (const SCase &Case : Cases)
+    {
+        SJpegSettings Settings;
+        Settings.Quality = Case.Quality;
+        Settings.Subsample = Case.Subsample;
+        Settings.Downscale = Case.Downscale;
+        Settings.ThreadCount = Case.ThreadCount;
+        CJpegEncoder Encoder(Settings);
+        std::vector<uint8_t> Output;
+        double Milliseconds = MeasureBestMilliseconds(Repeats, [&] { Encoder.Encode(View, Output); });
+
+        SDecodedJpeg Decoded;
+        double Psnr = DecodeReferenceJpeg(Output, Decoded) ? ComputeJpegPsnr(View, Case.Downscale, Decoded) : 0.0;
+        std::printf("%-26s %2d thread(s) %8.2f ms %9zu bytes %6.2f dB\n", Case.Name, Case.ThreadCount, Milliseconds,
+            Output.size(), Psnr);
+    }
+
+    for (int Quality : {50, 75, 90})
+    {
+        size_t Size = 0;
+        double Milliseconds = EncodeWithLibjpeg(View, Quality, Repeats, Size);
+        std::printf("libjpeg q%d 4:2:0            1 thread(s) %8.2f ms %9zu bytes\n", Quality, Milliseconds, Size);
+    }
+    return 0;
+}
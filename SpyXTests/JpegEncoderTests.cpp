@@ -0,0 +1,161 @@
+#include "TestFramework.h"
+#include "JpegTestSupport.h"
+#include "SyntheticUi.h"
+#include "Imaging/JpegEncoder.h"
+
+#include <cmath>
+#include <vector>
+
+// Every output is decoded by libjpeg, which must accept it without warnings and return an
+// image of the expected size that is close to the source.
+
+// Smooth photo-like content, which JPEG reproduces well at any setting. Features are
+// stretched by Scale so they stay equally smooth after a Scale-fold downscale.
+static std::vector<uint8_t> MakeSmoothImage(int Width, int Height, int Scale = 1)
+{
+    std::vector<uint8_t> Pixels((size_t)Width * Height * 4);
+    for (int Y = 0; Y < Height; Y++)
+    {
+        for (int X = 0; X < Width; X++)
+        {
+            uint8_t *Pixel = &Pixels[((size_t)Y * Width + X) * 4];
+            const double U = (double)X / Scale;
+            const double V = (double)Y / Scale;
+            Pixel[0] = (uint8_t)(128 + 100 * std::sin(U * 0.05) * std::cos(V * 0.03));
+            Pixel[1] = (uint8_t)(128 + 90 * std::sin(U * 0.02 + V * 0.04));
+            Pixel[2] = (uint8_t)(64 + 60 * std::cos(U * 0.03 - V * 0.02));
+            Pixel[3] = 255;
+        }
+    }
+    return Pixels;
+}
+
+static std::vector<uint8_t> ToGray(const std::vector<uint8_t> &Pixels)
+{
+    std::vector<uint8_t> Gray(Pixels.size() / 4);
+    for (size_t Index = 0; Index < Gray.size(); Index++) Gray[Index] = Pixels[Index * 4 + 1];
+    return Gray;
+}
+
+SPYX_TEST(SettingsDecodeWithReference)
+{
+    const int Sizes[][2] = {{1, 1}, {17, 9}, {33, 31}, {200, 120}};
+    for (const auto &Size : Sizes)
+    {
+        const int Width = Size[0];
+        const int Height = Size[1];
+        for (int Downscale : {1, 2, 3, 8})
+        {
+            std::vector<uint8_t> Color = MakeSmoothImage(Width, Height, Downscale);
+            std::vector<uint8_t> Gray = ToGray(Color);
+
+            for (int Quality : {10, 50, 75, 95})
+            {
+                for (int Mode = 0; Mode < 3; Mode++)  // 4:2:0, 4:4:4, grey
+                {
+                    for (int ThreadCount : {1, 3})
+                    {
+                        const bool IsGray = Mode == 2;
+                        SImageView View;
+                        View.Data = IsGray ? Gray.data() : Color.data();
+                        View.Width = Width;
+                        View.Height = Height;
+                        View.Stride = IsGray ? Width : Width * 4;
+                        View.Format = IsGray ? EPixelFormat::Gray8 : EPixelFormat::BGRA8;
+
+                        SJpegSettings Settings;
+                        Settings.Quality = Quality;
+                        Settings.Subsample = Mode == 0;
+                        Settings.Downscale = Downscale;
+                        Settings.ThreadCount = ThreadCount;
+                        Settings.RestartRows = ThreadCount > 1 ? 1 : 0;
+                        CJpegEncoder Encoder(Settings);
+
+                        std::vector<uint8_t> Output;
+                        bool Encoded = Encoder.Encode(View, Output);
+                        if (Width / Downscale < 1 || Height / Downscale < 1)
+                        {
+                            SPYX_CHECK(!Encoded);
+                            continue;
+                        }
+                        SPYX_REQUIRE(Encoded);
+
+                        SDecodedJpeg Decoded;
+                        SPYX_REQUIRE(DecodeReferenceJpeg(Output, Decoded));
+                        SPYX_CHECK(Decoded.Warnings == 0);
+                        SPYX_CHECK(Decoded.Width == Width / Downscale && Decoded.Height == Height / Downscale);
+                        SPYX_CHECK(Decoded.Components == (IsGray ? 1 : 3));
+                        double Psnr = ComputeJpegPsnr(View, Downscale, Decoded);
+                        SPYX_CHECK(Psnr >= (Quality >= 50 ? 30.0 : 24.0));
+                    }
+                }
+            }
+        }
+    }
+}
+
+SPYX_TEST(QualityTradesSizeForError)
+{
+    CSyntheticUi Ui(640, 400);
+    SImageView View = Ui.Render(0);
+    size_t PreviousSize = 0;
+    double PreviousPsnr = 0.0;
+    for (int Quality : {30, 60, 90})
+    {
+        SJpegSettings Settings;
+        Settings.Quality = Quality;
+        CJpegEncoder Encoder(Settings);
+        std::vector<uint8_t> Output;
+        SPYX_REQUIRE(Encoder.Encode(View, Output));
+        SDecodedJpeg Decoded;
+        SPYX_REQUIRE(DecodeReferenceJpeg(Output, Decoded));
+        double Psnr = ComputeJpegPsnr(View, 1, Decoded);
+        SPYX_CHECK(Output.size() > PreviousSize);
+        SPYX_CHECK(Psnr > PreviousPsnr);
+        PreviousSize = Output.size();
+        PreviousPsnr = Psnr;
+    }
+}
+
+SPYX_TEST(SegmentsMatchSingleThreadPixels)
+{
+    // Restart segments only change the entropy-coded layout; decoded pixels are identical
+    std::vector<uint8_t> Color = MakeSmoothImage(333, 211);
+    SImageView View;
+    View.Data = Color.data();
+    View.Width = 333;
+    View.Height = 211;
+    View.Stride = 333 * 4;
+
+    SJpegSettings Single;
+    Single.ThreadCount = 1;
+    SJpegSettings Segmented;
+    Segmented.ThreadCount = 4;
+    Segmented.RestartRows = 2;
+    std::vector<uint8_t> First, Second;
+    SPYX_REQUIRE(CJpegEncoder(Single).Encode(View, First));
+    SPYX_REQUIRE(CJpegEncoder(Segmented).Encode(View, Second));
+
+    SDecodedJpeg FirstDecoded, SecondDecoded;
+    SPYX_REQUIRE(DecodeReferenceJpeg(First, FirstDecoded));
+    SPYX_REQUIRE(DecodeReferenceJpeg(Second, SecondDecoded));
+    SPYX_CHECK(SecondDecoded.Warnings == 0);
+    SPYX_CHECK(FirstDecoded.Pixels == SecondDecoded.Pixels);
+}
+
+SPYX_TEST(InvalidInputIsRejected)
+{
+    CJpegEncoder Encoder;
+    std::vector<uint8_t> Output;
+    SImageView Empty;
+    SPYX_CHECK(!Encoder.Encode(Empty, Output));
+
+    uint16_t Half[4] = {};
+    SImageView Unsupported;
+    Unsupported.Data = (const uint8_t *)Half;
+    Unsupported.Width = 1;
+    Unsupported.Height = 1;
+    Unsupported.Stride = 8;
+    Unsupported.Format = EPixelFormat::RGBA16F;
+    SPYX_CHECK(!Encoder.Encode(Unsupported, Output));
+}
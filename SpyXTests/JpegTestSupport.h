@@ -0,0 +1,106 @@
+#ifndef TAPI_JPEG_TEST_SUPPORT_H
+#define TAPI_JPEG_TEST_SUPPORT_H
+
+#include "Imaging/ImageView.h"
+
+#include <cmath>
+#include <csetjmp>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include <jpeglib.h>
+
+// libjpeg as the reference decoder. Errors and warnings are caught instead of exiting.
+
+struct SJpegErrorManager
+{
+    jpeg_error_mgr Base;
+    std::jmp_buf Jump;
+};
+
+static void OnJpegError(j_common_ptr Info)
+{
+    std::longjmp(reinterpret_cast<SJpegErrorManager *>(Info->err)->Jump, 1);
+}
+
+static void OnJpegMessage(j_common_ptr, int) {}
+
+struct SDecodedJpeg
+{
+    int Width = 0;
+    int Height = 0;
+    int Components = 0;
+    long Warnings = 0;
+    std::vector<uint8_t> Pixels;  // RGB or grey, tightly packed
+};
+
+inline bool DecodeReferenceJpeg(const std::vector<uint8_t> &Data, SDecodedJpeg &Out)
+{
+    jpeg_decompress_struct Decoder;
+    SJpegErrorManager Errors;
+    Decoder.err = jpeg_std_error(&Errors.Base);
+    Errors.Base.error_exit = OnJpegError;
+    Errors.Base.emit_message = OnJpegMessage;
+    jpeg_create_decompress(&Decoder);
+    if (setjmp(Errors.Jump))
+    {
+        jpeg_destroy_decompress(&Decoder);
+        return false;
+    }
+
+    jpeg_mem_src(&Decoder, const_cast<unsigned char *>(Data.data()), (unsigned long)Data.size());
+    if (jpeg_read_header(&Decoder, TRUE) != JPEG_HEADER_OK)
+    {
+        jpeg_destroy_decompress(&Decoder);
+        return false;
+    }
+    jpeg_start_decompress(&Decoder);
+    Out.Width = (int)Decoder.output_width;
+    Out.Height = (int)Decoder.output_height;
+    Out.Components = Decoder.output_components;
+    Out.Pixels.resize((size_t)Out.Width * Out.Height * Out.Components);
+    while (Decoder.output_scanline < Decoder.output_height)
+    {
+        unsigned char *Row = &Out.Pixels[(size_t)Decoder.output_scanline * Out.Width * Out.Components];
+        jpeg_read_scanlines(&Decoder, &Row, 1);
+    }
+    jpeg_finish_decompress(&Decoder);
+    Out.Warnings = Errors.Base.num_warnings;
+    jpeg_destroy_decompress(&Decoder);
+    return true;
+}
+
+// PSNR of a decoded image against the source box-filtered by Downscale
+inline double ComputeJpegPsnr(const SImageView &Source, int Downscale, const SDecodedJpeg &Decoded)
+{
+    const bool IsGray = Source.Format == EPixelFormat::Gray8;
+    double SquaredError = 0.0;
+    size_t Count = 0;
+    for (int Y = 0; Y < Decoded.Height; Y++)
+    {
+        for (int X = 0; X < Decoded.Width; X++)
+        {
+            for (int Channel = 0; Channel < Decoded.Components; Channel++)
+            {
+                double Sum = 0.0;
+                for (int Dy = 0; Dy < Downscale; Dy++)
+                {
+                    const uint8_t *Row = Source.Row(Y * Downscale + Dy);
+                    for (int Dx = 0; Dx < Downscale; Dx++)
+                    {
+                        Sum += IsGray ? Row[X * Downscale + Dx] : Row[(X * Downscale + Dx) * 4 + 2 - Channel];
+                    }
+                }
+                double Difference = Decoded.Pixels[((size_t)Y * Decoded.Width + X) * Decoded.Components + Channel] -
+                    Sum / (Downscale * Downscale);
+                SquaredError += Difference * Difference;
+                Count++;
+            }
+        }
+    }
+    if (SquaredError == 0.0) return 99.0;
+    return 10.0 * std::log10(255.0 * 255.0 * Count / SquaredError);
+}
+
+#endif
@@ -0,0 +1,54 @@
+#include "TestFramework.h"
+#include "Imaging/PaletteQuantizer.h"
+
+#include <climits>
+#include <vector>
+
+// Sampling steps past the frame, and builds that fail without touching the current palette.
+
+static SImageView MakeView(const std::vector<uint32_t> &Pixels, int Width, int Height)
+{
+    SImageView Frame;
+    Frame.Data = reinterpret_cast<const uint8_t *>(Pixels.data());
+    Frame.Width = Width;
+    Frame.Height = Height;
+    Frame.Stride = Width * 4;
+    return Frame;
+}
+
+SPYX_TEST(StepsPastTheFrameStillSample)
+{
+    std::vector<uint32_t> Pixels(5 * 3, 0xFF204060u);
+    const SImageView Frame = MakeView(Pixels, 5, 3);
+    for (EPaletteMethod Method : {EPaletteMethod::MedianCut, EPaletteMethod::Popularity})
+    {
+        for (int Step : {4, 7, 1000, INT_MAX})
+        {
+            // Step / 2 used to start past a side, leaving no samples and an empty palette
+            CPaletteQuantizer Quantizer;
+            SPYX_REQUIRE(Quantizer.BuildPalette(Frame, Method, 16, Step));
+            SPYX_REQUIRE(Quantizer.GetColorCount() == 1);
+            SPYX_CHECK(Quantizer.GetPalette()[0] == 0xFF204060u);
+        }
+    }
+}
+
+SPYX_TEST(FailedBuildKeepsPalette)
+{
+    const uint32_t Colors[2] = {0xFF000000u, 0xFFFFFFFFu};
+    CPaletteQuantizer Quantizer;
+    SPYX_REQUIRE(Quantizer.SetPalette(Colors, 2));
+
+    std::vector<uint32_t> Pixels(8 * 8, 0xFFF0F0F0u);
+    SImageView Frame = MakeView(Pixels, 8, 8);
+    SPYX_CHECK(!Quantizer.BuildPalette(Frame, EPaletteMethod::MedianCut, 0, 1));
+    Frame.Format = EPixelFormat::RGBA16F;
+    SPYX_CHECK(!Quantizer.BuildPalette(Frame, EPaletteMethod::MedianCut, 16, 1));
+    Frame.Format = EPixelFormat::BGRA8;
+    SPYX_REQUIRE(Quantizer.GetColorCount() == 2);
+    SPYX_CHECK(Quantizer.GetPalette()[1] == 0xFFFFFFFFu);
+
+    std::vector<uint8_t> Indices(Pixels.size());
+    SPYX_REQUIRE(Quantizer.Quantize(Frame, Indices.data(), 8));
+    for (uint8_t Index : Indices) SPYX_CHECK(Index == 1);
+}
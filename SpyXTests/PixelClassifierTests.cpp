@@ -0,0 +1,105 @@
+#include "TestFramework.h"
+#include "Analysis/PixelClassifier.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <vector>
+
+// Label maps against per-pixel lookups of their sample pixels, and search areas whose edges
+// used to overflow 32-bit arithmetic.
+
+static CPixelClassifier MakeRedClassifier()
+{
+    SColorRule Rule;
+    Rule.Type = EColorRuleType::RgbBox;
+    Rule.Label = 7;
+    Rule.Color = 0xFFC00000u;
+    Rule.ColorHigh = 0xFFFF4040u;
+    CPixelClassifier Classifier;
+    Classifier.Compile(&Rule, 1);
+    return Classifier;
+}
+
+SPYX_TEST(RandomMapsMatchLookup)
+{
+    CTestRandom Random(5);
+    const CPixelClassifier Classifier = MakeRedClassifier();
+    SPYX_REQUIRE(Classifier.IsCompiled());
+    for (int Trial = 0; Trial < 200; Trial++)
+    {
+        const int Width = Random.Range(1, 70);
+        const int Height = Random.Range(1, 40);
+        std::vector<uint32_t> Pixels((size_t)Width * Height);
+        for (uint32_t &Color : Pixels) Color = Random.Next() % 2 ? 0xFFE02010u : Random.Next() | 0xFF000000u;
+        SImageView Frame;
+        Frame.Data = reinterpret_cast<const uint8_t *>(Pixels.data());
+        Frame.Width = Width;
+        Frame.Height = Height;
+        Frame.Stride = Width * 4;
+
+        SClassifyOptions Options;
+        Options.Step = Random.Range(1, 4);
+        if (Random.Next() % 2)
+        {
+            Options.RoiX = Random.Range(-5, 14);
+            Options.RoiY = Random.Range(-5, 14);
+            Options.RoiWidth = Random.Range(1, Width);
+            Options.RoiHeight = Random.Range(1, Height);
+        }
+
+        int MapWidth = 0;
+        int MapHeight = 0;
+        CPixelClassifier::GetLabelMapSize(Frame, Options, MapWidth, MapHeight);
+        const SPixelRect Area = ClipToFrame(Options.RoiX, Options.RoiY, Options.RoiWidth, Options.RoiHeight, Width,
+            Height);
+        const bool IsEmpty = Area.IsEmpty();
+        SPYX_CHECK(MapWidth == (IsEmpty ? 0 : (Area.GetWidth() + Options.Step - 1) / Options.Step));
+        SPYX_CHECK(MapHeight == (IsEmpty ? 0 : (Area.GetHeight() + Options.Step - 1) / Options.Step));
+
+        std::vector<uint8_t> Labels((size_t)std::max(MapWidth, 1) * std::max(MapHeight, 1));
+        uint32_t Counts[256];
+        SPYX_REQUIRE(Classifier.Classify(Frame, Options, Labels.data(), std::max(MapWidth, 1), Counts));
+        uint32_t Total = 0;
+        for (int Y = 0; Y < MapHeight; Y++)
+        {
+            const int SourceY = std::min(Area.Top + Y * Options.Step + Options.Step / 2, Area.Bottom - 1);
+            for (int X = 0; X < MapWidth; X++)
+            {
+                const int SourceX = std::min(Area.Left + X * Options.Step + Options.Step / 2, Area.Right - 1);
+                SPYX_CHECK(Labels[(size_t)Y * MapWidth + X] ==
+                    Classifier.Lookup(Pixels[(size_t)SourceY * Width + SourceX]));
+            }
+        }
+        for (uint32_t Count : Counts) Total += Count;
+        SPYX_CHECK(Total == (uint32_t)(MapWidth * MapHeight));
+    }
+}
+
+SPYX_TEST(HugeStepSamplesInsideArea)
+{
+    std::vector<uint32_t> Pixels(32 * 16, 0xFF102030u);
+    Pixels[15 * 32 + 31] = 0xFFE02010u;
+    SImageView Frame;
+    Frame.Data = reinterpret_cast<const uint8_t *>(Pixels.data());
+    Frame.Width = 32;
+    Frame.Height = 16;
+    Frame.Stride = 32 * 4;
+    const CPixelClassifier Classifier = MakeRedClassifier();
+
+    // One sample for the whole area, whose offset must not run past it
+    SClassifyOptions Options;
+    Options.RoiX = 1;
+    Options.RoiY = 1;
+    Options.RoiWidth = INT_MAX;
+    Options.RoiHeight = INT_MAX;
+    Options.Step = INT_MAX;
+    int Width = 0;
+    int Height = 0;
+    CPixelClassifier::GetLabelMapSize(Frame, Options, Width, Height);
+    SPYX_REQUIRE(Width == 1 && Height == 1);
+    uint8_t Labels[1];
+    uint32_t Counts[256];
+    SPYX_REQUIRE(Classifier.Classify(Frame, Options, Labels, Width, Counts));
+    SPYX_CHECK(Labels[0] == 7);
+}
@@ -0,0 +1,195 @@
+#include "TestFramework.h"
+#include "Analysis/PixelSampler.h"
+
+#include <algorithm>
+#include <climits>
+#include <vector>
+
+// Point and neighbourhood samples against a scalar reference, over BGRA8 and Gray8 frames
+// with padded strides and points in and out of order, some outside the frame. Runs of eight
+// points go through the AVX2 gather and row sums through SSE2 when those are built.
+
+static const uint32_t Canary = 0xDEADBEEFu;
+
+struct STestFrame
+{
+    std::vector<uint8_t> Pixels;
+    SImageView View;
+};
+
+// Random pixels, and random garbage in the padding past each row
+static STestFrame MakeFrame(CTestRandom &Random, EPixelFormat Format)
+{
+    STestFrame Frame;
+    Frame.View.Width = Random.Range(1, 90);
+    Frame.View.Height = Random.Range(1, 70);
+    Frame.View.Stride = Frame.View.Width * GetBytesPerPixel(Format) + Random.Range(0, 3) * 4;
+    Frame.View.Format = Format;
+    Frame.Pixels.resize((size_t)Frame.View.Stride * Frame.View.Height);
+    for (uint8_t &Byte : Frame.Pixels) Byte = (uint8_t)Random.Next();
+    Frame.View.Data = Frame.Pixels.data();
+    return Frame;
+}
+
+// Points near and inside the frame, a few far outside, either shuffled or in row order
+static std::vector<int32_t> MakePoints(CTestRandom &Random, const SImageView &Frame, int Count)
+{
+    std::vector<int32_t> Points((size_t)Count * 2);
+    for (int Index = 0; Index < Count; Index++)
+    {
+        const int Kind = Random.Range(0, 19);
+        int32_t X = Random.Range(-3, Frame.Width + 2);
+        int32_t Y = Random.Range(-3, Frame.Height + 2);
+        if (Kind == 0) X = Random.Range(0, 1) ? INT_MIN : INT_MAX;
+        if (Kind == 1) Y = Random.Range(0, 1) ? INT_MIN : INT_MAX;
+        if (Kind == 2) X = Frame.Width + (1 << 20);
+        Points[2 * Index] = X;
+        Points[2 * Index + 1] = Y;
+    }
+    if (Random.Range(0, 2) == 0)
+    {
+        std::vector<std::pair<int32_t, int32_t>> Pairs;
+        for (int Index = 0; Index < Count; Index++) Pairs.emplace_back(Points[2 * Index + 1], Points[2 * Index]);
+        std::sort(Pairs.begin(), Pairs.end());
+        for (int Index = 0; Index < Count; Index++)
+        {
+            Points[2 * Index] = Pairs[Index].second;
+            Points[2 * Index + 1] = Pairs[Index].first;
+        }
+    }
+    return Points;
+}
+
+static bool IsInside(const SImageView &Frame, int32_t X, int32_t Y)
+{
+    return X >= 0 && Y >= 0 && X < Frame.Width && Y < Frame.Height;
+}
+
+// Channel of pixel (X, Y) as BGRA, Gray8 replicated with alpha 255
+static int GetChannel(const SImageView &Frame, int X, int Y, int Channel)
+{
+    if (Frame.Format == EPixelFormat::BGRA8) return Frame.Row(Y)[X * 4 + Channel];
+    return Channel == 3 ? 255 : Frame.Row(Y)[X];
+}
+
+static uint32_t ReferencePixel(const SImageView &Frame, int32_t X, int32_t Y)
+{
+    if (!IsInside(Frame, X, Y)) return 0;
+    uint32_t Color = 0;
+    for (int Channel = 0; Channel < 4; Channel++) Color |= (uint32_t)GetChannel(Frame, X, Y, Channel) << (Channel * 8);
+    return Color;
+}
+
+// Mean, or minimum and maximum, of the clipped Size x Size window
+static void ReferenceNeighbourhood(const SImageView &Frame, int32_t X, int32_t Y, int Size, ENeighbourhoodMode Mode,
+    uint32_t *Out)
+{
+    const int Count = Mode == ENeighbourhoodMode::Mean ? 1 : 2;
+    if (!IsInside(Frame, X, Y))
+    {
+        for (int Index = 0; Index < Count; Index++) Out[Index] = 0;
+        return;
+    }
+
+    const int Before = (Size - 1) / 2;
+    uint32_t Mean = 0;
+    uint32_t Minimum = 0;
+    uint32_t Maximum = 0;
+    for (int Channel = 0; Channel < 4; Channel++)
+    {
+        int Sum = 0;
+        int PixelCount = 0;
+        int Low = 255;
+        int High = 0;
+        for (int WindowY = Y - Before; WindowY < Y - Before + Size; WindowY++)
+        {
+            for (int WindowX = X - Before; WindowX < X - Before + Size; WindowX++)
+            {
+                if (!IsInside(Frame, WindowX, WindowY)) continue;
+                const int Value = GetChannel(Frame, WindowX, WindowY, Channel);
+                Sum += Value;
+                PixelCount++;
+                Low = std::min(Low, Value);
+                High = std::max(High, Value);
+            }
+        }
+        Mean |= (uint32_t)((Sum + PixelCount / 2) / PixelCount) << (Channel * 8);
+        Minimum |= (uint32_t)Low << (Channel * 8);
+        Maximum |= (uint32_t)High << (Channel * 8);
+    }
+    if (Mode == ENeighbourhoodMode::Mean)
+    {
+        Out[0] = Mean;
+        return;
+    }
+    Out[0] = Minimum;
+    Out[1] = Maximum;
+}
+
+SPYX_TEST(PixelsMatchReference)
+{
+    CTestRandom Random(39);
+    for (int Trial = 0; Trial < 400; Trial++)
+    {
+        const STestFrame Frame = MakeFrame(Random, Trial % 2 ? EPixelFormat::Gray8 : EPixelFormat::BGRA8);
+        const int Count = Random.Range(1, 200);
+        const std::vector<int32_t> Points = MakePoints(Random, Frame.View, Count);
+
+        std::vector<uint32_t> Out((size_t)Count + 1, Canary);
+        const int Inside = SamplePixels(Frame.View, Points.data(), Count, Out.data());
+        int ExpectedInside = 0;
+        for (int Index = 0; Index < Count; Index++)
+        {
+            ExpectedInside += IsInside(Frame.View, Points[2 * Index], Points[2 * Index + 1]);
+            SPYX_CHECK(Out[Index] == ReferencePixel(Frame.View, Points[2 * Index], Points[2 * Index + 1]));
+        }
+        SPYX_CHECK(Inside == ExpectedInside);
+        SPYX_CHECK(Out[Count] == Canary);
+    }
+}
+
+SPYX_TEST(NeighbourhoodsMatchReference)
+{
+    CTestRandom Random(390);
+    for (int Trial = 0; Trial < 600; Trial++)
+    {
+        const STestFrame Frame = MakeFrame(Random, Trial % 2 ? EPixelFormat::Gray8 : EPixelFormat::BGRA8);
+        const ENeighbourhoodMode Mode = Trial / 2 % 2 ? ENeighbourhoodMode::MinMax : ENeighbourhoodMode::Mean;
+        const int Size = Trial / 4 % MaxNeighbourhoodSize + 1;
+        const int Count = Random.Range(1, 80);
+        const std::vector<int32_t> Points = MakePoints(Random, Frame.View, Count);
+
+        const int PerPoint = Mode == ENeighbourhoodMode::Mean ? 1 : 2;
+        std::vector<uint32_t> Out((size_t)Count * PerPoint + 1, Canary);
+        const int Inside = SampleNeighbourhoods(Frame.View, Points.data(), Count, Size, Mode, Out.data());
+        int ExpectedInside = 0;
+        for (int Index = 0; Index < Count; Index++)
+        {
+            const int32_t X = Points[2 * Index];
+            const int32_t Y = Points[2 * Index + 1];
+            ExpectedInside += IsInside(Frame.View, X, Y);
+
+            uint32_t Expected[2];
+            ReferenceNeighbourhood(Frame.View, X, Y, Size, Mode, Expected);
+            for (int Slot = 0; Slot < PerPoint; Slot++) SPYX_CHECK(Out[(size_t)Index * PerPoint + Slot] == Expected[Slot]);
+        }
+        SPYX_CHECK(Inside == ExpectedInside);
+        SPYX_CHECK(Out[(size_t)Count * PerPoint] == Canary);
+    }
+}
+
+SPYX_TEST(InvalidArgumentsSampleNothing)
+{
+    CTestRandom Random(3900);
+    STestFrame Frame = MakeFrame(Random, EPixelFormat::BGRA8);
+    const int32_t Points[2] = {0, 0};
+    uint32_t Out[2] = {Canary, Canary};
+
+    SPYX_CHECK(SampleNeighbourhoods(Frame.View, Points, 1, 0, ENeighbourhoodMode::Mean, Out) == 0);
+    SPYX_CHECK(SampleNeighbourhoods(Frame.View, Points, 1, MaxNeighbourhoodSize + 1, ENeighbourhoodMode::Mean, Out) == 0);
+    SPYX_CHECK(SampleNeighbourhoods(Frame.View, Points, 1, 3, (ENeighbourhoodMode)2, Out) == 0);
+    SPYX_CHECK(SamplePixels(Frame.View, Points, 0, Out) == 0);
+    Frame.View.Format = EPixelFormat::RGBA16F;
+    SPYX_CHECK(SamplePixels(Frame.View, Points, 1, Out) == 0);
+    SPYX_CHECK(Out[0] == Canary && Out[1] == Canary);
+}
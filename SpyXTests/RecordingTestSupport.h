@@ -0,0 +1,64 @@
+#ifndef TAPI_RECORDING_TEST_SUPPORT_H
+#define TAPI_RECORDING_TEST_SUPPORT_H
+
+#include "Imaging/ImageView.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Scratch files and frame comparisons shared by the recording, replay buffer and screenshot tests.
+
+inline std::string MakeTestPath(const char *Name)
+{
+    return "/tmp/spyx-test-" + std::to_string(getpid()) + "-" + Name;
+}
+
+// Removes the file when the test case ends, however it ends
+class CTestFile
+{
+public:
+    explicit CTestFile(const char *Name) : MPath(MakeTestPath(Name)) { std::remove(MPath.c_str()); }
+    ~CTestFile() { std::remove(MPath.c_str()); }
+
+    const char *GetPath() const { return MPath.c_str(); }
+
+    std::vector<uint8_t> Read() const
+    {
+        std::vector<uint8_t> Bytes;
+        std::FILE *File = std::fopen(MPath.c_str(), "rb");
+        if (!File) return Bytes;
+        uint8_t Buffer[65536];
+        size_t Count;
+        while ((Count = std::fread(Buffer, 1, sizeof(Buffer), File)) > 0) Bytes.insert(Bytes.end(), Buffer, Buffer + Count);
+        std::fclose(File);
+        return Bytes;
+    }
+
+    bool Write(const uint8_t *Data, size_t Size) const
+    {
+        std::FILE *File = std::fopen(MPath.c_str(), "wb");
+        if (!File) return false;
+        const bool Written = std::fwrite(Data, 1, Size, File) == Size;
+        return std::fclose(File) == 0 && Written;
+    }
+
+private:
+    std::string MPath;
+};
+
+// Same size and pixels; strides may differ
+inline bool IsSameImage(const SImageView &Expected, const SImageView &Actual)
+{
+    if (Expected.Width != Actual.Width || Expected.Height != Actual.Height || Expected.Format != Actual.Format) return false;
+    const size_t RowBytes = (size_t)Expected.Width * GetBytesPerPixel(Expected.Format);
+    for (int Y = 0; Y < Expected.Height; Y++)
+    {
+        if (std::memcmp(Expected.Row(Y), Actual.Row(Y), RowBytes) != 0) return false;
+    }
+    return true;
+}
+
+#endif
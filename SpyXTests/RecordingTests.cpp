@@ -0,0 +1,185 @@
+#include "TestFramework.h"
+#include "RecordingTestSupport.h"
+#include "SyntheticUi.h"
+#include "Recording/FrameCodec.h"
+#include "Recording/RecordingFile.h"
+#include "Recording/RecordingSource.h"
+
+#include <vector>
+
+// Recordings of synthetic UI frames written, reopened, seeked and cut short. Frame N is
+// stamped N * 1000 + 500 and is Render(N), so every decoded frame can be checked exactly.
+
+static const int FrameWidth = 160;
+static const int FrameHeight = 100;
+
+static int64_t GetFrameTime(int Frame)
+{
+    return (int64_t)Frame * 1000 + 500;
+}
+
+// Writes Count frames with a keyframe every 7; returns the payload offset of each frame
+static std::vector<uint64_t> WriteRecording(const char *Path, int Count, bool IsClosed)
+{
+    std::vector<uint64_t> Offsets;
+    SFrameCodecSettings Settings;
+    Settings.KeyframeInterval = 7;
+    CFrameEncoder Encoder(Settings);
+    CSyntheticUi Ui(FrameWidth, FrameHeight);
+    CRecordingWriter Writer;
+    if (!Writer.Open(Path, RecordingCodecTiled, 4096)) return Offsets;
+
+    std::vector<uint8_t> Encoded;
+    for (int Frame = 0; Frame < Count; Frame++)
+    {
+        SEncodedFrameInfo Info;
+        if (!Encoder.Encode(Ui.Render(Frame), Encoded, &Info)) return std::vector<uint64_t>();
+        Offsets.push_back(Writer.GetBytesWritten() + 16);  // Past the record header
+        if (!Writer.AppendFrame(Encoded.data(), Encoded.size(), GetFrameTime(Frame), Info.IsKeyframe)) return std::vector<uint64_t>();
+    }
+    if (IsClosed && !Writer.Close()) return std::vector<uint64_t>();
+    return Offsets;
+}
+
+// Reads the source to its end from its position, checking frames against the synthetic UI
+static int CheckFramesFrom(CRecordingSource &Source, int First)
+{
+    CSyntheticUi Ui(FrameWidth, FrameHeight);
+    SImageView Frame;
+    int64_t Timestamp = 0;
+    int Frames = 0;
+    while (Source.ReadFrame(Frame, &Timestamp))
+    {
+        const int Expected = First + Frames;
+        SPYX_CHECK(Timestamp == GetFrameTime(Expected));
+        SPYX_CHECK(IsSameImage(Ui.Render(Expected), Frame));
+        Frames++;
+    }
+    return Frames;
+}
+
+SPYX_TEST(WrittenFramesReadBack)
+{
+    CTestFile File("recording-roundtrip.sxr");
+    SPYX_REQUIRE(WriteRecording(File.GetPath(), 30, true).size() == 30);
+
+    CRecordingReader Reader;
+    SPYX_REQUIRE(Reader.Open(File.GetPath()));
+    SPYX_CHECK(!Reader.WasRecovered());
+    SPYX_CHECK(Reader.GetCodec() == RecordingCodecTiled);
+    SPYX_REQUIRE(Reader.GetFrameCount() == 30);
+    for (size_t Index = 0; Index < 30; Index++)
+    {
+        const SRecordingIndexEntry Entry = Reader.GetEntry(Index);
+        SPYX_CHECK(Entry.Timestamp == GetFrameTime((int)Index));
+        SPYX_CHECK(Entry.IsKeyframe() == (Index % 7 == 0));
+        SPYX_CHECK(Entry.KeyframeIndex == Index / 7 * 7);
+    }
+    Reader.Close();
+
+    CRecordingSource Source(2);
+    SPYX_REQUIRE(Source.Open(File.GetPath()));
+    SPYX_CHECK(CheckFramesFrom(Source, 0) == 30);
+}
+
+SPYX_TEST(SeekToTimeFindsFrameAtOrBefore)
+{
+    CTestFile File("recording-seek.sxr");
+    SPYX_REQUIRE(WriteRecording(File.GetPath(), 30, true).size() == 30);
+    CRecordingSource Source;
+    SPYX_REQUIRE(Source.Open(File.GetPath()));
+    CSyntheticUi Ui(FrameWidth, FrameHeight);
+
+    // Between timestamps, on them, backwards across keyframes and outside the recording
+    const int64_t Times[] = {12700, 12500, 3499, 29999, 500, 20100, 0, -5, 99999, 6600, 7500};
+    const int Expected[] = {12, 12, 2, 29, 0, 19, 0, 0, 29, 6, 7};
+    for (size_t Index = 0; Index < sizeof(Times) / sizeof(Times[0]); Index++)
+    {
+        Source.SeekToTime(Times[Index]);
+        SPYX_CHECK(Source.GetPosition() == (size_t)Expected[Index]);
+        SImageView Frame;
+        int64_t Timestamp = 0;
+        SPYX_REQUIRE(Source.ReadFrame(Frame, &Timestamp));
+        SPYX_CHECK(Timestamp == GetFrameTime(Expected[Index]));
+        SPYX_CHECK(IsSameImage(Ui.Render(Expected[Index]), Frame));
+    }
+
+    Source.SeekToFrame(30);
+    SImageView Frame;
+    SPYX_CHECK(!Source.ReadFrame(Frame));
+}
+
+SPYX_TEST(TruncatedRecordingRecoversIndex)
+{
+    CTestFile File("recording-truncated.sxr");
+    const std::vector<uint64_t> Offsets = WriteRecording(File.GetPath(), 20, true);
+    SPYX_REQUIRE(Offsets.size() == 20);
+    const std::vector<uint8_t> Bytes = File.Read();
+
+    // Cut inside the payload of frame Kept: the index and that frame's record are lost
+    for (int Kept : {1, 6, 7, 13, 19})
+    {
+        SPYX_REQUIRE(File.Write(Bytes.data(), (size_t)Offsets[Kept] + 3));
+        CRecordingSource Source;
+        SPYX_REQUIRE(Source.Open(File.GetPath()));
+        SPYX_CHECK(Source.GetReader().WasRecovered());
+        SPYX_REQUIRE(Source.GetFrameCount() == (size_t)Kept);
+        SPYX_CHECK(Source.GetReader().GetEntry(Kept - 1).KeyframeIndex == (uint32_t)(Kept - 1) / 7 * 7);
+        SPYX_CHECK(CheckFramesFrom(Source, 0) == Kept);
+        Source.SeekToTime(GetFrameTime(Kept - 1) + 10);
+        SPYX_CHECK(CheckFramesFrom(Source, Kept - 1) == 1);
+    }
+
+    // A recording left open (nothing finalized) recovers the same way
+    {
+        CTestFile Open("recording-unclosed.sxr");
+        CRecordingWriter Writer;
+        SPYX_REQUIRE(Writer.Open(Open.GetPath(), RecordingCodecTiled, 64));
+        std::vector<uint8_t> Payload(100, 7);
+        SPYX_REQUIRE(Writer.AppendFrame(Payload.data(), Payload.size(), 10, true));
+        SPYX_REQUIRE(Writer.AppendFrame(Payload.data(), Payload.size(), 20, false));
+        CRecordingReader Reader;
+        SPYX_REQUIRE(Reader.Open(Open.GetPath()));
+        SPYX_CHECK(Reader.WasRecovered());
+        SPYX_CHECK(Reader.GetFrameCount() == 2);
+        Reader.Close();
+        SPYX_CHECK(Writer.Close());
+    }
+}
+
+SPYX_TEST(HeaderWithoutFramesOpensEmpty)
+{
+    // Closed without frames: finalized with an empty index
+    CTestFile Closed("recording-empty.sxr");
+    {
+        CRecordingWriter Writer;
+        SPYX_REQUIRE(Writer.Open(Closed.GetPath()));
+        SPYX_REQUIRE(Writer.Close());
+    }
+    CRecordingSource Source;
+    SPYX_REQUIRE(Source.Open(Closed.GetPath()));
+    SPYX_CHECK(Source.GetFrameCount() == 0);
+    SImageView Frame;
+    SPYX_CHECK(!Source.ReadFrame(Frame));
+    Source.SeekToTime(1000);
+    SPYX_CHECK(!Source.ReadFrame(Frame));
+
+    // Cut right after the header, before the first record
+    CTestFile Cut("recording-header-only.sxr");
+    const std::vector<uint8_t> Bytes = Closed.Read();
+    SPYX_REQUIRE(Bytes.size() == 64);
+    std::vector<uint8_t> Provisional = Bytes;
+    Provisional[12] = 0;  // Not finalized, as written by Open
+    SPYX_REQUIRE(Cut.Write(Provisional.data(), Provisional.size()));
+    SPYX_REQUIRE(Source.Open(Cut.GetPath()));
+    SPYX_CHECK(Source.GetReader().WasRecovered());
+    SPYX_CHECK(Source.GetFrameCount() == 0);
+    SPYX_CHECK(!Source.ReadFrame(Frame));
+
+    // Too short for a header, or not a recording
+    SPYX_REQUIRE(Cut.Write(Bytes.data(), 40));
+    SPYX_CHECK(!Source.Open(Cut.GetPath()));
+    std::vector<uint8_t> Garbage(Bytes.size(), 0x5A);
+    SPYX_REQUIRE(Cut.Write(Garbage.data(), Garbage.size()));
+    SPYX_CHECK(!Source.Open(Cut.GetPath()));
+}
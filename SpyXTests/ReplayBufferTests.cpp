@@ -0,0 +1,193 @@
+#include "TestFramework.h"
+#include "RecordingTestSupport.h"
+#include "SyntheticUi.h"
+#include "Recording/FrameCodec.h"
+#include "Recording/RecordingFile.h"
+#include "Recording/RecordingSource.h"
+#include "Recording/ReplayBuffer.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Eviction by keyframe group under the time and byte limits, and dumps read back through
+// the recording reader, including dumps racing a writer that keeps appending.
+
+// Payload naming its frame, so a dump shows which frames it kept
+static std::vector<uint8_t> MakePayload(int Frame, size_t Size)
+{
+    std::vector<uint8_t> Payload(Size, (uint8_t)Frame);
+    Payload[0] = (uint8_t)(Frame >> 8);
+    return Payload;
+}
+
+// Frame numbers of a dumped recording, checking each payload against its timestamp
+static std::vector<int> ReadDumpedFrames(const char *Path)
+{
+    std::vector<int> Frames;
+    CRecordingReader Reader;
+    if (!Reader.Open(Path)) return Frames;
+    for (size_t Index = 0; Index < Reader.GetFrameCount(); Index++)
+    {
+        const int Frame = (int)(Reader.GetEntry(Index).Timestamp / 1000);
+        size_t Size = 0;
+        const uint8_t *Data = Reader.GetFrameData(Index, &Size);
+        SPYX_CHECK(Data && Size > 1 && Data[0] == (uint8_t)(Frame >> 8) && Data[Size - 1] == (uint8_t)Frame);
+        Frames.push_back(Frame);
+    }
+    return Frames;
+}
+
+SPYX_TEST(TimeLimitEvictsWholeGroups)
+{
+    SReplayBufferSettings Settings;
+    Settings.MaxDuration = 10000;
+    Settings.MaxBytes = 1 << 20;
+    CReplayBuffer Buffer(Settings);
+
+    // Keyframes every 4 frames, at 0, 4000, 8000, ...
+    for (int Frame = 0; Frame <= 20; Frame++)
+    {
+        const std::vector<uint8_t> Payload = MakePayload(Frame, 50);
+        SPYX_REQUIRE(Buffer.Append(Payload.data(), Payload.size(), Frame * 1000, Frame % 4 == 0));
+    }
+
+    // Groups go while the next one still reaches 10000 back from 20000: 0-3 and 4-7
+    SPYX_CHECK(Buffer.GetFrameCount() == 13);
+    SPYX_CHECK(Buffer.GetDuration() == 12000);
+    SPYX_CHECK(Buffer.GetBytesUsed() == 13 * 50);
+
+    CTestFile File("replay-time.sxr");
+    SPYX_REQUIRE(Buffer.Dump(File.GetPath()));
+    const std::vector<int> Frames = ReadDumpedFrames(File.GetPath());
+    SPYX_REQUIRE(Frames.size() == 13);
+    for (size_t Index = 0; Index < Frames.size(); Index++) SPYX_CHECK(Frames[Index] == 8 + (int)Index);
+
+    Buffer.Clear();
+    SPYX_CHECK(Buffer.GetFrameCount() == 0 && Buffer.GetBytesUsed() == 0);
+    SPYX_CHECK(Buffer.WantsKeyframe(21000));
+    SPYX_CHECK(!Buffer.Dump(File.GetPath()));
+}
+
+SPYX_TEST(ByteLimitEvictsWholeGroups)
+{
+    SReplayBufferSettings Settings;
+    Settings.MaxDuration = 1LL << 40;
+    Settings.MaxBytes = 4096;
+    CReplayBuffer Buffer(Settings);
+
+    CTestRandom Random(33);
+    int LastKeyframe = 0;
+    for (int Frame = 0; Frame < 300; Frame++)
+    {
+        const bool IsKeyframe = Frame % 3 == 0;
+        if (IsKeyframe) LastKeyframe = Frame;
+        const std::vector<uint8_t> Payload = MakePayload(Frame, (size_t)Random.Range(100, 400));
+        SPYX_REQUIRE(Buffer.Append(Payload.data(), Payload.size(), Frame * 1000, IsKeyframe));
+        SPYX_CHECK(Buffer.GetBytesUsed() <= Settings.MaxBytes);
+    }
+
+    // Whatever is left starts at a keyframe and runs without gaps to the newest frame
+    CTestFile File("replay-bytes.sxr");
+    SPYX_REQUIRE(Buffer.Dump(File.GetPath()));
+    const std::vector<int> Frames = ReadDumpedFrames(File.GetPath());
+    SPYX_REQUIRE(Frames.size() == Buffer.GetFrameCount() && Frames.size() >= 6);
+    SPYX_CHECK(Frames.front() % 3 == 0);
+    SPYX_CHECK(Frames.back() == 299 && LastKeyframe == 297);
+    for (size_t Index = 1; Index < Frames.size(); Index++) SPYX_CHECK(Frames[Index] == Frames[Index - 1] + 1);
+
+    // A group past an eighth of the budget asks for a keyframe
+    SPYX_CHECK(Buffer.WantsKeyframe(300000));
+}
+
+SPYX_TEST(UnstorableDeltaFramesAskForKeyframe)
+{
+    SReplayBufferSettings Settings;
+    Settings.MaxBytes = 1024;
+    CReplayBuffer Buffer(Settings);
+
+    const std::vector<uint8_t> Large = MakePayload(0, 600);
+    const std::vector<uint8_t> Small = MakePayload(1, 100);
+    SPYX_CHECK(!Buffer.Append(Small.data(), Small.size(), 0, false));
+    SPYX_REQUIRE(Buffer.Append(Large.data(), Large.size(), 0, true));
+
+    // Room for it means evicting its own reference
+    SPYX_CHECK(!Buffer.Append(Large.data(), Large.size(), 1000, false));
+    SPYX_CHECK(Buffer.WantsKeyframe(2000));
+    SPYX_CHECK(!Buffer.Append(Small.data(), Small.size(), 2000, false));
+    SPYX_CHECK(Buffer.GetFrameCount() == 1);
+
+    // A keyframe may replace the whole buffer
+    SPYX_REQUIRE(Buffer.Append(Large.data(), Large.size(), 3000, true));
+    SPYX_CHECK(Buffer.GetFrameCount() == 1);
+    SPYX_REQUIRE(Buffer.Append(Small.data(), Small.size(), 4000, false));
+    SPYX_CHECK(Buffer.GetFrameCount() == 2);
+}
+
+SPYX_TEST(DumpWhileAppendingDecodesExactly)
+{
+    const int Width = 96;
+    const int Height = 64;
+    SReplayBufferSettings Settings;
+    Settings.MaxDuration = 40000;
+    Settings.MaxBytes = 96 << 10;
+    CReplayBuffer Buffer(Settings);
+
+    SFrameCodecSettings CodecSettings;
+    CodecSettings.KeyframeInterval = 0;
+    CFrameEncoder Encoder(CodecSettings);
+    CSyntheticUi Ui(Width, Height);
+    CSyntheticUi Reference(Width, Height);
+    std::vector<uint8_t> Encoded;
+    int Frame = 0;
+    auto AppendNext = [&]
+    {
+        const int64_t Timestamp = (int64_t)Frame * 1000;
+        const bool IsKeyframe = Buffer.WantsKeyframe(Timestamp);
+        SEncodedFrameInfo Info;
+        if (Encoder.Encode(Ui.Render(Frame), Encoded, &Info, IsKeyframe))
+        {
+            Buffer.Append(Encoded.data(), Encoded.size(), Timestamp, Info.IsKeyframe);
+        }
+        Frame++;
+    };
+    for (int Warmup = 0; Warmup < 60; Warmup++) AppendNext();
+
+    CTestFile File("replay-dump.sxr");
+    int AppendsDuringDumps = 0;
+    for (int Round = 0; Round < 20; Round++)
+    {
+        std::atomic<bool> IsDone(false);
+        bool IsWritten = false;
+        std::thread Dumper([&]
+        {
+            IsWritten = Buffer.Dump(File.GetPath());
+            IsDone = true;
+        });
+        while (!IsDone)
+        {
+            AppendNext();
+            AppendsDuringDumps++;
+        }
+        Dumper.join();
+        SPYX_REQUIRE(IsWritten);
+
+        // A contiguous run from a keyframe, every frame exactly what was rendered for it
+        CRecordingSource Source;
+        SPYX_REQUIRE(Source.Open(File.GetPath()));
+        SPYX_REQUIRE(Source.GetFrameCount() > 0);
+        SPYX_CHECK(Source.GetReader().GetEntry(0).IsKeyframe());
+        SImageView Decoded;
+        int64_t Timestamp = 0;
+        int64_t Previous = -1;
+        while (Source.ReadFrame(Decoded, &Timestamp))
+        {
+            SPYX_CHECK(Previous < 0 || Timestamp == Previous + 1000);
+            SPYX_CHECK(IsSameImage(Reference.Render((int)(Timestamp / 1000)), Decoded));
+            Previous = Timestamp;
+        }
+        SPYX_CHECK(Source.GetPosition() == Source.GetFrameCount());
+    }
+    SPYX_CHECK(AppendsDuringDumps > 0);
+    SPYX_CHECK(Buffer.GetBytesUsed() <= Settings.MaxBytes);
+}
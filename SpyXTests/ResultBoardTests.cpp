@@ -0,0 +1,188 @@
+#include "TestFramework.h"
+#include "Server/ResultBoard.h"
+
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Schema lookup through a reader in shared memory, partial updates keeping the fields they do
+// not write, and snapshots taken while another thread keeps updating that must never mix two
+// updates.
+
+static std::string MakeBoardName(const char *Name)
+{
+    return "spyx-test-" + std::to_string(getpid()) + "-" + Name;
+}
+
+template <typename T>
+static T ReadField(const std::vector<uint8_t> &Record, const SResultField &Field, int Element = 0)
+{
+    T Value;
+    std::memcpy(&Value, &Record[Field.Offset + (size_t)Element * sizeof(T)], sizeof(T));
+    return Value;
+}
+
+SPYX_TEST(ReaderFindsTheSchema)
+{
+    CResultBoard Board;
+    SPYX_CHECK(Board.AddField("Frame", EResultFieldType::Int32) == 0);
+    SPYX_CHECK(Board.AddField("Timestamp", EResultFieldType::Int64) == 1);
+    SPYX_CHECK(Board.AddField("Scores", EResultFieldType::Float32, 3) == 2);
+    SPYX_CHECK(Board.AddField("Position", EResultFieldType::Float64, 2) == 3);
+    SPYX_CHECK(Board.AddField("Frame", EResultFieldType::Int64) == -1);
+    SPYX_CHECK(Board.AddField("", EResultFieldType::Int32) == -1);
+    SPYX_CHECK(Board.AddField(std::string(32, 'x'), EResultFieldType::Int32) == -1);
+    SPYX_CHECK(Board.AddField(std::string(31, 'x'), EResultFieldType::Int32, 0) == -1);
+    SPYX_CHECK(Board.AddField("Unknown", (EResultFieldType)9) == -1);
+
+    const std::string Name = MakeBoardName("schema");
+    SPYX_REQUIRE(Board.Create(Name));
+    SPYX_CHECK(Board.AddField("Late", EResultFieldType::Int32) == -1);
+
+    // Header fields at their documented offsets
+    uint32_t Words[8];
+    std::memcpy(Words, Board.GetData(), sizeof(Words));
+    SPYX_CHECK(Words[0] == 0x42525853 && Words[2] == 64 && Words[3] == 4 && Words[5] == 48);
+    SPYX_CHECK(Words[6] % 64 == 0 && Words[6] + Words[7] == Board.GetSize());
+
+    CResultBoardReader Reader;
+    SPYX_REQUIRE(Reader.Open(Name));
+    const std::vector<SResultField> &Written = Board.GetFields();
+    const std::vector<SResultField> &Read = Reader.GetFields();
+    SPYX_REQUIRE(Read.size() == Written.size());
+    for (size_t Index = 0; Index < Read.size(); Index++)
+    {
+        SPYX_CHECK(Read[Index].Name == Written[Index].Name && Read[Index].Type == Written[Index].Type);
+        SPYX_CHECK(Read[Index].Offset == Written[Index].Offset && Read[Index].Count == Written[Index].Count);
+        SPYX_CHECK(Reader.FindField(Read[Index].Name) == (int)Index);
+        SPYX_CHECK(Board.FindField(Read[Index].Name) == (int)Index);
+
+        // Naturally aligned, so every element is one plain load
+        const uint32_t TypeSize = Read[Index].Type == EResultFieldType::Int64 || Read[Index].Type == EResultFieldType::Float64 ? 8 : 4;
+        SPYX_CHECK(Read[Index].Offset % TypeSize == 0);
+    }
+    SPYX_CHECK(Reader.FindField("frame") == -1 && Board.FindField("Missing") == -1);
+
+    // Private boards are not visible to other readers
+    CResultBoard Private;
+    Private.AddField("Value", EResultFieldType::Int32);
+    SPYX_REQUIRE(Private.Create(""));
+    SPYX_CHECK(Private.IsOpen());
+    SPYX_CHECK(!Reader.Open(""));
+
+    Board.Close();
+    SPYX_CHECK(!Reader.Open(Name));
+}
+
+SPYX_TEST(PartialUpdatesKeepOtherFields)
+{
+    CResultBoard Board;
+    const int Frame = Board.AddField("Frame", EResultFieldType::Int32);
+    const int Timestamp = Board.AddField("Timestamp", EResultFieldType::Int64);
+    const int Scores = Board.AddField("Scores", EResultFieldType::Float32, 3);
+    const int Position = Board.AddField("Position", EResultFieldType::Float64, 2);
+    const std::string Name = MakeBoardName("partial");
+    SPYX_REQUIRE(Board.Create(Name));
+    CResultBoardReader Reader;
+    SPYX_REQUIRE(Reader.Open(Name));
+    const std::vector<SResultField> &Fields = Reader.GetFields();
+
+    std::vector<uint8_t> Record;
+    uint64_t Version = 99;
+    SPYX_REQUIRE(Reader.ReadSnapshot(Record, Version));
+    SPYX_CHECK(Version == 0 && ReadField<int32_t>(Record, Fields[Frame]) == 0);
+
+    Board.BeginUpdate();
+    Board.SetInt32(Frame, 7);
+    Board.SetInt64(Timestamp, 1LL << 40);
+    Board.SetFloat32(Scores, 0.5f, 2);
+    Board.SetFloat64(Position, -3.25, 1);
+    Board.EndUpdate();
+
+    // Only the frame changes; wrong types, elements and writes outside an update are ignored
+    Board.BeginUpdate();
+    Board.SetInt32(Frame, 8);
+    Board.SetInt64(Frame, 9);
+    Board.SetFloat32(Scores, 1.0f, 3);
+    Board.SetFloat32(Scores, 1.0f, -1);
+    Board.SetInt32(Position + 1, 1);
+    Board.EndUpdate();
+    Board.SetInt32(Frame, 10);
+
+    SPYX_REQUIRE(Reader.ReadSnapshot(Record, Version));
+    SPYX_CHECK(Version == 2);
+    SPYX_CHECK(ReadField<int32_t>(Record, Fields[Frame]) == 8);
+    SPYX_CHECK(ReadField<int64_t>(Record, Fields[Timestamp]) == 1LL << 40);
+    SPYX_CHECK(ReadField<float>(Record, Fields[Scores], 0) == 0.0f && ReadField<float>(Record, Fields[Scores], 2) == 0.5f);
+    SPYX_CHECK(ReadField<double>(Record, Fields[Position], 0) == 0.0 && ReadField<double>(Record, Fields[Position], 1) == -3.25);
+}
+
+SPYX_TEST(SnapshotsAreNeverTorn)
+{
+    // Every update writes the frame, its array and their sum; the rare field only every fifth
+    CResultBoard Board;
+    const int Frame = Board.AddField("Frame", EResultFieldType::Int64);
+    const int Values = Board.AddField("Values", EResultFieldType::Int32, 16);
+    const int Sum = Board.AddField("Sum", EResultFieldType::Float64);
+    const int Rare = Board.AddField("Rare", EResultFieldType::Int64);
+    const std::string Name = MakeBoardName("torn");
+    SPYX_REQUIRE(Board.Create(Name));
+
+    std::atomic<bool> IsDone(false);
+    std::thread Writer([&]
+    {
+        for (int64_t Update = 1; Update <= 200000; Update++)
+        {
+            Board.BeginUpdate();
+            Board.SetInt64(Frame, Update);
+            double Total = 0.0;
+            for (int Element = 0; Element < 16; Element++)
+            {
+                const int32_t Value = (int32_t)(Update * 16 + Element);
+                Board.SetInt32(Values, Value, Element);
+                Total += Value;
+            }
+            Board.SetFloat64(Sum, Total);
+            if (Update % 5 == 0) Board.SetInt64(Rare, Update);
+            Board.EndUpdate();
+        }
+        IsDone = true;
+    });
+
+    CResultBoardReader Reader;
+    SPYX_REQUIRE(Reader.Open(Name));
+    const std::vector<SResultField> &Fields = Reader.GetFields();
+    std::vector<uint8_t> Record;
+    uint64_t Version = 0;
+    uint64_t LastVersion = 0;
+    int Snapshots = 0;
+    int Torn = 0;
+    while (!IsDone || Snapshots == 0)
+    {
+        if (!Reader.ReadSnapshot(Record, Version)) continue;
+        Snapshots++;
+
+        const int64_t Update = ReadField<int64_t>(Record, Fields[Frame]);
+        double Total = 0.0;
+        bool IsConsistent = (uint64_t)Update == Version && Version >= LastVersion;
+        for (int Element = 0; Element < 16; Element++)
+        {
+            const int32_t Value = ReadField<int32_t>(Record, Fields[Values], Element);
+            IsConsistent = IsConsistent && (Update == 0 || Value == (int32_t)(Update * 16 + Element));
+            Total += Value;
+        }
+        IsConsistent = IsConsistent && ReadField<double>(Record, Fields[Sum]) == Total;
+        IsConsistent = IsConsistent && ReadField<int64_t>(Record, Fields[Rare]) == Update - Update % 5;
+        Torn += !IsConsistent;
+        LastVersion = Version;
+    }
+    Writer.join();
+
+    SPYX_CHECK(Torn == 0);
+    SPYX_CHECK(Snapshots > 0);
+    SPYX_REQUIRE(Reader.ReadSnapshot(Record, Version));
+    SPYX_CHECK(Version == 200000 && ReadField<int64_t>(Record, Fields[Frame]) == 200000);
+}
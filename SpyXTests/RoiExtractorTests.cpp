@@ -0,0 +1,198 @@
+#include "TestFramework.h"
+#include "Analysis/RoiExtractor.h"
+
+#include <climits>
+#include <vector>
+
+// Random ROIs against a per-pixel reference, and requests whose edges or sizes used to
+// overflow 32-bit arithmetic.
+
+static uint8_t ToGray(uint32_t Blue, uint32_t Green, uint32_t Red)
+{
+    return (uint8_t)((77 * Red + 150 * Green + 29 * Blue + 128) >> 8);
+}
+
+// Channel of frame pixel (X, Y) as the extractor reads it: 0 outside, opaque grey for Gray8
+static uint32_t GetChannel(const SImageView &Frame, int64_t X, int64_t Y, int Channel)
+{
+    if (X < 0 || Y < 0 || X >= Frame.Width || Y >= Frame.Height) return 0;
+    const uint8_t *Row = Frame.Row((int)Y);
+    if (Frame.Format == EPixelFormat::Gray8) return Channel == 3 ? 255 : Row[X];
+    return Row[X * 4 + Channel];
+}
+
+// Expected BGRA of an output pixel: the rounded mean of its source span
+static void GetExpected(const SImageView &Frame, const SRoiRequest &Roi, const SRoiOutput &Output, int OutputX,
+    int OutputY, uint32_t Expected[4])
+{
+    const int64_t Left = (int64_t)OutputX * Roi.Width / Output.Width;
+    const int64_t Right = (int64_t)(OutputX + 1) * Roi.Width / Output.Width;
+    const int64_t Top = (int64_t)OutputY * Roi.Height / Output.Height;
+    const int64_t Bottom = (int64_t)(OutputY + 1) * Roi.Height / Output.Height;
+    const uint64_t Area = (uint64_t)((Right - Left) * (Bottom - Top));
+    for (int Channel = 0; Channel < 4; Channel++)
+    {
+        uint64_t Sum = 0;
+        for (int64_t Y = Top; Y < Bottom; Y++)
+        {
+            for (int64_t X = Left; X < Right; X++) Sum += GetChannel(Frame, Roi.X + X, Roi.Y + Y, Channel);
+        }
+        Expected[Channel] = (uint32_t)((Sum + Area / 2) / Area);
+    }
+    if (Frame.Format == EPixelFormat::Gray8) Expected[1] = Expected[2] = Expected[0];
+}
+
+static int CountMismatches(const SImageView &Frame, const std::vector<SRoiRequest> &Rois,
+    const std::vector<SRoiOutput> &Layout, const std::vector<uint8_t> &Arena)
+{
+    int Mismatches = 0;
+    for (size_t Index = 0; Index < Rois.size(); Index++)
+    {
+        const SRoiOutput &Output = Layout[Index];
+        for (int Y = 0; Y < Output.Height; Y++)
+        {
+            const uint8_t *Row = &Arena[Output.Offset + (size_t)Y * Output.Stride];
+            for (int X = 0; X < Output.Width; X++)
+            {
+                uint32_t Expected[4];
+                GetExpected(Frame, Rois[Index], Output, X, Y, Expected);
+                if (Output.Format == EPixelFormat::Gray8)
+                {
+                    uint8_t Gray = Frame.Format == EPixelFormat::Gray8 ? (uint8_t)Expected[0] :
+                        ToGray(Expected[0], Expected[1], Expected[2]);
+                    Mismatches += Row[X] != Gray;
+                }
+                else
+                {
+                    for (int Channel = 0; Channel < 4; Channel++) Mismatches += Row[4 * X + Channel] != Expected[Channel];
+                }
+            }
+        }
+    }
+    return Mismatches;
+}
+
+static bool Extract(const SImageView &Frame, const std::vector<SRoiRequest> &Rois, std::vector<SRoiOutput> &Layout,
+    std::vector<uint8_t> &Arena)
+{
+    Layout.resize(Rois.size());
+    size_t Size = CRoiExtractor::Layout(Rois.data(), (int)Rois.size(), Layout.data());
+    if (Size == 0) return false;
+    Arena.assign(Size, 0xCD);
+    CRoiExtractor Extractor;
+    return Extractor.Extract(Frame, Rois.data(), (int)Rois.size(), Layout.data(), Arena.data());
+}
+
+SPYX_TEST(RandomRoisMatchReference)
+{
+    CTestRandom Random(5);
+    for (int Trial = 0; Trial < 120; Trial++)
+    {
+        const int Width = Random.Range(50, 300);
+        const int Height = Random.Range(40, 200);
+        const bool IsGray = Trial % 3 == 0;
+        std::vector<uint8_t> Pixels((size_t)Width * Height * (IsGray ? 1 : 4));
+        for (uint8_t &Byte : Pixels) Byte = (uint8_t)Random.Next();
+
+        SImageView Frame;
+        Frame.Data = Pixels.data();
+        Frame.Width = Width;
+        Frame.Height = Height;
+        Frame.Stride = Width * (IsGray ? 1 : 4);
+        Frame.Format = IsGray ? EPixelFormat::Gray8 : EPixelFormat::BGRA8;
+
+        // Some ROIs hang over the frame edges
+        std::vector<SRoiRequest> Rois((size_t)Random.Range(1, 30));
+        for (SRoiRequest &Roi : Rois)
+        {
+            Roi.X = Random.Range(-20, Width + 20);
+            Roi.Y = Random.Range(-20, Height + 20);
+            Roi.Width = Random.Range(1, 60);
+            Roi.Height = Random.Range(1, 60);
+            Roi.Format = Random.Next() % 2 ? EPixelFormat::Gray8 : EPixelFormat::BGRA8;
+            if (Random.Next() % 2)
+            {
+                Roi.OutputWidth = Random.Range(1, Roi.Width);
+                Roi.OutputHeight = Random.Range(1, Roi.Height);
+            }
+        }
+
+        std::vector<SRoiOutput> Layout;
+        std::vector<uint8_t> Arena;
+        SPYX_REQUIRE(Extract(Frame, Rois, Layout, Arena));
+        SPYX_CHECK(CountMismatches(Frame, Rois, Layout, Arena) == 0);
+    }
+}
+
+SPYX_TEST(OversizedRequestsAreRejected)
+{
+    SRoiRequest Roi;
+    SRoiOutput Output;
+
+    // Width * 4 used to wrap to a small stride and a matching undersized arena
+    Roi.Width = (1 << 30) + 1;
+    Roi.Height = 1;
+    SPYX_CHECK(CRoiExtractor::Layout(&Roi, 1, &Output) == 0);
+
+    Roi.Width = CRoiExtractor::MaxRoiSize + 1;
+    SPYX_CHECK(CRoiExtractor::Layout(&Roi, 1, &Output) == 0);
+    Roi.Width = CRoiExtractor::MaxRoiSize;
+    Roi.Height = CRoiExtractor::MaxRoiSize;
+    SPYX_CHECK(CRoiExtractor::Layout(&Roi, 1, &Output) == (size_t)CRoiExtractor::MaxRoiSize * CRoiExtractor::MaxRoiSize * 4);
+
+    // One output pixel averaging the whole ROI would overflow its 32-bit sums
+    Roi.OutputWidth = 1;
+    Roi.OutputHeight = 1;
+    SPYX_CHECK(CRoiExtractor::Layout(&Roi, 1, &Output) == 0);
+}
+
+SPYX_TEST(AreasPastFrameMatchReference)
+{
+    std::vector<uint8_t> Pixels(64 * 32 * 4, 200);
+    SImageView Frame;
+    Frame.Data = Pixels.data();
+    Frame.Width = 64;
+    Frame.Height = 32;
+    Frame.Stride = 64 * 4;
+
+    // One read area entirely past the frame, resampled, and one running far past its corner
+    std::vector<SRoiRequest> Rois(2);
+    Rois[0].Y = INT_MAX - 3;
+    Rois[0].Width = 8;
+    Rois[0].Height = 40;
+    Rois[0].OutputWidth = 4;
+    Rois[0].OutputHeight = 7;
+    Rois[1].X = 60;
+    Rois[1].Y = 30;
+    Rois[1].Width = CRoiExtractor::MaxRoiSize;
+    Rois[1].Height = 3;
+    Rois[1].Format = EPixelFormat::Gray8;
+
+    std::vector<SRoiOutput> Layout;
+    std::vector<uint8_t> Arena;
+    SPYX_REQUIRE(Extract(Frame, Rois, Layout, Arena));
+    SPYX_CHECK(CountMismatches(Frame, Rois, Layout, Arena) == 0);
+}
+
+SPYX_TEST(LargestSpanAveragesExactly)
+{
+    // 4095 x 4095 into one pixel is just inside the span limit, with sums near 2^32
+    const int Size = 4095;
+    std::vector<uint8_t> Pixels((size_t)Size * Size, 255);
+    SImageView Frame;
+    Frame.Data = Pixels.data();
+    Frame.Width = Size;
+    Frame.Height = Size;
+    Frame.Stride = Size;
+    Frame.Format = EPixelFormat::Gray8;
+
+    std::vector<SRoiRequest> Rois(1);
+    Rois[0].Width = Size;
+    Rois[0].Height = Size;
+    Rois[0].OutputWidth = 1;
+    Rois[0].OutputHeight = 1;
+    std::vector<SRoiOutput> Layout;
+    std::vector<uint8_t> Arena;
+    SPYX_REQUIRE(Extract(Frame, Rois, Layout, Arena));
+    SPYX_CHECK(Arena[0] == 255 && Arena[1] == 255 && Arena[2] == 255 && Arena[3] == 255);
+}
@@ -0,0 +1,144 @@
+#include "TestFramework.h"
+#include "RecordingTestSupport.h"
+#include "SyntheticUi.h"
+#include "Imaging/ScreenshotService.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// The queue fills while a completion callback holds the encoder thread, Flush waits for
+// what was queued, and every file written holds exactly what the encoder makes of the frame
+// as it was when submitted.
+
+// Completion callback that records the calls and can hold the encoder thread until released
+class CTestCompletion
+{
+public:
+    void OnComplete(const std::string &Path, bool Success)
+    {
+        std::unique_lock<std::mutex> Lock(MMutex);
+        MCalls.push_back(Path + (Success ? " ok" : " failed"));
+        MCondition.wait(Lock, [this] { return !MIsHeld; });
+    }
+
+    void Hold()
+    {
+        std::lock_guard<std::mutex> Lock(MMutex);
+        MIsHeld = true;
+    }
+
+    void Release()
+    {
+        {
+            std::lock_guard<std::mutex> Lock(MMutex);
+            MIsHeld = false;
+        }
+        MCondition.notify_all();
+    }
+
+    std::vector<std::string> GetCalls()
+    {
+        std::lock_guard<std::mutex> Lock(MMutex);
+        return MCalls;
+    }
+
+private:
+    std::mutex MMutex;
+    std::condition_variable MCondition;
+    std::vector<std::string> MCalls;
+    bool MIsHeld = false;
+};
+
+static std::vector<uint8_t> Encode(const SImageView &Frame, EImageFileFormat Format)
+{
+    std::vector<uint8_t> Encoded;
+    EncodeImage(Frame, Format, Encoded);
+    return Encoded;
+}
+
+SPYX_TEST(QueueFillsAndFlushWaits)
+{
+    CTestCompletion Completion;
+    CScreenshotService Service(2);
+    Service.SetCompletionCallback([&](const std::string &Path, bool Success) { Completion.OnComplete(Path, Success); });
+
+    CSyntheticUi Ui(160, 100);
+    CTestFile First("screenshot-first.png");
+    CTestFile Second("screenshot-second.qoi");
+    CTestFile Third("screenshot-third.png");
+    const std::vector<uint8_t> FirstExpected = Encode(Ui.Render(1), EImageFileFormat::PNG);
+    const std::vector<uint8_t> SecondExpected = Encode(Ui.Render(2), EImageFileFormat::QOI);
+
+    // Nothing completes while the callback holds, so the third frame finds the queue full.
+    // Rendering over the frame after each submit shows the service kept its own copy.
+    Completion.Hold();
+    SPYX_REQUIRE(Service.Submit(Ui.Render(1), First.GetPath(), EImageFileFormat::PNG));
+    SPYX_REQUIRE(Service.Submit(Ui.Render(2), Second.GetPath(), EImageFileFormat::QOI));
+    SPYX_CHECK(!Service.Submit(Ui.Render(3), Third.GetPath(), EImageFileFormat::PNG));
+    Ui.Render(4);
+
+    SScreenshotStats Stats = Service.GetStats();
+    SPYX_CHECK(Stats.Pending == 2 && Stats.Rejected == 1 && Stats.Completed == 0);
+
+    Completion.Release();
+    Service.Flush();
+    Stats = Service.GetStats();
+    SPYX_CHECK(Stats.Pending == 0 && Stats.Completed == 2 && Stats.Failed == 0 && Stats.Rejected == 1);
+
+    const std::vector<std::string> Calls = Completion.GetCalls();
+    SPYX_REQUIRE(Calls.size() == 2);
+    SPYX_CHECK(Calls[0] == std::string(First.GetPath()) + " ok");
+    SPYX_CHECK(Calls[1] == std::string(Second.GetPath()) + " ok");
+    SPYX_CHECK(First.Read() == FirstExpected);
+    SPYX_CHECK(Second.Read() == SecondExpected);
+    SPYX_CHECK(Third.Read().empty());
+
+    // The queue has room again once flushed
+    SPYX_REQUIRE(Service.Submit(Ui.Render(3), Third.GetPath(), EImageFileFormat::PNG));
+    Service.Flush();
+    SPYX_CHECK(Third.Read() == Encode(Ui.Render(3), EImageFileFormat::PNG));
+    SPYX_CHECK(Service.GetStats().Completed == 3);
+}
+
+SPYX_TEST(FailuresAndInvalidFramesAreReported)
+{
+    CTestCompletion Completion;
+    CScreenshotService Service(4);
+    Service.SetCompletionCallback([&](const std::string &Path, bool Success) { Completion.OnComplete(Path, Success); });
+
+    CSyntheticUi Ui(64, 48);
+    const std::string Missing = MakeTestPath("missing-directory/screenshot.png");
+    SPYX_REQUIRE(Service.Submit(Ui.Render(0), Missing, EImageFileFormat::PNG));
+
+    SImageView Invalid = Ui.Render(0);
+    Invalid.Format = EPixelFormat::RGBA16F;
+    SPYX_CHECK(!Service.Submit(Invalid, Missing, EImageFileFormat::PNG));
+    Service.Flush();
+
+    const SScreenshotStats Stats = Service.GetStats();
+    SPYX_CHECK(Stats.Failed == 1 && Stats.Completed == 0 && Stats.Rejected == 0 && Stats.Pending == 0);
+    const std::vector<std::string> Calls = Completion.GetCalls();
+    SPYX_REQUIRE(Calls.size() == 1);
+    SPYX_CHECK(Calls[0] == Missing + " failed");
+}
+
+SPYX_TEST(QueuedScreenshotsAreWrittenOnDestruction)
+{
+    CTestFile Gray("screenshot-gray.qoi");
+    std::vector<uint8_t> Pixels(37 * 29);
+    for (size_t Index = 0; Index < Pixels.size(); Index++) Pixels[Index] = (uint8_t)(Index * 7);
+    SImageView Frame;
+    Frame.Data = Pixels.data();
+    Frame.Width = 37;
+    Frame.Height = 29;
+    Frame.Stride = 37;
+    Frame.Format = EPixelFormat::Gray8;
+
+    {
+        CScreenshotService Service(1);
+        SPYX_REQUIRE(Service.Submit(Frame, Gray.GetPath(), EImageFileFormat::QOI));
+    }
+    SPYX_CHECK(Gray.Read() == Encode(Frame, EImageFileFormat::QOI));
+}
@@ -0,0 +1,104 @@
+#ifndef TAPI_SYNTHETIC_UI_H
+#define TAPI_SYNTHETIC_UI_H
+
+#include "Imaging/ImageView.h"
+
+#include <cstdint>
+#include <vector>
+
+// Deterministic UI-like BGRA8 content for codec, encoder and matcher tests: flat panels,
+// a gradient title bar, rows of text-like strokes and a small photo-like noisy area.
+// Between frames a cursor moves, a status field changes and every tenth frame redraws
+// one panel's text, which is roughly how a desktop application changes.
+class CSyntheticUi
+{
+public:
+    CSyntheticUi(int Width, int Height) : MWidth(Width), MHeight(Height), MPixels((size_t)Width * Height * 4) {}
+
+    SImageView Render(int Frame)
+    {
+        for (int Y = 0; Y < MHeight; Y++)
+        {
+            uint8_t *Row = &MPixels[(size_t)Y * MWidth * 4];
+            for (int X = 0; X < MWidth; X++) SetPixel(Row + X * 4, GetBackground(X, Y, Frame));
+        }
+
+        // Cursor
+        const int CursorX = (Frame * 37) % (MWidth > 20 ? MWidth - 12 : 1);
+        const int CursorY = (Frame * 17) % (MHeight > 20 ? MHeight - 16 : 1);
+        for (int Y = CursorY; Y < CursorY + 16 && Y < MHeight; Y++)
+        {
+            for (int X = CursorX; X < CursorX + 12 - (Y - CursorY) / 2 && X < MWidth; X++)
+            {
+                SetPixel(&MPixels[((size_t)Y * MWidth + X) * 4], 0xFFFFFFFFu);
+            }
+        }
+
+        SImageView View;
+        View.Data = MPixels.data();
+        View.Width = MWidth;
+        View.Height = MHeight;
+        View.Stride = MWidth * 4;
+        View.Format = EPixelFormat::BGRA8;
+        return View;
+    }
+
+private:
+    static void SetPixel(uint8_t *Pixel, uint32_t Value)
+    {
+        Pixel[0] = (uint8_t)Value;
+        Pixel[1] = (uint8_t)(Value >> 8);
+        Pixel[2] = (uint8_t)(Value >> 16);
+        Pixel[3] = (uint8_t)(Value >> 24);
+    }
+
+    static uint32_t Gray(int Level) { return 0xFF000000u | (uint32_t)Level * 0x010101u; }
+
+    static uint32_t Hash(uint32_t Value)
+    {
+        Value ^= Value >> 16;
+        Value *= 0x7FEB352Du;
+        Value ^= Value >> 15;
+        Value *= 0x846CA68Bu;
+        return Value ^ (Value >> 16);
+    }
+
+    uint32_t GetBackground(int X, int Y, int Frame) const
+    {
+        if (Y < 32) return Gray(48 + X * 64 / MWidth);  // Title bar
+        if (X < MWidth / 5) return Gray(((Y - 32) / 24) % 2 ? 58 : 62);  // Side list
+
+        // Panels in a grid, each with text rows
+        const int PanelX = (X - MWidth / 5) / 320;
+        const int PanelY = (Y - 32) / 240;
+        const int LocalX = (X - MWidth / 5) % 320;
+        const int LocalY = (Y - 32) % 240;
+        const bool IsNoisy = PanelX == 1 && PanelY == 1;
+        if (IsNoisy && LocalX > 16 && LocalX < 304 && LocalY > 16 && LocalY < 224)
+        {
+            return 0xFF000000u | ((Hash((uint32_t)(X * 7919 + Y * 104729)) & 0x3F3F3Fu) + 0x406080u);
+        }
+
+        const uint32_t Panel = (uint32_t)(PanelY * 16 + PanelX);
+        const uint32_t Redraw = (uint32_t)(Frame / 10) * ((Panel + (uint32_t)Frame / 10) % 4 == 0);
+        const uint32_t Status = Panel == 0 && LocalY >= 200 ? (uint32_t)Frame : 0;
+        const int Line = LocalY / 14;
+        const int Column = LocalX / 7;
+        if (LocalX > 8 && LocalX < 312 && LocalY % 14 < 10 && LocalY > 8 && LocalY < 232)
+        {
+            // A "glyph" is a 7x10 cell with a few strokes, chosen by line, column and version
+            uint32_t Glyph = Hash(Panel * 131071u + (uint32_t)Line * 8191u + (uint32_t)Column * 127u + Redraw * 31u + Status);
+            if (Glyph % 7 == 0) return Gray(230);  // Space
+            int CellX = LocalX % 7;
+            int CellY = LocalY % 14;
+            if ((Glyph >> (CellX * 3 + CellY % 5)) & 1) return Gray(32);
+        }
+        return Gray(230);
+    }
+
+    int MWidth;
+    int MHeight;
+    std::vector<uint8_t> MPixels;
+};
+
+#endif
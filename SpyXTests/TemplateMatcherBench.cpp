@@ -0,0 +1,91 @@
+#include "TestFramework.h"
+#include "SyntheticUi.h"
+#include "Analysis/TemplateMatcher.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// Searches a 1920x1080 synthetic UI frame for three planted icons (16, 32 and 48 pixels,
+// alpha-masked) with every method, at full resolution and through a two-level pyramid.
+// Usage: TemplateMatcherBench [repeats]
+
+int main(int ArgumentCount, char **Arguments)
+{
+    const int Repeats = GetRepeatCount(ArgumentCount, Arguments, 5);
+    const int Width = 1920;
+    const int Height = 1080;
+    CSyntheticUi Ui(Width, Height);
+    SImageView Rendered = Ui.Render(0);
+    std::vector<uint8_t> Pixels(Rendered.Data, Rendered.Data + (size_t)Rendered.Stride * Height);
+
+    const int Sizes[3] = {16, 32, 48};
+    const int PositionsX[3] = {1500, 300, 900};
+    const int PositionsY[3] = {700, 200, 902};
+    std::vector<std::vector<uint8_t>> Icons(3);
+    CTestRandom Random(1);
+    for (int Index = 0; Index < 3; Index++)
+    {
+        const int Size = Sizes[Index];
+        Icons[Index].resize((size_t)Size * Size * 4);
+        for (int Y = 0; Y < Size; Y++)
+        {
+            for (int X = 0; X < Size; X++)
+            {
+                uint32_t Color = 0xFF000000u | (Random.Next() & 0xFFFFFF);
+                std::memcpy(&Icons[Index][((size_t)Y * Size + X) * 4], &Color, 4);
+                std::memcpy(&Pixels[((size_t)(PositionsY[Index] + Y) * Width + PositionsX[Index] + X) * 4], &Color, 4);
+            }
+        }
+    }
+
+    SImageView Frame = Rendered;
+    Frame.Data = Pixels.data();
+    const int MaxThreads = (int)std::max(1u, std::thread::hardware_concurrency());
+    const char *MethodNames[3] = {"SAD", "SSD", "NCC"};
+
+    std::vector<int> ThreadCounts = {1};
+    if (MaxThreads > 1) ThreadCounts.push_back(MaxThreads);
+    for (int ThreadCount : ThreadCounts)
+    {
+        CTemplateMatcher Matcher(ThreadCount);
+        std::vector<int> Ids;
+        for (int Index = 0; Index < 3; Index++)
+        {
+            SImageView Icon;
+            Icon.Data = Icons[Index].data();
+            Icon.Width = Sizes[Index];
+            Icon.Height = Sizes[Index];
+            Icon.Stride = Sizes[Index] * 4;
+            Ids.push_back(Matcher.AddTemplate(Icon, true));
+        }
+
+        for (int Levels : {0, 2})
+        {
+            for (int Method = 0; Method < 3; Method++)
+            {
+                SMatchOptions Options;
+                Options.Method = (EMatchMethod)Method;
+                Options.MaxResults = 3;
+                Options.MaxDifference = Method == 0 ? 10.0f : 200.0f;
+                Options.MinCorrelation = 0.9f;
+                Options.PyramidLevels = Levels;
+
+                std::vector<SMatch> Results;
+                double Milliseconds = MeasureBestMilliseconds(Repeats,
+                    [&] { Matcher.Match(Frame, Ids.data(), (int)Ids.size(), Options, Results); });
+
+                int Found = 0;
+                for (const SMatch &Match : Results)
+                {
+                    Found += Match.X == PositionsX[Match.Template] && Match.Y == PositionsY[Match.Template];
+                }
+                std::printf("%s pyramid %d, %2d thread(s): %8.2f ms, %d/3 icons found\n", MethodNames[Method], Levels,
+                    ThreadCount, Milliseconds, Found);
+            }
+        }
+    }
+    return 0;
+}
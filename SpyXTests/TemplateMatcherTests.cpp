@@ -0,0 +1,377 @@
+#include "TestFramework.h"
+#include "SyntheticUi.h"
+#include "Analysis/TemplateMatcher.h"
+#include "Imaging/ToneMapper.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// Full-resolution searches are exhaustive, so their results must equal a brute-force
+// scoring of every position. Coarse-to-fine searches may miss matches, but every result
+// they return must carry the exact score of its position.
+
+struct STestTemplate
+{
+    int Id = -1;
+    int Width = 0;
+    int Height = 0;
+    std::vector<uint8_t> Luma;
+    std::vector<uint8_t> Mask;
+};
+
+struct SScoredPosition
+{
+    int X;
+    int Y;
+    double Score;
+};
+
+static std::vector<uint8_t> ToLuma(const SImageView &Image)
+{
+    std::vector<uint8_t> Luma((size_t)Image.Width * Image.Height);
+    if (Image.Format == EPixelFormat::Gray8)
+    {
+        for (int Y = 0; Y < Image.Height; Y++) std::memcpy(&Luma[(size_t)Y * Image.Width], Image.Row(Y), Image.Width);
+    }
+    else
+    {
+        ConvertBGRA8ToGray8(Image, Luma.data(), Image.Width);
+    }
+    return Luma;
+}
+
+// Every position of the template in the search area that passes the threshold
+static std::vector<SScoredPosition> ScoreAllPositions(const std::vector<uint8_t> &Frame, int FrameWidth,
+    const STestTemplate &Template, int Left, int Top, int Right, int Bottom, const SMatchOptions &Options)
+{
+    double Count = 0, TemplateSum = 0, TemplateSquares = 0;
+    for (size_t Index = 0; Index < Template.Luma.size(); Index++)
+    {
+        if (!Template.Mask[Index]) continue;
+        Count++;
+        TemplateSum += Template.Luma[Index];
+        TemplateSquares += (double)Template.Luma[Index] * Template.Luma[Index];
+    }
+    const double TemplateEnergy = TemplateSquares - TemplateSum * TemplateSum / Count;
+
+    std::vector<SScoredPosition> Positions;
+    for (int Y = Top; Y + Template.Height <= Bottom; Y++)
+    {
+        for (int X = Left; X + Template.Width <= Right; X++)
+        {
+            double Difference = 0, Sum = 0, Squares = 0, Cross = 0;
+            for (int Row = 0; Row < Template.Height; Row++)
+            {
+                for (int Column = 0; Column < Template.Width; Column++)
+                {
+                    const size_t Index = (size_t)Row * Template.Width + Column;
+                    if (!Template.Mask[Index]) continue;
+                    const double Pixel = Frame[(size_t)(Y + Row) * FrameWidth + X + Column];
+                    const double Value = Template.Luma[Index];
+                    Difference += Options.Method == EMatchMethod::Sad ? std::fabs(Pixel - Value) :
+                        (Pixel - Value) * (Pixel - Value);
+                    Sum += Pixel;
+                    Squares += Pixel * Pixel;
+                    Cross += Pixel * Value;
+                }
+            }
+
+            double Score;
+            if (Options.Method == EMatchMethod::Ncc)
+            {
+                const double Energy = Squares - Sum * Sum / Count;
+                if (Energy <= 0 || TemplateEnergy <= 0) continue;
+                Score = (Cross - TemplateSum * Sum / Count) / std::sqrt(TemplateEnergy * Energy);
+                if (Score < Options.MinCorrelation) continue;
+            }
+            else
+            {
+                Score = Difference / Count;
+                if (Score > Options.MaxDifference) continue;
+            }
+            Positions.push_back({X, Y, Score});
+        }
+    }
+
+    const bool HigherIsBetter = Options.Method == EMatchMethod::Ncc;
+    std::stable_sort(Positions.begin(), Positions.end(), [HigherIsBetter](const SScoredPosition &A,
+        const SScoredPosition &B) { return HigherIsBetter ? A.Score > B.Score : A.Score < B.Score; });
+    return Positions;
+}
+
+// Random frame with templates cut from it and lightly perturbed, some with alpha masks
+struct SMatchScene
+{
+    std::vector<uint8_t> Pixels;
+    SImageView Frame;
+    std::vector<uint8_t> Luma;
+    std::vector<STestTemplate> Templates;
+    std::vector<int> Ids;
+};
+
+static void BuildScene(CTestRandom &Random, CTemplateMatcher &Matcher, SMatchScene &Scene)
+{
+    const int Width = Random.Range(40, 160);
+    const int Height = Random.Range(30, 120);
+    const bool IsBgra = Random.Next() % 2;
+    const int BytesPerPixel = IsBgra ? 4 : 1;
+    const bool IsSmooth = Random.Next() % 3 != 0;
+
+    Scene.Pixels.resize((size_t)Width * Height * BytesPerPixel);
+    for (size_t Index = 0; Index < Scene.Pixels.size(); Index++)
+    {
+        Scene.Pixels[Index] = IsSmooth ? (uint8_t)((Index * 7 / (BytesPerPixel * 3)) % 256 ^ (Random.Next() % 8)) :
+            (uint8_t)Random.Next();
+    }
+    Scene.Frame.Data = Scene.Pixels.data();
+    Scene.Frame.Width = Width;
+    Scene.Frame.Height = Height;
+    Scene.Frame.Stride = Width * BytesPerPixel;
+    Scene.Frame.Format = IsBgra ? EPixelFormat::BGRA8 : EPixelFormat::Gray8;
+    Scene.Luma = ToLuma(Scene.Frame);
+
+    const int TemplateCount = Random.Range(1, 3);
+    for (int Index = 0; Index < TemplateCount; Index++)
+    {
+        STestTemplate Template;
+        Template.Width = Random.Range(1, std::min(40, Width));
+        Template.Height = Random.Range(1, std::min(30, Height));
+        const int SourceX = Random.Range(0, Width - Template.Width);
+        const int SourceY = Random.Range(0, Height - Template.Height);
+        const bool UseAlpha = IsBgra && Random.Next() % 2;
+
+        std::vector<uint8_t> Image((size_t)Template.Width * Template.Height * BytesPerPixel);
+        for (int Y = 0; Y < Template.Height; Y++)
+        {
+            for (int X = 0; X < Template.Width * BytesPerPixel; X++)
+            {
+                uint8_t Noise = Random.Next() % 4 == 0 ? (uint8_t)(Random.Next() % 16) : 0;
+                Image[(size_t)Y * Template.Width * BytesPerPixel + X] =
+                    Scene.Pixels[(size_t)(SourceY + Y) * Width * BytesPerPixel + SourceX * BytesPerPixel + X] ^ Noise;
+            }
+        }
+        if (UseAlpha)
+        {
+            for (int Pixel = 0; Pixel < Template.Width * Template.Height; Pixel++)
+            {
+                Image[Pixel * 4 + 3] = Random.Next() % 4 ? 255 : 0;
+            }
+        }
+
+        SImageView View;
+        View.Data = Image.data();
+        View.Width = Template.Width;
+        View.Height = Template.Height;
+        View.Stride = Template.Width * BytesPerPixel;
+        View.Format = Scene.Frame.Format;
+        Template.Id = Matcher.AddTemplate(View, UseAlpha);
+        if (Template.Id < 0) continue;
+
+        Template.Luma = ToLuma(View);
+        Template.Mask.assign((size_t)Template.Width * Template.Height, 1);
+        if (UseAlpha)
+        {
+            for (size_t Pixel = 0; Pixel < Template.Mask.size(); Pixel++) Template.Mask[Pixel] = Image[Pixel * 4 + 3] >= 128;
+        }
+        Scene.Ids.push_back(Template.Id);
+        Scene.Templates.push_back(Template);
+    }
+}
+
+static SMatchOptions MakeRandomOptions(CTestRandom &Random, int Method, const SImageView &Frame)
+{
+    SMatchOptions Options;
+    Options.Method = (EMatchMethod)Method;
+    Options.MaxResults = Random.Range(1, 5);
+    Options.SuppressRadius = 0;
+    Options.MinCorrelation = Random.Next() % 2 ? -1.0f : 0.5f;
+    Options.MaxDifference = Random.Next() % 2 ? 65025.0f : (Method == 0 ? 20.0f : 400.0f);
+    if (Random.Next() % 2)
+    {
+        Options.RoiX = Random.Range(-5, 14);
+        Options.RoiY = Random.Range(-5, 14);
+        Options.RoiWidth = Frame.Width / 2 + Random.Range(0, Frame.Width - 1);
+        Options.RoiHeight = Frame.Height / 2 + Random.Range(0, Frame.Height - 1);
+    }
+    return Options;
+}
+
+static void GetSearchArea(const SMatchOptions &Options, const SImageView &Frame, int &Left, int &Top, int &Right,
+    int &Bottom)
+{
+    Left = std::max(Options.RoiX, 0);
+    Top = std::max(Options.RoiY, 0);
+    Right = Options.RoiWidth > 0 ? std::min(Options.RoiX + Options.RoiWidth, Frame.Width) : Frame.Width;
+    Bottom = Options.RoiHeight > 0 ? std::min(Options.RoiY + Options.RoiHeight, Frame.Height) : Frame.Height;
+}
+
+SPYX_TEST(FullSearchMatchesBruteForce)
+{
+    CTestRandom Random(5);
+    for (int Trial = 0; Trial < 60; Trial++)
+    {
+        CTemplateMatcher Matcher(1 + Trial % 3);
+        SMatchScene Scene;
+        BuildScene(Random, Matcher, Scene);
+        if (Scene.Ids.empty()) continue;
+
+        for (int Method = 0; Method < 3; Method++)
+        {
+            SMatchOptions Options = MakeRandomOptions(Random, Method, Scene.Frame);
+            std::vector<SMatch> Results;
+            SPYX_REQUIRE(Matcher.Match(Scene.Frame, Scene.Ids.data(), (int)Scene.Ids.size(), Options, Results));
+
+            int Left, Top, Right, Bottom;
+            GetSearchArea(Options, Scene.Frame, Left, Top, Right, Bottom);
+            size_t Next = 0;
+            for (const STestTemplate &Template : Scene.Templates)
+            {
+                std::vector<SScoredPosition> Expected = ScoreAllPositions(Scene.Luma, Scene.Frame.Width, Template, Left,
+                    Top, Right, Bottom, Options);
+                const size_t Count = std::min((size_t)Options.MaxResults, Expected.size());
+
+                // Equal scores may come in either order, so compare scores rank by rank
+                for (size_t Rank = 0; Rank < Count; Rank++, Next++)
+                {
+                    SPYX_REQUIRE(Next < Results.size() && Results[Next].Template == Template.Id);
+                    SPYX_CHECK(std::fabs(Results[Next].Score - Expected[Rank].Score) <= 1e-3);
+                }
+            }
+            SPYX_CHECK(Next == Results.size());
+        }
+    }
+}
+
+SPYX_TEST(PyramidResultsCarryExactScores)
+{
+    CTestRandom Random(7);
+    int Found = 0;
+    int Total = 0;
+    for (int Trial = 0; Trial < 60; Trial++)
+    {
+        CTemplateMatcher Matcher(1 + Trial % 3);
+        SMatchScene Scene;
+        BuildScene(Random, Matcher, Scene);
+        if (Scene.Ids.empty()) continue;
+
+        for (int Method = 0; Method < 3; Method++)
+        {
+            SMatchOptions Options = MakeRandomOptions(Random, Method, Scene.Frame);
+            Options.PyramidLevels = Random.Range(1, 3);
+            Options.PyramidFilter = (EPyramidFilter)(Random.Next() % 2);
+            std::vector<SMatch> Results;
+            SPYX_REQUIRE(Matcher.Match(Scene.Frame, Scene.Ids.data(), (int)Scene.Ids.size(), Options, Results));
+
+            int Left, Top, Right, Bottom;
+            GetSearchArea(Options, Scene.Frame, Left, Top, Right, Bottom);
+            size_t Next = 0;
+            for (const STestTemplate &Template : Scene.Templates)
+            {
+                std::vector<SScoredPosition> Expected = ScoreAllPositions(Scene.Luma, Scene.Frame.Width, Template, Left,
+                    Top, Right, Bottom, Options);
+                const size_t First = Next;
+                for (; Next < Results.size() && Results[Next].Template == Template.Id; Next++)
+                {
+                    const SMatch &Match = Results[Next];
+                    auto Position = std::find_if(Expected.begin(), Expected.end(),
+                        [&Match](const SScoredPosition &Candidate) { return Candidate.X == Match.X && Candidate.Y == Match.Y; });
+                    SPYX_CHECK(Position != Expected.end() && std::fabs(Position->Score - Match.Score) <= 1e-3);
+                }
+                Found += Expected.empty() || Next > First;
+                Total++;
+            }
+            SPYX_CHECK(Next == Results.size());
+        }
+    }
+
+    // Coarse levels lose small and noisy templates, but most searches still find a match
+    SPYX_CHECK(Found * 10 >= Total * 7);
+}
+
+SPYX_TEST(ResultsDoNotDependOnThreadCount)
+{
+    CSyntheticUi Ui(640, 360);
+    SImageView Frame = Ui.Render(3);
+    std::vector<uint8_t> Icon(24 * 20 * 4);
+    for (int Y = 0; Y < 20; Y++) std::memcpy(&Icon[(size_t)Y * 24 * 4], Frame.Row(200 + Y) + 300 * 4, 24 * 4);
+    SImageView IconView;
+    IconView.Data = Icon.data();
+    IconView.Width = 24;
+    IconView.Height = 20;
+    IconView.Stride = 24 * 4;
+
+    std::vector<SMatch> Reference;
+    for (int ThreadCount : {1, 2, 5})
+    {
+        CTemplateMatcher Matcher(ThreadCount);
+        int Id = Matcher.AddTemplate(IconView, false);
+        SPYX_REQUIRE(Id >= 0);
+        SMatchOptions Options;
+        Options.MaxResults = 8;
+        Options.MinCorrelation = 0.3f;
+        std::vector<SMatch> Results;
+        SPYX_REQUIRE(Matcher.Match(Frame, &Id, 1, Options, Results));
+        SPYX_REQUIRE(!Results.empty());
+        SPYX_CHECK(Results[0].X == 300 && Results[0].Y == 200 && Results[0].Score > 0.999f);
+
+        if (Reference.empty()) Reference = Results;
+        SPYX_REQUIRE(Results.size() == Reference.size());
+        for (size_t Index = 0; Index < Results.size(); Index++)
+        {
+            SPYX_CHECK(Results[Index].X == Reference[Index].X && Results[Index].Y == Reference[Index].Y &&
+                Results[Index].Score == Reference[Index].Score);
+        }
+    }
+}
+
+SPYX_TEST(SearchAreaPastIntMaxClips)
+{
+    CSyntheticUi Ui(320, 200);
+    SImageView Frame = Ui.Render(1);
+    std::vector<uint8_t> Icon(16 * 16 * 4);
+    for (int Y = 0; Y < 16; Y++) std::memcpy(&Icon[(size_t)Y * 16 * 4], Frame.Row(150 + Y) + 250 * 4, 16 * 4);
+    SImageView IconView;
+    IconView.Data = Icon.data();
+    IconView.Width = 16;
+    IconView.Height = 16;
+    IconView.Stride = 16 * 4;
+
+    CTemplateMatcher Matcher(1);
+    int Id = Matcher.AddTemplate(IconView, false);
+    SPYX_REQUIRE(Id >= 0);
+
+    SMatchOptions Options;
+    Options.RoiX = 10;
+    Options.RoiY = 10;
+    Options.RoiWidth = INT_MAX;
+    Options.RoiHeight = INT_MAX;
+    std::vector<SMatch> Results;
+    SPYX_REQUIRE(Matcher.Match(Frame, &Id, 1, Options, Results));
+    SPYX_REQUIRE(Results.size() == 1);
+    SPYX_CHECK(Results[0].X == 250 && Results[0].Y == 150);
+}
+
+SPYX_TEST(InvalidTemplatesAreRejected)
+{
+    CTemplateMatcher Matcher(1);
+    std::vector<uint8_t> Pixels((size_t)(MaxTemplateSize + 1) * 4, 0);
+    SImageView View;
+    View.Data = Pixels.data();
+    View.Width = MaxTemplateSize + 1;
+    View.Height = 1;
+    View.Stride = View.Width * 4;
+    SPYX_CHECK(Matcher.AddTemplate(View, false) < 0);
+
+    // Fully transparent with the alpha mask on
+    View.Width = 4;
+    View.Stride = 16;
+    SPYX_CHECK(Matcher.AddTemplate(View, true) < 0);
+
+    SImageView Frame = View;
+    int Unknown = 42;
+    std::vector<SMatch> Results;
+    SPYX_CHECK(!Matcher.Match(Frame, &Unknown, 1, SMatchOptions(), Results));
+}
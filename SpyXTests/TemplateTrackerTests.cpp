@@ -0,0 +1,167 @@
+#include "TestFramework.h"
+#include "Analysis/TemplateTracker.h"
+
+#include <algorithm>
+#include <vector>
+
+// A 32 px icon on a noisy frame jitters a few pixels per frame, shifts further now and then,
+// jumps across the frame every 50 frames and is hidden every 70. Each step of the window,
+// grown window and full search sequence is counted exactly, and every match is where the
+// icon was drawn.
+
+static const int FrameWidth = 480;
+static const int FrameHeight = 270;
+static const int IconSize = 32;
+
+struct STestImage
+{
+    std::vector<uint8_t> Pixels;
+    SImageView View;
+
+    STestImage(int Width, int Height)
+    {
+        Pixels.resize((size_t)Width * Height * 4);
+        View.Data = Pixels.data();
+        View.Width = Width;
+        View.Height = Height;
+        View.Stride = Width * 4;
+        View.Format = EPixelFormat::BGRA8;
+    }
+};
+
+// Gray noise in [Low, Low + Range)
+static void FillNoise(STestImage &Image, CTestRandom &Random, int Low, int Range)
+{
+    for (size_t Index = 0; Index < Image.Pixels.size(); Index += 4)
+    {
+        const uint8_t Value = (uint8_t)(Low + Random.Range(0, Range - 1));
+        Image.Pixels[Index] = Image.Pixels[Index + 1] = Image.Pixels[Index + 2] = Value;
+        Image.Pixels[Index + 3] = 255;
+    }
+}
+
+static void DrawImage(STestImage &Frame, const STestImage &Image, int X, int Y)
+{
+    for (int Row = 0; Row < Image.View.Height; Row++)
+    {
+        const uint8_t *Source = Image.View.Row(Row);
+        uint8_t *Destination = &Frame.Pixels[(size_t)(Y + Row) * Frame.View.Stride + (size_t)X * 4];
+        std::copy(Source, Source + Image.View.Width * 4, Destination);
+    }
+}
+
+static STrackOptions MakeTrackOptions()
+{
+    STrackOptions Options;
+    Options.Match.MinCorrelation = 0.9f;
+    Options.SearchRadius = 8;
+    Options.MaxRadius = 64;
+    return Options;
+}
+
+SPYX_TEST(WindowsGrowThenFallBackToFullSearch)
+{
+    CTestRandom Random(43);
+    STestImage Background(FrameWidth, FrameHeight);
+    FillNoise(Background, Random, 60, 40);
+    STestImage Icon(IconSize, IconSize);
+    FillNoise(Icon, Random, 0, 256);
+
+    CTemplateMatcher Matcher(2);
+    const int TemplateId = Matcher.AddTemplate(Icon.View, false);
+    SPYX_REQUIRE(TemplateId >= 0);
+    CTemplateTracker Tracker(Matcher);
+    const int Handle = Tracker.CreateHandle(TemplateId, MakeTrackOptions());
+    SPYX_REQUIRE(Handle >= 0);
+
+    // Jump targets further apart than the largest window in both directions
+    const int Bases[4][2] = {{40, 40}, {400, 200}, {60, 210}, {420, 30}};
+    int BaseX = Bases[0][0];
+    int BaseY = Bases[0][1];
+    STestImage Frame(FrameWidth, FrameHeight);
+    for (int Index = 0; Index < 200; Index++)
+    {
+        if (Index % 50 == 0)
+        {
+            BaseX = Bases[Index / 50][0];
+            BaseY = Bases[Index / 50][1];
+        }
+        else if (Index % 50 == 25)
+        {
+            // 18 to 30 px from the last match: past the first two windows, inside the third
+            BaseX += BaseX < FrameWidth / 2 ? 24 : -24;
+        }
+        const int X = BaseX + Random.Range(-3, 3);
+        const int Y = BaseY + Random.Range(-3, 3);
+        const bool IsHidden = Index % 70 == 69;
+
+        Frame.Pixels = Background.Pixels;
+        if (!IsHidden) DrawImage(Frame, Icon, X, Y);
+
+        SMatch Match;
+        bool Found = false;
+        SPYX_REQUIRE(Tracker.Track(Handle, Frame.View, Match, Found));
+        SPYX_CHECK(Found == !IsHidden);
+        if (Found) SPYX_CHECK(Match.X == X && Match.Y == Y && Match.Template == TemplateId);
+    }
+
+    // Full searches: the first frame, three jumps, two hidden frames and the frame after each
+    STrackStats Stats;
+    SPYX_REQUIRE(Tracker.GetStats(Handle, Stats));
+    SPYX_CHECK(Stats.Searches == 200);
+    SPYX_CHECK(Stats.FullSearches == 8);
+    SPYX_CHECK(Stats.FullHits == 6);
+    SPYX_CHECK(Stats.Misses == 2);
+    SPYX_CHECK(Stats.GrownHits == 4);
+    SPYX_CHECK(Stats.WindowHits == 188);
+
+    // A reset handle starts over with a full search
+    SPYX_REQUIRE(Tracker.ResetHandle(Handle));
+    SMatch Match;
+    bool Found = false;
+    SPYX_REQUIRE(Tracker.Track(Handle, Frame.View, Match, Found));
+    SPYX_REQUIRE(Tracker.GetStats(Handle, Stats));
+    SPYX_CHECK(Found && Stats.Searches == 1 && Stats.FullHits == 1 && Stats.WindowHits == 0);
+}
+
+SPYX_TEST(InvalidHandlesAndOptionsAreRejected)
+{
+    CTestRandom Random(430);
+    STestImage Icon(IconSize, IconSize);
+    FillNoise(Icon, Random, 0, 256);
+    STestImage Frame(FrameWidth, FrameHeight);
+    FillNoise(Frame, Random, 60, 40);
+
+    CTemplateMatcher Matcher(1);
+    const int TemplateId = Matcher.AddTemplate(Icon.View, false);
+    CTemplateTracker Tracker(Matcher);
+    STrackOptions Options = MakeTrackOptions();
+    SPYX_CHECK(Tracker.CreateHandle(TemplateId + 1, Options) == -1);
+    Options.MaxRadius = Options.SearchRadius - 1;
+    SPYX_CHECK(Tracker.CreateHandle(TemplateId, Options) == -1);
+    Options = MakeTrackOptions();
+    Options.Match.MaxScale = 1.5f;
+    Options.Match.ScaleStep = 1.0f;
+    SPYX_CHECK(Tracker.CreateHandle(TemplateId, Options) == -1);
+
+    // Destroyed handles are reused
+    const int First = Tracker.CreateHandle(TemplateId, MakeTrackOptions());
+    const int Second = Tracker.CreateHandle(TemplateId, MakeTrackOptions());
+    SPYX_REQUIRE(First >= 0 && Second > First);
+    SPYX_CHECK(Tracker.DestroyHandle(First));
+    SPYX_CHECK(!Tracker.DestroyHandle(First));
+    SMatch Match;
+    bool Found = true;
+    STrackStats Stats;
+    SPYX_CHECK(!Tracker.Track(First, Frame.View, Match, Found) && !Found);
+    SPYX_CHECK(!Tracker.GetStats(First, Stats) && !Tracker.ResetHandle(First));
+    SPYX_CHECK(Tracker.CreateHandle(TemplateId, MakeTrackOptions()) == First);
+
+    // A handle fails once its template is gone
+    SPYX_REQUIRE(Tracker.Track(Second, Frame.View, Match, Found));
+    SPYX_CHECK(!Found);
+    SPYX_REQUIRE(Matcher.RemoveTemplate(TemplateId));
+    SPYX_CHECK(!Tracker.Track(Second, Frame.View, Match, Found));
+    Tracker.Clear();
+    SPYX_CHECK(!Tracker.GetStats(Second, Stats));
+}
@@ -0,0 +1,71 @@
+#ifndef TAPI_TEST_FRAMEWORK_H
+#define TAPI_TEST_FRAMEWORK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// Minimal test registry for the Linux test executables. A test file defines its cases with
+// SPYX_TEST and links TestMain.cpp, which runs every case and exits non-zero on a failure.
+
+using TestFunction = void (*)();
+
+int RegisterTest(const char *Name, TestFunction Function);
+void ReportFailure(const char *File, int Line, const char *Expression);
+
+#define SPYX_TEST(Name) \
+    static void Name(); \
+    [[maybe_unused]] static const int Name##Registration = RegisterTest(#Name, Name); \
+    static void Name()
+
+#define SPYX_CHECK(Condition) \
+    do { if (!(Condition)) ReportFailure(__FILE__, __LINE__, #Condition); } while (0)
+
+// Stops the test case, for conditions the rest of the case depends on
+#define SPYX_REQUIRE(Condition) \
+    do { if (!(Condition)) { ReportFailure(__FILE__, __LINE__, #Condition); return; } } while (0)
+
+// Deterministic generator so failures reproduce
+class CTestRandom
+{
+public:
+    explicit CTestRandom(uint64_t Seed) : MState(Seed * 0x9E3779B97F4A7C15ull + 1) {}
+
+    uint32_t Next()
+    {
+        MState = MState * 6364136223846793005ull + 1442695040888963407ull;
+        return (uint32_t)(MState >> 32);
+    }
+
+    // Uniform in [Low, High]
+    int Range(int Low, int High) { return Low + (int)(Next() % (uint32_t)(High - Low + 1)); }
+
+private:
+    uint64_t MState;
+};
+
+// Benchmarks: repeat count from the command line (default Default), best time in milliseconds
+inline int GetRepeatCount(int ArgumentCount, char **Arguments, int Default)
+{
+    int Repeats = ArgumentCount > 1 ? std::atoi(Arguments[1]) : Default;
+    return Repeats > 0 ? Repeats : 1;
+}
+
+template <typename TBody>
+double MeasureBestMilliseconds(int Repeats, TBody &&Body)
+{
+    double Best = 1e30;
+    for (int Repeat = 0; Repeat < Repeats; Repeat++)
+    {
+        auto Start = std::chrono::steady_clock::now();
+        Body();
+        std::chrono::duration<double, std::milli> Elapsed = std::chrono::steady_clock::now() - Start;
+        Best = std::min(Best, Elapsed.count());
+    }
+    return Best;
+}
+
+#endif
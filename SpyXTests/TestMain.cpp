@@ -0,0 +1,44 @@
+#include "TestFramework.h"
+
+#include <vector>
+
+struct STestCase
+{
+    const char *Name;
+    TestFunction Function;
+};
+
+static std::vector<STestCase> &GetTests()
+{
+    static std::vector<STestCase> Tests;
+    return Tests;
+}
+
+static int FailureCount = 0;
+
+int RegisterTest(const char *Name, TestFunction Function)
+{
+    GetTests().push_back({Name, Function});
+    return (int)GetTests().size();
+}
+
+void ReportFailure(const char *File, int Line, const char *Expression)
+{
+    std::printf("%s:%d: check failed: %s\n", File, Line, Expression);
+    FailureCount++;
+}
+
+int main()
+{
+    int FailedTests = 0;
+    for (const STestCase &Test : GetTests())
+    {
+        int FailuresBefore = FailureCount;
+        Test.Function();
+        bool Passed = FailureCount == FailuresBefore;
+        std::printf("[%s] %s\n", Passed ? "  OK  " : " FAIL ", Test.Name);
+        if (!Passed) FailedTests++;
+    }
+    std::printf("%d of %d tests passed\n", (int)GetTests().size() - FailedTests, (int)GetTests().size());
+    return FailedTests ? 1 : 0;
+}
@@ -0,0 +1,48 @@
+#include "TestFramework.h"
+#include "Imaging/ToneMapper.h"
+
+#include <vector>
+
+// Throughput of the FP16 tone-mapping kernels and the BGRA8 -> Gray8 conversion on a
+// 2560x1440 frame, vectorized against the scalar reference. Usage: ToneMapperBench [repeats]
+int main(int ArgumentCount, char **Arguments)
+{
+    const int Repeats = GetRepeatCount(ArgumentCount, Arguments, 20);
+    const int Width = 2560;
+    const int Height = 1440;
+    const double Megapixels = Width * (double)Height / 1e6;
+
+    CTestRandom Random(2560);
+    std::vector<uint16_t> HalfFrame((size_t)Width * Height * 4);
+    for (uint16_t &Half : HalfFrame) Half = (uint16_t)Random.Range(0x2000, 0x4C00);
+    std::vector<uint8_t> ColorFrame((size_t)Width * Height * 4);
+    for (uint8_t &Byte : ColorFrame) Byte = (uint8_t)Random.Next();
+
+    SImageView HalfView;
+    HalfView.Data = (const uint8_t *)HalfFrame.data();
+    HalfView.Width = Width;
+    HalfView.Height = Height;
+    HalfView.Stride = Width * 8;
+    HalfView.Format = EPixelFormat::RGBA16F;
+
+    SImageView ColorView;
+    ColorView.Data = ColorFrame.data();
+    ColorView.Width = Width;
+    ColorView.Height = Height;
+    ColorView.Stride = Width * 4;
+
+    CToneMapper Mapper;
+    std::vector<uint8_t> Output((size_t)Width * Height * 4);
+    auto Report = [&](const char *Name, double Milliseconds)
+    {
+        std::printf("%-28s %8.2f ms  %8.1f Mpix/s\n", Name, Milliseconds, Megapixels / Milliseconds * 1e3);
+    };
+
+    Report("FP16 -> BGRA8", MeasureBestMilliseconds(Repeats, [&] { Mapper.ToneMapToBGRA8(HalfView, Output.data(), Width * 4); }));
+    Report("FP16 -> BGRA8 (reference)", MeasureBestMilliseconds(Repeats, [&] { Mapper.ToneMapToBGRA8Reference(HalfView, Output.data(), Width * 4); }));
+    Report("FP16 -> Gray8", MeasureBestMilliseconds(Repeats, [&] { Mapper.ToneMapToGray8(HalfView, Output.data(), Width); }));
+    Report("FP16 -> Gray8 (reference)", MeasureBestMilliseconds(Repeats, [&] { Mapper.ToneMapToGray8Reference(HalfView, Output.data(), Width); }));
+    Report("BGRA8 -> Gray8", MeasureBestMilliseconds(Repeats, [&] { ConvertBGRA8ToGray8(ColorView, Output.data(), Width); }));
+    Report("BGRA8 -> Gray8 (reference)", MeasureBestMilliseconds(Repeats, [&] { ConvertBGRA8ToGray8Reference(ColorView, Output.data(), Width); }));
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include "TestFramework.h"
+#include "Imaging/ToneMapper.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// Independent decoder for checking HalfToFloat
+static float DecodeHalf(uint16_t Half)
+{
+    int Sign = Half >> 15;
+    int Exponent = (Half >> 10) & 31;
+    int Mantissa = Half & 1023;
+    float Value;
+    if (Exponent == 0) Value = std::ldexp((float)Mantissa, -24);
+    else if (Exponent == 31) Value = Mantissa ? NAN : INFINITY;
+    else Value = std::ldexp((float)(Mantissa | 1024), Exponent - 25);
+    return Sign ? -Value : Value;
+}
+
+// FP16 frame with a pixel mix of ordinary HDR values, specials and a padded stride
+static std::vector<uint16_t> MakeHalfFrame(CTestRandom &Random, int Height, int StrideHalves)
+{
+    std::vector<uint16_t> Pixels((size_t)StrideHalves * Height);
+    for (uint16_t &Half : Pixels)
+    {
+        switch (Random.Range(0, 9))
+        {
+            case 0: Half = (uint16_t)Random.Next(); break;          // Anything, NaN and infinity included
+            case 1: Half = (uint16_t)Random.Range(0, 1023); break;  // Denormals
+            case 2: Half = (uint16_t)(0x8000 | Random.Range(0, 0x7BFF)); break;
+            default: Half = (uint16_t)Random.Range(0x2000, 0x4C00); break;  // About 0.0005 to 16
+        }
+    }
+    return Pixels;
+}
+
+SPYX_TEST(HalfToFloatMatchesDecoder)
+{
+    int Mismatches = 0;
+    for (int Half = 0; Half < 65536; Half++)
+    {
+        float Expected = DecodeHalf((uint16_t)Half);
+        float Actual = HalfToFloat((uint16_t)Half);
+        bool Same = std::isnan(Expected) ? std::isnan(Actual) : std::memcmp(&Expected, &Actual, sizeof(float)) == 0;
+        if (!Same) Mismatches++;
+    }
+    SPYX_CHECK(Mismatches == 0);
+}
+
+SPYX_TEST(ToneMapMatchesReference)
+{
+    CTestRandom Random(26);
+    const SToneMapSettings SettingsList[] = {{1.0f, 4.0f}, {0.25f, 1.0f}, {3.0f, 12.5f}, {1.0f, 1e-3f}};
+    for (const SToneMapSettings &Settings : SettingsList)
+    {
+        CToneMapper Mapper;
+        Mapper.Configure(Settings);
+        for (int Case = 0; Case < 40; Case++)
+        {
+            const int Width = Random.Range(1, 67);
+            const int Height = Random.Range(1, 5);
+            const int StrideHalves = Width * 4 + Random.Range(0, 3) * 4;
+            std::vector<uint16_t> Frame = MakeHalfFrame(Random, Height, StrideHalves);
+
+            SImageView Source;
+            Source.Data = (const uint8_t *)Frame.data();
+            Source.Width = Width;
+            Source.Height = Height;
+            Source.Stride = StrideHalves * 2;
+            Source.Format = EPixelFormat::RGBA16F;
+
+            const int ColorStride = Width * 4 + 5;
+            std::vector<uint8_t> Fast((size_t)ColorStride * Height, 0xCD), Reference((size_t)ColorStride * Height, 0xCD);
+            Mapper.ToneMapToBGRA8(Source, Fast.data(), ColorStride);
+            Mapper.ToneMapToBGRA8Reference(Source, Reference.data(), ColorStride);
+            SPYX_CHECK(Fast == Reference);
+
+            const int GrayStride = Width + 3;
+            std::vector<uint8_t> FastGray((size_t)GrayStride * Height, 0xCD), ReferenceGray((size_t)GrayStride * Height, 0xCD);
+            Mapper.ToneMapToGray8(Source, FastGray.data(), GrayStride);
+            Mapper.ToneMapToGray8Reference(Source, ReferenceGray.data(), GrayStride);
+            SPYX_CHECK(FastGray == ReferenceGray);
+        }
+    }
+}
+
+SPYX_TEST(ToneMapCurveEndpoints)
+{
+    // Black stays black, the white point reaches full white and is not exceeded above it
+    const uint16_t Zero = 0x0000, One = 0x3C00, Four = 0x4400, Sixteen = 0x4C00;
+    const uint16_t Frame[4 * 4] = {Zero, Zero, Zero, One, One, One, One, One, Four, Four, Four, One, Sixteen, Sixteen, Sixteen, One};
+
+    SImageView Source;
+    Source.Data = (const uint8_t *)Frame;
+    Source.Width = 4;
+    Source.Height = 1;
+    Source.Stride = (int)sizeof(Frame);
+    Source.Format = EPixelFormat::RGBA16F;
+
+    CToneMapper Mapper;
+    uint8_t Output[16] = {};
+    Mapper.ToneMapToBGRA8(Source, Output, 16);
+    SPYX_CHECK(Output[0] == 0 && Output[1] == 0 && Output[2] == 0);
+    SPYX_CHECK(Output[4] > 128 && Output[4] < 255);
+    SPYX_CHECK(Output[8] == 255 && Output[12] == 255);
+}
+
+SPYX_TEST(GrayConversionMatchesReference)
+{
+    CTestRandom Random(601);
+    for (int Case = 0; Case < 60; Case++)
+    {
+        const int Width = Random.Range(1, 80);
+        const int Height = Random.Range(1, 4);
+        const int Stride = Width * 4 + Random.Range(0, 2) * 4;
+        std::vector<uint8_t> Frame((size_t)Stride * Height);
+        for (uint8_t &Byte : Frame) Byte = (uint8_t)Random.Next();
+
+        SImageView Source;
+        Source.Data = Frame.data();
+        Source.Width = Width;
+        Source.Height = Height;
+        Source.Stride = Stride;
+
+        std::vector<uint8_t> Fast((size_t)Width * Height), Reference((size_t)Width * Height);
+        ConvertBGRA8ToGray8(Source, Fast.data(), Width);
+        ConvertBGRA8ToGray8Reference(Source, Reference.data(), Width);
+        SPYX_CHECK(Fast == Reference);
+    }
+}